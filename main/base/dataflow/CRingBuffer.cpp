@@ -17,6 +17,7 @@
 #include "CRingBuffer.h"
 #include "CRingMaster.h"
 #include "ringbufint.h"
+#include "CRingItemIndex.h"
 
 #include <ErrnoException.h>
 #include <RangeError.h>
@@ -29,7 +30,9 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
 #include <time.h>
+#include <signal.h>
 #include <sys/mman.h>
 
 #include <CPortManager.h>
@@ -46,6 +49,53 @@ using namespace std;
 
 static string localhost("127.0.0.1");
 
+// Microseconds on a clock that doesn't jump; used to time blocking waits.
+
+static uint64_t
+monotonicUsec()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec)*1000000 + now.tv_nsec/1000;
+}
+// Count the ring items in a put that starts on an item boundary.  Used
+// when there's no item index to follow items across puts.
+
+static size_t
+itemsIn(const struct iovec* pieces, int nPieces)
+{
+  size_t   nItems = 0;
+  uint64_t start  = 0;		// Stream offset of the current piece.
+  uint64_t next   = 0;		// Stream offset of the next item header.
+  uint8_t  header[2*sizeof(uint32_t)];
+  size_t   nHeader = 0;
+
+  for (int i = 0; i < nPieces; i++) {
+    const uint8_t* p   = reinterpret_cast<const uint8_t*>(pieces[i].iov_base);
+    uint64_t       end = start + pieces[i].iov_len;
+    while (next + nHeader < end) {
+      header[nHeader] = p[next + nHeader - start];
+      if (++nHeader == sizeof(header)) {
+	uint32_t size, type;
+	memcpy(&size, header, sizeof(size));
+	memcpy(&type, header + sizeof(size), sizeof(type));
+	if ((type & 0xffff0000) != 0) {
+	  size = ((size >> 24) & 0xff)     | ((size >> 8) & 0xff00) |
+	         ((size << 8) & 0xff0000)  | ((size << 24) & 0xff000000);
+	}
+	if (size < sizeof(header)) {
+	  return nItems;	// Not ring items.
+	}
+	nItems++;
+	next   += size;
+	nHeader = 0;
+      }
+    }
+    start = end;
+  }
+  return nItems;
+}
+
 
 /*
   This file implements the CRingBuffer class.  
@@ -60,6 +110,7 @@ size_t CRingBuffer::m_defaultMaxConsumers(DEFAULT_MAX_CONSUMERS);
 
 CRingMaster* CRingBuffer::m_pMaster(NULL);
 pid_t        CRingBuffer::m_myPid(-1); // no pid has this.
+int          CRingBuffer::m_notifyMaster(-1); // Look at the environment.
 
 //////////////////////////////////////////////////////////////////////////////
 // 
@@ -112,6 +163,12 @@ public:
                       then destroyed to register this ring.  This is done when
                       the client does not want the ring master fd to be
                       inherited by child processes that may be created.
+  \param maxProducer - Maximum number of simultaneous producers.  Values
+                      larger than 1 make a multi-producer ring.
+  \param memoryOptions - Bitwise or of MemoryOption values.  Pages are placed
+                      and prefaulted when the ring is created; the options
+                      are also recorded so clients apply them when they attach.
+  \param numaNode    - If >= 0 the ring's pages prefer this NUMA node.
 
   \throw CErrnoException
 
@@ -120,7 +177,10 @@ void
 CRingBuffer::create(std::string name, 
 		     size_t dataBytes,
 		     size_t maxConsumer,
-		     bool   tempMasterConnection)
+		     bool   tempMasterConnection,
+		     size_t maxProducer,
+		     unsigned memoryOptions,
+		     int    numaNode)
 {
 
   // Figure out the entire size of the shared memory region and truncate the file to that
@@ -128,6 +188,13 @@ CRingBuffer::create(std::string name,
 
   size_t rawSize   = dataBytes + sizeof(RingHeader) + 
                                  sizeof(ClientInformation)*(maxConsumer+1);
+  if (maxProducer > 1) {
+    rawSize += multiProducerSize(maxProducer);
+  }
+  if (memoryOptions || (numaNode >= 0)) {
+    rawSize += optionsSize();
+  }
+  rawSize += statisticsSize(maxConsumer);
   
   long   pageSize  = sysconf(_SC_PAGESIZE);
   size_t pages     = (rawSize + (pageSize-1))/pageSize;
@@ -144,9 +211,20 @@ CRingBuffer::create(std::string name,
                        CDAQShm::GroupRead | CDAQShm::GroupWrite | CDAQShm::OtherRead | CDAQShm::OtherWrite)) {
       throw CErrnoException("Shared memory creation failed");
     }
+    // Place/prefault the pages before anything touches them.  This is
+    // all optional so failures are ignored.  Locking is per process so
+    // it's left to the clients.
+
+    if (memoryOptions || (numaNode >= 0)) {
+      void* pMemory = CDAQShm::attach(memoryName);
+      if (pMemory) {
+	CDAQShm::tune(pMemory, shmSize, 
+		      shmTuneFlags(memoryOptions) & ~CDAQShm::Lock, numaNode);
+	CDAQShm::detach(pMemory, memoryName, shmSize);
+      }
+    }
   
-  
-    format(name, maxConsumer);
+    format(name, maxConsumer, maxProducer, memoryOptions, numaNode);
   }  else if (isRing(name)) {
       // If the memory region exists - and is a ring
       //  *   If the ring master knows about it it's an error to make a new one.
@@ -205,6 +283,9 @@ CRingBuffer::create(std::string name,
  * @param maxConsumers - Maximum number of consumers.
  * @param tempMasterConnection - If true a temporary connection to the ring master is formed
  *                        then destroyed for the ring registration.
+ * @param maxProducer  - Maximum number of producers (> 1 for a multi-producer ring).
+ * @param memoryOptions - MemoryOption bits (see create).
+ * @param numaNode     - Preferred NUMA node or -1.
  *
  * @note The parameters other than name are only used when the ring needs to be created.
  *
@@ -214,10 +295,12 @@ CRingBuffer::create(std::string name,
  */
 CRingBuffer*
 CRingBuffer::createAndProduce(std::string name, size_t dataBytes, size_t maxConsumer,
-			      bool   tempMasterConnection)
+			      bool   tempMasterConnection, size_t maxProducer,
+			      unsigned memoryOptions, int numaNode)
 {
   if (!isRing(name)) {
-    create(name, dataBytes, maxConsumer, tempMasterConnection);
+    create(name, dataBytes, maxConsumer, tempMasterConnection, maxProducer,
+	   memoryOptions, numaNode);
   }
   return new CRingBuffer(name, producer);
 
@@ -271,6 +354,7 @@ CRingBuffer::remove(string name)
     throw CErrnoException("Shared memory deletion failed");
 
   }
+  CRingItemIndex::remove(name);
 
 }
 
@@ -285,13 +369,20 @@ CRingBuffer::remove(string name)
 
    \param name         - Name of the ring buffer. (a / will be prepended).
    \param maxConsumers - Maximum number of supported consumers.
+   \param maxProducer  - Maximum number of producers.  If larger than 1 a
+                         multi-producer control block is put between the
+                         consumer descriptors and the data.
+   \param memoryOptions - MemoryOption bits to record in the ring.
+   \param numaNode     - NUMA node to record in the ring (-1 for none).
+                         Formatting only records these; see create.
 
    \throw CErrnoException
 
 */
 void 
 CRingBuffer::format(std::string name,
-		    size_t maxConsumer)
+		    size_t maxConsumer, size_t maxProducer,
+		    unsigned memoryOptions, int numaNode)
 {
 
   // need the memory size for initialization.
@@ -322,6 +413,41 @@ CRingBuffer::format(std::string name,
   pHeader->s_topOffset         = memSize-1;
   pHeader->s_dataOffset        = sizeof(RingHeader) + 
                                  sizeof(ClientInformation)*(maxConsumer+1);
+  if (memoryOptions || (numaNode >= 0)) {
+    pRingOptions pOptions =
+      reinterpret_cast<pRingOptions>(reinterpret_cast<char*>(pHeader) +
+				     pHeader->s_dataOffset);
+    memset(pOptions->s_magicString, 0, sizeof(pOptions->s_magicString));
+    strcpy(pOptions->s_magicString, OPTIONS_MAGICSTRING);
+    pOptions->s_memoryOptions = memoryOptions;
+    pOptions->s_numaNode      = numaNode;
+    pHeader->s_dataOffset    += optionsSize();
+  }
+  if (maxProducer > 1) {
+    pMultiProducerHeader pMulti =
+      reinterpret_cast<pMultiProducerHeader>(reinterpret_cast<char*>(pHeader) +
+					     pHeader->s_dataOffset);
+    memset(pMulti->s_magicString, 0, sizeof(pMulti->s_magicString));
+    strcpy(pMulti->s_magicString, MP_MAGICSTRING);
+    pMulti->s_maxProducer  = maxProducer;
+    pMulti->s_publishLock  = 0;
+    pMulti->s_reserved     = 0;	// Position 0 is the start of the data.
+    pMulti->s_published    = 0;
+    for (int i = 0; i < maxProducer; i++) {
+      pMulti->s_producers[i].s_pid       = -1;
+      pMulti->s_producers[i].s_committed = 0;
+      pMulti->s_producers[i].s_start     = NO_RESERVATION;
+      pMulti->s_producers[i].s_end       = NO_RESERVATION;
+    }
+    pHeader->s_dataOffset     += multiProducerSize(maxProducer);
+  }
+  pRingStatistics pStatistics =
+    reinterpret_cast<pRingStatistics>(reinterpret_cast<char*>(pHeader) +
+				      pHeader->s_dataOffset);
+  memset(pStatistics, 0, statisticsSize(maxConsumer));
+  strcpy(pStatistics->s_magicString, STATISTICS_MAGICSTRING);
+  pStatistics->s_nClients      = maxConsumer+1;
+  pHeader->s_dataOffset       += statisticsSize(maxConsumer);
   pHeader->s_dataBytes         = memSize - pHeader->s_dataOffset;
 
   // Fill in the client information data structures:
@@ -431,6 +557,34 @@ CRingBuffer::defaultRingUrl()
   return url;
     
 }
+/*!
+  Determine if ring clients tell the RingMaster about their connections.
+  By default they don't; the ring master finds and frees the slots of
+  clients that have exited by itself.  Its LIST reply and the killing of
+  clients when a ring is removed come from the ring's own pids, so only a
+  RingMaster that predates reaping needs the notifications.
+
+  \param notify - true to send CONNECT/DISCONNECT messages for each client.
+*/
+void
+CRingBuffer::setRingMasterNotification(bool notify)
+{
+  m_notifyMaster = notify ? 1 : 0;
+}
+/*!
+  \return bool - true if clients send CONNECT/DISCONNECT to the RingMaster.
+                 Unless set, this is true if the environment variable
+                 NSCLDAQ_RINGMASTER_NOTIFY is a nonzero integer.
+*/
+bool
+CRingBuffer::getRingMasterNotification()
+{
+  if (m_notifyMaster < 0) {
+    const char* pValue = getenv("NSCLDAQ_RINGMASTER_NOTIFY");
+    m_notifyMaster = (pValue && atoi(pValue)) ? 1 : 0;
+  }
+  return m_notifyMaster != 0;
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////
 // Constructors and canonicals.
@@ -456,7 +610,13 @@ CRingBuffer::CRingBuffer(string name, CRingBuffer::ClientMode mode) :
   m_pClientInfo(0),
   m_mode(mode),
   m_pollInterval(DEFAULT_POLLMS),
-  m_ringName(name)
+  m_ringName(name),
+  m_pIndex(0),
+  m_indexAttempt(0),
+  m_pMulti(0),
+  m_pSlot(0),
+  m_pStats(0),
+  m_notified(false)
 {
   if (!isRing(name)) {
     errno = ENOENT;
@@ -470,12 +630,30 @@ CRingBuffer::CRingBuffer(string name, CRingBuffer::ClientMode mode) :
   // Now that we're mapped the remainder of the constructor must execute in a try
   // block so that failure will allow us to unmap the ring.
   //
+  m_pMulti = multiProducerHeader(m_pRing);
+  if (mode != manager) {
+    applyMemoryOptions();
+  }
   try {
-    if (m_mode == producer) {
-      if (m_pRing->s_producer.s_pid == -1) {
-	m_pClientInfo         = &(m_pRing->s_producer);
-	m_pClientInfo->s_pid  = getpid(); // leave the offset where it was.
+    if ((m_mode == producer) && m_pMulti) {
+      attachProducerSlot();
+    }
+    else if (m_mode == producer) {
+      // Claim the producer atomically; a producer that died without
+      // detaching (and has not been cleaned up yet) doesn't count.
+
+      pid_t me    = getpid();
+      pid_t owner = m_pRing->s_producer.s_pid;
+      if (__sync_bool_compare_and_swap(&(m_pRing->s_producer.s_pid), -1, me) ||
+	  ((owner > 0) && processDead(owner) &&
+	   __sync_bool_compare_and_swap(&(m_pRing->s_producer.s_pid), owner, me))) {
+	m_pClientInfo         = &(m_pRing->s_producer); // leave the offset where it was.
+	m_pStats              = clientStatistics(0);
+	if (m_pStats) {
+	  memset(m_pStats, 0, sizeof(ClientStatistics));
+	}
 	__sync_synchronize();		  // And flush to shm.
+	attachIndex();
 
       }
       else {
@@ -499,18 +677,19 @@ CRingBuffer::CRingBuffer(string name, CRingBuffer::ClientMode mode) :
     throw;
   }
   // We got this far we have a connection.  If this is not a manager connection,
-  // we can register with the ringmaster:
+  // and we've been asked to, we can register with the ringmaster:
 
   try {
-    if (mode != manager) {
+    if ((mode != manager) && getRingMasterNotification()) {
       connectToRingMaster();	// This will only really connect the first time.
       notifyConnection();		// Let the ring master know of our connection
+      m_notified = true;
     }
   }
   catch(...) {
     // on any failure, we give up the ring and throw:
 
-    m_pClientInfo->s_pid = -1;
+    releaseClient();
     unMapRing();
     throw;
   }
@@ -523,12 +702,14 @@ CRingBuffer::~CRingBuffer()
 
   string ringname = m_ringName;
   if (m_mode != manager) {
-    m_pClientInfo->s_pid = -1;
+    releaseClient();
     // Let the ringmaster know we're disconnecting.
     // the client pointer is still valid as is the map so the notification
     // can still find the 'slot number.
     
-    notifyDisconnection();
+    if (m_notified) {
+      notifyDisconnection();
+    }
 
   }
 
@@ -536,6 +717,7 @@ CRingBuffer::~CRingBuffer()
   
   // Unmap the ring and ensure that any use of this ring will fail utterly.
 
+  delete m_pIndex;
   unMapRing();
 
   // Zeroing pointers ensures that attempts to use this object will segflt.
@@ -583,7 +765,7 @@ CRingBuffer::put(const void* pBuffer, size_t nBytes, unsigned long timeout)
     throw CStateException(modeString().c_str(), "producer", 
 			  "CRingBuffer::put");
   }
-  if(m_myPid != m_pClientInfo->s_pid) {
+  if(!ownsProducer()) {
     throw CStateException("My PID", "Someone else's pid",
 			  "CRingBuffer::get");
   }
@@ -595,6 +777,10 @@ CRingBuffer::put(const void* pBuffer, size_t nBytes, unsigned long timeout)
 		      "CRingBuffer::put");
 
   }
+  if (m_pMulti) {
+    struct iovec piece = {const_cast<void*>(pBuffer), nBytes};
+    return putMulti(&piece, 1, nBytes, timeout);
+  }
   // Block until we have space. 
 
   CRingFreeSpacePredicate condition(nBytes);
@@ -634,6 +820,10 @@ CRingBuffer::put(const void* pBuffer, size_t nBytes, unsigned long timeout)
 
   }
   Skip(nBytes);
+  struct iovec piece = {const_cast<void*>(pBuffer), nBytes};
+  countTransfer(nBytes, m_pIndex ?
+		m_pIndex->record(&piece, 1, m_pClientInfo->s_offset) :
+		itemsIn(&piece, 1));
 
   // If we got this far success... issue a memory barrier to ensure this all is
   // written to the shm:
@@ -643,6 +833,67 @@ CRingBuffer::put(const void* pBuffer, size_t nBytes, unsigned long timeout)
   return nBytes;
 }
 
+/*!
+   Gather put: put several discontiguous pieces of data into the ring as a
+   single contiguous chunk.  This lets a producer build an item from a
+   small header it formats and a body that lives elsewhere (e.g. in an
+   input buffer) without first copying them together.  Space is waited for
+   once for the total size and the put pointer is only advanced once all
+   pieces are in the ring so consumers never see a partial chunk.
+
+   \param pieces  - Pointer to the iovec array describing the data.
+   \param nPieces - Number of elements in pieces.
+   \param timeout - As for put.
+
+   \return size_t
+   \retval total number of bytes written - on success.
+   \retval 0 - Wait for available space timed out.
+
+   \throw CRangeException - The total amount of data is larger than the
+                            size of the ring buffer data segment.
+   \throw CStateException - This CRingBufferObject is not open for producer use.
+*/
+size_t
+CRingBuffer::putv(const struct iovec* pieces, int nPieces, unsigned long timeout)
+{
+  if (m_mode != producer) {
+    throw CStateException(modeString().c_str(), "producer", 
+			  "CRingBuffer::putv");
+  }
+  if(!ownsProducer()) {
+    throw CStateException("My PID", "Someone else's pid",
+			  "CRingBuffer::putv");
+  }
+
+  size_t nBytes = 0;
+  for (int i = 0; i < nPieces; i++) {
+    nBytes += pieces[i].iov_len;
+  }
+  if (nBytes > m_pRing->s_header.s_dataBytes) {
+    throw CRangeError(0, m_pRing->s_header.s_dataBytes, nBytes,
+		      "CRingBuffer::putv");
+  }
+  if (m_pMulti) {
+    return putMulti(pieces, nPieces, nBytes, timeout);
+  }
+
+  CRingFreeSpacePredicate condition(nBytes);
+  int status = blockWhile(condition, timeout);
+  if (status) {
+    return 0;			// timed out.
+  }
+  // Copy the pieces in and only then publish them by moving the put offset.
+
+  copyIn(pieces, nPieces, m_pClientInfo->s_offset);
+  Skip(nBytes);
+  countTransfer(nBytes, m_pIndex ?
+		m_pIndex->record(pieces, nPieces, m_pClientInfo->s_offset) :
+		itemsIn(pieces, nPieces));
+  __sync_synchronize();
+
+  return nBytes;
+}
+
 /*!
    Get data from the ring buffer.  This object must have been opened 
    in consumer mode else a CStateException is thrown.
@@ -715,6 +966,7 @@ CRingBuffer::get(void*        pBuffer,
 
   peek(pBuffer, transferSize);
   Skip(transferSize);
+  countTransfer(transferSize, 0); // Callers that know about items count them.
 
 
 
@@ -818,6 +1070,64 @@ CRingBuffer:: skip(size_t nBytes)
 
   }
   Skip(nBytes);
+  countTransfer(nBytes, 0);
+}
+/*!
+   Use the ring's item index (if it has one) to skip over items the caller
+   does not want without looking at them.  The get pointer is left at the
+   next item the index says might be wanted or, if there are none, at the
+   first item that is not yet complete in the ring.  Nothing is skipped if
+   the index can't be used (see CRingItemIndex::locate).
+
+   Consumers attach to the index lazily.  If the ring has no index (e.g.
+   the producer predates them) this is retried at most once a second.
+
+   \param filter - Decides which item types are unwanted.
+   \return size_t - Number of bytes skipped.
+
+   \throw CStateException - This is not a consumer object.
+*/
+size_t
+CRingBuffer::skipUnwanted(CRingItemIndex::CTypeFilter& filter)
+{
+  if (m_mode != consumer) {
+    throw CStateException(modeString().c_str(), "consumer",
+			  "CRingBuffer::skipUnwanted");
+  }
+  if (!m_pIndex) {
+    time_t now = time(NULL);
+    if (now == m_indexAttempt) {
+      return 0;
+    }
+    m_indexAttempt = now;
+    attachIndex();
+    if (!m_pIndex) {
+      return 0;
+    }
+  }
+  size_t nSkip;
+  size_t behind;
+  if (m_pIndex->locate(m_pClientInfo->s_offset, filter, nSkip, behind) &&
+      nSkip && (behind <= availableData())) {
+    Skip(nSkip);
+    countTransfer(nSkip, 0);
+    return nSkip;
+  }
+  return 0;
+}
+/*!
+   Count ring items a consumer got.  The ring only moves bytes and a
+   consumer may get an item in several pieces (or several items at once)
+   so get leaves item counting to callers that know where items are.
+
+   \param nItems - Number of complete items gotten.
+*/
+void
+CRingBuffer::countItems(size_t nItems)
+{
+  if (m_pStats) {
+    m_pStats->s_items += nItems;
+  }
 }
 /////////////////////////////////////////////////////////////////////////////////
 // Manage the blocking latencies.
@@ -861,6 +1171,18 @@ CRingBuffer::availablePutSpace()
   pRingHeader pHeader   = reinterpret_cast<pRingHeader>(m_pRing);
   size_t      consumers = pHeader->s_maxConsumer;
 
+  // In multi-producer rings, space that's been reserved but not yet
+  // published is in use too.  The published position must be read before
+  // the consumer offsets so that we never underestimate what's in use.
+
+  uint64_t pending = 0;
+  if (m_pMulti) {
+    uint64_t reserved  = m_pMulti->s_reserved;
+    uint64_t published = m_pMulti->s_published;
+    __sync_synchronize();
+    if (reserved > published) pending = reserved - published;
+  }
+
   pClientInformation pClients = reinterpret_cast<pClientInformation>(reinterpret_cast<char*>(m_pRing) + 
 								      pHeader->s_firstConsumer);
 
@@ -887,7 +1209,7 @@ CRingBuffer::availablePutSpace()
 
     pClients++;
   }
-  return minFree;
+  return (minFree > pending) ? (minFree - pending) : 0;
 }
 
 
@@ -930,6 +1252,7 @@ CRingBuffer::getUsage()
   result.s_putSpace    = availablePutSpace();
   result.s_maxConsumers= pHead->s_maxConsumer;
   result.s_producer    = pProducer->s_pid;
+  result.s_producerCounters = counters(0);
 
   // Get information about all the consumers:
 
@@ -939,6 +1262,7 @@ CRingBuffer::getUsage()
       info.first  = pConsumers->s_pid;
       info.second = difference(*pProducer, *pConsumers);
       result.s_consumers.push_back(info);
+      result.s_consumerCounters.push_back(counters(i+1));
     }
     pConsumers++;
   }
@@ -980,6 +1304,25 @@ CRingBuffer::getSlot()
   }
   return -2;			// Really 'impossible'.
 }
+/*!
+  \return bool
+  \retval true - the ring accepts more than one producer.
+*/
+bool
+CRingBuffer::isMultiProducer() const
+{
+  return m_pMulti != 0;
+}
+/*!
+  \return unsigned
+  \retval The MemoryOption bits the ring was created with.
+*/
+unsigned
+CRingBuffer::getMemoryOptions()
+{
+  pRingOptions pOptions = ringOptions(m_pRing);
+  return pOptions ? pOptions->s_memoryOptions : 0;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 //  Blocking functions:
@@ -998,6 +1341,9 @@ CRingBuffer::getSlot()
     \return int
     \retval 0    - Blocking ended normally.
     \retval -1   - Blocking timed out.
+
+    \note If the caller actually has to wait, the wait and its duration
+          are added to the client's blocking counters.
 */
 int 
 CRingBuffer::blockWhile(CRingBuffer::CRingBufferPredicate& pred, unsigned long timeout)
@@ -1005,15 +1351,26 @@ CRingBuffer::blockWhile(CRingBuffer::CRingBufferPredicate& pred, unsigned long t
   // Lower the latencey by special casing the timeout == 0:
 
   if (timeout) {
-    time_t start = time(NULL);
-    while (pred(*this)) {
+    if (!pred(*this)) {
+      return 0;			// The usual case, no wait at all.
+    }
+    uint64_t blockStart = monotonicUsec();
+    time_t   start      = time(NULL);
+    int      status     = 0;
+    do {
       time_t now = time(NULL);
-      if ((now - start) >= timeout) 
-	return -1; // timeout
+      if ((now - start) >= timeout) {
+	status = -1; // timeout
+	break;
+      }
       pollblock(); // wait a bit before checking condition.
+    } while (pred(*this));
+
+    if (m_pStats) {
+      m_pStats->s_blocks++;
+      m_pStats->s_blockedUsec += monotonicUsec() - blockStart;
     }
-    
-    return 0;			// condition no longer true.
+    return status;
   }
   else {
     return pred(*this) ? -1 : 0;
@@ -1049,6 +1406,8 @@ CRingBuffer::pollblock()
 
 /*!
    Force the release of the producer.  This requires that we are connected as a manager.
+   In a multi-producer ring only the slots of producers that have exited are
+   released, since we can't tell which of the live ones is meant.
    
 */
 void
@@ -1058,7 +1417,24 @@ CRingBuffer::forceProducerRelease()
     throw CStateException(modeString().c_str(), "manager",
 			  "CRingBuffer::forceProducerRelease");
   }
-  m_pRing->s_producer.s_pid = -1;
+  if (m_pMulti) {
+    pid_t remaining = -1;
+    for (int i = 0; i < m_pMulti->s_maxProducer; i++) {
+      pProducerSlot p = &(m_pMulti->s_producers[i]);
+      pid_t pid = p->s_pid;
+      if (pid > 0) {
+	if (kill(pid, 0) && (errno == ESRCH)) {
+	  p->s_pid = -1;
+	} else {
+	  remaining = pid;
+	}
+      }
+    }
+    m_pRing->s_producer.s_pid = remaining;
+  }
+  else {
+    m_pRing->s_producer.s_pid = -1;
+  }
 }
 
 /*!
@@ -1084,9 +1460,73 @@ CRingBuffer::forceConsumerRelease(unsigned slot)
   m_pRing->s_consumers[slot].s_pid = -1;
 }
 
+/*!
+  Free the slots of clients whose processes no longer exist.  This is
+  how the RingMaster cleans up after clients that exit without detaching,
+  since clients don't tell it about their connections.  Requires that we
+  are connected as a manager.
+
+  \return unsigned - number of slots freed.
+
+  \throw CStateException - the mode is not manager.
+*/
+unsigned
+CRingBuffer::releaseDeadClients()
+{
+  if (m_mode != manager) {
+    throw CStateException(modeString().c_str(), "manager",
+			  "CRingBuffer::releaseDeadClients");
+  }
+  unsigned released = 0;
+  if (m_pMulti) {
+    pid_t remaining = -1;
+    bool  changed   = false;
+    for (int i = 0; i < m_pMulti->s_maxProducer; i++) {
+      pProducerSlot p   = &(m_pMulti->s_producers[i]);
+      pid_t         pid = p->s_pid;
+      if (pid > 0) {
+	if (processDead(pid) && __sync_bool_compare_and_swap(&(p->s_pid), pid, -1)) {
+	  released++;
+	  changed = true;
+	} else {
+	  remaining = pid;
+	}
+      }
+    }
+    if (changed) {
+      m_pRing->s_producer.s_pid = remaining;
+    }
+  } else {
+    pid_t pid = m_pRing->s_producer.s_pid;
+    if ((pid > 0) && processDead(pid) &&
+	__sync_bool_compare_and_swap(&(m_pRing->s_producer.s_pid), pid, -1)) {
+      released++;
+    }
+  }
+  for (int i = 0; i < m_pRing->s_header.s_maxConsumer; i++) {
+    pClientInformation p   = &(m_pRing->s_consumers[i]);
+    pid_t              pid = p->s_pid;
+    if ((pid > 0) && processDead(pid) &&
+	__sync_bool_compare_and_swap(&(p->s_pid), pid, -1)) {
+      released++;
+    }
+  }
+  __sync_synchronize();
+  return released;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // Private utility functions
 
+/******************************************************************/
+/* True if there's no process with the pid given.                 */
+/******************************************************************/
+bool
+CRingBuffer::processDead(pid_t pid)
+{
+  return (kill(pid, 0) < 0) && (errno == ESRCH);
+}
+
 /*******************************************************************/
 /*  Return the amount of data available for a single client.       */
 /******************************************************************/
@@ -1158,10 +1598,18 @@ CRingBuffer::allocateConsumer()
   pClientInformation put= reinterpret_cast<pClientInformation>(reinterpret_cast<char*>(m_pRing) +
 							   pHeader->s_producerInfo);
 
-  for (int i =0; i < nConsumers; i++) {
-    if (p->s_pid == -1) {
-      p->s_pid = 0;		// Claim it as in use but not active.
-      __sync_synchronize();	// Flush to shm as well.
+  // First look for a free slot.  If there are none, take one whose
+  // owner has died but has not been cleaned up yet.  Slots are claimed
+  // atomically as in use but not active (pid 0).
+
+  pClientInformation first = p;
+  for (int i = 0; i < 2*nConsumers; i++) {
+    if (i == nConsumers) {
+      p = first;
+    }
+    pid_t pid   = p->s_pid;
+    bool  claim = (i < nConsumers) ? (pid == -1) : ((pid > 0) && processDead(pid));
+    if (claim && __sync_bool_compare_and_swap(&(p->s_pid), pid, 0)) {
 
       // The loop below deals with any cases where the put pointer moved
       // While we were joining up.
@@ -1171,6 +1619,10 @@ CRingBuffer::allocateConsumer()
 	__sync_synchronize();
       }
 
+      m_pStats = clientStatistics((p - first) + 1);
+      if (m_pStats) {
+	memset(m_pStats, 0, sizeof(ClientStatistics));
+      }
       p->s_pid = getpid();	   // now unstall any free space computations
       m_pClientInfo = p;
       __sync_synchronize();	// Flush to shm as well.
@@ -1227,6 +1679,300 @@ CRingBuffer::Skip(size_t nBytes)
 
   __sync_synchronize();
 }
+/******************************************************************/
+/* Attach to the ring's item index.  Producers create the index   */
+/* if needed and start a new epoch in it.  The index is optional  */
+/* so failures just leave us without one.                         */
+/******************************************************************/
+void
+CRingBuffer::attachIndex()
+{
+  if (m_pMulti) {
+    return;			// Index is maintained by single producers only.
+  }
+  try {
+    if (m_mode == producer) {
+      if (!CRingItemIndex::exists(m_ringName)) {
+	CRingItemIndex::create(m_ringName);
+      }
+      m_pIndex = new CRingItemIndex(m_ringName, m_pRing->s_header.s_dataBytes);
+      m_pIndex->reset(m_pClientInfo->s_offset);
+    } else if (CRingItemIndex::exists(m_ringName)) {
+      m_pIndex = new CRingItemIndex(m_ringName, m_pRing->s_header.s_dataBytes);
+    }
+  }
+  catch (...) {
+    m_pIndex = 0;
+  }
+}
+/******************************************************************/
+/* Copy data into the ring starting at the given offset, wrapping */
+/* as needed.  No pointers are moved.                             */
+/******************************************************************/
+void
+CRingBuffer::copyIn(const struct iovec* pieces, int nPieces, off_t offset)
+{
+  off_t ringBase = m_pRing->s_header.s_dataOffset;
+  off_t ringTop  = m_pRing->s_header.s_topOffset;
+  char* pRing    = reinterpret_cast<char*>(m_pRing);
+
+  for (int i = 0; i < nPieces; i++) {
+    const char* pSrc  = reinterpret_cast<const char*>(pieces[i].iov_base);
+    size_t      nLeft = pieces[i].iov_len;
+    while (nLeft) {
+      size_t chunk = ringTop + 1 - offset;
+      if (chunk > nLeft) chunk = nLeft;
+      memcpy(pRing + offset, pSrc, chunk);
+      pSrc   += chunk;
+      nLeft  -= chunk;
+      offset += chunk;
+      if (offset > ringTop) offset = ringBase;
+    }
+  }
+}
+/******************************************************************/
+/* Add a completed transfer to our counters.  Multi-producer      */
+/* rings share the producer counters so those are atomic adds.    */
+/******************************************************************/
+void
+CRingBuffer::countTransfer(size_t nBytes, size_t nItems)
+{
+  if (!m_pStats) return;
+
+  if (m_pSlot) {
+    __sync_fetch_and_add(&(m_pStats->s_bytes), uint64_t(nBytes));
+    __sync_fetch_and_add(&(m_pStats->s_items), uint64_t(nItems));
+  }
+  else {
+    m_pStats->s_bytes += nBytes;
+    m_pStats->s_items += nItems;
+  }
+  m_pStats->s_lastActivity = time(NULL);
+}
+/******************************************************************/
+/* Return the statistics entry for a client (0 is the producer,   */
+/* 1+i consumer i) or null if the ring predates the statistics.   */
+/******************************************************************/
+ClientStatistics*
+CRingBuffer::clientStatistics(unsigned index)
+{
+  pRingStatistics pStatistics = ringStatistics(m_pRing);
+  if (pStatistics && (index < pStatistics->s_nClients)) {
+    return &(pStatistics->s_clients[index]);
+  }
+  return 0;
+}
+/******************************************************************/
+/* Snapshot a client's counters; all zero for rings that don't    */
+/* keep them.                                                     */
+/******************************************************************/
+CRingBuffer::ClientCounters
+CRingBuffer::counters(unsigned index)
+{
+  ClientCounters     result = {0, 0, 0, 0, 0};
+  pClientStatistics  p      = clientStatistics(index);
+  if (p) {
+    result.s_bytes        = p->s_bytes;
+    result.s_items        = p->s_items;
+    result.s_blockedUsec  = p->s_blockedUsec;
+    result.s_blocks       = p->s_blocks;
+    result.s_lastActivity = p->s_lastActivity;
+  }
+  return result;
+}
+/******************************************************************/
+/* Claim a free slot in a multi-producer ring.  Slots whose last  */
+/* reservation has not been published yet are not free even if   */
+/* their owner has gone.                                          */
+/******************************************************************/
+void
+CRingBuffer::attachProducerSlot()
+{
+  pid_t me = getpid();
+  for (int i = 0; i < m_pMulti->s_maxProducer; i++) {
+    pProducerSlot p = &(m_pMulti->s_producers[i]);
+    if ((p->s_start == NO_RESERVATION) &&
+	__sync_bool_compare_and_swap(&(p->s_pid), -1, me)) {
+      m_pSlot              = p;
+      m_pClientInfo        = &(m_pRing->s_producer);
+      m_pStats             = clientStatistics(0); // Shared by the producers.
+      m_pClientInfo->s_pid = me;	// Usage shows the latest producer.
+      __sync_synchronize();
+      return;
+    }
+  }
+  errno = EACCES;
+  throw CErrnoException("CRingBuffer::CRingBuffer - all producer slots in use");
+}
+/******************************************************************/
+/* Apply the per process parts of the ring's memory options to    */
+/* our mapping.  These are optimizations so failures are ignored. */
+/******************************************************************/
+void
+CRingBuffer::applyMemoryOptions()
+{
+  pRingOptions pOptions = ringOptions(m_pRing);
+  if (pOptions) {
+    unsigned flags = shmTuneFlags(pOptions->s_memoryOptions);
+    if (flags) {
+      CDAQShm::tune(m_pRing, m_pRing->s_header.s_topOffset + 1, flags);
+    }
+  }
+}
+/******************************************************************/
+/* Give up our client slot.  A multi-producer that leaves hands   */
+/* the producer pid shown in the usage to one that remains.       */
+/******************************************************************/
+void
+CRingBuffer::releaseClient()
+{
+  if (m_pSlot) {
+    m_pSlot->s_pid = -1;
+    pid_t remaining = -1;
+    for (int i = 0; i < m_pMulti->s_maxProducer; i++) {
+      pid_t pid = m_pMulti->s_producers[i].s_pid;
+      if (pid > 0) remaining = pid;
+    }
+    m_pRing->s_producer.s_pid = remaining;
+  }
+  else {
+    m_pClientInfo->s_pid = -1;
+  }
+  __sync_synchronize();
+}
+/******************************************************************/
+/* True if we (still) own our producer slot.                      */
+/******************************************************************/
+bool
+CRingBuffer::ownsProducer() const
+{
+  if (m_pSlot) {
+    return m_pSlot->s_pid == m_myPid;
+  }
+  return m_pClientInfo->s_pid == m_myPid;
+}
+/******************************************************************/
+/* Put for multi-producer rings: reserve space, copy the data in, */
+/* mark our slot committed and publish what we can.               */
+/******************************************************************/
+size_t
+CRingBuffer::putMulti(const struct iovec* pieces, int nPieces, size_t nBytes,
+		      unsigned long timeout)
+{
+  uint64_t position;
+  if (!reserve(nBytes, position)) {
+    if (timeout == 0) {
+      return 0;
+    }
+    uint64_t blockStart = monotonicUsec();
+    time_t   start      = time(NULL);
+    bool     timedOut   = false;
+    do {
+      if ((time(NULL) - start) >= timeout) {
+	timedOut = true;
+	break;
+      }
+      pollblock();
+    } while (!reserve(nBytes, position));
+
+    if (m_pStats) {
+      __sync_fetch_and_add(&(m_pStats->s_blocks), uint64_t(1));
+      __sync_fetch_and_add(&(m_pStats->s_blockedUsec), monotonicUsec() - blockStart);
+    }
+    if (timedOut) {
+      return 0;			// timed out.
+    }
+  }
+  copyIn(pieces, nPieces,
+	 m_pRing->s_header.s_dataOffset + position % m_pRing->s_header.s_dataBytes);
+  __sync_synchronize();		// Data must land before the commit.
+  m_pSlot->s_committed = 1;
+  __sync_synchronize();
+
+  publish();
+  countTransfer(nBytes, itemsIn(pieces, nPieces));
+  return nBytes;
+}
+/******************************************************************/
+/* Try to reserve nBytes of the ring.  Fails if there's no room   */
+/* or our previous put has not been published yet (each slot      */
+/* tracks a single reservation).  The slot is filled in before    */
+/* the reservation cursor moves so whoever publishes can always   */
+/* find it.                                                       */
+/******************************************************************/
+bool
+CRingBuffer::reserve(size_t nBytes, uint64_t& position)
+{
+  if (m_pSlot->s_start != NO_RESERVATION) {
+    return false;
+  }
+  while (1) {
+    uint64_t reserved = m_pMulti->s_reserved;
+    if (nBytes > availablePutSpace()) {
+      return false;
+    }
+    m_pSlot->s_committed = 0;
+    __sync_synchronize();
+    m_pSlot->s_end       = reserved + nBytes;
+    m_pSlot->s_start     = reserved;
+    __sync_synchronize();
+    if (__sync_bool_compare_and_swap(&(m_pMulti->s_reserved),
+				     reserved, reserved + nBytes)) {
+      position = reserved;
+      return true;
+    }
+    m_pSlot->s_start = NO_RESERVATION; // Lost the race, try again.
+    __sync_synchronize();
+  }
+}
+/******************************************************************/
+/* Move the published position over committed reservations in     */
+/* order.  Only one client publishes at a time; anyone whose      */
+/* commit lands while someone else holds the lock is taken care   */
+/* of by the recheck the lock holder makes after releasing it.    */
+/******************************************************************/
+void
+CRingBuffer::publish()
+{
+  pRingHeader pHeader = &(m_pRing->s_header);
+
+  while (__sync_lock_test_and_set(&(m_pMulti->s_publishLock), 1) == 0) {
+    pProducerSlot p;
+    while ((p = publishable())) {
+      uint64_t end = p->s_end;
+
+      // The put offset moves before the published position so a reader of
+      // the published position always sees an offset at least that far on.
+
+      m_pRing->s_producer.s_offset = pHeader->s_dataOffset + end % pHeader->s_dataBytes;
+      __sync_synchronize();
+      m_pMulti->s_published = end;
+      p->s_committed        = 0;
+      __sync_synchronize();
+      p->s_start            = NO_RESERVATION; // Frees the owner to put again.
+      __sync_synchronize();
+    }
+    __sync_lock_release(&(m_pMulti->s_publishLock));
+    __sync_synchronize();
+    if (!publishable()) break;
+  }
+}
+/******************************************************************/
+/* Return the slot holding the committed reservation that starts  */
+/* at the published position or null if there isn't one.          */
+/******************************************************************/
+ProducerSlot*
+CRingBuffer::publishable()
+{
+  uint64_t published = m_pMulti->s_published;
+  for (int i = 0; i < m_pMulti->s_maxProducer; i++) {
+    pProducerSlot p = &(m_pMulti->s_producers[i]);
+    if ((p->s_start == published) && p->s_committed) {
+      return p;
+    }
+  }
+  return 0;
+}
 /***************************************************************/
 /* Return the stringified mode                                 */
 /**************************************************************/
@@ -1308,3 +2054,105 @@ CRingBuffer::ringHeader(RingBuffer* p)
 return strncmp(p->s_header.s_magicString, 
 	       MAGICSTRING, strlen(MAGICSTRING)) == 0;
 }
+/**********************************************************************/
+/* Return a pointer to the multi-producer control block of a ring or  */
+/* null if it is a single producer ring.                              */
+/**********************************************************************/
+MultiProducerHeader*
+CRingBuffer::multiProducerHeader(RingBuffer* p)
+{
+  return reinterpret_cast<pMultiProducerHeader>(extensionBlock(p, MP_MAGICSTRING));
+}
+/**********************************************************************/
+/* Return a pointer to the memory options block of a ring or null if  */
+/* it was made without any.                                           */
+/**********************************************************************/
+RingOptions*
+CRingBuffer::ringOptions(RingBuffer* p)
+{
+  return reinterpret_cast<pRingOptions>(extensionBlock(p, OPTIONS_MAGICSTRING));
+}
+/**********************************************************************/
+/* Return a pointer to the client statistics block of a ring or null  */
+/* if the ring was formatted before there were statistics.            */
+/**********************************************************************/
+RingStatistics*
+CRingBuffer::ringStatistics(RingBuffer* p)
+{
+  return reinterpret_cast<pRingStatistics>(extensionBlock(p, STATISTICS_MAGICSTRING));
+}
+/**********************************************************************/
+/* Find an extension block by its magic string.  The blocks are       */
+/* walked from the end of the consumer descriptors to the data.       */
+/**********************************************************************/
+void*
+CRingBuffer::extensionBlock(RingBuffer* p, const char* magic)
+{
+  char*  pBase  = reinterpret_cast<char*>(p);
+  size_t offset = sizeof(RingHeader) + 
+                  sizeof(ClientInformation)*(p->s_header.s_maxConsumer+1);
+  size_t magicSize = sizeof(p->s_header.s_magicString);
+
+  while ((offset + magicSize) <= size_t(p->s_header.s_dataOffset)) {
+    char* pBlock = pBase + offset;
+    if (strncmp(pBlock, magic, magicSize) == 0) {
+      return pBlock;
+    }
+    if (strncmp(pBlock, OPTIONS_MAGICSTRING, magicSize) == 0) {
+      offset += optionsSize();
+    }
+    else if (strncmp(pBlock, MP_MAGICSTRING, magicSize) == 0) {
+      offset += multiProducerSize(
+        reinterpret_cast<pMultiProducerHeader>(pBlock)->s_maxProducer
+      );
+    }
+    else if (strncmp(pBlock, STATISTICS_MAGICSTRING, magicSize) == 0) {
+      offset += statisticsSize(
+        reinterpret_cast<pRingStatistics>(pBlock)->s_nClients - 1
+      );
+    }
+    else {
+      break;
+    }
+  }
+  return 0;
+}
+/**********************************************************************/
+/* Bytes needed for a multi-producer control block, kept a multiple   */
+/* of 8 so the data segment stays aligned.                            */
+/**********************************************************************/
+size_t
+CRingBuffer::multiProducerSize(size_t maxProducer)
+{
+  size_t size = sizeof(MultiProducerHeader) + sizeof(ProducerSlot)*(maxProducer-1);
+  return (size + 7) & ~size_t(7);
+}
+/**********************************************************************/
+/* Bytes needed for the memory options block.                         */
+/**********************************************************************/
+size_t
+CRingBuffer::optionsSize()
+{
+  return (sizeof(RingOptions) + 7) & ~size_t(7);
+}
+/**********************************************************************/
+/* Bytes needed for the client statistics block.                      */
+/**********************************************************************/
+size_t
+CRingBuffer::statisticsSize(size_t maxConsumer)
+{
+  size_t size = sizeof(RingStatistics) + sizeof(ClientStatistics)*maxConsumer;
+  return (size + 7) & ~size_t(7);
+}
+/**********************************************************************/
+/* Translate MemoryOption bits to CDAQShm::tune flags.                */
+/**********************************************************************/
+unsigned
+CRingBuffer::shmTuneFlags(unsigned memoryOptions)
+{
+  unsigned flags = 0;
+  if (memoryOptions & hugePages)  flags |= CDAQShm::HugePages;
+  if (memoryOptions & prefault)   flags |= CDAQShm::Prefault;
+  if (memoryOptions & lockMemory) flags |= CDAQShm::Lock;
+  return flags;
+}
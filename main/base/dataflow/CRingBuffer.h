@@ -47,15 +47,62 @@
 #endif
 #endif
 
+#ifndef __CRT_SYS_UIO_H
+#include <sys/uio.h>
+#ifndef __CRT_SYS_UIO_H
+#define __CRT_SYS_UIO_H
+#endif
+#endif
+
+#ifndef __CRT_TIME_H
+#include <time.h>
+#ifndef __CRT_TIME_H
+#define __CRT_TIME_H
+#endif
+#endif
+
 // Forward class/struct definitions.
 
 typedef struct __RingBuffer        RingBuffer;
 typedef struct __ClientInformation ClientInformation;
+typedef struct __MultiProducerHeader MultiProducerHeader;
+typedef struct __ProducerSlot      ProducerSlot;
+typedef struct __RingOptions       RingOptions;
+typedef struct __RingStatistics    RingStatistics;
+typedef struct __ClientStatistics  ClientStatistics;
 class CRingMaster;
 
+#ifndef __CRINGITEMINDEX_H
+#include "CRingItemIndex.h"
+#endif
+
 /*!
    The ring buffer class manages a single producer multi-consumer ring  buffer.
    This class provides object oriented access to the ring buffer.
+
+   Rings created with maxProducer > 1 accept that many concurrent producers.
+   Each put reserves space atomically and the data becomes visible to
+   consumers, in reservation order, once all earlier puts have completed.
+   Consumers can't tell the difference between the two kinds of ring.
+
+   Memory options given at creation time can ask for transparent huge pages,
+   prefaulting, locking and a preferred NUMA node.  They are recorded in the
+   ring so every client that attaches applies the per process ones (huge page
+   advice, prefault, lock) to its own mapping.  All of them are best effort.
+
+   Each client also keeps cumulative counters (bytes, ring items, time spent
+   blocked and number of blocking waits, time of last transfer) in the ring.
+   getUsage reports them for every client.  Producers count the item headers
+   in what they put.  The ring can't tell where a consumer's items start, so
+   consumers that get whole items (CRingItem::getFromRing does) count them
+   with countItems.
+
+   Attaching and detaching only touch the ring's shared memory: the client's
+   pid is recorded in its slot.  The RingMaster frees the slots of clients
+   that died (see releaseDeadClients) so there is no per client TCP
+   transaction with it unless setRingMasterNotification (or the environment
+   variable NSCLDAQ_RINGMASTER_NOTIFY=1) asks for the old CONNECT/DISCONNECT
+   messages.
 */
 class CRingBuffer
 {
@@ -68,6 +115,20 @@ public:
     manager
   } ClientMode;
 
+  typedef enum __MemoryOption {
+    hugePages  = 1,		// Transparent huge pages if the system allows.
+    prefault   = 2,		// Fault all pages in at create/attach.
+    lockMemory = 4		// mlock the ring in each client.
+  } MemoryOption;
+
+  struct ClientCounters {
+    uint64_t                               s_bytes;
+    uint64_t                               s_items;
+    uint64_t                               s_blockedUsec;
+    uint64_t                               s_blocks;
+    time_t                                 s_lastActivity;
+  };
+
   struct Usage {
     size_t                                 s_bufferSpace;
     size_t                                 s_putSpace;
@@ -76,6 +137,8 @@ public:
     size_t                                 s_maxGetSpace;
     size_t                                 s_minGetSpace;
     std::vector<std::pair<pid_t, size_t> > s_consumers;
+    ClientCounters                         s_producerCounters;
+    std::vector<ClientCounters>            s_consumerCounters; // Parallels s_consumers.
   };
 
   class CRingBufferPredicate {
@@ -88,6 +151,7 @@ private:
   static size_t m_defaultMaxConsumers; // Default for maximun consumers allowed.
   static CRingMaster* m_pMaster;	       // Connection to the ring master daemon.
   static pid_t        m_myPid;	       // Pid so forks will make new ringmaster conns.
+  static int          m_notifyMaster;  // Tell RingMaster about clients (-1 from env).
   // Member data
 private:
   RingBuffer*         m_pRing;	       // Pointer to the actual ring.
@@ -95,20 +159,35 @@ private:
   ClientMode          m_mode;	       // What sort of client this is.
   unsigned long       m_pollInterval;  // ms between blocking polls.
   std::string         m_ringName;      // Name of ring we're connected to.
+  CRingItemIndex*     m_pIndex;        // Item index if the ring has one.
+  time_t              m_indexAttempt;  // When a consumer last looked for it.
+  MultiProducerHeader* m_pMulti;       // Multi-producer control block or 0.
+  ProducerSlot*       m_pSlot;         // Our slot in it if we are a producer.
+  ClientStatistics*   m_pStats;        // Our counters (0 for old rings/managers).
+  bool                m_notified;      // RingMaster was told of our connection.
 
   // Static member functions,
 public:
   static void create(std::string name, 
 		     size_t dataBytes = m_defaultDataSize,
 		     size_t maxConsumer = m_defaultMaxConsumers,
-		     bool   tempMasterConnection = false);
+		     bool   tempMasterConnection = false,
+		     size_t maxProducer = 1,
+		     unsigned memoryOptions = 0,
+		     int    numaNode = -1);
   static CRingBuffer* createAndProduce(std::string name,
 				       size_t dataBytes = m_defaultDataSize,
 				       size_t maxConsumer = m_defaultMaxConsumers,
-				       bool   tempMasterConnection = false);
+				       bool   tempMasterConnection = false,
+				       size_t maxProducer = 1,
+				       unsigned memoryOptions = 0,
+				       int    numaNode = -1);
   static void remove(std::string name);
   static void format(std::string name,
-		     size_t maxConsumer = m_defaultMaxConsumers);
+		     size_t maxConsumer = m_defaultMaxConsumers,
+		     size_t maxProducer = 1,
+		     unsigned memoryOptions = 0,
+		     int    numaNode = -1);
   static bool isRing(std::string name);
   static void   setDefaultRingSize(size_t byteCount);
   static size_t getDefaultRingSize();
@@ -116,6 +195,8 @@ public:
   static size_t getDefaultMaxConsumers();
   static std::string defaultRing();
   static std::string defaultRingUrl();
+  static void   setRingMasterNotification(bool notify);
+  static bool   getRingMasterNotification();
 
   // Constructors and other canonicals.
 
@@ -132,10 +213,13 @@ private:
   // Manipulations on the ring buffer:
 public:
   virtual size_t put(const void* pBuffer, size_t nBytes, unsigned long timeout=ULONG_MAX);
+  size_t putv(const struct iovec* pieces, int nPieces, unsigned long timeout=ULONG_MAX);
   virtual size_t get(void* pBuffer, size_t maxBytes, size_t minBytes = 1, 
 	     unsigned long timeout=ULONG_MAX);
   virtual size_t peek(void* pBuffer, size_t maxbytes);
   virtual void   skip(size_t nBytes);
+  size_t skipUnwanted(CRingItemIndex::CTypeFilter& filter);
+  void   countItems(size_t nItems);
 
   unsigned long setPollInterval(unsigned long newValue);
   unsigned long getPollInterval();
@@ -148,6 +232,8 @@ public:
   Usage getUsage();
 
   off_t getSlot();
+  bool  isMultiProducer() const;
+  unsigned getMemoryOptions();
 
   // blocking.
 
@@ -162,6 +248,7 @@ public:
 
   void forceProducerRelease();
   void forceConsumerRelease(unsigned slot);
+  unsigned releaseDeadClients();
 
   // Utility funcionts:
 
@@ -171,10 +258,33 @@ private:
   void        allocateConsumer();
   size_t      difference(ClientInformation& producer, ClientInformation& consumer);
   void        Skip(size_t nBytes);
+  void        attachIndex();
+  void        attachProducerSlot();
+  void        applyMemoryOptions();
+  void        releaseClient();
+  bool        ownsProducer() const;
+  size_t      putMulti(const struct iovec* pieces, int nPieces, size_t nBytes,
+		       unsigned long timeout);
+  bool        reserve(size_t nBytes, uint64_t& position);
+  void        publish();
+  ProducerSlot* publishable();
+  void        copyIn(const struct iovec* pieces, int nPieces, off_t offset);
+  void        countTransfer(size_t nBytes, size_t nItems);
+  ClientStatistics* clientStatistics(unsigned index);
+  ClientCounters counters(unsigned index);
 
   static std::string shmName(std::string rawName);
   static RingBuffer* mapRingBuffer(std::string fullName);
   static bool        ringHeader(RingBuffer* p);
+  static MultiProducerHeader* multiProducerHeader(RingBuffer* p);
+  static RingOptions* ringOptions(RingBuffer* p);
+  static RingStatistics* ringStatistics(RingBuffer* p);
+  static void*       extensionBlock(RingBuffer* p, const char* magic);
+  static size_t      multiProducerSize(size_t maxProducer);
+  static size_t      optionsSize();
+  static size_t      statisticsSize(size_t maxConsumer);
+  static unsigned    shmTuneFlags(unsigned memoryOptions);
+  static bool        processDead(pid_t pid);
 
   std::string        modeString() const;
 
@@ -20,6 +20,7 @@
 #include <Exception.h>
 #include <ErrnoException.h>
 #include <errno.h>
+#include <stdio.h>
 
 #include "TCLInterpreter.h"
 #include "TCLObject.h"
@@ -108,6 +109,8 @@ CRingCommand::operator()(CTCLInterpreter&    interp,
     return remove(interp,objv);
   } else if (subCommand == string("list")) {
     return list(interp, objv);
+  } else if (subCommand == string("reap")) {
+    return reap(interp, objv);
   } else {
     string result;
     result += "Invalid subCommand keyword: ";
@@ -127,10 +130,13 @@ CRingCommand::operator()(CTCLInterpreter&    interp,
 
 /*************************************************************************/
 /* create a new ring buffer:                                             */
-/*  ringbuffer create  name ?size ?maxconsumers??                        */
+/*  ringbuffer create  name ?size ?maxconsumers ?maxproducers            */
+/*                           ?memoryoptions????                          */
 /*  name - the name of the ring buffer.                                  */
 /*  size - the optional size specification                               */
 /*  maxconsumers - the optional maximum consumer count.                  */
+/*  maxproducers - the optional maximum producer count (default 1).      */
+/*  memoryoptions - optional list of hugepages, prefault, lock, numa=n   */
 /*                                                                       */
 /* Result:                                                               */
 /*   An error message if an error occurs.                                */
@@ -143,7 +149,7 @@ CRingCommand::create(CTCLInterpreter& interp,
 {
   // Validate the command count:
 
-  if ((objv.size() < 3) || (objv.size() > 5)) {
+  if ((objv.size() < 3) || (objv.size() > 7)) {
     string result;
     result += "Incorrect number of parameters for ringbuffer create\n";
     result += CommandUsage();
@@ -155,6 +161,9 @@ CRingCommand::create(CTCLInterpreter& interp,
   string name      = objv[2];
   size_t size      = CRingBuffer::getDefaultRingSize();
   size_t consumers = CRingBuffer::getDefaultMaxConsumers();
+  size_t producers = 1;
+  unsigned memoryOptions = 0;
+  int    numaNode  = -1;
 
   // If present, update the size from the objv:
 
@@ -172,7 +181,7 @@ CRingCommand::create(CTCLInterpreter& interp,
   }
   // If present, update consumers from the objv:
 
-  if (objv.size() == 5) {
+  if (objv.size() >= 5) {
     try {
       consumers = (int)(objv[4]);
     }
@@ -185,10 +194,62 @@ CRingCommand::create(CTCLInterpreter& interp,
        
     }
   }
+  // If present, update producers from the objv:
+
+  if (objv.size() >= 6) {
+    try {
+      int n = (int)(objv[5]);
+      if (n < 1) throw n;
+      producers = n;
+    }
+    catch(...) {
+      string result;
+      result += "Optional max producer parameter must be a positive integer\n";
+      result += CommandUsage();
+      interp.setResult(result);
+      return TCL_ERROR;
+    }
+  }
+  // If present, decode the memory options:
+
+  if (objv.size() == 7) {
+    CTCLObject optionList = objv[6];
+    optionList.Bind(interp);
+    vector<CTCLObject> options = optionList.getListElements();
+    for (int i = 0; i < options.size(); i++) {
+      string option = options[i];
+      bool   valid  = true;
+      if (option == "hugepages") {
+	memoryOptions |= CRingBuffer::hugePages;
+      }
+      else if (option == "prefault") {
+	memoryOptions |= CRingBuffer::prefault;
+      }
+      else if (option == "lock") {
+	memoryOptions |= CRingBuffer::lockMemory;
+      }
+      else if (option.substr(0, 5) == "numa=") {
+	valid = (sscanf(option.c_str() + 5, "%d", &numaNode) == 1) && (numaNode >= 0);
+      }
+      else {
+	valid = false;
+      }
+      if (!valid) {
+	string result;
+	result += "Invalid memory option: ";
+	result += option;
+	result += '\n';
+	result += CommandUsage();
+	interp.setResult(result);
+	return TCL_ERROR;
+      }
+    }
+  }
   // Create the ring buffer:
 
   try {
-    CRingBuffer::create(name, size, consumers);
+    CRingBuffer::create(name, size, consumers, false, producers,
+			memoryOptions, numaNode);
   }
   catch (CException& reason) {
     string result;
@@ -465,15 +526,36 @@ CRingCommand::disconnect(CTCLInterpreter&    interp,
 /*   Largest amount of get data from the list of consumers                 */
 /*   Smallest amount of get data from the list of consumers                */
 /*                                                                         */
-/*  The final entry in the list is a list of the consumers attached to     */
+/*  The next entry in the list is a list of the consumers attached to      */
 /*  the ring.  This is a list of two element sublists where each sublist   */
 /*  provides the pid and unread data for one of the consumers              */
 /*                                                                         */
+/*  The final entry holds the cumulative client counters: the producer's   */
+/*  followed by one for each consumer in the same order as the consumer    */
+/*  list.  Each is {bytes items blocked-microseconds blocks last-activity} */
+/*                                                                         */
 /* If there's an error, the result is a descriptive error message instead  */
 /* of all this nice stuff.                                                 */
 /***************************************************************************/
 
 
+/*
+   Turn one client's counters into the Tcl list usage reports for it.
+   The counters can exceed an int so they are wide integers.
+*/
+static CTCLObject
+countersList(CTCLInterpreter& interp, const CRingBuffer::ClientCounters& counters)
+{
+  CTCLObject result;
+  result.Bind(interp);
+  result += Tcl_NewWideIntObj(Tcl_WideInt(counters.s_bytes));
+  result += Tcl_NewWideIntObj(Tcl_WideInt(counters.s_items));
+  result += Tcl_NewWideIntObj(Tcl_WideInt(counters.s_blockedUsec));
+  result += Tcl_NewWideIntObj(Tcl_WideInt(counters.s_blocks));
+  result += Tcl_NewWideIntObj(Tcl_WideInt(counters.s_lastActivity));
+  return result;
+}
+
 int
 CRingCommand::usage(CTCLInterpreter&    interp, 
 		    vector<CTCLObject>& objv)
@@ -523,6 +605,14 @@ CRingCommand::usage(CTCLInterpreter&    interp,
               consumerList += consumerEntry;
             }
             Result += consumerList;
+
+            CTCLObject counterList;
+            counterList.Bind(interp);
+            counterList += countersList(interp, usageInfo.s_producerCounters);
+            for (int i = 0; i < usageInfo.s_consumerCounters.size(); i++) {
+              counterList += countersList(interp, usageInfo.s_consumerCounters[i]);
+            }
+            Result += counterList;
           
             interp.setResult(Result);
     } else {
@@ -655,6 +745,56 @@ CRingCommand::list(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
   return TCL_OK;
     
 }
+/**
+ * reap
+ *   Free the client slots of a ring whose processes have exited without
+ *   detaching:
+ *     ringbuffer reap name
+ *
+ * @param interp - Reference to the interpreter object running the command.
+ * @param objv   -  Vector of Tcl_obj's that make up the command words.
+ * @return int
+ * @retval TCL_OK - Everthing worked.  The result is the number of slots freed.
+ * @retval TCL_ERROR - Failure of some sort.  The result is an error message.
+ */
+int
+CRingCommand::reap(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+  bindAll(interp, objv);
+  try {
+    requireExactly(objv, 3, "ringbuffer reap needs only a ring name");
+    std::string name = objv[2];
+
+    CRingBuffer ring(name, CRingBuffer::manager);
+    CTCLObject result;
+    result.Bind(interp);
+    result = static_cast<int>(ring.releaseDeadClients());
+    interp.setResult(result);
+  }
+  catch (CException& reason) {
+    string result;
+    result += "Failed to reap ring clients: ";
+    result += string(reason.ReasonText());
+    interp.setResult(result);
+    return TCL_ERROR;
+  }
+  catch (string msg) {
+    string result;
+    result += "Failed to reap ring clients: ";
+    result += msg;
+    result += '\n';
+    interp.setResult(result);
+    return TCL_ERROR;
+  }
+  catch (...) {
+    std::string result;
+    result += "Failed to reap ring clients: Unexpected exception type caught\n";
+    interp.setResult(result);
+    return TCL_ERROR;
+  }
+
+  return TCL_OK;
+}
 /**************************************************************************/
 /*  Remove a ring buffer.  The usual stuff. we need a ring name           */
 /*  ringbuffer remove name                                                */
@@ -739,17 +879,20 @@ CRingCommand::CommandUsage()
 {
   string usage;
   usage += "Usage:\n";
-  usage += "  ringbuffer create name ?size ?maxconsumers??\n";
+  usage += "  ringbuffer create name ?size ?maxconsumers ?maxproducers ?memoryoptions????\n";
   usage += "  ringbuffer format name ?maxconsumers?\n";
   usage += "  ringbuffer disconnect producer name\n";
   usage += "  ringbuffer disconnect consumer name index\n";
   usage += "  ringbuffer usage ?name?\n";
   usage += "  ringbuffer list\n";
   usage += "  ringbuffer remove name\n";
+  usage += "  ringbuffer reap name\n";
   usage += "Where\n";
   usage += "  name         - Is the name of a ring buffer\n";
   usage += "  size         - Is the number of data bytes a ring buffer can have\n";
   usage += "  maxconsumers - Is the maximum number of conumser clients that can connect\n";
+  usage += "  maxproducers - Is the maximum number of producers that can connect at once\n";
+  usage += "  memoryoptions - Is a list of any of hugepages prefault lock numa=node\n";
   usage += "  index        - Is the consumer index for a connected consumer\n";
   usage += "And anything bracketed with ?'s is an optional parameter.\n";
 
@@ -85,6 +85,8 @@ protected:
 	     std::vector<CTCLObject>& objv);
   int list(CTCLInterpreter& interp,
 	   std::vector<CTCLObject>& objv);
+  int reap(CTCLInterpreter& interp,
+	   std::vector<CTCLObject>& objv);
 
   // private utilities:
 private:
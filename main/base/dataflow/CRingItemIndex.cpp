@@ -0,0 +1,419 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <config.h>
+#include "CRingItemIndex.h"
+#include "ringbufint.h"
+
+#include <ErrnoException.h>
+#include <daqshm.h>
+
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+using namespace std;
+
+const uint32_t CRingItemIndex::DEFAULT_UNINDEXED_TYPE(30);
+const uint32_t CRingItemIndex::DEFAULT_INDEX_SIZE(DEFAULT_INDEX_ENTRIES);
+
+static const int MAX_LOCATE_TRIES(10); // Before giving up on a busy producer.
+
+/*
+ * Byte swap a longword - items can come from systems with the
+ * other byte order.
+ */
+static uint32_t
+swap32(uint32_t input)
+{
+  return ((input >> 24) & 0xff)       | ((input >> 8) & 0xff00) |
+         ((input << 8)  & 0xff0000)   | ((input << 24) & 0xff000000);
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Static members to manage the index segment.
+
+/*!
+   Create and initialize an index for a ring.  If one already exists it
+   is reinitialized.
+
+   \param ringName      - Name of the ring the index is for.
+   \param unindexedType - Type of the items that are not recorded.
+   \param nEntries      - Number of index entries.
+
+   \throw CErrnoException - if the shared memory can't be made.
+*/
+void
+CRingItemIndex::create(string ringName, uint32_t unindexedType, uint32_t nEntries)
+{
+  string name = indexName(ringName);
+  size_t size = sizeof(RingIndexHeader) + nEntries*sizeof(RingIndexEntry);
+
+  if (CDAQShm::size(name) < 0) {
+    if (CDAQShm::create(name, size,
+			CDAQShm::GroupRead | CDAQShm::GroupWrite |
+			CDAQShm::OtherRead | CDAQShm::OtherWrite)) {
+      throw CErrnoException("Ring item index creation failed");
+    }
+  }
+  size = CDAQShm::size(name);
+  pRingIndex pIndex = reinterpret_cast<pRingIndex>(CDAQShm::attach(name));
+  if (!pIndex) {
+    throw CErrnoException("Ring item index attach failed");
+  }
+  memset(pIndex, 0, sizeof(RingIndexHeader));
+  strcpy(pIndex->s_header.s_magicString, INDEX_MAGICSTRING);
+  pIndex->s_header.s_nEntries       =
+    (size - sizeof(RingIndexHeader))/sizeof(RingIndexEntry);
+  pIndex->s_header.s_unindexedType  = unindexedType;
+
+  CDAQShm::detach(pIndex, name, size);
+}
+/*!
+   Remove a ring's index.  It's not an error for there not to be one.
+
+   \param ringName - Name of the ring.
+*/
+void
+CRingItemIndex::remove(string ringName)
+{
+  string name = indexName(ringName);
+  if (CDAQShm::size(name) >= 0) {
+    CDAQShm::remove(name);
+  }
+}
+/*!
+   \param ringName - name of a ring.
+   \return bool - true if that ring has an index.
+*/
+bool
+CRingItemIndex::exists(string ringName)
+{
+  ssize_t size = CDAQShm::size(indexName(ringName));
+  return (size >= 0) && (size_t(size) >= sizeof(RingIndexHeader));
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Canonicals
+
+/*!
+   Attach to an existing index.
+
+   \param ringName  - Name of the ring.
+   \param ringBytes - Number of data bytes in the ring.
+
+   \throw CErrnoException - the index could not be mapped or is not an index.
+*/
+CRingItemIndex::CRingItemIndex(string ringName, size_t ringBytes) :
+  m_pIndex(0),
+  m_name(indexName(ringName)),
+  m_ringBytes(ringBytes),
+  m_produced(0),
+  m_itemStart(0),
+  m_remaining(0),
+  m_headerBytes(0)
+{
+  m_pIndex = reinterpret_cast<pRingIndex>(CDAQShm::attach(m_name));
+  if (!m_pIndex) {
+    throw CErrnoException("CRingItemIndex - attaching the index");
+  }
+  if (strcmp(m_pIndex->s_header.s_magicString, INDEX_MAGICSTRING) != 0) {
+    CDAQShm::detach(m_pIndex, m_name, CDAQShm::size(m_name));
+    errno = EINVAL;
+    throw CErrnoException("CRingItemIndex - not a ring item index");
+  }
+}
+/*!
+   Destructor - unmap the index.
+*/
+CRingItemIndex::~CRingItemIndex()
+{
+  CDAQShm::detach(m_pIndex, m_name, CDAQShm::size(m_name));
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Producer interface.
+
+/*!
+   Start a new epoch.  Called when a producer attaches.  Positions restart
+   at zero and all entries are dropped.  The stream is assumed to start on
+   an item boundary.
+
+   \param putOffset - The ring's put offset.
+*/
+void
+CRingItemIndex::reset(off_t putOffset)
+{
+  m_produced    = 0;
+  m_itemStart   = 0;
+  m_remaining   = 0;
+  m_headerBytes = 0;
+
+  beginUpdate();
+  m_pIndex->s_header.s_produced  = 0;
+  m_pIndex->s_header.s_putOffset = putOffset;
+  m_pIndex->s_header.s_boundary  = 0;
+  m_pIndex->s_header.s_recorded  = 0;
+  m_pIndex->s_header.s_valid     = 1;
+  endUpdate();
+}
+/*!
+   Account for data that were just put into the ring.  Item headers in
+   the data are parsed and entries are recorded for indexed types.
+
+   \param pieces    - Describes the data that were put in the ring.
+   \param nPieces   - Number of elements in pieces.
+   \param putOffset - The ring put offset after the put.
+
+   \return size_t - Number of items whose headers were completed by
+                    these data (0 once the index is invalid).
+*/
+size_t
+CRingItemIndex::record(const struct iovec* pieces, int nPieces, off_t putOffset)
+{
+  size_t nItems = 0;
+  beginUpdate();
+  for (int i = 0; i < nPieces; i++) {
+    nItems += parse(reinterpret_cast<const uint8_t*>(pieces[i].iov_base),
+		    pieces[i].iov_len);
+  }
+  // Everything before the item we're in the middle of is complete:
+
+  m_pIndex->s_header.s_produced  = m_produced;
+  m_pIndex->s_header.s_putOffset = putOffset;
+  m_pIndex->s_header.s_boundary  =
+    (m_remaining || m_headerBytes) ? m_itemStart : m_produced;
+  endUpdate();
+
+  return nItems;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Consumer interface.
+
+/*!
+   Find how far a consumer can skip ahead.
+
+   \param getOffset - The consumer's ring offset.
+   \param filter    - Says which types the consumer does not want.
+   \param nSkip     - Number of bytes to skip to get to the next item the
+                      consumer might want (possibly 0).  Only valid if
+                      true is returned.
+   \param behind    - Number of bytes the consumer was behind the put offset
+                      the index was consistent with.  The index lags the ring
+                      slightly so the caller must check this is no more than
+                      the data available to it <em>after</em> this call,
+                      otherwise the consumer had already read past that put
+                      offset and nSkip is meaningless.
+
+   \return bool - false if the index can't help; the consumer must look
+                  at the item headers itself.  This happens if:
+                  - The consumer wants the unindexed type.
+                  - The producer invalidated the index.
+                  - The consumer is looking at data from before the
+                    current producer attached.
+                  - Entries the consumer needs have been overwritten.
+                  - The producer was too busy to get a consistent view.
+*/
+bool
+CRingItemIndex::locate(off_t getOffset, CTypeFilter& filter, size_t& nSkip,
+		       size_t& behind)
+{
+  RingIndexHeader& h(m_pIndex->s_header);
+  if (!filter.skip(h.s_unindexedType)) {
+    return false;
+  }
+
+  for (int tries = 0; tries < MAX_LOCATE_TRIES; tries++) {
+    uint64_t sequence = h.s_sequence;
+    if (sequence & 1) {
+      sched_yield();		// Producer is updating.
+      continue;
+    }
+    __sync_synchronize();
+
+    bool     valid     = h.s_valid;
+    uint64_t produced  = h.s_produced;
+    off_t    putOffset = h.s_putOffset;
+    uint64_t target    = h.s_boundary;
+    uint64_t recorded  = h.s_recorded;
+    uint64_t nEntries  = h.s_nEntries;
+
+    behind             = distance(getOffset, putOffset);
+    bool     usable    = valid && (behind <= produced);
+    uint64_t position  = produced - behind;
+
+    // Walk back from the newest entry to the first one at or before
+    // our position, remembering the earliest wanted one:
+
+    if (usable) {
+      uint64_t oldest = (recorded > nEntries) ? recorded - nEntries : 0;
+      uint64_t i      = recorded;
+      bool     found  = false;
+      while (i > oldest) {
+	i--;
+	RingIndexEntry& e(m_pIndex->s_entries[i % nEntries]);
+	if (e.s_position < position) {
+	  found = true;
+	  break;
+	}
+	if (!filter.skip(e.s_type)) {
+	  target = e.s_position;
+	}
+      }
+      // If we ran out of entries without getting back to our position,
+      // some we need may have been overwritten:
+
+      if (!found && oldest) {
+	usable = false;
+      }
+      if (target < position) {
+	target = position;	// Partial item straddling our position.
+      }
+    }
+    __sync_synchronize();
+    if (h.s_sequence == sequence) {
+      if (usable) {
+	nSkip = target - position;
+      }
+      return usable;
+    }
+  }
+  return false;
+}
+/*!
+   \return uint64_t - Total number of entries recorded this epoch.
+*/
+uint64_t
+CRingItemIndex::recorded() const
+{
+  return m_pIndex->s_header.s_recorded;
+}
+
+/////////////////////////////////////////////////////////////////////////
+// Private utilities.
+
+/*
+ * Name of the shared memory segment for a ring's index.
+ */
+string
+CRingItemIndex::indexName(string ringName)
+{
+  return string("/") + ringName + INDEX_SUFFIX;
+}
+/*
+ * Run the producer's item state machine over some data.  Items and their
+ * headers can be split across calls.  Returns the number of item headers
+ * completed.
+ */
+size_t
+CRingItemIndex::parse(const uint8_t* p, size_t nBytes)
+{
+  const uint8_t* pStart = p;
+  const uint8_t* pEnd   = p + nBytes;
+  size_t         nItems = 0;
+
+  while (m_pIndex->s_header.s_valid && (p < pEnd)) {
+    if (m_remaining) {
+      size_t n = pEnd - p;
+      if (n > m_remaining) n = m_remaining;
+      m_remaining -= n;
+      p           += n;
+      continue;
+    }
+    // Accumulate a header.
+
+    if (m_headerBytes == 0) {
+      m_itemStart = m_produced + (p - pStart);
+    }
+    size_t n = sizeof(m_header) - m_headerBytes;
+    if (n > size_t(pEnd - p)) n = pEnd - p;
+    memcpy(m_header + m_headerBytes, p, n);
+    m_headerBytes += n;
+    p             += n;
+
+    if (m_headerBytes == sizeof(m_header)) {
+      uint32_t size, type;
+      memcpy(&size, m_header, sizeof(size));
+      memcpy(&type, m_header + sizeof(size), sizeof(type));
+      if ((type & 0xffff0000) != 0) {
+	size = swap32(size);
+	type = swap32(type);
+      }
+      if (size < sizeof(m_header)) {
+	invalidate();
+	break;
+      }
+      m_remaining   = size - sizeof(m_header);
+      m_headerBytes = 0;
+      nItems++;
+      if (type != m_pIndex->s_header.s_unindexedType) {
+	addEntry(type, size);
+      }
+    }
+  }
+  m_produced += nBytes;
+  return nItems;
+}
+/*
+ * Bracket updates to the shared index.
+ */
+void
+CRingItemIndex::beginUpdate()
+{
+  m_pIndex->s_header.s_sequence++;
+  __sync_synchronize();
+}
+void
+CRingItemIndex::endUpdate()
+{
+  __sync_synchronize();
+  m_pIndex->s_header.s_sequence++;
+}
+/*
+ * Record an item that starts at m_itemStart.
+ */
+void
+CRingItemIndex::addEntry(uint32_t type, uint32_t size)
+{
+  RingIndexHeader& h(m_pIndex->s_header);
+  RingIndexEntry&  e(m_pIndex->s_entries[h.s_recorded % h.s_nEntries]);
+  e.s_position = m_itemStart;
+  e.s_type     = type;
+  e.s_size     = size;
+  h.s_recorded++;
+}
+/*
+ * The data stream no longer makes sense to us; consumers must not
+ * rely on the index until a new producer resets it.
+ */
+void
+CRingItemIndex::invalidate()
+{
+  m_pIndex->s_header.s_valid = 0;
+  m_remaining   = 0;
+  m_headerBytes = 0;
+}
+/*
+ * Number of bytes from one ring offset forward to another.
+ */
+size_t
+CRingItemIndex::distance(off_t from, off_t to) const
+{
+  off_t d = to - from;
+  if (d < 0) d += m_ringBytes;
+  return d;
+}
@@ -0,0 +1,130 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#ifndef __CRINGITEMINDEX_H
+#define __CRINGITEMINDEX_H
+
+#ifndef __STL_STRING
+#include <string>
+#ifndef __STL_STRING
+#define __STL_STRING
+#endif
+#endif
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+#ifndef __CRT_UNISTD_H
+#include <unistd.h>
+#ifndef __CRT_UNISTD_H
+#define __CRT_UNISTD_H
+#endif
+#endif
+
+#ifndef __CRT_SYS_UIO_H
+#include <sys/uio.h>
+#ifndef __CRT_SYS_UIO_H
+#define __CRT_SYS_UIO_H
+#endif
+#endif
+
+typedef struct __RingIndex RingIndex;
+
+/*!
+   A ring item index is a small shared memory segment that lives alongside
+   a ring buffer.  The ring's producer records the absolute stream position
+   of every item whose type is not the 'unindexed' type (by default
+   PHYSICS_EVENT).  A consumer that does not want the unindexed type can
+   use the index to find the next item it does want and skip everything
+   in between without looking at it.
+
+   The producer side is fed the bytes exactly as they are put into the
+   ring; items may be split across puts in any way.  If the producer sees
+   an impossible item size it marks the index invalid and consumers fall
+   back to looking at item headers.
+
+   This class is used internally by CRingBuffer; client code normally
+   only sees it through CRingBuffer::skipUnwanted.
+*/
+class CRingItemIndex
+{
+public:
+  static const uint32_t DEFAULT_INDEX_SIZE;
+
+  // Consumers describe which item types they don't want with one of these:
+
+  class CTypeFilter {
+  public:
+    virtual ~CTypeFilter() {}
+    virtual bool skip(uint32_t type) = 0;
+  };
+
+private:
+  RingIndex*   m_pIndex;
+  std::string  m_name;		// Shared memory name.
+  size_t       m_ringBytes;	// Data bytes in the ring.
+
+  // Producer state machine:
+
+  uint64_t     m_produced;	// Absolute put position.
+  uint64_t     m_itemStart;	// Start of the item being received.
+  uint32_t     m_remaining;	// Bytes left in that item after the header.
+  size_t       m_headerBytes;	// Bytes of its header seen so far.
+  uint8_t      m_header[8];
+
+public:
+  CRingItemIndex(std::string ringName, size_t ringBytes);
+  virtual ~CRingItemIndex();
+
+private:
+  CRingItemIndex(const CRingItemIndex&);
+  CRingItemIndex& operator=(const CRingItemIndex&);
+
+public:
+  static const uint32_t DEFAULT_UNINDEXED_TYPE; // PHYSICS_EVENT
+
+  static void create(std::string ringName,
+		     uint32_t unindexedType = DEFAULT_UNINDEXED_TYPE,
+		     uint32_t nEntries = DEFAULT_INDEX_SIZE);
+  static void remove(std::string ringName);
+  static bool exists(std::string ringName);
+
+  // Producer interface:
+
+  void reset(off_t putOffset);
+  size_t record(const struct iovec* pieces, int nPieces, off_t putOffset);
+
+  // Consumer interface:
+
+  bool   locate(off_t getOffset, CTypeFilter& filter, size_t& nSkip,
+		size_t& behind);
+  uint64_t recorded() const;
+
+private:
+  static std::string indexName(std::string ringName);
+  void   beginUpdate();
+  void   endUpdate();
+  void   addEntry(uint32_t type, uint32_t size);
+  void   invalidate();
+  size_t parse(const uint8_t* p, size_t nBytes);
+  size_t distance(off_t from, off_t to) const;
+};
+
+#endif
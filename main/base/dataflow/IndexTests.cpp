@@ -0,0 +1,275 @@
+// Tests of the ring item index.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include <CRingBuffer.h>
+#include <CRingItemIndex.h>
+#include <ringbufint.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "testcommon.h"
+
+using namespace std;
+
+static const uint32_t PHYSICS(30);	// Unindexed by default.
+static const uint32_t SCALER(20);
+static const uint32_t TEXT(10);
+
+// Filter that skips all but a set of types:
+
+class WantOnly : public CRingItemIndex::CTypeFilter
+{
+  set<uint32_t> m_wanted;
+public:
+  WantOnly(uint32_t type) { m_wanted.insert(type); }
+  void add(uint32_t type) { m_wanted.insert(type); }
+  virtual bool skip(uint32_t type) { return m_wanted.count(type) == 0; }
+};
+
+// Make a fake ring item of the given type and total size:
+
+static vector<uint8_t>
+item(uint32_t type, uint32_t size)
+{
+  vector<uint8_t> result(size, 0xaa);
+  memcpy(&result[0], &size, sizeof(uint32_t));
+  memcpy(&result[4], &type, sizeof(uint32_t));
+  return result;
+}
+
+class IndexTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(IndexTests);
+  CPPUNIT_TEST(create);
+  CPPUNIT_TEST(recordWhole);
+  CPPUNIT_TEST(recordSplit);
+  CPPUNIT_TEST(locateNext);
+  CPPUNIT_TEST(locateNone);
+  CPPUNIT_TEST(wantPhysics);
+  CPPUNIT_TEST(overwritten);
+  CPPUNIT_TEST(oldEpoch);
+  CPPUNIT_TEST(invalid);
+  CPPUNIT_TEST(ringSkip);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  string           m_ring;
+  CRingItemIndex*  m_pIndex;
+  off_t            m_putOffset;
+  static const size_t RINGBYTES = 1024*1024;
+public:
+  void setUp() {
+    m_ring = uniqueRing("indextest");
+    CRingItemIndex::create(m_ring, PHYSICS, 16);
+    m_pIndex    = new CRingItemIndex(m_ring, RINGBYTES);
+    m_putOffset = 1000;
+    m_pIndex->reset(m_putOffset);
+  }
+  void tearDown() {
+    delete m_pIndex;
+    CRingItemIndex::remove(m_ring);
+  }
+protected:
+  void create();
+  void recordWhole();
+  void recordSplit();
+  void locateNext();
+  void locateNone();
+  void wantPhysics();
+  void overwritten();
+  void oldEpoch();
+  void invalid();
+  void ringSkip();
+private:
+  void put(const vector<uint8_t>& data) {
+    struct iovec piece = {const_cast<uint8_t*>(&data[0]), data.size()};
+    m_putOffset += data.size();
+    m_pIndex->record(&piece, 1, m_putOffset);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(IndexTests);
+
+// Creation makes something that exists and can be removed.
+
+void IndexTests::create()
+{
+  ASSERT(CRingItemIndex::exists(m_ring));
+  EQ(uint64_t(0), m_pIndex->recorded());
+
+  string other = uniqueRing("indextest2");
+  ASSERT(!CRingItemIndex::exists(other));
+  CRingItemIndex::create(other);
+  ASSERT(CRingItemIndex::exists(other));
+  CRingItemIndex::remove(other);
+  ASSERT(!CRingItemIndex::exists(other));
+}
+// Only non physics items are recorded.
+
+void IndexTests::recordWhole()
+{
+  put(item(PHYSICS, 100));
+  put(item(SCALER, 40));
+  put(item(PHYSICS, 100));
+  put(item(TEXT, 24));
+  EQ(uint64_t(2), m_pIndex->recorded());
+}
+// Items split across puts, including in their headers, are found.
+
+void IndexTests::recordSplit()
+{
+  vector<uint8_t> stream;
+  for (int i = 0; i < 10; i++) {
+    vector<uint8_t> p = item(PHYSICS, 50 + i);
+    vector<uint8_t> s = item(SCALER, 20);
+    stream.insert(stream.end(), p.begin(), p.end());
+    stream.insert(stream.end(), s.begin(), s.end());
+  }
+  // Put it in 3 byte chunks:
+
+  for (size_t i = 0; i < stream.size(); i += 3) {
+    size_t n = stream.size() - i;
+    if (n > 3) n = 3;
+    put(vector<uint8_t>(stream.begin() + i, stream.begin() + i + n));
+  }
+  EQ(uint64_t(10), m_pIndex->recorded());
+
+  // The consumer at the start is told to skip the first physics item:
+
+  WantOnly scalers(SCALER);
+  size_t nSkip, behind;
+  ASSERT(m_pIndex->locate(1000, scalers, nSkip, behind));
+  EQ(size_t(50), nSkip);
+  EQ(stream.size(), behind);
+}
+// A consumer sitting in front of physics data is sent to the next
+// wanted item; one sitting on a wanted item is not moved.
+
+void IndexTests::locateNext()
+{
+  put(item(PHYSICS, 100));
+  put(item(TEXT, 24));
+  put(item(PHYSICS, 100));
+  put(item(SCALER, 40));
+  put(item(PHYSICS, 100));
+
+  WantOnly scalers(SCALER);
+  size_t nSkip, behind;
+  ASSERT(m_pIndex->locate(1000, scalers, nSkip, behind));
+  EQ(size_t(224), nSkip);
+  EQ(size_t(364), behind);
+
+  ASSERT(m_pIndex->locate(1224, scalers, nSkip, behind));
+  EQ(size_t(0), nSkip);
+
+  WantOnly text(TEXT);
+  ASSERT(m_pIndex->locate(1000, text, nSkip, behind));
+  EQ(size_t(100), nSkip);
+}
+// With nothing wanted all complete items are skipped but a partial item
+// is not.
+
+void IndexTests::locateNone()
+{
+  put(item(PHYSICS, 100));
+  put(item(PHYSICS, 100));
+  vector<uint8_t> partial = item(PHYSICS, 100);
+  partial.resize(50);
+  put(partial);
+
+  WantOnly scalers(SCALER);
+  size_t nSkip, behind;
+  ASSERT(m_pIndex->locate(1000, scalers, nSkip, behind));
+  EQ(size_t(200), nSkip);
+  EQ(size_t(250), behind);
+}
+// If the consumer wants physics items the index is no help.
+
+void IndexTests::wantPhysics()
+{
+  put(item(PHYSICS, 100));
+  put(item(SCALER, 40));
+
+  WantOnly physics(PHYSICS);
+  size_t nSkip, behind;
+  ASSERT(!m_pIndex->locate(1000, physics, nSkip, behind));
+}
+// If entries the consumer needs have been overwritten, the index can't
+// be used.  Consumers past the overwritten entries can still use it.
+
+void IndexTests::overwritten()
+{
+  for (int i = 0; i < 20; i++) {
+    put(item(TEXT, 10));
+  }
+  put(item(PHYSICS, 100));
+  put(item(SCALER, 40));
+
+  WantOnly scalers(SCALER);
+  size_t nSkip, behind;
+  ASSERT(!m_pIndex->locate(1000, scalers, nSkip, behind));
+  ASSERT(m_pIndex->locate(1000 + 10*10, scalers, nSkip, behind));
+  EQ(size_t(10*10 + 100), nSkip);
+}
+// Data from before the producer attached can't be handled.
+
+void IndexTests::oldEpoch()
+{
+  put(item(PHYSICS, 100));
+  WantOnly scalers(SCALER);
+  size_t nSkip, behind;
+  ASSERT(!m_pIndex->locate(500, scalers, nSkip, behind));
+  ASSERT(m_pIndex->locate(1000, scalers, nSkip, behind));
+}
+// Garbage sizes invalidate the index until the next reset.
+
+void IndexTests::invalid()
+{
+  vector<uint8_t> bad = item(PHYSICS, 8);
+  bad[0] = 4;			// Smaller than a header.
+  put(bad);
+  WantOnly scalers(SCALER);
+  size_t nSkip, behind;
+  ASSERT(!m_pIndex->locate(1000, scalers, nSkip, behind));
+
+  m_pIndex->reset(m_putOffset);
+  put(item(PHYSICS, 100));
+  ASSERT(m_pIndex->locate(1008, scalers, nSkip, behind));
+  EQ(size_t(100), nSkip);
+}
+// End to end through a real ring - the producer maintains the index and
+// the consumer skips to the wanted item.
+
+void IndexTests::ringSkip()
+{
+  string ringName = uniqueRing("indexring");
+  CRingBuffer::create(ringName);
+  {
+    CRingBuffer producer(ringName, CRingBuffer::producer);
+    CRingBuffer consumer(ringName, CRingBuffer::consumer);
+
+    for (int i = 0; i < 100; i++) {
+      vector<uint8_t> p = item(PHYSICS, 1000);
+      producer.put(&p[0], p.size());
+    }
+    vector<uint8_t> s = item(SCALER, 40);
+    vector<uint8_t> p = item(PHYSICS, 1000);
+    struct iovec pieces[2] = {{&s[0], s.size()}, {&p[0], p.size()}};
+    producer.putv(pieces, 2);
+
+    WantOnly scalers(SCALER);
+    EQ(size_t(100*1000), consumer.skipUnwanted(scalers));
+    EQ(size_t(1040), consumer.availableData());
+
+    uint32_t header[2];
+    consumer.peek(header, sizeof(header));
+    EQ(SCALER, header[1]);
+  }
+  CRingBuffer::remove(ringName);
+}
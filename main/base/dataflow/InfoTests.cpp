@@ -15,6 +15,8 @@
 
 #include <string>
 #include <iostream>
+#include <string.h>
+#include <time.h>
 
 using namespace std;
 
@@ -25,6 +27,9 @@ class InfoTests : public CppUnit::TestFixture {
   CPPUNIT_TEST(usageempty);
   CPPUNIT_TEST(usage1consumer);
   CPPUNIT_TEST(usageconsumers);
+  CPPUNIT_TEST(counters);
+  CPPUNIT_TEST(blockCounters);
+  CPPUNIT_TEST(splitItems);
   CPPUNIT_TEST_SUITE_END();
 
 
@@ -47,6 +52,9 @@ protected:
   void usageempty();
   void usage1consumer();
   void usageconsumers();
+  void counters();
+  void blockCounters();
+  void splitItems();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(InfoTests);
@@ -171,3 +179,87 @@ void InfoTests::usageconsumers()
   EQ(sizeof(msg) - sizeof(msg)/4, use.s_maxGetSpace);
   EQ((size_t)0,                   use.s_minGetSpace);
 }
+// Transfers are counted for the producer and each consumer.  Counters
+// start over when a client takes over a slot.
+
+void InfoTests::counters()
+{
+  char msg[100];
+  memset(msg, 0, sizeof(msg));
+  uint32_t header[2] = {sizeof(msg)/2, 1}; // Each message is two items.
+  memcpy(msg, header, sizeof(header));
+  memcpy(msg + sizeof(msg)/2, header, sizeof(header));
+  time_t start = time(NULL);
+  {
+    CRingBuffer prod(SHM_TESTFILE, CRingBuffer::producer);
+    CRingBuffer cons1(SHM_TESTFILE);
+    CRingBuffer cons2(SHM_TESTFILE);
+
+    prod.put(msg, sizeof(msg));
+    prod.put(msg, sizeof(msg));
+    EQ(sizeof(msg), cons1.get(msg, sizeof(msg), sizeof(msg)));
+    cons1.countItems(2);
+    cons2.skip(50);
+
+    CRingBuffer::Usage use = prod.getUsage();
+    EQ(uint64_t(2*sizeof(msg)), use.s_producerCounters.s_bytes);
+    EQ(uint64_t(4), use.s_producerCounters.s_items);
+    ASSERT(use.s_producerCounters.s_lastActivity >= start);
+
+    EQ(size_t(2), use.s_consumerCounters.size());
+    EQ(uint64_t(sizeof(msg)), use.s_consumerCounters[0].s_bytes);
+    EQ(uint64_t(2), use.s_consumerCounters[0].s_items);
+    EQ(uint64_t(50), use.s_consumerCounters[1].s_bytes);
+    EQ(uint64_t(0), use.s_consumerCounters[1].s_items);
+    EQ(uint64_t(0), use.s_consumerCounters[0].s_blocks);
+  }
+  CRingBuffer prod(SHM_TESTFILE, CRingBuffer::producer);
+  CRingBuffer cons(SHM_TESTFILE);
+  CRingBuffer::Usage use = prod.getUsage();
+  EQ(uint64_t(0), use.s_producerCounters.s_bytes);
+  EQ(uint64_t(0), use.s_consumerCounters[0].s_bytes);
+}
+// Waits that actually block are counted and timed, ones that don't aren't.
+
+void InfoTests::blockCounters()
+{
+  CRingBuffer prod(SHM_TESTFILE, CRingBuffer::producer);
+  CRingBuffer cons(SHM_TESTFILE);
+  cons.setPollInterval(1);
+  char msg[100];
+
+  EQ(size_t(0), cons.get(msg, sizeof(msg), sizeof(msg), 0));  // No wait.
+  EQ(uint64_t(0), cons.getUsage().s_consumerCounters[0].s_blocks);
+
+  EQ(size_t(0), cons.get(msg, sizeof(msg), sizeof(msg), 1));  // Times out.
+  CRingBuffer::ClientCounters c = cons.getUsage().s_consumerCounters[0];
+  EQ(uint64_t(1), c.s_blocks);
+  ASSERT(c.s_blockedUsec > 0);
+  EQ(uint64_t(0), c.s_items);
+
+  memset(msg, 0, sizeof(msg));
+  prod.put(msg, sizeof(msg));
+  EQ(sizeof(msg), cons.get(msg, sizeof(msg), sizeof(msg), 1));   // Data's there.
+  EQ(uint64_t(1), cons.getUsage().s_consumerCounters[0].s_blocks);
+}
+// The producer counts items, not puts, even when it splits them.
+
+void InfoTests::splitItems()
+{
+  CRingBuffer prod(SHM_TESTFILE, CRingBuffer::producer);
+  uint8_t item[20];
+  memset(item, 0, sizeof(item));
+  uint32_t header[2] = {sizeof(item), 1};
+  memcpy(item, header, sizeof(header));
+
+  prod.put(item, 3);		// Partial header.
+  EQ(uint64_t(0), prod.getUsage().s_producerCounters.s_items);
+  prod.put(item + 3, sizeof(item) - 3);
+  EQ(uint64_t(1), prod.getUsage().s_producerCounters.s_items);
+
+  struct iovec pieces[3] = {
+    {item, sizeof(item)}, {item, 5}, {item + 5, sizeof(item) - 5}
+  };
+  prod.putv(pieces, 3);
+  EQ(uint64_t(3), prod.getUsage().s_producerCounters.s_items);
+}
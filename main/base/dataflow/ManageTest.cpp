@@ -9,7 +9,9 @@
 
 #include <sys/types.h>
 #include <sys/mman.h>
+#include <sys/wait.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 
 
@@ -25,6 +27,11 @@ class ManageTests : public CppUnit::TestFixture {
   CPPUNIT_TEST(attach);
   CPPUNIT_TEST(forceproducer);
   CPPUNIT_TEST(forceconsumer);
+  CPPUNIT_TEST(reap);
+  CPPUNIT_TEST(reapLive);
+  CPPUNIT_TEST(deadProducer);
+  CPPUNIT_TEST(deadConsumer);
+  CPPUNIT_TEST(notification);
   CPPUNIT_TEST_SUITE_END();
 
 
@@ -45,6 +52,24 @@ protected:
   void attach();
   void forceproducer();
   void forceconsumer();
+  void reap();
+  void reapLive();
+  void deadProducer();
+  void deadConsumer();
+  void notification();
+
+  // Attach in a child process that exits without detaching.
+
+  void dieAttached(std::string ring, bool producer, bool consumer) {
+    pid_t child = fork();
+    if (child == 0) {
+      if (producer) new CRingBuffer(ring, CRingBuffer::producer);
+      if (consumer) new CRingBuffer(ring, CRingBuffer::consumer);
+      _exit(0);
+    }
+    int status;
+    waitpid(child, &status, 0);
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ManageTests);
@@ -114,3 +139,71 @@ void ManageTests::forceconsumer()
   CRingBuffer c2(string(SHM_TESTFILE), CRingBuffer::consumer);
   EQ((off_t)0, c2.getSlot());
 }
+// Slots held by processes that exited are freed by releaseDeadClients.
+
+void ManageTests::reap()
+{
+  dieAttached(SHM_TESTFILE, true, true);
+
+  CRingBuffer mgr(string(SHM_TESTFILE), CRingBuffer::manager);
+  CRingBuffer::Usage before = mgr.getUsage();
+  ASSERT(before.s_producer != -1);
+  EQ((size_t)1, before.s_consumers.size());
+
+  EQ(2U, mgr.releaseDeadClients());
+
+  CRingBuffer::Usage after = mgr.getUsage();
+  EQ((pid_t)-1, after.s_producer);
+  EQ((size_t)0, after.s_consumers.size());
+}
+// Live clients are left alone.
+
+void ManageTests::reapLive()
+{
+  CRingBuffer p(string(SHM_TESTFILE), CRingBuffer::producer);
+  CRingBuffer c(string(SHM_TESTFILE), CRingBuffer::consumer);
+  CRingBuffer mgr(string(SHM_TESTFILE), CRingBuffer::manager);
+
+  EQ(0U, mgr.releaseDeadClients());
+  EQ(getpid(), mgr.getUsage().s_producer);
+}
+// A producer that died does not keep a new one from attaching.
+
+void ManageTests::deadProducer()
+{
+  dieAttached(SHM_TESTFILE, true, false);
+
+  CRingBuffer p(string(SHM_TESTFILE), CRingBuffer::producer);
+  CRingBuffer mgr(string(SHM_TESTFILE), CRingBuffer::manager);
+  EQ(getpid(), mgr.getUsage().s_producer);
+}
+// When all consumer slots are taken, those of dead consumers are reused.
+
+void ManageTests::deadConsumer()
+{
+  std::string name = uniqueRing("mgrtest1");
+  CRingBuffer::create(name, CRingBuffer::getDefaultRingSize(), 1);
+  dieAttached(name, false, true);
+
+  bool caught = false;
+  try {
+    CRingBuffer c(name, CRingBuffer::consumer);
+    EQ((off_t)0, c.getSlot());
+  }
+  catch (...) {
+    caught = true;
+  }
+  CRingBuffer::remove(name);
+  ASSERT(!caught);
+}
+// Clients don't talk to the ring master unless asked to.
+
+void ManageTests::notification()
+{
+  bool initial = CRingBuffer::getRingMasterNotification();
+  CRingBuffer::setRingMasterNotification(true);
+  EQ(true, CRingBuffer::getRingMasterNotification());
+  CRingBuffer::setRingMasterNotification(false);
+  EQ(false, CRingBuffer::getRingMasterNotification());
+  CRingBuffer::setRingMasterNotification(initial);
+}
@@ -0,0 +1,372 @@
+// Tests of multi-producer rings.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include <CRingBuffer.h>
+#include <ErrnoException.h>
+#include <ringbufint.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "testcommon.h"
+
+using namespace std;
+
+static const size_t   RING_SIZE(64*1024);	// Small so we wrap a lot.
+static const unsigned PRODUCERS(4);
+static const unsigned CONSUMERS(3);
+static const uint32_t ITEMS(20000);		// Per producer.
+
+// Each message is a header followed by a pattern that depends on the
+// producer and sequence number so torn/interleaved data is detectable:
+
+struct Message {
+  uint32_t s_size;
+  uint32_t s_producer;
+  uint32_t s_sequence;
+};
+
+static uint8_t
+pattern(uint32_t producer, uint32_t sequence, size_t i)
+{
+  return (producer*31 + sequence + i) & 0xff;
+}
+
+static size_t
+messageSize(uint32_t producer, uint32_t sequence)
+{
+  return sizeof(Message) + ((producer*7 + sequence) % 200);
+}
+
+// Thread bodies:
+
+struct ProducerArgs {
+  CRingBuffer* s_pRing;
+  uint32_t     s_id;
+};
+
+static void*
+producerThread(void* pArg)
+{
+  ProducerArgs* pArgs = reinterpret_cast<ProducerArgs*>(pArg);
+  vector<uint8_t> buffer(sizeof(Message) + 200);
+  for (uint32_t seq = 0; seq < ITEMS; seq++) {
+    size_t   size = messageSize(pArgs->s_id, seq);
+    Message  header = {uint32_t(size), pArgs->s_id, seq};
+    memcpy(&buffer[0], &header, sizeof(header));
+    for (size_t i = sizeof(header); i < size; i++) {
+      buffer[i] = pattern(pArgs->s_id, seq, i);
+    }
+    if (seq & 1) {
+      pArgs->s_pRing->put(&buffer[0], size);
+    } else {
+      struct iovec pieces[2] = {
+        {&buffer[0], sizeof(header)},
+        {&buffer[sizeof(header)], size - sizeof(header)}
+      };
+      pArgs->s_pRing->putv(pieces, 2);
+    }
+  }
+  return 0;
+}
+
+struct ConsumerArgs {
+  CRingBuffer*     s_pRing;
+  vector<uint32_t> s_next;		// Next expected sequence per producer.
+  string           s_error;
+};
+
+static void*
+consumerThread(void* pArg)
+{
+  ConsumerArgs* pArgs = reinterpret_cast<ConsumerArgs*>(pArg);
+  vector<uint8_t> buffer(sizeof(Message) + 200);
+  for (size_t n = 0; n < PRODUCERS*ITEMS; n++) {
+    Message header;
+    if (pArgs->s_pRing->get(&header, sizeof(header), sizeof(header), 10) != sizeof(header)) {
+      pArgs->s_error = "timed out waiting for a message";
+      return 0;
+    }
+    if ((header.s_producer >= PRODUCERS) ||
+        (header.s_size != messageSize(header.s_producer, header.s_sequence))) {
+      pArgs->s_error = "corrupt message header";
+      return 0;
+    }
+    if (header.s_sequence != pArgs->s_next[header.s_producer]) {
+      pArgs->s_error = "messages from a producer out of order";
+      return 0;
+    }
+    pArgs->s_next[header.s_producer]++;
+
+    size_t body = header.s_size - sizeof(header);
+    if (body) {
+      if (pArgs->s_pRing->get(&buffer[0], body, body, 10) != body) {
+        pArgs->s_error = "timed out waiting for a message body";
+        return 0;
+      }
+    }
+    for (size_t i = 0; i < body; i++) {
+      if (buffer[i] != pattern(header.s_producer, header.s_sequence, i + sizeof(header))) {
+        pArgs->s_error = "corrupt message body";
+        return 0;
+      }
+    }
+  }
+  return 0;
+}
+
+class MultiProducerTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(MultiProducerTests);
+  CPPUNIT_TEST(single);
+  CPPUNIT_TEST(attach);
+  CPPUNIT_TEST(layout);
+  CPPUNIT_TEST(putget);
+  CPPUNIT_TEST(noSpace);
+  CPPUNIT_TEST(ordered);
+  CPPUNIT_TEST(stress);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  string m_ring;
+
+public:
+  void setUp() {
+    m_ring = uniqueRing("mptest");
+    CRingBuffer::create(m_ring, RING_SIZE, 100, false, PRODUCERS);
+  }
+  void tearDown() {
+    try {
+      CRingBuffer::remove(m_ring);
+    }
+    catch (...) {}
+  }
+protected:
+  void single();
+  void attach();
+  void layout();
+  void putget();
+  void noSpace();
+  void ordered();
+  void stress();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(MultiProducerTests);
+
+// Rings made the old way are still single producer rings.
+
+void MultiProducerTests::single()
+{
+  string name = uniqueRing("sptest");
+  CRingBuffer::create(name);
+  {
+    CRingBuffer ring(name, CRingBuffer::producer);
+    EQ(false, ring.isMultiProducer());
+    bool threw = false;
+    try {
+      CRingBuffer second(name, CRingBuffer::producer);
+    }
+    catch (CErrnoException& e) {
+      threw = true;
+      EQ(EACCES, e.ReasonCode());
+    }
+    ASSERT(threw);
+  }
+  CRingBuffer::remove(name);
+}
+
+// Up to maxProducer producers can attach; slots are reused when they leave.
+
+void MultiProducerTests::attach()
+{
+  vector<CRingBuffer*> producers;
+  for (unsigned i = 0; i < PRODUCERS; i++) {
+    producers.push_back(new CRingBuffer(m_ring, CRingBuffer::producer));
+    EQ(true, producers.back()->isMultiProducer());
+  }
+  bool threw = false;
+  try {
+    CRingBuffer extra(m_ring, CRingBuffer::producer);
+  }
+  catch (CErrnoException& e) {
+    threw = true;
+    EQ(EACCES, e.ReasonCode());
+  }
+  ASSERT(threw);
+
+  delete producers[1];
+  producers[1] = new CRingBuffer(m_ring, CRingBuffer::producer);
+
+  CRingBuffer consumer(m_ring);
+  EQ(true, consumer.isMultiProducer());
+  EQ(getpid(), consumer.getUsage().s_producer);
+
+  for (unsigned i = 0; i < producers.size(); i++) {
+    delete producers[i];
+  }
+  EQ(pid_t(-1), consumer.getUsage().s_producer);
+}
+
+// The control block sits between the consumers and the data.
+
+void MultiProducerTests::layout()
+{
+  pRingBuffer p = reinterpret_cast<pRingBuffer>(mapRingBuffer(m_ring.c_str()));
+  size_t consumerEnd = sizeof(RingHeader) + sizeof(ClientInformation)*101;
+  pMultiProducerHeader pMulti =
+    reinterpret_cast<pMultiProducerHeader>(reinterpret_cast<char*>(p) + consumerEnd);
+
+  EQ(string(MP_MAGICSTRING), string(pMulti->s_magicString));
+  EQ(uint32_t(PRODUCERS), pMulti->s_maxProducer);
+  ASSERT(p->s_header.s_dataOffset >= off_t(consumerEnd + sizeof(MultiProducerHeader)));
+  EQ(off_t(0), p->s_header.s_dataOffset % 8);
+  ASSERT(p->s_header.s_dataBytes >= RING_SIZE);
+  EQ(p->s_header.s_dataOffset, p->s_producer.s_offset);
+
+  munmap(p, p->s_header.s_topOffset+1);
+}
+
+// Interleaved puts from two producers come out in put order and the
+// put offset consumers see tracks what's been published.
+
+void MultiProducerTests::putget()
+{
+  CRingBuffer consumer(m_ring);
+  CRingBuffer p1(m_ring, CRingBuffer::producer);
+  CRingBuffer p2(m_ring, CRingBuffer::producer);
+
+  char data[1000];
+  for (int i = 0; i < sizeof(data); i++) data[i] = i;
+
+  // Enough to wrap the ring several times:
+
+  size_t total = 0;
+  for (int i = 0; i < 300; i++) {
+    CRingBuffer& p(i & 1 ? p2 : p1);
+    data[0] = i;
+    EQ(sizeof(data), p.put(data, sizeof(data)));
+    total += sizeof(data);
+    EQ(sizeof(data), consumer.availableData());
+
+    char got[1000];
+    EQ(sizeof(got), consumer.get(got, sizeof(got), sizeof(got), 0));
+    EQ(char(i), got[0]);
+    EQ(0, memcmp(data + 1, got + 1, sizeof(data) - 1));
+  }
+  ASSERT(total > 4*RING_SIZE);
+}
+
+// Space a consumer hasn't read can't be reserved and a put that can't
+// get space times out.
+
+void MultiProducerTests::noSpace()
+{
+  CRingBuffer consumer(m_ring);
+  CRingBuffer p1(m_ring, CRingBuffer::producer);
+  CRingBuffer p2(m_ring, CRingBuffer::producer);
+
+  size_t available = p1.availablePutSpace();
+  vector<char> data(available - 100);
+  EQ(data.size(), p1.put(&data[0], data.size()));
+  EQ(size_t(100), p2.availablePutSpace());
+  EQ(size_t(0), p2.put(&data[0], 200, 0));
+  EQ(size_t(100), p2.put(&data[0], 100, 0));
+
+  consumer.skip(1000);
+  EQ(size_t(200), p2.put(&data[0], 200, 0));
+  EQ(size_t(800), p1.availablePutSpace());
+}
+
+// N producers and M consumers hammering a small ring: every consumer
+// sees every message intact, with each producer's messages in order.
+
+void MultiProducerTests::stress()
+{
+  vector<ConsumerArgs>  consumers(CONSUMERS);
+  vector<ProducerArgs>  producers(PRODUCERS);
+  vector<pthread_t>     threads;
+
+  for (unsigned i = 0; i < CONSUMERS; i++) {
+    consumers[i].s_pRing = new CRingBuffer(m_ring);
+    consumers[i].s_next.assign(PRODUCERS, 0);
+  }
+  for (unsigned i = 0; i < PRODUCERS; i++) {
+    producers[i].s_pRing = new CRingBuffer(m_ring, CRingBuffer::producer);
+    producers[i].s_id    = i;
+  }
+  for (unsigned i = 0; i < CONSUMERS; i++) {
+    pthread_t tid;
+    EQ(0, pthread_create(&tid, 0, consumerThread, &consumers[i]));
+    threads.push_back(tid);
+  }
+  for (unsigned i = 0; i < PRODUCERS; i++) {
+    pthread_t tid;
+    EQ(0, pthread_create(&tid, 0, producerThread, &producers[i]));
+    threads.push_back(tid);
+  }
+  for (unsigned i = 0; i < threads.size(); i++) {
+    pthread_join(threads[i], 0);
+  }
+
+  for (unsigned i = 0; i < CONSUMERS; i++) {
+    EQ(string(""), consumers[i].s_error);
+    for (unsigned p = 0; p < PRODUCERS; p++) {
+      EQ(ITEMS, consumers[i].s_next[p]);
+    }
+    EQ(size_t(0), consumers[i].s_pRing->availableData());
+    delete consumers[i].s_pRing;
+  }
+  EQ(uint64_t(PRODUCERS*ITEMS),
+     producers[0].s_pRing->getUsage().s_producerCounters.s_items);
+  for (unsigned i = 0; i < PRODUCERS; i++) {
+    delete producers[i].s_pRing;
+  }
+}
+
+// Data isn't visible until every earlier reservation is committed.  The
+// earlier reservation is faked by hand in a free slot.
+
+void MultiProducerTests::ordered()
+{
+  CRingBuffer consumer(m_ring);
+  CRingBuffer p1(m_ring, CRingBuffer::producer);
+
+  pRingBuffer p = reinterpret_cast<pRingBuffer>(mapRingBuffer(m_ring.c_str()));
+  size_t consumerEnd = sizeof(RingHeader) + sizeof(ClientInformation)*101;
+  pMultiProducerHeader pMulti =
+    reinterpret_cast<pMultiProducerHeader>(reinterpret_cast<char*>(p) + consumerEnd);
+  pProducerSlot pSlow = &(pMulti->s_producers[PRODUCERS-1]);
+
+  pSlow->s_committed  = 0;
+  pSlow->s_end        = 100;
+  pSlow->s_start      = 0;
+  pMulti->s_reserved  = 100;
+
+  char data[50];
+  memset(data, 1, sizeof(data));
+  EQ(sizeof(data), p1.put(data, sizeof(data)));
+  EQ(size_t(0), consumer.availableData());
+  EQ(uint64_t(150), uint64_t(pMulti->s_reserved));
+  EQ(uint64_t(0), uint64_t(pMulti->s_published));
+
+  // p1 can't put again until its first put is published:
+
+  EQ(size_t(0), p1.put(data, sizeof(data), 0));
+
+  // Committing the slow reservation publishes both:
+
+  pSlow->s_committed = 1;
+  CRingBuffer p2(m_ring, CRingBuffer::producer);
+  EQ(sizeof(data), p2.put(data, sizeof(data)));
+  EQ(size_t(200), consumer.availableData());
+  EQ(uint64_t(200), uint64_t(pMulti->s_published));
+  EQ(NO_RESERVATION, uint64_t(pSlow->s_start));
+
+  munmap(p, p->s_header.s_topOffset+1);
+}
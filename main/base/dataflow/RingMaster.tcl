@@ -65,6 +65,12 @@ exec tclsh ${0} ${@}
 #  If a socket close is detected, the server releases all un-disconnected ring buffer pointers
 #  still owned by the client.
 #
+#  Ring clients normally don't CONNECT/DISCONNECT at all (that's only done if
+#  NSCLDAQ_RINGMASTER_NOTIFY is set in their environment). Instead every
+#  reapInterval ms the server frees the slots of all known rings whose
+#  client processes have exited.  LIST and killClients read the client pids
+#  from the rings themselves, so they don't depend on CONNECT either.
+#
 #-------------------------------------------------------------------------------
 
 
@@ -111,6 +117,7 @@ set shmDirectory [file join / dev shm]
 
 set localhost   [list "127.0.0.1" "::1"];		# IP address of localhost connections.
 set knownRings  [list];			# Registered rings.
+set reapInterval 1000;			# ms between dead client sweeps.
 
 
 #----------------------------------------------------------------------
@@ -393,6 +400,23 @@ proc removeUsageEntry {socket name type pid}  {
   }
 }
 
+#---------------------------------------------------------------------------------
+#
+#  Free the ring slots held by clients that exited without detaching, then
+#  reschedule.
+#
+proc reapDeadClients {} {
+    foreach ring $::knownRings {
+	if {[catch {ringbuffer reap $ring} count] == 0} {
+	    if {$count > 0} {
+		emitLogMsg info "Released $count slots of exited clients from ring(=$ring)"
+	    }
+	} else {
+	    emitLogMsg debug "Unable to reap clients of ring(=$ring): $count"
+	}
+    }
+    after $::reapInterval reapDeadClients
+}
 #---------------------------------------------------------------------------------
 #
 #  The socket must be closed.  If the client on the socket owns any resources,
@@ -734,6 +758,7 @@ emitLogMsg debug "PortManager allocated a listen port: $listenPort"
 #  Disable the ones I don't want:
 
 enumerateRings
+reapDeadClients
 
 
 socket -server onConnection $listenPort
@@ -39,6 +39,7 @@ class StaticRingTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(defaults);
   CPPUNIT_TEST(create);
   CPPUNIT_TEST(format);
+  CPPUNIT_TEST(memoryOptions);
   CPPUNIT_TEST(remove);
   CPPUNIT_TEST(isring);
   CPPUNIT_TEST(ringname);
@@ -75,6 +76,7 @@ protected:
   void defaults();
   void create();
   void format();
+  void memoryOptions();
   void remove();
   void isring();
   void ringname();
@@ -124,7 +126,8 @@ void StaticRingTest::create() {
 
   size_t data = CRingBuffer::getDefaultRingSize();
   size_t ncons= CRingBuffer::getDefaultMaxConsumers() + 1; // (+1 for the producer).
-  off_t  total= data + ncons*sizeof(ClientInformation) + sizeof(RingHeader);
+  size_t stats= (sizeof(RingStatistics) + (ncons-1)*sizeof(ClientStatistics) + 7) & ~size_t(7);
+  off_t  total= data + ncons*sizeof(ClientInformation) + sizeof(RingHeader) + stats;
 
   // Align to pagesize:
 
@@ -170,8 +173,14 @@ void StaticRingTest::format()
   EQ(CRingBuffer::getDefaultMaxConsumers(), max);
   EQ(sizeof(RingHeader), (size_t)pHeader->s_producerInfo);
   EQ(sizeof(RingHeader)+sizeof(ClientInformation), (size_t)pHeader->s_firstConsumer);
-  EQ(sizeof(RingHeader) + (pHeader->s_maxConsumer+1)*sizeof(ClientInformation),
-     (size_t)pHeader->s_dataOffset);
+  size_t consumerEnd = sizeof(RingHeader) + (max+1)*sizeof(ClientInformation);
+  size_t stats       = (sizeof(RingStatistics) + max*sizeof(ClientStatistics) + 7) & ~size_t(7);
+  EQ(consumerEnd + stats, (size_t)pHeader->s_dataOffset);
+  pRingStatistics pStats =
+    reinterpret_cast<pRingStatistics>(reinterpret_cast<char*>(map) + consumerEnd);
+  EQ(string(STATISTICS_MAGICSTRING), string(pStats->s_magicString));
+  EQ(uint32_t(max+1), pStats->s_nClients);
+  EQ(uint64_t(0), pStats->s_clients[max].s_bytes);
   EQ(buf.st_size - pHeader->s_dataOffset, (long int)pHeader->s_dataBytes);
   off_t topoff = pHeader->s_topOffset;
   EQ(buf.st_size -1, topoff);
@@ -183,6 +192,41 @@ void StaticRingTest::format()
 }
 
 
+// Memory options are recorded ahead of the multi-producer block and don't
+// get in the way of using the ring.  Whether the system honors them
+// can't be relied on so that's not checked.
+
+void StaticRingTest::memoryOptions()
+{
+  unsigned options = CRingBuffer::hugePages | CRingBuffer::prefault;
+  CRingBuffer::create(SHM_TESTFILE, 4*1024*1024, 10, false, 2, options, 0);
+
+  void*        map      = mapRingBuffer(SHM_TESTFILE.c_str());
+  pRingBuffer  pRing    = reinterpret_cast<pRingBuffer>(map);
+  size_t       consumerEnd = sizeof(RingHeader) + 11*sizeof(ClientInformation);
+  pRingOptions pOptions =
+    reinterpret_cast<pRingOptions>(reinterpret_cast<char*>(map) + consumerEnd);
+  EQ(string(OPTIONS_MAGICSTRING), string(pOptions->s_magicString));
+  EQ(uint32_t(options), pOptions->s_memoryOptions);
+  EQ(int32_t(0), pOptions->s_numaNode);
+  ASSERT(size_t(pRing->s_header.s_dataBytes) >= 4*1024*1024);
+
+  {
+    CRingBuffer consumer(SHM_TESTFILE);
+    CRingBuffer producer(SHM_TESTFILE, CRingBuffer::producer);
+    EQ(options, consumer.getMemoryOptions());
+    EQ(true, consumer.isMultiProducer());
+
+    char data[100];
+    memset(data, 0x5a, sizeof(data));
+    EQ(sizeof(data), producer.put(data, sizeof(data)));
+    char got[100];
+    EQ(sizeof(got), consumer.get(got, sizeof(got), sizeof(got), 0));
+    EQ(0, memcmp(data, got, sizeof(got)));
+  }
+  munmap(map, pRing->s_header.s_topOffset + 1);
+}
+
 // Remove function
 // - called on a nonexistent ring should throw an exception.
 // - called on an existing ring should remove it.
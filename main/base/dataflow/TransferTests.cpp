@@ -42,6 +42,7 @@ class XferTests : public CppUnit::TestFixture {
   CPPUNIT_TEST(wrapget);
   CPPUNIT_TEST(edgewrapget);
   CPPUNIT_TEST(multi);
+  CPPUNIT_TEST(gatherput);
   CPPUNIT_TEST_SUITE_END();
 
 
@@ -68,6 +69,7 @@ protected:
   void wrapget();
   void edgewrapget();
   void multi();
+  void gatherput();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(XferTests);
@@ -397,3 +399,45 @@ void XferTests::multi()
   
 }
 
+
+// A gather put lays the pieces down contiguously, wrapping across the
+// top of the ring, and advances the put pointer only by the total.
+
+void XferTests::gatherput()
+{
+  CRingBuffer ring(string(SHM_TESTFILE), CRingBuffer::producer);
+
+  pRingBuffer        pBuffer = reinterpret_cast<pRingBuffer>(mapRingBuffer(SHM_TESTFILE.c_str()));
+  pClientInformation pPut    = &(pBuffer->s_producer);
+  pRingHeader        pHeader = &(pBuffer->s_header);
+
+  char msg[100];
+  for (int i=0; i < sizeof(msg); i++) {
+    msg[i] = i;
+  }
+  // Three pieces with the wrap falling in the middle one:
+
+  struct iovec pieces[3];
+  pieces[0].iov_base = msg;      pieces[0].iov_len = 10;
+  pieces[1].iov_base = msg + 10; pieces[1].iov_len = 60;
+  pieces[2].iov_base = msg + 70; pieces[2].iov_len = 30;
+
+  off_t startOffset = pHeader->s_topOffset - 49;
+  pPut->s_offset = startOffset;
+
+  EQ(sizeof(msg), ring.putv(pieces, 3));
+
+  off_t shouldBe = pHeader->s_dataOffset + 50;
+  off_t isOffset = pPut->s_offset;
+  EQ(shouldBe, isOffset);
+
+  char* p = reinterpret_cast<char*>(pBuffer);
+  for (int i = 0; i < 50; i++) {
+    EQ(i, (int)p[startOffset + i]);
+  }
+  for (int i = 50; i < sizeof(msg); i++) {
+    EQ(i, (int)p[pHeader->s_dataOffset + i - 50]);
+  }
+
+  munmap(pBuffer, pBuffer->s_header.s_topOffset+1);
+}
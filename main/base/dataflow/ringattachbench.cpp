@@ -0,0 +1,139 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+// Measures how long it takes to attach to and detach from a ring.
+//
+// Usage:
+//    ringattachbench ?ringname ?count ?consumer|producer ?processes????
+//
+// Each of the processes (default 1) attaches and detaches count (default
+// 10000) times.  The ring (default attachbench) is created if needed.
+// The attach and detach latency distributions and the overall number of
+// attach/detach pairs per second are written to stdout.
+//
+// Run with NSCLDAQ_RINGMASTER_NOTIFY=1 in the environment to compare with
+// clients that tell the RingMaster about each connection.
+//
+#include <CRingBuffer.h>
+#include <CLatencyHistogram.h>
+#include <Exception.h>
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+/*
+** Attach/detach count times, histogramming the times and print the results.
+** Returns the process exit status.
+*/
+static int
+benchmark(const string& ring, unsigned count, CRingBuffer::ClientMode mode)
+{
+  CLatencyHistogram attach;
+  CLatencyHistogram detach;
+  try {
+    for (unsigned i = 0; i < count; i++) {
+      uint64_t start = CLatencyHistogram::nowNs();
+      CRingBuffer* pRing = new CRingBuffer(ring, mode);
+      uint64_t attached = CLatencyHistogram::nowNs();
+      delete pRing;
+      detach.add(CLatencyHistogram::nowNs() - attached);
+      attach.add(attached - start);
+    }
+  }
+  catch (CException& e) {
+    cerr << "ringattachbench: " << e.ReasonText() << endl;
+    return EXIT_FAILURE;
+  }
+  catch (string msg) {
+    cerr << "ringattachbench: " << msg << endl;
+    return EXIT_FAILURE;
+  }
+
+  CLatencyHistogram::Snapshot a = attach.snapshot();
+  CLatencyHistogram::Snapshot d = detach.snapshot();
+  cout << getpid() << " (ns)   mean     p50     p99     max\n";
+  cout << "attach  " << a.s_sum/a.s_count
+       << " " << CLatencyHistogram::percentile(a, 0.50)
+       << " " << CLatencyHistogram::percentile(a, 0.99)
+       << " " << a.s_max << endl;
+  cout << "detach  " << d.s_sum/d.s_count
+       << " " << CLatencyHistogram::percentile(d, 0.50)
+       << " " << CLatencyHistogram::percentile(d, 0.99)
+       << " " << d.s_max << endl;
+  return EXIT_SUCCESS;
+}
+
+int
+main(int argc, char** argv)
+{
+  string   ring      = (argc > 1) ? argv[1] : "attachbench";
+  unsigned count     = (argc > 2) ? strtoul(argv[2], 0, 0) : 10000;
+  string   type      = (argc > 3) ? argv[3] : "consumer";
+  unsigned processes = (argc > 4) ? strtoul(argv[4], 0, 0) : 1;
+
+  if ((count == 0) || (processes == 0) ||
+      ((type != "consumer") && (type != "producer"))) {
+    cerr << "Usage:\n";
+    cerr << "   ringattachbench ?ringname ?count ?consumer|producer ?processes????\n";
+    exit(EXIT_FAILURE);
+  }
+  if ((type == "producer") && (processes > 1)) {
+    cerr << "ringattachbench: only one process can benchmark producer attaches\n";
+    exit(EXIT_FAILURE);
+  }
+  CRingBuffer::ClientMode mode =
+    (type == "producer") ? CRingBuffer::producer : CRingBuffer::consumer;
+
+  try {
+    if (!CRingBuffer::isRing(ring)) {
+      size_t consumers = CRingBuffer::getDefaultMaxConsumers();
+      CRingBuffer::create(ring, CRingBuffer::getDefaultRingSize(),
+                          (processes > consumers) ? processes : consumers);
+    }
+  }
+  catch (CException& e) {
+    cerr << "ringattachbench: unable to create " << ring << ": "
+         << e.ReasonText() << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  uint64_t start  = CLatencyHistogram::nowNs();
+  int      status = EXIT_SUCCESS;
+  for (unsigned i = 0; i < processes; i++) {
+    if (fork() == 0) {
+      exit(benchmark(ring, count, mode));
+    }
+  }
+  for (unsigned i = 0; i < processes; i++) {
+    int childStatus;
+    wait(&childStatus);
+    if (!WIFEXITED(childStatus) || WEXITSTATUS(childStatus)) {
+      status = EXIT_FAILURE;
+    }
+  }
+  double seconds = (CLatencyHistogram::nowNs() - start)/1.0e9;
+  cout << "attach/detach pairs per second: "
+       << static_cast<uint64_t>(count*processes/seconds) << endl;
+
+  return status;
+}
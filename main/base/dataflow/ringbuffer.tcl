@@ -22,7 +22,8 @@ exec tclsh ${0} ${@}
 #   command.  The ringbuffer command is a utility that provides
 #   shell access to ring buffer management.
 #   The following syntaxes are supported:
-#    ringbuffer create ?--datasize=n? ?--maxconsumers=n?   name
+#    ringbuffer create ?--datasize=n? ?--maxconsumers=n? ?--maxproducers=n?
+#                      ?--hugepages? ?--prefault? ?--lock? ?--numa=node?  name
 #    ringbuffer format ?--maxconsumers=n?                  name
 #    ringbuffer delete                                     name
 #    ringbuffer status ?--host=hostname?                  ?pattern?
@@ -34,6 +35,12 @@ exec tclsh ${0} ${@}
 #                of 1024*1024 (e.g. 100m).
 #  --maxconsumers - sets the maximum number of cnosumers that can attach
 #                to the ring at any given time.
+#  --maxproducers - sets the maximum number of producers that can attach
+#                to the ring at any given time (default 1).
+#  --hugepages - Back the ring with transparent huge pages if possible.
+#  --prefault  - Fault the ring's pages in at creation and when clients attach.
+#  --lock      - Clients lock the ring into memory when they attach.
+#  --numa      - NUMA node the ring's memory should come from.
 #  --host      - Sets the name of the host that is the target of the
 #                query.
 #  name        - The name of a ring buffer.
@@ -91,7 +98,8 @@ set defaultHostname     localhost
 #
 proc usage {} {
     puts stderr "Usage"
-    puts stderr " ringbuffer create ?--datasize=n? ?--maxconsumers=n?   name"
+    puts stderr " ringbuffer create ?--datasize=n? ?--maxconsumers=n? ?--maxproducers=n?"
+    puts stderr "                   ?--hugepages? ?--prefault? ?--lock? ?--numa=node? name"
     puts stderr " ringbuffer format ?--maxconsumers=n?                  name"
     puts stderr " ringbuffer delete                                     name"
     puts stderr " ringbuffer status ?--host=hostname? ?--all? ?--user=user1,..?  ?name?"
@@ -240,13 +248,17 @@ proc getRingUsage host {
 #
 #  The form of the table is e.g.:
 # 
-# Name   data-size(k)  free(k)   max-consumers   producer maxget(k) minget(k) client clientdata(k)
-# aring  10240         512       1000            1234     512        255       
-#                                                                              1240  512
-#                                                                              2376  255
-#                                                                              4000   0
+# Name   data-size(k)  free(k)   max-consumers   producer maxget(k) minget(k) client clientdata(k) moved(k) items blocked(ms)
+# aring  10240         512       1000            1234     512        255       -       -          20480   9000   12
+#                                                                              1240  512          19968   8750   3400
+#                                                                              2376  255          20225   8900   0
+#                                                                              4000   0           20480   9000   0
 # nextring....
 #
+# The last three columns are the cumulative data moved, number of puts/gets
+# and time spent waiting for space/data by the producer (ring line) and
+# each consumer.  Rings made before these were kept show zeroes.
+#
 # We use the struct::matrix and report packages from tcllib to creat the report.
 #
 # Parameters:
@@ -256,8 +268,8 @@ proc getRingUsage host {
 # 
 proc displayUsageData info {
     ::struct::matrix reportData
-    reportData add columns 9
-    reportData insert row 0 [list Name data-size(k) free(k) max_consumers producer maxget(k) minget(k) client clientdata(k)]
+    reportData add columns 12
+    reportData insert row 0 [list Name data-size(k) free(k) max_consumers producer maxget(k) minget(k) client clientdata(k) moved(k) items blocked(ms)]
 
     foreach item $info {
 	set name      [lindex $item 0]
@@ -273,29 +285,53 @@ proc displayUsageData info {
 	set minget    [lindex $ringdata 5]
 	set minget    [expr $minget/1024]
 	set clients   [lindex $ringdata 6]
+	set counters  [lindex $ringdata 7]
 
 	# Now The header for a ring:
 
-	reportData insert row end [list $name $size $free $consumer $producer $maxget $minget - -]
+	reportData insert row end [concat \
+	    [list $name $size $free $consumer $producer $maxget $minget - -] \
+	    [formatCounters [lindex $counters 0]]]
 
 	# List the client information:
 
+	set i 1
 	foreach client $clients {
 	    set pid [lindex $client 0]
 	    set get [lindex $client 1]
 	    set get [expr $get/1024]
-	    reportData insert row end [list - - - - - - - $pid $get]
+	    reportData insert row end [concat \
+		[list - - - - - - - $pid $get] \
+		[formatCounters [lindex $counters $i]]]
+	    incr i
 	}
     }
     # Format the report:
 
 
-    ::report::report r 9 style captionedtable 1
+    ::report::report r 12 style captionedtable 1
     puts [r printmatrix reportData]
     
     reportData destroy
 }
 ##
+# formatCounters
+#
+#   Turn a client's counters from the usage list into the moved(k), items
+#   and blocked(ms) report columns.  Usage from rings/servers that don't
+#   report counters gives an empty list.
+#
+# @param counters - {bytes items blocked-usec blocks last-activity}
+# @return list
+#
+proc formatCounters counters {
+    if {[llength $counters] < 3} {
+	return [list 0 0 0]
+    }
+    return [list [expr {[lindex $counters 0]/1024}] [lindex $counters 1] \
+		[expr {[lindex $counters 2]/1000}]]
+}
+##
 # filterRingStats
 #
 #  Given a ring usage list, filters the result by the 
@@ -360,7 +396,9 @@ proc filterRingStats {ringList opts}  {
 proc createRing tail {
     set options [list                                           \
 		     --datasize=$::defaultDataSize              \
-		     --maxconsumers=$::defaultMaxConsumers]
+		     --maxconsumers=$::defaultMaxConsumers      \
+		     --maxproducers=1                           \
+		     --hugepages --prefault --lock --numa=-1]
 
     set tail [lrange $tail 1 end]
     array set parse [decodeArgs $tail $options]
@@ -369,7 +407,17 @@ proc createRing tail {
 	usage
 	exit -1
     }
-    ringbuffer create $parse(Parameters) [size $parse(--datasize)] $parse(--maxconsumers)
+    set memoryOptions [list]
+    foreach option [list hugepages prefault lock] {
+	if {$parse(--$option)} {
+	    lappend memoryOptions $option
+	}
+    }
+    if {$parse(--numa) >= 0} {
+	lappend memoryOptions numa=$parse(--numa)
+    }
+    ringbuffer create $parse(Parameters) [size $parse(--datasize)] $parse(--maxconsumers) \
+	$parse(--maxproducers) $memoryOptions
 }
 
 #--------------------------------------------------------------------------
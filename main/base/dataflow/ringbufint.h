@@ -29,6 +29,13 @@
 #endif
 #endif
 
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
 
 /* constants - These are defined in this way so that they
                can be overidden by compiler -D switches. 
@@ -85,6 +92,128 @@ typedef struct __RingBuffer {
   ClientInformation  s_consumers[1]; /* Client information for the consumers.       */
 } RingBuffer, *pRingBuffer;
 
+/*
+   Optional extension blocks live in the space between the last consumer
+   descriptor and the data segment (older rings have no such gap).  Each
+   starts with a 32 character magic string that identifies it.  The blocks
+   are, in the order they appear if present:
+   - RingOptions - how the ring's memory was set up.
+   - MultiProducerHeader - multi-producer control.
+   - RingStatistics - cumulative per client counters.
+*/
+
+#define OPTIONS_MAGICSTRING "NSCLRingOptions"
+
+typedef struct __RingOptions {
+  char                s_magicString[32]; /* OPTIONS_MAGICSTRING                         */
+  uint32_t            s_memoryOptions;	/* CRingBuffer::MemoryOption bits.              */
+  int32_t             s_numaNode;	/* Preferred NUMA node or -1.                   */
+} RingOptions, *pRingOptions;
+
+/*
+   Multi-producer rings have a control block in the extension area.
+   Positions in the control block are absolute byte counts; a position p
+   lives at s_dataOffset + (p % s_dataBytes) in the ring.
+
+   Producers claim space by advancing s_reserved with a compare and swap,
+   copy their data in and then set s_committed in their slot.  Whoever holds
+   s_publishLock moves s_published (and the s_producer put offset consumers
+   look at) forward over committed reservations in reservation order.
+   A slot whose reservation has been published has s_start == NO_RESERVATION.
+*/
+
+#define MP_MAGICSTRING "NSCLRingMultiProducer"
+#define NO_RESERVATION (~((uint64_t)0))
+
+#ifndef DEFAULT_MAX_PRODUCERS
+#define DEFAULT_MAX_PRODUCERS 1
+#endif
+
+typedef struct __ProducerSlot {
+  volatile pid_t      s_pid;		/* Owner, -1 if free.                           */
+  volatile uint32_t   s_committed;	/* Nonzero once the reserved data is in place.  */
+  volatile uint64_t   s_start;		/* Reservation being filled/awaiting publish... */
+  volatile uint64_t   s_end;		/* ...and the position just past it.            */
+} ProducerSlot, *pProducerSlot;
+
+typedef struct __MultiProducerHeader {
+  char                s_magicString[32]; /* MP_MAGICSTRING                              */
+  uint32_t            s_maxProducer;	/* Number of producer slots.                    */
+  volatile uint32_t   s_publishLock;	/* Nonzero while someone is publishing.         */
+  volatile uint64_t   s_reserved;	/* Everything before this has been claimed.     */
+  volatile uint64_t   s_published;	/* Everything before this is visible.           */
+  ProducerSlot        s_producers[1];	/* Really s_maxProducer of these.               */
+} MultiProducerHeader, *pMultiProducerHeader;
+
+/*
+   Each client keeps cumulative counters in the statistics block.  Entry 0
+   belongs to the producer(s), entry 1+i to consumer i.  Only the client
+   owning an entry writes it (multi-producer rings update the producer
+   entry atomically) so readers may see slightly stale values but never
+   need a lock.  Counters restart when a client attaches to the slot,
+   except that the producers of a multi-producer ring share theirs.
+*/
+
+#define STATISTICS_MAGICSTRING "NSCLRingStatistics"
+
+typedef struct __ClientStatistics {
+  volatile uint64_t   s_bytes;		/* Bytes put or gotten/skipped.                 */
+  volatile uint64_t   s_items;		/* Ring items put or gotten.                    */
+  volatile uint64_t   s_blockedUsec;	/* Microseconds spent waiting for space/data.   */
+  volatile uint64_t   s_blocks;		/* Number of times the client had to wait.      */
+  volatile int64_t    s_lastActivity;	/* time(2) of the last transfer.                */
+} ClientStatistics, *pClientStatistics;
+
+typedef struct __RingStatistics {
+  char                s_magicString[32]; /* STATISTICS_MAGICSTRING                      */
+  uint32_t            s_nClients;	/* Number of entries (s_maxConsumer+1).         */
+  uint32_t            s_unused;
+  ClientStatistics    s_clients[1];	/* Really s_nClients of these.                  */
+} RingStatistics, *pRingStatistics;
+
+/*
+   Rings can have an item index.  This is a separate shared memory segment
+   maintained by the producer that records where items of interesting types
+   start in the data stream.  Positions are absolute byte counts since the
+   producer attached so that they are unambiguous across ring wraps.
+   The index segment is named after the ring with INDEX_SUFFIX appended.
+
+   The producer updates the header and entries between two increments of
+   s_sequence; readers retry if s_sequence is odd or changes while they read.
+*/
+
+#define INDEX_MAGICSTRING "NSCLRingIndex"
+#define INDEX_SUFFIX      "-itemindex"
+
+#ifndef DEFAULT_INDEX_ENTRIES
+#define DEFAULT_INDEX_ENTRIES 4096
+#endif
+
+
+typedef struct __RingIndexEntry {
+  uint64_t  s_position;		/* Absolute position of the item's first byte. */
+  uint32_t  s_type;		/* Item type (host byte order).                */
+  uint32_t  s_size;		/* Item size (host byte order).                */
+} RingIndexEntry, *pRingIndexEntry;
+
+typedef struct __RingIndexHeader {
+  char               s_magicString[32];	/* INDEX_MAGICSTRING                         */
+  uint32_t           s_nEntries;	/* Number of entry slots.                    */
+  uint32_t           s_unindexedType;	/* Items of this type are not recorded.      */
+  volatile uint32_t  s_valid;		/* Zero if the producer lost track of items. */
+  volatile uint32_t  s_unused;
+  volatile uint64_t  s_sequence;	/* Odd while an update is in progress.       */
+  volatile uint64_t  s_produced;	/* Absolute position of the put pointer...   */
+  volatile off_t     s_putOffset;	/* ...and the ring offset it corresponds to. */
+  volatile uint64_t  s_boundary;	/* All items before this are complete.       */
+  volatile uint64_t  s_recorded;	/* Total number of entries ever recorded.    */
+} RingIndexHeader, *pRingIndexHeader;
+
+typedef struct __RingIndex {
+  RingIndexHeader    s_header;
+  RingIndexEntry     s_entries[1];	/* Really s_header.s_nEntries of these.      */
+} RingIndex, *pRingIndex;
+
 
 
 #endif
@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <signal.h>
 #include <os.h>
+#include <CPipelineTrace.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
@@ -179,6 +180,7 @@ putData(CRingBuffer& ring, void* pBuffer, size_t nBytes)
       pLastItem = pHeader;
 
       ring.put(p, size);
+      CPipelineTrace::hopItem(CPipelineTrace::StdinToRing, p);
       p += size;
       nBytes -= size;
       lastSize = size;
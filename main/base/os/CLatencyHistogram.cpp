@@ -0,0 +1,175 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2015.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CLatencyHistogram.cpp
+# @brief  Implement the non-inline parts of CLatencyHistogram.
+# @author <fox@nscl.msu.edu>
+*/
+
+#include "CLatencyHistogram.h"
+#include <time.h>
+
+/**
+ * constructor
+ *    Start with all counters zeroed.
+ */
+CLatencyHistogram::CLatencyHistogram()
+{
+    reset();
+}
+/**
+ * copy constructor
+ *    Atomics aren't copyable so copy the current values.  This lets
+ *    histograms live in standard containers.
+ */
+CLatencyHistogram::CLatencyHistogram(const CLatencyHistogram& rhs)
+{
+    *this = rhs;
+}
+/**
+ * assignment
+ */
+CLatencyHistogram&
+CLatencyHistogram::operator=(const CLatencyHistogram& rhs)
+{
+    if (this != &rhs) {
+        Snapshot contents = rhs.snapshot();
+        for (int i = 0; i < BucketCount; i++) {
+            m_buckets[i].store(contents.s_buckets[i], std::memory_order_relaxed);
+        }
+        m_count.store(contents.s_count, std::memory_order_relaxed);
+        m_sum.store(contents.s_sum, std::memory_order_relaxed);
+        m_max.store(contents.s_max, std::memory_order_relaxed);
+        m_clearRequested.store(false, std::memory_order_relaxed);
+    }
+    return *this;
+}
+
+/**
+ * clear
+ *    Ask the owning thread to zero the histogram.  This is safe from any
+ *    thread; the histogram reads as empty from now on.
+ */
+void
+CLatencyHistogram::clear()
+{
+    m_clearRequested.store(true, std::memory_order_release);
+}
+/**
+ * reset
+ *    Zero the histogram.  Only the owning thread (or a constructor) may
+ *    do this.
+ */
+void
+CLatencyHistogram::reset()
+{
+    m_clearRequested.store(false, std::memory_order_relaxed); // A clear from now on is redone.
+    for (int i = 0; i < BucketCount; i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+/**
+ * snapshot
+ *    @return Snapshot - a copy of the current contents.
+ */
+CLatencyHistogram::Snapshot
+CLatencyHistogram::snapshot() const
+{
+    Snapshot result;
+    if (m_clearRequested.load(std::memory_order_acquire)) {
+        result.s_count = 0;             // The owner hasn't gotten to it yet.
+        result.s_sum   = 0;
+        result.s_max   = 0;
+        result.s_buckets.resize(BucketCount, 0);
+        return result;
+    }
+    result.s_count = m_count.load(std::memory_order_relaxed);
+    result.s_sum   = m_sum.load(std::memory_order_relaxed);
+    result.s_max   = m_max.load(std::memory_order_relaxed);
+    result.s_buckets.resize(BucketCount);
+    for (int i = 0; i < BucketCount; i++) {
+        result.s_buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+/**
+ * bucketLow
+ *   @param bucket - a bucket number.
+ *   @return uint64_t - the smallest value that lands in that bucket.
+ */
+uint64_t
+CLatencyHistogram::bucketLow(unsigned bucket)
+{
+    return bucket ? (uint64_t(1) << (bucket - 1)) : 0;
+}
+/**
+ * bucketHigh
+ *   @param bucket - a bucket number.
+ *   @return uint64_t - the largest value that lands in that bucket.
+ */
+uint64_t
+CLatencyHistogram::bucketHigh(unsigned bucket)
+{
+    if (bucket == 0)  return 0;
+    if (bucket >= 64) return UINT64_MAX;
+    return (uint64_t(1) << bucket) - 1;
+}
+
+/**
+ * percentile
+ *    Estimate a percentile from a snapshot.  Since the only thing we know
+ *    is the bucket a value landed in, the upper edge of the bucket holding
+ *    the requested fraction of the counts is returned (clipped to the
+ *    maximum value seen).
+ *
+ *  @param data     - Histogram snapshot.
+ *  @param fraction - e.g. 0.99 for the 99'th percentile.
+ *  @return uint64_t - 0 if the histogram is empty.
+ */
+uint64_t
+CLatencyHistogram::percentile(const Snapshot& data, double fraction)
+{
+    if (data.s_count == 0) return 0;
+    
+    uint64_t needed = uint64_t(fraction * data.s_count + 0.5);
+    if (needed == 0) needed = 1;
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < data.s_buckets.size(); i++) {
+        sum += data.s_buckets[i];
+        if (sum >= needed) {
+            uint64_t high = bucketHigh(i);
+            return high < data.s_max ? high : data.s_max;
+        }
+    }
+    return data.s_max;
+}
+/**
+ * nowNs
+ *    @return uint64_t - the monotonic clock in nanoseconds.  Used to time
+ *                      the intervals that get histogrammed.
+ */
+uint64_t
+CLatencyHistogram::nowNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return uint64_t(now.tv_sec)*1000000000 + now.tv_nsec;
+}
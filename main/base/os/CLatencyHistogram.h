@@ -0,0 +1,128 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2015.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CLatencyHistogram.h
+# @brief  Low overhead log2 bucketed histogram for timing statistics.
+# @author <fox@nscl.msu.edu>
+*/
+#ifndef __CLATENCYHISTOGRAM_H
+#define __CLATENCYHISTOGRAM_H
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
+#include <atomic>
+
+/**
+ * @class CLatencyHistogram
+ *
+ *    Histogram of 64 bit values with power of two bucket widths:
+ *    bucket 0 counts zeroes and bucket i (i > 0) counts values in
+ *    [2^(i-1), 2^i).  That's coarse but more than good enough to see where
+ *    time goes, and placing a value is a count-leading-zeroes instruction.
+ *
+ *    Each histogram is meant to be owned by a single updating thread
+ *    (e.g. the event orderer's output thread or a readout trigger loop)
+ *    so updates never contend and are done as relaxed loads and stores
+ *    rather than read-modify-writes.  Being atomics, the counters can
+ *    still be read by other threads (e.g. the Tcl command that reports
+ *    them) without locking; a snapshot taken while values are being
+ *    added may be off by the values in flight.
+ *
+ *    Another thread zeroing the counters could be undone by an add
+ *    between its load and store, leaving the buckets, count and sum
+ *    disagreeing.  So clear only posts a request; the owner zeroes the
+ *    histogram at its next add, and until then snapshots are empty.
+ */
+class CLatencyHistogram
+{
+public:
+    enum { BucketCount = 65 };
+    
+    typedef struct _Snapshot {
+        uint64_t              s_count;
+        uint64_t              s_sum;
+        uint64_t              s_max;
+        std::vector<uint64_t> s_buckets;
+    } Snapshot, *pSnapshot;
+    
+private:
+    std::atomic<uint64_t> m_buckets[BucketCount];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+    std::atomic<bool>     m_clearRequested;
+    
+public:
+    CLatencyHistogram();
+    CLatencyHistogram(const CLatencyHistogram& rhs);
+    CLatencyHistogram& operator=(const CLatencyHistogram& rhs);
+    
+    /**
+     * add
+     *    Count a value.  This is the hot path.
+     */
+    void add(uint64_t value) {
+        if (m_clearRequested.load(std::memory_order_acquire)) {
+            reset();
+        }
+        increment(m_buckets[bucketIndex(value)], 1);
+        increment(m_count, 1);
+        increment(m_sum, value);
+        if (value > m_max.load(std::memory_order_relaxed)) {
+            m_max.store(value, std::memory_order_relaxed);
+        }
+    }
+    void     clear();
+    Snapshot snapshot() const;
+    
+    // Utilities:
+    
+    static unsigned bucketIndex(uint64_t value) {
+        return value ? 64 - __builtin_clzll(value) : 0;
+    }
+    static uint64_t bucketLow(unsigned bucket);
+    static uint64_t bucketHigh(unsigned bucket);
+    static uint64_t percentile(const Snapshot& data, double fraction);
+    static uint64_t nowNs();
+    
+private:
+    void reset();
+    
+    // Only the owning thread writes so a plain load and store is enough;
+    // fetch_add would be a locked read-modify-write on every value.
+    
+    static void increment(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.store(
+            counter.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed
+        );
+    }
+};
+
+#endif
@@ -0,0 +1,373 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2015.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CPipelineTrace.cpp
+# @brief  Implement the trace region and its writers/readers.
+# @author <fox@nscl.msu.edu>
+*/
+
+#include "CPipelineTrace.h"
+#include "daqshm.h"
+
+#include <mutex>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+const char*      CPipelineTrace::Magic("NSCLTRC");
+const uint32_t   CPipelineTrace::Version;
+const uint32_t   CPipelineTrace::DefaultCapacity;
+const uint64_t   CPipelineTrace::NullTimestamp;
+std::atomic<int> CPipelineTrace::m_interval(-1);
+CPipelineTrace::pBlock CPipelineTrace::m_pBlock(0);
+std::string      CPipelineTrace::m_regionName;
+
+static std::once_flag initialized;
+
+/*
+** Time allowed for another process to initialize a new region.
+*/
+static const unsigned INIT_WAIT_MS(1000);
+
+/*
+** Scramble a timestamp so that sampling every n'th value of the hash
+** doesn't alias with timestamps that are regularly spaced (e.g. a pulser).
+** This is the splitmix64 finalizer.
+*/
+static uint64_t
+mix(uint64_t value)
+{
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+/*
+** The monotonic clock in ns.
+*/
+static uint64_t
+now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return uint64_t(t.tv_sec)*1000000000 + t.tv_nsec;
+}
+
+/**
+ * enable
+ *    Start tracing into a region, creating it if needed.  If the region
+ *    can't be used a warning is written and tracing stays off; tracing
+ *    must never stop the data flow.
+ *
+ * @param interval   - Sampling interval used if the region is created.
+ * @param regionName - Shared memory name of the region.
+ */
+void
+CPipelineTrace::enable(unsigned interval, std::string regionName)
+{
+    disable();
+    pBlock p = create(regionName, interval);
+    if (p) {
+        m_pBlock     = p;
+        m_regionName = regionName;
+        m_interval.store(p->s_interval, std::memory_order_relaxed);
+    } else {
+        std::cerr << "Unable to use the trace region " << regionName
+                  << ", latency tracing is off\n";
+        m_interval.store(0, std::memory_order_relaxed);
+    }
+}
+/**
+ * disable
+ *    Stop tracing.  Must not be called while other threads may be
+ *    recording hops.
+ */
+void
+CPipelineTrace::disable()
+{
+    m_interval.store(0, std::memory_order_relaxed);
+    if (m_pBlock) {
+        detach(m_pBlock, m_regionName);
+        m_pBlock = 0;
+        m_regionName = "";
+    }
+}
+/**
+ * sampled
+ *    @param timestamp - an item timestamp.
+ *    @return bool     - true if the item is in the traced sample.
+ */
+bool
+CPipelineTrace::sampled(uint64_t timestamp)
+{
+    int interval = m_interval.load(std::memory_order_relaxed);
+    return (interval > 0) && (timestamp != NullTimestamp) &&
+        ((mix(timestamp) % interval) == 0);
+}
+/**
+ * record
+ *    Write a hop record.  The record's sequence is zeroed while it's
+ *    being filled in so that readers can tell when they've seen a
+ *    partial or overwritten record.
+ *
+ * @param stage     - Stage that handled the item.
+ * @param timestamp - Timestamp of the item.
+ */
+void
+CPipelineTrace::record(Stage stage, uint64_t timestamp)
+{
+    pBlock p = m_pBlock;
+    if (!p) return;
+
+    uint64_t index = p->s_next.fetch_add(1, std::memory_order_relaxed);
+    Record&  r     = p->s_records[index % p->s_capacity];
+
+    r.s_sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    r.s_timestamp.store(timestamp, std::memory_order_relaxed);
+    r.s_ns.store(now(), std::memory_order_relaxed);
+    r.s_stage.store(stage, std::memory_order_relaxed);
+    r.s_pid.store(getpid(), std::memory_order_relaxed);
+    r.s_sequence.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * create
+ *    Create and initialize a trace region or attach to an existing one.
+ *
+ * @param name     - Shared memory name.
+ * @param interval - Sampling interval if the region is new.
+ * @param capacity - Number of records if the region is new.
+ *
+ * @return pBlock - 0 if the region could not be made or used.
+ */
+CPipelineTrace::pBlock
+CPipelineTrace::create(std::string name, unsigned interval, uint32_t capacity)
+{
+    if (interval == 0) interval = 1;
+    if (capacity == 0) capacity = 1;
+
+    if (CDAQShm::create(name, regionSize(capacity),
+                        CDAQShm::GroupRead | CDAQShm::GroupWrite |
+                        CDAQShm::OtherRead | CDAQShm::OtherWrite) &&
+        (CDAQShm::lastError() != CDAQShm::Exists)) {
+        return 0;
+    }
+
+    // attach falls back to a read only mapping; writers need to write:
+
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    close(fd);
+    if (CDAQShm::size(name) < ssize_t(regionSize(1))) {
+        return 0;
+    }
+    pBlock p = reinterpret_cast<pBlock>(CDAQShm::attach(name));
+    if (!p) {
+        return 0;
+    }
+
+    uint32_t fresh = 0;
+    if (p->s_state.compare_exchange_strong(fresh, 1)) {
+        strncpy(p->s_magic, Magic, sizeof(p->s_magic));
+        p->s_version  = Version;
+        p->s_capacity = capacity;
+        p->s_interval = interval;
+        p->s_next.store(0, std::memory_order_relaxed);
+        p->s_state.store(2, std::memory_order_release);
+    } else {
+        for (unsigned ms = 0;
+             (p->s_state.load(std::memory_order_acquire) != 2) &&
+                 (ms < INIT_WAIT_MS); ms++) {
+            usleep(1000);
+        }
+    }
+    if ((p->s_state.load(std::memory_order_acquire) != 2) ||
+        strncmp(p->s_magic, Magic, sizeof(p->s_magic)) ||
+        (p->s_version != Version) ||
+        (CDAQShm::size(name) < ssize_t(regionSize(p->s_capacity)))) {
+        CDAQShm::detach(p, name, CDAQShm::size(name));
+        return 0;
+    }
+    return p;
+}
+/**
+ * attach
+ *    Map an existing, initialized trace region.
+ *
+ * @param name - Shared memory name.
+ * @return pBlock - 0 if the region does not exist or is not a trace
+ *                  region of this version.
+ */
+CPipelineTrace::pBlock
+CPipelineTrace::attach(std::string name)
+{
+    if (CDAQShm::size(name) < ssize_t(regionSize(1))) {
+        return 0;
+    }
+    pBlock p = reinterpret_cast<pBlock>(CDAQShm::attach(name));
+    if (p && ((p->s_state.load(std::memory_order_acquire) != 2) ||
+              strncmp(p->s_magic, Magic, sizeof(p->s_magic)) ||
+              (p->s_version != Version) ||
+              (CDAQShm::size(name) < ssize_t(regionSize(p->s_capacity))))) {
+        CDAQShm::detach(p, name, CDAQShm::size(name));
+        p = 0;
+    }
+    return p;
+}
+/**
+ * detach
+ *    Unmap a region from create or attach.
+ */
+void
+CPipelineTrace::detach(pBlock pRegion, std::string name)
+{
+    CDAQShm::detach(pRegion, name, regionSize(pRegion->s_capacity));
+}
+/**
+ * read
+ *    Read the records written since the last read.  A record that is
+ *    still being written stops the read so it's picked up next time
+ *    unless the writers are far enough ahead that it would be lost
+ *    anyway.
+ *
+ * @param pRegion - The region.
+ * @param cursor  - Index of the next record to read; updated.  Start at 0.
+ * @param hops    - Records read are appended to this.
+ *
+ * @return uint64_t - Number of records that were overwritten before they
+ *                    could be read.
+ */
+uint64_t
+CPipelineTrace::read(const Block* pRegion, uint64_t& cursor,
+                     std::vector<Hop>& hops)
+{
+    uint64_t capacity = pRegion->s_capacity;
+    uint64_t next     = pRegion->s_next.load(std::memory_order_acquire);
+    uint64_t lost     = 0;
+
+    if (next - cursor > capacity) {
+        lost   = next - capacity - cursor;
+        cursor = next - capacity;
+    }
+    for (; cursor < next; cursor++) {
+        const Record& r   = pRegion->s_records[cursor % capacity];
+        uint64_t      seq = r.s_sequence.load(std::memory_order_acquire);
+        if (seq < cursor + 1) {
+            if (next - cursor < capacity/2) break; // Still being written.
+            lost++;
+            continue;
+        }
+        Hop hop;
+        hop.s_timestamp = r.s_timestamp.load(std::memory_order_relaxed);
+        hop.s_ns        = r.s_ns.load(std::memory_order_relaxed);
+        hop.s_stage     = Stage(r.s_stage.load(std::memory_order_relaxed));
+        hop.s_pid       = r.s_pid.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq != cursor + 1) ||
+            (r.s_sequence.load(std::memory_order_relaxed) != seq) ||
+            (hop.s_stage >= NumStages)) {
+            lost++;                               // Overwritten.
+            continue;
+        }
+        hops.push_back(hop);
+    }
+    return lost;
+}
+
+/**
+ * itemTimestamp
+ *    Pull the timestamp out of a ring item's body header.  This only
+ *    needs the first few words of the 11.0 layout (see DataFormat.h):
+ *    the item header (size, type) followed by the body header size, which
+ *    is zero if there's no body header, and the 64 bit timestamp.
+ *
+ * @param pItem - Pointer to the ring item.
+ * @return uint64_t - The timestamp or NullTimestamp if there is none.
+ */
+uint64_t
+CPipelineTrace::itemTimestamp(const void* pItem)
+{
+    const uint32_t* p = static_cast<const uint32_t*>(pItem);
+    if ((p[0] < 3*sizeof(uint32_t) + sizeof(uint64_t)) ||
+        (p[2] < sizeof(uint32_t) + sizeof(uint64_t))) {
+        return NullTimestamp;            // Too small or no body header.
+    }
+    uint64_t timestamp;
+    memcpy(&timestamp, p + 3, sizeof(timestamp));
+    return timestamp;
+}
+/**
+ * defaultName
+ *    @return std::string - name of the trace region if NSCLDAQ_TRACE_REGION
+ *                          does not give one.  The region is shared by all
+ *                          accounts so that stages run by different users
+ *                          trace together.
+ */
+std::string
+CPipelineTrace::defaultName()
+{
+    return "/nscldaq-trace";
+}
+/**
+ * stageName
+ *    @return const char* - printable name of a stage.
+ */
+const char*
+CPipelineTrace::stageName(unsigned stage)
+{
+    static const char* names[NumStages] = {
+        "readout", "ringsource", "orderer-in", "orderer-out", "glom",
+        "stdintoring", "eventlog"
+    };
+    return stage < NumStages ? names[stage] : "unknown";
+}
+/**
+ * regionSize
+ *    @return size_t - bytes needed for a region with capacity records.
+ */
+size_t
+CPipelineTrace::regionSize(uint32_t capacity)
+{
+    return sizeof(Block) + (capacity - 1)*sizeof(Record);
+}
+
+/*
+** Turn tracing on if the environment asks for it.  Only done once.
+*/
+void
+CPipelineTrace::initialize()
+{
+    std::call_once(initialized, []() {
+        const char* pInterval = getenv("NSCLDAQ_TRACE");
+        int interval = pInterval ? atoi(pInterval) : 0;
+        if (interval > 0) {
+            const char* pRegion = getenv("NSCLDAQ_TRACE_REGION");
+            enable(interval, pRegion ? pRegion : defaultName());
+        } else {
+            m_interval.store(0, std::memory_order_relaxed);
+        }
+    });
+}
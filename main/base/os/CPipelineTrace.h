@@ -0,0 +1,190 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2015.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CPipelineTrace.h
+# @brief  Sampled hop time stamps for end to end latency tracing.
+# @author <fox@nscl.msu.edu>
+*/
+#ifndef __CPIPELINETRACE_H
+#define __CPIPELINETRACE_H
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+#ifndef __STL_STRING
+#include <string>
+#ifndef __STL_STRING
+#define __STL_STRING
+#endif
+#endif
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
+#include <atomic>
+#include <sys/types.h>
+
+/**
+ * @class CPipelineTrace
+ *
+ *    Each stage of the data flow (readout output, ringsource, the
+ *    orderer, glom, stdintoring, eventlog) calls hop() or hopItem() as
+ *    items pass through it.  For a sample of the items the stage, its pid,
+ *    the item timestamp and the monotonic clock are written to a trace
+ *    region in shared memory.  A collector (pipelinetrace) reads the region
+ *    and matches records by timestamp to get the time spent between stages.
+ *
+ *    The items themselves are never touched, so consumers see the same
+ *    data whether or not tracing is on.  Tracing is off unless the
+ *    NSCLDAQ_TRACE environment variable holds the sampling interval n
+ *    (about one timestamp in n is traced); when off a hop costs one
+ *    test of a static.  An item is sampled based on a hash of its
+ *    timestamp, so every stage samples the same items; the interval of
+ *    the process that creates the region is used by all.  Items without
+ *    timestamps aren't traced.  NSCLDAQ_TRACE_REGION overrides the name
+ *    of the region.
+ *
+ *    The region is a ring of records that writers claim with an atomic
+ *    increment, so any number of processes can write without locking; the
+ *    oldest records are overwritten if the collector falls behind.  Since
+ *    the stamps come from CLOCK_MONOTONIC, stages must run on the same
+ *    host for their times to be comparable.
+ */
+class CPipelineTrace
+{
+public:
+    typedef enum _Stage {
+        ReadoutOutput,     // Readout puts the item in its ring.
+        RingSource,        // Ring source sends it to the orderer.
+        OrdererIngest,     // Orderer receives the fragment.
+        OrdererEmit,       // Orderer outputs the fragment.
+        Glom,              // glom outputs the event containing it.
+        StdinToRing,       // stdintoring puts it in a ring.
+        EventLog,          // eventlog writes it to disk.
+        NumStages
+    } Stage;
+
+    // Layout of the shared memory region:
+
+    typedef struct _Record {
+        std::atomic<uint64_t> s_sequence;  // index + 1 once written.
+        std::atomic<uint64_t> s_timestamp;
+        std::atomic<uint64_t> s_ns;
+        std::atomic<uint32_t> s_stage;
+        std::atomic<int32_t>  s_pid;
+    } Record, *pRecord;
+
+    typedef struct _Block {
+        char                  s_magic[8];
+        std::atomic<uint32_t> s_state;     // 0 new, 1 initializing, 2 ready.
+        uint32_t              s_version;
+        uint32_t              s_capacity;  // Number of records.
+        uint32_t              s_interval;  // Sampling interval.
+        std::atomic<uint64_t> s_next;      // Index of the next record.
+        Record                s_records[1];
+    } Block, *pBlock;
+
+    typedef struct _Hop {                  // A record as read back.
+        Stage    s_stage;
+        pid_t    s_pid;
+        uint64_t s_timestamp;
+        uint64_t s_ns;
+    } Hop, *pHop;
+
+    static const char*    Magic;           // "NSCLTRC"
+    static const uint32_t Version = 1;
+    static const uint32_t DefaultCapacity = 65536;
+    static const uint64_t NullTimestamp = 0xffffffffffffffffULL;
+
+private:
+    static std::atomic<int> m_interval;    // -1 not yet known, 0 off.
+    static pBlock           m_pBlock;
+    static std::string      m_regionName;
+
+public:
+
+    /**
+     * enabled
+     *    @return bool - true if this process traces.  Looks at the
+     *                   environment the first time.
+     */
+    static bool enabled() {
+        int interval = m_interval.load(std::memory_order_relaxed);
+        if (interval < 0) {
+            initialize();
+            interval = m_interval.load(std::memory_order_relaxed);
+        }
+        return interval > 0;
+    }
+    /**
+     * hop
+     *    Record that a stage handled the item with this timestamp, if
+     *    tracing is on and the item is in the sample.
+     */
+    static void hop(Stage stage, uint64_t timestamp) {
+        if (enabled() && sampled(timestamp)) {
+            record(stage, timestamp);
+        }
+    }
+    /**
+     * hopItem
+     *    Same as hop but takes a ring item and uses its body header
+     *    timestamp.
+     */
+    static void hopItem(Stage stage, const void* pItem) {
+        if (enabled()) {
+            uint64_t timestamp = itemTimestamp(pItem);
+            if (sampled(timestamp)) {
+                record(stage, timestamp);
+            }
+        }
+    }
+
+    static void enable(unsigned interval, std::string regionName = defaultName());
+    static void disable();
+    static bool sampled(uint64_t timestamp);
+    static void record(Stage stage, uint64_t timestamp);
+
+    // Reading:
+
+    static pBlock      create(std::string name, unsigned interval,
+                              uint32_t capacity = DefaultCapacity);
+    static pBlock      attach(std::string name);
+    static void        detach(pBlock pRegion, std::string name);
+    static uint64_t    read(const Block* pRegion, uint64_t& cursor,
+                            std::vector<Hop>& hops);
+
+    // Utilities:
+
+    static uint64_t    itemTimestamp(const void* pItem);
+    static std::string defaultName();
+    static const char* stageName(unsigned stage);
+    static size_t      regionSize(uint32_t capacity);
+
+private:
+    static void initialize();
+};
+
+#endif
@@ -26,6 +26,20 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/syscall.h>
+#include <vector>
+
+// Not all headers know about these yet:
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE 14
+#endif
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
 
 /**
  * Constant definitions:
@@ -53,6 +67,12 @@ const int CDAQShm::GroupWrite = 0x02;
 const int CDAQShm::OtherRead  = 0x10;
 const int CDAQShm::OtherWrite = 0x20;
 
+// Memory tuning bits:
+
+const int CDAQShm::HugePages  = 0x01;
+const int CDAQShm::Prefault   = 0x02;
+const int CDAQShm::Lock       = 0x04;
+
 // Static members.
 
 int CDAQShm::m_nLastError(CDAQShm::Success);
@@ -381,6 +401,80 @@ CDAQShm::stat(std::string name, struct stat* pStat)
   
 }
 
+/**
+ * tune
+ *    Adjust how an attached region is backed.  Each of the requested
+ *    adjustments is attempted even if an earlier one fails, since all of them
+ *    are optimizations the caller can live without:
+ *    - numaNode >= 0 - Prefer that node for the region's pages.  For shared
+ *                      memory the policy sticks to the region so pages
+ *                      faulted in later by any process follow it.
+ *    - HugePages     - Ask for transparent huge pages (only honored if
+ *                      /sys/kernel/mm/transparent_hugepage/shmem_enabled
+ *                      allows it).
+ *    - Prefault      - Fault in all the pages now rather than on first touch.
+ *                      The contents are not modified.
+ *    - Lock          - Lock the pages into memory for as long as this process
+ *                      has the region mapped.
+ *    Placement is done before the prefault so the prefaulted pages land
+ *    where they were asked to.
+ *
+ * @param pSharedMemory - Base of the mapping (from attach).
+ * @param size          - Bytes to tune.
+ * @param flags         - Bit mask of the adjustments above.
+ * @param numaNode      - NUMA node or -1 to leave placement alone.
+ * @return bool
+ * @retval false - everything requested was done.
+ * @retval true  - something could not be done (lastError() is CheckOSError
+ *                 and errno is from the last failure).
+ */
+bool
+CDAQShm::tune(void* pSharedMemory, size_t size, unsigned int flags, int numaNode)
+{
+  m_nLastError = Success;
+  int failure  = 0;
+
+  if (numaNode >= 0) {
+#ifdef SYS_mbind
+    const size_t  bitsPerLong = sizeof(unsigned long)*8;
+    std::vector<unsigned long> nodeMask(numaNode/bitsPerLong + 1, 0);
+    nodeMask[numaNode/bitsPerLong] = 1UL << (numaNode % bitsPerLong);
+    if (syscall(SYS_mbind, pSharedMemory, size, MPOL_PREFERRED,
+		&nodeMask[0], nodeMask.size()*bitsPerLong + 1, 0)) {
+      failure = errno;
+    }
+#else
+    failure = ENOSYS;
+#endif
+  }
+  if ((flags & HugePages) && madvise(pSharedMemory, size, MADV_HUGEPAGE)) {
+    failure = errno;
+  }
+  if (flags & Prefault) {
+    if (madvise(pSharedMemory, size, MADV_POPULATE_WRITE)) {
+
+      // Older kernel - reading each page faults it in without any risk
+      // of clobbering data other processes are writing.
+
+      long pageSize = sysconf(_SC_PAGESIZE);
+      volatile const char* p = reinterpret_cast<volatile const char*>(pSharedMemory);
+      for (size_t i = 0; i < size; i += pageSize) {
+	(void)p[i];
+      }
+    }
+  }
+  if ((flags & Lock) && mlock(pSharedMemory, size)) {
+    failure = errno;
+  }
+
+  if (failure) {
+    m_nLastError = CheckOSError;
+    errno        = failure;
+    return true;
+  }
+  return false;
+}
+
 /*-----------------------------------------------------------------------------------*/
 /* Private methods:                                                                 */
 
@@ -69,6 +69,8 @@ public:
   static int         lastError();
   static std::string errorMessage(int errorCode);
   static int         stat(std::string name, struct stat* pStat);
+  static bool        tune(void* pSharedMemory, size_t size, unsigned int flags,
+			  int numaNode = -1);
   
 
 private:
@@ -86,6 +88,10 @@ public:
   static const int OtherRead;
   static const int OtherWrite;
 
+  static const int HugePages;	// tune flags.
+  static const int Prefault;
+  static const int Lock;
+
 
 
   typedef struct _attachInformation {
@@ -0,0 +1,143 @@
+// Tests for the latency histograms.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CLatencyHistogram.h"
+#include <stdint.h>
+
+class LatencyHistoTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(LatencyHistoTests);
+  CPPUNIT_TEST(buckets);
+  CPPUNIT_TEST(bucketEdges);
+  CPPUNIT_TEST(empty);
+  CPPUNIT_TEST(accumulate);
+  CPPUNIT_TEST(percentiles);
+  CPPUNIT_TEST(clear);
+  CPPUNIT_TEST(clearThenAdd);
+  CPPUNIT_TEST(copy);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void buckets();
+  void bucketEdges();
+  void empty();
+  void accumulate();
+  void percentiles();
+  void clear();
+  void clearThenAdd();
+  void copy();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(LatencyHistoTests);
+
+// Values land in log2 buckets.
+
+void LatencyHistoTests::buckets()
+{
+  EQ(0u, CLatencyHistogram::bucketIndex(0));
+  EQ(1u, CLatencyHistogram::bucketIndex(1));
+  EQ(2u, CLatencyHistogram::bucketIndex(2));
+  EQ(2u, CLatencyHistogram::bucketIndex(3));
+  EQ(3u, CLatencyHistogram::bucketIndex(4));
+  EQ(11u, CLatencyHistogram::bucketIndex(1024));
+  EQ(64u, CLatencyHistogram::bucketIndex(UINT64_MAX));
+}
+// Bucket edges agree with bucketIndex.
+
+void LatencyHistoTests::bucketEdges()
+{
+  for (unsigned i = 0; i < 65; i++) {
+    EQ(i, CLatencyHistogram::bucketIndex(CLatencyHistogram::bucketLow(i)));
+    EQ(i, CLatencyHistogram::bucketIndex(CLatencyHistogram::bucketHigh(i)));
+  }
+}
+// A new histogram is empty.
+
+void LatencyHistoTests::empty()
+{
+  CLatencyHistogram h;
+  CLatencyHistogram::Snapshot s = h.snapshot();
+  EQ(uint64_t(0), s.s_count);
+  EQ(uint64_t(0), s.s_sum);
+  EQ(uint64_t(0), s.s_max);
+  EQ(size_t(65), s.s_buckets.size());
+  EQ(uint64_t(0), CLatencyHistogram::percentile(s, 0.5));
+}
+// Counts, sums and max are maintained.
+
+void LatencyHistoTests::accumulate()
+{
+  CLatencyHistogram h;
+  h.add(5);
+  h.add(6);
+  h.add(100);
+  CLatencyHistogram::Snapshot s = h.snapshot();
+
+  EQ(uint64_t(3), s.s_count);
+  EQ(uint64_t(111), s.s_sum);
+  EQ(uint64_t(100), s.s_max);
+  EQ(uint64_t(2), s.s_buckets[3]);
+  EQ(uint64_t(1), s.s_buckets[7]);
+}
+// Percentiles are the upper edge of the bucket clipped to the max.
+
+void LatencyHistoTests::percentiles()
+{
+  CLatencyHistogram h;
+  for (int i = 0; i < 90; i++) h.add(10);    // bucket 4: 8-15.
+  for (int i = 0; i < 10; i++) h.add(1000);  // bucket 10: 512-1023.
+  CLatencyHistogram::Snapshot s = h.snapshot();
+
+  EQ(uint64_t(15), CLatencyHistogram::percentile(s, 0.5));
+  EQ(uint64_t(15), CLatencyHistogram::percentile(s, 0.9));
+  EQ(uint64_t(1000), CLatencyHistogram::percentile(s, 0.99));
+}
+// clear zeroes everything.
+
+void LatencyHistoTests::clear()
+{
+  CLatencyHistogram h;
+  h.add(1234);
+  h.clear();
+  CLatencyHistogram::Snapshot s = h.snapshot();
+  EQ(uint64_t(0), s.s_count);
+  EQ(uint64_t(0), s.s_max);
+  EQ(uint64_t(0), s.s_buckets[CLatencyHistogram::bucketIndex(1234)]);
+}
+// A clear takes effect before the owner's next add.
+
+void LatencyHistoTests::clearThenAdd()
+{
+  CLatencyHistogram h;
+  h.add(1234);
+  h.add(1234);
+  h.clear();
+  h.add(5);
+  CLatencyHistogram::Snapshot s = h.snapshot();
+  EQ(uint64_t(1), s.s_count);
+  EQ(uint64_t(5), s.s_sum);
+  EQ(uint64_t(5), s.s_max);
+  EQ(uint64_t(0), s.s_buckets[CLatencyHistogram::bucketIndex(1234)]);
+  EQ(uint64_t(1), s.s_buckets[CLatencyHistogram::bucketIndex(5)]);
+}
+// Copies carry the contents (needed to live in containers).
+
+void LatencyHistoTests::copy()
+{
+  CLatencyHistogram h;
+  h.add(7);
+  CLatencyHistogram c(h);
+  h.add(7);
+  EQ(uint64_t(1), c.snapshot().s_count);
+  EQ(uint64_t(7), c.snapshot().s_max);
+}
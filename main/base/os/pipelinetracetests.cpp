@@ -0,0 +1,219 @@
+// Tests for the pipeline trace points.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CPipelineTrace.h"
+#include "daqshm.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sstream>
+
+class PipelineTraceTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(PipelineTraceTests);
+  CPPUNIT_TEST(timestamps);
+  CPPUNIT_TEST(sampleAll);
+  CPPUNIT_TEST(sampleSome);
+  CPPUNIT_TEST(disabled);
+  CPPUNIT_TEST(recordRead);
+  CPPUNIT_TEST(overwrite);
+  CPPUNIT_TEST(existing);
+  CPPUNIT_TEST(processes);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  std::string m_name;
+public:
+  void setUp() {
+    std::stringstream s;
+    s << "/tracetest-" << getpid();
+    m_name = s.str();
+    CDAQShm::remove(m_name);
+  }
+  void tearDown() {
+    CPipelineTrace::disable();
+    CDAQShm::remove(m_name);
+  }
+protected:
+  void timestamps();
+  void sampleAll();
+  void sampleSome();
+  void disabled();
+  void recordRead();
+  void overwrite();
+  void existing();
+  void processes();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PipelineTraceTests);
+
+// Timestamps come from the body header if there is one.
+
+void PipelineTraceTests::timestamps()
+{
+  uint32_t item[8];
+  memset(item, 0, sizeof(item));
+  item[0] = sizeof(item);
+  item[1] = 30;                   // PHYSICS_EVENT
+
+  EQ(CPipelineTrace::NullTimestamp, CPipelineTrace::itemTimestamp(item));
+
+  uint64_t stamp = 0x123456789abcdefULL;
+  item[2] = 20;                   // sizeof(BodyHeader)
+  memcpy(&item[3], &stamp, sizeof(stamp));
+  EQ(stamp, CPipelineTrace::itemTimestamp(item));
+
+  item[0] = 12;                   // Too small to hold one.
+  EQ(CPipelineTrace::NullTimestamp, CPipelineTrace::itemTimestamp(item));
+}
+// With an interval of 1 everything but null timestamps is traced.
+
+void PipelineTraceTests::sampleAll()
+{
+  CPipelineTrace::enable(1, m_name);
+  ASSERT(CPipelineTrace::enabled());
+  for (uint64_t t = 0; t < 1000; t++) {
+    ASSERT(CPipelineTrace::sampled(t));
+  }
+  ASSERT(!CPipelineTrace::sampled(CPipelineTrace::NullTimestamp));
+}
+// Larger intervals sample about 1/interval of regularly spaced stamps.
+
+void PipelineTraceTests::sampleSome()
+{
+  CPipelineTrace::enable(100, m_name);
+  unsigned n = 0;
+  for (uint64_t t = 0; t < 1000000; t += 10) {
+    if (CPipelineTrace::sampled(t)) n++;
+  }
+  ASSERT(n > 900);
+  ASSERT(n < 1100);
+}
+// Nothing is recorded when tracing is off.
+
+void PipelineTraceTests::disabled()
+{
+  CPipelineTrace::enable(1, m_name);
+  CPipelineTrace::disable();
+  ASSERT(!CPipelineTrace::enabled());
+  ASSERT(!CPipelineTrace::sampled(1234));
+  CPipelineTrace::hop(CPipelineTrace::Glom, 1234);
+
+  CPipelineTrace::pBlock p = CPipelineTrace::attach(m_name);
+  ASSERT(p);
+  EQ(uint64_t(0), p->s_next.load());
+  CPipelineTrace::detach(p, m_name);
+}
+// Hops come back in order.
+
+void PipelineTraceTests::recordRead()
+{
+  CPipelineTrace::enable(1, m_name);
+  CPipelineTrace::hop(CPipelineTrace::ReadoutOutput, 100);
+  CPipelineTrace::hop(CPipelineTrace::RingSource, 100);
+  CPipelineTrace::hop(CPipelineTrace::EventLog, 100);
+
+  CPipelineTrace::pBlock p = CPipelineTrace::attach(m_name);
+  ASSERT(p);
+  uint64_t cursor = 0;
+  std::vector<CPipelineTrace::Hop> hops;
+  EQ(uint64_t(0), CPipelineTrace::read(p, cursor, hops));
+  EQ(uint64_t(3), cursor);
+  EQ(size_t(3), hops.size());
+  EQ(CPipelineTrace::ReadoutOutput, hops[0].s_stage);
+  EQ(CPipelineTrace::RingSource, hops[1].s_stage);
+  EQ(CPipelineTrace::EventLog, hops[2].s_stage);
+  for (int i = 0; i < 3; i++) {
+    EQ(uint64_t(100), hops[i].s_timestamp);
+    EQ(getpid(), hops[i].s_pid);
+  }
+  ASSERT(hops[0].s_ns <= hops[1].s_ns);
+  ASSERT(hops[1].s_ns <= hops[2].s_ns);
+
+  // Nothing new:
+
+  hops.clear();
+  EQ(uint64_t(0), CPipelineTrace::read(p, cursor, hops));
+  EQ(size_t(0), hops.size());
+  CPipelineTrace::detach(p, m_name);
+}
+// Records the reader did not keep up with are counted as lost.
+
+void PipelineTraceTests::overwrite()
+{
+  CPipelineTrace::pBlock p = CPipelineTrace::create(m_name, 1, 8);
+  ASSERT(p);
+  CPipelineTrace::enable(1, m_name);
+  for (uint64_t t = 0; t < 20; t++) {
+    CPipelineTrace::hop(CPipelineTrace::Glom, t);
+  }
+  uint64_t cursor = 0;
+  std::vector<CPipelineTrace::Hop> hops;
+  EQ(uint64_t(12), CPipelineTrace::read(p, cursor, hops));
+  EQ(size_t(8), hops.size());
+  EQ(uint64_t(12), hops[0].s_timestamp);
+  EQ(uint64_t(19), hops[7].s_timestamp);
+  CPipelineTrace::detach(p, m_name);
+}
+// Writers use the interval and capacity of an existing region.
+
+void PipelineTraceTests::existing()
+{
+  CPipelineTrace::pBlock p = CPipelineTrace::create(m_name, 7, 16);
+  ASSERT(p);
+  CPipelineTrace::enable(1000, m_name);
+  EQ(uint32_t(7), p->s_interval);
+  EQ(uint32_t(16), p->s_capacity);
+
+  unsigned n = 0;
+  for (uint64_t t = 0; t < 7000; t++) {
+    if (CPipelineTrace::sampled(t)) n++;
+  }
+  ASSERT(n > 800);
+  ASSERT(n < 1200);
+  CPipelineTrace::detach(p, m_name);
+}
+// Several processes can write the same region.
+
+void PipelineTraceTests::processes()
+{
+  CPipelineTrace::enable(1, m_name);
+  pid_t child = fork();
+  if (child == 0) {
+    CPipelineTrace::enable(1, m_name);
+    for (int i = 0; i < 100; i++) {
+      CPipelineTrace::hop(CPipelineTrace::OrdererEmit, i);
+    }
+    _exit(0);
+  }
+  for (int i = 0; i < 100; i++) {
+    CPipelineTrace::hop(CPipelineTrace::OrdererIngest, i);
+  }
+  int status;
+  waitpid(child, &status, 0);
+
+  CPipelineTrace::pBlock p = CPipelineTrace::attach(m_name);
+  uint64_t cursor = 0;
+  std::vector<CPipelineTrace::Hop> hops;
+  EQ(uint64_t(0), CPipelineTrace::read(p, cursor, hops));
+  EQ(size_t(200), hops.size());
+  unsigned mine = 0, childs = 0;
+  for (size_t i = 0; i < hops.size(); i++) {
+    if (hops[i].s_pid == getpid()) {
+      EQ(CPipelineTrace::OrdererIngest, hops[i].s_stage);
+      mine++;
+    } else {
+      EQ(child, hops[i].s_pid);
+      EQ(CPipelineTrace::OrdererEmit, hops[i].s_stage);
+      childs++;
+    }
+  }
+  EQ(100u, mine);
+  EQ(100u, childs);
+  CPipelineTrace::detach(p, m_name);
+}
@@ -0,0 +1,101 @@
+// Tests for CDAQShm::tune.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include "daqshm.h"
+#include <sys/mman.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+
+class tuneTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(tuneTests);
+  CPPUNIT_TEST(nothing);
+  CPPUNIT_TEST(prefault);
+  CPPUNIT_TEST(bestEffort);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  static const char* shmName;
+  static const size_t shmSize;
+  void* m_pMemory;
+public:
+  void setUp() {
+    CDAQShm::create(shmName, shmSize, 0);
+    m_pMemory = CDAQShm::attach(shmName);
+  }
+  void tearDown() {
+    CDAQShm::detach(m_pMemory, shmName, shmSize);
+    CDAQShm::remove(shmName);
+  }
+protected:
+  void nothing();
+  void prefault();
+  void bestEffort();
+private:
+  size_t residentPages();
+};
+
+const char* tuneTests::shmName="/testshm-tune";
+const size_t tuneTests::shmSize = 4*1024*1024;
+CPPUNIT_TEST_SUITE_REGISTRATION(tuneTests);
+
+// Number of pages of the region that are in memory.
+
+size_t
+tuneTests::residentPages()
+{
+  long pageSize = sysconf(_SC_PAGESIZE);
+  std::vector<unsigned char> resident((shmSize + pageSize - 1)/pageSize);
+  EQ(0, mincore(m_pMemory, shmSize, &resident[0]));
+  size_t result = 0;
+  for (size_t i = 0; i < resident.size(); i++) {
+    if (resident[i] & 1) result++;
+  }
+  return result;
+}
+
+// No flags is a successful no-op.
+
+void tuneTests::nothing()
+{
+  ASSERT(m_pMemory);
+  EQ(false, CDAQShm::tune(m_pMemory, shmSize, 0));
+  EQ(CDAQShm::Success, CDAQShm::lastError());
+  EQ(size_t(0), residentPages());
+}
+
+// Prefault brings in every page and leaves the contents alone.
+
+void tuneTests::prefault()
+{
+  long pageSize = sysconf(_SC_PAGESIZE);
+  char* p = reinterpret_cast<char*>(m_pMemory);
+  memset(p + pageSize, 0x5a, 100);
+
+  CDAQShm::tune(m_pMemory, shmSize, CDAQShm::Prefault);
+  EQ(shmSize/pageSize, residentPages());
+  EQ(char(0), p[0]);
+  EQ(char(0x5a), p[pageSize + 99]);
+  EQ(char(0), p[pageSize + 100]);
+}
+
+// Everything is attempted even when something isn't supported; the
+// mapping is still usable afterwards.
+
+void tuneTests::bestEffort()
+{
+  long pageSize = sysconf(_SC_PAGESIZE);
+  bool failed = CDAQShm::tune(
+    m_pMemory, shmSize,
+    CDAQShm::HugePages | CDAQShm::Prefault | CDAQShm::Lock, 0
+  );
+  EQ(failed ? CDAQShm::CheckOSError : CDAQShm::Success, CDAQShm::lastError());
+  EQ(shmSize/pageSize, residentPages());
+
+  memset(m_pMemory, 1, shmSize);
+  EQ(char(1), reinterpret_cast<char*>(m_pMemory)[shmSize-1]);
+}
@@ -27,6 +27,8 @@
 #include <CRingItemFactory.h>
 #include <exception>
 #include <CAbnormalEndItem.h>
+#include <CPipelineTrace.h>
+#include <vector>
 
 // File scoped  variables:
 
@@ -42,6 +44,7 @@ static size_t          totalEventSize(0);
 static bool            nobuild(false);
 static enum enum_timestamp_policy timestampPolicy;
 static unsigned        stateChangeNesting(0);
+static std::vector<uint64_t> tracedTimestamps;	// Sampled fragments in the event.
 
 /**
  * outputGlomParameters
@@ -109,6 +112,10 @@ flushEvent()
     io::writeData(STDOUT_FILENO, &eventSize,  sizeof(uint32_t));
     io::writeData(STDOUT_FILENO, pAccumulatedEvent, 
 		  totalEventSize);
+    for (size_t i = 0; i < tracedTimestamps.size(); i++) {
+      CPipelineTrace::record(CPipelineTrace::Glom, tracedTimestamps[i]);
+    }
+    tracedTimestamps.clear();
     free(pAccumulatedEvent);
     pAccumulatedEvent = 0;
     totalEventSize    = 0;
@@ -215,6 +222,9 @@ accumulateEvent(uint64_t dt, EVB::pFragment pFrag)
   lastTimestamp    = timestamp;
   fragmentCount++;
   timestampSum    += timestamp;
+  if (CPipelineTrace::enabled() && CPipelineTrace::sampled(timestamp)) {
+    tracedTimestamps.push_back(timestamp);
+  }
   
   // Figure out how much we're going to add to the
   // event:
@@ -39,6 +39,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <io.h>
+#include <CPipelineTrace.h>
 #include <fstream>
 #include <iostream>
 
@@ -318,6 +319,7 @@ void CRingSource::transformAvailableData(uint8_t*& pFragments)
   while ((bytesPackaged < max_event) && m_pBuffer->availableData()) {
     std::unique_ptr<CRingItem> p(CRingItem::getFromRing(*m_pBuffer, all)); // should not block.
     RingItem*  pRingItem = p->getItemPointer();
+    CPipelineTrace::hopItem(CPipelineTrace::RingSource, pRingItem);
 
     // check for end runs for oneshot logic
     if (pRingItem->s_header.s_type == END_RUN) {
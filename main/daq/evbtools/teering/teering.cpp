@@ -22,28 +22,60 @@
 
 #include "tcmdline.h"
 #include <fragment.h>
-#include <fragio.h>
-#include <CRingFragmentItem.h>
+#include <CBufferedRecordReader.h>
+#include <DataFormat.h>
 #include <CRingBuffer.h>
 #include <io.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/uio.h>
 #include <iostream>
+#include <vector>
+
+/*
+ *  Each fragment becomes an EVB_FRAGMENT ring item.  The item header and
+ *  body header are formatted into one of these and the payload is
+ *  put into the ring straight out of the input buffer.
+ */
+struct ItemHeader {
+  RingItemHeader s_header;
+  BodyHeader     s_bodyHeader;
+};
+
+/*
+ *  Fragments are put into the ring in batches.  A batch is at most a
+ *  quarter of the ring so consumers get data in reasonable sized bites.
+ */
+static const size_t MAX_BATCH_FRAGMENTS(1024);
+
+struct Batch {
+  std::vector<ItemHeader>  s_headers;
+  std::vector<const void*> s_payloads;
+  std::vector<iovec>       s_pieces;
+  size_t                   s_nBytes;
+  size_t                   s_maxBytes;
+};
 
 /* Local functions: */
 
-static EVB::pFragment getFragment();
-static bool           fragmentToStdout(EVB::pFragment);
-static void           fragmentToRing(CRingBuffer&, EVB::pFragment);
+static size_t getChunk(CBufferedRecordReader& reader);
+static bool   chunkToStdout(const void* pData, size_t nBytes);
+static void   fragmentsToRing(CRingBuffer& ring, CBufferedRecordReader& reader,
+			      Batch& batch);
+static void   flushBatch(CRingBuffer& ring, Batch& batch);
+
 /**
  *  teering  is analagous to the unix tee program however it
  *  tees between stdout and rings.  Input is stdin and consists of
  *  ring fragments.  Output is:
  *   - stdout - Exactly what came in.
- *   - ring   - Fragments encapsulated in CRingFragmentItem objects submitted to the
+ *   - ring   - Fragments encapsulated in EVB_FRAGMENT ring items submitted to the
  *              destination ring.
  *
+ *  Input is read in large chunks and fragments are processed in place.
+ *  If stdin and stdout are both pipes the stdout copy is made by tee(2)
+ *  without passing through this process.
  */
 int
 main(int argc, char** argv) 
@@ -60,78 +92,138 @@ main(int argc, char** argv)
 
   CRingBuffer ring(args.ring_arg, CRingBuffer::producer);
 
+  Batch batch;
+  batch.s_headers.reserve(MAX_BATCH_FRAGMENTS);
+  batch.s_payloads.reserve(MAX_BATCH_FRAGMENTS);
+  batch.s_nBytes   = 0;
+  batch.s_maxBytes = ring.getUsage().s_bufferSpace/4;
+
   // Main loop:
 
+  CBufferedRecordReader reader(STDIN_FILENO, sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize);
   while(1) {
-    EVB::pFragment pF = getFragment();
-    if(!pF) break;
+    size_t nRead = getChunk(reader);
+    if (!nRead) break;
 
-    if(!fragmentToStdout(pF)) break;
-    fragmentToRing(ring, pF);
-    freeFragment(pF);
+    if (!reader.teed() && !chunkToStdout(reader.lastRead(), nRead)) break;
+    fragmentsToRing(ring, reader, batch);
   }
   exit(EXIT_SUCCESS);
 }
 /**
- * fragmentToRing
+ * fragmentsToRing
+ *
+ * Puts all of the complete fragments in the input buffer into the target
+ * ring as fragment ring items.
+ *
+ * @param ring   - Reference to the ring.
+ * @param reader - Input reader holding the fragments.
+ * @param batch  - Batch the items are accumulated in.
+ */
+static void
+fragmentsToRing(CRingBuffer& ring, CBufferedRecordReader& reader, Batch& batch)
+{
+  const void* p;
+  while ((p = reader.next())) {
+    const EVB::FragmentHeader* pFrag =
+      reinterpret_cast<const EVB::FragmentHeader*>(p);
+    size_t itemSize = sizeof(ItemHeader) + pFrag->s_size;
+
+    if (batch.s_headers.size() &&
+	((batch.s_nBytes + itemSize > batch.s_maxBytes) ||
+	 (batch.s_headers.size() == MAX_BATCH_FRAGMENTS))) {
+      flushBatch(ring, batch);
+    }
+    ItemHeader h;
+    h.s_header.s_size            = itemSize;
+    h.s_header.s_type            = EVB_FRAGMENT;
+    h.s_bodyHeader.s_size        = sizeof(BodyHeader);
+    h.s_bodyHeader.s_timestamp   = pFrag->s_timestamp;
+    h.s_bodyHeader.s_sourceId    = pFrag->s_sourceId;
+    h.s_bodyHeader.s_barrier     = pFrag->s_barrier;
+
+    batch.s_headers.push_back(h);
+    batch.s_payloads.push_back(pFrag + 1);
+    batch.s_nBytes += itemSize;
+  }
+  // The payloads point into the input buffer which the next read
+  // may move so the batch can't be carried over:
+
+  if (batch.s_headers.size()) {
+    flushBatch(ring, batch);
+  }
+}
+/**
+ * flushBatch
  *
- * Puts a new fragment in the target ring.
+ *  Put the batched items into the ring with a single gather put and
+ *  empty the batch.
  *
- * @param ring - Reference to the ring.
- * @param pFrag - Pointer to the fragment.
+ * @param ring  - Reference to the ring.
+ * @param batch - The batch.
  */
 static void
-fragmentToRing(CRingBuffer& ring, EVB::pFragment pFrag)
+flushBatch(CRingBuffer& ring, Batch& batch)
 {
-  CRingFragmentItem frag(pFrag->s_header.s_timestamp,
-			 pFrag->s_header.s_sourceId,
-			 pFrag->s_header.s_size,
-			 pFrag->s_pBody,
-			 pFrag->s_header.s_barrier);
-  frag.commitToRing(ring);
+  batch.s_pieces.clear();
+  for (size_t i = 0; i < batch.s_headers.size(); i++) {
+    iovec header = {&batch.s_headers[i], sizeof(ItemHeader)};
+    iovec body   = {const_cast<void*>(batch.s_payloads[i]),
+		    batch.s_headers[i].s_header.s_size - sizeof(ItemHeader)};
+    batch.s_pieces.push_back(header);
+    if (body.iov_len) batch.s_pieces.push_back(body);
+  }
+  ring.putv(&batch.s_pieces[0], batch.s_pieces.size());
+
+  batch.s_headers.clear();
+  batch.s_payloads.clear();
+  batch.s_nBytes = 0;
 }
 
 /**
- * getFragment
- *    Reads a fragment from stdin.  Note that the fragment and its
- *    payload must eventually be freed via a call to freeFragment.
+ * getChunk
+ *    Reads the next chunk of fragments from stdin, teeing it to stdout
+ *    if possible.
+ *
+ * @param reader - the stdin reader.
  *
- * @return EVB::pFragment 
- * @retval NULL - Read failed for some reason (the error is written to stderr), or eof.
- * @retval other - Pointer to the fragment read.
+ * @return size_t
+ * @retval 0     - Read failed for some reason (the error is written to stderr), or eof.
+ * @retval other - Number of bytes read.
  */
-static EVB::pFragment
-getFragment()
+static size_t
+getChunk(CBufferedRecordReader& reader)
 {
-  EVB::pFragment pResult;
   try {
-    return CFragIO::readFragment(STDIN_FILENO);
+    return reader.read(STDOUT_FILENO);
   }
   catch (int e) {
-    if (pResult) {
-      freeFragment(pResult);
-    }
     if (e) {			//  Only report true errors not eofs.
       std::cerr << "Read failed : " << strerror(e) << std::endl;
     }    
     return  0;
-
+  }
+  catch (std::string msg) {
+    std::cerr << "Read failed : " << msg << std::endl;
+    return 0;
   }
 
 }
 /**
- * fragmentToStdout
+ * chunkToStdout
  *
- * Write a flattened fragment to stdout.
+ * Write a chunk of input data to stdout.
  *
- * @param pFrag - Pointer to the fragment (not flattened).
+ * @param pData  - Pointer to the data.
+ * @param nBytes - Number of bytes to write.
  *
  */
 static bool
-fragmentToStdout(EVB::pFragment pFrag)
+chunkToStdout(const void* pData, size_t nBytes)
 {
   try {
-    CFragIO::writeFragment(STDOUT_FILENO, pFrag);
+    io::writeData(STDOUT_FILENO, pData, nBytes);
   }
   catch(int e) {
     if(e)  {
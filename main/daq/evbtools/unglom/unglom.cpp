@@ -26,7 +26,7 @@
 
 #include <io.h>
 #include <fragment.h>
-#include <fragio.h>
+#include <CBufferedRecordReader.h>
 #include <Exception.h>
 #include <exception>
 #include <errno.h>
@@ -34,23 +34,26 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <vector>
 #include <DataFormat.h>
+#include <RingItemView.h>
 #include <CRingItemFactory.h>
-#include <CRingItem.h>
 
 #include "cmdline.h"
 
 // forward prototypes:
 
-static void* readEvent();
-static void writeEvent(void* pEvent);
-static void writeNonPhysicsItem(CRingItem* pItem);
-static void writePhysicsItem(CRingItem* pItem);
-
-static void* pLastItem=0;
+static size_t ringItemSize(const void* pItem);
+static void writeEvent(const void* pEvent);
+static void writeNonPhysicsItem(const CRingItemView& item);
+static void writePhysicsItem(const CRingItemView& item);
+static void append(const void* pData, size_t nBytes);
+static void flushOutput();
 
 static uint32_t sourceId;	// Source id for non-event fragments.
 
+static std::vector<uint8_t> outputBuffer; // Fragments waiting to be written.
+
 /**
  * glom
  *
@@ -63,6 +66,9 @@ static uint32_t sourceId;	// Source id for non-event fragments.
  *    unglom <old-event-file | glom -dt 1234 >new-event-file
  * \endverbatim
  *
+ *  Input is read in large chunks and the ring items are taken apart in
+ *  place.  The fragments for a chunk are collected in a single output
+ *  buffer that is written once the chunk has been processed.
  */
 int main(int argc, char**argv)
 {
@@ -71,11 +77,17 @@ int main(int argc, char**argv)
   sourceId = args.id_arg;
 
   try {
-    while(1) {
-      void* pEvent = readEvent();
-      if (!pEvent) break;
-      writeEvent(pEvent);
-      free(pEvent);
+    CBufferedRecordReader reader(STDIN_FILENO, sizeof(RingItemHeader),
+				 ringItemSize);
+    while(reader.read()) {
+      const void* pEvent;
+      while ((pEvent = reader.next())) {
+	writeEvent(pEvent);
+      }
+      flushOutput();
+    }
+    if (reader.residual()) {
+      throw std::string("EOF in middle of a ring item");
     }
   }
   catch (std::string msg) {
@@ -106,74 +118,16 @@ int main(int argc, char**argv)
 */
 
 /**
- * readEvent
- * 
- * Reads an event from stdint.
- * 
- * @return void* Pointer to the event storage which must
- *               be freed using free(3).
- * @retval NULL if an endfile was hit during the read of the
- *              header.
- * @throw int on error.
+ * ringItemSize
+ *   Record sizer for the input reader.
  *
- * @note - We will catch io::readData's throw and if a 0
- *         value is thrown on the header read we'll return
- *         a null indicating an eof.
+ * @param pItem - Pointer to a ring item header.
+ * @return size_t - the size of the ring item in host byte order.
  */
-static void*
-readEvent()
+static size_t
+ringItemSize(const void* pItem)
 {
-  // read the ringheader:
-
-  RingItemHeader hdr;
-  try {
-    int nRead = io::readData(STDIN_FILENO, &hdr, sizeof(RingItemHeader));
-    if (nRead != sizeof(RingItemHeader)) {
-	throw std::string("EOF in middle of ring item header!");
-    }
-
-  }
-  catch (int err) {
-    if (err == 0) {
-      return NULL;
-    } else {
-      throw;
-    }
-  }
-  // Allocate the data.  The header indicates 
-  // the number of bytes we need.
-  
-
-  uint8_t* pData = reinterpret_cast<uint8_t*>(malloc(hdr.s_size));
-  if (!pData) {
-    throw errno;		// Allocation failed.
-  } 
-  // Copy the header into the data and point to the
-  // body which is then read:
-
-  memcpy(pData, &hdr, sizeof(RingItemHeader));
-  uint8_t* pBody = pData + sizeof(RingItemHeader);
-  
-  try {
-    size_t bodySize =  hdr.s_size - sizeof(RingItemHeader);
-    size_t nRead = io::readData(STDIN_FILENO, pBody, bodySize); 
-    if (bodySize != nRead) {
-      throw std::string("EOF in middle of a ring item");
-    }
-
-  }
-  catch (int e) {
-    // free storage:
-
-    free(pData);
-    throw;
-  }
-  // At this time, pData points to the fully read ring
-  // item:
-
-  return pData;
-  
-
+  return CRingItemView(pItem).size();
 }
 /**
  * writeEvent
@@ -185,33 +139,20 @@ readEvent()
  *
  * @param pEvent - Points to the ring item that is the event.
  *
- * @throw - int from io::writeData
+ * @throw - std::string if the item is not a ring item we know about.
  */
-static void writeEvent(void* pEvent)
+static void writeEvent(const void* pEvent)
 {
   if(!CRingItemFactory::isKnownItemType(pEvent)) {
     throw std::string("Unrecognized ring item in input stream");
   }
   
-
-  CRingItem* pItem = CRingItemFactory::createRingItem(pEvent);
-  //  Save the last item contents:
-  //
-  //  
-  pRingItem pRItem = pItem->getItemPointer();
-  pLastItem = realloc(pLastItem, pRItem->s_header.s_size);
-  if (pLastItem) {
-    memcpy(pLastItem, pRItem, pRItem->s_header.s_size);
-  } else {
-    throw std::string("Unable to allocate storage for prior item");
-  }
-  if (pItem->type() != PHYSICS_EVENT) {
-    writeNonPhysicsItem(pItem);
+  CRingItemView item(pEvent);
+  if (item.type() != PHYSICS_EVENT) {
+    writeNonPhysicsItem(item);
   } else {
-    writePhysicsItem(pItem);
+    writePhysicsItem(item);
   }
-
-  delete pItem;
 }
 /**
  * writeNonPhysicsItem
@@ -221,26 +162,24 @@ static void writeEvent(void* pEvent)
  *   emitted.
  *  
  * @note The ring item type is what we will put in as the barrier type.
- * @param pFrag - Pointer to the fragment to emit.
+ * @param item - View of the item to emit as a fragment.
  */
-static void writeNonPhysicsItem(CRingItem* pItem)
+static void writeNonPhysicsItem(const CRingItemView& item)
 {
-
-  // Fill in the header:
-
-  pRingItem pRItem = pItem->getItemPointer();
+  const RingItemHeader* pHeader =
+    reinterpret_cast<const RingItemHeader*>(item.getItemPointer());
 
   // Provide initial values
   EVB::FragmentHeader hdr;
   hdr.s_timestamp = NULL_TIMESTAMP;
   hdr.s_sourceId  = sourceId;
-  hdr.s_size      = pRItem->s_header.s_size;
-  uint32_t type=pRItem->s_header.s_type;
+  hdr.s_size      = pHeader->s_size;
+  uint32_t type=pHeader->s_type;
 
   // at the moment we assume that only state change items are barriers
   if (    type == BEGIN_RUN || type == END_RUN 
           || type == PAUSE_RUN || type==RESUME_RUN ) { 
-    hdr.s_barrier   = pRItem->s_header.s_type;
+    hdr.s_barrier   = pHeader->s_type;
   } else {
     // all non-state change items are not barriers
     hdr.s_barrier   = 0;
@@ -249,50 +188,67 @@ static void writeNonPhysicsItem(CRingItem* pItem)
   // if the ring item has a body header, override the 
   // values in the fragment header with the values 
   // in the body header 
-  if (pItem->hasBodyHeader()) {
-    hdr.s_timestamp = pItem->getEventTimestamp();
-    hdr.s_sourceId  = pItem->getSourceId();
-    hdr.s_barrier   = pItem->getBarrierType();
+  if (item.hasBodyHeader()) {
+    hdr.s_timestamp = item.getEventTimestamp();
+    hdr.s_sourceId  = item.getSourceId();
+    hdr.s_barrier   = item.getBarrierType();
   }
 
-  EVB::pFragment p = allocateFragment(&hdr);
-  memcpy(p->s_pBody, pRItem, pRItem->s_header.s_size);
-  CFragIO::writeFragment(STDOUT_FILENO, p);
-
-  freeFragment(p);
-
-  
+  append(&hdr, sizeof(hdr));
+  append(pHeader, pHeader->s_size);
 }
 /**
  * writePhysicsEvent
  *
  *  Write a physics event as its component fragments.  This works by recognizing
- *  that each physics event is a list of flattened fragments.
+ *  that each physics event is a list of flattened fragments so, once the
+ *  leading size is skipped, the rest of the body is the output verbatim.
  *
- * @param pItem - Pointer to the event.  The caller has ensured that the item is,
+ * @param item - View of the event.  The caller has ensured that the item is,
  *                in fact, a PHYSICS_EVENT item.
  *
  */
 static void
-writePhysicsItem(CRingItem* pItem)
+writePhysicsItem(const CRingItemView& item)
 {
-  uint32_t residualSize = pItem->getBodySize();
-  uint8_t* pBody        = reinterpret_cast<uint8_t*>(pItem->getBodyPointer());
+  size_t         residualSize = item.getBodySize();
+  const uint8_t* pBody        =
+    reinterpret_cast<const uint8_t*>(item.getBodyPointer());
 
   // Skip the leading event size glom filled in.
 
+  if (residualSize < sizeof(uint32_t)) {
+    throw std::string("Physics event too small to hold its event size");
+  }
   pBody                += sizeof(uint32_t);
   residualSize         -= sizeof(uint32_t);
 
-  while (residualSize) {
-    EVB::pFlatFragment pFrag = reinterpret_cast<EVB::pFlatFragment>(pBody);
-    EVB::Fragment      frag;
-    frag.s_header = pFrag->s_header;
-    frag.s_pBody  = pFrag->s_body;
-    CFragIO::writeFragment(STDOUT_FILENO, &frag);
-
-    uint32_t totalSize = sizeof(EVB::FragmentHeader) + pFrag->s_header.s_size;
-    pBody += totalSize;
-    residualSize -= totalSize;
+  append(pBody, residualSize);
+}
+/**
+ * append
+ *   Add data to the output buffer.
+ *
+ * @param pData  - Data to add.
+ * @param nBytes - How much there is.
+ */
+static void
+append(const void* pData, size_t nBytes)
+{
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(pData);
+  outputBuffer.insert(outputBuffer.end(), p, p + nBytes);
+}
+/**
+ * flushOutput
+ *   Write the output buffer to stdout and empty it.
+ *
+ * @throw - int from io::writeData
+ */
+static void
+flushOutput()
+{
+  if (!outputBuffer.empty()) {
+    io::writeData(STDOUT_FILENO, &outputBuffer[0], outputBuffer.size());
+    outputBuffer.clear();
   }
 }
@@ -0,0 +1,243 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CBufferedRecordReader.cpp
+ * @brief Implementation of the buffered record reader.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* for tee(2) */
+#endif
+
+#include "CBufferedRecordReader.h"
+#include <fragment.h>
+#include <io.h>
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *
+ * @param fd         - File descriptor data are read from.
+ * @param headerSize - Number of bytes needed to compute a record's size.
+ * @param sizer      - Function that returns the size of a record (including
+ *                     the header) given a pointer to its header.
+ * @param bufferSize - Initial size of the read buffer.  The buffer grows
+ *                     if a record larger than this is encountered.
+ */
+CBufferedRecordReader::CBufferedRecordReader(int fd, size_t headerSize,
+					     RecordSizer sizer, size_t bufferSize) :
+  m_fd(fd),
+  m_headerSize(headerSize),
+  m_sizer(sizer),
+  m_buffer(bufferSize < headerSize ? headerSize : bufferSize),
+  m_nCursor(0),
+  m_nFilled(0),
+  m_nLastRead(0),
+  m_canTee(true),
+  m_teed(false)
+{}
+
+/*----------------------------------------------------------------------------
+ * Public methods
+ */
+
+/**
+ * read
+ *
+ *   Slide any partial record to the front of the buffer and read as much
+ *   data as is available (without waiting for the buffer to fill).
+ *
+ * @param teeFd - If not negative, the data read are also sent to this file
+ *                descriptor with tee(2) if possible.  If teed() is false
+ *                after the read, the caller must write lastRead() itself.
+ *
+ * @return size_t - Number of bytes read; 0 at end of file.
+ *
+ * @throw int - errno on read error.
+ * @throw std::string - the buffer holds an impossible record size.
+ */
+size_t
+CBufferedRecordReader::read(int teeFd)
+{
+  makeRoom();
+  m_nLastRead = readChunk(teeFd);
+  m_nFilled  += m_nLastRead;
+  return m_nLastRead;
+}
+
+/**
+ * next
+ *
+ * @return const void* - Pointer to the next complete record in the buffer
+ *                       or null if there isn't one.
+ *
+ * @throw std::string - the record size is smaller than its header.
+ */
+const void*
+CBufferedRecordReader::next()
+{
+  size_t available = m_nFilled - m_nCursor;
+  if (available < m_headerSize) {
+    return 0;
+  }
+  const uint8_t* p    = &m_buffer[m_nCursor];
+  size_t         size = (*m_sizer)(p);
+  if (size < m_headerSize) {
+    throw std::string("Record with an invalid size in input stream");
+  }
+  if (size > available) {
+    return 0;
+  }
+  m_nCursor += size;
+  return p;
+}
+
+/**
+ * lastRead
+ *
+ * @return const void* - Pointer to the data brought in by the most recent
+ *                       read.  There are read()'s return value bytes of them.
+ */
+const void*
+CBufferedRecordReader::lastRead() const
+{
+  return &m_buffer[m_nFilled - m_nLastRead];
+}
+
+/**
+ * teed
+ *
+ * @return bool - true if the most recent read was duplicated via tee(2).
+ */
+bool
+CBufferedRecordReader::teed() const
+{
+  return m_teed;
+}
+
+/**
+ * residual
+ *
+ * @return size_t - Number of bytes read but not yet handed out by next().
+ *                  Nonzero at end of file means the last record was
+ *                  truncated.
+ */
+size_t
+CBufferedRecordReader::residual() const
+{
+  return m_nFilled - m_nCursor;
+}
+
+/**
+ * fragmentSize
+ *   Sizer for flattened event builder fragments.
+ *
+ * @param pHeader - Pointer to an EVB::FragmentHeader.
+ * @return size_t - Size of the header plus payload.
+ */
+size_t
+CBufferedRecordReader::fragmentSize(const void* pHeader)
+{
+  const EVB::FragmentHeader* p =
+    reinterpret_cast<const EVB::FragmentHeader*>(pHeader);
+  return sizeof(EVB::FragmentHeader) + p->s_size;
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities
+ */
+
+/**
+ * makeRoom
+ *   Move the unconsumed data to the front of the buffer.  If that's
+ *   the front of a record too big for the buffer, grow the buffer.
+ */
+void
+CBufferedRecordReader::makeRoom()
+{
+  size_t nLeft = m_nFilled - m_nCursor;
+  if (nLeft && m_nCursor) {
+    memmove(&m_buffer[0], &m_buffer[m_nCursor], nLeft);
+  }
+  m_nCursor = 0;
+  m_nFilled = nLeft;
+
+  if (nLeft >= m_headerSize) {
+    size_t size = (*m_sizer)(&m_buffer[0]);
+    if (size < m_headerSize) {
+      throw std::string("Record with an invalid size in input stream");
+    }
+    if (size > m_buffer.size()) {
+      m_buffer.resize(size);
+    }
+  }
+}
+/**
+ * readChunk
+ *   Read what's available into the free part of the buffer.
+ *   If asked to tee and tee(2) works between the two descriptors, the
+ *   data are first duplicated to teeFd and then consumed from m_fd.
+ *   tee(2) only works when both descriptors are pipes; the first EINVAL
+ *   turns it off for good.
+ *
+ * @param teeFd - descriptor to duplicate to or negative.
+ * @return size_t - bytes read (0 on eof).
+ */
+size_t
+CBufferedRecordReader::readChunk(int teeFd)
+{
+  uint8_t* pDest = &m_buffer[m_nFilled];
+  size_t   room  = m_buffer.size() - m_nFilled;
+
+  m_teed = false;
+  if ((teeFd >= 0) && m_canTee) {
+    ssize_t nTeed;
+    do {
+      nTeed = tee(m_fd, teeFd, room, 0);
+    } while ((nTeed < 0) && (errno == EINTR));
+
+    if (nTeed >= 0) {
+      m_teed = true;
+      if (nTeed == 0) return 0;	// Writers all gone.
+      if (io::readData(m_fd, pDest, nTeed) != size_t(nTeed)) {
+	throw EIO;		// Data we just teed vanished?!?
+      }
+      return nTeed;
+    }
+    if (errno != EINVAL) {
+      throw errno;
+    }
+    m_canTee = false;		// Not pipes - fall back to read.
+  }
+  ssize_t nRead;
+  do {
+    nRead = ::read(m_fd, pDest, room);
+  } while ((nRead < 0) && (errno == EINTR));
+  if (nRead < 0) {
+    throw errno;
+  }
+  return nRead;
+}
@@ -0,0 +1,108 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CBufferedRecordReader.h
+ * @brief Read a stream of self-sized records with large reads.
+ */
+
+#ifndef __CBUFFEREDRECORDREADER_H
+#define __CBUFFEREDRECORDREADER_H
+
+#ifndef __CRT_STDLIB_H
+#include <stdlib.h>		/* for size_t */
+#ifndef __CRT_STDLIB_H
+#define __CRT_STDLIB_H
+#endif
+#endif
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+/**
+ * CBufferedRecordReader
+ *
+ *   Reads a stream of records (flattened fragments, ring items...) whose
+ *   size can be computed from a fixed size header.  Data are read in large
+ *   chunks and complete records are handed out as pointers into the read
+ *   buffer - nothing is copied or allocated per record.  Pointers returned
+ *   by next() are only valid until the next call to read().
+ *
+ *   read() can optionally duplicate what it reads to another file
+ *   descriptor.  When both the input and that descriptor are pipes this
+ *   is done with tee(2) so the duplicate never passes through user space;
+ *   otherwise the caller must write the chunk itself (see teed() and
+ *   lastRead()).
+ *
+ *   Typical use:
+ *
+ *   \verbatim
+ *     CBufferedRecordReader reader(STDIN_FILENO, sizeof(Header), sizer);
+ *     while (reader.read()) {
+ *       const void* pRecord;
+ *       while((pRecord = reader.next())) {
+ *          ...
+ *       }
+ *     }
+ *   \endverbatim
+ */
+class CBufferedRecordReader
+{
+public:
+  typedef size_t (*RecordSizer)(const void* pHeader);
+
+private:
+  int                  m_fd;
+  size_t               m_headerSize;
+  RecordSizer          m_sizer;
+  std::vector<uint8_t> m_buffer;
+  size_t               m_nCursor;	// Offset of the first unconsumed byte.
+  size_t               m_nFilled;	// Offset just past the last byte read.
+  size_t               m_nLastRead;	// Size of the most recent read.
+  bool                 m_canTee;	// False once tee(2) has failed.
+  bool                 m_teed;	// Most recent read was teed.
+
+public:
+  CBufferedRecordReader(int fd, size_t headerSize, RecordSizer sizer,
+			size_t bufferSize = 1024*1024);
+
+public:
+  size_t      read(int teeFd = -1);
+  const void* next();
+
+  const void* lastRead() const;
+  bool        teed() const;
+  size_t      residual() const;
+
+  static size_t fragmentSize(const void* pHeader);
+
+private:
+  void   makeRoom();
+  size_t readChunk(int teeFd);
+};
+
+#endif
@@ -160,6 +160,31 @@ CConfigure::Set(CTCLInterpreter& interp, std::string name, CTCLObject& value)
     int size = value;
     pHandler->setXonThreshold(size);
     
+  } else if (name == "SourceCreditLimit") {
+
+    // Bytes each source may have queued; 0 turns off per source flow control.
+
+    int size = value;
+    if (size < 0) {
+      std::string errorMsg = "Source credit limit must be >= 0 was ";
+      errorMsg += static_cast<std::string>(value);
+
+      throw errorMsg;
+    }
+    pHandler->setSourceCreditLimit(static_cast<size_t>(size));
+    
+  } else if (name == "shards") {
+
+    // Number of sort threads; must be at least 1 (serial sort).
+
+    int shards = value;
+    if (shards < 1) {
+      std::string errorMsg = "Number of sort shards must be >= 1 was ";
+      errorMsg += static_cast<std::string>(value);
+
+      throw errorMsg;
+    }
+    pHandler->setShardCount(static_cast<unsigned>(shards));
   
   } else {
     std::string errorMsg = "Illegal configuration parametr name: ";
@@ -193,6 +218,16 @@ CConfigure::Get(CTCLInterpreter& interp, std::string name)
     oValue.Bind(interp);
     oValue = static_cast<int>(value);
     interp.setResult(oValue);
+  } else if (name == "shards") {
+    CTCLObject oValue;
+    oValue.Bind(interp);
+    oValue = static_cast<int>(pHandler->getShardCount());
+    interp.setResult(oValue);
+  } else if (name == "SourceCreditLimit") {
+    CTCLObject oValue;
+    oValue.Bind(interp);
+    oValue = static_cast<Tcl_WideInt>(pHandler->getSourceCreditLimit());
+    interp.setResult(oValue);
   } else {
     std::string errorMsg = "Illegal configuration parameter: ";
     errorMsg += name;
@@ -0,0 +1,192 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2013.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CCreditCallbackCommand.cpp
+# @brief  Implement command to manipulate per source flow control callbacks.
+*/
+
+#include "CCreditCallbackCommand.h"
+#include <TCLInterpreter.h>
+#include <TCLObject.h>
+#include "CFragmentHandler.h"
+
+
+/**
+ *  Observer class we use as a container for the handler scripts.
+ */
+class TclSourceFlowObserver : public CFragmentHandler::SourceFlowObserver
+{
+private:
+    std::string m_throttleCommand;
+    std::string m_releaseCommand;
+    CTCLInterpreter& m_interp;
+    
+public:
+    TclSourceFlowObserver(
+        CTCLInterpreter& interp, std::string throttlecmd, std::string releasecmd
+    ) :
+        m_throttleCommand(throttlecmd), m_releaseCommand(releasecmd),
+        m_interp(interp) {}
+    
+    // The SourceFlowObserver interface:
+    
+    void throttle(std::string socketName) {
+        dispatch(m_throttleCommand, socketName);
+    }
+    void release(std::string socketName) {
+        dispatch(m_releaseCommand, socketName);
+    }
+    
+public:
+    std::string throttleCommand() const {return m_throttleCommand;}
+    std::string releaseCommand() const {return m_releaseCommand;}
+    
+private:
+    void dispatch(std::string cmdBase, std::string socketName);
+};
+
+/**
+ * dispatch
+ *   Run a script with the socket name appended.
+ *
+ * @param cmdBase    - Script to run.
+ * @param socketName - Socket to throttle/release.
+ */
+void
+TclSourceFlowObserver::dispatch(std::string cmdBase, std::string socketName)
+{
+    CTCLObject cmd;
+    cmd.Bind(m_interp);
+    cmd = cmdBase;
+    cmd += socketName;
+    m_interp.GlobalEval(std::string(cmd));
+}
+
+
+/*----------------------------------------------------------------------------
+ *  Implementation of the main class.
+ *----------------------------------------------------------------------------*/
+ 
+/**
+ * constructor
+ *    Create/register the command.
+ *
+ * @param interp - reference to the interpreter on which the command will be
+ *                 registered.
+ * @param command - Command string.
+ */
+CCreditCallbackCommand::CCreditCallbackCommand(CTCLInterpreter& interp, std::string command) :
+    CTCLObjectProcessor(interp, command, true) {}
+    
+/**
+ * destructor
+ *    Unregister and delete the observers we made.
+ */
+CCreditCallbackCommand::~CCreditCallbackCommand()
+{
+    std::list<TclSourceFlowObserver*>::iterator p = m_observers.begin();
+    while (p != m_observers.end()) {
+        CFragmentHandler::getInstance()->removeSourceFlowObserver(*p);
+        delete *p;
+        p++;
+    }
+}
+
+/**
+ * operator()
+ *    Gets control when the command is entered.  We need exactly
+ *    4 command line words:  command add|remove  throttlescript releasescript
+ *
+ * @param interp - The interpreter on which the command is running.
+ * @param objv   - The vector of wrapped Tcl_Obj*s that make up the command.
+ *
+ * @return int  TCL_OK on success TCL_ERROR on failure with an error message
+ *              in the result on failure.
+ */
+int
+CCreditCallbackCommand::operator()(
+    CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+    bindAll(interp, objv);
+    try {
+        requireExactly(objv, 4, "Incorrect number of command line parameters");
+        std::string subcommand = objv[1];
+        
+        if (subcommand == "add") {
+            add(interp, objv);
+        } else if (subcommand == "remove") {
+            remove(interp, objv);
+        } else {
+            throw std::string("Invalid sub-command keyword, expected add | remove");
+        }
+    }
+    catch (std::string msg) {
+        interp.setResult(msg);
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+/**
+ * add
+ *    Wrap the scripts in an observer and register it with the fragment
+ *    handler.
+ *
+ *  @param interp - TCL Interpreter that is running the command.
+ *  @param objv   - The command line parameters.
+ */
+void
+CCreditCallbackCommand::add(
+    CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+    std::string throttle = objv[2];
+    std::string release  = objv[3];
+    TclSourceFlowObserver* pObserver =
+        new TclSourceFlowObserver(interp, throttle, release);
+    m_observers.push_back(pObserver);
+    CFragmentHandler::getInstance()->addSourceFlowObserver(pObserver);
+}
+/**
+ * remove
+ *   Remove the observer that was made for a pair of scripts.
+ *
+ *  @param interp - TCL Interpreter that is running the command.
+ *  @param objv   - The command line parameters.
+ *
+ *  @throw std::string - no observer has those scripts.
+ */
+void
+CCreditCallbackCommand::remove(
+    CTCLInterpreter& interp, std::vector<CTCLObject>& objv
+)
+{
+    std::string throttle = objv[2];
+    std::string release  = objv[3];
+    
+    std::list<TclSourceFlowObserver*>::iterator p = m_observers.begin();
+    while (p != m_observers.end()) {
+        TclSourceFlowObserver* pObserver = *p;
+        if ((pObserver->throttleCommand() == throttle) &&
+            (pObserver->releaseCommand() == release)) {
+            CFragmentHandler::getInstance()->removeSourceFlowObserver(pObserver);
+            m_observers.erase(p);
+            delete pObserver;
+            return;
+        }
+        p++;
+    }
+    throw std::string("No handler has been established for this pair of scripts");
+}
@@ -0,0 +1,78 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2013.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CCreditCallbackCommand.h
+# @brief  Defines a command to establish per source flow control callbacks.
+*/
+#ifndef CCREDITCALLBACKCOMMAND_H
+#define CCREDITCALLBACKCOMMAND_H
+#ifndef __TCLOBJECTPROCESSORH_H
+#include <TCLObjectProcessor.h>
+#endif
+
+#ifndef __STL_LIST
+#include <list>
+#ifndef __STL_LIST
+#define __STL_LIST
+#endif
+#endif
+
+class CTCLInterpreter;
+class CTCLObject;
+class TclSourceFlowObserver;
+
+/**
+ * @class CCreditCallbackCommand
+ *
+ * Implements a command that allows the registration and removal
+ * of Tcl scripts that execute when the orderer wants a socket to stop
+ * or start being read because of the per source byte budgets.  The
+ * socket name is appended to the script as a parameter.
+ *
+ * This is a command ensemble with the subcommands:
+ * *  add throttlescript releasescript - Adds the specified callbacks.
+ * *  remove throttlescript releasescript - Removes the specified callbacks.
+ */
+class CCreditCallbackCommand : public CTCLObjectProcessor
+{
+private:
+
+    std::list<TclSourceFlowObserver*> m_observers;
+    // Valid/legal canonicals:
+public:
+    CCreditCallbackCommand(CTCLInterpreter& interp, std::string command);
+    virtual ~CCreditCallbackCommand();
+    
+    // invalid/illegal canonicals:
+private:
+    CCreditCallbackCommand(const CCreditCallbackCommand& rhs);
+    CCreditCallbackCommand& operator=(const CCreditCallbackCommand& rhs);
+    int operator==(const CCreditCallbackCommand& rhs) const;
+    int operator!=(const CCreditCallbackCommand& rhs) const;
+    
+    // The CTCLObjectProcessor interface:
+
+public:
+    int operator()(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+    
+    // Subcommand processors:
+protected:
+    void add(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+    void remove(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+};
+
+#endif
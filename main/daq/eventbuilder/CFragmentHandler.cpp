@@ -26,7 +26,12 @@
 #include <functional>
 #include <cstdint>
 #include <time.h>
+#include <queue>
+#include <pthread.h>
 #include "COutputThread.h"
+#include <CMutex.h>
+#include <CCondition.h>
+#include <CPipelineTrace.h>
 
 using std::uint32_t;
 using std::uint64_t;
@@ -46,6 +51,7 @@ static const time_t DefaultStartupTimeout(4); // default seconds to accumulate d
 static time_t timeOfFirstSubmission(UINT64_MAX); //
 static const  size_t defaultXonLimit(9*Mega);     // Default total fragment storage at which we can xon
 static const  size_t defaultXoffLimit(10*Mega);    // Default total fragment storage at which we xoff.
+static const  size_t defaultSourceCreditLimit(64*Mega); // Default bytes a source may have queued.
 
 /*---------------------------------------------------------------------
  * Debugging
@@ -74,6 +80,243 @@ static void dumpFragment(EVB::pFragment p) {
 
 }
 
+/*---------------------------------------------------------------------
+ * Sort shards.
+ */
+
+/**
+ * @class CFragmentHandler::SortShard
+ *
+ *   Owns the source queues of a subset of the sources.  The interpreter
+ *   thread posts a job to the shards and waits for them all to finish it,
+ *   so while a shard works it has exclusive use of its queues and the rest
+ *   of the handler is not changing.  Jobs are:
+ *   - Ingest - queue the fragments in m_ingest.
+ *   - Sort   - pop fragments no newer than m_bound from the queue heads,
+ *              oldest first, into m_sorted.  Queue heads that are barriers
+ *              stop their queues.
+ *
+ *   The thread is a raw pthread so that it can be reliably joined when
+ *   the number of shards changes.
+ */
+class CFragmentHandler::SortShard
+{
+public:
+  enum Job { Idle, Ingest, Sort, Exit };
+
+  typedef struct _IngestItem {
+    size_t             s_index;
+    EVB::pFlatFragment s_pFragment;
+    SourceQueue*       s_pQueue;
+  } IngestItem;
+
+  std::vector<std::pair<uint32_t, SourceQueue*> > m_queues; // In source id order.
+
+  // Ingest job:
+
+  std::vector<IngestItem>   m_ingest;
+  std::vector<InputAnomaly> m_anomalies;
+  uint64_t                  m_oldest;
+  uint64_t                  m_newest;
+
+  // Sort job:
+
+  uint64_t                    m_bound;
+  std::vector<SortedFragment> m_sorted;
+  bool                        m_emptied;     // Some queue was emptied.
+  bool                        m_sawBarrier;  // Some queue head is a barrier.
+
+private:
+  typedef std::pair<uint64_t, uint32_t> Key; // Timestamp, source id.
+  typedef std::pair<Key, size_t> Head;       // Key, index into m_queues.
+  typedef std::priority_queue<Head, std::vector<Head>, std::greater<Head> > Heads;
+
+  CFragmentHandler&  m_handler;
+  pthread_t          m_thread;
+  CMutex             m_lock;
+  CConditionVariable m_changed;
+  Job                m_job;
+
+public:
+  SortShard(CFragmentHandler& handler);
+  ~SortShard();
+
+  void post(Job job);
+  void wait();
+  void perform(Job job);
+
+private:
+  void ingest();
+  void sort();
+  void pushHead(Heads& heads, size_t i);
+  static void* worker(void* pArg);
+};
+
+/**
+ * constructor
+ *   Start the thread; it waits for jobs.
+ *
+ * @param handler - The fragment handler whose queues we sort.
+ * @throw std::string - if the thread could not be started.
+ */
+CFragmentHandler::SortShard::SortShard(CFragmentHandler& handler) :
+  m_oldest(UINT64_MAX), m_newest(0), m_bound(0),
+  m_emptied(false), m_sawBarrier(false),
+  m_handler(handler), m_job(Idle)
+{
+  if (pthread_create(&m_thread, 0, worker, this)) {
+    throw std::string("Unable to start a sort shard thread");
+  }
+}
+/**
+ * destructor
+ *   Tell the thread to exit and wait for it.
+ */
+CFragmentHandler::SortShard::~SortShard()
+{
+  post(Exit);
+  pthread_join(m_thread, 0);
+}
+/**
+ * post
+ *   Hand a job to the thread.  The thread must be idle.
+ */
+void
+CFragmentHandler::SortShard::post(Job job)
+{
+  CriticalSection c(m_lock);
+  m_job = job;
+  m_changed.broadcast();
+}
+/**
+ * wait
+ *   Wait for the thread to finish its job.
+ */
+void
+CFragmentHandler::SortShard::wait()
+{
+  CriticalSection c(m_lock);
+  while (m_job != Idle) {
+    m_changed.wait(m_lock);
+  }
+}
+/**
+ * perform
+ *   Do a job in the calling thread.
+ */
+void
+CFragmentHandler::SortShard::perform(Job job)
+{
+  if (job == Ingest) {
+    ingest();
+  } else if (job == Sort) {
+    sort();
+  }
+}
+/**
+ * ingest
+ *   Queue the fragments in m_ingest noting the anomalies and the timestamp
+ *   range of the fragments.
+ */
+void
+CFragmentHandler::SortShard::ingest()
+{
+  m_anomalies.clear();
+  m_oldest = UINT64_MAX;
+  m_newest = 0;
+  for (size_t i = 0; i < m_ingest.size(); i++) {
+    IngestItem& item(m_ingest[i]);
+    m_handler.enqueueFragment(
+      *item.s_pQueue, item.s_pFragment, item.s_index, m_anomalies
+    );
+    uint64_t timestamp = item.s_pQueue->s_queue.back().second->s_header.s_timestamp;
+    if (timestamp < m_oldest) m_oldest = timestamp;
+    if (timestamp > m_newest) m_newest = timestamp;
+  }
+}
+/**
+ * sort
+ *   Merge the queue heads into m_sorted.  Residence times and queue
+ *   statistics are maintained as popOldest does and, like it, timestamp
+ *   ties go to the lowest source id.
+ */
+void
+CFragmentHandler::SortShard::sort()
+{
+  Heads heads;
+  for (size_t i = 0; i < m_queues.size(); i++) {
+    pushHead(heads, i);
+  }
+  uint64_t now = m_handler.m_nNowNs;
+  while (!heads.empty()) {
+    size_t i = heads.top().second;
+    heads.pop();
+
+    SourceQueue& queue(*m_queues[i].second);
+    EVB::pFragment pFrag = queue.s_queue.front().second;
+    SortedFragment sorted = {
+      pFrag->s_header.s_timestamp, m_queues[i].first, pFrag,
+      queue.s_arrivals.front()
+    };
+    queue.s_lastPoppedTimestamp = sorted.s_timestamp;
+    queue.s_bytesDeQd          += pFrag->s_header.s_size;
+    queue.s_bytesInQ           -= pFrag->s_header.s_size;
+    queue.s_queue.pop();
+    queue.s_arrivals.pop();
+    queue.s_residence.add(now > sorted.s_arrival ? now - sorted.s_arrival : 0);
+    m_sorted.push_back(sorted);
+
+    if (queue.s_queue.empty()) {
+      m_emptied = true;
+    }
+    pushHead(heads, i);
+  }
+}
+/**
+ * pushHead
+ *   If the head of a queue can be output add it to the merge.
+ */
+void
+CFragmentHandler::SortShard::pushHead(Heads& heads, size_t i)
+{
+  SourceQueue& queue(*m_queues[i].second);
+  if (!queue.s_queue.empty()) {
+    EVB::pFragment pFrag = queue.s_queue.front().second;
+    uint64_t timestamp   = pFrag->s_header.s_timestamp;
+    if (pFrag->s_header.s_barrier) {
+      m_sawBarrier = true;
+    } else if (timestamp <= m_bound) {
+      heads.push(Head(Key(timestamp, m_queues[i].first), i));
+    }
+  }
+}
+/**
+ * worker
+ *   Thread entry point: perform jobs until told to exit.
+ */
+void*
+CFragmentHandler::SortShard::worker(void* pArg)
+{
+  SortShard* pShard = reinterpret_cast<SortShard*>(pArg);
+  pShard->m_lock.lock();
+  while (1) {
+    while (pShard->m_job == Idle) {
+      pShard->m_changed.wait(pShard->m_lock);
+    }
+    Job job = pShard->m_job;
+    if (job == Exit) break;
+
+    pShard->m_lock.unlock();
+    pShard->perform(job);
+    pShard->m_lock.lock();
+
+    pShard->m_job = Idle;
+    pShard->m_changed.broadcast();
+  }
+  pShard->m_lock.unlock();
+  return 0;
+}
+
 /*--------------------------------------------------------------------------
  ** Creationals: Note this is a singleton, constructors are private.
  */
@@ -88,7 +331,8 @@ static void dumpFragment(EVB::pFragment p) {
  *   - m_pInstance -> this.
  */
 CFragmentHandler::CFragmentHandler() :
-  m_outputThread(*(new COutputThread()))
+  m_outputThread(*(new COutputThread())),
+  m_nNextShard(0)
 
 {
     m_outputThread.start();
@@ -98,6 +342,7 @@ CFragmentHandler::CFragmentHandler() :
     resetTimestamps();
 
     m_nNow = time(NULL);	// Initialize the time.
+    m_nNowNs = CLatencyHistogram::nowNs();
     m_nOldestReceived = INT32_MAX; // Hopefully that makes it infinitely future.
 
     // Start the idle poll off:
@@ -110,6 +355,7 @@ CFragmentHandler::CFragmentHandler() :
     m_nXoffLimit = defaultXoffLimit;
     m_fXoffed    = false;
     m_nTotalFragmentSize = 0;
+    m_nSourceCreditLimit = defaultSourceCreditLimit;
 }
 /**
  * Destructor - for now just kill off the timer -- don't worry about
@@ -118,6 +364,7 @@ CFragmentHandler::CFragmentHandler() :
 CFragmentHandler::~CFragmentHandler()
 {
     Tcl_DeleteTimerHandler(m_timer);
+    stopShards();
 }
 
 /**
@@ -170,6 +417,7 @@ void
 CFragmentHandler::addFragments(size_t nSize, EVB::pFlatFragment pFragments)
 {
     m_nNow = time(NULL);
+    m_nNowNs = CLatencyHistogram::nowNs();   // Arrival time of all these fragments.
     if (m_nNow < m_nOldestReceived) {
       m_nOldestReceived = m_nNow; // Really done first time.
       m_nMostRecentlyEmptied = m_nNow;
@@ -180,6 +428,10 @@ CFragmentHandler::addFragments(size_t nSize, EVB::pFlatFragment pFragments)
     }
    int frags = 0;
    int srcid = -1;
+    if (!m_shards.empty()) {
+      addFragmentsSharded(nSize, pFragments);
+      nSize = 0;
+    }
     while (nSize) {
       EVB::pFragmentHeader pHeader = &(pFragments->s_header);
       frags++;
@@ -215,6 +467,113 @@ CFragmentHandler::addFragments(size_t nSize, EVB::pFlatFragment pFragments)
       flushQueues();		// flush events with received time stamps older than m_nNow - m_nBuildWindow
     }
     checkXoff();
+    checkCredits();
+}
+/**
+ * addFragmentsSharded
+ *   addFragments when there are sort shards.  This thread makes sure the
+ *   source queues exist and divides the fragments among the shards, which
+ *   queue them in parallel.  Anomalies are reported and the global
+ *   bookkeeping done once the shards are finished.
+ *
+ * @param nSize      - Number of bytes of fragments.
+ * @param pFragments - Pointer to the first fragment.
+ *
+ * @throw std::string - The fragment sizes are inconsistent with nSize.
+ *        In that case none of the fragments are queued.
+ */
+void
+CFragmentHandler::addFragmentsSharded(size_t nSize, EVB::pFlatFragment pFragments)
+{
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->m_ingest.clear();
+  }
+  size_t index = 0;
+  while (nSize) {
+    EVB::pFragmentHeader pHeader = &(pFragments->s_header);
+    size_t fragmentSize = totalFragmentSize(pHeader);
+    if (fragmentSize > nSize) {
+      for (size_t i = 0; i < m_shards.size(); i++) {
+        m_shards[i]->m_ingest.clear();
+      }
+      std::stringstream s;
+      s << "Last fragment has too many bytes: " << nSize
+        << " bytes in fragment group but " << fragmentSize
+        << " bytes are in the last fragment!";
+      throw s.str();
+    }
+    SourceQueue& queue(getSourceQueue(pHeader->s_sourceId));
+    SortShard::IngestItem item = {index++, pFragments, &queue};
+    m_shards[queue.s_shard]->m_ingest.push_back(item);
+    m_liveSources.insert(pHeader->s_sourceId);
+
+    lastHeader = *pHeader;
+    first      = false;
+
+    char* pNext = reinterpret_cast<char*>(pFragments);
+    pNext      += fragmentSize;
+    pFragments  = reinterpret_cast<EVB::pFlatFragment>(pNext);
+    nSize      -= fragmentSize;
+  }
+  runShards(SortShard::Ingest);
+
+  std::vector<InputAnomaly> anomalies;
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    SortShard& shard(*m_shards[i]);
+    if (shard.m_ingest.empty()) continue;
+
+    anomalies.insert(
+      anomalies.end(), shard.m_anomalies.begin(), shard.m_anomalies.end()
+    );
+    if (shard.m_oldest < m_nOldest) m_nOldest = shard.m_oldest;
+    if (shard.m_newest > m_nNewest) m_nNewest = shard.m_newest;
+    m_nFragmentsLastPeriod += shard.m_ingest.size();
+    m_nTotalFragmentSize   += shard.m_ingest.size();
+    shard.m_ingest.clear();
+  }
+  std::sort(
+    anomalies.begin(), anomalies.end(),
+    [](const InputAnomaly& a, const InputAnomaly& b) { return a.s_index < b.s_index; }
+  );
+  reportAnomalies(anomalies);
+}
+/**
+ * setShardCount
+ *
+ *   Set the number of sort shards.  With more than one shard the source
+ *   queues are divided among that many threads which queue and sort their
+ *   fragments in parallel.  Observers are still called from this thread.
+ *
+ * @param nShards - Number of shards; 0 or 1 sort on this thread only.
+ *
+ * @throw std::string - a shard thread could not be started.
+ */
+void
+CFragmentHandler::setShardCount(unsigned nShards)
+{
+  stopShards();
+  if (nShards > 1) {
+    try {
+      for (unsigned i = 0; i < nShards; i++) {
+        m_shards.push_back(new SortShard(*this));
+      }
+    }
+    catch (...) {
+      stopShards();
+      throw;
+    }
+    assignShards();
+  }
+}
+/**
+ * getShardCount
+ *
+ * @return unsigned - Number of sort shards (1 if sorting is serial).
+ */
+unsigned
+CFragmentHandler::getShardCount() const
+{
+  return m_shards.empty() ? 1 : m_shards.size();
 }
 /**
  * setBuildWindow
@@ -290,6 +649,31 @@ void
 CFragmentHandler::setXoffThreshold(size_t nBytes) {
     m_nXoffLimit = nBytes;
 }
+/**
+ * setSourceCreditLimit
+ *    Sets the number of fragment body bytes each source may have queued.
+ *    Sockets with a source over this budget stop being read unless the
+ *    merge needs their data (see checkCredits).
+ *
+ * @param nBytes - the per source budget.  0 turns per source flow control
+ *                 off (throttled sockets are released).
+ */
+void
+CFragmentHandler::setSourceCreditLimit(size_t nBytes)
+{
+    m_nSourceCreditLimit = nBytes;
+    checkCredits();
+}
+/**
+ * getSourceCreditLimit
+ *
+ * @return size_t - the per source byte budget (0 if there is none).
+ */
+size_t
+CFragmentHandler::getSourceCreditLimit() const
+{
+    return m_nSourceCreditLimit;
+}
 
 /**
  * addObserver
@@ -519,6 +903,35 @@ CFragmentHandler::removeFlowControlObserver(FlowControlObserver* pObserver)
     }
 }
 
+/**
+ * addSourceFlowObserver
+ *   Adds an observer of per source flow control.  These observers are
+ *   told which sockets to stop and start reading.
+ *
+ * @param pObserver - pointer to the observer to add.
+ */
+void
+CFragmentHandler::addSourceFlowObserver(SourceFlowObserver* pObserver)
+{
+    m_sourceFlowObservers.push_back(pObserver);
+}
+/**
+ * removeSourceFlowObserver
+ *   Remove an observer added by addSourceFlowObserver.
+ *
+ * @param pObserver - The observer to remove.
+ */
+void
+CFragmentHandler::removeSourceFlowObserver(SourceFlowObserver* pObserver)
+{
+    std::list<SourceFlowObserver*>::iterator p =
+        std::find(m_sourceFlowObservers.begin(), m_sourceFlowObservers.end(),
+                  pObserver);
+    if (p != m_sourceFlowObservers.end()) {
+        m_sourceFlowObservers.erase(p);
+    }
+}
+
 /**
  * addNonMonotonicTimestampObserver
  *   Add an observer that is called if an input queue has a timestamp that is
@@ -613,6 +1026,38 @@ CFragmentHandler::Xoff()
         }
         m_fXoffed = true;
 }
+/**
+ * throttleSocket
+ *   Tell the source flow observers to stop reading a socket.
+ *
+ * @param sockName - the socket.
+ */
+void
+CFragmentHandler::throttleSocket(std::string sockName)
+{
+    m_throttledSockets.insert(sockName);
+    std::list<SourceFlowObserver*>::iterator p = m_sourceFlowObservers.begin();
+    while (p != m_sourceFlowObservers.end()) {
+        (*p)->throttle(sockName);
+        p++;
+    }
+}
+/**
+ * releaseSocket
+ *   Tell the source flow observers to read a socket again.
+ *
+ * @param sockName - the socket.
+ */
+void
+CFragmentHandler::releaseSocket(std::string sockName)
+{
+    m_throttledSockets.erase(sockName);
+    std::list<SourceFlowObserver*>::iterator p = m_sourceFlowObservers.begin();
+    while (p != m_sourceFlowObservers.end()) {
+        (*p)->release(sockName);
+        p++;
+    }
+}
 
 
 /**
@@ -649,6 +1094,9 @@ CFragmentHandler::flush()
  *                        # s_queueId - Source id of the queue.
  *                        # s_queueDepth - number of fragments in the queue.
  *                        # s_oldestElement - Timestamp at head of queue.
+ *                        # s_credit - bytes left in the source's budget.
+ *                        # s_throttled - true if the source's socket is
+ *                          not being read.
  */
 CFragmentHandler::InputStatistics
 CFragmentHandler::getStatistics()
@@ -660,16 +1108,79 @@ CFragmentHandler::getStatistics()
     result.s_oldestFragment = m_nOldest;
     result.s_newestFragment = m_nNewest;
     
-    QueueStatGetter statGetter;
+    QueueStatGetter statGetter(m_nSourceCreditLimit);
     
     statGetter = for_each(m_FragmentQueues.begin(), m_FragmentQueues.end(), statGetter);
     
     result.s_totalQueuedFragments = statGetter.totalFragments();
     result.s_queueStats           = statGetter.queueStats();
     
+    // Mark the sources whose sockets are throttled:
+    
+    for (std::set<std::string>::iterator s = m_throttledSockets.begin();
+         s != m_throttledSockets.end(); s++) {
+        std::list<uint32_t>& ids(m_socketSources[*s]);
+        for (size_t i = 0; i < result.s_queueStats.size(); i++) {
+            QueueStatistics& stats(result.s_queueStats[i]);
+            if (std::find(ids.begin(), ids.end(), stats.s_queueId) != ids.end()) {
+                stats.s_throttled = true;
+            }
+        }
+    }
+    
+    return result;
+}
+/**
+ * getLatencyStatistics
+ *
+ *   Return the latency histograms maintained by the orderer.  This is
+ *   intended for the GUI and the EVB::latencystats command.
+ *
+ *   @return CFragmentHandler::LatencyStatistics
+ *   @retval struct with:
+ *   - s_batchSize       - Histogram of the number of fragments per output batch.
+ *   - s_timestampSpread - Histogram of newest-oldest timestamp in each batch.
+ *   - s_sources         - per source histograms of the time (ns) fragments
+ *                         spent in the source queue (s_residence) and from
+ *                         receipt until the output observers were done
+ *                         with them (s_ingestToEmit).
+ */
+CFragmentHandler::LatencyStatistics
+CFragmentHandler::getLatencyStatistics()
+{
+    LatencyStatistics result;
+    result.s_batchSize       = m_batchSizes.snapshot();
+    result.s_timestampSpread = m_timestampSpreads.snapshot();
+    
+    std::map<uint32_t, CLatencyHistogram::Snapshot> emitted =
+        m_outputThread.getIngestToEmit();
     
+    for (Sources::iterator p = m_FragmentQueues.begin();
+         p != m_FragmentQueues.end(); p++) {
+        SourceLatencyStatistics source;
+        source.s_sourceId  = p->first;
+        source.s_residence = p->second.s_residence.snapshot();
+        source.s_ingestToEmit = emitted[p->first];   // Empty if none yet.
+        
+        result.s_sources.push_back(source);
+    }
     return result;
 }
+/**
+ * clearLatencyStatistics
+ *    Zero all of the latency histograms.
+ */
+void
+CFragmentHandler::clearLatencyStatistics()
+{
+    m_batchSizes.clear();
+    m_timestampSpreads.clear();
+    for (Sources::iterator p = m_FragmentQueues.begin();
+         p != m_FragmentQueues.end(); p++) {
+        p->second.s_residence.clear();
+    }
+    m_outputThread.clearIngestToEmit();
+}
 /**
  * createSourceQueue
  *
@@ -744,6 +1255,7 @@ CFragmentHandler::markSocketFailed(std::string sockName)
 
     m_deadSockets[sockName] = p->second;
     m_socketSources.erase(p);
+    m_throttledSockets.erase(sockName);   // Nothing left to read.
   } else {
     std::string msg = sockName;
     msg += " is not a known socket to the fragment handler";
@@ -817,6 +1329,9 @@ CFragmentHandler::resetTimestamps()
 void
 CFragmentHandler::clearQueues()
 {
+  while (!m_throttledSockets.empty()) {
+    releaseSocket(*m_throttledSockets.begin());
+  }
   m_deadSockets.clear();
   m_socketSources.clear();
   m_liveSources.clear();
@@ -829,10 +1344,14 @@ CFragmentHandler::clearQueues()
     while (!q.s_queue.empty()) {
       delete q.s_queue.front().second;
       q.s_queue.pop();
-      
+      q.s_arrivals.pop();
     }
   }
   m_FragmentQueues.clear();
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->m_queues.clear();
+  }
+  m_nNextShard = 0;
 }
 
 /*---------------------------------------------------------------------
@@ -858,14 +1377,18 @@ CFragmentHandler::flushQueues(bool completely)
 {
  loop: 			// avoid recursion with a good old fashioned goto.
   
+  m_nNowNs = CLatencyHistogram::nowNs(); // Dequeue time for residence statistics.
 
 
   // Ensure there's at least one fragment available:
 
 
   std::vector<EVB::pFragment>& sortedFragments(*(new std::vector<EVB::pFragment>));
-  while (noEmptyQueue() // || (m_nNow - m_nOldestReceived > m_nBuildWindow)
-	  || completely ) {
+  if (!m_shards.empty()) {
+    popSharded(completely, sortedFragments);
+  }
+  while (m_shards.empty() && (noEmptyQueue() // || (m_nNow - m_nOldestReceived > m_nBuildWindow)
+	  || completely )) {
     if (queuesEmpty()) break;	// Done if there are no more frags.
     std::pair<time_t, ::EVB::pFragment>* p = popOldest();
     if (p) {
@@ -891,6 +1414,7 @@ CFragmentHandler::flushQueues(bool completely)
   findOldest();     // Previous code could have made oldest uh.. newer.
   time_t firstOldest = m_nOldestReceived;
   m_nNow = time(NULL);
+  m_nNowNs = CLatencyHistogram::nowNs();
   if ((m_nNow - m_nOldestReceived) >= m_nBuildWindow) {
     while (!queuesEmpty() && ((m_nNow - m_nOldestReceived) >= m_nBuildWindow) ) {
       std::pair<time_t, ::EVB::pFragment>* p = popOldest();
@@ -927,6 +1451,7 @@ CFragmentHandler::flushQueues(bool completely)
   // If XOFed and below the low water mark, XON:
   
   checkXon();
+  checkCredits();
 
   
   // If a barrier is pending check it and, if the flush was complete,
@@ -944,6 +1469,154 @@ CFragmentHandler::flushQueues(bool completely)
 }
     
 
+/**
+ * popSharded
+ *
+ *   The first phase of flushQueues when there are sort shards.  Only
+ *   fragments that are no newer than the newest fragment of the queue that
+ *   will be emptied first can be output (all of them on a complete flush).
+ *   Queues with barriers can't be emptied so they don't limit this.  Each
+ *   shard sorts the fragments from its queues in parallel, and the sorted
+ *   runs are then merged here.
+ *
+ * @param completely      - A complete flush is being done.
+ * @param sortedFragments - The fragments are appended to this in order.
+ */
+void
+CFragmentHandler::popSharded(bool completely, std::vector<EVB::pFragment>& sortedFragments)
+{
+  uint64_t bound = UINT64_MAX;
+  if (!completely) {
+    for (Sources::iterator p = m_FragmentQueues.begin(); p != m_FragmentQueues.end(); p++) {
+      SourceQueue& queue(p->second);
+      if (queue.s_queue.empty()) return;       // Nothing can be ordered yet.
+      if (queue.s_barriers == 0) {
+        uint64_t newest = queue.s_queue.back().second->s_header.s_timestamp;
+        if (newest < bound) bound = newest;
+      }
+    }
+  }
+  if (queuesEmpty()) return;
+
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    SortShard& shard(*m_shards[i]);
+    shard.m_bound      = bound;
+    shard.m_emptied    = false;
+    shard.m_sawBarrier = false;
+    shard.m_sorted.clear();
+  }
+  runShards(SortShard::Sort);
+
+  // Merge the shards' runs:
+
+  // Sources are dealt to shards round robin, so timestamp ties must be
+  // broken by source id, not shard, to match the serial order.
+
+  typedef std::pair<uint64_t, uint32_t> Key; // Timestamp, source id.
+  typedef std::pair<Key, size_t> Head;       // Key, shard index.
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+  std::vector<size_t> next(m_shards.size(), 0);
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    SortShard& shard(*m_shards[i]);
+    if (!shard.m_sorted.empty()) {
+      SortedFragment& first(shard.m_sorted.front());
+      heads.push(Head(Key(first.s_timestamp, first.s_sourceId), i));
+    }
+    if (shard.m_emptied)    m_nMostRecentlyEmptied = time(NULL);
+    if (shard.m_sawBarrier) m_fBarrierPending      = true;
+  }
+  while (!heads.empty()) {
+    size_t i = heads.top().second;
+    heads.pop();
+
+    std::vector<SortedFragment>& run(m_shards[i]->m_sorted);
+    SortedFragment& fragment(run[next[i]++]);
+    if (fragment.s_timestamp < m_nMostRecentlyPopped) {
+      dataLate(*(fragment.s_pFragment));
+    } else {
+      m_nMostRecentlyPopped = fragment.s_timestamp;
+    }
+    m_nTotalFragmentSize--;
+    sortedFragments.push_back(fragment.s_pFragment);
+    m_batchArrivals.push_back(fragment.s_arrival);
+
+    if (next[i] < run.size()) {
+      SortedFragment& following(run[next[i]]);
+      heads.push(Head(Key(following.s_timestamp, following.s_sourceId), i));
+    }
+  }
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->m_sorted.clear();
+  }
+}
+/**
+ * runShards
+ *
+ *   Have the sort shards with something to do perform a job.  The last
+ *   of them does it on this thread rather than sitting idle waiting for
+ *   the others.  Returns when all shards are done.
+ *
+ * @param job - SortShard::Ingest or SortShard::Sort.
+ */
+void
+CFragmentHandler::runShards(int job)
+{
+  SortShard::Job shardJob = static_cast<SortShard::Job>(job);
+  std::vector<SortShard*> busy;
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    SortShard* pShard = m_shards[i];
+    bool hasWork = (shardJob == SortShard::Ingest) ?
+      !pShard->m_ingest.empty() : !pShard->m_queues.empty();
+    if (hasWork) busy.push_back(pShard);
+  }
+  if (busy.empty()) return;
+
+  for (size_t i = 0; i < busy.size() - 1; i++) {
+    busy[i]->post(shardJob);
+  }
+  busy.back()->perform(shardJob);
+  for (size_t i = 0; i < busy.size() - 1; i++) {
+    busy[i]->wait();
+  }
+}
+/**
+ * assignShards
+ *
+ *   Deal the existing source queues out to the sort shards in source id
+ *   order.
+ */
+void
+CFragmentHandler::assignShards()
+{
+  m_nNextShard = 0;
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    m_shards[i]->m_queues.clear();
+  }
+  for (Sources::iterator p = m_FragmentQueues.begin(); p != m_FragmentQueues.end(); p++) {
+    p->second.s_shard = m_nNextShard++ % m_shards.size();
+    m_shards[p->second.s_shard]->m_queues.push_back(
+      std::pair<uint32_t, SourceQueue*>(p->first, &(p->second))
+    );
+  }
+}
+/**
+ * stopShards
+ *
+ *   Stop and destroy the sort shards.  The queues are then sorted
+ *   serially again.
+ */
+void
+CFragmentHandler::stopShards()
+{
+  for (size_t i = 0; i < m_shards.size(); i++) {
+    delete m_shards[i];
+  }
+  m_shards.clear();
+  m_nNextShard = 0;
+  for (Sources::iterator p = m_FragmentQueues.begin(); p != m_FragmentQueues.end(); p++) {
+    p->second.s_shard = 0;
+  }
+}
 /**
  * popOldest
  *
@@ -1006,6 +1679,7 @@ CFragmentHandler::popOldest()
       pOldestQ->second.s_bytesDeQd          += oldestFrag.second->s_header.s_size;
       pOldestQ->second.s_bytesInQ           -= oldestFrag.second->s_header.s_size;
       pOldestQ->second.s_queue.pop();
+      dequeueArrival(pOldestQ->second);
 
       // If this queue has been emptied mark that time:
 
@@ -1025,6 +1699,26 @@ CFragmentHandler::popOldest()
 
 }
 
+/**
+ * dequeueArrival
+ *
+ *   Called when the front fragment of a source queue is popped to
+ *   pop its arrival time as well.  The queue residence time is histogrammed
+ *   and the arrival time is saved for the batch being built so that the
+ *   output thread can compute the ingest to emit latency.
+ *
+ *  @param queue - the source queue that was just popped.
+ */
+void
+CFragmentHandler::dequeueArrival(SourceQueue& queue)
+{
+    uint64_t arrived = queue.s_arrivals.front();
+    queue.s_arrivals.pop();
+    
+    queue.s_residence.add(m_nNowNs > arrived ? m_nNowNs - arrived : 0);
+    m_batchArrivals.push_back(arrived);
+}
+
 /**
  * observe
  *
@@ -1040,7 +1734,37 @@ CFragmentHandler::popOldest()
 void
 CFragmentHandler::observe(std::vector<EVB::pFragment>& event)
 {
-    m_outputThread.queueFragments(&event);
+    // Batch statistics:  the timestamp spread ignores fragments without
+    // timestamps:
+
+    std::vector<uint64_t>* pArrivals = 0;
+    if (!event.empty()) {
+      m_batchSizes.add(event.size());
+      
+      uint64_t oldest = UINT64_MAX;
+      uint64_t newest = 0;
+      for (int i = 0; i < event.size(); i++) {
+        uint64_t stamp = event[i]->s_header.s_timestamp;
+        if (stamp != NULL_TIMESTAMP) {
+          if (stamp < oldest) oldest = stamp;
+          if (stamp > newest) newest = stamp;
+        }
+      }
+      if (oldest <= newest) {
+        m_timestampSpreads.add(newest - oldest);
+      }
+      // The arrival times go with the fragments so the output thread can
+      // figure out the ingest to emit latencies.  They should always
+      // line up with the event but if they don't no harm is done:
+      
+      if (m_batchArrivals.size() == event.size()) {
+        pArrivals = new std::vector<uint64_t>;
+        pArrivals->swap(m_batchArrivals);
+      }
+    }
+    m_batchArrivals.clear();
+    
+    m_outputThread.queueFragments(&event, pArrivals);
 }
 /**
  * dataLate
@@ -1082,40 +1806,107 @@ CFragmentHandler::dataLate(const ::EVB::Fragment& fragment)
 void
 CFragmentHandler::addFragment(EVB::pFlatFragment pFragment)
 {
-    bool     assigned            = false;
     uint64_t priorOldest         = m_nOldest;
 
     m_nFragmentsLastPeriod++;	//  We were not idle.
 
+    // Get a reference to the fragment queue, creating it if needed
+    // and queue the fragment:
+    
+    EVB::pFragmentHeader pHeader = &pFragment->s_header;
+    SourceQueue& destQueue(getSourceQueue(pHeader->s_sourceId));
+
+    std::vector<InputAnomaly> anomalies;
+    enqueueFragment(destQueue, pFragment, 0, anomalies);
+    reportAnomalies(anomalies);
+
+    EVB::pFragment pFrag         = destQueue.s_queue.back().second;
+    uint64_t timestamp           = pFrag->s_header.s_timestamp;
+    
+    m_liveSources.insert(pHeader->s_sourceId); // having a fragment makes a source live.
+    
+    // update newest/oldest if needed -- and not a barrier:
+    // 
+    // Since data can come out of order across sources it's possible
+    // to update oldest as well as newest.
+
+    // If the timing of receiving this fragment would result in an
+    // out of order fragment, it's late:
+    //
+
+    
+    if ((timestamp < m_nOldest)) {
+	if ((m_nOldest - timestamp) > 0x100000000ll && (m_nOldest != 0xffffffffffffffff)) {
+	  std::cerr << "addFragment... timestamp taking a big step back from : " << std::hex
+		    << m_nOldest << " to " << timestamp << std::dec << std::endl;
+	}
+#ifdef DEBUG
+	std::cerr << "add fragment decreasing oldest timestamp from: "
+		  << std::hex << m_nOldest << " to: " 
+		  << timestamp << std::dec << std::endl;
+#endif
+	m_nOldest = timestamp;
+    }
+    
+    if (timestamp > m_nNewest) m_nNewest = timestamp;
+#ifdef DEBUG
+
+    if ((priorOldest != m_nOldest) && (m_nOldest == 0)) {
+      std::cerr << "addFragment assigned m_nOldest -> 0 was: " 
+		<< std::hex << priorOldest << std::dec << std::endl;
+      dumpFragment(pFrag);
+      
+    }
+#endif
+    // Tally the fragment size and Xoff if the high water mark was hit:
+    
+    m_nTotalFragmentSize++;
+
+
+}
+/**
+ * enqueueFragment
+ *
+ *   Copy a fragment into its source queue.  Null timestamps are assigned
+ *   and the source's queue statistics are updated.  Duplicate and
+ *   out of order timestamps are not observed here but appended to
+ *   anomalies so that this can be done by a sort shard thread.  Only
+ *   destQueue is modified.
+ *
+ * @param destQueue - The queue for the fragment's source.
+ * @param pFragment - Pointer to the flattened fragment.
+ * @param index     - Position of the fragment in its batch; copied into
+ *                    the anomalies.
+ * @param anomalies - Anomalies are appended here.
+ */
+void
+CFragmentHandler::enqueueFragment(
+    SourceQueue& destQueue, EVB::pFlatFragment pFragment, size_t index,
+    std::vector<InputAnomaly>& anomalies
+)
+{
+    bool     assigned            = false;
+
     // Allocate the fragmentand copy it:
     
     EVB::pFragmentHeader pHeader = &pFragment->s_header;
     EVB::pFragment pFrag         = allocateFragment(pHeader); // Copies the header.
     uint64_t timestamp           = pHeader->s_timestamp;
-    bool     isBarrier           = pHeader->s_barrier != 0;
 
     memcpy(pFrag->s_pBody, pFragment->s_body, pFrag->s_header.s_size);
 
-    // Get a reference to the fragment queue, creating it if needed:
-    
-    SourceQueue& destQueue(getSourceQueue(pHeader->s_sourceId));
-
-
     // If the timestamp is null, assign the newest timestamp from that source to it:
 
     if ((timestamp == NULL_TIMESTAMP)) {
-      assigned = true;
       timestamp = destQueue.s_newestTimestamp;
       pFrag->s_header.s_timestamp = timestamp;             // Avoid duplicate.
       assigned = true;
 #ifdef DEBUG
       std::cerr << "Assigned timestamp " << std::hex << timestamp << std::dec << std::endl;
 #endif
-    } else {
-      if ((pFrag->s_header.s_timestamp - timestamp) > uint64_t(0x100000000ll)) {
-	std::cerr << "orderer: Big timestamp jump last: 0x" << std::hex
-		  << timestamp << " Next: 0x" << pFrag->s_header.s_timestamp << std::endl;
-      }
+    }
+    if (!assigned) {
+      CPipelineTrace::hop(CPipelineTrace::OrdererIngest, timestamp);
     }
     /*
      Bug #4516 - avoid counting duplicate timestamps if the timestamp was
@@ -1125,7 +1916,10 @@ CFragmentHandler::addFragment(EVB::pFlatFragment pFragment)
        assigned timestamps... because queue s_newestTimestamp is initialized to 0.
     */
     if ((timestamp == destQueue.s_newestTimestamp) && (!assigned)) {
-      observeDuplicateTimestamp(pHeader->s_sourceId, timestamp);  
+      InputAnomaly duplicate = {
+        index, true, pHeader->s_sourceId, timestamp, timestamp
+      };
+      anomalies.push_back(duplicate);
     }
     
     // Update stastistics:
@@ -1134,74 +1928,51 @@ CFragmentHandler::addFragment(EVB::pFlatFragment pFragment)
     destQueue.s_bytesInQ       += pFrag->s_header.s_size;     // Only count payloads.
     destQueue.s_totalBytesQd   += pFrag->s_header.s_size;     // Total bytes into the queue.
     
-    
     // Before we push the queue element, see if we need to observe a bad
     // timestamop:
     
-    
-    
-    
-    
     uint64_t newTimestamp   = pFrag->s_header.s_timestamp;
     uint64_t priorTimestamp =
         destQueue.s_lastTimestamp;
     
     if (newTimestamp < priorTimestamp) {
-        observeOutOfOrderInput(pHeader->s_sourceId, priorTimestamp, newTimestamp);
+      InputAnomaly outOfOrder = {
+        index, false, pHeader->s_sourceId, priorTimestamp, newTimestamp
+      };
+      anomalies.push_back(outOfOrder);
     }
 
     destQueue.s_queue.push(std::pair<time_t, EVB::pFragment>(m_nNow, pFrag));
+    destQueue.s_arrivals.push(m_nNowNs);
     destQueue.s_lastTimestamp = newTimestamp;
-    
-    
-    m_liveSources.insert(pHeader->s_sourceId); // having a fragment makes a source live.
-    
-    // update newest/oldest if needed -- and not a barrier:
-    // 
-    // Since data can come out of order across sources it's possible
-    // to update oldest as well as newest.
-
-    // If the timing of receiving this fragment would result in an
-    // out of order fragment, it's late:
-    //
-
-    
-    if ((timestamp < m_nOldest)) {
-	if ((m_nOldest - timestamp) > 0x100000000ll && (m_nOldest != 0xffffffffffffffff)) {
-	  std::cerr << "addFragment... timestamp taking a big step back from : " << std::hex
-		    << m_nOldest << " to " << timestamp << std::dec << std::endl;
-	}
-#ifdef DEBUG
-	std::cerr << "add fragment decreasing oldest timestamp from: "
-		  << std::hex << m_nOldest << " to: " 
-		  << timestamp << std::dec << std::endl;
-#endif
-	m_nOldest = timestamp;
+    if (pFrag->s_header.s_barrier) {
+      destQueue.s_barriers++;
     }
-    // Queue out of order fragment?
-    if (!destQueue.s_queue.empty()) {
-      if (timestamp < destQueue.s_newestTimestamp) {
+}
+/**
+ * reportAnomalies
+ *
+ *   Fire the duplicate and out of order timestamp observers for the
+ *   anomalies enqueueFragment found.  Out of order timestamps are also
+ *   logged to stderr.  This runs in the caller's thread for both the
+ *   serial and sharded paths.
+ *
+ * @param anomalies - The anomalies in the order they should be reported.
+ */
+void
+CFragmentHandler::reportAnomalies(const std::vector<InputAnomaly>& anomalies)
+{
+    for (size_t i = 0; i < anomalies.size(); i++) {
+      const InputAnomaly& a(anomalies[i]);
+      if (a.s_duplicate) {
+        observeDuplicateTimestamp(a.s_sourceId, a.s_timestamp);
+      } else {
 	std::cerr << "Queue timestamp took a jump backwards from : "
-		  << std::hex << destQueue.s_newestTimestamp
-		  << " to " << timestamp << std::dec << std::endl;
+		  << std::hex << a.s_prior
+		  << " to " << a.s_timestamp << std::dec << std::endl;
+        observeOutOfOrderInput(a.s_sourceId, a.s_prior, a.s_timestamp);
       }
     }
-    
-    if (timestamp > m_nNewest) m_nNewest = timestamp;
-#ifdef DEBUG
-
-    if ((priorOldest != m_nOldest) && (m_nOldest == 0)) {
-      std::cerr << "addFragment assigned m_nOldest -> 0 was: " 
-		<< std::hex << priorOldest << std::dec << std::endl;
-      dumpFragment(pFrag);
-      
-    }
-#endif
-    // Tally the fragment size and Xoff if the high water mark was hit:
-    
-    m_nTotalFragmentSize++;
-
-
 }
 /**
  * totalFragmentSize
@@ -1271,8 +2042,8 @@ CFragmentHandler::noEmptyQueue()
 /**
  * Construction sets the total fragment count to zero.
  */
-CFragmentHandler::QueueStatGetter::QueueStatGetter() :
-  m_nTotalFragments(0)
+CFragmentHandler::QueueStatGetter::QueueStatGetter(size_t creditLimit) :
+  m_nTotalFragments(0), m_nCreditLimit(creditLimit)
 {}
 
 
@@ -1295,6 +2066,9 @@ CFragmentHandler::QueueStatGetter::operator()(SourceElementV& source)
     stats.s_queuedBytes       = sourceQ.s_bytesInQ;
     stats.s_dequeuedBytes     = sourceQ.s_bytesDeQd;
     stats.s_totalQueuedBytes  = sourceQ.s_totalBytesQd;
+    stats.s_credit            = (m_nCreditLimit > sourceQ.s_bytesInQ) ?
+                                m_nCreditLimit - sourceQ.s_bytesInQ : 0;
+    stats.s_throttled         = false;
     
     m_nTotalFragments += stats.s_queueDepth;
     m_Stats.push_back(stats);
@@ -1347,18 +2121,20 @@ CFragmentHandler::generateBarrier(std::vector<EVB::pFragment>& outputList)
 
 
   BarrierSummary result;
-
+  m_nNowNs = CLatencyHistogram::nowNs();
 
   
   for (Sources::iterator p = m_FragmentQueues.begin(); p!= m_FragmentQueues.end(); p++) {
     if (!p->second.s_queue.empty()) {
       ::EVB::pFragment pFront = p->second.s_queue.front().second;
-      p->second.s_lastPoppedTimestamp = pFront->s_header.s_timestamp;
-      p->second.s_bytesDeQd           += pFront->s_header.s_size;
-      p->second.s_bytesInQ            -= pFront->s_header.s_size;
       if (pFront->s_header.s_barrier) {
+	p->second.s_lastPoppedTimestamp = pFront->s_header.s_timestamp;
+	p->second.s_bytesDeQd           += pFront->s_header.s_size;
+	p->second.s_bytesInQ            -= pFront->s_header.s_size;
 	outputList.push_back(pFront);
 	p->second.s_queue.pop();
+	p->second.s_barriers--;
+	dequeueArrival(p->second);
 	result.s_typesPresent.push_back(
             std::pair<uint32_t, uint32_t>(p->first, uint32_t(pFront->s_header.s_barrier))
         );
@@ -1537,6 +2313,19 @@ CFragmentHandler::getSourceQueue(uint32_t id)
   Sources::iterator p = m_FragmentQueues.find(id);
   if (p  == m_FragmentQueues.end()) {	       // Need to create.
     SourceQueue& queue = m_FragmentQueues[id]; // Does most of the creation.
+    if (!m_shards.empty()) {                    // Deal it to a sort shard.
+      queue.s_shard = m_nNextShard++ % m_shards.size();
+      std::vector<std::pair<uint32_t, SourceQueue*> >& shardQueues(
+        m_shards[queue.s_shard]->m_queues
+      );
+      shardQueues.insert(
+        std::lower_bound(
+          shardQueues.begin(), shardQueues.end(),
+          std::pair<uint32_t, SourceQueue*>(id, 0)
+        ),
+        std::pair<uint32_t, SourceQueue*>(id, &queue)
+      );
+    }
     return queue;
   }  else {			              // already exists.
     return p->second;
@@ -1660,6 +2449,7 @@ CFragmentHandler::IdlePoll(ClientData data)
   // allows that to accept data again:
 
   pHandler->checkXon();
+  pHandler->checkCredits();
 
 
   // reschedule
@@ -1698,3 +2488,59 @@ CFragmentHandler::checkXoff()
     Xon();
   }
 }
+/**
+ * checkCredits
+ *    Per source flow control.  Each source may have m_nSourceCreditLimit
+ *    bytes of fragment bodies queued.  A socket with a source over that
+ *    budget is throttled, unless one of its sources is needed to advance
+ *    the merge: its queue is empty, or it is the lagging source (the live
+ *    source with the oldest newest timestamp).  Throttling the leading
+ *    sources this way lets the lagging ones keep sending.  A throttled
+ *    socket is released once it's needed or all of its sources are below
+ *    3/4 of the budget.
+ */
+void
+CFragmentHandler::checkCredits()
+{
+  if (!m_nSourceCreditLimit) {
+    while (!m_throttledSockets.empty()) {
+      releaseSocket(*m_throttledSockets.begin());
+    }
+    return;
+  }
+  size_t releaseLimit = m_nSourceCreditLimit - m_nSourceCreditLimit/4;
+
+  uint64_t lagging = UINT64_MAX;
+  for (Sources::iterator p = m_FragmentQueues.begin(); p != m_FragmentQueues.end(); p++) {
+    if (m_liveSources.count(p->first) && (p->second.s_newestTimestamp < lagging)) {
+      lagging = p->second.s_newestTimestamp;
+    }
+  }
+
+  std::map<std::string, std::list<uint32_t> >::iterator p = m_socketSources.begin();
+  while (p != m_socketSources.end()) {
+    bool over   = false;
+    bool under  = true;
+    bool needed = false;
+    std::list<uint32_t>::iterator id = p->second.begin();
+    while (id != p->second.end()) {
+      Sources::iterator q = m_FragmentQueues.find(*id);
+      if (q != m_FragmentQueues.end()) {
+        SourceQueue& queue(q->second);
+        if (queue.s_bytesInQ > m_nSourceCreditLimit) over  = true;
+        if (queue.s_bytesInQ >= releaseLimit)        under = false;
+        if (queue.s_queue.empty() || (queue.s_newestTimestamp <= lagging)) {
+          needed = true;
+        }
+      }
+      id++;
+    }
+    bool throttled = m_throttledSockets.count(p->first) != 0;
+    if (!throttled && over && !needed) {
+      throttleSocket(p->first);
+    } else if (throttled && (needed || under)) {
+      releaseSocket(p->first);
+    }
+    p++;
+  }
+}
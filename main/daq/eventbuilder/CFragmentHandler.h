@@ -77,6 +77,10 @@
 
 #include <limits>
 
+#ifndef __CLATENCYHISTOGRAM_H
+#include "CLatencyHistogram.h"
+#endif
+
 class COutputThread;
 
 // Forward definitions:
@@ -126,6 +130,10 @@ private:
     std::uint64_t                                        s_totalBytesQd;
     std::uint64_t                                        s_lastTimestamp;
     std::queue<std::pair<time_t,  EVB::pFragment> > s_queue;
+    std::queue<std::uint64_t>                            s_arrivals;  // nowNs() at enqueue, parallels s_queue.
+    CLatencyHistogram                                    s_residence; // ns fragments spent in s_queue.
+    unsigned                                             s_shard;     // Sort shard that owns the queue.
+    std::uint32_t                                        s_barriers;  // Barrier fragments in s_queue.
     void reset() {
         s_newestTimestamp = 0;
 //        s_lastPoppedTimestamp = std::numeric_limits<std::uint64_t>::max();
@@ -135,7 +143,7 @@ private:
         s_totalBytesQd = 0;
         s_lastTimestamp = 0;
     }
-    _SourceQueue()  {reset();}
+    _SourceQueue() : s_shard(0), s_barriers(0) {reset();}
     
 
   } SourceQueue, *pSourceQueue;
@@ -147,6 +155,29 @@ private:
     std::vector<std::pair<std::uint32_t, std::uint32_t> > s_typesPresent;
     std::vector<std::uint32_t>                        s_missingSources;
   } BarrierSummary, *pBarrierSummary;
+
+  // Input anomalies found while queueing fragments.  When queueing is
+  // done by sort shards these are saved and reported by the interpreter
+  // thread in the order the fragments were received.
+
+  typedef struct _InputAnomaly {
+    size_t        s_index;          // Fragment number within its addFragments batch.
+    bool          s_duplicate;      // Duplicate timestamp else non-monotonic.
+    std::uint32_t s_sourceId;
+    std::uint64_t s_prior;
+    std::uint64_t s_timestamp;
+  } InputAnomaly, *pInputAnomaly;
+
+  // A fragment popped by a sort shard:
+
+  typedef struct _SortedFragment {
+    std::uint64_t  s_timestamp;
+    std::uint32_t  s_sourceId;      // Breaks timestamp ties as popOldest does.
+    EVB::pFragment s_pFragment;
+    std::uint64_t  s_arrival;       // nowNs() when it was queued.
+  } SortedFragment, *pSortedFragment;
+
+  class SortShard;                  // Sort worker thread (see CFragmentHandler.cpp).
   
   // public data types:
 public:
@@ -157,6 +188,8 @@ public:
         size_t     s_queuedBytes;               // Currently queued bytes
         size_t     s_dequeuedBytes;
         size_t     s_totalQueuedBytes;          // bytes queued since last reset.
+        size_t     s_credit;                    // Bytes left in the source's budget (0 if no budgets).
+        bool       s_throttled;                 // Source's socket is not being read.
         
     } QueueStatistics, *pQueueStatistics;
     
@@ -167,6 +200,18 @@ public:
         
         std::vector<QueueStatistics> s_queueStats;
     } InputStatistics, *pInputStatistics;
+    
+    typedef struct _SourceLatencyStatistics {
+        std::uint32_t               s_sourceId;
+        CLatencyHistogram::Snapshot s_residence;     // ns in the source queue.
+        CLatencyHistogram::Snapshot s_ingestToEmit;  // ns from receipt to output observers.
+    } SourceLatencyStatistics, *pSourceLatencyStatistics;
+    
+    typedef struct _LatencyStatistics {
+        CLatencyHistogram::Snapshot          s_batchSize;       // fragments per output batch.
+        CLatencyHistogram::Snapshot          s_timestampSpread; // ticks newest-oldest per batch.
+        std::vector<SourceLatencyStatistics> s_sources;
+    } LatencyStatistics, *pLatencyStatistics;
   
 public:
 
@@ -226,6 +271,17 @@ public:
         virtual void Xoff() = 0;
   };
   
+  // Observer for per source flow control.  A socket is throttled when
+  // one of its sources has used up its byte budget while the merge does not
+  // need its data, and released when that's no longer the case.
+
+  class SourceFlowObserver {
+    public:
+        virtual ~SourceFlowObserver() {}
+        virtual void throttle(std::string socketName) = 0;
+        virtual void release(std::string socketName) = 0;
+  };
+  
   class NonMonotonicTimestampObserver {
     public:
         virtual void operator()(
@@ -240,9 +296,10 @@ private:
     class QueueStatGetter {
     private:
       std::uint32_t                     m_nTotalFragments;
+      size_t                            m_nCreditLimit;
       std::vector<QueueStatistics> m_Stats;
     public:
-      QueueStatGetter();
+      QueueStatGetter(size_t creditLimit);
       void operator()(SourceElementV& source);
       std::uint32_t totalFragments();
       std::vector<QueueStatistics> queueStats();
@@ -259,6 +316,7 @@ private:
 
   time_t                       m_nBuildWindow;
   time_t                       m_nNow;
+  std::uint64_t                m_nNowNs;            //!< CLatencyHistogram::nowNs() at the same points as m_nNow
   time_t                       m_nOldestReceived;
   time_t                       m_nMostRecentlyEmptied;
   time_t                       m_nStartupTimeout;   //!< N seconds to wait before flushing (dflt=2)
@@ -273,6 +331,7 @@ private:
   std::list<DuplicateTimestampObserver*>     m_duplicateTimestampObservers;
   std::list<FlowControlObserver*>            m_flowControlObservers;
   std::list<NonMonotonicTimestampObserver*>  m_nonMonotonicTsObservers;
+  std::list<SourceFlowObserver*>             m_sourceFlowObservers;
 
   Sources                      m_FragmentQueues;
   bool                         m_fBarrierPending;      //< True if at least one queue has a barrier event.
@@ -287,8 +346,27 @@ private:
   bool                         m_fXoffed;
   size_t                       m_nTotalFragmentSize;
 
+  size_t                       m_nSourceCreditLimit;   //!< Per source byte budget, 0 - none.
+  std::set<std::string>        m_throttledSockets;
+
   COutputThread&               m_outputThread;
 
+  // Latency statistics maintained by this (the interpreter) thread.  Per
+  // source residence times live in the source queues, ingest to emit
+  // times are maintained by the output thread.
+
+  CLatencyHistogram            m_batchSizes;
+  CLatencyHistogram            m_timestampSpreads;
+  std::vector<std::uint64_t>   m_batchArrivals;     //!< Arrival times of fragments in the batch being built.
+
+  // Sharded sorting.  When there are shards, each owns the queues of a
+  // subset of the sources, queues their fragments and merges them into a
+  // locally ordered run on its own thread.  This thread merges the runs and
+  // makes all decisions about flushes and barriers.
+
+  std::vector<SortShard*>      m_shards;            //!< Empty - sort on this thread.
+  unsigned                     m_nNextShard;        //!< Round robin shard for new sources.
+
   // Canonicals/creationals. Note that since this is a singleton, construction
   // is private.
 
@@ -321,6 +399,11 @@ public:
   
   void setXoffThreshold(size_t nBytes);
   void setXonThreshold(size_t nBytes);
+  void setSourceCreditLimit(size_t nBytes);
+  size_t getSourceCreditLimit() const;
+
+  void setShardCount(unsigned nShards);
+  unsigned getShardCount() const;
   
   
   // Observer management:
@@ -348,6 +431,9 @@ public:
   void addFlowControlObserver(FlowControlObserver* pObserver);
   void removeFlowControlObserver(FlowControlObserver* pObserver);
   
+  void addSourceFlowObserver(SourceFlowObserver* pObserver);
+  void removeSourceFlowObserver(SourceFlowObserver* pObserver);
+  
   void addNonMonotonicTimestampObserver(
     NonMonotonicTimestampObserver* pObserver
   );
@@ -363,6 +449,8 @@ public:
   // Get/set state of the queues etc.
 
   InputStatistics getStatistics();
+  LatencyStatistics getLatencyStatistics();
+  void clearLatencyStatistics();
   void createSourceQueue(std::string socketName, std::uint32_t id);  
   void markSourceFailed(std::uint32_t id);
   void markSocketFailed(std::string sockName);
@@ -375,9 +463,18 @@ public:
 private:
   void flushQueues(bool completely=false);
   std::pair<time_t, ::EVB::pFragment>* popOldest();
+  void   dequeueArrival(SourceQueue& queue);
   void   observe(std::vector<EVB::pFragment>& event); // pass built events on down the line.
   void   dataLate(const ::EVB::Fragment& fragment);		    // Data late handler.
   void   addFragment(EVB::pFlatFragment pFragment);
+  void   enqueueFragment(SourceQueue& queue, EVB::pFlatFragment pFragment,
+                         size_t index, std::vector<InputAnomaly>& anomalies);
+  void   reportAnomalies(const std::vector<InputAnomaly>& anomalies);
+  void   addFragmentsSharded(size_t nSize, EVB::pFlatFragment pFragments);
+  void   popSharded(bool completely, std::vector<EVB::pFragment>& sortedFragments);
+  void   runShards(int job);
+  void   assignShards();
+  void   stopShards();
   size_t totalFragmentSize(EVB::pFragmentHeader pHeader);
   bool   queuesEmpty();
   bool   noEmptyQueue();
@@ -394,6 +491,8 @@ private:
   void observeOutOfOrderInput(unsigned sourceId, std::uint64_t prior, std::uint64_t bad);
   void Xoff();
   void Xon();
+  void throttleSocket(std::string sockName);
+  void releaseSocket(std::string sockName);
   
   void findOldest();
   size_t countPresentBarriers() const;
@@ -411,6 +510,7 @@ private:
   size_t inFlightFragmentCount();
   void checkXoff();
   void checkXon();
+  void checkCredits();
 };
 
 
@@ -125,6 +125,11 @@ CInputStatsCommand::operator()(CTCLInterpreter& interp, std::vector<CTCLObject>&
     wideInt     = (Tcl_WideInt)(stats.s_queueStats[i].s_totalQueuedBytes);
     aQueueStat += wideInt;
     
+    wideInt     = (Tcl_WideInt)(stats.s_queueStats[i].s_credit);
+    aQueueStat += wideInt;
+    
+    aQueueStat += (int)(stats.s_queueStats[i].s_throttled ? 1 : 0);
+    
     QueueStatList += aQueueStat;
   }
   result += QueueStatList;
@@ -57,6 +57,9 @@ class CTCLObject;
  *      # bytes - the number of bytes in the queue.
  *      # dequeued -Number of bytes dequeued from the queue.
  *      # totalqueued - Cumulative bytes that have been put in the queue.
+ *      # credit - bytes the source can still queue before its socket may be
+ *                 throttled (0 if per source flow control is off).
+ *      # throttled - 1 if the source's socket is not being read.
  *
  */
 class CInputStatsCommand : public CTCLObjectProcessor 
@@ -0,0 +1,188 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2013.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CLatencyStatsCommand.cpp
+# @brief  Implementation of the CLatencyStatsCommand class.
+# @author <fox@nscl.msu.edu>
+*/
+
+#include "CLatencyStatsCommand.h"
+#include <TCLInterpreter.h>
+#include <TCLObject.h>
+#include "CFragmentHandler.h"
+#include <vector>
+
+/**
+ * constructor
+ *
+ *  @param interp - refers to the interpreter we are going to register with.
+ *  @param cmd    - the command name string we will register as.
+ */
+CLatencyStatsCommand::CLatencyStatsCommand(CTCLInterpreter& interp, std::string cmd) :
+    CTCLObjectProcessor(interp, cmd, true)
+{}
+/**
+ * destructor
+ */
+CLatencyStatsCommand::~CLatencyStatsCommand()
+{}
+
+/**
+ * operator()
+ *    Gets control when the command is invoked in our interpreter.
+ *    *  Ensure that we have have sufficient command parameters for the keyword.
+ *    *  Dispatch to the command handler for the keyword used.
+ *
+ * @param interp - the interpreter running us.
+ * @param objv   - The vector of command words.
+ * @return int TCL_OK on success, TCL_ERROR on failure.
+ */
+int
+CLatencyStatsCommand::operator()(
+    CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+    
+    bindAll(interp, objv);
+    try {
+        requireAtLeast(objv, 2, "Insufficient command parameters");
+        
+        std::string subcommand = objv[1];
+        if (subcommand == "get") {
+            get(interp, objv);
+        } else if (subcommand == "clear") {
+            clear(interp, objv);
+        } else {
+            throw std::string(
+                "Invalid subcommand keyword, must be either 'get' or 'clear'"
+            );
+        }
+        
+    } catch(std::string msg) {
+        interp.setResult(msg);
+        return TCL_ERROR;
+    }
+    return TCL_OK;
+}
+
+/**
+ * clear
+ *   Zero the latency histograms.
+ * 
+ * @param interp - the interpreter running us.
+ * @param objv   - The vector of command words.
+ */
+void
+CLatencyStatsCommand::clear(
+    CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+    requireExactly(objv, 2, "Incorrect number of command parameters");
+    CFragmentHandler::getInstance()->clearLatencyStatistics();
+}
+/**
+ * get
+ *    Get the current histograms.  See the header for the form of the result.
+ *
+ * @param interp - the interpreter running us.
+ * @param objv   - The vector of command words.
+ */
+void
+CLatencyStatsCommand::get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+    requireExactly(objv, 2, "Incorrect number of command parameters");
+    
+    CFragmentHandler::LatencyStatistics stats =
+        CFragmentHandler::getInstance()->getLatencyStatistics();
+    
+    CTCLObject result;
+    result.Bind(interp);
+    
+    result += histogramObject(interp, stats.s_batchSize);
+    result += histogramObject(interp, stats.s_timestampSpread);
+    
+    CTCLObject perSourceStats;
+    perSourceStats.Bind(interp);
+    for (int i = 0; i < stats.s_sources.size(); i++) {
+        CTCLObject sourceElement;
+        sourceElement.Bind(interp);
+        
+        sourceElement += static_cast<int>(stats.s_sources[i].s_sourceId);
+        sourceElement += histogramObject(interp, stats.s_sources[i].s_residence);
+        sourceElement += histogramObject(interp, stats.s_sources[i].s_ingestToEmit);
+        
+        perSourceStats += sourceElement;
+    }
+    result += perSourceStats;
+    
+    interp.setResult(result);
+}
+/**
+ * histogramObject
+ *    Produce the list representation of a histogram snapshot.
+ *
+ * @param interp - interpreter to bind the objects to.
+ * @param data   - Histogram snapshot.
+ * @return CTCLObject - {count mean p50 p90 p99 max {{low high count}...}}
+ */
+CTCLObject
+CLatencyStatsCommand::histogramObject(
+    CTCLInterpreter& interp, const CLatencyHistogram::Snapshot& data
+)
+{
+    CTCLObject result;
+    result.Bind(interp);
+    
+    result += uint64Object(interp, data.s_count);
+    result += uint64Object(interp, data.s_count ? data.s_sum/data.s_count : 0);
+    result += uint64Object(interp, CLatencyHistogram::percentile(data, 0.50));
+    result += uint64Object(interp, CLatencyHistogram::percentile(data, 0.90));
+    result += uint64Object(interp, CLatencyHistogram::percentile(data, 0.99));
+    result += uint64Object(interp, data.s_max);
+    
+    CTCLObject buckets;
+    buckets.Bind(interp);
+    for (unsigned i = 0; i < data.s_buckets.size(); i++) {
+        if (data.s_buckets[i]) {
+            CTCLObject bucket;
+            bucket.Bind(interp);
+            bucket += uint64Object(interp, CLatencyHistogram::bucketLow(i));
+            bucket += uint64Object(interp, CLatencyHistogram::bucketHigh(i));
+            bucket += uint64Object(interp, data.s_buckets[i]);
+            
+            buckets += bucket;
+        }
+    }
+    result += buckets;
+    
+    return result;
+}
+/**
+ * uint64Object
+ *    Create a CTCLObject from a uint64_t via a Tcl wide integer object.
+ *    
+ *  @param interp -references the interpreter to which the CTCLObject is bound.
+ *  @param value  - the uint64_t we're binding.
+ *  @return CTCLObject
+ */
+CTCLObject
+CLatencyStatsCommand::uint64Object(CTCLInterpreter& interp, uint64_t value)
+{
+    Tcl_Obj* nativeObject = Tcl_NewWideIntObj(value);
+    CTCLObject wrappedObject(nativeObject);
+    wrappedObject.Bind(interp);
+    
+    return wrappedObject;
+}
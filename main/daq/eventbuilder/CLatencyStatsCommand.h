@@ -0,0 +1,94 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2013.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CLatencyStatsCommand.h
+# @brief  Command to return the orderer's latency histograms.
+# @author <fox@nscl.msu.edu>
+*/
+
+#ifndef __CLATENCYSTATSCOMMAND_H
+#define __CLATENCYSTATSCOMMAND_H
+
+#ifndef __TCLOBJECTPROCESSOR_H
+#include <TCLObjectProcessor.h>
+#endif
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+#ifndef __CLATENCYHISTOGRAM_H
+#include "CLatencyHistogram.h"
+#endif
+
+// Forward definitions:
+
+class CTCLInterpreter;
+class CTCLObject;
+
+/**
+ * @class CLatencyStatsCommand
+ *    Implements the EVB::latencystats command:
+ *    -  EVB::latencystats get   - returns the histograms.
+ *    -  EVB::latencystats clear - zeroes the histograms.
+ *
+ *    get returns a three element list:
+ *    *  The histogram of the number of fragments in each output batch.
+ *    *  The histogram of the timestamp spread (newest - oldest) in each batch.
+ *    *  A list with one element per source containing the source id,
+ *       the histogram of queue residence times and the histogram of
+ *       ingest to emit times (both nanoseconds).
+ *
+ *    Each histogram is a list of count, mean, p50, p90, p99, max and a list of
+ *    {low high count} triples for the non-empty buckets.
+ */
+class CLatencyStatsCommand : public CTCLObjectProcessor
+{
+    // Legal canonicals
+    
+public:
+    CLatencyStatsCommand(CTCLInterpreter& interp, std::string command);
+    virtual ~CLatencyStatsCommand();
+    
+    // Forbidden canonicals.
+
+private:
+    CLatencyStatsCommand(const CLatencyStatsCommand& rhs);
+    CLatencyStatsCommand& operator=(const CLatencyStatsCommand& rhs);
+    int operator==(CLatencyStatsCommand& rhs) const;
+    int operator!=(CLatencyStatsCommand& rhs) const;
+    
+    // command entry point:
+    
+public:
+  int operator()(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+
+  // command execution methods:
+
+private:
+  void clear(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+  void get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+  CTCLObject histogramObject(
+    CTCLInterpreter& interp, const CLatencyHistogram::Snapshot& data
+  );
+  CTCLObject uint64Object(CTCLInterpreter& interp, uint64_t value);
+};
+
+#endif
@@ -21,6 +21,7 @@
 */
 
 #include "COutputThread.h"
+#include <CPipelineTrace.h>
 #include <stdexcept>
 #include <algorithm>
 
@@ -50,7 +51,8 @@ void
 COutputThread::run()
 {
     while (1) {
-        std::vector<EVB::pFragment>* pFrags = getFragments();
+        Batch batch = getFragments();
+        std::vector<EVB::pFragment>* pFrags = batch.s_pFragments;
 	m_nInflightCount -= (pFrags->size());
         {
             CriticalSection c(m_observerGuard);
@@ -59,6 +61,17 @@ COutputThread::run()
                 (*pO)(*pFrags);
             }
         }
+        if (CPipelineTrace::enabled()) {
+            for (size_t i = 0; i < pFrags->size(); i++) {
+                CPipelineTrace::hop(
+                    CPipelineTrace::OrdererEmit, (*pFrags)[i]->s_header.s_timestamp
+                );
+            }
+        }
+        if (batch.s_pArrivals) {
+            histogramLatencies(*pFrags, *batch.s_pArrivals);
+            delete batch.s_pArrivals;
+        }
         freeFragments(pFrags); 
     }
 }
@@ -105,12 +118,18 @@ COutputThread::removeObserver(CFragmentHandler::Observer* o)
  *
  *  @param pFrags - pointer to a vector of fragment pointers we queue for
  *                  processing.
+ *  @param pArrivals - If not null, a dynamically allocated vector with the
+ *                  receipt time of each fragment in pFrags.  The thread
+ *                  deletes it once the latencies have been histogrammed.
  */
 void
-COutputThread::queueFragments(std::vector<EVB::pFragment>* pFrags)
+COutputThread::queueFragments(
+    std::vector<EVB::pFragment>* pFrags, std::vector<uint64_t>* pArrivals
+)
 {
+    Batch batch = {pFrags, pArrivals};
     m_nInflightCount += pFrags->size();
-    m_inputQueue.queue(pFrags);
+    m_inputQueue.queue(batch);
 }
 /**
  * getInflightCount
@@ -123,6 +142,34 @@ COutputThread::getInflightCount() const
 {
     return m_nInflightCount;
 }
+/**
+ * getIngestToEmit
+ *    Snapshot the ingest to emit latency histograms.
+ *
+ * @return std::map<uint32_t, CLatencyHistogram::Snapshot> - indexed by source id.
+ */
+std::map<uint32_t, CLatencyHistogram::Snapshot>
+COutputThread::getIngestToEmit()
+{
+    std::map<uint32_t, CLatencyHistogram::Snapshot> result;
+    CriticalSection c(m_latencyGuard);
+    for (auto p = m_ingestToEmit.begin(); p != m_ingestToEmit.end(); p++) {
+        result[p->first] = p->second.snapshot();
+    }
+    return result;
+}
+/**
+ * clearIngestToEmit
+ *    Zero the ingest to emit histograms.
+ */
+void
+COutputThread::clearIngestToEmit()
+{
+    CriticalSection c(m_latencyGuard);
+    for (auto p = m_ingestToEmit.begin(); p != m_ingestToEmit.end(); p++) {
+        p->second.clear();
+    }
+}
 
 /*----------------------------------------------------------------------------
  * private utilities
@@ -132,9 +179,9 @@ COutputThread::getInflightCount() const
  * getFragments
  *    Return the next set of fragments that were queued for processing by our
  *    observers.
- * @return std::vector<EVB::pFragment>*
+ * @return Batch
  */
-std::vector<EVB::pFragment>*
+COutputThread::Batch
 COutputThread::getFragments()
 {
     return m_inputQueue.get();
@@ -161,3 +208,29 @@ COutputThread::freeFragments(std::vector<EVB::pFragment>* frags)
     
     delete frags;
 }
+/**
+ * histogramLatencies
+ *    Add the time from receipt to now for each fragment in a batch to
+ *    the histogram for its source.
+ *
+ * @param frags    - the fragments.
+ * @param arrivals - their arrival times.
+ */
+void
+COutputThread::histogramLatencies(
+    const std::vector<EVB::pFragment>& frags, const std::vector<uint64_t>& arrivals
+)
+{
+    uint64_t now = CLatencyHistogram::nowNs();
+    for (int i = 0; i < frags.size() && i < arrivals.size(); i++) {
+        uint32_t id = frags[i]->s_header.s_sourceId;
+        auto p = m_ingestToEmit.find(id);
+        if (p == m_ingestToEmit.end()) {
+            CriticalSection c(m_latencyGuard);   // Only inserts need the lock.
+            p = m_ingestToEmit.insert(
+                std::make_pair(id, CLatencyHistogram())
+            ).first;
+        }
+        p->second.add(now > arrivals[i] ? now - arrivals[i] : 0);
+    }
+}
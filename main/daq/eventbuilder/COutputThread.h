@@ -30,6 +30,9 @@
 #include <CMutex.h>
 #include <CBufferQueue.h>
 #include <atomic>
+#include <map>
+#include <stdint.h>
+#include "CLatencyHistogram.h"
 
 /**
  * @class COutputThread
@@ -50,15 +53,26 @@
  *         in turn, would mislead the user about how the event builder was
  *         performing.
  *
+ *     Batches can be accompanied by the times at which each fragment was
+ *     received.  If so, the thread histograms, per source, the time between
+ *     receipt and the completion of the output observers.
  */
 class COutputThread : public Thread
 {
     // Local data:
     
 private:
+    // A batch of fragments and, optionally, their arrival times
+    // (CLatencyHistogram::nowNs() units, parallel to the fragments).
+    
+    typedef struct _Batch {
+        std::vector<EVB::pFragment>* s_pFragments;
+        std::vector<uint64_t>*       s_pArrivals;
+    } Batch, *pBatch;
+    
     // Buffer queue between the fragment source and us:
     
-    CBufferQueue<std::vector<EVB::pFragment>* > m_inputQueue;
+    CBufferQueue<Batch> m_inputQueue;
     
     // The mutex guard and the list of observers it guards:
     
@@ -69,6 +83,12 @@ private:
     
     std::atomic<size_t>   m_nInflightCount;
     
+    // Ingest to emit latencies by source id.  Only this thread adds to the
+    // histograms; the guard protects the map itself.
+    
+    CMutex                                    m_latencyGuard;
+    std::map<uint32_t, CLatencyHistogram>     m_ingestToEmit;
+    
 public:
     COutputThread();
     virtual ~COutputThread();
@@ -85,14 +105,26 @@ public:
 
     // Make fragments available to the thread:
 public:
-    void queueFragments(std::vector<EVB::pFragment>* pFrags);
+    void queueFragments(
+        std::vector<EVB::pFragment>* pFrags,
+        std::vector<uint64_t>* pArrivals = 0
+    );
     size_t getInflightCount() const;
     
+    // Latency statistics:
+    
+    std::map<uint32_t, CLatencyHistogram::Snapshot> getIngestToEmit();
+    void clearIngestToEmit();
+    
     // Private utilities:
     
 private:
-    std::vector<EVB::pFragment>* getFragments();
+    Batch getFragments();
     void freeFragments(std::vector<EVB::pFragment>* frags);
+    void histogramLatencies(
+        const std::vector<EVB::pFragment>& frags,
+        const std::vector<uint64_t>& arrivals
+    );
     
 };
 
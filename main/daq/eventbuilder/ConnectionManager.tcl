@@ -59,7 +59,11 @@ namespace eval EVB {}
 #   -fragmentcommand   - Script to call on a fragment
 #
 # METHODS
-#   Only construction and destrution are are public.
+#   tryRead            - Process data already buffered for the socket.
+#   flowOff/flowOn     - Stop/start reading for global flow control.
+#   throttle/release   - Stop/start reading because the connection's sources
+#                        are over their byte budgets in the orderer.
+#   isThrottled        - True if the connection is throttled.
 #
 snit::type EVB::Connection {
     option -state -default FORMING -readonly yes
@@ -73,7 +77,8 @@ snit::type EVB::Connection {
 
     variable callbacks
     variable expecting
-    variable stateMethods -array [list FORMING _Connect ACTIVE _Fragments]
+    variable flowedOff 0;               # Global flow control (EVB::onflow).
+    variable throttled 0;               # Per source flow control (EVB::oncredit).
 
 
 
@@ -102,6 +107,9 @@ snit::type EVB::Connection {
     #    and if so dispatch.  During this , the -fragmentcommand is disabled.
     #
     method tryRead {} {
+	if {$flowedOff || $throttled} {
+	    return
+	}
 	if {[chan pending input $options(-socket)] > 0} {
 	    $callbacks register -fragmentcommand [list]; # turn off callback
 	    $self $expecting $options(-socket)
@@ -113,15 +121,41 @@ snit::type EVB::Connection {
     #   Called to disable reception of data.
     #
     method flowOff {} {
-        fileevent $options(-socket) readable [list]
+        set flowedOff 1
+        $self _UpdateReadable
     }
     ##
     # flowOn
     #   Called to enable reception of data.
     #
     method flowOn {} {
-        set method $stateMethods($options(-state))
-        fileevent $options(-socket) readable [mymethod $method $options(-socket)] 
+        set flowedOff 0
+        $self _UpdateReadable
+    }
+    ##
+    # throttle
+    #   Called to stop reading because our sources have used up their
+    #   byte budgets.  The client blocks when its TCP window fills.
+    #
+    method throttle {} {
+        set throttled 1
+        $self _UpdateReadable
+    }
+    ##
+    # release
+    #   Called when our sources can send again.
+    #
+    method release {} {
+        set throttled 0
+        $self _UpdateReadable
+    }
+    ##
+    # isThrottled
+    #
+    # @return bool - true if the connection is not read because of its budgets.
+    #
+    method isThrottled {} {
+        return $throttled
     }
 
     #----------------------------------------------------------------------------
@@ -274,9 +308,24 @@ snit::type EVB::Connection {
     # @param newState - The new state value.
     #
     method _Expecting {method newState} {
-	fileevent $options(-socket) readable [mymethod $method $options(-socket)] 
 	set options(-state) $newState
 	set expecting $method
+	$self _UpdateReadable
+    }
+    ##
+    # _UpdateReadable
+    #   Read the socket if neither global nor per source flow control
+    #   stops us.
+    #
+    method _UpdateReadable {} {
+        if {$options(-socket) == -1} {
+            return
+        }
+        if {$flowedOff || $throttled} {
+            fileevent $options(-socket) readable [list]
+        } else {
+            fileevent $options(-socket) readable [mymethod $expecting $options(-socket)]
+        }
     }
     ##
     # Called to close the connection
@@ -488,6 +537,7 @@ snit::type EVB::ConnectionManager {
             exit
         }
         EVB::onflow add [mymethod _FlowOn] [mymethod _FlowOff]
+        EVB::oncredit add [mymethod _Throttle] [mymethod _Release]
     }
     destructor {
 	foreach object [array names connections] {
@@ -551,6 +601,45 @@ snit::type EVB::ConnectionManager {
         }
     }
 
+    ##
+    # _Throttle
+    #   Stop reading the connection on a socket whose sources are over budget.
+    #
+    # @param socket - the socket.
+    #
+    method _Throttle socket {
+        set connection [$self _SocketConnection $socket]
+        if {$connection ne ""} {
+            $connection throttle
+        }
+    }
+    ##
+    # _Release
+    #   Resume reading the connection on a socket.
+    #
+    # @param socket - the socket.
+    #
+    method _Release socket {
+        set connection [$self _SocketConnection $socket]
+        if {$connection ne ""} {
+            $connection release
+        }
+    }
+    ##
+    # _SocketConnection
+    #
+    # @param socket - a socket name.
+    # @return string - the connection using it or "" if there is none.
+    #
+    method _SocketConnection socket {
+        foreach connection [array names connections] {
+            if {[$connection cget -socket] eq $socket} {
+                return $connection
+            }
+        }
+        return ""
+    }
+
     ##
     # Client disconnect is just removing it from the list of connections
     # and invoking the disconnect callback.  Once all that dust has settled,
@@ -662,6 +751,10 @@ snit::type EVB::ConnectionManager {
 	if {($now - $lastFragment) < $options(-sourcetimeout)} {
 	    set timedoutSources [list]; # Assume it's all just peachy.
 	    foreach connection [array names connections] {
+		if {[$connection isThrottled]} {
+		    set connections($connection) $now; # Quiet because we stopped it.
+		    continue
+		}
 		if {($now - $connections($connection)) > $options(-sourcetimeout)} {
 		    lappend timedoutSources $connection
 		}
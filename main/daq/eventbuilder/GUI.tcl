@@ -37,6 +37,7 @@ package require EVB::Late
 package require EVB::LatePopup
 package require EVB::DuplicateTimestamp
 package require EVB::OutOfOrderUI
+package require EVB::LatencyUI
 package require RingStatus
 package require ring
 
@@ -452,6 +453,7 @@ snit::widgetadaptor EVB::errorStatistics {
 #                     updated.
 #   - getErrorStats   - Get the error statistics widget
 #   - getRingStats    - Get ring status widget.
+#   - getLatencyStats - Get the latency histogram widget.
 #  ..
 snit::widgetadaptor EVB::statusNotebook {
     component summaryStats
@@ -460,6 +462,7 @@ snit::widgetadaptor EVB::statusNotebook {
     component barrierStats
     component errorStats
     component ringStats
+    component latencyStats
     
     delegate option * to hull
     delegate method * to hull
@@ -498,6 +501,9 @@ snit::widgetadaptor EVB::statusNotebook {
         install errorStats using EVB::errorStatistics  $win.errors
         $hull add $errorStats -text {Errors}
         
+        install latencyStats using LatencyUI $win.latency
+        $hull add $latencyStats -text {Latency}
+        
         $self configurelist $args
 
         grid rowconfigure $win 0 -weight 1
@@ -552,6 +558,14 @@ snit::widgetadaptor EVB::statusNotebook {
     method getErrorStats {} {
         return $errorStats
     }
+    ##
+    # getLatencyStats
+    #
+    #   Get the latency histogram widget.
+    #
+    method getLatencyStats {} {
+        return $latencyStats
+    }
 }
 
 
@@ -642,6 +656,8 @@ proc EVB::maintainGUI {widget {ms 2000}} {
     set dupStats     [EVB::dupstat get]
     
     EVB::updateDupStatsDialog $dupStats
+    
+    [$widget getLatencyStats] update [EVB::latencystats get]
 
 
 
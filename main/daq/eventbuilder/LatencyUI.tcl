@@ -0,0 +1,136 @@
+#!/bin/sh
+# -*- tcl -*-
+# The next line is executed by /bin/sh, but not tcl \
+exec tclsh "$0" ${1+"$@"}
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2014.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Authors:
+#             Ron Fox
+#             Jeromy Tompkins 
+#	     NSCL
+#	     Michigan State University
+#	     East Lansing, MI 48824-1321
+
+
+
+##
+# @file LatencyUI.tcl
+# @brief UI to display the orderer latency histograms.
+# @author Ron Fox <fox@nscl.msu.edu>
+#
+
+package require Tk
+package require snit
+
+package provide EVB::LatencyUI 1.0
+
+
+##
+# @class LatencyUI
+#   Megawidget consisting of a treeview and scrollbar that displays the
+#   data returned by EVB::latencystats get.  Each histogram is a top level
+#   line with its summary values (count, mean, percentiles, max); the
+#   non-empty buckets of the histogram are its children:
+#
+# \verbatim
+#   Histogram              Count   Mean   p50    p90    p99    Max
+#   Batch size              1000     12    15     31     63     40
+#   Timestamp spread        1000    ...
+#   Source 1 residence       ...
+#      +---  1024-2047       123
+#   Source 1 ingest to emit  ...
+# \endverbatim
+#
+#  Times are in nanoseconds, timestamp spreads in timestamp ticks.
+#
+#  METHODS:
+#    update - Update the display from the output of EVB::latencystats get.
+#
+#  OPTIONS:
+#    All options are delegated to the treeview.
+#
+snit::widgetadaptor LatencyUI {
+    component tree
+    
+    delegate option * to tree
+
+    # Indexed by histogram name, contents are the tree item for that histogram.
+    
+    variable items -array [list]
+    variable columnNames [list Count Mean p50 p90 p99 Max]
+    
+    ##
+    # constructor
+    #  Create the hull (ttk::frame) the tree view and the scroll bar (vertical).
+    #  Lay them all out.
+    #
+    constructor args {
+        installhull using ttk::frame
+        
+        install tree using ttk::treeview $win.tree \
+            -yscrollcommand [list $win.sb set] -columns $columnNames
+        ttk::scrollbar $win.sb -orient vertical -command [list $tree yview]
+        
+        $tree heading #0 -text Histogram
+        foreach column $columnNames {
+            $tree heading $column -text $column
+            $tree column  $column -width 80 -stretch 1
+        }
+        
+        grid $tree $win.sb -sticky nsew
+        grid rowconfigure    $win 0 -weight 1
+        grid columnconfigure $win 0 -weight 1
+        
+        $self configurelist $args
+    }
+    
+    ##
+    # update
+    #   Update the display.
+    #
+    # @param stats - Output of EVB::latencystats get.
+    #
+    method update stats {
+        $self _updateHistogram {Batch size}       [lindex $stats 0]
+        $self _updateHistogram {Timestamp spread} [lindex $stats 1]
+        
+        foreach source [lindex $stats 2] {
+            set id [lindex $source 0]
+            $self _updateHistogram "Source $id residence (ns)"      [lindex $source 1]
+            $self _updateHistogram "Source $id ingest to emit (ns)" [lindex $source 2]
+        }
+    }
+    #---------------------------------------------------------------------------
+    #  Private methods
+    #
+    
+    ##
+    # _updateHistogram
+    #   Update the line for a single histogram and replace its bucket children.
+    #
+    # @param name - Name of the histogram (tree text).
+    # @param histogram - {count mean p50 p90 p99 max buckets}
+    #
+    method _updateHistogram {name histogram} {
+        if {[array names items $name] eq ""} {
+            set items($name) [$tree insert {} end -text $name]
+        }
+        set item $items($name)
+        $tree item $item -values [lrange $histogram 0 5]
+        
+        $tree delete [$tree children $item]
+        foreach bucket [lindex $histogram 6] {
+            set low   [lindex $bucket 0]
+            set high  [lindex $bucket 1]
+            $tree insert $item end -text "$low - $high" \
+                -values [list [lindex $bucket 2]]
+        }
+    }
+}
@@ -37,8 +37,10 @@
 #include "CResetCommand.h"
 #include "CBarrierStatsCommand.h"
 #include "CDuplicateTimeStatCommand.h"
+#include "CLatencyStatsCommand.h"
 #include "CConfigure.h"
 #include "CXonXOffCallbackCommand.h"
+#include "CCreditCallbackCommand.h"
 #include "COutOfOrderTraceCommand.h"
 #include "CFragmentHandler.h"
 
@@ -75,7 +77,9 @@ int Eventbuilder_Init(Tcl_Interp* pInterp)
   new CBarrierStatsCommand(*pInterpObject, "EVB::barrierstats"); 
   new CConfigure(*pInterpObject, "EVB::config");
   new CDuplicateTimeStatCommand(*pInterpObject, "EVB::dupstat");
+  new CLatencyStatsCommand(*pInterpObject, "EVB::latencystats");
   new CXonXoffCallbackCommand(*pInterpObject, "EVB::onflow");
+  new CCreditCallbackCommand(*pInterpObject, "EVB::oncredit");
   new COutOfOrderTraceCommand(*pInterpObject, "EVB::ootrace");
 
   // Setup the output stage:
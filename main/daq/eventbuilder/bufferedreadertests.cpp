@@ -0,0 +1,263 @@
+// Tests for the buffered record reader used by the stream filters.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CBufferedRecordReader.h"
+#include "fragment.h"
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+// Writer thread for the streaming test:
+
+struct StreamSource {
+  int                         s_fd;
+  const std::vector<uint8_t>* s_pData;
+  int                         s_nPasses;
+};
+
+static void*
+streamWriter(void* pArg)
+{
+  StreamSource* pSource = reinterpret_cast<StreamSource*>(pArg);
+  for (int i = 0; i < pSource->s_nPasses; i++) {
+    const uint8_t* p     = &(*pSource->s_pData)[0];
+    size_t         nLeft = pSource->s_pData->size();
+    while (nLeft) {
+      ssize_t n = write(pSource->s_fd, p, nLeft);
+      if (n <= 0) break;
+      p     += n;
+      nLeft -= n;
+    }
+  }
+  close(pSource->s_fd);
+  return 0;
+}
+
+class BufferedReaderTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(BufferedReaderTests);
+  CPPUNIT_TEST(fromFile);
+  CPPUNIT_TEST(growBuffer);
+  CPPUNIT_TEST(truncated);
+  CPPUNIT_TEST(badSize);
+  CPPUNIT_TEST(teePipes);
+  CPPUNIT_TEST(teeFallback);
+  CPPUNIT_TEST(streamThroughput);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  std::vector<uint8_t> m_stream;	// Flattened fragments.
+  size_t               m_nFragments;
+  std::string          m_filename;
+
+public:
+  void setUp() {
+    // 1000 fragments with payloads from 0 to ~4K bytes; payload bytes
+    // carry the fragment number so they can be checked.
+
+    m_stream.clear();
+    m_nFragments = 1000;
+    for (size_t i = 0; i < m_nFragments; i++) {
+      EVB::FragmentHeader h;
+      h.s_timestamp = i*10;
+      h.s_sourceId  = i % 4;
+      h.s_size      = (i*37) % 4096;
+      h.s_barrier   = 0;
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(&h);
+      m_stream.insert(m_stream.end(), p, p + sizeof(h));
+      m_stream.insert(m_stream.end(), h.s_size, uint8_t(i));
+    }
+    char name[] = "/tmp/bufferedreaderXXXXXX";
+    int fd = mkstemp(name);
+    m_filename = name;
+    write(fd, &m_stream[0], m_stream.size());
+    close(fd);
+  }
+  void tearDown() {
+    unlink(m_filename.c_str());
+  }
+protected:
+  void fromFile();
+  void growBuffer();
+  void truncated();
+  void badSize();
+  void teePipes();
+  void teeFallback();
+  void streamThroughput();
+private:
+  size_t readAll(CBufferedRecordReader& reader, int teeFd = -1);
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BufferedReaderTests);
+
+// Read the whole stream checking each fragment; returns the count.
+
+size_t
+BufferedReaderTests::readAll(CBufferedRecordReader& reader, int teeFd)
+{
+  size_t n = 0;
+  while (reader.read(teeFd)) {
+    const void* p;
+    while ((p = reader.next())) {
+      const EVB::FragmentHeader* pH =
+	reinterpret_cast<const EVB::FragmentHeader*>(p);
+      size_t i = n % m_nFragments;
+      EQ(uint64_t(i*10), pH->s_timestamp);
+      EQ(uint32_t((i*37) % 4096), pH->s_size);
+      const uint8_t* pBody = reinterpret_cast<const uint8_t*>(pH + 1);
+      for (uint32_t b = 0; b < pH->s_size; b++) {
+	if (pBody[b] != uint8_t(i)) {
+	  EQ(uint8_t(i), pBody[b]);
+	}
+      }
+      n++;
+    }
+  }
+  return n;
+}
+
+// Fragments come out in order and intact.
+
+void BufferedReaderTests::fromFile()
+{
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  CBufferedRecordReader reader(fd, sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize, 64*1024);
+  EQ(m_nFragments, readAll(reader));
+  EQ(size_t(0), reader.residual());
+  close(fd);
+}
+// A buffer smaller than a fragment grows rather than fails.
+
+void BufferedReaderTests::growBuffer()
+{
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  CBufferedRecordReader reader(fd, sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize, 10);
+  EQ(m_nFragments, readAll(reader));
+  close(fd);
+}
+// A truncated last fragment is left as residual data.
+
+void BufferedReaderTests::truncated()
+{
+  truncate(m_filename.c_str(), m_stream.size() - 10);
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  CBufferedRecordReader reader(fd, sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize);
+  EQ(m_nFragments - 1, readAll(reader));
+  ASSERT(reader.residual() > 0);
+  close(fd);
+}
+// A size smaller than the header is reported.
+
+static size_t
+badSizer(const void* p)
+{
+  return 2;
+}
+
+void BufferedReaderTests::badSize()
+{
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  CBufferedRecordReader reader(fd, sizeof(EVB::FragmentHeader), badSizer);
+  reader.read();
+  CPPUNIT_ASSERT_THROW(reader.next(), std::string);
+  close(fd);
+}
+// Pipe to pipe - the data are teed and arrive intact on both sides.
+
+void BufferedReaderTests::teePipes()
+{
+  int in[2], out[2];
+  pipe(in);
+  pipe(out);
+  fcntl(out[1], F_SETPIPE_SZ, 1024*1024);
+
+  StreamSource source = {in[1], &m_stream, 1};
+  pthread_t tid;
+  pthread_create(&tid, 0, streamWriter, &source);
+
+  // Drain the tee'd copy as we go or the output pipe could fill.
+
+  std::vector<uint8_t> copy;
+  CBufferedRecordReader reader(in[0], sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize);
+  size_t n = 0;
+  size_t nRead;
+  while ((nRead = reader.read(out[1]))) {
+    ASSERT(reader.teed());
+    size_t got = 0;
+    while (got < nRead) {
+      uint8_t buffer[64*1024];
+      size_t  want = nRead - got;
+      if (want > sizeof(buffer)) want = sizeof(buffer);
+      ssize_t nCopy = ::read(out[0], buffer, want);
+      ASSERT(nCopy > 0);
+      copy.insert(copy.end(), buffer, buffer + nCopy);
+      got += nCopy;
+    }
+    while (reader.next()) n++;
+  }
+  pthread_join(tid, 0);
+  EQ(m_nFragments, n);
+  EQ(m_stream.size(), copy.size());
+  ASSERT(copy == m_stream);
+
+  close(in[0]);
+  close(out[0]);
+  close(out[1]);
+}
+// File input can't be teed; the caller gets the chunk via lastRead.
+
+void BufferedReaderTests::teeFallback()
+{
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  int out[2];
+  pipe(out);
+
+  CBufferedRecordReader reader(fd, sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize, 4096);
+  std::vector<uint8_t> copy;
+  size_t nRead;
+  while ((nRead = reader.read(out[1]))) {
+    ASSERT(!reader.teed());
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(reader.lastRead());
+    copy.insert(copy.end(), p, p + nRead);
+    while (reader.next())
+      ;
+  }
+  ASSERT(copy == m_stream);
+
+  close(fd);
+  close(out[0]);
+  close(out[1]);
+}
+// Push a few tens of megabytes of captured fragments through a pipe.
+
+void BufferedReaderTests::streamThroughput()
+{
+  int in[2];
+  pipe(in);
+  int nPasses = 16;
+  StreamSource source = {in[1], &m_stream, nPasses};
+  pthread_t tid;
+  pthread_create(&tid, 0, streamWriter, &source);
+
+  CBufferedRecordReader reader(in[0], sizeof(EVB::FragmentHeader),
+			       CBufferedRecordReader::fragmentSize);
+  EQ(m_nFragments*nPasses, readAll(reader));
+  EQ(size_t(0), reader.residual());
+
+  pthread_join(tid, 0);
+  close(in[0]);
+}
@@ -0,0 +1,320 @@
+// Tests of per source (credit) flow control in the event orderer.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include <vector>
+#include <string>
+
+#define private public
+#include "CFragmentHandler.h"
+#undef private
+
+#include "CCreditCallbackCommand.h"
+#include "CConfigure.h"
+#include <TCLInterpreter.h>
+#include <TCLVariable.h>
+#include <TCLException.h>
+#include "fragment.h"
+
+// Append a flat fragment with an nBytes body to a buffer.
+
+static void
+appendFragment(std::vector<uint8_t>& buffer, uint32_t sourceId, uint64_t timestamp,
+               uint32_t nBytes)
+{
+  EVB::FragmentHeader header;
+  header.s_timestamp = timestamp;
+  header.s_sourceId  = sourceId;
+  header.s_size      = nBytes;
+  header.s_barrier   = 0;
+  uint8_t* p = reinterpret_cast<uint8_t*>(&header);
+  buffer.insert(buffer.end(), p, p + sizeof(header));
+  buffer.insert(buffer.end(), nBytes, uint8_t(0));
+}
+
+static void
+addFragments(CFragmentHandler* pHandler, std::vector<uint8_t>& buffer)
+{
+  pHandler->addFragments(
+    buffer.size(), reinterpret_cast<EVB::pFlatFragment>(&buffer[0])
+  );
+}
+
+// Pop and free the oldest fragment.
+
+static void
+popOne(CFragmentHandler* pHandler)
+{
+  std::pair<time_t, EVB::pFragment>* p = pHandler->popOldest();
+  freeFragment(p->second);
+  delete p;
+}
+
+// Records the throttle/release calls.
+
+class RecordingObserver : public CFragmentHandler::SourceFlowObserver {
+public:
+  std::vector<std::string> m_throttled;
+  std::vector<std::string> m_released;
+  void throttle(std::string socketName) {m_throttled.push_back(socketName);}
+  void release(std::string socketName)  {m_released.push_back(socketName);}
+};
+
+class CreditTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(CreditTests);
+  CPPUNIT_TEST(defaultLimit);
+  CPPUNIT_TEST(configLimit);
+  CPPUNIT_TEST(configNegative);
+  CPPUNIT_TEST(underBudget);
+  CPPUNIT_TEST(leaderThrottled);
+  CPPUNIT_TEST(laggerNotThrottled);
+  CPPUNIT_TEST(emptyQueueNeeded);
+  CPPUNIT_TEST(hysteresis);
+  CPPUNIT_TEST(disable);
+  CPPUNIT_TEST(statistics);
+  CPPUNIT_TEST(socketFailed);
+  CPPUNIT_TEST(tclScripts);
+  CPPUNIT_TEST(tclRemove);
+  CPPUNIT_TEST(tclRemoveNoSuch);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+    CTCLInterpreter*  m_pInterp;
+    CFragmentHandler* m_pHandler;
+    RecordingObserver m_observer;
+public:
+  void setUp() {
+    m_pInterp  = new CTCLInterpreter();
+    m_pHandler = new CFragmentHandler();
+    CFragmentHandler::m_pInstance = m_pHandler;
+    m_pHandler->setBuildWindow(1000);
+    m_pHandler->setSourceCreditLimit(1000);
+    m_pHandler->createSourceQueue("sockA", 1);
+    m_pHandler->createSourceQueue("sockB", 2);
+    m_observer = RecordingObserver();
+    m_pHandler->addSourceFlowObserver(&m_observer);
+  }
+  void tearDown() {
+    m_pHandler->flushQueues(true);
+    delete m_pHandler;
+    CFragmentHandler::m_pInstance = 0;
+    delete m_pInterp;
+  }
+protected:
+  void defaultLimit();
+  void configLimit();
+  void configNegative();
+  void underBudget();
+  void leaderThrottled();
+  void laggerNotThrottled();
+  void emptyQueueNeeded();
+  void hysteresis();
+  void disable();
+  void statistics();
+  void socketFailed();
+  void tclScripts();
+  void tclRemove();
+  void tclRemoveNoSuch();
+private:
+  void throttleA();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CreditTests);
+
+// Source 1 (sockA) gets ahead of source 2 (sockB) and over its budget.
+
+void CreditTests::throttleA()
+{
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 2, 50, 100);
+  appendFragment(buffer, 1, 100, 400);
+  appendFragment(buffer, 1, 200, 400);
+  appendFragment(buffer, 1, 300, 400);
+  addFragments(m_pHandler, buffer);
+}
+
+// Budgets are on by default.
+
+void CreditTests::defaultLimit()
+{
+  CFragmentHandler handler;
+  EQ(size_t(64*1024*1024), handler.getSourceCreditLimit());
+}
+
+// The budget can be set and gotten with the config command.
+
+void CreditTests::configLimit()
+{
+  CConfigure cmd(*m_pInterp, "config");
+  m_pInterp->Eval("config set SourceCreditLimit 1234");
+  EQ(size_t(1234), m_pHandler->getSourceCreditLimit());
+  EQ(std::string("1234"), m_pInterp->Eval("config get SourceCreditLimit"));
+}
+
+void CreditTests::configNegative()
+{
+  CConfigure cmd(*m_pInterp, "config");
+  bool thrown = false;
+  try {
+    m_pInterp->Eval("config set SourceCreditLimit -1");
+  }
+  catch (CTCLException& e) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+  EQ(size_t(1000), m_pHandler->getSourceCreditLimit());
+}
+
+// Nothing happens while sources are in budget.
+
+void CreditTests::underBudget()
+{
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 2, 50, 100);
+  appendFragment(buffer, 1, 100, 900);
+  addFragments(m_pHandler, buffer);
+
+  ASSERT(m_observer.m_throttled.empty());
+  ASSERT(m_pHandler->m_throttledSockets.empty());
+}
+
+// A leading source over budget gets its socket throttled, once.
+
+void CreditTests::leaderThrottled()
+{
+  throttleA();
+  EQ(size_t(1), m_observer.m_throttled.size());
+  EQ(std::string("sockA"), m_observer.m_throttled[0]);
+  EQ(size_t(1), m_pHandler->m_throttledSockets.count("sockA"));
+
+  m_pHandler->checkCredits();
+  EQ(size_t(1), m_observer.m_throttled.size());
+  ASSERT(m_observer.m_released.empty());
+}
+
+// The lagging source can go over budget; the merge needs its data.
+
+void CreditTests::laggerNotThrottled()
+{
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 1, 100, 1200);
+  appendFragment(buffer, 2, 500, 10);
+  addFragments(m_pHandler, buffer);
+
+  ASSERT(m_observer.m_throttled.empty());
+}
+
+// A socket with an empty source queue is needed even if another of its
+// sources is over budget.
+
+void CreditTests::emptyQueueNeeded()
+{
+  m_pHandler->createSourceQueue("sockA", 3);
+  throttleA();
+  ASSERT(m_observer.m_throttled.empty());
+}
+
+// Release only happens once all sources of the socket are below 3/4 of
+// the budget.
+
+void CreditTests::hysteresis()
+{
+  throttleA();
+  popOne(m_pHandler);               // Source 2.
+  popOne(m_pHandler);               // 800 bytes left in source 1.
+  m_pHandler->checkCredits();
+  ASSERT(m_observer.m_released.empty());
+
+  popOne(m_pHandler);               // 400 left.
+  m_pHandler->checkCredits();
+  EQ(size_t(1), m_observer.m_released.size());
+  EQ(std::string("sockA"), m_observer.m_released[0]);
+  ASSERT(m_pHandler->m_throttledSockets.empty());
+}
+
+// A budget of 0 turns flow control off and releases throttled sockets.
+
+void CreditTests::disable()
+{
+  throttleA();
+  m_pHandler->setSourceCreditLimit(0);
+  EQ(size_t(1), m_observer.m_released.size());
+
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 1, 400, 5000);
+  addFragments(m_pHandler, buffer);
+  EQ(size_t(1), m_observer.m_throttled.size());
+}
+
+// Credits and throttling show up in the input statistics.
+
+void CreditTests::statistics()
+{
+  throttleA();
+  CFragmentHandler::InputStatistics stats = m_pHandler->getStatistics();
+  EQ(size_t(2), stats.s_queueStats.size());
+
+  CFragmentHandler::QueueStatistics& s1(stats.s_queueStats[0]);
+  EQ(uint32_t(1), s1.s_queueId);
+  EQ(size_t(0), s1.s_credit);
+  ASSERT(s1.s_throttled);
+
+  CFragmentHandler::QueueStatistics& s2(stats.s_queueStats[1]);
+  EQ(uint32_t(2), s2.s_queueId);
+  EQ(size_t(900), s2.s_credit);
+  ASSERT(!s2.s_throttled);
+}
+
+// A failed socket is no longer throttled.
+
+void CreditTests::socketFailed()
+{
+  throttleA();
+  m_pHandler->markSocketFailed("sockA");
+  ASSERT(m_pHandler->m_throttledSockets.empty());
+}
+
+// The Tcl scripts are called with the socket name.
+
+void CreditTests::tclScripts()
+{
+  CCreditCallbackCommand cmd(*m_pInterp, "oncredit");
+  m_pInterp->Eval("set ::throttled {}; set ::released {}");
+  m_pInterp->Eval("oncredit add {lappend ::throttled} {lappend ::released}");
+
+  throttleA();
+  m_pHandler->setSourceCreditLimit(0);
+
+  CTCLVariable throttled(m_pInterp, "::throttled", false);
+  CTCLVariable released(m_pInterp, "::released", false);
+  EQ(std::string("sockA"), std::string(throttled.Get()));
+  EQ(std::string("sockA"), std::string(released.Get()));
+}
+
+void CreditTests::tclRemove()
+{
+  CCreditCallbackCommand cmd(*m_pInterp, "oncredit");
+  m_pInterp->Eval("oncredit add a b");
+  m_pInterp->Eval("oncredit add c d");
+  EQ(size_t(3), m_pHandler->m_sourceFlowObservers.size());
+
+  m_pInterp->Eval("oncredit remove c d");
+  EQ(size_t(2), m_pHandler->m_sourceFlowObservers.size());
+}
+
+void CreditTests::tclRemoveNoSuch()
+{
+  CCreditCallbackCommand cmd(*m_pInterp, "oncredit");
+  m_pInterp->Eval("oncredit add a b");
+  bool thrown = false;
+  try {
+    m_pInterp->Eval("oncredit remove b a");
+  }
+  catch (CTCLException& e) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
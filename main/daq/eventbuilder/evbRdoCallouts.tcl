@@ -102,6 +102,8 @@ namespace eval ::EVBC {
     
     variable XoffThreshold      ""
     variable XonThreshold       ""
+    variable shards             ""
+    variable SourceCreditLimit  ""
 }
 
 
@@ -311,7 +313,7 @@ proc EVBC::start args {
     
     # If any parameters have been set push those out now:
     
-    foreach param [list window XoffThreshold XonThreshold] {
+    foreach param [list window XoffThreshold XonThreshold shards SourceCreditLimit] {
         set value [set ::EVBC::$param]
         if {$value ne ""} {
             EVBC::configParams $param $value
@@ -688,8 +690,12 @@ proc EVBC::onEnd {} {
 #                    * window set number of seconds in the build window.
 #                    * XoffThreshold - set the number of queued bytes before xoffing.
 #                    * XonThreshold  - set then umber of queued bytes at which XON
+#                    * shards - set the number of threads that sort fragments.
+#                    * SourceCreditLimit - set the number of queued bytes a source
+#                      may have before its socket is throttled (0 turns
+#                      per source flow control off).
 # @param value    - A new positive integer value (all config parameters above take
-#                   positive integers).
+#                   positive integers, SourceCreditLimit may also be 0).
 #
 # @note - it is an error (not caught) for XonThreshold to be larger than Xoffthreshold.
 # @note - I actually anticipate the user is going to mostly adjust the build window
@@ -699,7 +705,7 @@ proc EVBC::configParams {parameter value} {
     
     # Validate the parameter name:
     
-    set configParams [list window XoffThreshold XonThreshold]
+    set configParams [list window XoffThreshold XonThreshold shards SourceCreditLimit]
     if {$parameter ni $configParams} {
         error "EVBC::configure $parameter must be one of [join $configParams {, }]"
     }
@@ -708,7 +714,9 @@ proc EVBC::configParams {parameter value} {
     if {![string is integer -strict $value]} {
         error "EVBC::configure $parameter value $value must be an integer and is not"
     }
-    if {$value <= 0} {
+    if {($parameter eq "SourceCreditLimit") && ($value == 0)} {
+        # Turns off per source flow control.
+    } elseif {$value <= 0} {
         error "EVBC::configure $parameter value $value must be strictly > 0"
     }
     
@@ -0,0 +1,376 @@
+// Tests of the sharded (multi-threaded) sort in the event orderer.
+
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+// This dodge is used to ensure we can construct
+// and not treat the fragment handler as a singleton.
+
+#define private public
+#include "CFragmentHandler.h"
+#undef private
+
+
+#include "fragment.h"
+
+// Build a flat fragment (no body) in a buffer.
+
+static void
+appendFragment(std::vector<uint8_t>& buffer, uint32_t sourceId, uint64_t timestamp,
+               uint32_t barrier = 0)
+{
+  EVB::FragmentHeader header;
+  header.s_timestamp = timestamp;
+  header.s_sourceId  = sourceId;
+  header.s_size      = 0;
+  header.s_barrier   = barrier;
+  uint8_t* p = reinterpret_cast<uint8_t*>(&header);
+  buffer.insert(buffer.end(), p, p + sizeof(header));
+}
+
+static void
+addFragments(CFragmentHandler* pHandler, std::vector<uint8_t>& buffer)
+{
+  pHandler->addFragments(
+    buffer.size(), reinterpret_cast<EVB::pFlatFragment>(&buffer[0])
+  );
+}
+
+// Extract timestamps from a list of fragments and free them.
+
+static std::vector<uint64_t>
+timestamps(std::vector<EVB::pFragment>& fragments)
+{
+  std::vector<uint64_t> result;
+  for (size_t i = 0; i < fragments.size(); i++) {
+    result.push_back(fragments[i]->s_header.s_timestamp);
+    freeFragment(fragments[i]);
+  }
+  fragments.clear();
+  return result;
+}
+
+// Extract source ids from a list of fragments and free them.
+
+static std::vector<uint32_t>
+sourceIds(std::vector<EVB::pFragment>& fragments)
+{
+  std::vector<uint32_t> result;
+  for (size_t i = 0; i < fragments.size(); i++) {
+    result.push_back(fragments[i]->s_header.s_sourceId);
+    freeFragment(fragments[i]);
+  }
+  fragments.clear();
+  return result;
+}
+
+class ShardTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ShardTests);
+  CPPUNIT_TEST(defaultCount);
+  CPPUNIT_TEST(assignment);
+  CPPUNIT_TEST(backToSerial);
+  CPPUNIT_TEST(sameOrder);
+  CPPUNIT_TEST(sameOrderTies);
+  CPPUNIT_TEST(partial);
+  CPPUNIT_TEST(anomalies);
+  CPPUNIT_TEST(late);
+  CPPUNIT_TEST(barrier);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+    CFragmentHandler* m_pFragHandler;
+    Tcl_Interp*       m_pInterp;           // Needed to make an event loop
+public:                                    // for the timer handler.
+  void setUp() {
+    m_pInterp = Tcl_CreateInterp();
+    m_pFragHandler = new CFragmentHandler();
+  }
+  void tearDown() {
+    delete m_pFragHandler;
+    Tcl_DeleteInterp(m_pInterp);
+  }
+protected:
+  void defaultCount();
+  void assignment();
+  void backToSerial();
+  void sameOrder();
+  void sameOrderTies();
+  void partial();
+  void anomalies();
+  void late();
+  void barrier();
+private:
+  std::vector<uint64_t> serialOrder();
+  std::vector<EVB::pFragment> serialFragments();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ShardTests);
+
+// Pop everything from the queues the way the serial flush does.
+
+std::vector<EVB::pFragment>
+ShardTests::serialFragments()
+{
+  std::vector<EVB::pFragment> fragments;
+  std::pair<time_t, EVB::pFragment>* p;
+  while ((p = m_pFragHandler->popOldest())) {
+    fragments.push_back(p->second);
+    delete p;
+  }
+  return fragments;
+}
+std::vector<uint64_t>
+ShardTests::serialOrder()
+{
+  std::vector<EVB::pFragment> fragments = serialFragments();
+  return timestamps(fragments);
+}
+
+// Sorting is serial by default.
+
+void ShardTests::defaultCount()
+{
+  EQ(unsigned(1), m_pFragHandler->getShardCount());
+  EQ(size_t(0), m_pFragHandler->m_shards.size());
+}
+
+// Queues are dealt to shards round robin, both existing queues when the
+// shards are made and new ones later on.
+
+void ShardTests::assignment()
+{
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 5, 100);
+  appendFragment(buffer, 2, 100);
+  addFragments(m_pFragHandler, buffer);
+
+  m_pFragHandler->setShardCount(2);
+  EQ(unsigned(2), m_pFragHandler->getShardCount());
+  EQ(unsigned(0), m_pFragHandler->getSourceQueue(2).s_shard); // id order.
+  EQ(unsigned(1), m_pFragHandler->getSourceQueue(5).s_shard);
+
+  EQ(unsigned(0), m_pFragHandler->getSourceQueue(3).s_shard);
+  EQ(unsigned(1), m_pFragHandler->getSourceQueue(1).s_shard);
+
+  m_pFragHandler->flushQueues(true);
+}
+
+// Setting 1 shard stops the threads.
+
+void ShardTests::backToSerial()
+{
+  m_pFragHandler->setShardCount(4);
+  EQ(unsigned(4), m_pFragHandler->getShardCount());
+  m_pFragHandler->setShardCount(1);
+  EQ(unsigned(1), m_pFragHandler->getShardCount());
+  EQ(size_t(0), m_pFragHandler->m_shards.size());
+}
+
+// The sharded sort produces the same order as the serial one.
+
+void ShardTests::sameOrder()
+{
+  std::vector<uint8_t> buffer;
+  srand(1234);
+  for (uint32_t src = 0; src < 8; src++) {
+    uint64_t ts = rand() % 50;
+    for (int i = 0; i < 100; i++) {
+      appendFragment(buffer, src, ts);
+      ts += 1 + rand() % 100;
+    }
+  }
+  addFragments(m_pFragHandler, buffer);
+  std::vector<uint64_t> serial = serialOrder();
+  EQ(size_t(800), serial.size());
+
+  m_pFragHandler->m_nTotalFragmentSize = 0;  // popOldest doesn't count.
+
+  m_pFragHandler->setShardCount(3);
+  addFragments(m_pFragHandler, buffer);
+  EQ(size_t(800), m_pFragHandler->m_nTotalFragmentSize);
+  std::vector<EVB::pFragment> fragments;
+  m_pFragHandler->popSharded(true, fragments);
+  std::vector<uint64_t> sharded = timestamps(fragments);
+
+  ASSERT(serial == sharded);
+  EQ(size_t(0), m_pFragHandler->m_nTotalFragmentSize);
+  ASSERT(m_pFragHandler->queuesEmpty());
+}
+
+// Fragments of one event have the same timestamp in all sources; the
+// sharded sort must put them in source id order as the serial sort does
+// even though the sources are in different shards.
+
+void ShardTests::sameOrderTies()
+{
+  std::vector<uint8_t> buffer;
+  for (uint64_t ts = 100; ts <= 300; ts += 100) {
+    for (uint32_t src = 0; src < 4; src++) {
+      appendFragment(buffer, src, ts);
+    }
+  }
+  addFragments(m_pFragHandler, buffer);
+  std::vector<EVB::pFragment> fragments = serialFragments();
+  std::vector<uint32_t> serial = sourceIds(fragments);
+  EQ(size_t(12), serial.size());
+  EQ(uint32_t(1), serial[1]);
+
+  m_pFragHandler->m_nTotalFragmentSize = 0;  // popOldest doesn't count.
+
+  m_pFragHandler->setShardCount(2);
+  addFragments(m_pFragHandler, buffer);
+  m_pFragHandler->popSharded(true, fragments);
+  std::vector<uint32_t> sharded = sourceIds(fragments);
+
+  ASSERT(serial == sharded);
+}
+
+// Without a complete flush only fragments up to the newest fragment of
+// the queue that runs dry first come out.
+
+void ShardTests::partial()
+{
+  m_pFragHandler->setShardCount(2);
+
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 1, 10);
+  appendFragment(buffer, 1, 20);
+  appendFragment(buffer, 1, 30);
+  appendFragment(buffer, 2, 15);
+  addFragments(m_pFragHandler, buffer);
+
+  std::vector<EVB::pFragment> fragments;
+  m_pFragHandler->popSharded(false, fragments);
+  std::vector<uint64_t> stamps = timestamps(fragments);
+  EQ(size_t(2), stamps.size());
+  EQ(uint64_t(10), stamps[0]);
+  EQ(uint64_t(15), stamps[1]);
+
+  // Now that source 2 is empty, nothing more can come out:
+
+  m_pFragHandler->popSharded(false, fragments);
+  EQ(size_t(0), fragments.size());
+
+  m_pFragHandler->popSharded(true, fragments);
+  stamps = timestamps(fragments);
+  EQ(size_t(2), stamps.size());
+  EQ(uint64_t(20), stamps[0]);
+  EQ(uint64_t(30), stamps[1]);
+}
+
+// Duplicate and out of order input observers fire in batch order.
+
+class DupObserver : public CFragmentHandler::DuplicateTimestampObserver
+{
+public:
+  std::vector<uint32_t> m_sources;
+  void operator()(uint32_t sourceId, uint64_t timestamp) {
+    m_sources.push_back(sourceId);
+  }
+};
+
+class OrderObserver : public CFragmentHandler::NonMonotonicTimestampObserver
+{
+public:
+  std::vector<uint64_t> m_stamps;
+  void operator()(unsigned sourceId, uint64_t priorTimestamp, uint64_t thisTimestamp) {
+    m_stamps.push_back(thisTimestamp);
+  }
+};
+
+void ShardTests::anomalies()
+{
+  DupObserver   dups;
+  OrderObserver order;
+  m_pFragHandler->addDuplicateTimestampObserver(&dups);
+  m_pFragHandler->addNonMonotonicTimestampObserver(&order);
+  m_pFragHandler->setShardCount(2);
+
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 2, 100);
+  appendFragment(buffer, 1, 100);
+  appendFragment(buffer, 1, 100);   // dup on 1.
+  appendFragment(buffer, 2, 100);   // dup on 2.
+  appendFragment(buffer, 2, 50);    // backwards on 2.
+  appendFragment(buffer, 1, 40);    // backwards on 1.
+  addFragments(m_pFragHandler, buffer);
+
+  EQ(size_t(2), dups.m_sources.size());
+  EQ(uint32_t(1), dups.m_sources[0]);
+  EQ(uint32_t(2), dups.m_sources[1]);
+
+  EQ(size_t(2), order.m_stamps.size());
+  EQ(uint64_t(50), order.m_stamps[0]);
+  EQ(uint64_t(40), order.m_stamps[1]);
+
+  m_pFragHandler->flushQueues(true);
+}
+
+// Data late is still detected when sharded.
+
+class LateObserver : public CFragmentHandler::DataLateObserver {
+public:
+  bool m_called;
+  LateObserver() :m_called(false) {}
+  void operator()(const ::EVB::Fragment& fragment,  uint64_t newest) {
+    m_called = true;
+  }
+};
+
+void ShardTests::late()
+{
+  LateObserver lateHandler;
+  m_pFragHandler->setBuildWindow(0);
+  m_pFragHandler->addDataLateObserver(&lateHandler);
+  m_pFragHandler->setShardCount(2);
+
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 1, 100);
+  addFragments(m_pFragHandler, buffer);
+  m_pFragHandler->flushQueues();
+
+  buffer.clear();
+  appendFragment(buffer, 2, 50);
+  addFragments(m_pFragHandler, buffer);
+  m_pFragHandler->flushQueues();
+
+  ASSERT(lateHandler.m_called);
+}
+
+// Barriers come out as barriers and their count is maintained.
+
+class GoodBarrierObserver : public CFragmentHandler::BarrierObserver {
+public:
+  std::vector<std::pair<uint32_t,uint32_t> > m_record;
+  void operator()(const std::vector<std::pair<uint32_t,uint32_t> >& barrierTypes) {
+    m_record = barrierTypes;
+  }
+};
+
+void ShardTests::barrier()
+{
+  GoodBarrierObserver barriers;
+  m_pFragHandler->addBarrierObserver(&barriers);
+  m_pFragHandler->setShardCount(2);
+
+  std::vector<uint8_t> buffer;
+  appendFragment(buffer, 1, 10);
+  appendFragment(buffer, 1, 101, 1);
+  appendFragment(buffer, 2, 102, 2);
+  addFragments(m_pFragHandler, buffer);
+  EQ(uint32_t(1), m_pFragHandler->getSourceQueue(1).s_barriers);
+
+  m_pFragHandler->flushQueues();
+
+  EQ(size_t(2), barriers.m_record.size());
+  EQ(uint32_t(0), m_pFragHandler->getSourceQueue(1).s_barriers);
+  EQ(uint32_t(0), m_pFragHandler->getSourceQueue(2).s_barriers);
+  ASSERT(m_pFragHandler->queuesEmpty());
+}
@@ -15,6 +15,7 @@
  */
 
 #include "CDataFormatItem.h"
+#include "RingItemView.h"
 #include "DataFormat.h"
 
 #include <sstream>
@@ -60,6 +61,16 @@ CDataFormatItem::CDataFormatItem(const CRingItem& rhs) throw(std::bad_cast) :
         throw std::bad_cast();
     }
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a data format item.
+ */
+CDataFormatItem::CDataFormatItem(const CDataFormatItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 /**
  * Assignment
  *
@@ -28,6 +28,8 @@
 #endif
 
 
+class CDataFormatItemView;
+
 /**
  * @class CDataFormatItem
  *
@@ -49,6 +51,7 @@ public:
     
     CDataFormatItem(const CDataFormatItem& rhs);
     CDataFormatItem(const CRingItem& rhs) throw(std::bad_cast);
+    CDataFormatItem(const CDataFormatItemView& view) throw(std::bad_cast);
     
     CDataFormatItem& operator=(const CDataFormatItem& rhs);
     CDataFormatItem& operator=(const CRingItem& rhs) throw(std::bad_cast);
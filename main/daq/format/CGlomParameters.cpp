@@ -14,6 +14,7 @@
  * @author  Ron Fox <fox@nscl.msu.edu>
  */
 #include "CGlomParameters.h"
+#include "RingItemView.h"
 #include "DataFormat.h"
 #include <sstream>
 
@@ -92,6 +93,16 @@ CGlomParameters::CGlomParameters(const CRingItem& rhs) throw(std::bad_cast) :
 {
     if (type() != EVB_GLOM_INFO) throw std::bad_cast();        
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a glom parameters item.
+ */
+CGlomParameters::CGlomParameters(const CGlomParametersView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 /**
  * operator=
  *
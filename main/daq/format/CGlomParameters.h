@@ -27,6 +27,8 @@
 #endif
 #endif
 
+class CGlomParametersView;
+
 /**
  * @class CGlomParameters
  *
@@ -53,6 +55,7 @@ public:
     virtual ~CGlomParameters();
     CGlomParameters(const CGlomParameters& rhs);
     CGlomParameters(const CRingItem& rhs) throw(std::bad_cast);
+    CGlomParameters(const CGlomParametersView& view) throw(std::bad_cast);
     
     CGlomParameters& operator=(const CGlomParameters& rhs);
     int operator==(const CGlomParameters& rhs) const;
@@ -15,6 +15,7 @@
 */
 
 #include "CPhysicsEventItem.h"
+#include "RingItemView.h"
 #include "DataFormat.h"
 #include <sstream>
 #include <stdio.h>
@@ -48,6 +49,16 @@ CPhysicsEventItem::CPhysicsEventItem(const CRingItem& rhs) throw(std::bad_cast)
     throw std::bad_cast();
   }
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a physics event item.
+ */
+CPhysicsEventItem::CPhysicsEventItem(const CPhysicsEventItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 
 
 CPhysicsEventItem::CPhysicsEventItem(const CPhysicsEventItem& rhs) :
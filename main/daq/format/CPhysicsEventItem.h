@@ -56,6 +56,8 @@ struct _RingItem;
  *  else just delegates to the base class.
  */
 
+class CPhysicsEventItemView;
+
 class CPhysicsEventItem : public CRingItem
 {
 public:
@@ -64,6 +66,7 @@ public:
                     size_t maxBody=8192);
 
   CPhysicsEventItem(const CRingItem& rhs) throw(std::bad_cast);
+  CPhysicsEventItem(const CPhysicsEventItemView& view) throw(std::bad_cast);
   CPhysicsEventItem(const CPhysicsEventItem& rhs);
   virtual ~CPhysicsEventItem();
 
@@ -15,6 +15,7 @@
 */
 
 #include "CRingFragmentItem.h"
+#include "RingItemView.h"
 #include "DataFormat.h"
 #include "CRingItemFactory.h"
 
@@ -74,6 +75,16 @@ CRingFragmentItem::CRingFragmentItem(const CRingItem& rhs) throw(std::bad_cast)
   updateSize();
 
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a fragment item.
+ */
+CRingFragmentItem::CRingFragmentItem(const CFragmentItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 
 /**
  * Copy constructor.
@@ -36,6 +36,8 @@
 typedef struct _EventBuilderFragment *pEventBuilderFragment;
 
 
+class CFragmentItemView;
+
 /**
  * class to encapsulate ring items that are actually event builder output fragments.
  */
@@ -50,6 +52,7 @@ public:
 		    const void* pBody,
 		    uint32_t barrier=0);
   CRingFragmentItem(const CRingItem& rhs) throw(std::bad_cast);
+  CRingFragmentItem(const CFragmentItemView& view) throw(std::bad_cast);
   CRingFragmentItem(const CRingFragmentItem& rhs);
 
   virtual ~CRingFragmentItem();
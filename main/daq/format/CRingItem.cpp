@@ -17,6 +17,7 @@
 #include <config.h>
 #include "CRingItem.h"
 #include "DataFormat.h"
+#include "RingItemView.h"
 
 #include <CRingBuffer.h>
 #include <CRingSelectionPredicate.h>
@@ -112,6 +113,22 @@ CRingItem::CRingItem(const CRingItem& rhs)
 
   copyIn(rhs);
 }
+/**
+ * Construct from a view.
+ *   The raw item the view wraps is copied in exactly once.  The byte order
+ *   of the viewed item is preserved and reflected in mustSwap().
+ *
+ * @param view - View of the item to copy.
+ */
+CRingItem::CRingItem(const CRingItemView& view) :
+  m_swapNeeded(view.mustSwap())
+{
+  size_t size = view.size();
+  m_storageSize = size;
+  newIfNecessary(size);
+  memcpy(m_pItem, view.getItemPointer(), size);
+  m_pCursor = reinterpret_cast<uint8_t*>(m_pItem) + size;
+}
 /*!
     Destroy the item. If the storage size was big, we need to delete the 
     storage as it was dynamically allocated.
@@ -554,6 +571,7 @@ CRingItem::getFromRing(CRingBuffer& ring, CRingSelectionPredicate& predicate)
     std::cerr << "Mismatch in CRingItem::getItem required size: sb " << size << " was " << gotSize 
 	      << std::endl;
   }
+  ring.countItems(1);		// The ring only counts bytes for consumers.
   
   // The ring item was constructed with the cursor pointing as if there's
   // no body header...therefore the arithmetic below is correct whether there
@@ -40,6 +40,7 @@
 
 struct _RingItem;
 class CRingBuffer;
+class CRingItemView;
 class CRingSelectionPredicate;
 
 // Constants:
@@ -77,6 +78,7 @@ public:
   CRingItem(uint16_t type, uint64_t timestamp, uint32_t sourceId,
             uint32_t barrierType = 0, size_t maxBody = CRingItemStaticBufferSize - 10);
   CRingItem(const CRingItem& rhs);
+  explicit CRingItem(const CRingItemView& view);
   virtual ~CRingItem();
   
   CRingItem& operator=(const CRingItem& rhs);
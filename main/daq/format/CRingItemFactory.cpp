@@ -29,6 +29,7 @@
 #include "CGlomParameters.h"
 #include "CAbnormalEndItem.h"
 #include "DataFormat.h"
+#include "RingItemView.h"
 
 #include <vector>
 #include <string>
@@ -147,16 +148,38 @@ CRingItemFactory::createRingItem(const void* pItem)
   if (!isKnownItemType(pItem)) {
     throw std::string("CRingItemFactory::createRingItem - unknown ring item type");
   }
-  /* Make a 'vanilla' CRing item that we can pass into the other creator */
-
-  const RingItem* pRitem = reinterpret_cast<const RingItem*>(pItem);
-  CRingItem baseItem(pRitem->s_header.s_type, pRitem->s_header.s_size);
-  uint8_t*  pBody  = reinterpret_cast<uint8_t*>(baseItem.getItemPointer());
-  memcpy(pBody, pRitem, pRitem->s_header.s_size);
-  pBody += pRitem->s_header.s_size;
-  baseItem.setBodyCursor(pBody);
-  baseItem.updateSize();
-
+  /*
+     Types that can be built directly from a view are copied exactly once.
+     The rest go through a 'vanilla' CRingItem that we pass into the
+     other creator.
+  */
+
+  CRingItemView view(pItem);
+  switch (view.type()) {
+  case BEGIN_RUN:
+  case END_RUN:
+  case PAUSE_RUN:
+  case RESUME_RUN:
+    return new CRingStateChangeItem(CStateChangeItemView(pItem));
+  case PACKET_TYPES:
+  case MONITORED_VARIABLES:
+    return new CRingTextItem(CTextItemView(pItem));
+  case PERIODIC_SCALERS:
+    return new CRingScalerItem(CScalerItemView(pItem));
+  case PHYSICS_EVENT:
+    return new CPhysicsEventItem(CPhysicsEventItemView(pItem));
+  case PHYSICS_EVENT_COUNT:
+    return new CRingPhysicsEventCountItem(CPhysicsEventCountItemView(pItem));
+  case EVB_FRAGMENT:
+    return new CRingFragmentItem(CFragmentItemView(pItem));
+  case EVB_GLOM_INFO:
+    return new CGlomParameters(CGlomParametersView(pItem));
+  case RING_FORMAT:
+    return new CDataFormatItem(CDataFormatItemView(pItem));
+  default:
+    break;
+  }
+  CRingItem baseItem(view);
   return createRingItem(baseItem);
 }
 /**
@@ -15,6 +15,7 @@
 */
 #include <config.h>
 #include "CRingPhysicsEventCountItem.h"
+#include "RingItemView.h"
 #include <sstream>
 
 using namespace std;
@@ -132,6 +133,16 @@ CRingPhysicsEventCountItem::CRingPhysicsEventCountItem(const CRingItem& rhs) thr
   }
   init();
 
+}
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a physics event count item.
+ */
+CRingPhysicsEventCountItem::CRingPhysicsEventCountItem(const CPhysicsEventCountItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
 }
 /*!
   Construction from an existing physics event count item.
@@ -48,6 +48,7 @@
 #endif
 #endif
 
+class CPhysicsEventCountItemView;
 
 /*!
    The physics event count item provides periodic informatino about how
@@ -76,6 +77,7 @@ public:
     int divisor=1);
   
   CRingPhysicsEventCountItem(const CRingItem& rhs)  throw(std::bad_cast);
+  CRingPhysicsEventCountItem(const CPhysicsEventCountItemView& view) throw(std::bad_cast);
   CRingPhysicsEventCountItem(const CRingPhysicsEventCountItem& rhs);
 
   virtual ~CRingPhysicsEventCountItem();
@@ -15,6 +15,7 @@
 */
 #include <config.h>
 #include "CRingScalerItem.h"
+#include "RingItemView.h"
 #include <time.h>
 #include <string.h>
 #include <sstream>
@@ -142,6 +143,16 @@ CRingScalerItem::CRingScalerItem(const CRingItem& rhs) throw(bad_cast) :
   updateSize();
   
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a scaler item.
+ */
+CRingScalerItem::CRingScalerItem(const CScalerItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 
 /*!
   Ordinary copy construction
@@ -51,6 +51,8 @@
 #endif
 #endif
 
+class CScalerItemView;
+
 /*!
    This class derived from CRingItem and represents a set of scalers that have been 
    formatted as a ring item.  
@@ -77,6 +79,7 @@ public:
 		  std::vector<uint32_t> scalers,
                   uint32_t timeDivisor = 1, bool incremental=true);
   CRingScalerItem(const CRingItem& rhs) throw(std::bad_cast);
+  CRingScalerItem(const CScalerItemView& view) throw(std::bad_cast);
   CRingScalerItem(const CRingScalerItem& rhs);
   
   virtual ~CRingScalerItem();
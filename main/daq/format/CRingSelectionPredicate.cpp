@@ -35,7 +35,8 @@ static const size_t DEFAULT_HIGH_WATER(2*1024*1024); // Default high water mark.
   selection that has an appropriate name for how the selection is used.
 */
 CRingSelectionPredicate::CRingSelectionPredicate() : 
-  m_highWaterMark(DEFAULT_HIGH_WATER)
+  m_highWaterMark(DEFAULT_HIGH_WATER),
+  m_skipSampled(false)
 {
 }
 
@@ -45,7 +46,9 @@ CRingSelectionPredicate::CRingSelectionPredicate() :
  \param uint32_t*  - C array of types.
 */
 CRingSelectionPredicate::CRingSelectionPredicate(unsigned int nTypes,
-						 uint32_t* types)
+						 uint32_t* types) :
+  m_highWaterMark(DEFAULT_HIGH_WATER),
+  m_skipSampled(false)
 {
   vector<ItemType> selection;
   for (int i =0; i < nTypes; i++) {
@@ -64,7 +67,9 @@ CRingSelectionPredicate::CRingSelectionPredicate(unsigned int nTypes,
 */
 CRingSelectionPredicate::CRingSelectionPredicate(unsigned int nTypes,
 						 uint32_t* type,
-						 bool*     sample)
+						 bool*     sample) :
+  m_highWaterMark(DEFAULT_HIGH_WATER),
+  m_skipSampled(false)
 {
   vector<ItemType> selection;
   for (int i =0; i < nTypes; i++) {
@@ -77,7 +82,9 @@ CRingSelectionPredicate::CRingSelectionPredicate(unsigned int nTypes,
   Copy construction.
 */
 CRingSelectionPredicate::CRingSelectionPredicate(const CRingSelectionPredicate& rhs) : 
-  m_selections(rhs.m_selections)
+  m_selections(rhs.m_selections),
+  m_highWaterMark(rhs.m_highWaterMark),
+  m_skipSampled(false)
 {
   
 }
@@ -174,6 +181,13 @@ CRingSelectionPredicate::setHighWaterMark(size_t newValue)
 bool
 CRingSelectionPredicate::operator()(CRingBuffer& ring)
 {
+  // If the ring's item index can take us past unwanted items, let it.
+  // Sampled items are unwanted while the ring is past the high water mark.
+
+  m_skipSampled = hasSampledTypes() &&
+    (ring.availablePutSpace() < m_highWaterMark);
+  ring.skipUnwanted(*this);
+
   // We need to have at least a header:
 
   if (ring.availableData() < sizeof(RingItemHeader)) {
@@ -228,15 +242,16 @@ CRingSelectionPredicate::operator()(CRingBuffer& ring)
     // If the type is not in the selection list we can also return false.
     //
 
-    CRingBuffer::Usage usage = ring.getUsage();
-    size_t freeSpace     = usage.s_putSpace;
-    size_t availableData = ring.availableData();
-
     SelectionMapIterator p = find(header.s_type);
     if (p == end()) {
       return false;
     }
     if (p->second.s_sampled) {
+      // Only sampled items need to know how full the ring is:
+
+      size_t freeSpace     = ring.availablePutSpace();
+      size_t availableData = ring.availableData();
+
       if (freeSpace     >= m_highWaterMark) {
 	return false;		// full item is in ring, and below high water.
       } 
@@ -260,6 +275,31 @@ CRingSelectionPredicate::operator()(CRingBuffer& ring)
   
 }
 
+/*!
+  Type filter interface for the ring item index.  The index should
+  skip the items we would skip: those selectThis rejects and, while the
+  ring was past the high water mark when we were last called, sampled
+  ones.  Unlike the header by header path, which stops skipping sampled
+  items as soon as the ring drops below the high water mark, the index
+  skips the whole run.  For sampling consumers that just means catching
+  up to the newest data.
+
+  \param type - an item type.
+  \return bool - true if items of that type are not wanted.
+*/
+bool
+CRingSelectionPredicate::skip(uint32_t type)
+{
+  if (selectThis(type)) {
+    return true;
+  }
+  if (m_skipSampled) {
+    SelectionMapIterator p = find(type);
+    return (p != end()) && p->second.s_sampled;
+  }
+  return false;
+}
+
 /*!
   Select an item that matches the prediate from the ring buffer.
   The caller will block until a matching item is found in the ring.
@@ -320,6 +360,20 @@ CRingSelectionPredicate::end()
 {
   return m_selections.end();
 }
+/*
+ * True if any of the selected types are sampled.
+ */
+bool
+CRingSelectionPredicate::hasSampledTypes() const
+{
+  for (SelectionMap::const_iterator p = m_selections.begin();
+       p != m_selections.end(); p++) {
+    if (p->second.s_sampled) {
+      return true;
+    }
+  }
+  return false;
+}
 /*
  * Does a byte swap on a longword.
  */
@@ -58,9 +58,15 @@ class CRingBuffer;
    This base class has quite a bit of the mechanisms of predicates that select 
    items on the basis of their item type.
 
+   The predicate is also a type filter for the ring's item index.  If the
+   ring has an index and PHYSICS_EVENT items are not wanted, or are
+   sampled and the ring is past the high water mark, runs of them are
+   skipped in one go without looking at their headers.
+
 
 */
-class CRingSelectionPredicate : public CRingBuffer::CRingBufferPredicate
+class CRingSelectionPredicate : public CRingBuffer::CRingBufferPredicate,
+                                public CRingItemIndex::CTypeFilter
 {
   // internal types:
 
@@ -89,6 +95,7 @@ protected:
 private:
   SelectionMap  m_selections;
   size_t        m_highWaterMark; // When to start skipping for sampled data.
+  bool          m_skipSampled;   // Ring is past the high water mark.
 
   // Constructors and canonicals.
 
@@ -114,6 +121,7 @@ public:
 
   virtual bool operator()(CRingBuffer& ring);
   virtual bool selectThis(uint32_t type) = 0;
+  virtual bool skip(uint32_t type);
   void selectItem(CRingBuffer& ring);
   size_t getNumberOfSelections() const { return m_selections.size(); }
 
@@ -124,6 +132,8 @@ protected:
   SelectionMapIterator end();
   uint32_t longswap(uint32_t input);
   void addSelectionItems(std::vector<ItemType> selections);
+private:
+  bool hasSampledTypes() const;
 };
 
 #endif
@@ -17,6 +17,7 @@
 
 #include <config.h>
 #include "CRingStateChangeItem.h"
+#include "RingItemView.h"
 #include <RangeError.h>
 #include <sstream>
 #include <string.h>
@@ -141,6 +142,16 @@ CRingStateChangeItem::CRingStateChangeItem(const CRingItem& item) throw(std::bad
 
   init();
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a state change item.
+ */
+CRingStateChangeItem::CRingStateChangeItem(const CStateChangeItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 /*!
   Copy construction.
   \param rhs - Basis for the construction.
@@ -44,6 +44,8 @@
 #include <RangeError.h>
 #endif
 
+class CStateChangeItemView;
+
 /*!
   This class represents a state change item.
   State change items are items in the buffer that indicate a change in the state of
@@ -80,6 +82,7 @@ public:
                        uint32_t offsetDivisor = 1);
   
   CRingStateChangeItem(const CRingItem& item) throw(std::bad_cast);
+  CRingStateChangeItem(const CStateChangeItemView& view) throw(std::bad_cast);
   CRingStateChangeItem(const CRingStateChangeItem& rhs);
   virtual ~CRingStateChangeItem();
 
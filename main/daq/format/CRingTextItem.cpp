@@ -17,6 +17,7 @@
 
 #include <config.h>
 #include "CRingTextItem.h"
+#include "RingItemView.h"
 #include <string.h>
 #include <sstream>
 using namespace std;
@@ -115,6 +116,16 @@ CRingTextItem::CRingTextItem(const CRingItem& rhs) throw(bad_cast):
 
   init();
 }
+/**
+ * Construct from a view of a raw ring item.
+ *
+ * @param view - The item view.
+ * @throw std::bad_cast - the view is not of a text item.
+ */
+CRingTextItem::CRingTextItem(const CTextItemView& view) throw(std::bad_cast) :
+  CRingItem(requireRingItemType(view))
+{
+}
 
 /*!
   Copy construction.  
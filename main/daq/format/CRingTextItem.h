@@ -66,6 +66,8 @@
 #endif
 
 
+class CTextItemView;
+
 /*!
   The text ring item provides a mechanism to put an item in/take an item out of 
   a ring buffer that consists of null terminated text strings.  
@@ -90,6 +92,7 @@ public:
     int offsetDivisor = 1
   );
   CRingTextItem(const CRingItem& rhs) throw(std::bad_cast);
+  CRingTextItem(const CTextItemView& view) throw(std::bad_cast);
   CRingTextItem(const CRingTextItem& rhs);
 
   virtual ~CRingTextItem();
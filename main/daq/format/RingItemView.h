@@ -0,0 +1,485 @@
+#ifndef __RINGITEMVIEW_H
+#define __RINGITEMVIEW_H
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2014.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file RingItemView.h
+ * @brief Non-owning, non-virtual views of raw ring items.
+ *
+ *  The CRingItem class hierarchy copies each item into an object it owns
+ *  (and CRingItemFactory makes a second, typed copy).  That's fine for
+ *  producers but is wasteful for consumers that just want to look at
+ *  a few fields of every item that goes by.  The classes in this file
+ *  wrap a pointer to a RingItem that lives somewhere else (a ring buffer
+ *  chunk, a file buffer, a CRingItem) and decode fields in place, swapping
+ *  bytes when the item came from a system with the other byte order.
+ *
+ *  The views never allocate, have no virtual methods and are cheap to copy.
+ *  The caller must ensure the underlying storage outlives the view.
+ *
+ *  Type dispatch is done at compile time via visitRingItem(), which
+ *  calls the visitor overload that matches the item type:
+ *
+ * \verbatim
+ *    struct Counter {
+ *       void operator()(const CScalerItemView& s)  { ... }
+ *       void operator()(const CRingItemView& other) { ... }  // fallback
+ *    };
+ *    Counter c;
+ *    visitRingItem(pItem, c);
+ * \endverbatim
+ */
+
+#ifndef __DATAFORMAT_H
+#include "DataFormat.h"
+#endif
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+#ifndef __CRT_STRING_H
+#include <string.h>
+#ifndef __CRT_STRING_H
+#define __CRT_STRING_H
+#endif
+#endif
+
+#ifndef __CRT_TIME_H
+#include <time.h>
+#ifndef __CRT_TIME_H
+#define __CRT_TIME_H
+#endif
+#endif
+
+#ifndef __STL_TYPEINFO
+#include <typeinfo>
+#ifndef __STL_TYPEINFO
+#define __STL_TYPEINFO
+#endif
+#endif
+
+/*----------------------------------------------------------------------------
+ * Byte order helpers.
+ */
+
+/**
+ * @class CRingItemByteOrder
+ *
+ *   Static helpers for converting ring item data between byte orders.
+ *   The bulk converters are written as simple loops over the builtin
+ *   byte swap so that the compiler can vectorize them.
+ */
+class CRingItemByteOrder
+{
+public:
+  static uint16_t swap16(uint16_t v) { return __builtin_bswap16(v); }
+  static uint32_t swap32(uint32_t v) { return __builtin_bswap32(v); }
+  static uint64_t swap64(uint64_t v) { return __builtin_bswap64(v); }
+
+  /**
+   * swap32InPlace
+   *   Swap an array of longwords in place.
+   * @param p - pointer to the first longword.
+   * @param n - number of longwords.
+   */
+  static void swap32InPlace(uint32_t* p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      p[i] = __builtin_bswap32(p[i]);
+    }
+  }
+  /**
+   * swap16InPlace
+   *   Swap an array of words in place.
+   */
+  static void swap16InPlace(uint16_t* p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      p[i] = __builtin_bswap16(p[i]);
+    }
+  }
+  /**
+   * copy32
+   *   Copy n longwords from src to dest (which may be unaligned),
+   *   swapping if requested.
+   */
+  static void copy32(uint32_t* dest, const void* src, size_t n, bool swap) {
+    memcpy(dest, src, n*sizeof(uint32_t));
+    if (swap) swap32InPlace(dest, n);
+  }
+};
+
+/*----------------------------------------------------------------------------
+ * Generic view.
+ */
+
+/**
+ * @class CRingItemView
+ *
+ *   View of an arbitrary ring item.  Decodes the item header and the
+ *   body header (if present).  All the typed views derive from this
+ *   (non virtually) so the generic accessors are available everywhere.
+ */
+class CRingItemView
+{
+protected:
+  const RingItem* m_pItem;
+  bool            m_swap;
+
+public:
+  explicit CRingItemView(const void* pItem) :
+    m_pItem(reinterpret_cast<const RingItem*>(pItem)),
+    m_swap((m_pItem->s_header.s_type & 0xffff) == 0)
+  {}
+
+  // Header level information:
+
+  const RingItem* getItemPointer() const { return m_pItem; }
+  bool     mustSwap() const { return m_swap; }
+  uint32_t type() const { return get32(m_pItem->s_header.s_type); }
+  uint32_t size() const { return get32(m_pItem->s_header.s_size); }
+
+  // Body header:
+
+  bool hasBodyHeader() const {
+    return m_pItem->s_body.u_noBodyHeader.s_mbz != 0;
+  }
+  uint64_t getEventTimestamp() const {
+    return get64(m_pItem->s_body.u_hasBodyHeader.s_bodyHeader.s_timestamp);
+  }
+  uint32_t getSourceId() const {
+    return get32(m_pItem->s_body.u_hasBodyHeader.s_bodyHeader.s_sourceId);
+  }
+  uint32_t getBarrierType() const {
+    return get32(m_pItem->s_body.u_hasBodyHeader.s_bodyHeader.s_barrier);
+  }
+
+  // Body:
+
+  const void* getBodyPointer() const {
+    return hasBodyHeader() ?
+      reinterpret_cast<const void*>(m_pItem->s_body.u_hasBodyHeader.s_body) :
+      reinterpret_cast<const void*>(m_pItem->s_body.u_noBodyHeader.s_body);
+  }
+  size_t getBodySize() const {
+    return size() -
+      (reinterpret_cast<const uint8_t*>(getBodyPointer()) -
+       reinterpret_cast<const uint8_t*>(m_pItem));
+  }
+  /** Pointer to the byte just past the end of this item. */
+  const void* next() const {
+    return reinterpret_cast<const uint8_t*>(m_pItem) + size();
+  }
+
+  // Field decoders usable by derived views:
+
+protected:
+  uint16_t get16(uint16_t v) const { return m_swap ? CRingItemByteOrder::swap16(v) : v; }
+  uint32_t get32(uint32_t v) const { return m_swap ? CRingItemByteOrder::swap32(v) : v; }
+  uint64_t get64(uint64_t v) const { return m_swap ? CRingItemByteOrder::swap64(v) : v; }
+
+  /** Typed body pointer that allows for the optional body header. */
+  template<typename T>
+  const T* body() const {
+    return reinterpret_cast<const T*>(getBodyPointer());
+  }
+};
+
+/*----------------------------------------------------------------------------
+ * Typed views.
+ */
+
+/**
+ * @class CStateChangeItemView
+ *   BEGIN_RUN, END_RUN, PAUSE_RUN, RESUME_RUN items.
+ */
+class CStateChangeItemView : public CRingItemView
+{
+public:
+  explicit CStateChangeItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) {
+    return (type == BEGIN_RUN) || (type == END_RUN) ||
+           (type == PAUSE_RUN) || (type == RESUME_RUN);
+  }
+
+  uint32_t getRunNumber() const  { return get32(b()->s_runNumber); }
+  uint32_t getElapsedTime() const { return get32(b()->s_timeOffset); }
+  uint32_t getTimeDivisor() const { return get32(b()->s_offsetDivisor); }
+  float    computeElapsedTime() const {
+    return static_cast<float>(getElapsedTime())/getTimeDivisor();
+  }
+  time_t   getTimestamp() const  { return get32(b()->s_Timestamp); }
+  /** Title is null terminated in the item; no copy is made. */
+  const char* getTitle() const   { return b()->s_title; }
+private:
+  const StateChangeItemBody* b() const { return body<StateChangeItemBody>(); }
+};
+
+/**
+ * @class CScalerItemView
+ *   PERIODIC_SCALERS items.  The scaler array can be accessed in place via
+ *   getScalerPointer (native byte order only) or copied out, with bulk
+ *   byte swapping, via copyScalers.
+ */
+class CScalerItemView : public CRingItemView
+{
+public:
+  explicit CScalerItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) { return type == PERIODIC_SCALERS; }
+
+  uint32_t getStartTime() const   { return get32(b()->s_intervalStartOffset); }
+  uint32_t getEndTime() const     { return get32(b()->s_intervalEndOffset); }
+  uint32_t getTimeDivisor() const { return get32(b()->s_intervalDivisor); }
+  float    computeStartTime() const {
+    return static_cast<float>(getStartTime())/getTimeDivisor();
+  }
+  float    computeEndTime() const {
+    return static_cast<float>(getEndTime())/getTimeDivisor();
+  }
+  time_t   getTimestamp() const   { return get32(b()->s_timestamp); }
+  bool     isIncremental() const  { return get32(b()->s_isIncremental) != 0; }
+  uint32_t getScalerCount() const { return get32(b()->s_scalerCount); }
+
+  /** Single channel - no range checking. */
+  uint32_t getScaler(uint32_t channel) const {
+    uint32_t v;
+    memcpy(&v, &(b()->s_scalers[channel]), sizeof(v));
+    return get32(v);
+  }
+  /**
+   * In place scaler array; only meaningful if !mustSwap().  The array
+   * need not be aligned, use copyScalers to get at it as uint32_t's.
+   */
+  const void* getScalerPointer() const { return b()->s_scalers; }
+  /**
+   * copyScalers
+   *   Copy at most max scalers into dest in host byte order.
+   * @return number of scalers copied.
+   */
+  size_t copyScalers(uint32_t* dest, size_t max) const {
+    size_t n = getScalerCount();
+    if (n > max) n = max;
+    CRingItemByteOrder::copy32(dest, b()->s_scalers, n, m_swap);
+    return n;
+  }
+private:
+  const ScalerItemBody* b() const { return body<ScalerItemBody>(); }
+};
+
+/**
+ * @class CTextItemView
+ *   PACKET_TYPES and MONITORED_VARIABLES items.  The strings are walked
+ *   in place with firstString/nextString.
+ */
+class CTextItemView : public CRingItemView
+{
+public:
+  explicit CTextItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) {
+    return (type == PACKET_TYPES) || (type == MONITORED_VARIABLES);
+  }
+
+  uint32_t getTimeOffset() const  { return get32(b()->s_timeOffset); }
+  uint32_t getTimeDivisor() const { return get32(b()->s_offsetDivisor); }
+  float    computeElapsedTime() const {
+    return static_cast<float>(getTimeOffset())/getTimeDivisor();
+  }
+  time_t   getTimestamp() const   { return get32(b()->s_timestamp); }
+  uint32_t getStringCount() const { return get32(b()->s_stringCount); }
+
+  const char* firstString() const { return b()->s_strings; }
+  const char* nextString(const char* p) const { return p + strlen(p) + 1; }
+private:
+  const TextItemBody* b() const { return body<TextItemBody>(); }
+};
+
+/**
+ * @class CPhysicsEventItemView
+ *   PHYSICS_EVENT items.  The body is left uninterpreted.
+ */
+class CPhysicsEventItemView : public CRingItemView
+{
+public:
+  explicit CPhysicsEventItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) { return type == PHYSICS_EVENT; }
+};
+
+/**
+ * @class CPhysicsEventCountItemView
+ *   PHYSICS_EVENT_COUNT items.
+ */
+class CPhysicsEventCountItemView : public CRingItemView
+{
+public:
+  explicit CPhysicsEventCountItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) { return type == PHYSICS_EVENT_COUNT; }
+
+  uint32_t getTimeOffset() const  { return get32(b()->s_timeOffset); }
+  uint32_t getTimeDivisor() const { return get32(b()->s_offsetDivisor); }
+  time_t   getTimestamp() const   { return get32(b()->s_timestamp); }
+  uint64_t getEventCount() const  { return get64(b()->s_eventCount); }
+private:
+  const PhysicsEventCountItemBody* b() const {
+    return body<PhysicsEventCountItemBody>();
+  }
+};
+
+/**
+ * @class CFragmentItemView
+ *   EVB_FRAGMENT and EVB_UNKNOWN_PAYLOAD items.  These always have a body
+ *   header; the payload is the item body.
+ */
+class CFragmentItemView : public CRingItemView
+{
+public:
+  explicit CFragmentItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) {
+    return (type == EVB_FRAGMENT) || (type == EVB_UNKNOWN_PAYLOAD);
+  }
+
+  uint64_t    timestamp() const      { return getEventTimestamp(); }
+  uint32_t    source() const         { return getSourceId(); }
+  uint32_t    barrierType() const    { return getBarrierType(); }
+  size_t      payloadSize() const    { return getBodySize(); }
+  const void* payloadPointer() const { return getBodyPointer(); }
+};
+
+/**
+ * @class CGlomParametersView
+ *   EVB_GLOM_INFO items.
+ */
+class CGlomParametersView : public CRingItemView
+{
+public:
+  explicit CGlomParametersView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) { return type == EVB_GLOM_INFO; }
+
+  uint64_t coincidenceTicks() const { return get64(p()->s_coincidenceTicks); }
+  bool     isBuilding() const       { return get16(p()->s_isBuilding) != 0; }
+  uint16_t timestampPolicy() const  { return get16(p()->s_timestampPolicy); }
+private:
+  const GlomParameters* p() const {
+    return reinterpret_cast<const GlomParameters*>(m_pItem);
+  }
+};
+
+/**
+ * @class CDataFormatItemView
+ *   RING_FORMAT items.
+ */
+class CDataFormatItemView : public CRingItemView
+{
+public:
+  explicit CDataFormatItemView(const void* pItem) : CRingItemView(pItem) {}
+  static bool matches(uint32_t type) { return type == RING_FORMAT; }
+
+  uint16_t getMajor() const { return get16(p()->s_majorVersion); }
+  uint16_t getMinor() const { return get16(p()->s_minorVersion); }
+private:
+  const DataFormat* p() const {
+    return reinterpret_cast<const DataFormat*>(m_pItem);
+  }
+};
+
+/*----------------------------------------------------------------------------
+ * Compile time dispatch.
+ */
+
+/**
+ * isRingItemOfType
+ *   @return true if the item pointed to can be viewed as a View.
+ */
+template<typename View>
+inline bool isRingItemOfType(const void* pItem)
+{
+  return View::matches(CRingItemView(pItem).type());
+}
+
+/**
+ * requireRingItemType
+ *   The typed view constructors don't check the type of the item they
+ *   wrap, so that visitRingItem and other callers that have already
+ *   switched on the type don't pay for it again.  Code that can be handed
+ *   a view of the wrong type, e.g. the CRingItem subclass constructors
+ *   that copy from a view, checks it with this.
+ *
+ * @param view - The view to check.
+ * @return the view.
+ * @throw std::bad_cast - the viewed item is not of a type View represents.
+ */
+template<typename View>
+inline const View& requireRingItemType(const View& view)
+{
+  if (!View::matches(view.type())) {
+    throw std::bad_cast();
+  }
+  return view;
+}
+
+/**
+ * visitRingItem
+ *   Wrap pItem in the view that matches its type and hand it to the
+ *   visitor.  Overload resolution selects the visitor member; a visitor
+ *   that only takes a CRingItemView will see every item, one that takes
+ *   const CScalerItemView& and const CRingItemView& sees scalers via
+ *   the first and everything else via the second.
+ *
+ * @param pItem   - Pointer to a raw ring item.
+ * @param visitor - Functor with operator() overloads for the views.
+ */
+template<typename Visitor>
+inline void visitRingItem(const void* pItem, Visitor& visitor)
+{
+  CRingItemView generic(pItem);
+  switch (generic.type()) {
+  case BEGIN_RUN:
+  case END_RUN:
+  case PAUSE_RUN:
+  case RESUME_RUN:
+    visitor(CStateChangeItemView(pItem));
+    break;
+  case PACKET_TYPES:
+  case MONITORED_VARIABLES:
+    visitor(CTextItemView(pItem));
+    break;
+  case PERIODIC_SCALERS:
+    visitor(CScalerItemView(pItem));
+    break;
+  case PHYSICS_EVENT:
+    visitor(CPhysicsEventItemView(pItem));
+    break;
+  case PHYSICS_EVENT_COUNT:
+    visitor(CPhysicsEventCountItemView(pItem));
+    break;
+  case EVB_FRAGMENT:
+  case EVB_UNKNOWN_PAYLOAD:
+    visitor(CFragmentItemView(pItem));
+    break;
+  case EVB_GLOM_INFO:
+    visitor(CGlomParametersView(pItem));
+    break;
+  case RING_FORMAT:
+    visitor(CDataFormatItemView(pItem));
+    break;
+  default:
+    visitor(generic);
+  }
+}
+
+#endif
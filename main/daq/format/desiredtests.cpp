@@ -15,6 +15,7 @@ extern std::string uniqueName(std::string);
 class desiredtests : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(desiredtests);
   CPPUNIT_TEST(selecttest);
+  CPPUNIT_TEST(indexSkipsSampled);
   //  CPPUNIT_TEST(sampletest); /* Changed how sampling worked which invalidates */
   CPPUNIT_TEST_SUITE_END();
 
@@ -31,6 +32,7 @@ public:
   }
 protected:
   void selecttest();
+  void indexSkipsSampled();
   void sampletest();
 };
 
@@ -79,3 +81,34 @@ void desiredtests::sampletest() {
    
 
 }
+
+// Sampled physics events are skipped through the ring's item index while
+// the ring is past the high water mark, but not while it's below it.
+
+void desiredtests::indexSkipsSampled()
+{
+  CRingBuffer prod(uniqueName("pred"), CRingBuffer::producer);
+  CRingBuffer cons(uniqueName("pred"), CRingBuffer::consumer);
+
+  RingItemHeader h = {sizeof(RingItemHeader), PHYSICS_EVENT};
+  for (int i = 0; i < 100; i++) {
+    prod.put(&h, sizeof(h));
+  }
+  h.s_type = PERIODIC_SCALERS;
+  prod.put(&h, sizeof(h));
+
+  CDesiredTypesPredicate p;
+  p.addDesiredType(PHYSICS_EVENT, true);
+  p.addDesiredType(PERIODIC_SCALERS);
+
+  p.setHighWaterMark(0);                        // Never past it.
+  EQ(false, p.skip(PHYSICS_EVENT));
+  ASSERT(!p(cons));
+  EQ(101*sizeof(h), cons.availableData());
+
+  p.setHighWaterMark(prod.availablePutSpace() + 1); // Always past it.
+  ASSERT(!p(cons));
+  EQ(true, p.skip(PHYSICS_EVENT));
+  EQ(false, p.skip(PERIODIC_SCALERS));
+  EQ(sizeof(h), cons.availableData());          // Only the scaler is left.
+}
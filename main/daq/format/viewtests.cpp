@@ -0,0 +1,292 @@
+// Tests for the non-owning ring item views.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "DataFormat.h"
+#include "RingItemView.h"
+#include "CRingItemFactory.h"
+#include "CRingScalerItem.h"
+#include "CRingStateChangeItem.h"
+#include "CRingTextItem.h"
+#include "CRingFragmentItem.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Visitor that records which view overload was selected:
+
+struct ViewRecorder {
+  std::string m_which;
+  void operator()(const CScalerItemView& v)      { m_which = "scaler"; }
+  void operator()(const CStateChangeItemView& v) { m_which = "state"; }
+  void operator()(const CRingItemView& v)        { m_which = "generic"; }
+};
+
+class viewtests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(viewtests);
+  CPPUNIT_TEST(header);
+  CPPUNIT_TEST(bodyHeader);
+  CPPUNIT_TEST(scaler);
+  CPPUNIT_TEST(scalerSwapped);
+  CPPUNIT_TEST(stateChange);
+  CPPUNIT_TEST(text);
+  CPPUNIT_TEST(fragment);
+  CPPUNIT_TEST(glom);
+  CPPUNIT_TEST(dispatch);
+  CPPUNIT_TEST(construct);
+  CPPUNIT_TEST(constructWrongType);
+  CPPUNIT_TEST(factory);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void header();
+  void bodyHeader();
+  void scaler();
+  void scalerSwapped();
+  void stateChange();
+  void text();
+  void fragment();
+  void glom();
+  void dispatch();
+  void construct();
+  void constructWrongType();
+  void factory();
+private:
+  void swapScaler(pScalerItem pItem);
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(viewtests);
+
+// Byte swap a scaler item without a body header in place.
+
+void
+viewtests::swapScaler(pScalerItem pItem)
+{
+  size_t   nLongs   = pItem->s_header.s_size/sizeof(uint32_t);
+  CRingItemByteOrder::swap32InPlace(reinterpret_cast<uint32_t*>(pItem), nLongs);
+}
+
+// Item header decodes properly.
+
+void viewtests::header()
+{
+  pPhysicsEventItem pItem = formatEventItem(2, const_cast<char*>("abcd"));
+  CRingItemView v(pItem);
+
+  EQ(PHYSICS_EVENT, v.type());
+  EQ(pItem->s_header.s_size, v.size());
+  EQ(false, v.mustSwap());
+  EQ(false, v.hasBodyHeader());
+  EQ(size_t(8), v.getBodySize());     // Includes the self-counting word count.
+  EQ(0, memcmp("abcd", reinterpret_cast<const uint8_t*>(v.getBodyPointer()) + 4, 4));
+  EQ((const void*)(reinterpret_cast<uint8_t*>(pItem) + pItem->s_header.s_size), v.next());
+
+  free(pItem);
+}
+// Body header fields are decoded.
+
+void viewtests::bodyHeader()
+{
+  pPhysicsEventItem pItem =
+    formatTimestampedEventItem(0x123456789ull, 5, 2, 2, "abcd");
+  CPhysicsEventItemView v(pItem);
+
+  EQ(true, v.hasBodyHeader());
+  EQ(uint64_t(0x123456789ull), v.getEventTimestamp());
+  EQ(uint32_t(5), v.getSourceId());
+  EQ(uint32_t(2), v.getBarrierType());
+  EQ(size_t(8), v.getBodySize());     // Includes the self-counting word count.
+  EQ(0, memcmp("abcd", reinterpret_cast<const uint8_t*>(v.getBodyPointer()) + 4, 4));
+
+  free(pItem);
+}
+// Scaler items in native byte order.
+
+void viewtests::scaler()
+{
+  uint32_t counters[10];
+  for (int i = 0; i < 10; i++) counters[i] = i*100;
+  pScalerItem pItem = formatScalerItem(10, 1234, 10, 20, counters);
+  CScalerItemView v(pItem);
+
+  EQ(uint32_t(10), v.getStartTime());
+  EQ(uint32_t(20), v.getEndTime());
+  EQ(time_t(1234), v.getTimestamp());
+  EQ(uint32_t(10), v.getScalerCount());
+  EQ(true, v.isIncremental());
+  EQ(uint32_t(500), v.getScaler(5));
+  EQ(0, memcmp(counters, v.getScalerPointer(), sizeof(counters)));
+
+  uint32_t copy[5];
+  EQ(size_t(5), v.copyScalers(copy, 5));
+  EQ(0, memcmp(counters, copy, sizeof(copy)));
+
+  free(pItem);
+}
+// Scaler items from a system with the other byte order.
+
+void viewtests::scalerSwapped()
+{
+  uint32_t counters[10];
+  for (int i = 0; i < 10; i++) counters[i] = i*100;
+  pScalerItem pItem = formatScalerItem(10, 1234, 10, 20, counters);
+  size_t size = pItem->s_header.s_size;
+  swapScaler(pItem);
+
+  CScalerItemView v(pItem);
+  EQ(true, v.mustSwap());
+  EQ(PERIODIC_SCALERS, v.type());
+  EQ(uint32_t(size), v.size());
+  EQ(uint32_t(20), v.getEndTime());
+  EQ(uint32_t(10), v.getScalerCount());
+  EQ(uint32_t(900), v.getScaler(9));
+
+  uint32_t copy[10];
+  EQ(size_t(10), v.copyScalers(copy, 10));
+  EQ(0, memcmp(counters, copy, sizeof(copy)));
+
+  free(pItem);
+}
+// State change items.
+
+void viewtests::stateChange()
+{
+  pStateChangeItem pItem = formatStateChange(4321, 15, 12, "A title", END_RUN);
+  CStateChangeItemView v(pItem);
+
+  EQ(true, CStateChangeItemView::matches(v.type()));
+  EQ(uint32_t(12), v.getRunNumber());
+  EQ(uint32_t(15), v.getElapsedTime());
+  EQ(time_t(4321), v.getTimestamp());
+  EQ(std::string("A title"), std::string(v.getTitle()));
+
+  free(pItem);
+}
+// Text items - walk the strings in place.
+
+void viewtests::text()
+{
+  const char* strings[3] = {"one", "two", "three"};
+  pTextItem pItem = formatTextItem(3, 1234, 10, strings, MONITORED_VARIABLES);
+  CTextItemView v(pItem);
+
+  EQ(uint32_t(3), v.getStringCount());
+  EQ(uint32_t(10), v.getTimeOffset());
+  const char* p = v.firstString();
+  for (int i = 0; i < 3; i++) {
+    EQ(std::string(strings[i]), std::string(p));
+    p = v.nextString(p);
+  }
+
+  free(pItem);
+}
+// Event builder fragments.
+
+void viewtests::fragment()
+{
+  pEventBuilderFragment pItem = formatEVBFragment(0x1234, 3, 0, 4, "abcd");
+  CFragmentItemView v(pItem);
+
+  EQ(uint64_t(0x1234), v.timestamp());
+  EQ(uint32_t(3), v.source());
+  EQ(uint32_t(0), v.barrierType());
+  EQ(size_t(4), v.payloadSize());
+  EQ(0, memcmp("abcd", v.payloadPointer(), 4));
+
+  free(pItem);
+}
+// Glom parameters.
+
+void viewtests::glom()
+{
+  pGlomParameters pItem =
+    formatGlomParameters(100, 1, GLOM_TIMESTAMP_AVERAGE);
+  CGlomParametersView v(pItem);
+
+  EQ(uint64_t(100), v.coincidenceTicks());
+  EQ(true, v.isBuilding());
+  EQ(GLOM_TIMESTAMP_AVERAGE, v.timestampPolicy());
+
+  free(pItem);
+}
+// visitRingItem picks the best overload.
+
+void viewtests::dispatch()
+{
+  ViewRecorder r;
+  uint32_t counters[2] = {1, 2};
+
+  pScalerItem pScaler = formatScalerItem(2, 1234, 0, 10, counters);
+  visitRingItem(pScaler, r);
+  EQ(std::string("scaler"), r.m_which);
+
+  pStateChangeItem pState = formatStateChange(4321, 0, 1, "title", BEGIN_RUN);
+  visitRingItem(pState, r);
+  EQ(std::string("state"), r.m_which);
+
+  pPhysicsEventItem pEvent = formatEventItem(2, const_cast<char*>("abcd"));
+  visitRingItem(pEvent, r);
+  EQ(std::string("generic"), r.m_which);
+
+  EQ(true, isRingItemOfType<CScalerItemView>(pScaler));
+  EQ(false, isRingItemOfType<CScalerItemView>(pEvent));
+
+  free(pScaler);
+  free(pState);
+  free(pEvent);
+}
+// Existing classes can be constructed from views.
+
+void viewtests::construct()
+{
+  uint32_t counters[10];
+  for (int i = 0; i < 10; i++) counters[i] = i;
+  pScalerItem pItem = formatScalerItem(10, 1234, 10, 20, counters);
+
+  CRingScalerItem item((CScalerItemView(pItem)));
+  EQ(uint32_t(pItem->s_header.s_size), item.size());
+  EQ(uint32_t(10), item.getScalerCount());
+  EQ(uint32_t(7), item.getScaler(7));
+  EQ(0, memcmp(pItem, item.getItemPointer(), pItem->s_header.s_size));
+
+  free(pItem);
+}
+// A view of the wrong type is rejected.
+
+void viewtests::constructWrongType()
+{
+  pStateChangeItem pItem = formatStateChange(4321, 15, 12, "A title", BEGIN_RUN);
+
+  EXCEPTION(CRingScalerItem((CScalerItemView(pItem))), std::bad_cast);
+  EXCEPTION(CRingTextItem((CTextItemView(pItem))), std::bad_cast);
+
+  free(pItem);
+}
+// The factory produces the right type from raw data.
+
+void viewtests::factory()
+{
+  pStateChangeItem pItem = formatStateChange(4321, 15, 12, "A title", BEGIN_RUN);
+  CRingItem* p = CRingItemFactory::createRingItem(pItem);
+
+  CRingStateChangeItem* pState = dynamic_cast<CRingStateChangeItem*>(p);
+  ASSERT(pState);
+  EQ(uint32_t(12), pState->getRunNumber());
+  EQ(std::string("A title"), pState->getTitle());
+  EQ(uint32_t(pItem->s_header.s_size), pState->size());
+
+  delete p;
+  free(pItem);
+}
@@ -31,8 +31,12 @@ While true {
    Connect to Tcl Server
    Connect channels in channel list.
    while connected {
-      Update channels to server.
-      Wait for interval seconds.
+      If interval seconds have passed since the last full update {
+         Update all channels to server.
+      } else {
+         Update changed channels to server.
+      }
+      Wait for delta interval (or interval if none) seconds.
    }
 }
 
@@ -80,6 +84,7 @@ static const float  PLCTIMEOUT(10.0); // Timeout for PLC Channels.
 static const int    CONNECTRETRYINTERVAL(10); // Seconds between retry attempts.
 static const int    CONNECTRETRIES(1000);     // Number of retries allowed. 
 static const int    MININTERVAL(5);     // Minimum update interval
+static const int    MINDELTAINTERVAL(1); // Minimum changed channel update interval.
 
 static const string DataArrayName("EPICS_DATA"); // Name of data tcl array.
 static const string UnitsArrayName("EPICS_UNITS"); // Name of units tcl array.
@@ -96,6 +101,7 @@ CApplication::CApplication ()
     m_nPort(DEFAULTPORT),
     m_sHost(DEFAULTHOST),
     m_nInterval(INTERVAL),
+    m_nDeltaInterval(0),
     m_fMustAuthorize(false)
 { 
   
@@ -151,6 +157,20 @@ CApplication::operator()(gengetopt_args_info& Parameters)
       ValidateInterval(Parameters.interval_arg);
       m_nInterval = Parameters.interval_arg;
     }
+    // --delta-interval=seconds (after --interval as it must be smaller).
+
+    if(Parameters.delta_interval_given) {
+      ValidateDeltaInterval(Parameters.delta_interval_arg);
+      m_nDeltaInterval = Parameters.delta_interval_arg;
+    }
+    // --deadband=value
+
+    if(Parameters.deadband_given) {
+      if(Parameters.deadband_arg < 0.0) {
+	throw string("The deadband must not be negative");
+      }
+      m_Filter.setDeadband(Parameters.deadband_arg);
+    }
     // --host=name.
     
     if(Parameters.node_given) {
@@ -199,9 +219,19 @@ CApplication::operator()(gengetopt_args_info& Parameters)
       CLookupVisitor ChannelInitializer;
       m_Channels.foreach(ChannelInitializer);	// Lookup channels and revive.
       cerr << "Channel lookup complete\n";
+
+      // The server may have lost everything so start with a full update.
+
+      m_Filter.reset();
+      time_t nextFullUpdate = 0;
       while(m_Socket.getState() == CSocket::Connected) {
-	Update();
-	Delay(m_nInterval);
+	time_t now = time(NULL);
+	bool   full = (m_nDeltaInterval == 0) || (now >= nextFullUpdate);
+	Update(full);
+	if(full) {
+	  nextFullUpdate = now + m_nInterval;
+	}
+	Delay(m_nDeltaInterval ? m_nDeltaInterval : m_nInterval);
       }
     }
     throw "Unable to form a connection to the server";
@@ -302,27 +332,34 @@ CApplication::ReadChannelFile(istream& Input)
 - Creates a CBuildChannelData visitor object and
   passes it to  m_Channels.foreach to collect the
   current data.
-- Passes the CBuildChannelData object to 
+- Selects the channels to send: all of them for a full update,
+  otherwise only those that changed (see CChangeFilter).
+- Passes the selected channels to
   ChannelsToServer to update the TCLserver's
   idea of what the channel values etc. are.
 
+\param full (bool)
+   If true all channels are sent, otherwise only changed ones.
 */
 void 
-CApplication::Update()  
+CApplication::Update(bool full)  
 {
   CBuildChannelData collector;
   m_Channels.foreach(collector);
-  ChannelsToServer(collector);
+
+  CBuildChannelData changed;
+  if(m_Filter.select(collector, changed, full)) {
+    ChannelsToServer(changed);
+  }
   
 }  
 
 /*! 
 
-Takes the channels parameter and iterates through
-the pairs of channel name/value information.
-For each channel name/value, a TCL command is
-created and the value appropriately quoted/escaped.
-The TCL Command is sent to the TCL server for execution.
+Takes the channels parameter and builds a script of
+TCL set commands for the channel name/value information
+(see BuildScript).  The script is sent to the TCL server for
+execution in a single write.
 
 \param chans (CBuildChannelData&)
    The visitor that has been building up channel data.
@@ -331,41 +368,23 @@ The TCL Command is sent to the TCL server for execution.
 void 
 CApplication::ChannelsToServer(CBuildChannelData& chans)  
 { 
-  CBuildChannelData::ChannelItemIterator i = chans.begin();
-  while(i != chans.end()) {
+  string script = BuildScript(chans);
 
-    // Fetch the data out of the channel data block:
+  // If we lose the connection the main loop will take care of
+  // any reconnection stuff.
+  //
+  try {
+    m_Socket.Flush();
+    m_Socket.Write((void*)script.c_str(), script.size());
+  }
+  catch (CException& problem) {
+    cerr << ">>>WARNING<<< failed to write all channels to server: " 
+	 << problem.ReasonText() << endl;
+    cerr << "              Will attempt to retry server connection\n";
 
-    string name     = i->first;
-    string value    = i->second.m_sValue;
-    string units    = i->second.m_sUnits;
-    string updated  = FormatTime(i->second.m_Updated);
+    // Resend everything once reconnected:
 
-    // Format the commands and send them on to the server.
-    // If we lose the connection then break from the loop.
-    // the main loop will take care of any reconnection stuff.
-    //
-    try {
-      m_Socket.Flush();
-      string command;
-      command = GenerateSet(DataArrayName, name, value);
-      m_Socket.Write((void*)command.c_str(), command.size());
-      
-      if(units != string("")) {
-	command = GenerateSet(UnitsArrayName, name, units);
-	m_Socket.Write((void*)command.c_str(), command.size());
-      }
-      
-      command = GenerateSet(UpdateArrayName, name, updated);
-      m_Socket.Write((void*)command.c_str(), command.size());
-    }
-    catch (CException& problem) {
-      cerr << ">>>WARNING<<< failed to write all channels to server: " 
-	   << problem.ReasonText() << endl;
-      cerr << "              Will attempt to retry server connection\n";
-      break;
-    }
-    i++;
+    m_Filter.reset();
   }
 }  
 
@@ -496,6 +515,54 @@ CApplication::ValidateInterval(int interval)
   }
 }
 
+/*!
+   Validate the interval between updates of only the changed channels.
+   It must be at least MINDELTAINTERVAL and smaller than the full
+   update interval.
+   \param interval - the interval in seconds.
+   \throw string
+      if the interval is not valid.
+*/
+void
+CApplication::ValidateDeltaInterval(int interval)
+{
+  if((interval < MINDELTAINTERVAL) || (interval >= m_nInterval)) {
+    ostringstream error;
+    error << "Invalid delta interval value: " << interval
+	  << " Delta intervals must be >= " << MINDELTAINTERVAL
+	  << " and less than the update interval (" << m_nInterval << ")";
+    throw string(error.str());
+  }
+}
+/*!
+   Build the script that updates the server's arrays for a set of
+   channels.  For each channel name/value, TCL set commands are
+   created for the value, units (if there are any) and update time
+   with the values appropriately quoted/escaped.
+   \param chans (CBuildChannelData&)
+      The channel data to send.
+   \return string
+      The script; empty if there are no channels.
+*/
+string
+CApplication::BuildScript(CBuildChannelData& chans)
+{
+  string script;
+  CBuildChannelData::ChannelItemIterator i = chans.begin();
+  while(i != chans.end()) {
+    string name     = i->first;
+    string units    = i->second.m_sUnits;
+
+    script += GenerateSet(DataArrayName, name, i->second.m_sValue);
+    if(units != string("")) {
+      script += GenerateSet(UnitsArrayName, name, units);
+    }
+    script += GenerateSet(UpdateArrayName, name,
+			  FormatTime(i->second.m_Updated));
+    i++;
+  }
+  return script;
+}
 /*!
    Construct a time from the time_t array in cannonical time form.
    We steal the time format from sql's concept of time.  A time is 
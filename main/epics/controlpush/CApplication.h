@@ -49,6 +49,10 @@ to start the application.
 #include <CChannelList.h>
 #endif
 
+#ifndef __CCHANGEFILTER_H
+#include "CChangeFilter.h"
+#endif
+
 #ifndef __STL_STRING
 #include <string>        //Required for include files 
 #ifndef __STL_STRING
@@ -79,12 +83,14 @@ private:
   int      m_nPort;       //!<  TCP port of Tcl server we connect to.  
   std::string   m_sHost;       //!<  TCP server we connect to.
   int      m_nInterval;   //!<  Seconds between channel updates.
+  int      m_nDeltaInterval; //!< Seconds between changed channel updates (0 none).
   bool     m_fMustAuthorize;
  
   // Class assocations.
 
   CSocket      m_Socket;   //!< Socket object on tclserver.
   CChannelList m_Channels; //!< List of channels we are maintaining.
+  CChangeFilter m_Filter;  //!< What the server already has.
 
 
 public:
@@ -109,7 +115,7 @@ public:
 
   int operator()       (gengetopt_args_info& Parameters)   ; //!< Entry point.
   void ReadChannelFile (std::istream& Input)   ;                  //!< Create channel list.
-  void Update          ()   ;                                //!< Do an update. 
+  void Update          (bool full = true)   ;               //!< Do an update. 
   void ChannelsToServer(CBuildChannelData& chans)   ;        //!< Send channel info -> server. 
   void ConnectToServer (int nRetryInterval, int nNumRetries)   ; //!< Connect with tcl server.
   //
@@ -117,6 +123,8 @@ public:
 private:
   void ValidatePort(int port);	// Throw if port is not valid.
   void ValidateInterval(int interval);
+  void ValidateDeltaInterval(int interval);
+  std::string BuildScript(CBuildChannelData& chans);
   std::string FormatTime(time_t t);
   std::string GenerateSet(const std::string& arrayname, const std::string& index, 
 		     const std::string& value);
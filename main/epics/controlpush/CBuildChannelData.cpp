@@ -116,6 +116,21 @@ CBuildChannelData::operator()(CChannel* pChannel)
 
 }  
 
+/*!
+   Adds channel data directly rather than by visiting a channel.
+   This lets the data be filtered into another CBuildChannelData and
+   lets tests supply channel data without EPICS.
+   \param name (const string&)
+      Name of the channel.
+   \param info (const ChannelData&)
+      The channel's data.
+*/
+void
+CBuildChannelData::add(const string& name, const ChannelData& info)
+{
+  m_ChannelData.push_back(ChannelItem(name, info));
+}
+
 /*!  Function: 	
    ChannelItemIterator begin() 
  Operation Type:
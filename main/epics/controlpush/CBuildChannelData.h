@@ -91,6 +91,7 @@ public:
       m_sValue = rhs.m_sValue;
       m_sUnits = rhs.m_sUnits;
       m_Updated= rhs.m_Updated;
+      return *this;
     }                           //!< Ensure strings are copied properly, not just bitwise.
   } ChannelData;		//!< Information about a channel.
 
@@ -115,6 +116,7 @@ public:
 public:
 
   virtual   void operator() (CChannel* pChannel); //!< per channel operation
+  void add(const std::string& name, const ChannelData& info); //!< Add an item directly.
   ChannelItemIterator begin ()   ;                       //!< Return begin iterator.
   ChannelItemIterator end ()   ;                         //!< Return end iterator.
   int          size ()   ;                        //!< Return number of items in the list.
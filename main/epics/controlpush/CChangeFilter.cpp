@@ -0,0 +1,154 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2005.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/*! \file CChangeFilter.cpp
+  Implementation of the CChangeFilter class.  See the class header
+  file for more information about what's in this file.
+*/
+
+#include <config.h>
+#include "CChangeFilter.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+using namespace std;
+
+/*!
+   Construct a filter that has not sent anything yet.
+   \param deadband (double)
+      Numeric value changes no larger than this are not sent.
+*/
+CChangeFilter::CChangeFilter(double deadband) :
+  m_Deadband(deadband)
+{
+}
+/*!
+   No-op.
+*/
+CChangeFilter::~CChangeFilter()
+{
+}
+
+/*!
+   Set a new deadband.
+   \param deadband (double)
+     The new deadband; negative values are treated as zero.
+*/
+void
+CChangeFilter::setDeadband(double deadband)
+{
+  m_Deadband = deadband < 0.0 ? 0.0 : deadband;
+}
+/*!
+   \return double
+     The current deadband.
+*/
+double
+CChangeFilter::getDeadband() const
+{
+  return m_Deadband;
+}
+/*!
+   Forget everything that was sent.  The next select sends all channels.
+   This is called when the server connection is (re)made since the server
+   may have lost its state.
+*/
+void
+CChangeFilter::reset()
+{
+  m_LastSent.clear();
+}
+
+/*!
+   Select the channels that must be sent and remember them as sent.
+
+   \param current (CBuildChannelData&)
+      The current values of all channels.
+   \param toSend (CBuildChannelData&)
+      The channels to send are appended to this.
+   \param all (bool)
+      If true, all channels are selected regardless of changes.
+   \return int
+      Number of channels selected.
+*/
+int
+CChangeFilter::select(CBuildChannelData& current, CBuildChannelData& toSend,
+		      bool all)
+{
+  int nSelected = 0;
+  CBuildChannelData::ChannelItemIterator i = current.begin();
+  while(i != current.end()) {
+    map<string, CBuildChannelData::ChannelData>::iterator p =
+      m_LastSent.find(i->first);
+    if(all || (p == m_LastSent.end()) || Changed(p->second, i->second)) {
+      toSend.add(i->first, i->second);
+      m_LastSent[i->first] = i->second;
+      nSelected++;
+    }
+    i++;
+  }
+  return nSelected;
+}
+
+//// Utility functions:
+
+/*!
+   Decide if a channel changed enough to send.
+   \param sent (const ChannelData&)
+     What was last sent for the channel.
+   \param now  (const ChannelData&)
+     The channel's current data.
+*/
+bool
+CChangeFilter::Changed(const CBuildChannelData::ChannelData& sent,
+		       const CBuildChannelData::ChannelData& now) const
+{
+  if(sent.m_sUnits != now.m_sUnits) {
+    return true;
+  }
+  if(sent.m_sValue == now.m_sValue) {
+    return false;
+  }
+  double oldValue;
+  double newValue;
+  if(IsNumber(sent.m_sValue, oldValue) && IsNumber(now.m_sValue, newValue)) {
+    return fabs(newValue - oldValue) > m_Deadband;
+  }
+  return true;
+}
+/*!
+   Determine if a channel value is entirely a number.
+   \param value (const string&)
+      The value string.
+   \param number (double& [out])
+      The value if it is a number.
+*/
+bool
+CChangeFilter::IsNumber(const string& value, double& number)
+{
+  const char* pStart = value.c_str();
+  char*       pEnd;
+  number = strtod(pStart, &pEnd);
+  if(pEnd == pStart) {
+    return false;
+  }
+  while(*pEnd && isspace(*pEnd)) {
+    pEnd++;
+  }
+  return *pEnd == '\0';
+}
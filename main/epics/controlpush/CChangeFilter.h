@@ -0,0 +1,93 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2005.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/*!
+  \class CChangeFilter
+
+  Remembers what was last sent to the Tcl server for each channel
+  so that updates can be limited to the channels that changed.
+  A channel has changed if:
+  - It was never sent.
+  - Its units changed.
+  - Its value changed.  If the old and new values are both numbers,
+    the change must be larger than the deadband.
+
+  Changes in the last update time alone don't count; full updates
+  (select with all = true) keep those current in the server.
+
+  The filter only deals in CBuildChannelData so it does not need
+  live EPICS channels.
+*/
+
+#ifndef __CCHANGEFILTER_H  //Required for current class
+#define __CCHANGEFILTER_H
+
+//
+// Include files:
+//
+
+#ifndef __CBUILDCHANNELDATA_H
+#include "CBuildChannelData.h"
+#endif
+
+#ifndef __STL_STRING
+#include <string>
+#ifndef __STL_STRING
+#define __STL_STRING
+#endif
+#endif
+
+#ifndef __STL_MAP
+#include <map>
+#ifndef __STL_MAP
+#define __STL_MAP
+#endif
+#endif
+
+class CChangeFilter
+{
+private:
+  double  m_Deadband;		//!< Numeric changes <= this are ignored.
+  std::map<std::string, CBuildChannelData::ChannelData> m_LastSent; //!< By channel name.
+
+public:
+  CChangeFilter(double deadband = 0.0);
+  ~CChangeFilter();
+
+private:
+  CChangeFilter(const CChangeFilter& rhs);
+  CChangeFilter& operator=(const CChangeFilter& rhs);
+  int operator==(const CChangeFilter& rhs) const;
+  int operator!=(const CChangeFilter& rhs) const;
+public:
+
+  // Class operations:
+
+  void   setDeadband(double deadband); //!< Set numeric deadband.
+  double getDeadband() const;
+  void   reset();		              //!< Forget what was sent.
+  int    select(CBuildChannelData& current,
+		CBuildChannelData& toSend,
+		bool all = false);            //!< Pick channels to send.
+
+  // internal utilities:
+private:
+  bool Changed(const CBuildChannelData::ChannelData& sent,
+	       const CBuildChannelData::ChannelData& now) const;
+  static bool IsNumber(const std::string& value, double& number);
+};
+
+#endif
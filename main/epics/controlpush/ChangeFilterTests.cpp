@@ -0,0 +1,209 @@
+// Tests for change driven updates.  A stand-in channel provider
+// supplies channel data so no EPICS channels are needed.
+
+#include <config.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include "CChangeFilter.h"
+#include "CBuildChannelData.h"
+#include "CApplication.h"
+#include <string>
+#include <map>
+
+
+using namespace std;
+
+// Stand-in for the channel list: a set of channels with settable
+// values that can be collected as CBuildChannelData would collect them.
+
+class FakeChannels
+{
+  map<string, CBuildChannelData::ChannelData> m_channels;
+public:
+  void set(string name, string value, string units = "") {
+    CBuildChannelData::ChannelData& info(m_channels[name]);
+    info.m_sValue  = value;
+    info.m_sUnits  = units;
+    info.m_Updated = 1000;
+  }
+  void collect(CBuildChannelData& data) {
+    map<string, CBuildChannelData::ChannelData>::iterator p = m_channels.begin();
+    while(p != m_channels.end()) {
+      data.add(p->first, p->second);
+      p++;
+    }
+  }
+};
+
+static int
+selectChanged(CChangeFilter& filter, FakeChannels& channels, bool all = false)
+{
+  CBuildChannelData current;
+  CBuildChannelData changed;
+  channels.collect(current);
+  int n = filter.select(current, changed, all);
+  EQMSG("returned count", changed.size(), n);
+  return n;
+}
+
+
+class ChangeFilterTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ChangeFilterTests);
+  CPPUNIT_TEST(FirstSendsAll);
+  CPPUNIT_TEST(UnchangedNotSent);
+  CPPUNIT_TEST(ChangedSent);
+  CPPUNIT_TEST(Deadband);
+  CPPUNIT_TEST(StringValues);
+  CPPUNIT_TEST(Units);
+  CPPUNIT_TEST(Full);
+  CPPUNIT_TEST(Reset);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  FakeChannels*  m_pChannels;
+  CChangeFilter* m_pFilter;
+public:
+  void setUp() {
+    m_pChannels = new FakeChannels;
+    m_pFilter   = new CChangeFilter;
+    m_pChannels->set("A", "1.0", "V");
+    m_pChannels->set("B", "2");
+    m_pChannels->set("C", "closed");
+  }
+  void tearDown() {
+    delete m_pFilter;
+    delete m_pChannels;
+  }
+protected:
+  void FirstSendsAll();
+  void UnchangedNotSent();
+  void ChangedSent();
+  void Deadband();
+  void StringValues();
+  void Units();
+  void Full();
+  void Reset();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ChangeFilterTests);
+
+void
+ChangeFilterTests::FirstSendsAll()
+{
+  EQ(3, selectChanged(*m_pFilter, *m_pChannels));
+}
+
+void
+ChangeFilterTests::UnchangedNotSent()
+{
+  selectChanged(*m_pFilter, *m_pChannels);
+  EQ(0, selectChanged(*m_pFilter, *m_pChannels));
+}
+
+void
+ChangeFilterTests::ChangedSent()
+{
+  selectChanged(*m_pFilter, *m_pChannels);
+  m_pChannels->set("B", "3");
+
+  CBuildChannelData current;
+  CBuildChannelData changed;
+  m_pChannels->collect(current);
+  EQ(1, m_pFilter->select(current, changed));
+  EQ(string("B"), changed.begin()->first);
+  EQ(string("3"), changed.begin()->second.m_sValue);
+}
+
+void
+ChangeFilterTests::Deadband()
+{
+  m_pFilter->setDeadband(0.5);
+  selectChanged(*m_pFilter, *m_pChannels);
+
+  m_pChannels->set("A", "1.25", "V");      // Within the deadband.
+  EQ(0, selectChanged(*m_pFilter, *m_pChannels));
+  m_pChannels->set("A", "1.5", "V");       // Exactly the deadband.
+  EQ(0, selectChanged(*m_pFilter, *m_pChannels));
+  m_pChannels->set("A", "1.75", "V");      // Outside.
+  EQ(1, selectChanged(*m_pFilter, *m_pChannels));
+
+  // The reference is what was sent, so creeping changes are caught:
+
+  m_pChannels->set("A", "2.0", "V");
+  EQ(0, selectChanged(*m_pFilter, *m_pChannels));
+  m_pChannels->set("A", "2.3", "V");
+  EQ(1, selectChanged(*m_pFilter, *m_pChannels));
+}
+
+void
+ChangeFilterTests::StringValues()
+{
+  m_pFilter->setDeadband(100.0);
+  selectChanged(*m_pFilter, *m_pChannels);
+
+  m_pChannels->set("C", "open");
+  EQ(1, selectChanged(*m_pFilter, *m_pChannels));
+  m_pChannels->set("C", "5");              // string -> number always sent.
+  EQ(1, selectChanged(*m_pFilter, *m_pChannels));
+}
+
+void
+ChangeFilterTests::Units()
+{
+  m_pFilter->setDeadband(100.0);
+  selectChanged(*m_pFilter, *m_pChannels);
+
+  m_pChannels->set("A", "1.0", "mV");
+  EQ(1, selectChanged(*m_pFilter, *m_pChannels));
+}
+
+void
+ChangeFilterTests::Full()
+{
+  selectChanged(*m_pFilter, *m_pChannels);
+  EQ(3, selectChanged(*m_pFilter, *m_pChannels, true));
+}
+
+void
+ChangeFilterTests::Reset()
+{
+  selectChanged(*m_pFilter, *m_pChannels);
+  m_pFilter->reset();
+  EQ(3, selectChanged(*m_pFilter, *m_pChannels));
+}
+
+// An update is a single script with a set per array element:
+
+class ApplicationTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ApplicationTests);
+  CPPUNIT_TEST(Script);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void Script();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ApplicationTests);
+
+void
+ApplicationTests::Script()
+{
+  FakeChannels channels;
+  channels.set("A", "1.0", "V");
+  channels.set("B", "a;b");
+  CBuildChannelData data;
+  channels.collect(data);
+
+  CApplication app;
+  string script = app.BuildScript(data);
+  string updated = app.FormatTime(1000);
+
+  string expected = "set EPICS_DATA(A) \"1.0\"\n";
+  expected       += "set EPICS_UNITS(A) \"V\"\n";
+  expected       += "set EPICS_UPDATED(A) \"" + updated + "\"\n";
+  expected       += "set EPICS_DATA(B) \"a\\;b\"\n";
+  expected       += "set EPICS_UPDATED(B) \"" + updated + "\"\n";
+  EQ(expected, script);
+}
@@ -176,6 +176,8 @@ class CVMEInterface
    */
   static bool TryLock(int semnum, int timeoutSeconds);
  private:
+  static void AttachLocks();
+  static void AttachMutexes();
   static void AttachSemaphore();
 
 };
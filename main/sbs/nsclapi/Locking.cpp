@@ -23,9 +23,16 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <assert.h>
+#include <stdlib.h>
 #include <time.h>
 #include <string>
+#include <atomic>
+#include <mutex>
 
 using namespace std;
 
@@ -47,11 +54,166 @@ union semun {
    This file implements coarse grained VME locking.
    If applications use this, the entire VME subsystem will be controlled
    by a single lock.  
+
+   By default the locks are a SysV semaphore set, as they always have
+   been.  If the environment variable NSCLDAQ_VMELOCK is "mutex" the
+   locks are instead process shared, robust pthread mutexes that live in
+   a POSIX shared memory page.  Uncontended, those are taken and released
+   entirely in user space (futexes) where a semaphore costs a system call
+   each way, and the trigger loop takes the lock very often.  The two
+   kinds of lock don't exclude each other, so this is only safe when
+   every program that shares the interface (including older NSCLDAQ
+   versions) sets it.  A mutex must also be released by the thread
+   that took it; a semaphore can be released by any thread.
 */
 
 static int semid = -1;		// This will be the id of the locking semaphore
 static int semkey= 0x564d4520;  // "VME " :-).
 
+static const int       nLocks(8);
+static const char*     lockPageName("/nscldaq_vmelock");
+static const uint32_t  lockPageReady(0x564d454c);  // "VMEL"
+static const uint32_t  lockPageInitializing(1);
+
+typedef struct _LockPage {
+  std::atomic<uint32_t> s_state;  // 0, lockPageInitializing or lockPageReady
+  pthread_mutex_t       s_locks[nLocks];
+} LockPage;
+
+static LockPage*       pLockPage(0); // Non null if the mutexes are used.
+static std::once_flag  attachOnce;
+
+/*
+** Initialize the mutexes in a lock page.
+*/
+static void
+initializeLockPage(LockPage* pPage)
+{
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+  for (int i = 0; i < nLocks; i++) {
+    int status = pthread_mutex_init(&(pPage->s_locks[i]), &attributes);
+    if (status) {
+      pthread_mutexattr_destroy(&attributes);
+      errno = status;
+      throw CErrnoException("AttachMutexes - pthread_mutex_init failed");
+    }
+  }
+  pthread_mutexattr_destroy(&attributes);
+  pPage->s_state.store(lockPageReady, std::memory_order_release);
+}
+/*
+** Return the mutex for a lock number.  Out of range lock numbers
+** are EINVAL errors just as they are for semop.
+*/
+static pthread_mutex_t*
+lockMutex(int semnum)
+{
+  if ((semnum < 0) || (semnum >= nLocks)) {
+    errno = EINVAL;
+    throw CErrnoException("CVMEInterface - invalid lock number");
+  }
+  return &(pLockPage->s_locks[semnum]);
+}
+/*
+** Process the status of a mutex lock operation.  If the previous owner
+** died holding the lock we inherit it; the VME interface has no
+** state to repair so the mutex is just marked consistent again.
+**
+** @return bool - true if the lock is now held, false if it was busy.
+*/
+static bool
+lockStatus(pthread_mutex_t* pMutex, int status, const char* pWhat)
+{
+  if (status == EOWNERDEAD) {
+    status = pthread_mutex_consistent(pMutex);
+  }
+  if ((status == EBUSY) || (status == ETIMEDOUT)) {
+    return false;
+  }
+  if (status) {
+    errno = status;
+    throw CErrnoException(pWhat);
+  }
+  return true;
+}
+
+/*!
+   Attach to the locks if that has not been done yet.  This is done once
+   per process; if it fails it is retried on the next lock operation.
+*/
+void
+CVMEInterface::AttachLocks()
+{
+  std::call_once(attachOnce, &CVMEInterface::AttachMutexes);
+}
+/*!
+   Map the shared lock page, creating it if needed.  The page is
+   zero filled when it is created.  Whoever manages to move its state
+   from zero to initializing initializes the mutexes and then marks it
+   ready.  Everybody else waits (up to a second) for it to be ready.  If it
+   never gets ready the initializing process died in the middle, and
+   the page is initialized again.
+
+   Unless NSCLDAQ_VMELOCK asks for the mutexes the semaphore is
+   attached instead.  If the mutexes were asked for we don't fall back
+   on the semaphore when they can't be had; that would leave this
+   process unsynchronized with the ones that did get them.
+
+   \throw CErrnoException
+      If the lock page can't be created or used.
+*/
+void
+CVMEInterface::AttachMutexes()
+{
+  const char* pMode = getenv("NSCLDAQ_VMELOCK");
+  if (!pMode || (std::string(pMode) != "mutex")) {
+    AttachSemaphore();
+    return;
+  }
+
+  int fd = shm_open(lockPageName, O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    throw CErrnoException("AttachMutexes - shm_open failed");
+  }
+  fchmod(fd, 0666);		// In spite of the umask (fails if not ours).
+
+  struct stat info;
+  if (fstat(fd, &info) ||
+      ((info.st_size < off_t(sizeof(LockPage))) && ftruncate(fd, sizeof(LockPage)))) {
+    int status = errno;
+    close(fd);
+    errno = status;
+    throw CErrnoException("AttachMutexes - unable to size the lock page");
+  }
+  void* p = mmap(0, sizeof(LockPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int status = errno;
+  close(fd);
+  if (p == MAP_FAILED) {
+    errno = status;
+    throw CErrnoException("AttachMutexes - unable to map the lock page");
+  }
+  LockPage* pPage = reinterpret_cast<LockPage*>(p);
+
+  uint32_t state = 0;
+  if (pPage->s_state.compare_exchange_strong(state, lockPageInitializing)) {
+    initializeLockPage(pPage);
+  } else {
+    for (int i = 0; i < 1000; i++) {
+      if (pPage->s_state.load(std::memory_order_acquire) == lockPageReady) break;
+      usleep(1000);
+    }
+    state = pPage->s_state.load(std::memory_order_acquire);
+    if ((state != lockPageReady) &&
+        pPage->s_state.compare_exchange_strong(state, lockPageInitializing)) {
+      initializeLockPage(pPage);
+    }
+  }
+  pLockPage = pPage;
+}
+
 /*!
    This internal function is used to establish the semaphore:
    - If the semaphore exists, it's id is just stored in semid.
@@ -140,19 +302,23 @@ bool CVMEInterface::TryLock(int timeoutSeconds)
   return TryLock(0, timeoutSeconds);
 }
 /*!
-    Lock the semaphore.  If the semid is -1, the
-    semaphore is created first.  
+    Lock the semaphore.  If the locks have not been attached, that's
+    done first.
 
     \throw CErrnoException
-       - Really from AttachSemaphore
-       - From failures in semop.
+       - Really from AttachMutexes/AttachSemaphore
+       - From failures in pthread_mutex_lock or semop.
 */
 void 
 CVMEInterface::Lock(int semnum) 
 {
-  // If necessary, get the semaphore id..
-
-  if (semid == -1) AttachSemaphore();
+  AttachLocks();
+  if (pLockPage) {
+    pthread_mutex_t* pMutex = lockMutex(semnum);
+    lockStatus(pMutex, pthread_mutex_lock(pMutex),
+               "CVMEInterface::Lock pthread_mutex_lock gave bad status");
+    return;
+  }
   assert(semid >= 0);		// Otherwise attach.. throws.
 
   struct sembuf buf;
@@ -178,13 +344,22 @@ CVMEInterface::Lock(int semnum)
   locked.
   
   \throw  CErrnoException
-     If the semop operation produced an error.
+     If the unlock operation produced an error (e.g. with
+     NSCLDAQ_VMELOCK=mutex, the mutex is not held by this thread).
   \throw string
      If the semaphore did not yet exist.
 */
 void
 CVMEInterface::Unlock(int semnum)
 {
+  if (pLockPage) {
+    int status = pthread_mutex_unlock(lockMutex(semnum));
+    if (status) {
+      errno = status;
+      throw CErrnoException("CVMEInterface::Unlock pthread_mutex_unlock gave bad status");
+    }
+    return;
+  }
   if(semid == -1) {
     throw string("Attempt to unlock the semaphore before it was created");
   }
@@ -207,7 +382,22 @@ CVMEInterface::Unlock(int semnum)
 
 bool
 CVMEInterface::TryLock(int semnum, int nTimeoutSeconds) {
-  if (semid == -1) AttachSemaphore();
+  AttachLocks();
+  if (pLockPage) {
+    pthread_mutex_t* pMutex = lockMutex(semnum);
+    if (nTimeoutSeconds <= 0) {
+      return lockStatus(pMutex, pthread_mutex_trylock(pMutex),
+                        "CVMEInterface::TryLock pthread_mutex_trylock gave bad status");
+    }
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += nTimeoutSeconds;
+    int status;
+    while ((status = pthread_mutex_timedlock(pMutex, &deadline)) == EINTR)
+      ;
+    return lockStatus(pMutex, status,
+                      "CVMEInterface::TryLock pthread_mutex_timedlock gave bad status");
+  }
   assert(semid >= 0);
   
 
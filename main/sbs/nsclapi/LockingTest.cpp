@@ -3,6 +3,7 @@
 #include "Asserts.h"
 
 #include <CVMEInterface.h>
+#include <ErrnoException.h>
 
 #include <thread>
 #include <iostream>
@@ -12,6 +13,8 @@
 
 #include <poll.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 using namespace std;
 
@@ -37,6 +40,8 @@ class LockingTest : public CppUnit::TestFixture {
   CPPUNIT_TEST( tryLock_0 );
   CPPUNIT_TEST( tryLock_1 );
   CPPUNIT_TEST( tryLock_2 );
+  CPPUNIT_TEST( deadOwner );
+  CPPUNIT_TEST( badLockNumber );
   CPPUNIT_TEST_SUITE_END();
 
 
@@ -135,6 +140,28 @@ void tryLock_2()
            expected, actual);
 }
 
+// A process that exits holding the lock must not leave it locked.
+
+void deadOwner()
+{
+  pid_t child = fork();
+  if (child == 0) {
+    CVMEInterface::Lock();
+    _exit(0);
+  }
+  int status;
+  waitpid(child, &status, 0);
+
+  bool locked = CVMEInterface::TryLock(1);
+  if (locked) CVMEInterface::Unlock();
+  EQMSG("Lock held by a dead process can be taken", true, locked);
+}
+
+void badLockNumber()
+{
+  EXCEPTION(CVMEInterface::Lock(8), CErrnoException);
+}
+
 double getTimeoutResolution() {
   using namespace std::chrono;
 
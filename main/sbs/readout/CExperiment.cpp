@@ -44,6 +44,7 @@
 #include <string>
 #include <fragment.h>
 #include <os.h>
+#include <CPipelineTrace.h>
 #include <CCondition.h>
 #include <CMutex.h>
 
@@ -521,6 +522,7 @@ CExperiment::ReadEvent()
         item.setBodyHeader(m_nEventTimestamp, m_nSourceId, 0);
       }
       item.commitToRing(*m_pRing);
+      CPipelineTrace::hopItem(CPipelineTrace::ReadoutOutput, item.getItemPointer());
       m_nEventsEmitted++;
     }
     m_pReadout->clear();	// do any post event clears.
@@ -661,6 +663,14 @@ CExperiment::getScalerTrigger()
 {
   return m_pScalerTrigger;
 }
+/*!
+  Return the trigger loop.  This is null until the first run starts.
+*/
+CTriggerLoop*
+CExperiment::getTriggerLoop()
+{
+  return m_pTriggerLoop;
+}
 /*!
    Schedule the end run buffer read out:
    @param pause  - true if this is a pause run.
@@ -121,6 +121,7 @@ private:
 public:
   CEventTrigger*      getEventTrigger();
   CEventTrigger*      getScalerTrigger();
+  CTriggerLoop*       getTriggerLoop();
 
   // Member functions:
 
@@ -28,6 +28,7 @@
 #include "CResumeCommand.h"
 #include "CEndCommand.h"
 #include "CInitCommand.h"
+#include "CTriggerLatencyCommand.h"
 #include <TCLTimer.h>
 
 using namespace std;
@@ -203,4 +204,5 @@ void CRunControlPackage::createCommands(CTCLInterpreter& interp)
   addCommand(new CResumeCommand(interp));
   addCommand(new CEndCommand(interp));
   addCommand(new CInitCommand(interp));
+  addCommand(new CTriggerLatencyCommand(interp));
 }
@@ -49,6 +49,7 @@ class RunTimer;
   - end    - End an active run.
   - pause  - Pause an active run.
   - resume - Resume an paused run.
+  - latency - Report the trigger loop latency histograms.
 
 */
 class CRunControlPackage  : public CTCLObjectPackage
@@ -0,0 +1,68 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+#include <config.h>
+#include "CSyntheticEventSegment.h"
+#include <CLatencyHistogram.h>
+
+/*!
+  Construct the segment.
+
+  \param words     - Number of 16 bit words each event contributes.
+  \param readoutNs - Number of nanoseconds to busy wait for each event.
+*/
+CSyntheticEventSegment::CSyntheticEventSegment(size_t words, uint64_t readoutNs) :
+  m_nWords(words),
+  m_nReadoutNs(readoutNs),
+  m_nEvent(0)
+{}
+
+/*!
+   Restart the event counter at the beginning of a run.
+*/
+void
+CSyntheticEventSegment::onBegin()
+{
+  m_nEvent = 0;
+}
+/*!
+   Read an event.  The event is the low 16 bits of the event counter
+   followed by a ramp, truncated to maxwords.  The wait is a busy wait
+   because that's what a real readout does with the processor.
+
+   \param pBuffer  - Where to put the event.
+   \param maxwords - Most words we can put there.
+   \return size_t  - Number of words read.
+*/
+size_t
+CSyntheticEventSegment::read(void* pBuffer, size_t maxwords)
+{
+  if (m_nReadoutNs) {
+    uint64_t until = CLatencyHistogram::nowNs() + m_nReadoutNs;
+    while (CLatencyHistogram::nowNs() < until)
+      ;
+  }
+
+  size_t    nWords = (m_nWords < maxwords) ? m_nWords : maxwords;
+  uint16_t* p      = reinterpret_cast<uint16_t*>(pBuffer);
+  if (nWords) {
+    *p++ = static_cast<uint16_t>(m_nEvent);
+  }
+  for (size_t i = 1; i < nWords; i++) {
+    *p++ = static_cast<uint16_t>(i);
+  }
+  m_nEvent++;
+  return nWords;
+}
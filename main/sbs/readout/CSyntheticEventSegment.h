@@ -0,0 +1,54 @@
+#ifndef __CSYNTHETICEVENTSEGMENT_H
+#define __CSYNTHETICEVENTSEGMENT_H
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#ifndef __CEVENTSEGMENT_H
+#include <CEventSegment.h>
+#endif
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+/*!
+  An event segment that needs no hardware.  Each event it busy waits
+  for a fixed time (standing in for digitizer conversion and VME transfer
+  time) and then produces a fixed number of words: an event counter
+  followed by a ramp.
+
+  Together with a CTimedTrigger or CNullTrigger this allows the dead
+  time the readout framework adds to each event to be measured
+  (see the trigger loop latency histograms) without a crate.
+*/
+class CSyntheticEventSegment : public CEventSegment
+{
+private:
+  size_t   m_nWords;        // uint16_t words per event.
+  uint64_t m_nReadoutNs;    // Busy wait per event.
+  uint32_t m_nEvent;        // Event counter.
+
+public:
+  CSyntheticEventSegment(size_t words, uint64_t readoutNs = 0);
+
+  virtual void   onBegin();
+  virtual size_t read(void* pBuffer, size_t maxwords);
+};
+
+#endif
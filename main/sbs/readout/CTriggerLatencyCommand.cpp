@@ -0,0 +1,143 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+#include <config.h>
+#include "CTriggerLatencyCommand.h"
+#include "CReadoutMain.h"
+#include "CExperiment.h"
+#include "CTriggerLoop.h"
+#include <TCLInterpreter.h>
+#include <TCLObject.h>
+#include <tcl.h>
+
+using namespace std;
+
+
+/*!
+   Constructor.. register ourself as the latency command.
+   @param interp   - Reference to the interpreter object on which this
+                     command will be registered.
+*/
+CTriggerLatencyCommand::CTriggerLatencyCommand(CTCLInterpreter& interp) :
+  CTCLPackagedObjectProcessor(interp, string("latency"))
+{
+  
+}
+/*!
+   Destructor here just to support chaining.
+*/
+CTriggerLatencyCommand::~CTriggerLatencyCommand() {}
+
+/*!
+   Execute the command.  See the header for the subcommands.  Before
+   the first run there's no trigger loop and the histograms are empty.
+
+   @param interp  - Reference to the intepreter that's running the command.
+   @param objv    - Vector of Tcl objects that are the command parameters.
+   @return int
+   @return TCL_OK     - The command succeeded.
+   @return TCL_ERROR  - The command failed.
+*/
+int
+CTriggerLatencyCommand::operator()(CTCLInterpreter&    interp,
+                                   vector<CTCLObject>& objv)
+{
+  if (objv.size() != 2) {
+    interp.setResult(usage());
+    return TCL_ERROR;
+  }
+  objv[1].Bind(interp);
+  string subcommand = objv[1];
+
+  CExperiment*  pExperiment = CReadoutMain::getExperiment();
+  CTriggerLoop* pLoop       = pExperiment ? pExperiment->getTriggerLoop() : 0;
+
+  if (subcommand == "get") {
+    CLatencyHistogram empty;
+    CTCLObject result;
+    result.Bind(interp);
+    result += histogramObject(interp,
+      pLoop ? pLoop->getEventLatency() : empty.snapshot());
+    result += histogramObject(interp,
+      pLoop ? pLoop->getScalerLatency() : empty.snapshot());
+    interp.setResult(result);
+  } else if (subcommand == "clear") {
+    if (pLoop) pLoop->clearLatency();
+  } else {
+    interp.setResult(usage());
+    return TCL_ERROR;
+  }
+  return TCL_OK;
+}
+/*!
+   Produce the list representation of a histogram snapshot.
+
+   @param interp - interpreter to bind the objects to.
+   @param data   - Histogram snapshot.
+   @return CTCLObject - {count mean p50 p90 p99 max {{low high count}...}}
+*/
+CTCLObject
+CTriggerLatencyCommand::histogramObject(CTCLInterpreter& interp,
+                                        const CLatencyHistogram::Snapshot& data)
+{
+  CTCLObject result;
+  result.Bind(interp);
+    
+  result += uint64Object(interp, data.s_count);
+  result += uint64Object(interp, data.s_count ? data.s_sum/data.s_count : 0);
+  result += uint64Object(interp, CLatencyHistogram::percentile(data, 0.50));
+  result += uint64Object(interp, CLatencyHistogram::percentile(data, 0.90));
+  result += uint64Object(interp, CLatencyHistogram::percentile(data, 0.99));
+  result += uint64Object(interp, data.s_max);
+    
+  CTCLObject buckets;
+  buckets.Bind(interp);
+  for (unsigned i = 0; i < data.s_buckets.size(); i++) {
+    if (data.s_buckets[i]) {
+      CTCLObject bucket;
+      bucket.Bind(interp);
+      bucket += uint64Object(interp, CLatencyHistogram::bucketLow(i));
+      bucket += uint64Object(interp, CLatencyHistogram::bucketHigh(i));
+      bucket += uint64Object(interp, data.s_buckets[i]);
+      
+      buckets += bucket;
+    }
+  }
+  result += buckets;
+  
+  return result;
+}
+/*!
+   Create a CTCLObject from a uint64_t via a Tcl wide integer object.
+*/
+CTCLObject
+CTriggerLatencyCommand::uint64Object(CTCLInterpreter& interp, uint64_t value)
+{
+  CTCLObject result(Tcl_NewWideIntObj(value));
+  result.Bind(interp);
+  return result;
+}
+/*!
+   Provides the usage string for the command
+*/
+string
+CTriggerLatencyCommand::usage()
+{
+  string result = "Usage\n";
+  result       += "   latency get\n";
+  result       += "   latency clear\n";
+  result       += " Reports or clears the trigger to readout latency histograms (ns)";
+  return result;
+}
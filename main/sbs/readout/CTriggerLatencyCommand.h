@@ -0,0 +1,88 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#ifndef __CTRIGGERLATENCYCOMMAND_H
+#define __CTRIGGERLATENCYCOMMAND_H
+
+
+#ifndef __TCLPACKAGEDOBJECTPROCESSOR_H
+#include <TCLPackagedObjectProcessor.h>
+#endif
+
+#ifndef __CLATENCYHISTOGRAM_H
+#include <CLatencyHistogram.h>
+#endif
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
+
+#ifndef __STL_STRING
+#include <string>
+#ifndef __STL_STRING
+#define __STL_STRING
+#endif
+#endif
+
+
+// Forward class defs:
+
+class CTCLInterpreter;
+class CTCLObject;
+
+/*!
+   This class provides the latency command which reports the trigger
+   loop's latency histograms:
+
+   - latency get   - returns a two element list; the event and the scaler
+                     histograms.  Each is a list of the form
+                     {count mean p50 p90 p99 max {{low high count}...}}
+                     where all times are in nanoseconds and only the
+                     nonzero buckets are listed.
+   - latency clear - zeroes the histograms.
+*/
+class CTriggerLatencyCommand : public CTCLPackagedObjectProcessor
+{
+  // Canonicals, the various copy like things are not allowed:
+
+public:
+  CTriggerLatencyCommand(CTCLInterpreter& interp);
+  virtual ~CTriggerLatencyCommand();
+
+private:
+  CTriggerLatencyCommand(const CTriggerLatencyCommand& rhs);
+  CTriggerLatencyCommand& operator=(const CTriggerLatencyCommand& rhs);
+  int operator==(const CTriggerLatencyCommand& rhs) const;
+  int operator!=(const CTriggerLatencyCommand& rhs) const;
+
+  // Command entry point:
+
+public:
+  virtual int operator()(CTCLInterpreter& interp,
+			 std::vector<CTCLObject>& objv);
+
+private:
+  CTCLObject histogramObject(CTCLInterpreter& interp,
+                             const CLatencyHistogram::Snapshot& data);
+  CTCLObject uint64Object(CTCLInterpreter& interp, uint64_t value);
+  std::string usage();
+};
+
+#endif
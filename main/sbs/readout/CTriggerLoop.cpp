@@ -24,15 +24,16 @@
 #include <string>
 #include <stdlib.h>
 #include <CVMEInterface.h>
-#include <os.h>
 
 #include <stdio.h>
+#include <sched.h>
 
 #include <iostream>
 
 using namespace std;
 
 static const unsigned DWELL_COUNT(100);
+static const unsigned SPIN_DWELLS(100);  // Idle dwells before yielding.
 
 /*!
   Construct the trigger loop object.  We have lazy binding to the
@@ -46,7 +47,9 @@ static const unsigned DWELL_COUNT(100);
 CTriggerLoop::CTriggerLoop(CExperiment& experiment) :
   m_pExperiment(&experiment),
   m_running(false),
-  m_stopping(false)
+  m_stopping(false),
+  m_pausing(false),
+  m_failed(false)
 {}
 
 /*!
@@ -67,6 +70,7 @@ void
 CTriggerLoop::start()
 {
   if (!m_running) {
+    CriticalSection guard(m_startLock);
     m_running = false;
     m_stopping = false;
     m_failed   = false;
@@ -76,7 +80,7 @@ CTriggerLoop::start()
     
     
     while (!m_running && !m_failed) {
-      Os::usleep(500);
+      m_startCondition.wait(m_startLock);
     }
   }
   else {
@@ -125,8 +129,8 @@ CTriggerLoop::stop(bool pausing)
 void
 CTriggerLoop::run()
 {
-  m_running  = true;
   m_stopping = false;
+  setRunning(true, false);
   
   // On exceptions notify the experiment:
   
@@ -135,17 +139,15 @@ CTriggerLoop::run()
   }
   catch (const char* msg) {
     m_pExperiment->triggerFail(msg);
-    m_running  = false;
     m_stopping = false;
-    m_failed   = true;
+    setRunning(false, true);
     throw;
 
   }
   catch (std::string msg) {
     m_pExperiment->triggerFail(msg);
-    m_running  = false;
     m_stopping = false;
-    m_failed   = true;
+    setRunning(false, true);
     throw;
 
   }
@@ -154,17 +156,15 @@ CTriggerLoop::run()
     msg += " ";
     msg +=  e.WasDoing();
     m_pExperiment->triggerFail(msg);
-    m_running  = false;
     m_stopping = false;
-    m_failed   = true;
+    setRunning(false, true);
     throw;
 
   }
   catch (...) {
     m_pExperiment->triggerFail("Unexpected exception caught");
-    m_running  = false;
     m_stopping = false;
-    m_failed = true;
+    setRunning(false, true);
     throw;
 
   }
@@ -186,15 +186,24 @@ CTriggerLoop::mainLoop()
   if (pEvent)  pEvent->setup();
   if (pScaler) pScaler->setup();
 
+  unsigned idleDwells = 0;
   do {
+    bool triggered = false;
     try {
       CVMEInterface::Lock();
       for (int i =0; i < DWELL_COUNT; i++) {
+        uint64_t pollStart = CLatencyHistogram::nowNs();
         if ((*pEvent)()) {
           m_pExperiment->ReadEvent();
+          uint64_t done = CLatencyHistogram::nowNs();
+          m_eventLatency.add(done - pollStart);
+          pollStart = done;
+          triggered = true;
         }
         if ((*pScaler)()) {
           m_pExperiment->TriggerScalerReadout();
+          m_scalerLatency.add(CLatencyHistogram::nowNs() - pollStart);
+          triggered = true;
           if (m_stopping) break;
         }
       }
@@ -204,6 +213,14 @@ CTriggerLoop::mainLoop()
       throw;
     }
     CVMEInterface::Unlock();
+
+    // Spin while triggers are coming in, otherwise be polite:
+
+    if (triggered) {
+      idleDwells = 0;
+    } else if (++idleDwells > SPIN_DWELLS) {
+      sched_yield();
+    }
   }
   while(!m_stopping);
   // End of run scaler:
@@ -213,3 +230,42 @@ CTriggerLoop::mainLoop()
 
   return;
 }
+/*!
+  Set the running/failed flags and wake up start() which is waiting
+  for one of them.
+*/
+void
+CTriggerLoop::setRunning(bool running, bool failed)
+{
+  CriticalSection guard(m_startLock);
+  m_running = running;
+  m_failed  = failed;
+  m_startCondition.broadcast();
+}
+/*!
+  @return CLatencyHistogram::Snapshot - ns from the start of the trigger
+          poll that saw an event trigger to the end of the event readout.
+*/
+CLatencyHistogram::Snapshot
+CTriggerLoop::getEventLatency() const
+{
+  return m_eventLatency.snapshot();
+}
+/*!
+  @return CLatencyHistogram::Snapshot - same as getEventLatency but for
+          scaler triggers.
+*/
+CLatencyHistogram::Snapshot
+CTriggerLoop::getScalerLatency() const
+{
+  return m_scalerLatency.snapshot();
+}
+/*!
+  Zero the latency histograms.  This is safe while the loop runs.
+*/
+void
+CTriggerLoop::clearLatency()
+{
+  m_eventLatency.clear();
+  m_scalerLatency.clear();
+}
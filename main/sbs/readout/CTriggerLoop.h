@@ -23,6 +23,18 @@
 #include <Thread.h>
 #endif
 
+#ifndef __CMUTEX_H
+#include <CMutex.h>
+#endif
+
+#ifndef __CCONDITION_H
+#include <CCondition.h>
+#endif
+
+#ifndef __CLATENCYHISTOGRAM_H
+#include <CLatencyHistogram.h>
+#endif
+
 
 // Forward class definitions
 
@@ -37,6 +49,15 @@ class CEventTrigger;
   and calling the appropriate methods in the experiment to react to trigger
   conditions.
 
+  The triggers are polled continuously (with the VME lock held) while
+  triggers are arriving.  Once no trigger has been seen for a while, the
+  loop yields the processor between dwells so an idle run does not
+  starve the rest of the system.
+
+  The time from the start of the poll that saw a trigger to the end of its
+  readout is histogrammed (in ns) for events and scalers.  That's the
+  dead time the trigger loop adds per event.
+
 */
 class CTriggerLoop : public Thread
 {
@@ -49,6 +70,12 @@ private:
   volatile bool      m_pausing;   // Shared between threads.
   volatile bool      m_failed;    // Shared between thread... trigger loop failed.
 
+  CMutex             m_startLock;      // Guards m_running for start().
+  CConditionVariable m_startCondition; // Signalled when the thread runs.
+
+  CLatencyHistogram  m_eventLatency;   // ns from trigger poll to event read.
+  CLatencyHistogram  m_scalerLatency;  // ns from trigger poll to scalers read.
+
 public:
   CTriggerLoop(CExperiment& experiment);
   virtual ~CTriggerLoop();
@@ -67,8 +94,13 @@ public:
   void         stop(bool pausing);          // stop/join.
   virtual void run();
 
+  CLatencyHistogram::Snapshot getEventLatency() const;
+  CLatencyHistogram::Snapshot getScalerLatency() const;
+  void         clearLatency();
+
 protected:
   void         mainLoop();
+  void         setRunning(bool running, bool failed);
 };
 
 
@@ -25,6 +25,7 @@ unsigned eventTriggers;
 class TriggerLoopTests : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(TriggerLoopTests);
   CPPUNIT_TEST(theTest);
+  CPPUNIT_TEST(latency);
   CPPUNIT_TEST_SUITE_END();
 
 
@@ -38,6 +39,7 @@ public:
   }
 protected:
   void theTest();
+  void latency();
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TriggerLoopTests);
@@ -99,6 +101,9 @@ CEventTrigger* CExperiment::getEventTrigger() {
 CEventTrigger* CExperiment::getScalerTrigger() {
   return m_pScalerTrigger;
 }
+void CExperiment::ScheduleEndRunBuffer(bool pause) {}
+void CExperiment::triggerFail(std::string msg) {}
+void CExperiment::syncEndRun(bool pause) {}
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -111,8 +116,28 @@ void TriggerLoopTests::theTest() {
   
   theTrigger.start();
   sleep(1);
-  theTrigger.stop(pause);
+  theTrigger.stop(false);
+  theTrigger.join();
 
   ASSERT(scalerTriggers != 0);
   ASSERT(eventTriggers  != 0);
 }
+// Each trigger's readout time is histogrammed.
+
+void TriggerLoopTests::latency() {
+  CExperiment theExperiment("Test");
+  CTriggerLoop theTrigger(theExperiment);
+  
+  theTrigger.start();
+  usleep(100000);
+  theTrigger.stop(false);
+  theTrigger.join();
+
+  CLatencyHistogram::Snapshot events  = theTrigger.getEventLatency();
+  CLatencyHistogram::Snapshot scalers = theTrigger.getScalerLatency();
+  EQ(uint64_t(eventTriggers), events.s_count);
+  EQ(uint64_t(scalerTriggers), scalers.s_count);
+
+  theTrigger.clearLatency();
+  EQ(uint64_t(0), theTrigger.getEventLatency().s_count);
+}
@@ -0,0 +1,95 @@
+// Tests of the synthetic event segment.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CSyntheticEventSegment.h"
+#include <CLatencyHistogram.h>
+#include <stdint.h>
+
+using namespace std;
+
+class synthseg : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(synthseg);
+  CPPUNIT_TEST(contents);
+  CPPUNIT_TEST(counter);
+  CPPUNIT_TEST(truncate);
+  CPPUNIT_TEST(begin);
+  CPPUNIT_TEST(wait);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void contents();
+  void counter();
+  void truncate();
+  void begin();
+  void wait();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(synthseg);
+
+// An event is the counter followed by a ramp.
+
+void synthseg::contents()
+{
+  CSyntheticEventSegment seg(10);
+  uint16_t buffer[20];
+  EQ(size_t(10), seg.read(buffer, 20));
+  EQ(uint16_t(0), buffer[0]);
+  for (int i = 1; i < 10; i++) {
+    EQ(uint16_t(i), buffer[i]);
+  }
+}
+// Each event increments the counter.
+
+void synthseg::counter()
+{
+  CSyntheticEventSegment seg(2);
+  uint16_t buffer[2];
+  for (int i = 0; i < 5; i++) {
+    seg.read(buffer, 2);
+    EQ(uint16_t(i), buffer[0]);
+  }
+}
+// Events are truncated to the buffer space.
+
+void synthseg::truncate()
+{
+  CSyntheticEventSegment seg(10);
+  uint16_t buffer[10] = {0xffff, 0xffff, 0xffff, 0xffff, 0xffff,
+                         0xffff, 0xffff, 0xffff, 0xffff, 0xffff};
+  EQ(size_t(4), seg.read(buffer, 4));
+  EQ(uint16_t(3), buffer[3]);
+  EQ(uint16_t(0xffff), buffer[4]);
+}
+// Beginning a run restarts the counter.
+
+void synthseg::begin()
+{
+  CSyntheticEventSegment seg(1);
+  uint16_t buffer[1];
+  seg.read(buffer, 1);
+  seg.read(buffer, 1);
+  seg.onBegin();
+  seg.read(buffer, 1);
+  EQ(uint16_t(0), buffer[0]);
+}
+// Reads take at least the readout time.
+
+void synthseg::wait()
+{
+  CSyntheticEventSegment seg(1, 2000000);
+  uint16_t buffer[1];
+  uint64_t start = CLatencyHistogram::nowNs();
+  seg.read(buffer, 1);
+  ASSERT((CLatencyHistogram::nowNs() - start) >= 2000000);
+}
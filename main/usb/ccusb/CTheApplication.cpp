@@ -40,6 +40,7 @@
 #include <CAcquisitionThread.h>
 #include <CRunState.h>
 #include <CControlQueues.h>
+#include <CReadoutStatistics.h>
 
 #include <CPortManager.h>
 #include <Events.h>
@@ -154,6 +155,7 @@ int CTheApplication::operator()(int argc, char** argv)
     enumerate();
     exit(EXIT_SUCCESS);
   }
+  Globals::fullInit = arg_struct.fullinit_flag != 0;
 
     // Set up the --init-script if it's been supplied:
     
@@ -168,7 +170,18 @@ int CTheApplication::operator()(int argc, char** argv)
     setConfigFiles(arg_struct.daqconfig_given ? arg_struct.daqconfig_arg : NULL,
                    arg_struct.ctlconfig_given ? arg_struct.ctlconfig_arg : NULL);
     initializeBufferPool();
-    startOutputThread(destinationRing(arg_struct.ring_given ? arg_struct.ring_arg : NULL));
+    std::string ringName = destinationRing(arg_struct.ring_given ? arg_struct.ring_arg : NULL);
+
+    // Publish the readout statistics where usbstats can find them.  Failing
+    // to do so is not fatal; the readoutstats command still works.
+
+    try {
+      CReadoutStatistics::getInstance()->publish(CReadoutStatistics::defaultName(ringName));
+    }
+    catch (std::string msg) {
+      std::cerr << "Warning: " << msg << std::endl;
+    }
+    startOutputThread(ringName);
     
     // Figure out which port to ask the tcl server to start on (see Issue #435).
     
@@ -36,5 +36,6 @@ namespace Globals {
   char*              pTimestampExtractor;
   TclServer*         pTclServer;
   CTCLInterpreter*   pMainInterpreter(0);
+  bool               fullInit(false);
   Tcl_ThreadId           mainThread;
 };
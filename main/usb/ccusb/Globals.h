@@ -64,6 +64,7 @@ namespace Globals {
   extern char*           pTimestampExtractor;
   extern TclServer*      pTclServer;
   extern CTCLInterpreter* pMainInterpreter;
+  extern bool            fullInit;
   extern Tcl_ThreadId           mainThread;   
 };
 
@@ -32,6 +32,7 @@
 #include <Globals.h>
 #include <CConfiguration.h>
 #include <os.h>
+#include <CReadoutStatistics.h>
 #include <Events.h>
 #include <tcl.h>
 
@@ -60,6 +61,24 @@ bool                CAcquisitionThread::m_Running(false);
 CCCUSB*             CAcquisitionThread::m_pCamac(0);
 CAcquisitionThread* CAcquisitionThread::m_pTheInstance(0);
 
+/*
+** Get a free buffer, noting in the statistics when none was ready
+** and how long we waited for one.
+*/
+static DataBuffer*
+getFreeBuffer()
+{
+  DataBuffer* pBuffer;
+  if (!gFreeBuffers.getnow(pBuffer)) {
+    CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+    uint64_t            start  = CReadoutStatistics::nowNs();
+    pStats->add(CReadoutStatistics::FreeExhausted);
+    pBuffer = gFreeBuffers.get();
+    pStats->add(CReadoutStatistics::FreeWaitNs, CReadoutStatistics::nowNs() - start);
+  }
+  return pBuffer;
+}
+
 
 
 
@@ -172,6 +191,7 @@ CAcquisitionThread::init()
     // onTriggerFail/bgerror procs.
     //
     if (errorMessage != "") {
+        CStack::forgetHardwareState(); // Don't know what we left in the hardware.
         reportErrorToMainThread(errorMessage);
     }
 }
@@ -225,24 +245,30 @@ CAcquisitionThread::operator()()
 void
 CAcquisitionThread::mainLoop()
 {
-  DataBuffer*     pBuffer   = gFreeBuffers.get();
+  DataBuffer*     pBuffer   = getFreeBuffer();
   CControlQueues* pCommands = CControlQueues::getInstance(); 
+  CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
   try {
     while (true) {
       
       // Event data from the VM-usb.
       if (m_Running) {
 	size_t bytesRead;
+	uint64_t readStart = CReadoutStatistics::nowNs();
 	int status = m_pCamac->usbRead(pBuffer->s_rawData, pBuffer->s_storageSize,
 				       &bytesRead,
 				       USBTIMEOUT*1000 );
 	if (status == 0) {
+	  pStats->add(CReadoutStatistics::UsbReadNs, CReadoutStatistics::nowNs() - readStart);
+	  pStats->add(CReadoutStatistics::UsbBuffers);
+	  pStats->add(CReadoutStatistics::UsbBytes, bytesRead);
 	  pBuffer->s_bufferSize = bytesRead;
 	  pBuffer->s_bufferType   = TYPE_EVENTS;
 	  processBuffer(pBuffer);	// Submitted to output thread so...
-	  pBuffer = gFreeBuffers.get(); // need a new one.
+	  pBuffer = getFreeBuffer(); // need a new one.
 	} 
 	else {
+	  pStats->add(CReadoutStatistics::UsbTimeouts);
 	  if (errno != ETIMEDOUT) {
       std::stringstream err;
 	    err << "Bad status from usbread: " << strerror(errno) << endl;
@@ -337,6 +363,9 @@ CAcquisitionThread::processBuffer(DataBuffer* pBuffer)
   // In this version, all stack ids are good.  The output thread will ensure that
   // stack 1 completions are scalers and all others are events.
 
+  CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+  pStats->add(CReadoutStatistics::FilledQueued);
+  pStats->atLeast(CReadoutStatistics::FilledMaxDepth, pStats->filledDepth());
   gFilledBuffers.queue(pBuffer);	// Send it on to the output thread.
 }
 /*!
@@ -404,6 +433,9 @@ CAcquisitionThread::startDaq()
   Globals::pConfig = new CConfiguration;
   Globals::pConfig->processConfiguration(Globals::configurationFilename);
   std::vector<CReadoutModule*> Stacks = Globals::pConfig->getStacks();
+  if (Globals::fullInit) {
+    CStack::forgetHardwareState(); // Load every stack.
+  }
 
 
   // The CCUSB has two stacks to load; an event stack and a scaler stack.
@@ -514,7 +546,7 @@ void
 CAcquisitionThread::drainUsb()
 {
   bool done = false;
-  DataBuffer* pBuffer = gFreeBuffers.get();
+  DataBuffer* pBuffer = getFreeBuffer();
   int timeouts(0);
   size_t bytesRead;
   cerr << "CAcquisitionThread::drainUsb...\n";
@@ -530,7 +562,7 @@ CAcquisitionThread::drainUsb()
         done = true;
       }
       processBuffer(pBuffer);
-      pBuffer = gFreeBuffers.get();
+      pBuffer = getFreeBuffer();
     }
     else {
       timeouts++;		// By the time debugged this is only failure.
@@ -24,6 +24,7 @@
 #include <CAcquisitionThread.h>
 #include <CRunState.h>
 #include <CConfiguration.h>
+#include <CStack.h>
 #include <iostream>
 #include <TclServer.h>
 
@@ -100,6 +101,10 @@ CInit::operator()(CTCLInterpreter& interp,
   // via the controlconfig.tcl script 
   Globals::pTclServer->initModules();
 
+  // The next begin loads all of the stacks too:
+
+  CStack::forgetHardwareState();
+
   tclUtil::setResult(interp, string("Init - initialization procedures executed"));
   return TCL_OK;
 }
@@ -26,6 +26,8 @@
 #include <Exception.h>
 #include <ErrnoException.h>
 #include <CRingBuffer.h>
+#include <CReadoutStatistics.h>
+#include <CPipelineTrace.h>
 #include <Globals.h>
 
 #include <assert.h>
@@ -205,6 +207,7 @@ DataBuffer&
 COutputThread::getBuffer()
 {
   DataBuffer* pBuffer = gFilledBuffers.get(); // Will block if needed.
+  CReadoutStatistics::getInstance()->add(CReadoutStatistics::FilledDequeued);
   return *pBuffer;
 
 }
@@ -542,6 +545,7 @@ COutputThread::scaler(void* pData)
   }
 
   pEvent->commitToRing(*m_pRing);
+  CReadoutStatistics::getInstance()->add(CReadoutStatistics::Scalers);
   m_elapsedSeconds = endTime;
   delete pEvent;
 
@@ -712,7 +716,14 @@ COutputThread::event(void* pData)
 
     event.setBodyCursor(pEnd);
     event.updateSize();
+
+    CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+    uint64_t putStart = CReadoutStatistics::nowNs();
     event.commitToRing(*m_pRing);
+    pStats->add(CReadoutStatistics::RingPutNs, CReadoutStatistics::nowNs() - putStart);
+    CPipelineTrace::hopItem(CPipelineTrace::ReadoutOutput, event.getItemPointer());
+    pStats->add(CReadoutStatistics::Events);
+    pStats->add(CReadoutStatistics::EventBytes, m_nWordsInBuffer*sizeof(uint16_t));
 
     delete pEvent;
 
@@ -8,6 +8,7 @@
 #include <CResumeRun.h>
 #include <CInit.h>
 #include <CExit.h>
+#include <CReadoutStatsCommand.h>
 #include <Globals.h>
 #include <Events.h>
 
@@ -32,6 +33,7 @@ unique_ptr<CPauseRun>  CSystemControl::m_pPauseRun;
 unique_ptr<CResumeRun> CSystemControl::m_pResumeRun;
 unique_ptr<CInit>      CSystemControl::m_pInit;
 unique_ptr<CExit>      CSystemControl::m_pExit;
+unique_ptr<CReadoutStatsCommand> CSystemControl::m_pReadoutStats;
 
 
 // The entry point
@@ -65,6 +67,7 @@ int CSystemControl::AppInit( Tcl_Interp* interp)
   m_pResumeRun.reset(new CResumeRun(*Globals::pMainInterpreter));
   m_pInit.reset(new CInit(*Globals::pMainInterpreter));
   m_pExit.reset(new CExit(*Globals::pMainInterpreter));
+  m_pReadoutStats.reset(new CReadoutStatsCommand(*Globals::pMainInterpreter));
   
   // Look for readoutRC.tcl in the config directory.  If it exists, run it.
 
@@ -34,6 +34,12 @@
 #include <iostream>
 using namespace std;
 
+// The lists we believe the controller holds from the last begin run.
+// See loadStack and forgetHardwareState.
+
+CCCUSB*                                   CStack::m_pController(0);
+std::map<uint8_t, std::vector<uint16_t> > CStack::m_loadedLists;
+
 
 
 // -delay is in the range 0 - 0xff  number of microseconds of delay 
@@ -248,7 +254,17 @@ CStack::loadStack(CCCUSB& controller)
   listNumber = getTriggerType();	// 0 for event, 1 for scaler.
 
 
-  // Load the list:... unless it has no elements!
+  // Load the list:... unless it has no elements or it's already there.
+
+  useController(controller);
+  std::vector<uint16_t> contents = readoutList.get();
+  std::map<uint8_t, std::vector<uint16_t> >::iterator pLoaded = m_loadedLists.find(listNumber);
+  if ((pLoaded != m_loadedLists.end()) && (pLoaded->second == contents)) {
+    std::cerr << "Stack " << static_cast<int>(listNumber)
+	      << " is unchanged and already loaded\n";
+    return;
+  }
+  m_loadedLists.erase(listNumber);
 
   if (readoutList.size() > 0) {
     int status = controller.loadList(listNumber,
@@ -268,8 +284,20 @@ CStack::loadStack(CCCUSB& controller)
       msg += which;
       throw msg;
     }
+    m_loadedLists[listNumber] = contents;
   }
 }
+/*!
+   Forget which lists are loaded in the controller so that every list is
+   loaded again at the next begin run.  Used to force a full initialization
+   (the init command or --fullinit) and after errors.
+*/
+void
+CStack::forgetHardwareState()
+{
+  m_pController = 0;
+  m_loadedLists.clear();
+}
 /*!
   To do this we need to get the stack number...
   - For event stacks we need to program the lam mask register, and delay registers.
@@ -411,6 +439,17 @@ CStack::getListNumber()
   }
   assert(0);			// Error to be here.
 }
+/*
+   What we remember is only good for the controller it was done with.
+*/
+void
+CStack::useController(CCCUSB& controller)
+{
+  if (m_pController != &controller) {
+    forgetHardwareState();
+    m_pController = &controller;
+  }
+}
 /*
    Custom validator for the -modules switch.  This validator checks that
    - The proposed value is a valid Tcl list.
@@ -41,6 +41,13 @@
 #endif
 #endif
 
+#ifndef __STL_MAP
+#include <map>
+#ifndef __STL_MAP
+#define __STL_MAP
+#endif
+#endif
+
 
 // forward definitions
 
@@ -77,7 +84,11 @@ options only valid for scaler stacks:
 
 
 \endverbatim
-  
+
+  The class remembers the contents of each list it loaded so unchanged lists
+  are not reloaded at begin run.  Modules are always initialized, as nearly
+  all of them reset or clear the hardware in Initialize.
+  forgetHardwareState makes the next begin load every list.
 */
 class CStack : public CReadoutHardware
 {
@@ -95,6 +106,9 @@ private:
   CReadoutModule*    m_pConfiguration;
   static bool        m_incrementalScalers;
 
+  static CCCUSB*                                 m_pController;        // What we know of the hardware
+  static std::map<uint8_t, std::vector<uint16_t> > m_loadedLists;      // list number -> contents.
+
 
 public:
   // Canonicals:
@@ -126,6 +140,7 @@ public:
   void enableStack(CCCUSB& controller);
   TriggerType     getTriggerType();
   static bool     isIncremental() {return m_incrementalScalers; }
+  static void     forgetHardwareState();
 
 
   // Utility member functions:
@@ -134,6 +149,7 @@ private:
 
   unsigned int    getIntegerParameter(std::string name);
   StackElements   getStackElements();
+  static void     useController(CCCUSB& controller);
   int getListNumber();
 
   // Custom validators
@@ -0,0 +1,232 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReadoutStatistics.cpp
+ * @brief Implement the USB readout statistics block.
+ */
+
+#include <config.h>
+#include "CReadoutStatistics.h"
+
+#include <daqshm.h>
+
+#include <new>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,
+              "Readout statistics need lock free 64 bit atomics");
+
+const char* CReadoutStatistics::Magic("USBSTAT");
+
+CReadoutStatistics* CReadoutStatistics::m_pInstance(0);
+
+static const char* counterNames[CReadoutStatistics::NumCounters] = {
+  "usbBuffers", "usbBytes", "usbReadNs", "usbTimeouts",
+  "filledQueued", "filledDequeued", "filledMaxDepth",
+  "freeExhausted", "freeWaitNs",
+  "events", "eventBytes", "scalers", "ringPutNs"
+};
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *   Counters start out in private memory.
+ */
+CReadoutStatistics::CReadoutStatistics() :
+  m_pBlock(0),
+  m_pPrivate(reinterpret_cast<pBlock>(new char[sizeof(Block)]))
+{
+  initialize(m_pPrivate);
+  m_pBlock = m_pPrivate;
+}
+/**
+ * destructor
+ */
+CReadoutStatistics::~CReadoutStatistics()
+{
+  unpublish();
+  delete []reinterpret_cast<char*>(m_pPrivate);
+}
+
+/**
+ * getInstance
+ *   The statistics for this process.
+ */
+CReadoutStatistics*
+CReadoutStatistics::getInstance()
+{
+  if (!m_pInstance) {
+    m_pInstance = new CReadoutStatistics;
+  }
+  return m_pInstance;
+}
+
+/*----------------------------------------------------------------------------
+ * Publication
+ */
+
+/**
+ * publish
+ *   Move the counters into a shared memory region.  A region left behind
+ *   by an earlier readout with the same name is replaced.  This must be
+ *   called before the threads that update the counters start.
+ *
+ * @param name - Shared memory name (see defaultName).
+ *
+ * @throw std::string - the region could not be made.
+ */
+void
+CReadoutStatistics::publish(std::string name)
+{
+  unpublish();
+  CDAQShm::remove(name);
+  if (CDAQShm::create(name, sizeof(Block),
+                      CDAQShm::GroupRead | CDAQShm::OtherRead)) {
+    std::string msg = "Unable to create readout statistics shared memory ";
+    msg += name + ": ";
+    msg += CDAQShm::errorMessage(CDAQShm::lastError());
+    throw msg;
+  }
+  pBlock pShared = reinterpret_cast<pBlock>(CDAQShm::attach(name));
+  if (!pShared) {
+    std::string msg = "Unable to map readout statistics shared memory ";
+    msg += name + ": ";
+    msg += CDAQShm::errorMessage(CDAQShm::lastError());
+    CDAQShm::remove(name);
+    throw msg;
+  }
+  initialize(pShared);
+  for (int i = 0; i < NumCounters; i++) {
+    pShared->s_counters[i].store(get(Counter(i)), std::memory_order_relaxed);
+  }
+  m_pBlock  = pShared;
+  m_shmName = name;
+}
+/**
+ * unpublish
+ *   Move the counters back to private memory and delete the shared
+ *   region.  No other thread may be updating counters.
+ */
+void
+CReadoutStatistics::unpublish()
+{
+  if (m_shmName != "") {
+    for (int i = 0; i < NumCounters; i++) {
+      m_pPrivate->s_counters[i].store(get(Counter(i)), std::memory_order_relaxed);
+    }
+    pBlock pShared = m_pBlock;
+    m_pBlock = m_pPrivate;
+    CDAQShm::detach(pShared, m_shmName, sizeof(Block));
+    CDAQShm::remove(m_shmName);
+    m_shmName = "";
+  }
+}
+
+/**
+ * filledDepth
+ *   Number of buffers waiting for the output thread.
+ */
+uint64_t
+CReadoutStatistics::filledDepth() const
+{
+  uint64_t dequeued = get(FilledDequeued);   // First so depth can't go negative.
+  uint64_t queued   = get(FilledQueued);
+  return queued > dequeued ? queued - dequeued : 0;
+}
+
+/*----------------------------------------------------------------------------
+ * Utilities
+ */
+
+/**
+ * nowNs
+ *   Monotonic clock in nanoseconds for timing hot path operations.
+ */
+uint64_t
+CReadoutStatistics::nowNs()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return uint64_t(now.tv_sec)*1000000000 + now.tv_nsec;
+}
+/**
+ * counterName
+ *   @return const char* - name of a counter, 0 if c is out of range.
+ */
+const char*
+CReadoutStatistics::counterName(unsigned c)
+{
+  return c < NumCounters ? counterNames[c] : 0;
+}
+/**
+ * defaultName
+ *   The shared memory name used by a readout that puts data into a ring.
+ *
+ * @param ringName - name of the output ring.
+ */
+std::string
+CReadoutStatistics::defaultName(std::string ringName)
+{
+  return std::string("/") + ringName + "-usbstats";
+}
+/**
+ * attach
+ *   Map a published statistics region for reading.
+ *
+ * @param name - Shared memory name.
+ *
+ * @return const Block* - 0 if the region does not exist or is not a
+ *                        statistics region of this version.
+ */
+const CReadoutStatistics::Block*
+CReadoutStatistics::attach(std::string name)
+{
+  if (CDAQShm::size(name) < ssize_t(sizeof(Block))) {
+    return 0;
+  }
+  const Block* p = reinterpret_cast<const Block*>(CDAQShm::attach(name));
+  if (p && ((memcmp(p->s_magic, Magic, strlen(Magic) + 1) != 0) ||
+            (p->s_version != Version))) {
+    CDAQShm::detach(const_cast<Block*>(p), name, sizeof(Block));
+    p = 0;
+  }
+  return p;
+}
+/**
+ * initialize
+ *   Fill in a new block in raw memory.  Only the plain header fields are
+ *   cleared; the counters are constructed in place.
+ */
+void
+CReadoutStatistics::initialize(pBlock p)
+{
+  memset(p->s_magic, 0, sizeof(p->s_magic));
+  strcpy(p->s_magic, Magic);
+  p->s_version      = Version;
+  p->s_counterCount = NumCounters;
+  p->s_startTime    = time(0);
+  p->s_pid          = getpid();
+  p->s_unused       = 0;
+  for (int i = 0; i < NumCounters; i++) {
+    new(&(p->s_counters[i])) std::atomic<uint64_t>(0);
+  }
+}
@@ -0,0 +1,128 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReadoutStatistics.h
+ * @brief Runtime counters for the USB readout programs.
+ */
+#ifndef CREADOUTSTATISTICS_H
+#define CREADOUTSTATISTICS_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @class CReadoutStatistics
+ *
+ *   Counters maintained by the acquisition and output threads of the
+ *   VM-USB and CC-USB readout programs.  Counters are updated with relaxed
+ *   atomics so the hot paths never lock.  Once published the counters live
+ *   in a named shared memory region (see publish()) so that other programs
+ *   (e.g. usbstats) can watch them while the readout is running.
+ *
+ *   All counters are cumulative; rates come from sampling twice.  Counters
+ *   whose names end in Ns are nanosecond totals.
+ */
+class CReadoutStatistics
+{
+public:
+  typedef enum _Counter {
+    UsbBuffers,        // Buffers read from the controller.
+    UsbBytes,          // Bytes in those buffers.
+    UsbReadNs,         // Time spent in reads that returned data.
+    UsbTimeouts,       // Reads that timed out.
+    FilledQueued,      // Buffers queued to the output thread.
+    FilledDequeued,    // Buffers taken by the output thread.
+    FilledMaxDepth,    // Most buffers ever waiting for the output thread.
+    FreeExhausted,     // Times no free buffer was available.
+    FreeWaitNs,        // Time waiting for free buffers.
+    Events,            // Physics events put in the ring.
+    EventBytes,        // Bytes of event body put in the ring.
+    Scalers,           // Scaler items put in the ring.
+    RingPutNs,         // Time spent putting items in the ring.
+    NumCounters
+  } Counter;
+
+  // Layout of the shared memory region:
+
+  typedef struct _Block {
+    char                  s_magic[8];
+    uint32_t              s_version;
+    uint32_t              s_counterCount;
+    int64_t               s_startTime;       // time() when published.
+    int32_t               s_pid;             // Publishing process.
+    uint32_t              s_unused;
+    std::atomic<uint64_t> s_counters[NumCounters];
+  } Block, *pBlock;
+
+  static const char*    Magic;               // "USBSTAT"
+  static const uint32_t Version = 1;
+
+private:
+  pBlock      m_pBlock;
+  pBlock      m_pPrivate;                    // Used until published.
+  std::string m_shmName;
+
+  static CReadoutStatistics* m_pInstance;
+
+public:
+  CReadoutStatistics();
+  virtual ~CReadoutStatistics();
+
+private:
+  CReadoutStatistics(const CReadoutStatistics& rhs);
+  CReadoutStatistics& operator=(const CReadoutStatistics& rhs);
+
+public:
+  static CReadoutStatistics* getInstance();
+
+  void publish(std::string name);
+  void unpublish();
+  std::string shmName() const { return m_shmName; }
+
+  // Hot path updates:
+
+  void add(Counter c, uint64_t n = 1) {
+    m_pBlock->s_counters[c].fetch_add(n, std::memory_order_relaxed);
+  }
+  void atLeast(Counter c, uint64_t value) {
+    uint64_t current = m_pBlock->s_counters[c].load(std::memory_order_relaxed);
+    while ((value > current) &&
+           !m_pBlock->s_counters[c].compare_exchange_weak(
+             current, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t get(Counter c) const {
+    return m_pBlock->s_counters[c].load(std::memory_order_relaxed);
+  }
+  uint64_t filledDepth() const;
+  const Block* block() const { return m_pBlock; }
+
+  // Utilities:
+
+  static uint64_t     nowNs();
+  static const char*  counterName(unsigned c);
+  static std::string  defaultName(std::string ringName);
+  static const Block* attach(std::string name);
+
+private:
+  static void initialize(pBlock pBlock);
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReadoutStatsCommand.cpp
+ * @brief Implement the readoutstats Tcl command.
+ */
+
+#include <config.h>
+#include "CReadoutStatsCommand.h"
+#include "CReadoutStatistics.h"
+
+#include <TCLInterpreter.h>
+#include <TCLObject.h>
+#include <tcl.h>
+#include <time.h>
+
+/**
+ * constructor
+ *   Registers the command.
+ *
+ * @param interp - Interpreter on which the command is registered.
+ * @param name   - Command name.
+ */
+CReadoutStatsCommand::CReadoutStatsCommand(CTCLInterpreter& interp, const char* name) :
+  CTCLObjectProcessor(interp, name, true)
+{}
+/**
+ * destructor
+ */
+CReadoutStatsCommand::~CReadoutStatsCommand()
+{}
+
+/**
+ * operator()
+ *   Execute the command; it takes no parameters.
+ *
+ * @param interp - interpreter running the command.
+ * @param objv   - command words.
+ *
+ * @return int - TCL_OK on success, TCL_ERROR if there were parameters.
+ */
+int
+CReadoutStatsCommand::operator()(CTCLInterpreter& interp,
+				 std::vector<CTCLObject>& objv)
+{
+  if (objv.size() != 1) {
+    interp.setResult("Usage: readoutstats");
+    return TCL_ERROR;
+  }
+  CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+
+  CTCLObject result;
+  result.Bind(interp);
+  for (unsigned i = 0; i < CReadoutStatistics::NumCounters; i++) {
+    result += CReadoutStatistics::counterName(i);
+    result += Tcl_NewWideIntObj(
+      pStats->get(static_cast<CReadoutStatistics::Counter>(i))
+    );
+  }
+  result += "filledDepth";
+  result += Tcl_NewWideIntObj(pStats->filledDepth());
+  result += "elapsed";
+  result += Tcl_NewWideIntObj(time(0) - pStats->block()->s_startTime);
+  result += "shm";
+  result += pStats->shmName();
+
+  interp.setResult(result);
+  return TCL_OK;
+}
@@ -0,0 +1,56 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReadoutStatsCommand.h
+ * @brief The readoutstats Tcl command.
+ */
+#ifndef CREADOUTSTATSCOMMAND_H
+#define CREADOUTSTATSCOMMAND_H
+
+#include <TCLObjectProcessor.h>
+
+#include <vector>
+
+class CTCLInterpreter;
+class CTCLObject;
+
+/**
+ * @class CReadoutStatsCommand
+ *
+ *   readoutstats - returns the readout statistics (see CReadoutStatistics)
+ *   as a list of name value pairs suitable for dict or array set.  In
+ *   addition to the counters the list has:
+ *   - filledDepth - buffers now waiting for the output thread.
+ *   - elapsed     - seconds since the statistics were published.
+ *   - shm         - the shared memory name (empty if not published).
+ */
+class CReadoutStatsCommand : public CTCLObjectProcessor
+{
+public:
+  CReadoutStatsCommand(CTCLInterpreter& interp, const char* name = "readoutstats");
+  virtual ~CReadoutStatsCommand();
+
+private:
+  CReadoutStatsCommand(const CReadoutStatsCommand& rhs);
+  CReadoutStatsCommand& operator=(const CReadoutStatsCommand& rhs);
+
+protected:
+  virtual int operator()(CTCLInterpreter& interp,
+			 std::vector<CTCLObject>& objv);
+};
+
+#endif
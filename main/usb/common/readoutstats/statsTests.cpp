@@ -0,0 +1,152 @@
+// Tests for the USB readout statistics block.
+
+#include <config.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include "CReadoutStatistics.h"
+#include <daqshm.h>
+#include <string>
+#include <stdint.h>
+#include <unistd.h>
+#include <stdio.h>
+
+using namespace std;
+
+class StatsTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(StatsTests);
+  CPPUNIT_TEST(Initial);
+  CPPUNIT_TEST(Add);
+  CPPUNIT_TEST(AtLeast);
+  CPPUNIT_TEST(Depth);
+  CPPUNIT_TEST(Names);
+  CPPUNIT_TEST(Publish);
+  CPPUNIT_TEST(Unpublish);
+  CPPUNIT_TEST(AttachMissing);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  CReadoutStatistics* m_pStats;
+  string              m_name;
+public:
+  void setUp() {
+    m_pStats = new CReadoutStatistics;
+    char name[100];
+    snprintf(name, sizeof(name), "/statstest-%d", getpid());
+    m_name = name;
+  }
+  void tearDown() {
+    delete m_pStats;
+    CDAQShm::remove(m_name);
+  }
+protected:
+  void Initial();
+  void Add();
+  void AtLeast();
+  void Depth();
+  void Names();
+  void Publish();
+  void Unpublish();
+  void AttachMissing();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StatsTests);
+
+void
+StatsTests::Initial()
+{
+  for (int i = 0; i < CReadoutStatistics::NumCounters; i++) {
+    EQ(uint64_t(0), m_pStats->get(CReadoutStatistics::Counter(i)));
+  }
+  EQ(string(""), m_pStats->shmName());
+}
+
+void
+StatsTests::Add()
+{
+  m_pStats->add(CReadoutStatistics::Events);
+  m_pStats->add(CReadoutStatistics::Events);
+  m_pStats->add(CReadoutStatistics::EventBytes, 1234);
+  EQ(uint64_t(2),    m_pStats->get(CReadoutStatistics::Events));
+  EQ(uint64_t(1234), m_pStats->get(CReadoutStatistics::EventBytes));
+  EQ(uint64_t(0),    m_pStats->get(CReadoutStatistics::Scalers));
+}
+
+void
+StatsTests::AtLeast()
+{
+  m_pStats->atLeast(CReadoutStatistics::FilledMaxDepth, 5);
+  EQ(uint64_t(5), m_pStats->get(CReadoutStatistics::FilledMaxDepth));
+  m_pStats->atLeast(CReadoutStatistics::FilledMaxDepth, 3);
+  EQ(uint64_t(5), m_pStats->get(CReadoutStatistics::FilledMaxDepth));
+  m_pStats->atLeast(CReadoutStatistics::FilledMaxDepth, 7);
+  EQ(uint64_t(7), m_pStats->get(CReadoutStatistics::FilledMaxDepth));
+}
+
+void
+StatsTests::Depth()
+{
+  m_pStats->add(CReadoutStatistics::FilledQueued, 10);
+  m_pStats->add(CReadoutStatistics::FilledDequeued, 4);
+  EQ(uint64_t(6), m_pStats->filledDepth());
+  m_pStats->add(CReadoutStatistics::FilledDequeued, 6);
+  EQ(uint64_t(0), m_pStats->filledDepth());
+}
+
+void
+StatsTests::Names()
+{
+  EQ(string("usbBuffers"), string(CReadoutStatistics::counterName(0)));
+  EQ(string("ringPutNs"),
+     string(CReadoutStatistics::counterName(CReadoutStatistics::RingPutNs)));
+  ASSERT(!CReadoutStatistics::counterName(CReadoutStatistics::NumCounters));
+  EQ(string("/fox-usbstats"), CReadoutStatistics::defaultName("fox"));
+}
+
+// Counters made before publication carry over and later updates are
+// visible to a reader.
+
+void
+StatsTests::Publish()
+{
+  m_pStats->add(CReadoutStatistics::UsbBuffers, 3);
+  m_pStats->publish(m_name);
+  EQ(m_name, m_pStats->shmName());
+
+  const CReadoutStatistics::Block* p = CReadoutStatistics::attach(m_name);
+  ASSERT(p);
+  EQ(getpid(), pid_t(p->s_pid));
+  EQ(uint32_t(CReadoutStatistics::NumCounters), p->s_counterCount);
+  EQ(uint64_t(3), p->s_counters[CReadoutStatistics::UsbBuffers].load());
+
+  m_pStats->add(CReadoutStatistics::UsbBuffers);
+  EQ(uint64_t(4), p->s_counters[CReadoutStatistics::UsbBuffers].load());
+
+  CDAQShm::detach(const_cast<CReadoutStatistics::Block*>(p), m_name,
+                  sizeof(CReadoutStatistics::Block));
+}
+
+void
+StatsTests::Unpublish()
+{
+  m_pStats->publish(m_name);
+  m_pStats->add(CReadoutStatistics::Scalers, 2);
+  m_pStats->unpublish();
+
+  EQ(string(""), m_pStats->shmName());
+  ASSERT(CDAQShm::size(m_name) < 0);
+  EQ(uint64_t(2), m_pStats->get(CReadoutStatistics::Scalers));
+}
+
+void
+StatsTests::AttachMissing()
+{
+  ASSERT(!CReadoutStatistics::attach(m_name));
+
+  // A region that is not a statistics block is rejected:
+
+  CDAQShm::create(m_name, sizeof(CReadoutStatistics::Block),
+                  CDAQShm::GroupRead);
+  ASSERT(!CReadoutStatistics::attach(m_name));
+}
@@ -0,0 +1,154 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file usbstats.cpp
+ * @brief Display the statistics of a running VMUSBReadout/CCUSBReadout.
+ *
+ * Usage:
+ *    usbstats ?-i seconds? ?-n count? ?ring-or-shm-name?
+ *
+ *  The name is either the readout's output ring (default the user's ring)
+ *  or, if it starts with /, the statistics shared memory name.  Every
+ *  interval (default 2 seconds) the counters, their rates and a few
+ *  derived values are written.  -n limits the number of reports.
+ */
+
+#include <config.h>
+#include "CReadoutStatistics.h"
+#include <CRingBuffer.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+
+static void
+usage()
+{
+  std::cerr << "Usage:\n";
+  std::cerr << "   usbstats ?-i seconds? ?-n count? ?ring-or-shm-name?\n";
+  exit(EXIT_FAILURE);
+}
+
+static double
+ratio(double numerator, double denominator)
+{
+  return denominator > 0 ? numerator/denominator : 0.0;
+}
+
+/**
+ * report
+ *   Write one report.
+ *
+ * @param p       - The statistics block.
+ * @param prior   - Counter values at the last report.
+ * @param seconds - Seconds since then.
+ */
+static void
+report(const CReadoutStatistics::Block* p, uint64_t* prior, double seconds)
+{
+  typedef CReadoutStatistics S;
+  uint64_t now[S::NumCounters];
+  uint64_t delta[S::NumCounters];
+  for (int i = 0; i < S::NumCounters; i++) {
+    now[i]   = p->s_counters[i].load(std::memory_order_relaxed);
+    delta[i] = now[i] - prior[i];
+  }
+
+  std::cout << "--------------------------------------------------\n";
+  std::cout << std::setw(16) << "counter" << std::setw(18) << "total"
+            << std::setw(16) << "per second" << std::endl;
+  for (int i = 0; i < S::NumCounters; i++) {
+    std::cout << std::setw(16) << S::counterName(i)
+              << std::setw(18) << now[i]
+              << std::setw(16) << std::fixed << std::setprecision(1)
+              << ratio(delta[i], seconds) << std::endl;
+  }
+  uint64_t depth = now[S::FilledQueued] > now[S::FilledDequeued] ?
+    now[S::FilledQueued] - now[S::FilledDequeued] : 0;
+
+  std::cout << std::setprecision(2);
+  std::cout << "filled buffer depth      : " << depth << std::endl;
+  std::cout << "bytes per event          : "
+            << ratio(delta[S::EventBytes], delta[S::Events]) << std::endl;
+  std::cout << "bytes per USB buffer     : "
+            << ratio(delta[S::UsbBytes], delta[S::UsbBuffers]) << std::endl;
+  std::cout << "usec per USB read        : "
+            << ratio(delta[S::UsbReadNs], 1000.0*delta[S::UsbBuffers]) << std::endl;
+  std::cout << "% time waiting for free  : "
+            << ratio(100.0*delta[S::FreeWaitNs], seconds*1.0e9) << std::endl;
+  std::cout << "% time putting to ring   : "
+            << ratio(100.0*delta[S::RingPutNs], seconds*1.0e9) << std::endl;
+
+  memcpy(prior, now, sizeof(now));
+}
+
+int
+main(int argc, char** argv)
+{
+  unsigned interval = 2;
+  int      count    = -1;
+  int      opt;
+  while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+    switch (opt) {
+    case 'i':
+      interval = atoi(optarg);
+      if (interval == 0) usage();
+      break;
+    case 'n':
+      count = atoi(optarg);
+      break;
+    default:
+      usage();
+    }
+  }
+  if (argc - optind > 1) usage();
+
+  std::string name = (optind < argc) ? argv[optind] : CRingBuffer::defaultRing();
+  if (name[0] != '/') {
+    name = CReadoutStatistics::defaultName(name);
+  }
+
+  const CReadoutStatistics::Block* p = CReadoutStatistics::attach(name);
+  if (!p) {
+    std::cerr << "usbstats: " << name
+              << " is not a readout statistics shared memory region\n";
+    exit(EXIT_FAILURE);
+  }
+  if ((kill(p->s_pid, 0) < 0) && (errno == ESRCH)) {
+    std::cerr << "usbstats: warning - the readout (pid " << p->s_pid
+              << ") is no longer running\n";
+  }
+
+  uint64_t prior[CReadoutStatistics::NumCounters];
+  for (int i = 0; i < CReadoutStatistics::NumCounters; i++) {
+    prior[i] = p->s_counters[i].load(std::memory_order_relaxed);
+  }
+  uint64_t last = CReadoutStatistics::nowNs();
+  while (count != 0) {
+    sleep(interval);
+    uint64_t now = CReadoutStatistics::nowNs();
+    report(p, prior, (now - last)/1.0e9);
+    last = now;
+    if (count > 0) count--;
+  }
+  return EXIT_SUCCESS;
+}
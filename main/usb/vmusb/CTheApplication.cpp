@@ -36,10 +36,12 @@
 #include <os.h>
 #include <CRunState.h>
 #include <CControlQueues.h>
+#include <CReadoutStatistics.h>
 
 #include <CPortManager.h>
 
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <stdexcept>
 
@@ -155,6 +157,19 @@ int CTheApplication::operator()(int argc, char** argv)
     enumerateVMUSB();
     Tcl_Exit(EXIT_SUCCESS);
   }
+  Globals::fullInit = parsedArgs.fullinit_flag != 0;
+  if ((parsedArgs.multibuffer_arg < 0) || 
+      (parsedArgs.multibuffer_arg > CVMUSB::TransferSetupRegister::multiBufferCountMask)) {
+    std::cerr << "--multibuffer must be in the range [0, "
+              << CVMUSB::TransferSetupRegister::multiBufferCountMask << "]\n";
+    Tcl_Exit(EXIT_FAILURE);
+  }
+  if ((parsedArgs.bulk_timeout_arg < 0) || (parsedArgs.bulk_timeout_arg > 15)) {
+    std::cerr << "--bulk-timeout must be in the range [0, 15]\n";
+    Tcl_Exit(EXIT_FAILURE);
+  }
+  Globals::bulkTransferBuffers = parsedArgs.multibuffer_arg;
+  Globals::bulkTransferTimeout = Globals::bulkTransferBuffers ? parsedArgs.bulk_timeout_arg : 0;
   if (parsedArgs.init_script_given) {
     m_systemControl.setInitScript(string(parsedArgs.init_script_arg));
   }
@@ -197,8 +212,19 @@ int CTheApplication::operator()(int argc, char** argv)
     }
     
     initializeBufferPool();
-    startOutputThread(destinationRing(parsedArgs.ring_given ? parsedArgs.ring_arg :
-				      reinterpret_cast<const char*>(NULL)));
+    std::string ringName = destinationRing(parsedArgs.ring_given ? parsedArgs.ring_arg :
+					   reinterpret_cast<const char*>(NULL));
+
+    // Publish the readout statistics where usbstats can find them.  Failing
+    // to do so is not fatal; the readoutstats command still works.
+
+    try {
+      CReadoutStatistics::getInstance()->publish(CReadoutStatistics::defaultName(ringName));
+    }
+    catch (std::string msg) {
+      std::cerr << "Warning: " << msg << std::endl;
+    }
+    startOutputThread(ringName);
 
     // Replace the default server port if the user supplied one and start the Tcl server.
 
@@ -368,14 +394,16 @@ CTheApplication::setConfigFiles()
    top of this file;
    - bufferCount  - Number of buffers to create.
    - bufferSize   - Size (in bytes) of the buffer (payload).
+   With --multibuffer each buffer must hold a full bulk transfer.
 
 */
 void
 CTheApplication::initializeBufferPool()
 {
   Globals::usbBufferSize = bufferSize;
+  uint32_t transferSize  = bufferSize * std::max(1U, Globals::bulkTransferBuffers);
   for(uint i =0; i < bufferCount; i++) {
-    DataBuffer* p = createDataBuffer(bufferSize);
+    DataBuffer* p = createDataBuffer(transferSize);
     gFreeBuffers.queue(p);
   }
 }
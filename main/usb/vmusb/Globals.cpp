@@ -39,4 +39,7 @@ namespace Globals {
   char*              pTimestampExtractor = 0;
   Tcl_ThreadId           mainThreadId = 0;
   CTCLInterpreter*       pMainInterpreter = 0;
+  bool                   fullInit = false;
+  unsigned               bulkTransferBuffers = 0;
+  unsigned               bulkTransferTimeout = 0;
 };
@@ -62,6 +62,9 @@ namespace Globals {
   extern char*           pTimestampExtractor;
   extern Tcl_ThreadId           mainThreadId;
   extern CTCLInterpreter*       pMainInterpreter;
+  extern bool                   fullInit;
+  extern unsigned               bulkTransferBuffers; // 0 - no multi-buffering.
+  extern unsigned               bulkTransferTimeout; // Seconds.
 };
 
 #endif
@@ -24,6 +24,7 @@ East Lansing, MI 48824-1321
 #include <CVMUSB.h>
 #include <CVMUSBReadoutList.h>
 #include <DataBuffer.h>
+#include "CVMUSBTransfer.h"
 #include <CControlQueues.h>
 #include <event.h>
 #include "CRunState.h" 
@@ -35,6 +36,7 @@ East Lansing, MI 48824-1321
 #include <Exception.h>
 #include <TclServer.h>
 #include <os.h>
+#include <CReadoutStatistics.h>
 #include <tcl.h>
 
 #include <iostream>
@@ -66,6 +68,24 @@ vector<CReadoutModule*> CAcquisitionThread::m_Stacks;
 
 unsigned long CAcquisitionThread::m_tid; // Thread id of the running thread.
 
+/*
+** Get a free buffer, noting in the statistics when none was ready
+** and how long we waited for one.
+*/
+static DataBuffer*
+getFreeBuffer()
+{
+  DataBuffer* pBuffer;
+  if (!gFreeBuffers.getnow(pBuffer)) {
+    CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+    uint64_t            start  = CReadoutStatistics::nowNs();
+    pStats->add(CReadoutStatistics::FreeExhausted);
+    pBuffer = gFreeBuffers.get();
+    pStats->add(CReadoutStatistics::FreeWaitNs, CReadoutStatistics::nowNs() - start);
+  }
+  return pBuffer;
+}
+
 
 /*!
   Construct the the acquisition thread object.
@@ -163,7 +183,11 @@ void CAcquisitionThread::init()
     Globals::running = false;
     cerr << "CAcquisition thread caught some other exception type.\n";
   }
+  // If we failed we don't know what we left in the hardware:
 
+  if (!Globals::running) {
+    CStack::forgetHardwareState();
+  }
 }
 
 /*!
@@ -221,6 +245,7 @@ void CAcquisitionThread::operator()()
   // If there's an error message report the error to the main thread:
 
   if (errorMessage != "") {
+    CStack::forgetHardwareState(); // Hardware may have been power cycled.
     reportErrorToMainThread(errorMessage);
     return;
   }
@@ -239,8 +264,9 @@ void CAcquisitionThread::operator()()
   void
 CAcquisitionThread::mainLoop()
 {
-  DataBuffer*     pBuffer   = gFreeBuffers.get();
+  DataBuffer*     pBuffer   = getFreeBuffer();
   CControlQueues* pCommands = CControlQueues::getInstance(); 
+  CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
   try {
     unsigned int consecutiveTimeouts = 0;
     while (true) {
@@ -248,17 +274,22 @@ CAcquisitionThread::mainLoop()
       // Event data from the VM-usb.
 
       size_t bytesRead;
+      uint64_t readStart = CReadoutStatistics::nowNs();
       int status = m_pVme->usbRead(pBuffer->s_rawData, pBuffer->s_storageSize,
           &bytesRead,
-          USBTIMEOUT*1000 );
+          (USBTIMEOUT + Globals::bulkTransferTimeout)*1000 ); // Outlast partial multi-buffer transfers.
       if (status == 0) {
+        pStats->add(CReadoutStatistics::UsbReadNs, CReadoutStatistics::nowNs() - readStart);
+        pStats->add(CReadoutStatistics::UsbBuffers);
+        pStats->add(CReadoutStatistics::UsbBytes, bytesRead);
         consecutiveTimeouts = 0;
         pBuffer->s_bufferSize = bytesRead;
         pBuffer->s_bufferType   = TYPE_EVENTS;
         processBuffer(pBuffer); // Submitted to output thread so...
-        pBuffer = gFreeBuffers.get(); // need a new one.
+        pBuffer = getFreeBuffer(); // need a new one.
       } 
       else {
+        pStats->add(CReadoutStatistics::UsbTimeouts);
         if (errno != ETIMEDOUT) {
           cerr << "Bad status from usbread: " << strerror(errno) << endl;
           cerr << "Ending the run... check the VME Crate.. If it power cycled restart this program\n";
@@ -372,6 +403,9 @@ CAcquisitionThread::processBuffer(DataBuffer* pBuffer)
     gFreeBuffers.queue(pBuffer);
   } 
   else {
+    CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+    pStats->add(CReadoutStatistics::FilledQueued);
+    pStats->atLeast(CReadoutStatistics::FilledMaxDepth, pStats->filledDepth());
     gFilledBuffers.queue(pBuffer);  // Send it on to be routed to spectrodaq in another thread.
   }
 }
@@ -412,9 +446,23 @@ CAcquisitionThread::startDaq()
   //  m_pVme->writeActionRegister(CVMUSB::ActionRegister::sysReset);
   m_pVme->writeActionRegister(0);
 
-  // Set up the buffer size and mode:
-
-  m_pVme->writeBulkXferSetup(0 << CVMUSB::TransferSetupRegister::timeoutShift); // don't want multibuffering...1sec timeout is fine.
+  // Set up the buffer size and mode.  Unless --multibuffer was given
+  // each usbRead gets a single buffer. Otherwise a bulk transfer holds up to
+  // Globals::bulkTransferBuffers buffers, and events can span buffers and
+  // scaler events share buffers with the rest of the data:
+
+  uint16_t bufferMode(0);
+  if (Globals::bulkTransferBuffers) {
+    m_pVme->writeBulkXferSetup(
+      ((Globals::bulkTransferBuffers << CVMUSB::TransferSetupRegister::multiBufferCountShift) &
+       CVMUSB::TransferSetupRegister::multiBufferCountMask)                               |
+      ((Globals::bulkTransferTimeout << CVMUSB::TransferSetupRegister::timeoutShift) &
+       CVMUSB::TransferSetupRegister::timeoutMask));
+    bufferMode = CVMUSB::GlobalModeRegister::mixedBuffers | 
+                 CVMUSB::GlobalModeRegister::spanBuffers;
+  } else {
+    m_pVme->writeBulkXferSetup(0 << CVMUSB::TransferSetupRegister::timeoutShift); // don't want multibuffering...1sec timeout is fine.
+  }
 
   // The global mode:
   //   13k buffer
@@ -426,8 +474,7 @@ CAcquisitionThread::startDaq()
   //
   m_pVme->writeGlobalMode((4 << CVMUSB::GlobalModeRegister::busReqLevelShift) | 
                             //        CVMUSB::GlobalModeRegister::flushScalers |
-                            // CVMUSB::GlobalModeRegister::mixedBuffers        |
-                            // CVMUSB::GlobalModeRegister::spanBuffers         |
+                            bufferMode                                        |
                             (CVMUSB::GlobalModeRegister::bufferLen13K << 
                                   CVMUSB::GlobalModeRegister::bufferLenShift));
 
@@ -445,6 +492,9 @@ CAcquisitionThread::startDaq()
   // stack load offset.
 
   CStack::resetStackOffset();
+  if (Globals::fullInit) {
+    CStack::forgetHardwareState(); // Load every stack.
+  }
 
   cerr << "Loading " << m_Stacks.size() << " stacks to vm-usb\n";
   m_haveScalerStack = false;
@@ -469,7 +519,7 @@ CAcquisitionThread::startDaq()
   if (list.size() != 0) {
     std::cerr << "Loading monitor stack of size: " << list.size() << " at offset: " << CStack::getOffset() << std::endl;
     size_t currentOffset = CStack::getOffset();
-    m_pVme->loadList(7, list, currentOffset); // The tcl server will periodically trigger the list.
+    CStack::loadList(*m_pVme, 7, list, currentOffset); // The tcl server will periodically trigger the list.
   }
 
 
@@ -582,31 +632,36 @@ CAcquisitionThread::VMusbToAutonomous()
 /*!
   Drain usb - We read buffers from the DAQ (with an extended timeout)
   until the buffer we get indicates it was the last one (data taking turned off).
-  Each buffer is processed normally.
+  Each buffer is processed normally; problems with its data are reported
+  by the output thread, not again by the check for the last buffer.
  */
   void
 CAcquisitionThread::drainUsb()
 {
   bool done = false;
-  DataBuffer* pBuffer = gFreeBuffers.get();
+  DataBuffer* pBuffer = getFreeBuffer();
   int timeouts(0);
   size_t bytesRead;
   cerr << "CAcquisitionThread::drainUsb...\n";
   do {
     int    status = m_pVme->usbRead(pBuffer->s_rawData, pBuffer->s_storageSize,
         &bytesRead, 
-        DRAINTIMEOUTS*1000); // 5 second timeout!!
+        (DRAINTIMEOUTS + Globals::bulkTransferTimeout)*1000); // 5 second timeout!!
     if (status == 0) {
       pBuffer->s_bufferSize = bytesRead;
       pBuffer->s_bufferType   = TYPE_EVENTS;
       cerr << "Got a buffer, with type header: " << hex << pBuffer->s_rawData[0] << endl;
-      if (pBuffer->s_rawData[0] & VMUSBLastBuffer) {
+      CVMUSBTransfer transfer(
+        pBuffer->s_rawData, bytesRead,
+        m_pVme->getShadowRegisters().globalMode & CVMUSB::GlobalModeRegister::doubleHeader
+      );
+      if (transfer.lastBuffer()) {     // Need not be the first of a multi-buffer transfer.
         bootToTheHead();
         cerr << "Done\n";
         done = true;
       }
       processBuffer(pBuffer);
-      pBuffer = gFreeBuffers.get();
+      pBuffer = getFreeBuffer();
     }
     else {
       timeouts++;   // By the time debugged this is only failure.
@@ -25,6 +25,7 @@
 #include <ErrnoException.h>
 #include <Globals.h>
 #include <CVMUSB.h>
+#include "CVMUSBTransfer.h"
 #include <TclServer.h>
 
 #include <assert.h>
@@ -41,6 +42,8 @@
 #include <CRingTextItem.h>
 #include <CDataFormatItem.h>
 #include <CStack.h>
+#include <CReadoutStatistics.h>
+#include <CPipelineTrace.h>
 
 #include <sys/time.h>
 #include <dlfcn.h>
@@ -214,6 +217,7 @@ DataBuffer&
 COutputThread::getBuffer()
 {
   DataBuffer* pBuffer = gFilledBuffers.get(); // Will block if needed.
+  CReadoutStatistics::getInstance()->add(CReadoutStatistics::FilledDequeued);
   return *pBuffer;
 
 }
@@ -328,6 +332,7 @@ COutputThread::startRun(DataBuffer& buffer)
   m_elapsedSeconds = 0;
   
   m_nEventsSeen    = 0;
+  m_scalerSegments.clear();
 
   CDataFormatItem format;
   format.commitToRing(*m_pRing);
@@ -365,6 +370,7 @@ COutputThread::endRun(DataBuffer& buffer)
 
   free(m_pBuffer);
   m_pBuffer = 0;
+  m_scalerSegments.clear();   // Partial scaler event can't be finished.
 
   // Determine the absolute timestamp.
 
@@ -402,6 +408,7 @@ COutputThread::pauseRun(DataBuffer& buffer)
 {
   free(m_pBuffer);
   m_pBuffer = 0;
+  m_scalerSegments.clear();   // Partial scaler event can't be finished.
 
   // Determine the absolute timestamp.
 
@@ -482,98 +489,68 @@ bool COutputThread::hasOptionalHeader()
 
 /**
  * Process events in a buffer creating output buffers as required.
- *  - Figure out the used words in the buffer
- *  - For each event in the buffer invoke either event or scaler depending on
+ *  - The buffer can hold several VM-USB buffers if multi-buffer bulk
+ *    transfers are enabled; each is processed in turn.
+ *  - For each event in a VM-USB buffer invoke either event or scaler depending on
  *    the stack number.  Stack 1 is always a scaler event while any other stack
  *    is considered a physics event.
  *  - Stack 7 is the monitor stack and is sent to the Tcl server via a Tcl event
  *    sent to its event queue.
  *
+ * Events that span VM-USB buffers arrive as segments (see CVMUSBTransfer);
+ * event and scaler reassemble them.
+ *
  * @param inBuffer  -  Reference to a raw input buffer.
  */
 static uint32_t  bufferNumber = 0; 
 void 
 COutputThread::processEvents(DataBuffer& inBuffer)
 {
-  uint16_t* pContents = inBuffer.s_rawData;
-  int16_t  nEvents   = (*pContents) & VMUSBNEventMask;
-
+  CVMUSBTransfer         transfer(inBuffer.s_rawData, inBuffer.s_bufferSize,
+                                  hasOptionalHeader());
+  CVMUSBTransfer::Buffer vmusbBuffer;
 
-  bufferNumber++;
+  while (transfer.next(vmusbBuffer)) {
+    bufferNumber++;
 
-  pContents++;			// Point to first event.
-  ssize_t    nWords    = (inBuffer.s_bufferSize)/sizeof(uint16_t) - 1; // Remaining words read.
-
-  // Check if the optional second header exists
-  if (hasOptionalHeader()) {
-    uint16_t wordsInBuffer = *pContents++;  
-    if (wordsInBuffer != nWords-1) {
-      // The words that are reported in the optional header do not count 
-      // the first buffer header word. The number is self inclusive though.
-      cerr << "VMUSB specifies " << wordsInBuffer << " in buffer, but ";
-      cerr << "the number of words read is in disagreement." ;
-    }
-    --nWords;
-  } 
-
-  while (nWords > 0) {
-    if (nEvents <= 0) {
-      // Next long should be 0xffffffff buffer terminator:
-      // I've seen this happen but it's not fatal...just go on to the next buffer.
-
-      uint32_t* pNextLong = reinterpret_cast<uint32_t*>(pContents);
-      if (*pNextLong != 0xffffffff) {
-	cerr << "Ran out of events but did not see buffer terminator\n";
-	cerr << nWords << " remaining unprocessed\n";
-      }
-
-      break;			// trusting event count vs word count(?).
-    }
+    uint16_t* pContents = vmusbBuffer.s_pEvents;
+    for (size_t i = 0; i < vmusbBuffer.s_nEvents; i++) {
 
-    // Pull the event length and stack number from the header:
-    // event length is not self inclusive and is in uint16_t units.
+      // Pull the event length and stack number from the header:
+      // event length is not self inclusive and is in uint16_t units.
 
-    uint16_t header     = *pContents;
-    size_t   eventLength = header & VMUSBEventLengthMask;
-    uint8_t  stackNum   = (header & VMUSBStackIdMask) >> VMUSBStackIdShift;
+      uint16_t header     = *pContents;
+      size_t   eventLength = header & VMUSBEventLengthMask;
+      uint8_t  stackNum   = (header & VMUSBStackIdMask) >> VMUSBStackIdShift;
 
-    // Dispatch depending on the actual stack number.  The dispatch provided
-    // allows for multiple event stacks (e.g. interrupt triggered stacks
-    // that do different things).
+      // Dispatch depending on the actual stack number.  The dispatch provided
+      // allows for multiple event stacks (e.g. interrupt triggered stacks
+      // that do different things).
 
-    if (stackNum == ScalerStack) {
-      scaler(pContents);
-    }
-    else if (stackNum == MonitorStack) {
-      sendToTclServer(pContents);
-    }
-    else {
-      event(pContents);
+      if (stackNum == ScalerStack) {
+        scaler(pContents);
+      }
+      else if (stackNum == MonitorStack) {
+        sendToTclServer(pContents);
+      }
+      else {
+        event(pContents);
+      }
+      pContents += eventLength + 1; // Event count is not self inclusive.
     }
-    // Point at the next event and compute the remaining word and event counts.
-    
-    pContents += eventLength + 1; // Event count is not self inclusive.
-    nWords    -= (eventLength + 1);
-    nEvents--;
-  }
-
-  // I've seen the VM-USB hand me a bogus event count...but never a bogus
-  // buffer word count.  This is non fatal but reported.
 
-  if (nWords < 0) {
-    cerr << "Warning used up more than the buffer  by " << (-nWords) << endl;
-  }
-  m_nBuffersBeforeEventCount--;
-  if (m_nBuffersBeforeEventCount == 0) {
+    m_nBuffersBeforeEventCount--;
+    if (m_nBuffersBeforeEventCount == 0) {
     
-    // No scaler buffers maybe so figure out the time in seconds we are
-    // into the run from the realtime clock...forget fractions.
+      // No scaler buffers maybe so figure out the time in seconds we are
+      // into the run from the realtime clock...forget fractions.
     
-    timespec now;
-    clock_gettime(CLOCK_REALTIME, &now);
+      timespec now;
+      clock_gettime(CLOCK_REALTIME, &now);
     
-    outputTriggerCount(now.tv_sec - m_startTimestamp.tv_sec);   // Figure out run offset.
-    m_nBuffersBeforeEventCount = BUFFERS_BETWEEN_EVENTCOUNTS;
+      outputTriggerCount(now.tv_sec - m_startTimestamp.tv_sec);   // Figure out run offset.
+      m_nBuffersBeforeEventCount = BUFFERS_BETWEEN_EVENTCOUNTS;
+    }
   }
 }
 /**
@@ -630,16 +607,14 @@ COutputThread::outputTriggerCount(uint32_t runOffset)
 
 /**
  * Process a scaler event:
+ * - If the event spans VM-USB buffers, save the segment and wait for the
+ *   rest of it.
  * - Figure out the time interval start/stop times, and the absolute time.
  * - extract the vector of scalers from the VM-USB event.
  * - Create and submit the CRingScalerItem to the ring.
  *  
- * @note We assume scaler events won't consist of more than 2048
- *       scalers (e.g. the continuation bit is not set.
-
  * @param pData - Pointer to scaler data.
  *
- * @throw std::string - If a scaler buffer has a continuation segment.
  * @throw CErrnoException - If we can't get the absolute timestamp.
  * @throw std::string - From CRingBuffer if unable to commit the item to the ring.
  */
@@ -648,23 +623,25 @@ COutputThread::scaler(void* pData)
 {
 
 
+  // Segments of an event that spans buffers are accumulated until the
+  // last one arrives.  The completed event is moved out of
+  // m_scalerSegments so a failure below can't leave it behind.
+
+  std::vector<uint16_t> event;
+  if (!m_scalerSegments.add(reinterpret_cast<uint16_t*>(pData), event)) {
+    return;                     // Rest is in the next buffer.
+  }
+  pData             = event.data();
+  uint32_t* pBody   = reinterpret_cast<uint32_t*>(event.data() + 1); // Pointer to the scalers.
+  size_t    nWords  = event.size() - 1;
+
   time_t timestamp;
   if (time(&timestamp) == -1) {
     throw CErrnoException("COutputThread::scaler unable to get the absolute timestamp");
   }
 
-  // Figure out where the scalers are and fetch the event header.
-
-  uint16_t* pHeader = reinterpret_cast<uint16_t*>(pData);
-  uint16_t  header  = *pHeader;
-  uint32_t* pBody   = reinterpret_cast<uint32_t*>(pHeader+1); // Pointer to the scalers.
-
-  // See Issue #424 - for now throw an error  if there's a continuation segment:
+  // Figure out how many scalers there are:
 
-
-  // Figure out how many wods/scalers there are:
-
-  size_t        nWords   =  header & VMUSBEventLengthMask;
   size_t        nScalers =  nWords/(sizeof(uint32_t)/sizeof(uint16_t));
 
   // Marshall the scalers into an std::vector:
@@ -705,6 +682,7 @@ COutputThread::scaler(void* pData)
   }
 
   pEvent->commitToRing(*m_pRing);
+  CReadoutStatistics::getInstance()->add(CReadoutStatistics::Scalers);
   m_elapsedSeconds = endTime;
   delete pEvent;
 }
@@ -818,7 +796,14 @@ COutputThread::event(void* pData)
 
     event.setBodyCursor(pEnd);
     event.updateSize();
+
+    CReadoutStatistics* pStats = CReadoutStatistics::getInstance();
+    uint64_t putStart = CReadoutStatistics::nowNs();
     event.commitToRing(*m_pRing);
+    pStats->add(CReadoutStatistics::RingPutNs, CReadoutStatistics::nowNs() - putStart);
+    CPipelineTrace::hopItem(CPipelineTrace::ReadoutOutput, event.getItemPointer());
+    pStats->add(CReadoutStatistics::Events);
+    pStats->add(CReadoutStatistics::EventBytes, m_nWordsInBuffer*sizeof(uint16_t));
     delete pEvent;
     // Reset the cursor and word count in the assembly buffer:
 
@@ -32,6 +32,13 @@
 #endif
 #endif
 
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
 #ifndef __THREAD_H
 #include <Thread.h>
 #ifndef __THREAD_H
@@ -39,6 +46,10 @@
 #endif
 #endif
 
+#ifndef __CSCALERASSEMBLER_H
+#include "CScalerAssembler.h"
+#endif
+
 // Forward definitions:
 
 struct DataBuffer;
@@ -72,7 +83,8 @@ class CSystemControl;
     -#  Buffer size is gotten from the read from the VM_USB
         and indicates the number of bytes of data
         in the body and its header word (does not include either itself nor
-	the buffer type.
+	the buffer type.  With multi-buffer bulk transfers the body can
+        hold several VM-USB buffers (see CVMUSBTransfer).
     -#  The buffer type is one of the following:
         - 1   Run starting... in this case there will be no VM-USB body.
               and the buffersize will be size of Spectrodaq buffer desired.
@@ -123,6 +135,7 @@ private:
   uint8_t*    m_pBuffer;	   //!< Pointer to the current buffer.
   uint8_t*    m_pCursor;           //!< Where next event goes in buffer.
   size_t      m_nWordsInBuffer;    //!< Number of words already in the buffer.
+  CScalerAssembler m_scalerSegments; //!< Scaler event that spans buffers.
   std::string m_ringName;           //!< Name of destination ringbuffer.
   CRingBuffer* m_pRing;		    //!< The actual ring in which we put data.
   uint64_t    m_nEventsSeen;        //!< Events processed so far for the physics trigger item.
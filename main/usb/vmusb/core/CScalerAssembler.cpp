@@ -0,0 +1,68 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <config.h>
+#include "CScalerAssembler.h"
+#include "DataBuffer.h"
+
+/*!
+   Add a segment of a scaler event.
+
+   \param pSegment - Points to the segment's VM-USB event header.
+   \param event    - If the event is complete, receives it as a header
+                     word (stack id and total length, no continuation bit)
+                     followed by the data of all of its segments.
+
+   \return bool
+   \retval true  - event holds a complete scaler event.
+   \retval false - The segment was a continuation; the rest is still to come.
+*/
+bool
+CScalerAssembler::add(const uint16_t* pSegment, std::vector<uint16_t>& event)
+{
+  uint16_t header = *pSegment;
+  size_t   nWords = header & VMUSBEventLengthMask;
+
+  if (m_segments.empty()) {
+    m_segments.push_back(header & VMUSBStackIdMask);
+  }
+  m_segments.insert(m_segments.end(), pSegment+1, pSegment+1+nWords);
+  if (header & VMUSBContinuation) {
+    return false;
+  }
+  m_segments[0] |= (m_segments.size() - 1) & VMUSBEventLengthMask;
+
+  event.clear();
+  event.swap(m_segments);
+  return true;
+}
+/*!
+   Throw away any partial event, e.g. at the start or end of a run.
+*/
+void
+CScalerAssembler::clear()
+{
+  m_segments.clear();
+}
+/*!
+   \return bool
+   \retval true - No partial event is being held.
+*/
+bool
+CScalerAssembler::empty() const
+{
+  return m_segments.empty();
+}
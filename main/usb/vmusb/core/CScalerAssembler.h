@@ -0,0 +1,53 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#ifndef __CSCALERASSEMBLER_H
+#define __CSCALERASSEMBLER_H
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+/*!
+    Puts back together a scaler event that the VM-USB split across buffers
+    (see CVMUSBTransfer).  Segments with the VMUSBContinuation bit set are
+    saved until the segment without it arrives.  The completed event is
+    handed back to the caller and the assembler starts over empty, so
+    whatever the caller does with the event can't leave stale segments
+    behind.
+*/
+class CScalerAssembler
+{
+private:
+  std::vector<uint16_t> m_segments; //!< Header word followed by the data so far.
+
+public:
+  bool add(const uint16_t* pSegment, std::vector<uint16_t>& event);
+  void clear();
+  bool empty() const;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <config.h>
+#include "CVMUSBTransfer.h"
+#include "DataBuffer.h"
+
+#include <iostream>
+
+using namespace std;
+
+static const uint16_t BufferTerminator(0xffff);
+
+/*!
+   Construct the walker.
+
+   \param pData          - The data read from the VM-USB.
+   \param nBytes         - Number of bytes read.
+   \param optionalHeader - True if the global mode register has the
+                           doubleHeader bit set.
+*/
+CVMUSBTransfer::CVMUSBTransfer(void* pData, size_t nBytes, bool optionalHeader) :
+  m_pCursor(reinterpret_cast<uint16_t*>(pData)),
+  m_nWords(nBytes/sizeof(uint16_t)),
+  m_optionalHeader(optionalHeader),
+  m_report(true)
+{
+}
+
+/*!
+   Locate the next VM-USB buffer in the transfer.  Events are only counted
+   if they lie entirely inside the data read; the buffer terminator is
+   skipped.  Inconsistencies the VM-USB has been seen to produce (bad
+   event counts, missing terminators) are reported but not fatal; they
+   end the walk of the transfer as the next buffer can't be found.
+
+   \param buffer - Filled in with a description of the buffer.
+
+   \return bool
+   \retval true  - buffer describes the next VM-USB buffer.
+   \retval false - No more buffers in the transfer.
+*/
+bool
+CVMUSBTransfer::next(Buffer& buffer)
+{
+  if (m_nWords <= 0) {
+    return false;
+  }
+  uint16_t* p      = m_pCursor;
+  ssize_t   nWords = m_nWords;
+
+  buffer.s_header = *p++;
+  nWords--;
+  size_t nEvents  = buffer.s_header & VMUSBNEventMask;
+
+  uint16_t wordsInBuffer(0);
+  if (m_optionalHeader && (nWords > 0)) {
+    wordsInBuffer = *p++;
+    nWords--;
+  }
+  buffer.s_pEvents = p;
+  buffer.s_nEvents = 0;
+
+  while ((buffer.s_nEvents < nEvents) && (nWords > 0)) {
+    ssize_t eventWords = (*p & VMUSBEventLengthMask) + 1; // Length is not self inclusive.
+    if (eventWords > nWords) {
+      if (m_report) {
+        cerr << "Warning used up more than the buffer  by " << (eventWords - nWords) << endl;
+      }
+      nWords = 0;
+      break;
+    }
+    p      += eventWords;
+    nWords -= eventWords;
+    buffer.s_nEvents++;
+  }
+  buffer.s_nWords = p - buffer.s_pEvents;
+
+  // Skip the terminator.  Anything else after the last event means we
+  // can't tell where the next buffer starts.
+
+  int terminatorWords(0);
+  while ((nWords > 0) && (terminatorWords < 2) && (*p == BufferTerminator)) {
+    p++;
+    nWords--;
+    terminatorWords++;
+  }
+  if ((terminatorWords == 0) && (nWords > 0)) {
+    if (m_report) {
+      cerr << "Ran out of events but did not see buffer terminator\n";
+      cerr << nWords << " remaining unprocessed\n";
+    }
+    nWords = 0;
+  }
+  // The optional header word count does not count the first buffer header
+  // word or itself.
+
+  if (m_report && m_optionalHeader && (wordsInBuffer != (p - buffer.s_pEvents))) {
+    cerr << "VMUSB specifies " << wordsInBuffer << " in buffer, but ";
+    cerr << "the number of words read is in disagreement.\n";
+  }
+
+  m_pCursor = p;
+  m_nWords  = nWords;
+  return true;
+}
+/*!
+   Scans a copy of the walker so the transfer can still be walked with
+   next().  The scan is silent: problems with the data are reported once,
+   by whoever walks the transfer itself.
+
+   \return bool
+   \retval true - if one of the buffers in the transfer is the last one
+                  of the run (has the VMUSBLastBuffer bit set).
+*/
+bool
+CVMUSBTransfer::lastBuffer() const
+{
+  CVMUSBTransfer walker(*this);
+  Buffer         buffer;
+  walker.m_report = false;
+  while (walker.next(buffer)) {
+    if (buffer.s_header & VMUSBLastBuffer) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,80 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#ifndef __CVMUSBTRANSFER_H
+#define __CVMUSBTRANSFER_H
+
+#ifndef __CRT_STDINT_H
+#include <stdint.h>
+#ifndef __CRT_STDINT_H
+#define __CRT_STDINT_H
+#endif
+#endif
+
+#ifndef __CRT_UNISTD_H
+#include <unistd.h>
+#ifndef __CRT_UNISTD_H
+#define __CRT_UNISTD_H
+#endif
+#endif
+
+/*!
+    Walks the VM-USB buffers in the data of one usbRead.  With multi-buffer
+    bulk transfers enabled (see CVMUSB::TransferSetupRegister) a single read
+    can return several VM-USB buffers back to back, each laid out as in
+    section 4.6 of the VM-USB manual:
+\verbatim
+    +--------------------------------+
+    | Buffer header (LB, nEvents)    |
+    +--------------------------------+
+    | Optional second header (words) |
+    +--------------------------------+
+    | Event header (stack, C, length)|
+    |   ... event words ...          |
+    +- - - - - - -- - - - - - - - - -+
+    | 0xffff terminator word(s)      |
+    +--------------------------------+
+\endverbatim
+    With buffer spanning enabled an event that does not fit in a buffer
+    is split in segments; all but the last have the VMUSBContinuation bit
+    set in their event header and the rest follows as the first event of
+    the next buffer.  Putting the segments back together is up to the
+    consumer.
+*/
+class CVMUSBTransfer
+{
+public:
+  struct Buffer {
+    uint16_t  s_header;		//!< First buffer header word.
+    uint16_t* s_pEvents;	//!< First event header.
+    size_t    s_nEvents;	//!< Events (segments) in the buffer.
+    size_t    s_nWords;		//!< Words from s_pEvents to the end of the buffer.
+  };
+
+private:
+  uint16_t* m_pCursor;		//!< Next buffer header.
+  ssize_t   m_nWords;		//!< Words left from m_pCursor on.
+  bool      m_optionalHeader;	//!< Buffers have a second header word.
+  bool      m_report;		//!< Report inconsistencies in the data.
+
+public:
+  CVMUSBTransfer(void* pData, size_t nBytes, bool optionalHeader);
+
+  bool next(Buffer& buffer);
+  bool lastBuffer() const;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <string>
+#include <iostream>
+using namespace std;
+
+class TCLApplication;
+TCLApplication* gpTCLApplication = 0;
+
+int main(int argc, char** argv)
+{
+  CppUnit::TextUi::TestRunner   
+               runner; // Control tests.
+  CppUnit::TestFactoryRegistry& 
+               registry(CppUnit::TestFactoryRegistry::getRegistry());
+
+  runner.addTest(registry.makeTest());
+
+  bool wasSucessful;
+  try {
+    wasSucessful = runner.run("",false);
+  } 
+  catch(string& rFailure) {
+    cerr << "Caught a string exception from test suites.: \n";
+    cerr << rFailure << endl;
+    wasSucessful = false;
+  }
+  return !wasSucessful;
+}
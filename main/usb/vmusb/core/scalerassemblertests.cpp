@@ -0,0 +1,123 @@
+// Tests for CScalerAssembler: putting back together scaler events the
+// VM-USB split across buffers.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CScalerAssembler.h"
+#include "DataBuffer.h"
+
+#include <vector>
+#include <stdint.h>
+
+class ScalerAssemblerTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ScalerAssemblerTests);
+  CPPUNIT_TEST(whole);
+  CPPUNIT_TEST(spanning);
+  CPPUNIT_TEST(startsOver);
+  CPPUNIT_TEST(clear);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  CScalerAssembler* m_pAssembler;
+
+public:
+  void setUp() {
+    m_pAssembler = new CScalerAssembler;
+  }
+  void tearDown() {
+    delete m_pAssembler;
+  }
+protected:
+  void whole();
+  void spanning();
+  void startsOver();
+  void clear();
+
+private:
+  // A segment of stack 1 holding the 32 bit scalers first..first+n-1.
+
+  static std::vector<uint16_t> segment(uint32_t first, size_t n,
+                                       bool continued = false) {
+    std::vector<uint16_t> result;
+    result.push_back((1 << 13) | (continued ? VMUSBContinuation : 0) | (2*n));
+    for (uint32_t i = first; i < first + n; i++) {
+      result.push_back(i & 0xffff);
+      result.push_back(i >> 16);
+    }
+    return result;
+  }
+  // The scalers in an assembled event.
+
+  static std::vector<uint32_t> scalers(const std::vector<uint16_t>& event) {
+    const uint32_t* p = reinterpret_cast<const uint32_t*>(event.data() + 1);
+    return std::vector<uint32_t>(p, p + (event.size() - 1)/2);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ScalerAssemblerTests);
+
+// An event that fits in its buffer comes straight back.
+
+void ScalerAssemblerTests::whole()
+{
+  std::vector<uint16_t> in = segment(0x10000, 3);
+  std::vector<uint16_t> event;
+
+  ASSERT(m_pAssembler->add(in.data(), event));
+  ASSERT(in == event);
+  ASSERT(m_pAssembler->empty());
+}
+// A continuation segment followed by the last segment gives one event
+// with all of the scalers.
+
+void ScalerAssemblerTests::spanning()
+{
+  std::vector<uint16_t> first = segment(0x10000, 3, true);
+  std::vector<uint16_t> last  = segment(0x10003, 2);
+  std::vector<uint16_t> event;
+
+  ASSERT(!m_pAssembler->add(first.data(), event));
+  ASSERT(event.empty());
+  ASSERT(!m_pAssembler->empty());
+
+  ASSERT(m_pAssembler->add(last.data(), event));
+  EQ(uint16_t((1 << 13) | 10), event[0]);   // No continuation bit.
+  std::vector<uint32_t> counters = scalers(event);
+  EQ(size_t(5), counters.size());
+  for (uint32_t i = 0; i < counters.size(); i++) {
+    EQ(0x10000 + i, counters[i]);
+  }
+  ASSERT(m_pAssembler->empty());
+}
+// Nothing of a completed event shows up in the next one.
+
+void ScalerAssemblerTests::startsOver()
+{
+  std::vector<uint16_t> first = segment(0, 2, true);
+  std::vector<uint16_t> last  = segment(2, 2);
+  std::vector<uint16_t> next  = segment(100, 1);
+  std::vector<uint16_t> event;
+
+  m_pAssembler->add(first.data(), event);
+  m_pAssembler->add(last.data(), event);
+  ASSERT(m_pAssembler->add(next.data(), event));
+  ASSERT(next == event);
+}
+// A partial event that is thrown away doesn't prefix the next one.
+
+void ScalerAssemblerTests::clear()
+{
+  std::vector<uint16_t> first = segment(0, 2, true);
+  std::vector<uint16_t> next  = segment(100, 1);
+  std::vector<uint16_t> event;
+
+  m_pAssembler->add(first.data(), event);
+  m_pAssembler->clear();
+  ASSERT(m_pAssembler->empty());
+
+  ASSERT(m_pAssembler->add(next.data(), event));
+  ASSERT(next == event);
+}
@@ -0,0 +1,231 @@
+// Tests for CVMUSBTransfer: walking the VM-USB buffers of a (multi-buffer)
+// bulk transfer read from a CMockVMUSB.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CVMUSBTransfer.h"
+#include "DataBuffer.h"
+#include <CMockVMUSB.h>
+
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <stdint.h>
+
+class TransferTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(TransferTests);
+  CPPUNIT_TEST(single);
+  CPPUNIT_TEST(multi);
+  CPPUNIT_TEST(optionalHeader);
+  CPPUNIT_TEST(spanning);
+  CPPUNIT_TEST(lastBuffer);
+  CPPUNIT_TEST(badEventCount);
+  CPPUNIT_TEST(noTerminator);
+  CPPUNIT_TEST(lastBufferQuiet);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  CMockVMUSB*           m_pController;
+  std::vector<uint16_t> m_data;
+  size_t                m_nBytes;
+
+public:
+  void setUp() {
+    m_pController = new CMockVMUSB;
+  }
+  void tearDown() {
+    delete m_pController;
+  }
+protected:
+  void single();
+  void multi();
+  void optionalHeader();
+  void spanning();
+  void lastBuffer();
+  void badEventCount();
+  void noTerminator();
+  void lastBufferQuiet();
+
+private:
+  // Append a VM-USB buffer with one event of length words per entry of
+  // lengths.  Events of stack 0 hold their index in the buffer.
+
+  static void addBuffer(std::vector<uint16_t>& transfer,
+                        const std::vector<uint16_t>& lengths,
+                        uint16_t flags = 0, bool optionalHeader = false) {
+    transfer.push_back(flags | lengths.size());
+    size_t wordCountIndex = transfer.size();
+    if (optionalHeader) transfer.push_back(0);
+    for (size_t i = 0; i < lengths.size(); i++) {
+      transfer.push_back(lengths[i]);
+      for (int w = 0; w < (lengths[i] & VMUSBEventLengthMask); w++) {
+        transfer.push_back(i);
+      }
+    }
+    transfer.push_back(0xffff);
+    transfer.push_back(0xffff);
+    if (optionalHeader) {
+      transfer[wordCountIndex] = transfer.size() - wordCountIndex - 1;
+    }
+  }
+  // Read the transfer back through the controller.
+
+  CVMUSBTransfer read(const std::vector<uint16_t>& transfer,
+                      bool optionalHeader = false) {
+    m_pController->addReturnData(transfer, 0);
+    m_data.resize(transfer.size() + 100);
+    m_pController->usbRead(m_data.data(), m_data.size()*sizeof(uint16_t), &m_nBytes);
+    return CVMUSBTransfer(m_data.data(), m_nBytes, optionalHeader);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TransferTests);
+
+// One buffer per read (no multi-buffering).
+
+void TransferTests::single()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {3, 5});
+
+  CVMUSBTransfer t = read(transfer);
+  CVMUSBTransfer::Buffer b;
+  ASSERT(t.next(b));
+  EQ(size_t(2), b.s_nEvents);
+  EQ(size_t(4 + 6), b.s_nWords);
+  EQ(m_data.data() + 1, b.s_pEvents);
+  EQ(uint16_t(5), b.s_pEvents[4]);
+
+  ASSERT(!t.next(b));
+}
+// Several buffers in one transfer are each found.
+
+void TransferTests::multi()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {3, 5});
+  addBuffer(transfer, {1});
+  addBuffer(transfer, {2, 2, 2});
+
+  CVMUSBTransfer t = read(transfer);
+  CVMUSBTransfer::Buffer b;
+  std::vector<size_t>    events;
+  while (t.next(b)) {
+    events.push_back(b.s_nEvents);
+  }
+  EQ(size_t(3), events.size());
+  EQ(size_t(2), events[0]);
+  EQ(size_t(1), events[1]);
+  EQ(size_t(3), events[2]);
+  EQ(uint16_t(2), b.s_pEvents[6]);  // Header of the last event.
+}
+// The second buffer header word is skipped.
+
+void TransferTests::optionalHeader()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {4}, 0, true);
+  addBuffer(transfer, {1, 1}, 0, true);
+
+  CVMUSBTransfer t = read(transfer, true);
+  CVMUSBTransfer::Buffer b;
+  ASSERT(t.next(b));
+  EQ(size_t(1), b.s_nEvents);
+  EQ(m_data.data() + 2, b.s_pEvents);
+  ASSERT(t.next(b));
+  EQ(size_t(2), b.s_nEvents);
+  EQ(uint16_t(1), b.s_pEvents[0]);
+  ASSERT(!t.next(b));
+}
+// An event that spans buffers shows up as a continued segment at the end
+// of one buffer and the rest at the start of the next.
+
+void TransferTests::spanning()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {2, VMUSBContinuation | 10});
+  addBuffer(transfer, {6, 2});
+
+  CVMUSBTransfer t = read(transfer);
+  CVMUSBTransfer::Buffer b;
+  ASSERT(t.next(b));
+  EQ(size_t(2), b.s_nEvents);
+  uint16_t* pLast = b.s_pEvents + 3;
+  ASSERT((*pLast & VMUSBContinuation) != 0);
+  EQ(size_t(10), size_t(*pLast & VMUSBEventLengthMask));
+
+  ASSERT(t.next(b));
+  ASSERT((b.s_pEvents[0] & VMUSBContinuation) == 0);
+  EQ(size_t(6), size_t(b.s_pEvents[0] & VMUSBEventLengthMask));
+  ASSERT(!t.next(b));
+}
+// The last buffer of the run need not be the first of the transfer.
+
+void TransferTests::lastBuffer()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {3});
+  addBuffer(transfer, {3});
+  ASSERT(!read(transfer).lastBuffer());
+
+  addBuffer(transfer, {1}, VMUSBLastBuffer);
+  ASSERT(read(transfer).lastBuffer());
+}
+// An event count that runs past the data only counts complete events.
+
+void TransferTests::badEventCount()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {3, 3});
+  transfer[0] = 5;
+  transfer.resize(transfer.size() - 2);  // No terminator either.
+
+  CVMUSBTransfer t = read(transfer);
+  CVMUSBTransfer::Buffer b;
+  ASSERT(t.next(b));
+  EQ(size_t(2), b.s_nEvents);
+  ASSERT(!t.next(b));
+}
+// Without a terminator the next buffer can't be found.
+
+void TransferTests::noTerminator()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {3});
+  transfer.resize(transfer.size() - 2);
+  addBuffer(transfer, {3});
+
+  CVMUSBTransfer t = read(transfer);
+  CVMUSBTransfer::Buffer b;
+  ASSERT(t.next(b));
+  EQ(size_t(1), b.s_nEvents);
+  ASSERT(!t.next(b));
+}
+// Looking for the last buffer doesn't report problems; walking the
+// transfer does, once.
+
+void TransferTests::lastBufferQuiet()
+{
+  std::vector<uint16_t> transfer;
+  addBuffer(transfer, {3});
+  transfer.resize(transfer.size() - 2);
+  addBuffer(transfer, {3}, VMUSBLastBuffer);
+
+  CVMUSBTransfer     t = read(transfer);
+  std::ostringstream errors;
+  std::streambuf*    pOld = std::cerr.rdbuf(errors.rdbuf());
+
+  bool last = t.lastBuffer();
+  std::string scanned = errors.str();
+  CVMUSBTransfer::Buffer b;
+  while (t.next(b))
+    ;
+  std::cerr.rdbuf(pOld);
+
+  ASSERT(!last);                // Can't be found past the missing terminator.
+  EQ(std::string(""), scanned);
+  ASSERT(!errors.str().empty());
+}
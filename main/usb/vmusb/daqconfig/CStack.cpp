@@ -39,6 +39,12 @@ using namespace std;
 size_t CStack::m_listOffset(0);	// See however restStackOffset.
 bool   CStack::m_incrementalScaler(true);
 
+// The lists we believe the controller holds from the last begin run.
+// See loadList and forgetHardwareState.
+
+CVMUSB*                                     CStack::m_pController(0);
+std::map<uint8_t, CStack::LoadedList>       CStack::m_loadedLists;
+
 
 /// The stuff below is data the validators need:
 /// We need to set up the enumeration validator dynamically as there's no simple way
@@ -151,6 +157,9 @@ Option           value type               Value meaning
                                           scaler ring items produced by this stack are marked
                                           non-incremental. If true (the default) scaler ring items
                                           are marked as incremental.
+-optimize         boolean                 If true (default is false), the stack is
+                                          optimized (see CVMUSBReadoutList::optimize) when
+                                          it is loaded.
 \endverbatim
 
   \param configuration : CReadoutModule&
@@ -189,6 +198,7 @@ CStack::onAttach(CReadoutModule& configuration)
   m_pConfiguration->addParameter("-modules",
 				CStack::moduleChecker, NULL, "");
   m_pConfiguration->addBooleanParameter("-incremental", "true");
+  m_pConfiguration->addBooleanParameter("-optimize", false);
   
 }
 /*!
@@ -344,6 +354,71 @@ CStack::getOffset()
 {
   return m_listOffset;
 }
+/*!
+   Forget which lists are loaded in the controller so that every list is
+   loaded again at the next begin run.  This is used to force a full
+   initialization (the init command or --fullinit) and when a run ends in
+   error as then we don't know what state the hardware is in.
+*/
+void
+CStack::forgetHardwareState()
+{
+  m_pController = 0;
+  m_loadedLists.clear();
+}
+/*!
+   Load a list into the VM-USB unless the same list is already loaded
+   at the same offset.  Lists that were loaded in any part of the stack
+   memory being overwritten are forgotten.
+
+   \param controller : CVMUSB&
+      Controller to load.
+   \param listNumber : uint8_t
+      Number of the list (0-7).
+   \param list : CVMUSBReadoutList&
+      The list.
+   \param offset : size_t
+      Stack memory offset at which to load it.
+
+   \return bool
+   \retval true  - the list was loaded.
+   \retval false - The list was already there.
+*/
+bool
+CStack::loadList(CVMUSB& controller, uint8_t listNumber,
+		 CVMUSBReadoutList& list, size_t offset)
+{
+  useController(controller);
+
+  std::vector<uint32_t> contents = list.get();
+  size_t                words    = list.stackWords();
+
+  std::map<uint8_t, LoadedList>::iterator p = m_loadedLists.find(listNumber);
+  if ((p != m_loadedLists.end())      &&
+      (p->second.s_offset == offset)  &&
+      (p->second.s_contents == contents)) {
+    return false;
+  }
+  // Anything that was where this list is going won't be there anymore:
+
+  m_loadedLists.erase(listNumber);
+  p = m_loadedLists.begin();
+  while (p != m_loadedLists.end()) {
+    std::map<uint8_t, LoadedList>::iterator here = p++;
+    if ((here->second.s_offset < offset + words) &&
+	(offset < here->second.s_offset + here->second.s_words)) {
+      m_loadedLists.erase(here);
+    }
+  }
+
+  if (controller.loadList(listNumber, list, offset) == 0) {
+    LoadedList& loaded = m_loadedLists[listNumber];
+    loaded.s_offset    = offset;
+    loaded.s_words     = words;
+    loaded.s_contents  = contents;
+  }
+  return true;
+}
 /*!
    Generates and loads the stack that reads out this trigger.
    This is done by creating a readout list, filling it in via addReadoutList,
@@ -351,6 +426,9 @@ CStack::getOffset()
    m_listOffset will be updated to reflect the number of stack lines that we have
    loaded.
 
+   If -optimize is true, the list is optimized before it's loaded and the
+   stack memory and estimated VME cycles per trigger are reported.
+
    \param controller : CVMUSB&
      The VMUSB controller handle connected to the VM-USB that we will be managing.
 */
@@ -363,20 +441,27 @@ CStack::loadStack(CVMUSB& controller)
   addReadoutList(readoutList);
   listNumber = getListNumber();
 
-
-
-  
+  if ((readoutList.size() > 0) && m_pConfiguration->getBoolParameter("-optimize")) {
+    size_t before = readoutList.stackWords();
+    readoutList.optimize();
+    std::cout << "Stack " << static_cast<int>(listNumber) << " ("
+	      << m_pConfiguration->getName() << ") optimized: "
+	      << before << " -> " << readoutList.stackWords()
+	      << " words of stack memory, about " << readoutList.busCycles()
+	      << " VME bus cycles per trigger\n";
+  }
 
   // Load the list:... unless it has no elements!
 
   if (readoutList.size() > 0) {
-    controller.loadList(listNumber,
-			readoutList,
-			m_listOffset);
-    // The + 4 below is the size of the header each stack has according to Jan.
-    // That is 2 longwords.
+    if (!loadList(controller, listNumber, readoutList, m_listOffset)) {
+      std::cerr << "Stack " << static_cast<int>(listNumber)
+		<< " is unchanged and already loaded\n";
+    }
+    // stackWords includes the two longword header each stack has
+    // according to Jan.
     
-    m_listOffset += readoutList.size() * sizeof(uint32_t)/sizeof(uint16_t)+4 ; // Stack locs are words.
+    m_listOffset += readoutList.stackWords(); // Stack locs are words.
   }
 }
 /*!
@@ -610,6 +695,17 @@ CStack::getListNumber()
     return static_cast<uint8_t>(getIntegerParameter("-stack"));
   }
 }
+/*
+   What we remember is only good for the controller it was done with.
+*/
+void
+CStack::useController(CVMUSB& controller)
+{
+  if (m_pController != &controller) {
+    forgetHardwareState();
+    m_pController = &controller;
+  }
+}
 /*
    Custom validator for the -modules switch.  This validator checks that
    - The proposed value is a valid Tcl list.
@@ -41,6 +41,20 @@
 #endif
 #endif
 
+#ifndef __STL_MAP
+#include <map>
+#ifndef __STL_MAP
+#define __STL_MAP
+#endif
+#endif
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
 
 // forward definitions
 
@@ -81,9 +95,16 @@ Option           value type               Value meaning
                                           NIM1 and starting the readout stack.
 -modules          stringlist              List of ADC, Scaler, Chain modules that will be read by
                                           this stack.
+-optimize         boolean                 If true the stack is run through
+                                          CVMUSBReadoutList::optimize before it is loaded.
 \endverbatim
 \note  The assumption is that all the stacks are managed by this class. The m_listOffset
        static member is used to keep track of the offsets at which each stack is loaded.
+\note  The class also remembers the contents of each list it loaded; lists
+       identical to what is already loaded at the same offset are not reloaded
+       at begin run.  Modules are always initialized, as nearly all of them
+       reset or clear the hardware in Initialize.
+       forgetHardwareState makes the next begin load every list.
 */
 class CStack : public CReadoutHardware
 {
@@ -91,6 +112,11 @@ private:
   // Data types:
 
   typedef std::list<CReadoutHardware*>  StackElements;
+  typedef struct _LoadedList {
+    size_t                s_offset;
+    size_t                s_words;
+    std::vector<uint32_t> s_contents;
+  } LoadedList;
 public:
   typedef enum _TriggerType {
     Nim1,
@@ -102,6 +128,9 @@ private:
   CReadoutModule*    m_pConfiguration;
   static size_t      m_listOffset; // Offsets for list loading
   static bool        m_incrementalScaler;
+
+  static CVMUSB*                             m_pController;         // What we know of the hardware
+  static std::map<uint8_t, LoadedList>       m_loadedLists;         // list number -> contents.
 public:
   // Canonicals:
 
@@ -130,6 +159,9 @@ public:
 
   static void   resetStackOffset(size_t to= static_cast<size_t>(0));
   static size_t getOffset();
+  static void   forgetHardwareState();
+  static bool   loadList(CVMUSB& controller, uint8_t listNumber,
+                         CVMUSBReadoutList& list, size_t offset);
 
   void loadStack(CVMUSB& controller);
   void enableStack(CVMUSB& controller);
@@ -143,6 +175,7 @@ private:
 
   unsigned int    getIntegerParameter(std::string name);
   StackElements   getStackElements();
+  static void     useController(CVMUSB& controller);
   uint8_t         getListNumber();
 
   // Custom validators
@@ -0,0 +1,217 @@
+// Tests for incremental begin-run: CStack only loads lists that changed since
+// the last run but always initializes every module.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+#include <TCLInterpreter.h>
+#include <TCLObject.h>
+
+#include "CConfiguration.h"
+#include "CReadoutModule.h"
+#include "CReadoutHardware.h"
+#include "CStack.h"
+#include <CMockVMUSB.h>
+#include <CVMUSBReadoutList.h>
+
+
+namespace Globals {
+  extern CConfiguration* pConfig;
+  extern unsigned        scalerPeriod;
+};
+
+// Hardware that counts how often it's initialized.
+
+class CCountingHardware : public CReadoutHardware
+{
+public:
+  static int s_initCount;
+  virtual void onAttach(CReadoutModule& configuration) {
+    configuration.addParameter("-value", CConfigurableObject::isInteger, NULL, "0");
+  }
+  virtual void Initialize(CVMUSB& controller) { s_initCount++; }
+  virtual void addReadoutList(CVMUSBReadoutList& list) { list.addMarker(0x1234); }
+  virtual CReadoutHardware* clone() const { return new CCountingHardware(*this); }
+};
+int CCountingHardware::s_initCount(0);
+
+class StackTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(StackTests);
+  CPPUNIT_TEST(initOnce);
+  CPPUNIT_TEST(initEvery);
+  CPPUNIT_TEST(madcReset);
+  CPPUNIT_TEST(loadOnce);
+  CPPUNIT_TEST(loadChanged);
+  CPPUNIT_TEST(loadOverwritten);
+  CPPUNIT_TEST(forget);
+  CPPUNIT_TEST(newController);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  CTCLInterpreter* m_pInterp;
+  CMockVMUSB*      m_pController;
+
+public:
+  void setUp() {
+    ::Globals::pConfig = new CConfiguration;
+    m_pInterp          = ::Globals::pConfig->getInterpreter();
+    m_pController      = new CMockVMUSB;
+    CStack::forgetHardwareState();
+    CCountingHardware::s_initCount = 0;
+
+    m_pInterp->GlobalEval("v977 create io -base 0x12340000");
+    m_pInterp->GlobalEval("marker create mark 0x1234");
+    m_pInterp->GlobalEval("stack create event");
+    m_pInterp->GlobalEval("stack config event -trigger nim1 -modules {io mark}");
+  }
+  void tearDown() {
+    delete m_pController;
+    delete ::Globals::pConfig;
+    ::Globals::pConfig = 0;
+  }
+protected:
+  void initOnce();
+  void initEvery();
+  void madcReset();
+  void loadOnce();
+  void loadChanged();
+  void loadOverwritten();
+  void forget();
+  void newController();
+
+private:
+  CStack* stack() {
+    CReadoutModule* pModule = ::Globals::pConfig->findStack("event");
+    return dynamic_cast<CStack*>(pModule->getHardwarePointer());
+  }
+  // Run the begin run part of startDaq, return the operations it did.
+
+  std::vector<std::string> begin() {
+    CMockVMUSB& ctlr(*m_pController);
+    size_t before = ctlr.getOperationRecord().size();
+    CStack::resetStackOffset();
+    stack()->Initialize(ctlr);
+    stack()->loadStack(ctlr);
+    std::vector<std::string> ops = ctlr.getOperationRecord();
+    return std::vector<std::string>(ops.begin() + before, ops.end());
+  }
+  static size_t count(const std::vector<std::string>& ops, std::string op) {
+    return std::count(ops.begin(), ops.end(), op);
+  }
+  // Count the 16 bit writes to address in the lists logged in ops.
+
+  static size_t countWrite16(const std::vector<std::string>& ops, uint32_t address) {
+    CVMUSBReadoutList write;
+    write.addWrite16(address, CVMUSBReadoutList::a32UserData, 0);
+    char word[16];
+    sprintf(word, ":%08x", write.get()[1]); // Address as it is in the list.
+    size_t n = 0;
+    for (size_t i = 0; i < ops.size(); i++) {
+      size_t at = ops[i].find(word);
+      if ((at != std::string::npos) && (at + strlen(word) == ops[i].size())) n++;
+    }
+    return n;
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StackTests);
+
+// The first begin initializes and loads.  The second initializes the
+// modules again but doesn't reload the unchanged list.
+
+void StackTests::initOnce()
+{
+  std::vector<std::string> first = begin();
+  ASSERT(count(first, "executeList::begin") > 0);
+  EQ(size_t(1), count(first, "loadList::begin"));
+
+  std::vector<std::string> second = begin();
+  EQ(count(first, "executeList::begin"), count(second, "executeList::begin"));
+  EQ(size_t(0), count(second, "loadList::begin"));
+}
+// Modules are initialized at every begin even if nothing changed.
+
+void StackTests::initEvery()
+{
+  ::Globals::pConfig->addAdc(new CReadoutModule("count", CCountingHardware()));
+  m_pInterp->GlobalEval("stack config event -modules {mark count}");
+
+  begin();
+  EQ(1, CCountingHardware::s_initCount);
+  std::vector<std::string> ops = begin();
+  EQ(2, CCountingHardware::s_initCount);
+  EQ(size_t(0), count(ops, "loadList::begin")); // Readout list is the same.
+}
+// Every begin resets the MADC32 readout and its timestamp counters even
+// though its configuration is unchanged.
+
+void StackTests::madcReset()
+{
+  m_pInterp->GlobalEval("madc create adc -base 0x20000000");
+  m_pInterp->GlobalEval("stack config event -modules {adc mark}");
+
+  begin();
+  std::vector<std::string> ops = begin();
+  ASSERT(countWrite16(ops, 0x20000000 + 0x6034) > 0);  // ReadoutReset
+  ASSERT(countWrite16(ops, 0x20000000 + 0x6090) > 0);  // TimestampReset
+}
+// An unchanged list is not reloaded.
+
+void StackTests::loadOnce()
+{
+  begin();
+  CStack::resetStackOffset();
+  stack()->loadStack(*m_pController);
+  EQ(size_t(1), count(m_pController->getOperationRecord(), "loadList::begin"));
+}
+// A changed readout list is reloaded.
+
+void StackTests::loadChanged()
+{
+  begin();
+  m_pInterp->GlobalEval("marker config mark -value 0x4321");
+  std::vector<std::string> ops = begin();
+  EQ(size_t(1), count(ops, "loadList::begin"));
+}
+// A list overwritten by another list is reloaded.
+
+void StackTests::loadOverwritten()
+{
+  begin();
+
+  CVMUSBReadoutList other;
+  other.addMarker(1);
+  ASSERT(CStack::loadList(*m_pController, 7, other, 0));
+  ASSERT(!CStack::loadList(*m_pController, 7, other, 0));
+
+  std::vector<std::string> ops = begin();
+  EQ(size_t(1), count(ops, "loadList::begin"));
+}
+// forgetHardwareState makes the next begin load every list too.
+
+void StackTests::forget()
+{
+  std::vector<std::string> first = begin();
+  CStack::forgetHardwareState();
+  std::vector<std::string> second = begin();
+  ASSERT(first == second);
+}
+// What's remembered only applies to the controller it was done with.
+
+void StackTests::newController()
+{
+  std::vector<std::string> first = begin();
+  CMockVMUSB* pNew = new CMockVMUSB;     // Before the delete so it's not at the same address.
+  delete m_pController;
+  m_pController = pNew;
+  std::vector<std::string> second = begin();
+  ASSERT(first == second);
+}
@@ -303,3 +303,17 @@ void CLoggingReadoutList::addMarker(uint16_t value)
   m_log.push_back(ss.str()); 
 }
 
+// The log records the request and the stack sizes before and after.
+
+size_t CLoggingReadoutList::optimize(bool coalesceReads, bool mergeWrites)
+{
+  size_t before = size();
+  size_t saved  = CVMUSBReadoutList::optimize(coalesceReads, mergeWrites);
+
+  stringstream ss;
+  ss << "optimize " << coalesceReads << " " << mergeWrites
+     << " " << before << " " << size();
+  m_log.push_back(ss.str());
+
+  return saved;
+}
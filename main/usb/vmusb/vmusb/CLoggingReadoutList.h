@@ -45,6 +45,8 @@ class CLoggingReadoutList : public CVMUSBReadoutList
     void addDelay(uint8_t clocks);
     void addMarker(uint16_t value);
 
+    size_t optimize(bool coalesceReads = true, bool mergeWrites = true);
+
 };
 
 #endif
@@ -135,14 +135,18 @@ int CMockVMUSB::loadList(uint8_t listNumber, CVMUSBReadoutList& list, off_t list
   m_opRecord.push_back("loadList::begin"); // bookend
 
   ostringstream command;
-  command << "listnumber:" << listNumber;
+  command << "listnumber:" << static_cast<int>(listNumber);
+  m_opRecord.push_back(command.str());
   command.str(""); command.clear(); // clear string and stream status bits
   command << "offset:" << listOffset;
   m_opRecord.push_back(command.str()); // bookend
 
   for (int stackIndex=0;  stackIndex<stackLength; ++stackIndex) {
     command.str(""); command.clear(); // clear string and stream status bits
-    command << dec << stackIndex << ":" << hex << stack.at(stackLength); 
+    command << dec << stackIndex << ":" 
+            << setfill('0') << hex 
+            << setw(8) << stack.at(stackIndex)
+            << dec << setfill(' ');
     m_opRecord.push_back(command.str());
   }
 
@@ -152,7 +156,8 @@ int CMockVMUSB::loadList(uint8_t listNumber, CVMUSBReadoutList& list, off_t list
 }
 
 /**
- *
+ * Data queued with addReturnData are returned first (e.g. synthetic
+ * VM-USB buffers); otherwise the buffer is filled with a counting pattern.
  */
 int CMockVMUSB::usbRead(void* data, size_t bufferSize, size_t* transferCount, int timeout)
 {
@@ -166,18 +171,23 @@ int CMockVMUSB::usbRead(void* data, size_t bufferSize, size_t* transferCount, in
   command << "timeout:" << timeout;
   m_opRecord.push_back(command.str()); 
 
-  transferCount = 0;
+  *transferCount = 0;
+  int retval     = 0;
 
-  if (bufferSize!=0) {
+  if (m_returnData.size()>0) {
+    fillReturnData(data, bufferSize, transferCount);
+    retval = m_returnData.front().first;
+    m_returnData.erase(m_returnData.begin());
+  } else if (bufferSize!=0) {
     uint32_t* buffer = reinterpret_cast<uint32_t*>(data);
     for (int i=0; i<bufferSize/sizeof(uint32_t); ++i) {
       buffer[i] = i;
-      transferCount += 4;
+      *transferCount += 4;
     }
   }
 
   m_opRecord.push_back("usbRead:end");
-  return 0;
+  return retval;
 }
 
 uint32_t CMockVMUSB::readRegister(uint32_t reg)
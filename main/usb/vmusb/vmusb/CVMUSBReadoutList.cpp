@@ -18,6 +18,7 @@
 #include "CVMUSB.h"		//  I think this is ok.
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 using namespace std;
 
 // Class level statics:
@@ -66,6 +67,7 @@ static const int modeNTMask(0xc00000);
 static const int modeNTShift(22);
 static const int modeBLTMask(0xf0000000);
 static const int modeBLTShift(24);
+static const int modeBLTCount(0xff); // BLT field once shifted down.
 
 
 
@@ -675,6 +677,58 @@ CVMUSBReadoutList::addMaskedCountFifoRead32(uint32_t address, uint8_t amod)
 }
 
 
+/*
+ * Return the number of longwords in the stack line that starts at index.
+ * Zero is returned if the line would run off the end of the list
+ * (e.g. the list is not a set of stack lines).
+ */
+size_t
+CVMUSBReadoutList::lineLength(size_t index) const
+{
+  uint32_t mode = m_list[index];
+  size_t   length;
+  if (mode & modeDelay) {
+    length = 1;
+  } else if (mode & modeMarker) {
+    length = 2;
+  } else if (mode & modeSLF) {
+    length = (mode & modeNW) ? 2 : 3;
+  } else {
+    length = 2;			// mode and address.
+    if (mode & modeMB) length++;	// block count.
+    if (mode & modeND) length++;	// number data mask.
+    if ((mode & modeNW) == 0) {	// data to write.
+      size_t transfers = (mode >> modeBLTShift) & modeBLTCount;
+      length += transfers ? transfers : 1;
+    }
+  }
+  return (index + length <= m_list.size()) ? length : 0;
+}
+/*
+ * True if the line at index is a plain 16 or 32 bit single shot read using an
+ * address modifier that has a block transfer counterpart.
+ */
+bool
+CVMUSBReadoutList::isCoalescibleRead(size_t index) const
+{
+  uint32_t mode = m_list[index];
+  if ((mode & ~modeAMMask) != static_cast<uint32_t>(modeNW)) return false;
+  return blockModifier(mode & modeAMMask) != 0;
+}
+/*
+ * Map a data address modifier to the block transfer modifier for the
+ * same address space and privilege; 0 if there is none.
+ */
+uint8_t
+CVMUSBReadoutList::blockModifier(uint8_t amod)
+{
+  if (amod == a32UserData) return a32UserBlock;
+  if (amod == a32PrivData) return a32PrivBlock;
+  if (amod == a24UserData) return a24UserBlock;
+  if (amod == a24PrivData) return a24PrivBlock;
+  return 0;
+}
+
 /*
  * Utility function used to turn a single shot read in the list into
  * a number data read.  The last two words in the stack are assumed to describe
@@ -692,6 +746,161 @@ CVMUSBReadoutList::lastTransferIsNumberData(uint32_t mask)
 
   m_list.push_back(address);
 }
+//////////////////////////////////////////////////////
+// Optimization and cost estimates.
+
+/*!
+   Rewrite the list so that it does the same work in fewer stack lines.
+   Two transformations are available:
+   - Runs of single shot reads of the same width and data address modifier
+     at consecutive addresses are turned into a single block transfer line.
+     Runs are broken at 256 byte boundaries (a VME block transfer may not
+     cross one), and are never formed between a number data read and the
+     block transfer that uses its count as that would take the count
+     from the wrong place.
+   - A single shot write that is identical to the line just before it
+     is dropped.
+
+   Both change what the VME bus sees.  Block transfers require that the
+   module support them at those addresses and dropping a write is wrong
+   for registers where the write itself is the action (e.g. a FIFO).
+   That's why optimization is something the user asks for and not done
+   by default.
+
+   Lines that can't be decoded end the optimization; the remainder of the
+   list is left as is.
+
+   \param coalesceReads : bool
+      Turn runs of single reads into block reads.
+   \param mergeWrites : bool
+      Drop immediately repeated single writes.
+   \return size_t
+   \retval Number of stack longwords that were removed.
+*/
+size_t
+CVMUSBReadoutList::optimize(bool coalesceReads, bool mergeWrites)
+{
+  size_t           before = m_list.size();
+  vector<uint32_t> result;
+  size_t           lastLine(0);	// Index in result of the prior line.
+  size_t           lastLength(0);
+  bool             countPending(false); // Number data read not yet used.
+
+  size_t i = 0;
+  while (i < m_list.size()) {
+    size_t   length = lineLength(i);
+    uint32_t mode   = m_list[i];
+    if (length == 0) {
+      result.insert(result.end(), m_list.begin() + i, m_list.end());
+      break;
+    }
+
+    if (coalesceReads && !countPending && isCoalescibleRead(i)) {
+      uint32_t base  = m_list[i+1];
+      uint32_t width = (base & addrNotLong) ? sizeof(uint16_t) : sizeof(uint32_t);
+      size_t   count = 1;
+      size_t   next  = i + 2;
+      while ((next + 1 < m_list.size()) && (m_list[next] == mode)) {
+	uint32_t address = m_list[next+1];
+	if ((address != base + count*width) ||
+	    ((address & 0xffffff00) != (base & 0xffffff00))) {
+	  break;
+	}
+	count++;
+	next += 2;
+      }
+      if (count > 1) {
+	lastLine   = result.size();
+	lastLength = 2;
+	result.push_back((mode & ~modeAMMask) |
+			 blockModifier(mode & modeAMMask) |
+			 (count << modeBLTShift));
+	result.push_back(base);
+	i = next;
+	continue;
+      }
+    }
+    // Single shot writes are three longwords so a duplicate is a three
+    // longword line that matches the prior one exactly:
+
+    bool singleWrite = ((mode & (modeDelay | modeMarker | modeSLF | modeNW |
+				 modeMB | modeND)) == 0)  &&
+                       (((mode >> modeBLTShift) & modeBLTCount) == 0);
+    if (mergeWrites && singleWrite && (lastLength == 3) &&
+	equal(m_list.begin() + i, m_list.begin() + i + 3,
+	      result.begin() + lastLine)) {
+      i += length;
+      continue;
+    }
+
+    // Keep track of whether or not a number data read is waiting for
+    // its block transfer:
+
+    if (((mode & (modeDelay | modeMarker | modeSLF)) == 0)) {
+      if (mode & modeND) {
+	countPending = true;
+      } else if ((mode & modeMB) || ((mode >> modeBLTShift) & modeBLTCount)) {
+	countPending = false;
+      }
+    }
+    lastLine   = result.size();
+    lastLength = length;
+    result.insert(result.end(), m_list.begin() + i, m_list.begin() + i + length);
+    i += length;
+  }
+  m_list = result;
+  return before - m_list.size();
+}
+/*!
+   \return size_t
+   \retval The number of 16 bit words of VM-USB stack memory this list
+           will occupy when loaded.  Each stack also has a two longword
+           header.
+*/
+size_t
+CVMUSBReadoutList::stackWords() const
+{
+  return m_list.size() * sizeof(uint32_t)/sizeof(uint16_t) + 4;
+}
+/*!
+   Estimate the number of VME bus cycles an execution of the list
+   performs.  A single shot transfer is counted as an address and a data
+   cycle.  A block transfer as one address cycle and one data cycle per
+   transfer, with a new address cycle for each block of a multiblock
+   transfer.  Register operations, markers and delays don't use the VME
+   bus and count as zero.
+
+   \note block transfers whose count comes from number data are
+         counted using the transfer count in the stack, since the real
+         count is only known when the list runs.
+
+   \return size_t
+*/
+size_t
+CVMUSBReadoutList::busCycles() const
+{
+  size_t cycles = 0;
+  size_t i      = 0;
+  while (i < m_list.size()) {
+    size_t length = lineLength(i);
+    if (length == 0) break;
+
+    uint32_t mode = m_list[i];
+    if ((mode & (modeDelay | modeMarker | modeSLF)) == 0) {
+      size_t transfers = (mode >> modeBLTShift) & modeBLTCount;
+      if (mode & modeMB) {
+	cycles += m_list[i+1] * (1 + transfers);
+      } else if (transfers) {
+	cycles += 1 + transfers;
+      } else {
+	cycles += 2;
+      }
+    }
+    i += length;
+  }
+  return cycles;
+}
+
 //////////////////////////////////////////////////////
 // Debugging.
 
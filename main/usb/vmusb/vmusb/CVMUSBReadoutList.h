@@ -216,6 +216,12 @@ public:
 
   void dump(std::ostream& str);	/* Dump contents of stack. */
 
+  // Optimization and cost estimates:
+
+  virtual size_t optimize(bool coalesceReads = true, bool mergeWrites = true);
+  size_t         stackWords() const;	/* VM-USB stack memory (16 bit words). */
+  size_t         busCycles() const;	/* Estimated VME cycles per execution */
+
 
   // The following constants define address modifiers that are known to
   // VME Rev C.  There are other amods that are legal in newer revs of the
@@ -254,6 +260,9 @@ private:
 			uint32_t startingMode,
 			size_t   width = sizeof(uint32_t));
   void     lastTransferIsNumberData(uint32_t mask);
+  size_t   lineLength(size_t index) const;
+  bool     isCoalescibleRead(size_t index) const;
+  static uint8_t blockModifier(uint8_t amod);
 
  public:
   // SWIG helper functions.
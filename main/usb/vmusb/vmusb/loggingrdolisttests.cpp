@@ -41,6 +41,7 @@ class CLoggingReadoutListTests : public CppUnit::TestFixture
   CPPUNIT_TEST(addMaskedCountFifoRead32_0);
   CPPUNIT_TEST(addDelay_0);
   CPPUNIT_TEST(addMarker_0);
+  CPPUNIT_TEST(optimize_0);
   CPPUNIT_TEST_SUITE_END();
 
   public:
@@ -73,6 +74,7 @@ class CLoggingReadoutListTests : public CppUnit::TestFixture
     void addMaskedCountFifoRead32_0();
     void addDelay_0();
     void addMarker_0();
+    void optimize_0();
 
 };
 
@@ -333,4 +335,19 @@ void CLoggingReadoutListTests::addMarker_0()
 
 }
 
+void CLoggingReadoutListTests::optimize_0()
+{
+  m_pList->addRead32(0x1000, 0x09);
+  m_pList->addRead32(0x1004, 0x09);
+  m_pList->optimize();
+
+  vector<string> expected(3);
+  expected[0]  = "addRead32 00001000 09";
+  expected[1]  = "addRead32 00001004 09";
+  expected[2]  = "optimize 1 1 4 2";
+
+  CPPUNIT_ASSERT(expected == m_pList->getLog());
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), m_pList->size());
+}
+
 #endif
@@ -34,6 +34,9 @@ class CMockVMUSBTests : public CppUnit::TestFixture {
   CPPUNIT_TEST (eventsPerBuffer_0); 
   CPPUNIT_TEST (addReturnDatum_0);
   CPPUNIT_TEST (addReturnData_0);
+  CPPUNIT_TEST (loadList_0);
+  CPPUNIT_TEST (loadList_1);
+  CPPUNIT_TEST (usbRead_0);
   CPPUNIT_TEST_SUITE_END();
 
   private:
@@ -57,6 +60,9 @@ class CMockVMUSBTests : public CppUnit::TestFixture {
 
   void addReturnDatum_0();
   void addReturnData_0();
+  void loadList_0();
+  void loadList_1();
+  void usbRead_0();
 
 };
 
@@ -253,3 +259,63 @@ void CMockVMUSBTests::addReturnData_0() {
   CPPUNIT_ASSERT(2 == retData.at(2));
 }
 
+/** loadList records the raw stack, so an optimized list shows up
+ *  as the optimized stack lines.
+ */
+void CMockVMUSBTests::loadList_0() {
+  CVMUSBReadoutList list;
+  list.addRead32(0x1000, 0x09);
+  list.addRead32(0x1004, 0x09);
+  list.optimize();
+
+  m_pCtlr->loadList(2, list, 0x10);
+
+  vector<string> expected(6);
+  expected[0] = "loadList::begin";
+  expected[1] = "listnumber:2";
+  expected[2] = "offset:16";
+  expected[3] = "0:0200010b";
+  expected[4] = "1:00001000";
+  expected[5] = "loadList::end";
+
+  CPPUNIT_ASSERT( expected == m_pCtlr->getOperationRecord());
+}
+
+/** Executing an optimized logging list shows the optimization.
+ */
+void CMockVMUSBTests::loadList_1() {
+  CVMUSBReadoutList* list = m_pCtlr->createReadoutList();
+  list->addWrite32(0x1000, 0x09, 5);
+  list->addWrite32(0x1000, 0x09, 5);
+  list->optimize();
+
+  size_t nBytesRead=0;
+  uint32_t data[100]; 
+  m_pCtlr->executeList(*list, data, sizeof(data), &nBytesRead);
+
+  vector<string> expected(5);
+  expected[0] = "executeList::begin";
+  expected[1] = "addWrite32 00001000 09 5";
+  expected[2] = "addWrite32 00001000 09 5";
+  expected[3] = "optimize 1 1 6 3";
+  expected[4] = "executeList::end";
+
+  CPPUNIT_ASSERT( expected == m_pCtlr->getOperationRecord());
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), list->size());
+
+  delete list;
+}
+
+/** usbRead hands back the queued return data, one transfer per read.
+ */
+void CMockVMUSBTests::usbRead_0() {
+  m_pCtlr->addReturnData({0x8001, 0x0000, 0xffff}, 0);
+
+  uint16_t buffer[16];
+  size_t   nRead;
+  CPPUNIT_ASSERT_EQUAL(0, m_pCtlr->usbRead(buffer, sizeof(buffer), &nRead));
+  CPPUNIT_ASSERT_EQUAL(3*sizeof(uint16_t), nRead);
+  CPPUNIT_ASSERT_EQUAL(uint16_t(0x8001), buffer[0]);
+  CPPUNIT_ASSERT_EQUAL(uint16_t(0xffff), buffer[2]);
+  CPPUNIT_ASSERT(m_pCtlr->getReturnData().empty());
+}
@@ -47,6 +47,14 @@ class VMUSBRdoListTests : public CppUnit::TestFixture {
   CPPUNIT_TEST (addMaskedCountFifoRead32_0);
   CPPUNIT_TEST (addDelay_0);
   CPPUNIT_TEST (addMarker_0);
+  CPPUNIT_TEST (optimizeReads32_0);
+  CPPUNIT_TEST (optimizeReads16_0);
+  CPPUNIT_TEST (optimizeBoundary_0);
+  CPPUNIT_TEST (optimizeNumberData_0);
+  CPPUNIT_TEST (optimizeWrites_0);
+  CPPUNIT_TEST (optimizeOff_0);
+  CPPUNIT_TEST (stackWords_0);
+  CPPUNIT_TEST (busCycles_0);
   CPPUNIT_TEST_SUITE_END();
 
   private:
@@ -82,6 +90,14 @@ class VMUSBRdoListTests : public CppUnit::TestFixture {
   void addMaskedCountFifoRead32_0();
   void addDelay_0();
   void addMarker_0();
+  void optimizeReads32_0();
+  void optimizeReads16_0();
+  void optimizeBoundary_0();
+  void optimizeNumberData_0();
+  void optimizeWrites_0();
+  void optimizeOff_0();
+  void stackWords_0();
+  void busCycles_0();
 
 };
 
@@ -377,3 +393,162 @@ void VMUSBRdoListTests::addMarker_0()
 
   CPPUNIT_ASSERT(expected == m_pList->get());
 }
+
+// Consecutive 32 bit reads become a block read with the block amod.
+// Reads that don't continue the run are left alone.
+
+void VMUSBRdoListTests::optimizeReads32_0()
+{
+  m_pList->addRead32(0x1000, 0x09);
+  m_pList->addRead32(0x1004, 0x09);
+  m_pList->addRead32(0x1008, 0x09);
+  m_pList->addRead32(0x1010, 0x09); // Gap.
+  m_pList->addRead32(0x1014, 0x39); // Different amod.
+
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), m_pList->optimize());
+
+  std::vector<uint32_t> expected(6);
+  expected[0] = ((3<<24)|(1<<8)|0x0b);
+  expected[1] = 0x1000;
+  expected[2] = ((1<<8)|0x09);
+  expected[3] = 0x1010;
+  expected[4] = ((1<<8)|0x39);
+  expected[5] = 0x1014;
+
+  CPPUNIT_ASSERT(expected == m_pList->get());
+}
+
+void VMUSBRdoListTests::optimizeReads16_0()
+{
+  m_pList->addRead16(0x2000, 0x3d);
+  m_pList->addRead16(0x2002, 0x3d);
+  m_pList->addRead32(0x2004, 0x3d); // Width change ends the run.
+  m_pList->addRead8(0x2008, 0x3d);  // Byte reads are never merged.
+  m_pList->addRead8(0x2009, 0x3d);
+
+  m_pList->optimize();
+
+  std::vector<uint32_t> expected(8);
+  expected[0] = ((2<<24)|(1<<8)|0x3f);
+  expected[1] = 0x2001;
+  expected[2] = ((1<<8)|0x3d);
+  expected[3] = 0x2004;
+  expected[4] = ((1<<8)|(2<<6)|0x3d);
+  expected[5] = 0x2009;
+  expected[6] = ((1<<8)|(1<<6)|0x3d);
+  expected[7] = 0x2009;
+
+  CPPUNIT_ASSERT(expected == m_pList->get());
+}
+
+// Block transfers can't cross a 256 byte boundary.
+
+void VMUSBRdoListTests::optimizeBoundary_0()
+{
+  for (uint32_t a = 0x30f8; a < 0x3108; a += 4) {
+    m_pList->addRead32(a, 0x0d);
+  }
+  m_pList->optimize();
+
+  std::vector<uint32_t> expected(4);
+  expected[0] = ((2<<24)|(1<<8)|0x0f);
+  expected[1] = 0x30f8;
+  expected[2] = ((2<<24)|(1<<8)|0x0f);
+  expected[3] = 0x3100;
+
+  CPPUNIT_ASSERT(expected == m_pList->get());
+}
+
+// Nothing is merged between a count read and the block read that uses
+// the count.
+
+void VMUSBRdoListTests::optimizeNumberData_0()
+{
+  m_pList->addBlockCountRead32(0x4000, 0xfff, 0x09);
+  m_pList->addRead32(0x4004, 0x09);
+  m_pList->addRead32(0x4008, 0x09);
+  m_pList->addMaskedCountBlockRead32(0x5000, 0x0b);
+  m_pList->addRead32(0x4004, 0x09);
+  m_pList->addRead32(0x4008, 0x09);
+
+  std::vector<uint32_t> original = m_pList->get();
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), m_pList->optimize());
+
+  std::vector<uint32_t> expected(original.begin(), original.begin() + 9);
+  expected.push_back((2<<24)|(1<<8)|0x0b);
+  expected.push_back(0x4004);
+
+  CPPUNIT_ASSERT(expected == m_pList->get());
+}
+
+// Only immediately repeated single writes are dropped.
+
+void VMUSBRdoListTests::optimizeWrites_0()
+{
+  m_pList->addWrite16(0x6000, 0x09, 1);
+  m_pList->addWrite16(0x6000, 0x09, 1);
+  m_pList->addWrite16(0x6000, 0x09, 1);
+  m_pList->addWrite16(0x6000, 0x09, 2);
+  m_pList->addDelay(1);
+  m_pList->addWrite16(0x6000, 0x09, 2);
+  m_pList->addRegisterWrite(4, 1);
+  m_pList->addRegisterWrite(4, 1);
+
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(6), m_pList->optimize());
+
+  CVMUSBReadoutList expected;
+  expected.addWrite16(0x6000, 0x09, 1);
+  expected.addWrite16(0x6000, 0x09, 2);
+  expected.addDelay(1);
+  expected.addWrite16(0x6000, 0x09, 2);
+  expected.addRegisterWrite(4, 1);
+  expected.addRegisterWrite(4, 1);
+
+  CPPUNIT_ASSERT(expected.get() == m_pList->get());
+}
+
+// Each transformation can be turned off.
+
+void VMUSBRdoListTests::optimizeOff_0()
+{
+  m_pList->addRead32(0x1000, 0x09);
+  m_pList->addRead32(0x1004, 0x09);
+  m_pList->addWrite32(0x1000, 0x09, 1);
+  m_pList->addWrite32(0x1000, 0x09, 1);
+  std::vector<uint32_t> original = m_pList->get();
+
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), m_pList->optimize(false, false));
+  CPPUNIT_ASSERT(original == m_pList->get());
+
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(3), m_pList->optimize(false, true));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2), m_pList->optimize(true, false));
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(5), m_pList->size());
+}
+
+void VMUSBRdoListTests::stackWords_0()
+{
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(4), m_pList->stackWords());
+  m_pList->addRead32(0x1000, 0x09);
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(8), m_pList->stackWords());
+}
+
+void VMUSBRdoListTests::busCycles_0()
+{
+  m_pList->addRead32(0x1000, 0x09);          // 2
+  m_pList->addWrite16(0x1000, 0x09, 1);      // 2
+  m_pList->addBlockRead32(0x2000, 0x0b, 10); // 11
+  m_pList->addFifoRead32(0x3000, 0x0b, 130); // 2*65 + 3
+  m_pList->addDelay(10);                     // 0
+  m_pList->addMarker(0xaaaa);                // 0
+  m_pList->addRegisterRead(4);               // 0
+
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(2+2+11+130+3), m_pList->busCycles());
+
+  m_pList->clear();
+  for (uint32_t a = 0x1000; a < 0x1010; a += 4) {
+    m_pList->addRead32(a, 0x09);
+  }
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(8), m_pList->busCycles());
+  m_pList->optimize();
+  CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(5), m_pList->busCycles());
+}
@@ -0,0 +1,432 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCompressedSegmentReader.cpp
+ * @brief Implement the block compressed segment reader.
+ */
+
+#include <config.h>
+#include "CCompressedSegmentReader.h"
+
+#include <RingItemView.h>
+#include <io.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *   Reads the segment header and, if the file is seekable, the block index.
+ *
+ * @param fd            - File descriptor positioned at the segment header.
+ * @param magicConsumed - True if the caller has already read the
+ *                        MagicSize bytes of magic (e.g. to identify the
+ *                        file) so fd is positioned just after them.
+ *
+ * @throw std::runtime_error - not a compressed segment.
+ * @throw int                - errno from io::readData.
+ */
+CCompressedSegmentReader::CCompressedSegmentReader(int fd, bool magicConsumed) :
+  m_fd(fd),
+  m_base(0),
+  m_indexed(false),
+  m_pCurrent(0),
+  m_cursor(0),
+  m_threadRunning(false),
+  m_stop(false),
+  m_endOfData(false)
+{
+  memset(&m_trailer, 0, sizeof(m_trailer));
+
+  uint8_t* p      = reinterpret_cast<uint8_t*>(&m_header);
+  size_t   offset = 0;
+  if (magicConsumed) {
+    memcpy(m_header.s_magic, COMPRESSED_SEGMENT_MAGIC, MagicSize);
+    offset = MagicSize;
+  }
+  size_t nBytes = sizeof(m_header) - offset;
+  if ((io::readData(fd, p + offset, nBytes) != nBytes) ||
+      !isCompressed(&m_header, sizeof(m_header))) {
+    throw std::runtime_error("Not a compressed event segment");
+  }
+  if (m_header.s_version != COMPRESSED_SEGMENT_VERSION) {
+    throw std::runtime_error("Unsupported compressed event segment version");
+  }
+
+  off_t position = lseek(fd, 0, SEEK_CUR);
+  if (position >= 0) {
+    m_base = position - sizeof(m_header);
+    readIndex();
+  }
+  pthread_mutex_init(&m_lock, 0);
+  pthread_cond_init(&m_changed, 0);
+}
+
+/**
+ * destructor
+ *   Stop the decompression thread and release the blocks.
+ */
+CCompressedSegmentReader::~CCompressedSegmentReader()
+{
+  stopThread();
+  delete m_pCurrent;
+  pthread_cond_destroy(&m_changed);
+  pthread_mutex_destroy(&m_lock);
+}
+
+/*----------------------------------------------------------------------------
+ * Public methods
+ */
+
+/**
+ * read
+ *   Read uncompressed data.
+ *
+ * @param pBuffer - Where the data go.
+ * @param nBytes  - How much to read.
+ * @return size_t - Bytes read; fewer than nBytes only at the end of the data.
+ *
+ * @throw std::runtime_error - a block is corrupt or could not be read.
+ */
+size_t
+CCompressedSegmentReader::read(void* pBuffer, size_t nBytes)
+{
+  uint8_t* p    = reinterpret_cast<uint8_t*>(pBuffer);
+  size_t   done = 0;
+
+  while (done < nBytes) {
+    if (!m_pCurrent || (m_cursor == m_pCurrent->s_data.size())) {
+      delete m_pCurrent;
+      m_pCurrent = nextBlock();
+      m_cursor   = 0;
+      if (!m_pCurrent) break;
+    }
+    size_t n = std::min(nBytes - done, m_pCurrent->s_data.size() - m_cursor);
+    memcpy(p + done, &m_pCurrent->s_data[m_cursor], n);
+    m_cursor += n;
+    done     += n;
+  }
+  return done;
+}
+
+/**
+ * blockAt
+ *   @param fileOffset - Offset relative to the segment header.
+ *   @return size_t    - The first block at or after fileOffset, or
+ *                       blockCount() if there is none.
+ */
+size_t
+CCompressedSegmentReader::blockAt(uint64_t fileOffset) const
+{
+  for (size_t i = 0; i < m_index.size(); i++) {
+    if (m_index[i].s_fileOffset >= fileOffset) return i;
+  }
+  return m_index.size();
+}
+
+/**
+ * blockDataOffset
+ *   @param block     - Block number; blockCount() means the end of the data.
+ *   @return uint64_t - Uncompressed offset at which the block's data start.
+ */
+uint64_t
+CCompressedSegmentReader::blockDataOffset(size_t block) const
+{
+  return (block < m_index.size()) ? m_index[block].s_dataOffset : dataSize();
+}
+
+/**
+ * seekBlock
+ *   Position so that the next read returns the first byte of a block.
+ *
+ * @param block - Block number; blockCount() positions at the end of the data.
+ *
+ * @throw std::runtime_error - the segment has no index.
+ * @throw std::out_of_range  - no such block.
+ */
+void
+CCompressedSegmentReader::seekBlock(size_t block)
+{
+  if (!m_indexed) {
+    throw std::runtime_error("Compressed event segment has no block index");
+  }
+  if (block > m_index.size()) {
+    throw std::out_of_range("Compressed event segment block number");
+  }
+  stopThread();
+  delete m_pCurrent;
+  m_pCurrent  = 0;
+  m_cursor    = 0;
+  m_endOfData = false;
+  m_error     = "";
+
+  uint64_t offset = (block < m_index.size()) ?
+    m_index[block].s_fileOffset :
+    m_trailer.s_indexOffset - sizeof(CompressedBlockHeader); // The terminator.
+  if (lseek(m_fd, m_base + offset, SEEK_SET) < 0) {
+    throw std::runtime_error("Unable to position in a compressed event segment");
+  }
+}
+
+/**
+ * seekItem
+ *   Position so that the next read returns the start of an item.  The
+ *   block holding the item is decompressed and the items before it in
+ *   the block are skipped.
+ *
+ * @param item - Item number (from 0); itemCount() or more positions at the end.
+ */
+void
+CCompressedSegmentReader::seekItem(uint64_t item)
+{
+  if (m_indexed && (item >= itemCount())) {
+    seekBlock(m_index.size());
+    return;
+  }
+  size_t block = 0;
+  while ((block + 1 < m_index.size()) && (m_index[block + 1].s_firstItem <= item)) {
+    block++;
+  }
+  seekBlock(block);
+
+  uint64_t skip = item - m_index[block].s_firstItem;
+  if (skip) {
+    m_pCurrent = nextBlock();
+    while (skip-- && m_pCurrent && (m_cursor < m_pCurrent->s_data.size())) {
+      m_cursor += CRingItemView(&m_pCurrent->s_data[m_cursor]).size();
+    }
+  }
+}
+
+/**
+ * isCompressed
+ *   @param pBytes - The first bytes of a file.
+ *   @param nBytes - How many there are.
+ *   @return bool  - True if they start a compressed segment.
+ */
+bool
+CCompressedSegmentReader::isCompressed(const void* pBytes, size_t nBytes)
+{
+  return (nBytes >= MagicSize) &&
+    (memcmp(pBytes, COMPRESSED_SEGMENT_MAGIC, MagicSize) == 0);
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities.
+ */
+
+/*
+ * Load the block index from the end of the file.  Files without a valid
+ * trailer (not seekable, or the writer never finished) are left
+ * unindexed.
+ */
+void
+CCompressedSegmentReader::readIndex()
+{
+  struct stat info;
+  if (fstat(m_fd, &info) || !S_ISREG(info.st_mode)) return;
+
+  off_t size = info.st_size - m_base;
+  CompressedSegmentTrailer trailer;
+  if (size < off_t(sizeof(CompressedSegmentHeader) + sizeof(trailer))) return;
+  if (pread(m_fd, &trailer, sizeof(trailer), info.st_size - sizeof(trailer)) !=
+      sizeof(trailer)) {
+    return;
+  }
+  if (memcmp(trailer.s_magic, COMPRESSED_TRAILER_MAGIC, sizeof(trailer.s_magic)) ||
+      (trailer.s_indexOffset +
+       trailer.s_blockCount * sizeof(CompressedBlockIndexEntry) +
+       sizeof(trailer) != uint64_t(size))) {
+    return;
+  }
+
+  std::vector<CompressedBlockIndexEntry> index(trailer.s_blockCount);
+  size_t nBytes = index.size() * sizeof(CompressedBlockIndexEntry);
+  if (nBytes &&
+      (pread(m_fd, &index[0], nBytes, m_base + trailer.s_indexOffset) != ssize_t(nBytes))) {
+    return;
+  }
+  m_index.swap(index);
+  m_trailer = trailer;
+  m_indexed = true;
+}
+
+/*
+ * Read and decompress the block at the file position.
+ * Returns null at the end of the blocks.  A file that ends part way into
+ * a block (the writer didn't finish) also just ends.
+ */
+CCompressedSegmentReader::pBlock
+CCompressedSegmentReader::readBlock(std::vector<uint8_t>& compressed)
+{
+  CompressedBlockHeader header;
+  if (io::readData(m_fd, &header, sizeof(header)) != sizeof(header)) {
+    return 0;
+  }
+  if (header.s_magic != COMPRESSED_BLOCK_MAGIC) {
+    throw std::runtime_error("Corrupt compressed event segment: bad block header");
+  }
+  if (header.s_size == 0) {
+    return 0;
+  }
+  if (header.s_compressedSize == 0) {
+    throw std::runtime_error("Corrupt compressed event segment: empty block");
+  }
+
+  compressed.resize(header.s_compressedSize);
+  if (io::readData(m_fd, &compressed[0], compressed.size()) != compressed.size()) {
+    return 0;
+  }
+
+  pBlock pResult = new Block;
+  pResult->s_data.resize(header.s_size);
+  pResult->s_itemCount = header.s_itemCount;
+
+  uLongf size   = header.s_size;
+  int    status = uncompress(&pResult->s_data[0], &size,
+                             &compressed[0], compressed.size());
+  if ((status != Z_OK) || (size != header.s_size)) {
+    delete pResult;
+    throw std::runtime_error("Corrupt compressed event segment: block does not decompress");
+  }
+  return pResult;
+}
+
+/*
+ * Get the next decompressed block from the thread, starting it if needed.
+ * Returns null at the end of the data.  Errors the thread hit are thrown
+ * once the blocks before them have been consumed.
+ */
+CCompressedSegmentReader::pBlock
+CCompressedSegmentReader::nextBlock()
+{
+  if (!m_threadRunning) {
+    if (m_endOfData) return 0;
+    startThread();
+  }
+
+  pBlock      pResult = 0;
+  std::string error;
+
+  pthread_mutex_lock(&m_lock);
+  while (m_queue.empty() && !m_endOfData) {
+    pthread_cond_wait(&m_changed, &m_lock);
+  }
+  if (!m_queue.empty()) {
+    pResult = m_queue.front();
+    m_queue.pop_front();
+    pthread_cond_broadcast(&m_changed);
+  } else {
+    error = m_error;
+  }
+  pthread_mutex_unlock(&m_lock);
+
+  if (error != "") {
+    throw std::runtime_error(error);
+  }
+  return pResult;
+}
+
+void
+CCompressedSegmentReader::startThread()
+{
+  m_stop = false;
+  if (pthread_create(&m_thread, 0, decompressor, this)) {
+    throw std::runtime_error("Unable to start the event segment decompression thread");
+  }
+  m_threadRunning = true;
+}
+
+/*
+ * Stop the thread and discard anything it decompressed that was not
+ * consumed.  The file position is then wherever the thread left it.
+ */
+void
+CCompressedSegmentReader::stopThread()
+{
+  if (!m_threadRunning) return;
+
+  pthread_mutex_lock(&m_lock);
+  m_stop = true;
+  pthread_cond_broadcast(&m_changed);
+  pthread_mutex_unlock(&m_lock);
+  pthread_join(m_thread, 0);
+  m_threadRunning = false;
+
+  while (!m_queue.empty()) {
+    delete m_queue.front();
+    m_queue.pop_front();
+  }
+}
+
+/*
+ * Thread body: stay up to MaxQueuedBlocks ahead of the consumer until the
+ * data end, an error occurs or we're asked to stop.
+ */
+void
+CCompressedSegmentReader::decompressBlocks()
+{
+  std::vector<uint8_t> compressed;
+  while (1) {
+    pBlock      pNew = 0;
+    std::string error;
+    try {
+      pNew = readBlock(compressed);
+    }
+    catch (std::exception& e) {
+      error = e.what();
+    }
+    catch (int e) {
+      error = strerror(e);
+    }
+
+    pthread_mutex_lock(&m_lock);
+    while (!m_stop && (m_queue.size() >= MaxQueuedBlocks)) {
+      pthread_cond_wait(&m_changed, &m_lock);
+    }
+    if (m_stop) {
+      pthread_mutex_unlock(&m_lock);
+      delete pNew;
+      return;
+    }
+    if (pNew) {
+      m_queue.push_back(pNew);
+    } else {
+      m_endOfData = true;
+      m_error     = error;
+    }
+    pthread_cond_broadcast(&m_changed);
+    pthread_mutex_unlock(&m_lock);
+
+    if (!pNew) return;
+  }
+}
+
+void*
+CCompressedSegmentReader::decompressor(void* pArg)
+{
+  reinterpret_cast<CCompressedSegmentReader*>(pArg)->decompressBlocks();
+  return 0;
+}
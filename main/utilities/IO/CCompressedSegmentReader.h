@@ -0,0 +1,112 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCompressedSegmentReader.h
+ * @brief Read a block compressed segment (see CompressedSegment.h).
+ */
+#ifndef CCOMPRESSEDSEGMENTREADER_H
+#define CCOMPRESSEDSEGMENTREADER_H
+
+#include "CompressedSegment.h"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+/**
+ * @class CCompressedSegmentReader
+ *
+ *   Presents the uncompressed contents of a segment as a byte stream.
+ *   Blocks are read and decompressed a few ahead of the consumer on a
+ *   background thread which is started by the first read.
+ *
+ *   If the file is seekable and has a block index, the reader can be
+ *   positioned at any item or block.  Pipes and files whose writer never
+ *   finished can only be read sequentially.  The file descriptor belongs
+ *   to the caller.
+ */
+class CCompressedSegmentReader
+{
+private:
+  typedef struct _Block {
+    std::vector<uint8_t> s_data;
+    uint32_t             s_itemCount;
+  } Block, *pBlock;
+
+  static const size_t MaxQueuedBlocks = 4;
+
+  int                                    m_fd;
+  off_t                                  m_base;     // File offset of segment header.
+  CompressedSegmentHeader                m_header;
+  std::vector<CompressedBlockIndexEntry> m_index;
+  CompressedSegmentTrailer               m_trailer;
+  bool                                   m_indexed;
+
+  pBlock                                 m_pCurrent;
+  size_t                                 m_cursor;
+
+  // Shared with the decompression thread:
+
+  pthread_t                              m_thread;
+  bool                                   m_threadRunning;
+  pthread_mutex_t                        m_lock;
+  pthread_cond_t                         m_changed;
+  std::deque<pBlock>                     m_queue;
+  bool                                   m_stop;
+  bool                                   m_endOfData;
+  std::string                            m_error;
+
+public:
+  CCompressedSegmentReader(int fd, bool magicConsumed = false);
+  virtual ~CCompressedSegmentReader();
+
+private:
+  CCompressedSegmentReader(const CCompressedSegmentReader& rhs);
+  CCompressedSegmentReader& operator=(const CCompressedSegmentReader& rhs);
+
+public:
+  size_t read(void* pBuffer, size_t nBytes);
+
+  bool     indexed()    const { return m_indexed; }
+  size_t   blockCount() const { return m_index.size(); }
+  uint64_t itemCount()  const { return m_trailer.s_itemCount; }
+  uint64_t dataSize()   const { return m_trailer.s_dataSize; }
+  const std::vector<CompressedBlockIndexEntry>& index() const { return m_index; }
+
+  size_t   blockAt(uint64_t fileOffset) const;
+  uint64_t blockDataOffset(size_t block) const;
+  void     seekBlock(size_t block);
+  void     seekItem(uint64_t item);
+
+  static bool isCompressed(const void* pBytes, size_t nBytes);
+  static const size_t MagicSize = 8;
+
+private:
+  void   readIndex();
+  pBlock readBlock(std::vector<uint8_t>& compressed);
+  pBlock nextBlock();
+  void   startThread();
+  void   stopThread();
+  void   decompressBlocks();
+  static void* decompressor(void* pArg);
+};
+
+#endif
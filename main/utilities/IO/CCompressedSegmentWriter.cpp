@@ -0,0 +1,179 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCompressedSegmentWriter.cpp
+ * @brief Implement the block compressed segment writer.
+ */
+
+#include <config.h>
+#include "CCompressedSegmentWriter.h"
+
+#include <io.h>
+
+#include <stdexcept>
+#include <string.h>
+#include <zlib.h>
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *   Writes the segment header.
+ *
+ * @param fd        - File descriptor open on the (empty) output file.
+ * @param blockSize - Uncompressed bytes per block.  A block holds at
+ *                    least one item so larger items make larger blocks.
+ * @param level     - zlib compression level; 1 is fastest, 9 smallest.
+ *
+ * @throw int - errno from io::writeData.
+ */
+CCompressedSegmentWriter::CCompressedSegmentWriter(
+  int fd, size_t blockSize, int level
+) :
+  m_fd(fd),
+  m_blockSize(blockSize ? blockSize : DefaultBlockSize),
+  m_level(level),
+  m_blockItems(0),
+  m_bytesWritten(0),
+  m_dataSize(0),
+  m_nItems(0)
+{
+  m_block.reserve(m_blockSize);
+
+  CompressedSegmentHeader header;
+  memcpy(header.s_magic, COMPRESSED_SEGMENT_MAGIC, sizeof(header.s_magic));
+  header.s_version   = COMPRESSED_SEGMENT_VERSION;
+  header.s_blockSize = m_blockSize;
+  output(&header, sizeof(header));
+}
+
+/**
+ * destructor
+ *   Pending data that was not flushed is lost.
+ */
+CCompressedSegmentWriter::~CCompressedSegmentWriter()
+{}
+
+/*----------------------------------------------------------------------------
+ * Public methods
+ */
+
+/**
+ * write
+ *   Add an item to the segment.  If the item won't fit in the current
+ *   block, that block is written first.
+ *
+ * @param pItem  - Pointer to the complete ring item.
+ * @param nBytes - Size of the item.
+ */
+void
+CCompressedSegmentWriter::write(const void* pItem, size_t nBytes)
+{
+  if (!m_block.empty() && (m_block.size() + nBytes > m_blockSize)) {
+    flush();
+  }
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(pItem);
+  m_block.insert(m_block.end(), p, p + nBytes);
+  m_blockItems++;
+  m_nItems++;
+
+  if (m_block.size() >= m_blockSize) {
+    flush();
+  }
+}
+
+/**
+ * flush
+ *   Compress and write the pending items (if any) as a block.
+ *
+ * @throw std::runtime_error - compression failed.
+ * @throw int - errno from io::writeData.
+ */
+void
+CCompressedSegmentWriter::flush()
+{
+  if (m_block.empty()) return;
+
+  uLongf compressedSize = compressBound(m_block.size());
+  m_compressed.resize(compressedSize);
+  int status = compress2(&m_compressed[0], &compressedSize,
+                         &m_block[0], m_block.size(), m_level);
+  if (status != Z_OK) {
+    throw std::runtime_error("Compressing an event segment block failed");
+  }
+
+  CompressedBlockIndexEntry entry;
+  entry.s_fileOffset = m_bytesWritten;
+  entry.s_dataOffset = m_dataSize;
+  entry.s_firstItem  = m_nItems - m_blockItems;
+  m_index.push_back(entry);
+
+  CompressedBlockHeader header;
+  header.s_magic          = COMPRESSED_BLOCK_MAGIC;
+  header.s_compressedSize = compressedSize;
+  header.s_size           = m_block.size();
+  header.s_itemCount      = m_blockItems;
+  output(&header, sizeof(header));
+  output(&m_compressed[0], compressedSize);
+
+  m_dataSize  += m_block.size();
+  m_block.clear();
+  m_blockItems = 0;
+}
+
+/**
+ * finish
+ *   Flush the last block and write the terminator, index and trailer.
+ *   Nothing should be written after this.
+ */
+void
+CCompressedSegmentWriter::finish()
+{
+  flush();
+
+  CompressedBlockHeader end;
+  end.s_magic          = COMPRESSED_BLOCK_MAGIC;
+  end.s_compressedSize = 0;
+  end.s_size           = 0;
+  end.s_itemCount      = 0;
+  output(&end, sizeof(end));
+
+  CompressedSegmentTrailer trailer;
+  trailer.s_indexOffset = m_bytesWritten;
+  trailer.s_blockCount  = m_index.size();
+  trailer.s_itemCount   = m_nItems;
+  trailer.s_dataSize    = m_dataSize;
+  memcpy(trailer.s_magic, COMPRESSED_TRAILER_MAGIC, sizeof(trailer.s_magic));
+
+  if (!m_index.empty()) {
+    output(&m_index[0], m_index.size() * sizeof(CompressedBlockIndexEntry));
+  }
+  output(&trailer, sizeof(trailer));
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities.
+ */
+
+void
+CCompressedSegmentWriter::output(const void* pData, size_t nBytes)
+{
+  io::writeData(m_fd, pData, nBytes);
+  m_bytesWritten += nBytes;
+}
@@ -0,0 +1,78 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCompressedSegmentWriter.h
+ * @brief Write ring items as a block compressed segment (see CompressedSegment.h).
+ */
+#ifndef CCOMPRESSEDSEGMENTWRITER_H
+#define CCOMPRESSEDSEGMENTWRITER_H
+
+#include "CompressedSegment.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class CCompressedSegmentWriter
+ *
+ *   Items are accumulated until about blockSize bytes are pending, then
+ *   the block is compressed and written.  finish() must be called to
+ *   write the index that makes the segment randomly accessible; the
+ *   destructor does not do that since it can't report errors.  The file
+ *   descriptor belongs to the caller.
+ */
+class CCompressedSegmentWriter
+{
+public:
+  static const size_t DefaultBlockSize = 1024*1024;
+
+private:
+  int                                    m_fd;
+  size_t                                 m_blockSize;
+  int                                    m_level;
+  std::vector<uint8_t>                   m_block;
+  std::vector<uint8_t>                   m_compressed;
+  uint32_t                               m_blockItems;
+  uint64_t                               m_bytesWritten;
+  uint64_t                               m_dataSize;
+  uint64_t                               m_nItems;
+  std::vector<CompressedBlockIndexEntry> m_index;
+
+public:
+  CCompressedSegmentWriter(int fd, size_t blockSize = DefaultBlockSize,
+                           int level = 1);
+  virtual ~CCompressedSegmentWriter();
+
+private:
+  CCompressedSegmentWriter(const CCompressedSegmentWriter& rhs);
+  CCompressedSegmentWriter& operator=(const CCompressedSegmentWriter& rhs);
+
+public:
+  void write(const void* pItem, size_t nBytes);
+  void flush();
+  void finish();
+
+  uint64_t bytesWritten() const { return m_bytesWritten; }
+  uint64_t pendingBytes() const { return m_block.size(); }
+  uint64_t items()        const { return m_nItems; }
+
+private:
+  void output(const void* pData, size_t nBytes);
+};
+
+#endif
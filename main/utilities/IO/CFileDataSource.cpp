@@ -17,6 +17,7 @@
 
 #include <config.h>
 #include "CFileDataSource.h"
+#include "CCompressedSegmentReader.h"
 
 
 #include <URL.h>
@@ -53,7 +54,10 @@ using std::string;
 */
 CFileDataSource::CFileDataSource(URL& url, vector<uint16_t> exclusionList) :
   m_fd(-1),
-  m_url(*(new URL(url)))
+  m_url(*(new URL(url))),
+  m_formatKnown(false),
+  m_pDecompressor(0),
+  m_nPeeked(0)
 {
   for (int i=0; i < exclusionList.size(); i++) {
     m_exclude.insert(exclusionList[i]);
@@ -64,7 +68,10 @@ CFileDataSource::CFileDataSource(URL& url, vector<uint16_t> exclusionList) :
  * construtor from fd:
  */
 CFileDataSource::CFileDataSource(int fd, vector<uint16_t> exclusionlist) :
-  m_fd(fd),  m_url(*(new URL("file://stdin/junk")))
+  m_fd(fd),  m_url(*(new URL("file://stdin/junk"))),
+  m_formatKnown(false),
+  m_pDecompressor(0),
+  m_nPeeked(0)
 {
   for (int i=0; i < exclusionlist.size(); i++) {
     m_exclude.insert(exclusionlist[i]);
@@ -78,6 +85,7 @@ CFileDataSource::CFileDataSource(int fd, vector<uint16_t> exclusionlist) :
 */
 CFileDataSource::~CFileDataSource()
 {
+  delete m_pDecompressor;
   delete &m_url;
   close(m_fd);
 }
@@ -116,13 +124,35 @@ CFileDataSource::getItem()
 void CFileDataSource::read(char* pBuffer, size_t nBytes)
 {
   if (! eof() ) {
-    size_t nRead = io::readData(m_fd, pBuffer, nBytes);
+    size_t nRead = readBytes(pBuffer, nBytes);
 
     if (nRead != nBytes) {
       setEOF(true);
     }
   }
 }
+/*!
+  Read a block of raw data without regard to item boundaries.  This is
+  read() but the caller is told how much was read so that it can read
+  ahead in large blocks.
+
+  \param pBuffer - Where the data go.
+  \param nBytes  - Size of the block.
+  \return size_t - Number of bytes read.  Less than nBytes only at the end
+                   of the file, in which case eof() becomes true.
+*/
+size_t
+CFileDataSource::readBlock(char* pBuffer, size_t nBytes)
+{
+  size_t nRead = 0;
+  if (! eof() ) {
+    nRead = readBytes(pBuffer, nBytes);
+    if (nRead != nBytes) {
+      setEOF(true);
+    }
+  }
+  return nRead;
+}
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // Private utilties.
@@ -142,7 +172,7 @@ CFileDataSource::getItemFromFile()
 
   RingItemHeader header;
 
-  int nRead = io::readData(m_fd, &header, sizeof(header));
+  int nRead = readBytes(&header, sizeof(header));
   if (nRead != sizeof(header)) {
     return reinterpret_cast<CRingItem*>(NULL);
   }
@@ -152,7 +182,7 @@ CFileDataSource::getItemFromFile()
   // Read the remainder of the data:
 
   uint8_t* pBody = new uint8_t[bodysize];
-  nRead          = io::readData(m_fd, pBody, bodysize);
+  nRead          = readBytes(pBody, bodysize);
   if (nRead != bodysize) {
     delete []pBody;
     return reinterpret_cast<CRingItem*>(NULL);
@@ -249,3 +279,49 @@ CFileDataSource::getItemSize(RingItemHeader& header)
 
   return size;
 }
+/*
+**  Read data from the file, decompressing if it's a compressed segment.
+**
+** Parameters:
+**    pBuffer - where the data go.
+**    nBytes  - Number of bytes to read.
+** Returns:
+**    Number of bytes read.  This is less than nBytes only at end of file.
+*/
+size_t
+CFileDataSource::readBytes(void* pBuffer, size_t nBytes)
+{
+  if (!m_formatKnown) {
+    checkFormat();
+  }
+  if (m_pDecompressor) {
+    return m_pDecompressor->read(pBuffer, nBytes);
+  }
+  // Bytes read by checkFormat come first:
+
+  uint8_t* p = reinterpret_cast<uint8_t*>(pBuffer);
+  size_t   n = 0;
+  if (m_nPeeked) {
+    n = (nBytes < m_nPeeked) ? nBytes : m_nPeeked;
+    memcpy(p, m_peeked, n);
+    memmove(m_peeked, m_peeked + n, m_nPeeked - n);
+    m_nPeeked -= n;
+  }
+  return n + io::readData(m_fd, p + n, nBytes - n);
+}
+/*
+**  Determine if the file is a compressed segment.  The first bytes of the
+**  file are read.  If they are not the compressed segment magic they are
+**  saved so that they will be the first bytes read.  This works for
+**  pipes as well as files.
+*/
+void
+CFileDataSource::checkFormat()
+{
+  m_formatKnown = true;
+  m_nPeeked     = io::readData(m_fd, m_peeked, CCompressedSegmentReader::MagicSize);
+  if (CCompressedSegmentReader::isCompressed(m_peeked, m_nPeeked)) {
+    m_nPeeked       = 0;
+    m_pDecompressor = new CCompressedSegmentReader(m_fd, true);
+  }
+}
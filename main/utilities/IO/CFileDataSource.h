@@ -28,6 +28,7 @@
 
 class URL;
 class CRingItem;
+class CCompressedSegmentReader;
 struct _RingItemHeader;
 
 /*!
@@ -35,6 +36,9 @@ struct _RingItemHeader;
   an event file to stdout.  The data source returns sequential ring items
   that are not in the excluded set of data types.
 
+  Block compressed segments (see CompressedSegment.h) are recognized by
+  their first bytes and decompressed transparently.
+
 */
 
 class CFileDataSource : public CDataSource
@@ -45,6 +49,10 @@ private:
   int                  m_fd;	  // File descriptor open on the event source.
   std::set<uint16_t>   m_exclude; // item types to exclude from the return set.
   URL&                 m_url;	  // URI that points to the file.
+  bool                 m_formatKnown;  // Compressed or not has been determined.
+  CCompressedSegmentReader* m_pDecompressor; // Non null for compressed files.
+  uint8_t              m_peeked[8];    // Bytes read to determine the format...
+  size_t               m_nPeeked;      // ...that have not been consumed.
 
   // Constructors and other canonicals:
 
@@ -65,6 +73,7 @@ public:
   virtual CRingItem* getItem();
 
   void read(char* pBuffer, size_t nBytes);
+  size_t readBlock(char* pBuffer, size_t nBytes);
 
   // utilities:
 
@@ -73,6 +82,8 @@ private:
   bool       acceptable(CRingItem* item) const;
   void       openFile();
   uint32_t   getItemSize(_RingItemHeader& header);
+  size_t     readBytes(void* pBuffer, size_t nBytes);
+  void       checkFormat();
 };
 
 #endif
@@ -0,0 +1,52 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CItemAnalyzer.h
+ * @brief Interface for analyzers driven by CParallelFileAnalyzer.
+ */
+
+#ifndef CITEMANALYZER_H
+#define CITEMANALYZER_H
+
+class CRingItemView;
+
+/**
+ * @class CItemAnalyzer
+ *
+ *   Abstract base class for something that accumulates information from
+ *   a stream of raw ring items.  CParallelFileAnalyzer gives each work unit
+ *   (a file or a piece of a file) its own analyzer obtained via clone() and
+ *   merges the per unit analyzers, in unit order, once all units are done.
+ *
+ *   Concrete analyzers must therefore:
+ *   - Return an analyzer with the same configuration but no accumulated
+ *     data from clone().
+ *   - Implement merge() so that merging the analyzer for the data
+ *     that follows *this gives the same result as if a single analyzer had
+ *     seen all of the data in order.
+ */
+class CItemAnalyzer
+{
+public:
+  virtual ~CItemAnalyzer() {}
+
+  virtual CItemAnalyzer* clone() const = 0;
+  virtual void analyze(const CRingItemView& item) = 0;
+  virtual void merge(const CItemAnalyzer& following) = 0;
+};
+
+#endif
@@ -0,0 +1,508 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CParallelFileAnalyzer.cpp
+ * @brief Implement the multi-threaded event file analysis driver.
+ */
+
+#include <config.h>
+#include "CParallelFileAnalyzer.h"
+#include "CItemAnalyzer.h"
+#include "CCompressedSegmentReader.h"
+
+#include <DataFormat.h>
+#include <RingItemView.h>
+#include <ErrnoException.h>
+#include <Exception.h>
+#include <io.h>
+
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <sstream>
+
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+/*----------------------------------------------------------------------------
+ * Worker threads - local to this file.
+ */
+
+namespace {
+
+/**
+ *  Work units are pulled from a shared list by incrementing an atomic
+ *  index.  Each unit has its own analyzer and error message slot so the
+ *  workers never need to lock anything.
+ *
+ *  Threads are raw pthreads rather than the Thread class because the
+ *  pool needs a join that reliably waits for the thread to exit.
+ */
+typedef struct _WorkerContext {
+  const std::vector<CParallelFileAnalyzer::WorkUnit>* s_pUnits;
+  std::vector<CItemAnalyzer*>*                        s_pAnalyzers;
+  std::vector<std::string>*                           s_pErrors;
+  std::atomic<size_t>                                 s_nextUnit;
+  size_t                                              s_bufferSize;
+} WorkerContext, *pWorkerContext;
+
+void*
+analysisWorker(void* pArg)
+{
+  pWorkerContext pContext = reinterpret_cast<pWorkerContext>(pArg);
+  const std::vector<CParallelFileAnalyzer::WorkUnit>& units(*pContext->s_pUnits);
+  std::vector<std::string>& errors(*pContext->s_pErrors);
+
+  size_t i;
+  while ((i = pContext->s_nextUnit.fetch_add(1)) < units.size()) {
+    try {
+      CParallelFileAnalyzer::processUnit(
+        units[i], *(*pContext->s_pAnalyzers)[i], pContext->s_bufferSize
+      );
+    }
+    catch (CException& e) {
+      errors[i] = e.ReasonText();
+    }
+    catch (std::exception& e) {
+      errors[i] = e.what();
+    }
+    catch (std::string msg) {
+      errors[i] = msg;
+    }
+    catch (...) {
+      errors[i] = "Unrecognized exception";
+    }
+  }
+  return 0;
+}
+
+/**
+ * Open a file or throw a CErrnoException.
+ */
+int
+openOrThrow(std::string filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::string msg = "Opening event file ";
+    msg += filename;
+    throw CErrnoException(msg);
+  }
+  return fd;
+}
+
+/**
+ * True if the file open on fd is a compressed segment.
+ */
+bool
+isCompressedFile(int fd)
+{
+  char magic[CCompressedSegmentReader::MagicSize];
+  ssize_t n = pread(fd, magic, sizeof(magic), 0);
+  return (n > 0) && CCompressedSegmentReader::isCompressed(magic, n);
+}
+
+/**
+ * Divide a compressed segment into work units that are runs of whole
+ * blocks.  Unit boundaries are block file offsets.  Without an index
+ * the file can only be read sequentially so it is one unit.
+ */
+std::vector<CParallelFileAnalyzer::WorkUnit>
+splitCompressedFile(int fd, std::string filename, off_t fileSize, off_t chunkSize)
+{
+  std::vector<CParallelFileAnalyzer::WorkUnit> result;
+  CParallelFileAnalyzer::WorkUnit unit = {filename, 0, fileSize};
+
+  CCompressedSegmentReader reader(fd);
+  if ((chunkSize == 0) || !reader.indexed()) {
+    result.push_back(unit);
+    return result;
+  }
+  const std::vector<CompressedBlockIndexEntry>& index(reader.index());
+  for (size_t i = 1; i < index.size(); i++) {
+    if (off_t(index[i].s_fileOffset) - unit.s_begin >= chunkSize) {
+      unit.s_end = index[i].s_fileOffset;
+      result.push_back(unit);
+      unit.s_begin = unit.s_end;
+    }
+  }
+  unit.s_end = fileSize;
+  result.push_back(unit);
+  return result;
+}
+
+/**
+ * Size of the item whose header is pointed to, in host byte order.
+ */
+uint32_t
+headerSize(const void* pHeader)
+{
+  return CRingItemView(pHeader).size();
+}
+
+/**
+ * A file that ends in the middle of an item (e.g. a segment that's still
+ * being written) is analyzed up to the last complete item.
+ */
+void
+warnTruncated(std::string filename)
+{
+  std::cerr << "Warning: " << filename
+            << " ends with a partial ring item, which is ignored\n";
+}
+
+/**
+ * Bytes read at a time when looking for item boundaries.
+ */
+const size_t ScanBufferSize(1024*1024);
+
+}
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *
+ * @param nThreads   - Number of worker threads to use (at least 1).
+ * @param bufferSize - Size of the read buffer each worker uses.
+ * @param chunkSize  - If nonzero, files are split into work units of
+ *                     about this many bytes.
+ */
+CParallelFileAnalyzer::CParallelFileAnalyzer(
+  unsigned nThreads, size_t bufferSize, off_t chunkSize
+) :
+  m_nThreads(nThreads ? nThreads : 1),
+  m_bufferSize(bufferSize),
+  m_chunkSize(chunkSize)
+{}
+
+/*----------------------------------------------------------------------------
+ * Public methods
+ */
+
+/**
+ * addFile
+ *   Add a file to the set to analyze.  Files are analyzed (merged) in
+ *   the order in which they are added.
+ *
+ * @param filename - path to the file.
+ */
+void
+CParallelFileAnalyzer::addFile(std::string filename)
+{
+  m_files.push_back(filename);
+}
+
+/**
+ * workUnits
+ *   @return std::vector<WorkUnit> - the units of work the files
+ *           will be broken into, in merge order.
+ */
+std::vector<CParallelFileAnalyzer::WorkUnit>
+CParallelFileAnalyzer::workUnits() const
+{
+  std::vector<WorkUnit> result;
+  for (size_t i = 0; i < m_files.size(); i++) {
+    std::vector<WorkUnit> units = splitFile(m_files[i], m_chunkSize);
+    result.insert(result.end(), units.begin(), units.end());
+  }
+  return result;
+}
+
+/**
+ * analyze
+ *   Run the analysis.
+ *
+ * @param result - Analyzer into which all of the per unit results are
+ *                 merged.  Per unit analyzers are made with result.clone().
+ *
+ * @throw std::runtime_error - if any unit failed.  The message describes
+ *        the first unit (in merge order) that failed.
+ */
+void
+CParallelFileAnalyzer::analyze(CItemAnalyzer& result)
+{
+  std::vector<WorkUnit>       units = workUnits();
+  std::vector<CItemAnalyzer*> analyzers;
+  std::vector<std::string>    errors(units.size());
+  for (size_t i = 0; i < units.size(); i++) {
+    analyzers.push_back(result.clone());
+  }
+
+  // Start the workers and wait for them all to finish.  If a thread
+  // can't be started the ones that did start pick up its share.
+
+  WorkerContext context;
+  context.s_pUnits     = &units;
+  context.s_pAnalyzers = &analyzers;
+  context.s_pErrors    = &errors;
+  context.s_nextUnit   = 0;
+  context.s_bufferSize = m_bufferSize;
+
+  std::vector<pthread_t> workers;
+  unsigned nWorkers = m_nThreads;
+  if (nWorkers > units.size()) nWorkers = units.size();
+  for (unsigned i = 0; i < nWorkers; i++) {
+    pthread_t tid;
+    if (pthread_create(&tid, 0, analysisWorker, &context) == 0) {
+      workers.push_back(tid);
+    }
+  }
+  if (workers.empty()) {
+    analysisWorker(&context);             // Do it all ourselves.
+  }
+  for (size_t i = 0; i < workers.size(); i++) {
+    pthread_join(workers[i], 0);
+  }
+
+  // Merge in order, stopping at the first failure:
+
+  std::string failure;
+  for (size_t i = 0; i < units.size(); i++) {
+    if ((failure == "") && (errors[i] != "")) {
+      std::stringstream msg;
+      msg << "Analysis of " << units[i].s_filename << " [" << units[i].s_begin
+          << ", " << units[i].s_end << ") failed: " << errors[i];
+      failure = msg.str();
+    }
+    if (failure == "") {
+      result.merge(*analyzers[i]);
+    }
+    delete analyzers[i];
+  }
+  if (failure != "") {
+    throw std::runtime_error(failure);
+  }
+}
+
+/*----------------------------------------------------------------------------
+ * Static building blocks.
+ */
+
+/**
+ * splitFile
+ *   Divide a file into work units.
+ *
+ * @param filename  - Path to the file.
+ * @param chunkSize - Approximate unit size; 0 means the whole file is a
+ *                    single unit.
+ * @return std::vector<WorkUnit>
+ *
+ * @note Finding item boundaries requires a pass over the item headers.
+ *       The headers are picked out of large reads, items bigger than the
+ *       read buffer are hopped over by reading only their successor's
+ *       header.  A truncated last item ends the final unit at the last
+ *       complete item; a corrupt item size ends the scan and the rest of
+ *       the file goes in the last unit, where processUnit reports it.
+ * @note Compressed segments are split on block boundaries using the
+ *       block index, so no data need be decompressed.
+ */
+std::vector<CParallelFileAnalyzer::WorkUnit>
+CParallelFileAnalyzer::splitFile(std::string filename, off_t chunkSize)
+{
+  std::vector<WorkUnit> result;
+  int fd = openOrThrow(filename);
+
+  struct stat info;
+  if (fstat(fd, &info)) {
+    close(fd);
+    throw CErrnoException("Getting event file size");
+  }
+  off_t fileSize = info.st_size;
+
+  if (isCompressedFile(fd)) {
+    try {
+      result = splitCompressedFile(fd, filename, fileSize, chunkSize);
+    }
+    catch (...) {
+      close(fd);
+      throw;
+    }
+    close(fd);
+    return result;
+  }
+
+  WorkUnit unit = {filename, 0, fileSize};
+  if (chunkSize == 0) {
+    close(fd);
+    result.push_back(unit);
+    return result;
+  }
+
+  std::vector<uint8_t> buffer(ScanBufferSize);
+  off_t    bufferOffset = 0;                    // File offset of buffer[0].
+  size_t   nInBuffer    = 0;
+  off_t    offset       = 0;
+  uint32_t size         = 0;
+  bool     corrupt      = false;
+  while (offset + off_t(sizeof(RingItemHeader)) <= fileSize) {
+    if (offset + off_t(sizeof(RingItemHeader)) > bufferOffset + off_t(nInBuffer)) {
+      size_t nRead = (size > buffer.size()) ? sizeof(RingItemHeader) : buffer.size();
+      ssize_t n = pread(fd, &buffer[0], nRead, offset);
+      if (n < ssize_t(sizeof(RingItemHeader))) {
+        close(fd);
+        throw CErrnoException("Reading event file item headers");
+      }
+      bufferOffset = offset;
+      nInBuffer    = n;
+    }
+    size = headerSize(&buffer[offset - bufferOffset]);
+    if (size < sizeof(RingItemHeader)) {
+      corrupt = true;
+      break;
+    }
+    if (offset + size > fileSize) {
+      break;
+    }
+    offset += size;
+    if (offset - unit.s_begin >= chunkSize) {
+      unit.s_end = offset;
+      result.push_back(unit);
+      unit.s_begin = offset;
+    }
+  }
+  close(fd);
+
+  if (corrupt) {
+    offset = fileSize;
+  } else if (offset < fileSize) {
+    warnTruncated(filename);
+  }
+  if (offset > unit.s_begin) {
+    unit.s_end = offset;
+    result.push_back(unit);
+  }
+  return result;
+}
+
+/**
+ * processUnit
+ *   Feed all of the items in a work unit to an analyzer.  The unit is
+ *   read in bufferSize pieces; items are presented in place.  Items
+ *   bigger than the buffer cause it to grow.
+ *
+ * For compressed segments the unit's block range is decompressed and
+ * remaining counts uncompressed bytes.  An unindexed compressed segment
+ * is read until its data run out.
+ *
+ * @param unit       - Describes the file and byte range.
+ * @param analyzer   - Gets each item.
+ * @param bufferSize - Initial read buffer size.
+ *
+ * @throw CErrnoException - if the file can't be opened/read.
+ * @throw std::runtime_error - if an item has an impossible size.
+ *
+ * @note A partial item at the end of the unit can only happen at the end
+ *       of a file, see splitFile; it is warned about and ignored.
+ */
+void
+CParallelFileAnalyzer::processUnit(
+  const WorkUnit& unit, CItemAnalyzer& analyzer, size_t bufferSize
+)
+{
+  int fd = openOrThrow(unit.s_filename);
+
+  std::vector<uint8_t> buffer(bufferSize < sizeof(RingItemHeader) ?
+                              sizeof(RingItemHeader) : bufferSize);
+  off_t  remaining = unit.s_end - unit.s_begin;
+  size_t nInBuffer = 0;                         // Unconsumed bytes at front.
+  bool   bounded   = true;                      // False - read to the end.
+  std::unique_ptr<CCompressedSegmentReader> pReader;
+
+  try {
+    if (isCompressedFile(fd)) {
+      pReader.reset(new CCompressedSegmentReader(fd));
+      if (pReader->indexed()) {
+        size_t first = pReader->blockAt(unit.s_begin);
+        size_t last  = pReader->blockAt(unit.s_end);
+        pReader->seekBlock(first);
+        remaining = pReader->blockDataOffset(last) - pReader->blockDataOffset(first);
+      } else {
+        remaining = std::numeric_limits<off_t>::max();
+        bounded   = false;
+      }
+    } else if (lseek(fd, unit.s_begin, SEEK_SET) < 0) {
+      throw CErrnoException("Positioning to the start of a work unit");
+    }
+
+    while (remaining > 0 || nInBuffer > 0) {
+
+      // Top up the buffer:
+
+      size_t room  = buffer.size() - nInBuffer;
+      size_t nRead = (off_t(room) < remaining) ? room : remaining;
+      if (nRead) {
+        size_t got = pReader ? pReader->read(&buffer[nInBuffer], nRead) :
+                               io::readData(fd, &buffer[nInBuffer], nRead);
+        if (got != nRead) {
+          if (bounded) {
+            throw std::runtime_error("Unexpected end of file");
+          }
+          remaining = 0;                        // End of unindexed data.
+        } else {
+          remaining -= got;
+        }
+        nInBuffer += got;
+      }
+      // Consume the complete items:
+
+      uint8_t* p   = &buffer[0];
+      uint8_t* end = p + nInBuffer;
+      while ((end - p) >= sizeof(RingItemHeader)) {
+        CRingItemView item(p);
+        uint32_t size = item.size();
+        if (size < sizeof(RingItemHeader)) {
+          throw std::runtime_error("Ring item with an invalid size");
+        }
+        if (size > (end - p)) break;
+        analyzer.analyze(item);
+        p += size;
+      }
+      // Slide the partial item down; grow the buffer if it can't fit:
+
+      nInBuffer = end - p;
+      if (nInBuffer) {
+        memmove(&buffer[0], p, nInBuffer);
+        if (nInBuffer >= sizeof(RingItemHeader)) {
+          uint32_t size = CRingItemView(&buffer[0]).size();
+          if (size > buffer.size()) {
+            buffer.resize(size);
+          }
+        }
+        if (remaining == 0) {
+          warnTruncated(unit.s_filename);
+          break;
+        }
+      }
+    }
+  }
+  catch (...) {
+    pReader.reset();
+    close(fd);
+    throw;
+  }
+  pReader.reset();
+  close(fd);
+}
@@ -0,0 +1,80 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CParallelFileAnalyzer.h
+ * @brief Analyze event files on a pool of worker threads.
+ */
+
+#ifndef CPARALLELFILEANALYZER_H
+#define CPARALLELFILEANALYZER_H
+
+#include <vector>
+#include <string>
+#include <sys/types.h>
+#include <stddef.h>
+
+class CItemAnalyzer;
+
+/**
+ * @class CParallelFileAnalyzer
+ *
+ *   Runs a CItemAnalyzer over a set of event files (e.g. the segments of
+ *   one or more runs) using several threads.  The files are broken into
+ *   work units:
+ *   - By default each file is a work unit.
+ *   - If a chunk size is set, files are further split into byte ranges
+ *     of about that size.  Split points are always on ring item boundaries,
+ *     found by hopping from item header to item header.
+ *
+ *   Each work unit is read with large sequential reads and its items are
+ *   handed to the analyzer in place (no CRingItem objects are made).
+ *   Every unit gets its own clone of the analyzer; when all units are
+ *   done the clones are merged in file/offset order so the final result
+ *   does not depend on thread scheduling.
+ */
+class CParallelFileAnalyzer
+{
+public:
+  typedef struct _WorkUnit {
+    std::string s_filename;
+    off_t       s_begin;            // Offset of first item.
+    off_t       s_end;              // Offset just past the last item.
+  } WorkUnit, *pWorkUnit;
+
+private:
+  std::vector<std::string> m_files;
+  unsigned                 m_nThreads;
+  size_t                   m_bufferSize;
+  off_t                    m_chunkSize;
+
+public:
+  CParallelFileAnalyzer(unsigned nThreads, size_t bufferSize = 8*1024*1024,
+                        off_t chunkSize = 0);
+
+  void addFile(std::string filename);
+  void analyze(CItemAnalyzer& result);
+
+  std::vector<WorkUnit> workUnits() const;
+
+  // Building blocks, public so they can be tested independently:
+
+  static std::vector<WorkUnit> splitFile(std::string filename, off_t chunkSize);
+  static void processUnit(const WorkUnit& unit, CItemAnalyzer& analyzer,
+                          size_t bufferSize);
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CompressedSegment.h
+ * @brief Layout of block compressed event segment files.
+ *
+ *  A compressed segment is:
+ *  - A CompressedSegmentHeader.
+ *  - Any number of blocks.  Each is a CompressedBlockHeader followed by
+ *    s_compressedSize bytes of zlib data that inflate to s_size bytes of
+ *    complete ring items (items never span blocks).
+ *  - A CompressedBlockHeader with s_size == 0 that ends the blocks.
+ *  - The block index; one CompressedBlockIndexEntry per block.
+ *  - A CompressedSegmentTrailer.
+ *
+ *  Offsets are relative to the start of the segment header.  Everything is
+ *  in the byte order of the writing system, as ring items are.  A file
+ *  whose writer never finished (e.g. a crash) has no terminator, index or
+ *  trailer; its blocks can still be read sequentially.
+ */
+#ifndef COMPRESSEDSEGMENT_H
+#define COMPRESSEDSEGMENT_H
+
+#include <stdint.h>
+
+#define COMPRESSED_SEGMENT_MAGIC   "NSCLZSEG"   /* 8 chars, no null. */
+#define COMPRESSED_SEGMENT_VERSION 1
+#define COMPRESSED_BLOCK_MAGIC     0x4b4c425a   /* "ZBLK" */
+#define COMPRESSED_TRAILER_MAGIC   "NSCLZIDX"
+
+typedef struct _CompressedSegmentHeader {
+  char     s_magic[8];          // COMPRESSED_SEGMENT_MAGIC.
+  uint32_t s_version;
+  uint32_t s_blockSize;         // Nominal uncompressed block size.
+} CompressedSegmentHeader, *pCompressedSegmentHeader;
+
+typedef struct _CompressedBlockHeader {
+  uint32_t s_magic;             // COMPRESSED_BLOCK_MAGIC.
+  uint32_t s_compressedSize;
+  uint32_t s_size;              // Uncompressed; 0 ends the blocks.
+  uint32_t s_itemCount;
+} CompressedBlockHeader, *pCompressedBlockHeader;
+
+typedef struct _CompressedBlockIndexEntry {
+  uint64_t s_fileOffset;        // Where the block header is.
+  uint64_t s_dataOffset;        // Uncompressed offset of the block's data.
+  uint64_t s_firstItem;         // Number of the first item in the block.
+} CompressedBlockIndexEntry, *pCompressedBlockIndexEntry;
+
+typedef struct _CompressedSegmentTrailer {
+  uint64_t s_indexOffset;
+  uint64_t s_blockCount;
+  uint64_t s_itemCount;
+  uint64_t s_dataSize;          // Total uncompressed bytes.
+  char     s_magic[8];          // COMPRESSED_TRAILER_MAGIC.
+} CompressedSegmentTrailer, *pCompressedSegmentTrailer;
+
+#endif
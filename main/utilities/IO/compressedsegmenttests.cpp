@@ -0,0 +1,367 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "CCompressedSegmentWriter.h"
+#include "CCompressedSegmentReader.h"
+#include "CFileDataSource.h"
+#include "CParallelFileAnalyzer.h"
+#include "CItemAnalyzer.h"
+
+#include <DataFormat.h>
+#include <RingItemView.h>
+#include <CRingItem.h>
+#include <URL.h>
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Analyzer that remembers the size and type of each item it saw.
+
+class ItemListAnalyzer : public CItemAnalyzer
+{
+public:
+  std::vector<uint32_t> m_items;
+public:
+  virtual CItemAnalyzer* clone() const { return new ItemListAnalyzer; }
+  virtual void analyze(const CRingItemView& item) {
+    m_items.push_back((item.type() << 16) | item.size());
+  }
+  virtual void merge(const CItemAnalyzer& following) {
+    const ItemListAnalyzer& f = dynamic_cast<const ItemListAnalyzer&>(following);
+    m_items.insert(m_items.end(), f.m_items.begin(), f.m_items.end());
+  }
+};
+
+
+class CompressedSegmentTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(CompressedSegmentTests);
+  CPPUNIT_TEST(roundTrip);
+  CPPUNIT_TEST(index);
+  CPPUNIT_TEST(seekItem);
+  CPPUNIT_TEST(seekBlock);
+  CPPUNIT_TEST(unfinished);
+  CPPUNIT_TEST(notCompressed);
+  CPPUNIT_TEST(dataSourceUrl);
+  CPPUNIT_TEST(dataSourcePipe);
+  CPPUNIT_TEST(dataSourceUncompressed);
+  CPPUNIT_TEST(parallelAnalysis);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  std::string          m_filename;
+  std::vector<uint8_t> m_raw;             // Uncompressed contents.
+  std::vector<size_t>  m_offsets;         // Offset of each item in m_raw.
+
+public:
+  void setUp() {
+    char name[] = "/tmp/compressedsegmentXXXXXX";
+    int fd = mkstemp(name);
+    close(fd);
+    m_filename = name;
+    m_raw.clear();
+    m_offsets.clear();
+
+    // Scaler, 2000 variable sized events, scaler:
+
+    uint32_t scalers[4] = {1, 2, 3, 4};
+    addItem(formatScalerItem(4, 0, 0, 10, scalers));
+    for (uint32_t i = 0; i < 2000; i++) {
+      uint16_t body[64];
+      uint16_t nWords = 2 + 2*(i % 30);
+      for (int w = 0; w < nWords; w++) body[w] = i + w;
+      addItem(formatEventItem(nWords, body));
+    }
+    addItem(formatScalerItem(4, 0, 10, 20, scalers));
+  }
+  void tearDown() {
+    unlink(m_filename.c_str());
+  }
+protected:
+  void roundTrip();
+  void index();
+  void seekItem();
+  void seekBlock();
+  void unfinished();
+  void notCompressed();
+  void dataSourceUrl();
+  void dataSourcePipe();
+  void dataSourceUncompressed();
+  void parallelAnalysis();
+private:
+  void addItem(void* pItem) {
+    uint32_t size = reinterpret_cast<pRingItemHeader>(pItem)->s_size;
+    uint8_t* p    = reinterpret_cast<uint8_t*>(pItem);
+    m_offsets.push_back(m_raw.size());
+    m_raw.insert(m_raw.end(), p, p + size);
+    free(pItem);
+  }
+  // Write the items compressed; 4Kbyte blocks make plenty of blocks.
+
+  void writeCompressed(bool finish = true) {
+    int fd = open(m_filename.c_str(), O_WRONLY | O_TRUNC);
+    CCompressedSegmentWriter writer(fd, 4096);
+    for (size_t i = 0; i < m_offsets.size(); i++) {
+      CRingItemView item(&m_raw[m_offsets[i]]);
+      writer.write(&m_raw[m_offsets[i]], item.size());
+    }
+    if (finish) {
+      writer.finish();
+    } else {
+      writer.flush();
+    }
+    close(fd);
+  }
+  void writeRaw() {
+    int fd = open(m_filename.c_str(), O_WRONLY | O_TRUNC);
+    CPPUNIT_ASSERT_EQUAL(ssize_t(m_raw.size()), write(fd, &m_raw[0], m_raw.size()));
+    close(fd);
+  }
+  std::vector<uint8_t> readAll(CCompressedSegmentReader& reader) {
+    std::vector<uint8_t> result(m_raw.size() + 100);
+    size_t n = reader.read(&result[0], result.size());
+    result.resize(n);
+    return result;
+  }
+  void checkItem(const uint8_t* pItem, size_t i) {
+    CRingItemView item(pItem);
+    CPPUNIT_ASSERT_EQUAL(CRingItemView(&m_raw[m_offsets[i]]).size(), item.size());
+    CPPUNIT_ASSERT(memcmp(pItem, &m_raw[m_offsets[i]], item.size()) == 0);
+  }
+  void checkSource(CFileDataSource& source) {
+    for (size_t i = 0; i < m_offsets.size(); i++) {
+      CRingItem* pItem = source.getItem();
+      CPPUNIT_ASSERT(pItem);
+      checkItem(reinterpret_cast<uint8_t*>(pItem->getItemPointer()), i);
+      delete pItem;
+    }
+    CPPUNIT_ASSERT(source.getItem() == 0);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CompressedSegmentTests);
+
+// What goes in comes out.
+
+void CompressedSegmentTests::roundTrip()
+{
+  writeCompressed();
+
+  struct stat info;
+  stat(m_filename.c_str(), &info);
+  CPPUNIT_ASSERT(off_t(m_raw.size()) > info.st_size);
+
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  {
+    CCompressedSegmentReader reader(fd);
+    std::vector<uint8_t> data = readAll(reader);
+    CPPUNIT_ASSERT_EQUAL(m_raw.size(), data.size());
+    CPPUNIT_ASSERT(data == m_raw);
+
+    uint8_t byte;
+    CPPUNIT_ASSERT_EQUAL(size_t(0), reader.read(&byte, 1));
+  }
+  close(fd);
+}
+// The index describes the blocks and totals.
+
+void CompressedSegmentTests::index()
+{
+  writeCompressed();
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  {
+    CCompressedSegmentReader reader(fd);
+    CPPUNIT_ASSERT(reader.indexed());
+    CPPUNIT_ASSERT(reader.blockCount() > 10);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(m_offsets.size()), reader.itemCount());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(m_raw.size()), reader.dataSize());
+
+    const std::vector<CompressedBlockIndexEntry>& idx(reader.index());
+    CPPUNIT_ASSERT_EQUAL(uint64_t(sizeof(CompressedSegmentHeader)), idx[0].s_fileOffset);
+    CPPUNIT_ASSERT_EQUAL(uint64_t(0), idx[0].s_dataOffset);
+    for (size_t i = 0; i < idx.size(); i++) {
+      // Blocks start on items:
+
+      CPPUNIT_ASSERT_EQUAL(m_offsets[idx[i].s_firstItem], size_t(idx[i].s_dataOffset));
+      CPPUNIT_ASSERT_EQUAL(i, reader.blockAt(idx[i].s_fileOffset));
+      if (i) {
+        CPPUNIT_ASSERT(idx[i].s_fileOffset > idx[i-1].s_fileOffset);
+        CPPUNIT_ASSERT_EQUAL(i, reader.blockAt(idx[i-1].s_fileOffset + 1));
+      }
+    }
+    CPPUNIT_ASSERT_EQUAL(reader.dataSize(), reader.blockDataOffset(reader.blockCount()));
+  }
+  close(fd);
+}
+// Positioning at an item.
+
+void CompressedSegmentTests::seekItem()
+{
+  writeCompressed();
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  {
+    CCompressedSegmentReader reader(fd);
+    size_t items[] = {1500, 0, 1, 777, 2001};
+    for (int i = 0; i < sizeof(items)/sizeof(size_t); i++) {
+      size_t item = items[i];
+      reader.seekItem(item);
+      std::vector<uint8_t> data = readAll(reader);
+      CPPUNIT_ASSERT_EQUAL(m_raw.size() - m_offsets[item], data.size());
+      checkItem(&data[0], item);
+    }
+    reader.seekItem(m_offsets.size());
+    uint8_t byte;
+    CPPUNIT_ASSERT_EQUAL(size_t(0), reader.read(&byte, 1));
+  }
+  close(fd);
+}
+// Positioning at a block.
+
+void CompressedSegmentTests::seekBlock()
+{
+  writeCompressed();
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  {
+    CCompressedSegmentReader reader(fd);
+    size_t block = reader.blockCount()/2;
+    reader.seekBlock(block);
+
+    uint8_t header[sizeof(RingItemHeader)];
+    CPPUNIT_ASSERT_EQUAL(sizeof(header), reader.read(header, sizeof(header)));
+    CPPUNIT_ASSERT(memcmp(header, &m_raw[reader.blockDataOffset(block)], sizeof(header)) == 0);
+
+    reader.seekBlock(reader.blockCount());
+    CPPUNIT_ASSERT_EQUAL(size_t(0), reader.read(header, sizeof(header)));
+
+    CPPUNIT_ASSERT_THROW(reader.seekBlock(reader.blockCount() + 1), std::out_of_range);
+  }
+  close(fd);
+}
+// A segment whose writer never finished can be read but not positioned.
+
+void CompressedSegmentTests::unfinished()
+{
+  writeCompressed(false);
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  {
+    CCompressedSegmentReader reader(fd);
+    CPPUNIT_ASSERT(!reader.indexed());
+    CPPUNIT_ASSERT_THROW(reader.seekBlock(0), std::runtime_error);
+
+    std::vector<uint8_t> data = readAll(reader);
+    CPPUNIT_ASSERT(data == m_raw);
+  }
+  close(fd);
+}
+// Ordinary event files are not mistaken for compressed ones.
+
+void CompressedSegmentTests::notCompressed()
+{
+  CPPUNIT_ASSERT(!CCompressedSegmentReader::isCompressed(&m_raw[0], m_raw.size()));
+  CPPUNIT_ASSERT(CCompressedSegmentReader::isCompressed(COMPRESSED_SEGMENT_MAGIC, 8));
+  CPPUNIT_ASSERT(!CCompressedSegmentReader::isCompressed(COMPRESSED_SEGMENT_MAGIC, 7));
+
+  writeRaw();
+  int fd = open(m_filename.c_str(), O_RDONLY);
+  CPPUNIT_ASSERT_THROW(CCompressedSegmentReader reader(fd), std::runtime_error);
+  close(fd);
+}
+// The file data source reads compressed files transparently.
+
+void CompressedSegmentTests::dataSourceUrl()
+{
+  writeCompressed();
+  URL uri(std::string("file://") + m_filename);
+  std::vector<uint16_t> exclude;
+  CFileDataSource source(uri, exclude);
+  checkSource(source);
+}
+// ...even when they come down a pipe (e.g. stdin).
+
+void CompressedSegmentTests::dataSourcePipe()
+{
+  writeCompressed();
+  int fds[2];
+  CPPUNIT_ASSERT_EQUAL(0, pipe(fds));
+  pid_t child = fork();
+  if (child == 0) {
+    close(fds[0]);
+    int fd = open(m_filename.c_str(), O_RDONLY);
+    char buffer[1000];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+      if (write(fds[1], buffer, n) != n) break;
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  {
+    std::vector<uint16_t> exclude;
+    CFileDataSource source(fds[0], exclude);  // Closes fds[0].
+    checkSource(source);
+  }
+  int status;
+  waitpid(child, &status, 0);
+}
+// Uncompressed files still read as they always have.
+
+void CompressedSegmentTests::dataSourceUncompressed()
+{
+  writeRaw();
+  URL uri(std::string("file://") + m_filename);
+  std::vector<uint16_t> exclude;
+  CFileDataSource source(uri, exclude);
+  checkSource(source);
+}
+// Compressed files are split on block boundaries for parallel analysis.
+
+void CompressedSegmentTests::parallelAnalysis()
+{
+  writeRaw();
+  ItemListAnalyzer expected;
+  CParallelFileAnalyzer serial(1);
+  serial.addFile(m_filename);
+  serial.analyze(expected);
+  CPPUNIT_ASSERT_EQUAL(m_offsets.size(), expected.m_items.size());
+
+  writeCompressed();
+  struct stat info;
+  stat(m_filename.c_str(), &info);
+
+  std::vector<CParallelFileAnalyzer::WorkUnit> units =
+    CParallelFileAnalyzer::splitFile(m_filename, 8192);
+  CPPUNIT_ASSERT(units.size() > 1);
+  CPPUNIT_ASSERT_EQUAL(off_t(0), units[0].s_begin);
+  CPPUNIT_ASSERT_EQUAL(info.st_size, units.back().s_end);
+  for (size_t i = 1; i < units.size(); i++) {
+    CPPUNIT_ASSERT_EQUAL(units[i-1].s_end, units[i].s_begin);
+  }
+
+  ItemListAnalyzer result;
+  CParallelFileAnalyzer parallel(4, 1024, 8192);
+  parallel.addFile(m_filename);
+  parallel.analyze(result);
+  CPPUNIT_ASSERT(result.m_items == expected.m_items);
+}
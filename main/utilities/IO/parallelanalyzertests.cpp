@@ -0,0 +1,257 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "CParallelFileAnalyzer.h"
+#include "CItemAnalyzer.h"
+
+#include <DataFormat.h>
+#include <RingItemView.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// Analyzer that just remembers the sequence of items it saw.
+
+class SequenceAnalyzer : public CItemAnalyzer
+{
+public:
+  std::vector<uint32_t> m_sequence;      // event sequence numbers/types.
+public:
+  virtual CItemAnalyzer* clone() const { return new SequenceAnalyzer; }
+  virtual void analyze(const CRingItemView& item) {
+    if (item.type() == PHYSICS_EVENT) {
+      const uint32_t* p =
+        reinterpret_cast<const uint32_t*>(item.getBodyPointer());
+      m_sequence.push_back(p[1]);
+    } else {
+      m_sequence.push_back(0x80000000 | item.type());
+    }
+  }
+  virtual void merge(const CItemAnalyzer& following) {
+    const SequenceAnalyzer& f = dynamic_cast<const SequenceAnalyzer&>(following);
+    m_sequence.insert(m_sequence.end(), f.m_sequence.begin(), f.m_sequence.end());
+  }
+};
+
+
+class ParallelAnalyzerTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ParallelAnalyzerTests);
+  CPPUNIT_TEST(wholeFile);
+  CPPUNIT_TEST(splitBoundaries);
+  CPPUNIT_TEST(smallBuffer);
+  CPPUNIT_TEST(threadsMatchSerial);
+  CPPUNIT_TEST(badFile);
+  CPPUNIT_TEST(truncatedFile);
+  CPPUNIT_TEST(bigItems);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  std::string m_filename;
+  std::vector<off_t> m_boundaries;        // offsets of each item.
+  size_t      m_nItems;
+
+public:
+  void setUp() {
+    char name[] = "/tmp/parallelanalyzerXXXXXX";
+    int fd = mkstemp(name);
+    m_filename = name;
+    m_boundaries.clear();
+    off_t offset = 0;
+
+    // Scaler, 1000 variable sized events, scaler:
+
+    uint32_t scalers[4] = {1, 2, 3, 4};
+    writeItem(fd, formatScalerItem(4, 0, 0, 10, scalers), offset);
+    for (uint32_t i = 0; i < 1000; i++) {
+      uint16_t body[64];
+      uint16_t nWords = 2 + 2*(i % 30);
+      memcpy(body, &i, sizeof(i));
+      pPhysicsEventItem pEvent = formatEventItem(nWords, body);
+      writeItem(fd, pEvent, offset);
+    }
+    writeItem(fd, formatScalerItem(4, 0, 10, 20, scalers), offset);
+    m_nItems = 1002;
+
+    close(fd);
+  }
+  void tearDown() {
+    unlink(m_filename.c_str());
+  }
+protected:
+  void wholeFile();
+  void splitBoundaries();
+  void smallBuffer();
+  void threadsMatchSerial();
+  void badFile();
+  void truncatedFile();
+  void bigItems();
+private:
+  void writeItem(int fd, void* pItem, off_t& offset) {
+    uint32_t size = reinterpret_cast<pRingItemHeader>(pItem)->s_size;
+    m_boundaries.push_back(offset);
+    ssize_t n = write(fd, pItem, size);
+    CPPUNIT_ASSERT_EQUAL(ssize_t(size), n);
+    offset += size;
+    free(pItem);
+  }
+  void checkSequence(const SequenceAnalyzer& a) {
+    CPPUNIT_ASSERT_EQUAL(m_nItems, a.m_sequence.size());
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0x80000000 | PERIODIC_SCALERS), a.m_sequence[0]);
+    for (uint32_t i = 0; i < 1000; i++) {
+      CPPUNIT_ASSERT_EQUAL(i, a.m_sequence[i+1]);
+    }
+    CPPUNIT_ASSERT_EQUAL(uint32_t(0x80000000 | PERIODIC_SCALERS), a.m_sequence[1001]);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ParallelAnalyzerTests);
+
+// No chunk size means one unit for the whole file.
+
+void ParallelAnalyzerTests::wholeFile()
+{
+  std::vector<CParallelFileAnalyzer::WorkUnit> units =
+    CParallelFileAnalyzer::splitFile(m_filename, 0);
+  CPPUNIT_ASSERT_EQUAL(size_t(1), units.size());
+  CPPUNIT_ASSERT_EQUAL(off_t(0), units[0].s_begin);
+
+  SequenceAnalyzer a;
+  CParallelFileAnalyzer::processUnit(units[0], a, 1024*1024);
+  checkSequence(a);
+}
+// Splits land on item boundaries and cover the file with no gaps.
+
+void ParallelAnalyzerTests::splitBoundaries()
+{
+  std::vector<CParallelFileAnalyzer::WorkUnit> units =
+    CParallelFileAnalyzer::splitFile(m_filename, 1000);
+  CPPUNIT_ASSERT(units.size() > 10);
+
+  off_t expected = 0;
+  for (size_t i = 0; i < units.size(); i++) {
+    CPPUNIT_ASSERT_EQUAL(expected, units[i].s_begin);
+    CPPUNIT_ASSERT(units[i].s_end > units[i].s_begin);
+    CPPUNIT_ASSERT(std::find(m_boundaries.begin(), m_boundaries.end(),
+                             units[i].s_begin) != m_boundaries.end());
+    expected = units[i].s_end;
+  }
+  struct stat info;
+  stat(m_filename.c_str(), &info);
+  CPPUNIT_ASSERT_EQUAL(info.st_size, expected);
+}
+// Buffers smaller than an item must grow rather than fail.
+
+void ParallelAnalyzerTests::smallBuffer()
+{
+  std::vector<CParallelFileAnalyzer::WorkUnit> units =
+    CParallelFileAnalyzer::splitFile(m_filename, 0);
+  SequenceAnalyzer a;
+  CParallelFileAnalyzer::processUnit(units[0], a, 10);
+  checkSequence(a);
+}
+// Many chunks over several threads give the serial result.
+
+void ParallelAnalyzerTests::threadsMatchSerial()
+{
+  CParallelFileAnalyzer serial(1);
+  serial.addFile(m_filename);
+  SequenceAnalyzer s;
+  serial.analyze(s);
+  checkSequence(s);
+
+  CParallelFileAnalyzer parallel(4, 256, 512);
+  parallel.addFile(m_filename);
+  parallel.addFile(m_filename);
+  SequenceAnalyzer p;
+  parallel.analyze(p);
+
+  CPPUNIT_ASSERT_EQUAL(2*m_nItems, p.m_sequence.size());
+  CPPUNIT_ASSERT(std::equal(s.m_sequence.begin(), s.m_sequence.end(),
+                            p.m_sequence.begin()));
+  CPPUNIT_ASSERT(std::equal(s.m_sequence.begin(), s.m_sequence.end(),
+                            p.m_sequence.begin() + m_nItems));
+}
+// Failures in a unit are reported.
+
+void ParallelAnalyzerTests::badFile()
+{
+  int fd = open(m_filename.c_str(), O_WRONLY);
+  uint32_t badSize = 2;
+  pwrite(fd, &badSize, sizeof(badSize), m_boundaries[10]);
+  close(fd);
+
+  CParallelFileAnalyzer::WorkUnit unit = {m_filename, 0, m_boundaries[20]};
+  SequenceAnalyzer a;
+  CPPUNIT_ASSERT_THROW(
+    CParallelFileAnalyzer::processUnit(unit, a, 1024), std::runtime_error
+  );
+  CParallelFileAnalyzer chunked(2, 1024, 256);
+  chunked.addFile(m_filename);
+  CPPUNIT_ASSERT_THROW(chunked.analyze(a), std::runtime_error);
+}
+// A partial item at the end of a file is ignored whether or not the file
+// is split.
+
+void ParallelAnalyzerTests::truncatedFile()
+{
+  int fd = open(m_filename.c_str(), O_WRONLY | O_APPEND);
+  uint32_t partial[3] = {100, PHYSICS_EVENT, 0};
+  write(fd, partial, sizeof(partial));
+  close(fd);
+
+  CParallelFileAnalyzer whole(1);
+  whole.addFile(m_filename);
+  SequenceAnalyzer w;
+  whole.analyze(w);
+  checkSequence(w);
+
+  CParallelFileAnalyzer chunked(4, 256, 512);
+  chunked.addFile(m_filename);
+  SequenceAnalyzer c;
+  chunked.analyze(c);
+  checkSequence(c);
+}
+// Items bigger than the header scan buffer are split on properly.
+
+void ParallelAnalyzerTests::bigItems()
+{
+  int fd = open(m_filename.c_str(), O_WRONLY | O_TRUNC);
+  m_boundaries.clear();
+  off_t offset = 0;
+  std::vector<uint16_t> body(1024*1024);
+  for (uint32_t i = 0; i < 5; i++) {
+    memcpy(body.data(), &i, sizeof(i));
+    writeItem(fd, formatEventItem(body.size() - i*1000, body.data()), offset);
+  }
+  close(fd);
+
+  std::vector<CParallelFileAnalyzer::WorkUnit> units =
+    CParallelFileAnalyzer::splitFile(m_filename, 1);
+  CPPUNIT_ASSERT_EQUAL(size_t(5), units.size());
+  for (size_t i = 0; i < units.size(); i++) {
+    CPPUNIT_ASSERT_EQUAL(m_boundaries[i], units[i].s_begin);
+  }
+  CPPUNIT_ASSERT_EQUAL(offset, units[4].s_end);
+}
@@ -24,8 +24,17 @@ namespace DAQ {
     ///////////////////////////////////////////////////////////////////////////
     // C10p0to11p0MediatorCreator IMplementation
 
+    C10p0to11p0MediatorCreator::C10p0to11p0MediatorCreator(unsigned nThreads,
+                                                           size_t batchBytes)
+      : m_nThreads(nThreads), m_batchBytes(batchBytes)
+    {
+    }
+
     std::unique_ptr<CBaseMediator> C10p0to11p0MediatorCreator::operator ()() const {
-      return std::unique_ptr<CBaseMediator>(new C10p0to11p0Mediator());
+      return std::unique_ptr<CBaseMediator>(
+            new C10p0to11p0Mediator(std::unique_ptr<CDataSource>(),
+                                    std::unique_ptr<CDataSink>(),
+                                    m_nThreads, m_batchBytes));
     }
 
 
@@ -36,10 +45,23 @@ namespace DAQ {
 
     //
     C10p0to11p0Mediator::C10p0to11p0Mediator(std::unique_ptr<CDataSource> source,
-                                           std::unique_ptr<CDataSink> sink)
+                                           std::unique_ptr<CDataSink> sink,
+                                           unsigned nThreads,
+                                           size_t batchBytes)
       : CBaseMediator(std::unique_ptr<CDataSource>(), std::unique_ptr<CDataSink>()),
-        m_mediator(std::move(source), std::move(sink))
+        m_pMediator()
     {
+      if (nThreads) {
+        m_pMediator.reset(
+              new CBulkTransformMediator<CBulkTransform10p0to11p0>(std::move(source),
+                                                                   std::move(sink),
+                                                                   nThreads,
+                                                                   batchBytes));
+      } else {
+        m_pMediator.reset(
+              new CTransformMediator<CTransform10p0to11p0>(std::move(source),
+                                                           std::move(sink)));
+      }
     }
 
 
@@ -49,13 +71,13 @@ namespace DAQ {
 
       outputRingFormat();
 
-      m_mediator.mainLoop();
+      m_pMediator->mainLoop();
     }
 
     //
     void C10p0to11p0Mediator::outputRingFormat()
     {
-      CDataSink& sink = *m_mediator.getDataSink();
+      CDataSink& sink = *m_pMediator->getDataSink();
       sink << V11::CDataFormatItem();
     }
 
@@ -22,6 +22,8 @@
 #include <CTransformFactory.h>
 #include <CTransformMediator.h>
 #include <CTransform10p0to11p0.h>
+#include <CBulkTransformMediator.h>
+#include <CBulkTransform10p0to11p0.h>
 #include <memory>
 
 
@@ -35,7 +37,18 @@ namespace DAQ {
      * \brief The C10p0to11p0MediatorCreator class
      */
     class C10p0to11p0MediatorCreator : public CTransformCreator {
+      unsigned m_nThreads;
+      size_t   m_batchBytes;
+
     public:
+      /*!
+       * \param nThreads   - if nonzero, the bulk transform is used with
+       *                     this many batches in flight.
+       * \param batchBytes - size of the bulk transform batches.
+       */
+      C10p0to11p0MediatorCreator(unsigned nThreads = 0,
+                                 size_t batchBytes = 4*1024*1024);
+
       std::unique_ptr<CBaseMediator> operator()() const;
     };
 
@@ -47,10 +60,14 @@ namespace DAQ {
      * before entering the main loop. It is just a decorator pattern on top
      * of a standard CTransformMediator.
      *
+     * If constructed with a nonzero thread count, the mediator decorated
+     * is a CBulkTransformMediator rather than a CTransformMediator. The
+     * output is the same; the bulk mediator is just much faster on files.
+     *
      */
     class C10p0to11p0Mediator : public CBaseMediator
     {
-      CTransformMediator<CTransform10p0to11p0> m_mediator; // actual mediator
+      std::unique_ptr<CBaseMediator> m_pMediator; // actual mediator
 
     public:
       /*!
@@ -60,28 +77,33 @@ namespace DAQ {
        *
        * \param source data source
        * \param sink   data sink
+       * \param nThreads   0 for item by item transforms, otherwise the number
+       *                   of batches to transform at once.
+       * \param batchBytes size of bulk transform batches.
        */
       C10p0to11p0Mediator(std::unique_ptr<CDataSource> source = std::unique_ptr<CDataSource>(),
-                         std::unique_ptr<CDataSink> sink = std::unique_ptr<CDataSink>());
+                         std::unique_ptr<CDataSink> sink = std::unique_ptr<CDataSink>(),
+                         unsigned nThreads = 0,
+                         size_t batchBytes = 4*1024*1024);
 
       /*!
        * \brief mainLoop
        *
-       *  OUtputs a ring data format item and then calls the main loop of the m_mediator
+       *  OUtputs a ring data format item and then calls the main loop of the decorated mediator
        */
       virtual void mainLoop();
 
-      virtual void initialize() { m_mediator.initialize();}
-      virtual void finalize() { m_mediator.finalize();}
+      virtual void initialize() { m_pMediator->initialize();}
+      virtual void finalize() { m_pMediator->finalize();}
 
-      virtual CDataSource* getDataSource() { return m_mediator.getDataSource(); }
-      virtual CDataSink*   getDataSink()   { return m_mediator.getDataSink(); }
+      virtual CDataSource* getDataSource() { return m_pMediator->getDataSource(); }
+      virtual CDataSink*   getDataSink()   { return m_pMediator->getDataSink(); }
 
       virtual void setDataSource(std::unique_ptr<CDataSource> &pSource)
-      { m_mediator.setDataSource(pSource); }
+      { m_pMediator->setDataSource(pSource); }
 
       virtual void setDataSink(std::unique_ptr<CDataSink> &pSink)
-      { m_mediator.setDataSink(pSink); }
+      { m_pMediator->setDataSink(pSink); }
 
     private:
 
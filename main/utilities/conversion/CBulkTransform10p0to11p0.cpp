@@ -0,0 +1,166 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Jeromy Tompkins
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <CBulkTransform10p0to11p0.h>
+#include <CBulkTransformMediator.h>
+#include <CTransform10p0to11p0.h>
+
+#include <V10/CRingItem.h>
+#include <V11/CRingItem.h>
+#include <V10/DataFormatV10.h>
+#include <V11/DataFormatV11.h>
+
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+
+using namespace std;
+
+namespace DAQ {
+  namespace Transform {
+
+    //
+    void
+    CBulkTransform10p0to11p0::operator()(CConversionBatch& batch) const
+    {
+      const char* p   = batch.s_input.data();
+      const char* end = p + batch.s_input.size();
+
+      // 11.0 items are at most a body header bigger than 10.0 items:
+
+      batch.s_output.clear();
+      batch.s_output.reserve(batch.s_input.size() + batch.s_input.size()/4);
+
+      while (p < end) {
+        if (size_t(end - p) < sizeof(V10::RingItemHeader)) {
+          throw std::runtime_error("CBulkTransform10p0to11p0::operator() Truncated ring item header");
+        }
+        uint32_t size = reinterpret_cast<const V10::RingItemHeader*>(p)->s_size;
+        if ((size < sizeof(V10::RingItemHeader)) || (size > size_t(end - p))) {
+          throw std::runtime_error("CBulkTransform10p0to11p0::operator() Invalid ring item size");
+        }
+
+        try {
+          transformItem(p, batch.s_output);
+        } catch (std::exception& exc) {
+          batch.s_messages.push_back(exc.what());
+        } catch (...) {
+          batch.s_messages.push_back("Caught an error");
+        }
+        p += size;
+      }
+    }
+
+    //
+    void
+    CBulkTransform10p0to11p0::transformItem(const char* pItem, vector<char>& output) const
+    {
+      switch (reinterpret_cast<const V10::RingItemHeader*>(pItem)->s_type) {
+        case V10::PHYSICS_EVENT:
+          transformPhysicsEvent(pItem, output);
+          break;
+        case V10::EVB_FRAGMENT:
+          if (! transformFragment(pItem, output)) {
+            transformGeneric(pItem, output);
+          }
+          break;
+        default:
+          transformGeneric(pItem, output);
+          break;
+      }
+    }
+
+    // Header, empty body header and the body copied unchanged.
+    //
+    void
+    CBulkTransform10p0to11p0::transformPhysicsEvent(const char* pItem,
+                                                    vector<char>& output) const
+    {
+      const V10::RingItemHeader* pHeader10
+          = reinterpret_cast<const V10::RingItemHeader*>(pItem);
+      size_t   bodySize = pHeader10->s_size - sizeof(V10::RingItemHeader);
+      uint32_t newSize  = sizeof(V11::RingItemHeader) + sizeof(uint32_t) + bodySize;
+
+      size_t offset = output.size();
+      output.resize(offset + newSize);
+
+      V11::pPhysicsEventItem pItem11
+          = reinterpret_cast<V11::pPhysicsEventItem>(&output[offset]);
+      pItem11->s_header.s_size                = newSize;
+      pItem11->s_header.s_type                = V11::PHYSICS_EVENT;
+      pItem11->s_body.u_noBodyHeader.s_mbz    = 0;
+      memcpy(pItem11->s_body.u_noBodyHeader.s_body,
+             pItem + sizeof(V10::RingItemHeader), bodySize);
+    }
+
+    // The fragment header becomes a body header, the payload is copied
+    // unchanged. Returns false if the payload size does not agree with the
+    // item size; the generic transform reproduces the old behavior for those.
+    //
+    bool
+    CBulkTransform10p0to11p0::transformFragment(const char* pItem,
+                                                vector<char>& output) const
+    {
+      const V10::EventBuilderFragment* pFrag10
+          = reinterpret_cast<const V10::EventBuilderFragment*>(pItem);
+      size_t headerSize = offsetof(V10::EventBuilderFragment, s_body);
+      if (pFrag10->s_header.s_size < headerSize
+          || pFrag10->s_payloadSize != pFrag10->s_header.s_size - headerSize) {
+        return false;
+      }
+
+      uint32_t newSize = sizeof(V11::RingItemHeader) + sizeof(V11::BodyHeader)
+                         + pFrag10->s_payloadSize;
+
+      size_t offset = output.size();
+      output.resize(offset + newSize);
+
+      V11::pEventBuilderFragment pFrag11
+          = reinterpret_cast<V11::pEventBuilderFragment>(&output[offset]);
+      pFrag11->s_header.s_size           = newSize;
+      pFrag11->s_header.s_type           = V11::EVB_FRAGMENT;
+      pFrag11->s_bodyHeader.s_size       = sizeof(V11::BodyHeader);
+      pFrag11->s_bodyHeader.s_timestamp  = pFrag10->s_timestamp;
+      pFrag11->s_bodyHeader.s_sourceId   = pFrag10->s_sourceId;
+      pFrag11->s_bodyHeader.s_barrier    = pFrag10->s_barrierType;
+      memcpy(pFrag11->s_body, pFrag10->s_body, pFrag10->s_payloadSize);
+
+      return true;
+    }
+
+    // Everything else goes through the item by item transform.
+    //
+    void
+    CBulkTransform10p0to11p0::transformGeneric(const char* pItem,
+                                               vector<char>& output) const
+    {
+      uint32_t size = reinterpret_cast<const V10::RingItemHeader*>(pItem)->s_size;
+
+      V10::CRingItem item10(V10::VOID, size);
+      char* pStorage = reinterpret_cast<char*>(item10.getItemPointer());
+      memcpy(pStorage, pItem, size);
+      item10.setBodyCursor(pStorage + size);
+      item10.updateSize();
+
+      V11::CRingItem item11 = CTransform10p0to11p0()(item10);
+      if (item11.type() != 0) {
+        const char* p11 = reinterpret_cast<const char*>(item11.getItemPointer());
+        output.insert(output.end(), p11, p11 + item11.size());
+      }
+    }
+
+  } // end of Transform
+} // end of DAQ
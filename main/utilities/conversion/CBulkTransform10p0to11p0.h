@@ -0,0 +1,78 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Jeromy Tompkins
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+
+#ifndef DAQ_TRANSFORM_CBULKTRANSFORM10P0TO11P0_H
+#define DAQ_TRANSFORM_CBULKTRANSFORM10P0TO11P0_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DAQ {
+  namespace Transform {
+
+    struct CConversionBatch;
+
+    /*! \brief Buffer to buffer version of CTransform10p0to11p0
+     *
+     * Transforms a batch of 10.0 ring items into 11.0 ring items working
+     * directly on the raw data:
+     *  - PHYSICS_EVENT and EVB_FRAGMENT items, which make up nearly all of
+     *    the data, are converted in place by writing the new header and
+     *    copying the body with one memcpy.
+     *  - All other items (state changes, scalers, text...) are rare. They
+     *    are wrapped in a V10::CRingItem and passed to CTransform10p0to11p0
+     *    so the rules stay in one place.
+     *
+     * The output is byte for byte what CTransformMediator<CTransform10p0to11p0>
+     * writes for the same input. Items that can't be transformed are left out
+     * and a message is recorded, as CTransformMediator prints them.
+     *
+     * The object has no state so a single instance may be used from many
+     * threads at once.
+     */
+    class CBulkTransform10p0to11p0
+    {
+    public:
+      /*!
+       * \brief Transform all items in batch.s_input into batch.s_output
+       *
+       * \throws std::runtime_error if the input does not consist of
+       *         complete ring items.
+       */
+      void operator()(CConversionBatch& batch) const;
+
+      /*!
+       * \brief Transform a single item, appending the result to output
+       *
+       * \param pItem - pointer to a complete 10.0 ring item
+       * \param output - the 11.0 item is appended to this
+       *
+       * \throws std::exception (from the item transform) on failure.
+       */
+      void transformItem(const char* pItem, std::vector<char>& output) const;
+
+    private:
+      void transformPhysicsEvent(const char* pItem, std::vector<char>& output) const;
+      bool transformFragment(const char* pItem, std::vector<char>& output) const;
+      void transformGeneric(const char* pItem, std::vector<char>& output) const;
+    };
+
+  } // end of Transform
+} // end of DAQ
+
+#endif
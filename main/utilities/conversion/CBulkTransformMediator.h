@@ -0,0 +1,119 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Jeromy Tompkins
+       NSCL
+       Michigan State University
+       East Lansing, MI 48824-1321
+*/
+
+
+#ifndef DAQ_TRANSFORM_CBULKTRANSFORMMEDIATOR_H
+#define DAQ_TRANSFORM_CBULKTRANSFORMMEDIATOR_H
+
+#include <CBaseMediator.h>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CDataSource;
+class CDataSink;
+
+namespace DAQ {
+  namespace Transform {
+
+    /*!
+     * \brief A batch of items for a bulk transform
+     *
+     * The input is a contiguous block of complete ring items exactly as
+     * they were read from the source. The bulk transform fills the output
+     * with the transformed items in the same order. Items that could not
+     * be transformed are skipped and a message is added for each of them.
+     */
+    struct CConversionBatch {
+      std::vector<char>        s_input;
+      std::vector<char>        s_output;
+      std::vector<std::string> s_messages;
+    };
+
+
+    /*! \brief A mediator that transforms large batches of items in parallel
+     *
+     *  Reading item objects one at a time and transforming them one at a time
+     *  is slow for the large archives we reprocess. This mediator reads
+     *  complete items from the source into batches of about batchBytes bytes.
+     *  Each batch is transformed on its own thread by the BulkTransform while
+     *  the next batches are read. Batches are written to the sink in the order
+     *  they were read so the output is identical to what CTransformMediator
+     *  would produce.
+     *
+     *  The BulkTransform must provide:
+     *  \code
+     *    void operator()(CConversionBatch& batch) const;
+     *  \endcode
+     *  which must be safe to call from several threads at once.
+     *
+     *  Because a batch is only written once it is full, this is meant for
+     *  file to file conversions rather than online ring buffer data.
+     */
+    template<class BulkTransform>
+    class CBulkTransformMediator : public CBaseMediator
+    {
+    private:
+      using BatchPtr = std::unique_ptr<CConversionBatch>;
+
+      BulkTransform m_transform;
+      unsigned      m_nThreads;
+      size_t        m_batchBytes;
+
+    public:
+      CBulkTransformMediator(std::unique_ptr<CDataSource> source = std::unique_ptr<CDataSource>(),
+                             std::unique_ptr<CDataSink> sink = std::unique_ptr<CDataSink>(),
+                             unsigned nThreads = 1,
+                             size_t batchBytes = 4*1024*1024,
+                             BulkTransform transform = BulkTransform());
+
+      virtual ~CBulkTransformMediator();
+
+    private:
+      CBulkTransformMediator(const CBulkTransformMediator&);
+      CBulkTransformMediator& operator=(const CBulkTransformMediator&);
+
+    public:
+      virtual void mainLoop();
+      virtual void initialize();
+      virtual void finalize();
+
+      /*!
+       * \brief Read items from the source into a batch
+       *
+       * \param batch - the input of this batch is filled
+       * \return bool - false if nothing was read (end of data).
+       */
+      bool readBatch(CConversionBatch& batch);
+
+      /*!
+       * \brief Output the messages and the transformed data of a batch
+       */
+      void writeBatch(CConversionBatch& batch);
+
+    private:
+      BatchPtr transformBatch(BatchPtr pBatch) const;
+    };
+
+  } // end of Transform
+} // end of DAQ
+
+// include the implementation
+#include <CBulkTransformMediator.hpp>
+
+#endif
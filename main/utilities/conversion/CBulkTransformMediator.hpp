@@ -0,0 +1,173 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Jeromy Tompkins
+       NSCL
+       Michigan State University
+       East Lansing, MI 48824-1321
+*/
+
+
+#include <CDataSource.h>
+#include <CDataSink.h>
+
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+
+namespace DAQ {
+  namespace Transform {
+
+/**! Constructor
+
+  \param source     the data source (ownership is transferred)
+  \param sink       the data sink (ownership is transferred)
+  \param nThreads   maximum number of batches being transformed at once
+  \param batchBytes approximate number of input bytes in a batch
+  \param transform  the bulk transform
+*/
+template<class BulkTransform>
+CBulkTransformMediator<BulkTransform>::CBulkTransformMediator(
+    std::unique_ptr<CDataSource> source,
+    std::unique_ptr<CDataSink> sink,
+    unsigned nThreads, size_t batchBytes,
+    BulkTransform transform)
+: CBaseMediator(move(source), move(sink)),
+  m_transform(transform),
+  m_nThreads(nThreads ? nThreads : 1),
+  m_batchBytes(batchBytes)
+{}
+
+template<class BulkTransform>
+CBulkTransformMediator<BulkTransform>::~CBulkTransformMediator()
+{
+}
+
+/**! The main loop
+
+  Batches are read by this thread and handed to std::async. At most
+  m_nThreads batches are in flight; once that many are outstanding the
+  oldest is waited for and written before another is read.
+*/
+template<class BulkTransform>
+void CBulkTransformMediator<BulkTransform>::mainLoop()
+{
+  if (! getDataSource()) {
+    std::string errmsg = "CBulkTransformMediator<>::mainLoop() Data source is null";
+    throw std::runtime_error(errmsg);
+  }
+  if (! getDataSink()) {
+    std::string errmsg = "CBulkTransformMediator<>::mainLoop() Data sink is null";
+    throw std::runtime_error(errmsg);
+  }
+
+  std::deque<std::future<BatchPtr> > inFlight;
+
+  BatchPtr pBatch(new CConversionBatch);
+  while (readBatch(*pBatch)) {
+    inFlight.push_back(
+      std::async(std::launch::async,
+                 &CBulkTransformMediator<BulkTransform>::transformBatch,
+                 this, std::move(pBatch))
+    );
+    pBatch.reset(new CConversionBatch);
+
+    if (inFlight.size() >= m_nThreads) {
+      BatchPtr pDone = inFlight.front().get();
+      inFlight.pop_front();
+      writeBatch(*pDone);
+    }
+  }
+
+  while (! inFlight.empty()) {
+    BatchPtr pDone = inFlight.front().get();
+    inFlight.pop_front();
+    writeBatch(*pDone);
+  }
+}
+
+template<class BulkTransform>
+void CBulkTransformMediator<BulkTransform>::initialize()
+{
+}
+
+template<class BulkTransform>
+void CBulkTransformMediator<BulkTransform>::finalize()
+{
+}
+
+//
+template<class BulkTransform>
+bool CBulkTransformMediator<BulkTransform>::readBatch(CConversionBatch& batch)
+{
+  CDataSource& source = *getDataSource();
+  std::vector<char>& input = batch.s_input;
+  input.clear();
+  input.reserve(m_batchBytes + m_batchBytes/8);
+
+  const size_t headerSize = 2*sizeof(uint32_t);
+  while (input.size() < m_batchBytes) {
+    if (source.eof()) break;
+
+    uint32_t header[2];
+    source.read(reinterpret_cast<char*>(header), headerSize);
+    if (source.eof()) break;
+
+    uint32_t totalSize = header[0];
+    if (totalSize < headerSize) {
+      throw std::runtime_error("CBulkTransformMediator<>::readBatch() Ring item with an invalid size");
+    }
+
+    // Read the item directly into the batch:
+
+    size_t offset = input.size();
+    input.resize(offset + totalSize);
+    std::memcpy(&input[offset], header, headerSize);
+    source.read(&input[offset + headerSize], totalSize - headerSize);
+    if (source.eof()) {
+      input.resize(offset);          // Partial item at the end is dropped.
+      break;
+    }
+  }
+  return ! input.empty();
+}
+
+//
+template<class BulkTransform>
+void CBulkTransformMediator<BulkTransform>::writeBatch(CConversionBatch& batch)
+{
+  for (size_t i = 0; i < batch.s_messages.size(); i++) {
+    std::cout << batch.s_messages[i] << std::endl;
+  }
+  if (! batch.s_output.empty()) {
+    getDataSink()->put(batch.s_output.data(), batch.s_output.size());
+  }
+}
+
+//
+template<class BulkTransform>
+typename CBulkTransformMediator<BulkTransform>::BatchPtr
+CBulkTransformMediator<BulkTransform>::transformBatch(BatchPtr pBatch) const
+{
+  m_transform(*pBatch);
+
+  // The input is no longer needed; give back its storage now rather
+  // than holding it until the batch is written.
+
+  std::vector<char>().swap(pBatch->s_input);
+
+  return pBatch;
+}
+
+  } // end of Transform
+} // end of DAQ
@@ -114,7 +114,9 @@ void Main::setUpTransformFactory()
   m_factory.setCreator(  10, 8,
                          unique_ptr<CTransformCreator>(new C10p0to8p0MediatorCreator()));
   m_factory.setCreator( 10, 11,
-                           unique_ptr<CTransformCreator>(new C10p0to11p0MediatorCreator()));
+                           unique_ptr<CTransformCreator>(
+                             new C10p0to11p0MediatorCreator(m_argsInfo.threads_arg,
+                                                            size_t(m_argsInfo.batch_size_arg)*1024)));
   m_factory.setCreator( 11, 10,
                            unique_ptr<CTransformCreator>(new CGenericCreator<CTransform11p0to10p0>()));
 
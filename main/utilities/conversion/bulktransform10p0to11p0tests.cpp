@@ -0,0 +1,205 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Jeromy Tompkins
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include <cppunit/Asserter.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "Asserts.h"
+
+#include <V10/CRingItem.h>
+#include <V10/CRingScalerItem.h>
+#include <V10/CRingStateChangeItem.h>
+#include <V10/CPhysicsEventItem.h>
+#include <V10/CRingPhysicsEventCountItem.h>
+#include <V10/CRingTextItem.h>
+#include <V10/CRingTimestampedRunningScalerItem.h>
+#include <V10/CRingFragmentItem.h>
+#include <V10/DataFormatV10.h>
+#include <V11/CRingItem.h>
+
+#include <CTestSourceSink.h>
+
+#include <CTransform10p0to11p0.h>
+#include <CBulkTransform10p0to11p0.h>
+#include <CBulkTransformMediator.h>
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+using namespace std;
+using namespace DAQ;
+using namespace DAQ::Transform;
+
+/*!
+ * \brief Test source that reports end of file when it runs out of data
+ */
+class CEofTestSource : public CTestSourceSink
+{
+public:
+  virtual void read(char* pBuffer, size_t nBytes) {
+    if (getBuffer().size() < nBytes) {
+      setEOF(true);
+    } else {
+      CTestSourceSink::read(pBuffer, nBytes);
+    }
+  }
+};
+
+
+class CBulkTransform10p0to11p0Tests : public CppUnit::TestFixture
+{
+public:
+    CPPUNIT_TEST_SUITE(CBulkTransform10p0to11p0Tests);
+    CPPUNIT_TEST(matchesItemTransform_0);
+    CPPUNIT_TEST(badItemReported_0);
+    CPPUNIT_TEST(truncatedInput_0);
+    CPPUNIT_TEST(mediator_0);
+    CPPUNIT_TEST(mediator_1);
+    CPPUNIT_TEST_SUITE_END();
+
+private:
+    vector<char> m_input;     // 10.0 items
+    vector<char> m_expected;  // item by item transform of m_input.
+
+public:
+    void setUp() {
+      m_input.clear();
+      m_expected.clear();
+
+      V10::CRingStateChangeItem begin(V10::BEGIN_RUN, 3, 0, 1234, "A title");
+      addItem(begin);
+
+      for (uint16_t i = 0; i < 200; i++) {
+        V10::CPhysicsEventItem event(V10::PHYSICS_EVENT);
+        vector<uint16_t> body(1 + i%40, i);
+        body[0] = body.size();
+        event.fillBody(body);
+        addItem(event);
+
+        if (i % 50 == 0) {
+          vector<uint8_t> payload(i + 1, uint8_t(i));
+          V10::CRingFragmentItem frag(1000 + i, 2, payload.size(), payload.data(), 0);
+          addItem(frag);
+
+          V10::CRingScalerItem scaler(i, i+10, 1234, {1, 2, 3, 4});
+          addItem(scaler);
+          V10::CRingTimestampedRunningScalerItem nonincr(
+                0x1234, i, i+10, 1, 1234, {5, 6, 7});
+          addItem(nonincr);
+          V10::CRingTextItem text(V10::MONITORED_VARIABLES, {"a", "bb"}, i, 1234);
+          addItem(text);
+          V10::CRingPhysicsEventCountItem count(i, i, 1234);
+          addItem(count);
+        }
+      }
+      V10::CRingStateChangeItem end(V10::END_RUN, 3, 20, 1244, "A title");
+      addItem(end);
+    }
+
+    void tearDown() {
+    }
+
+protected:
+    void matchesItemTransform_0();
+    void badItemReported_0();
+    void truncatedInput_0();
+    void mediator_0();
+    void mediator_1();
+
+private:
+    // Append the item to the input and the item by item transform of it to
+    // the expected output.
+    void addItem(const V10::CRingItem& item) {
+      const char* p = reinterpret_cast<const char*>(item.getItemPointer());
+      m_input.insert(m_input.end(), p, p + item.size());
+
+      V10::CRingItem copy(item);
+      V11::CRingItem item11 = CTransform10p0to11p0()(copy);
+      const char* p11 = reinterpret_cast<const char*>(item11.getItemPointer());
+      m_expected.insert(m_expected.end(), p11, p11 + item11.size());
+    }
+    void runMediator(unsigned nThreads, size_t batchBytes);
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CBulkTransform10p0to11p0Tests);
+
+// The bulk transform output is byte for byte the item by item output.
+void CBulkTransform10p0to11p0Tests::matchesItemTransform_0()
+{
+  CConversionBatch batch;
+  batch.s_input = m_input;
+  CBulkTransform10p0to11p0()(batch);
+
+  EQMSG("No messages", size_t(0), batch.s_messages.size());
+  EQMSG("Output size", m_expected.size(), batch.s_output.size());
+  CPPUNIT_ASSERT_MESSAGE("Output is bit exact", m_expected == batch.s_output);
+}
+
+// Items the transform does not support are left out and reported.
+void CBulkTransform10p0to11p0Tests::badItemReported_0()
+{
+  V10::CRingItem bad(V10::EVB_UNKNOWN_PAYLOAD, 16);
+  bad.setBodyCursor(reinterpret_cast<char*>(bad.getBodyPointer()) + 8);
+  bad.updateSize();
+
+  CConversionBatch batch;
+  const char* p = reinterpret_cast<const char*>(bad.getItemPointer());
+  batch.s_input.assign(p, p + bad.size());
+  batch.s_input.insert(batch.s_input.end(), m_input.begin(), m_input.end());
+
+  CBulkTransform10p0to11p0()(batch);
+
+  EQMSG("One message", size_t(1), batch.s_messages.size());
+  CPPUNIT_ASSERT_MESSAGE("Rest of the output is bit exact", m_expected == batch.s_output);
+}
+
+// Input that ends mid item is an error.
+void CBulkTransform10p0to11p0Tests::truncatedInput_0()
+{
+  CConversionBatch batch;
+  batch.s_input = m_input;
+  batch.s_input.resize(batch.s_input.size() - 2);
+
+  CPPUNIT_ASSERT_THROW(CBulkTransform10p0to11p0()(batch), std::runtime_error);
+}
+
+// Run the bulk mediator on m_input and check the sink gets m_expected.
+void CBulkTransform10p0to11p0Tests::runMediator(unsigned nThreads, size_t batchBytes)
+{
+  CEofTestSource* pSource = new CEofTestSource;
+  CTestSourceSink* pSink = new CTestSourceSink;
+  pSource->put(m_input.data(), m_input.size());
+
+  CBulkTransformMediator<CBulkTransform10p0to11p0> mediator(
+        unique_ptr<CDataSource>(pSource), unique_ptr<CDataSink>(pSink),
+        nThreads, batchBytes);
+  mediator.mainLoop();
+
+  EQMSG("Output size", m_expected.size(), pSink->getBuffer().size());
+  CPPUNIT_ASSERT_MESSAGE("Output is bit exact", m_expected == pSink->getBuffer());
+}
+
+// Single batch, single thread.
+void CBulkTransform10p0to11p0Tests::mediator_0()
+{
+  runMediator(1, 1024*1024);
+}
+
+// Many small batches on several threads come out in order.
+void CBulkTransform10p0to11p0Tests::mediator_1()
+{
+  runMediator(4, 256);
+}
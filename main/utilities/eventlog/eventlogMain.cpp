@@ -17,6 +17,7 @@
 #include <openssl/evp.h>
 #include "eventlogMain.h"
 #include "eventlogargs.h"
+#include <CCompressedSegmentWriter.h>
 
 
 
@@ -28,8 +29,10 @@
 #include <DataFormat.h>
 #include <CAllButPredicate.h>
 #include <io.h>
+#include <CPipelineTrace.h>
 
 #include <iostream>
+#include <stdexcept>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
@@ -81,12 +84,17 @@ class noData :  public CRingBuffer::CRingBufferPredicate
    m_pChecksumContext(0),
    m_nBeginsSeen(0),
    m_fChangeRunOk(false),
-   m_prefix("run")
+   m_prefix("run"),
+   m_fCompress(false),
+   m_compressionLevel(1),
+   m_pWriter(0)
  {
  }
 
  EventLogMain::~EventLogMain()
- {}
+ {
+   delete m_pWriter;
+ }
  //////////////////////////////////////////////////////////////////////////////////
  //
  // Object member functions:
@@ -120,6 +128,10 @@ class noData :  public CRingBuffer::CRingBufferPredicate
  ** Note that all files are stored in the directory pointed to by
  ** m_eventDirectory.
  **
+ ** If compression is enabled, m_pWriter is created to write the segment
+ ** as a block compressed segment.  The name does not change; readers
+ ** recognize compressed segments by their contents.
+ **
  ** Parameters:
  **     runNumber   - The run number.
  **     segment     - The segment number.
@@ -145,9 +157,47 @@ class noData :  public CRingBuffer::CRingBufferPredicate
      perror("Open failed for event file segment"); 
      exit(EXIT_FAILURE);
    }
+   if (m_fCompress) {
+     try {
+       m_pWriter = new CCompressedSegmentWriter(
+         fd, CCompressedSegmentWriter::DefaultBlockSize, m_compressionLevel
+       );
+     }
+     catch (int err) {
+       cerr << "Unable to write the compressed segment header: " << strerror(err) << endl;
+       exit(EXIT_FAILURE);
+     }
+   }
    return fd;
 
  } 
+ /*
+ ** Close an event segment.  If the segment is compressed, the last block
+ ** and the block index are written first.
+ **
+ ** Parameters:
+ **     fd   - File descriptor open on the segment.
+ */
+ void
+ EventLogMain::closeEventSegment(int fd)
+ {
+   if (m_pWriter) {
+     try {
+       m_pWriter->finish();
+     }
+     catch (int err) {
+       cerr << "Unable to finish a compressed event segment: " << strerror(err) << endl;
+       exit(EXIT_FAILURE);
+     }
+     catch (std::exception& e) {
+       cerr << "Unable to finish a compressed event segment: " << e.what() << endl;
+       exit(EXIT_FAILURE);
+     }
+     delete m_pWriter;
+     m_pWriter = 0;
+   }
+   close(fd);
+ }
 
 
  /*
@@ -311,10 +361,14 @@ class noData :  public CRingBuffer::CRingBufferPredicate
      size_t size    = itemSize(*pItem);
      itemType       = pItem->type();
 
-     // If necessary, close this segment and open a new one:
+     // If necessary, close this segment and open a new one.
+     // Compressed segments are limited by the bytes they'll occupy on disk;
+     // the pending block is counted uncompressed to be safe:
 
-     if ( (bytesInSegment + size) > m_segmentSize) {
-       close(fd);
+     uint64_t used = m_pWriter ?
+       (m_pWriter->bytesWritten() + m_pWriter->pendingBytes()) : bytesInSegment;
+     if ( (used + size) > m_segmentSize) {
+       closeEventSegment(fd);
        segment++;
        bytesInSegment = 0;
 
@@ -391,7 +445,7 @@ class noData :  public CRingBuffer::CRingBufferPredicate
        
    }
 
-   close(fd);
+   closeEventSegment(fd);
 
 
  }
@@ -471,6 +525,15 @@ class noData :  public CRingBuffer::CRingBufferPredicate
    m_fChecksum = (parsed.checksum_flag != 0);
    m_fChangeRunOk = (parsed.combine_runs_flag != 0);
 
+   // Compression:
+
+   m_fCompress        = (parsed.compress_flag != 0);
+   m_compressionLevel = parsed.compression_level_arg;
+   if ((m_compressionLevel < 1) || (m_compressionLevel > 9)) {
+     cerr << "--compression-level must be in the range 1-9\n";
+     exit(EXIT_FAILURE);
+   }
+
  }
 
  /*
@@ -610,7 +673,12 @@ EventLogMain::writeItem(int fd, CRingItem& item)
            reinterpret_cast<EVP_MD_CTX*>(m_pChecksumContext), pItem, nBytes);
       }
 
-      io::writeData(fd, pItem, nBytes);
+      if (m_pWriter) {
+        m_pWriter->write(pItem, nBytes);
+      } else {
+        io::writeData(fd, pItem, nBytes);
+      }
+      CPipelineTrace::hopItem(CPipelineTrace::EventLog, pItem);
     }
     catch(int err) {
       if(err) {
@@ -624,6 +692,10 @@ EventLogMain::writeItem(int fd, CRingItem& item)
       std::cerr << e << std::endl;
       exit(EXIT_FAILURE);
     }
+    catch (std::exception& e) {
+      std::cerr << "Unable to output a ringbuffer item : " << e.what() << std::endl;
+      exit(EXIT_FAILURE);
+    }
 }
 /**
 * itemSize
@@ -40,6 +40,7 @@
 class CRingBuffer;
 class CRingItem;
 class CRingStateChangeItem;
+class CCompressedSegmentWriter;
 
 
 /*!
@@ -64,6 +65,9 @@ class EventLogMain
   uint32_t          m_nBeginsSeen;
   bool              m_fChangeRunOk;
   std::string       m_prefix;
+  bool              m_fCompress;
+  int               m_compressionLevel;
+  CCompressedSegmentWriter* m_pWriter;  // Non null if the open segment is compressed.
 
   // Constructors and canonicals:
 
@@ -85,6 +89,7 @@ public:
 private:
   void parseArguments(int argc, char** argv);
   int  openEventSegment(uint32_t runNumber, unsigned int segment);
+  void closeEventSegment(int fd);
   void recordData();
   void recordRun(const CRingStateChangeItem& item, CRingItem* pFormatItem);
   void writeItem(int fd, CRingItem&    item);
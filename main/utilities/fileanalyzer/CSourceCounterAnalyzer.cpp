@@ -0,0 +1,66 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#include "CSourceCounterAnalyzer.h"
+
+/**
+ * constructor
+ *
+ * @param defaultId  - Source id assigned to items without body headers.
+ * @param outputFile - Where the counter writes its results on finalize.
+ * @param built      - True if the physics events are built events.
+ */
+CSourceCounterAnalyzer::CSourceCounterAnalyzer(
+  uint32_t defaultId, std::string outputFile, bool built
+) :
+  m_defaultId(defaultId), m_outputFile(outputFile), m_builtData(built),
+  m_counter(defaultId, outputFile)
+{
+  m_counter.setBuiltData(built);
+}
+
+/**
+ * clone
+ *   @return CItemAnalyzer* - a new analyzer with the same settings and
+ *           zeroed counters.
+ */
+CItemAnalyzer*
+CSourceCounterAnalyzer::clone() const
+{
+  return new CSourceCounterAnalyzer(m_defaultId, m_outputFile, m_builtData);
+}
+
+/**
+ * analyze
+ *   Count an item.
+ */
+void
+CSourceCounterAnalyzer::analyze(const CRingItemView& item)
+{
+  m_counter.countItem(item);
+}
+
+/**
+ * merge
+ *   Sum the counts of another CSourceCounterAnalyzer into ours.
+ */
+void
+CSourceCounterAnalyzer::merge(const CItemAnalyzer& following)
+{
+  const CSourceCounterAnalyzer& other =
+    dynamic_cast<const CSourceCounterAnalyzer&>(following);
+  m_counter.merge(other.m_counter);
+}
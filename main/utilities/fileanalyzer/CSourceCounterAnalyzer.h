@@ -0,0 +1,48 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+#ifndef CSOURCECOUNTERANALYZER_H
+#define CSOURCECOUNTERANALYZER_H
+
+#include <CItemAnalyzer.h>
+#include "CSourceCounterFilter.h"
+
+/**
+ * @class CSourceCounterAnalyzer
+ *
+ *   Adapts CSourceCounterFilter so that it can be run by
+ *   CParallelFileAnalyzer.  Each clone counts a piece of the data; the
+ *   pieces are summed by merge.
+ */
+class CSourceCounterAnalyzer : public CItemAnalyzer
+{
+private:
+  uint32_t             m_defaultId;
+  std::string          m_outputFile;
+  bool                 m_builtData;
+  CSourceCounterFilter m_counter;
+
+public:
+  CSourceCounterAnalyzer(uint32_t defaultId, std::string outputFile, bool built);
+
+  virtual CItemAnalyzer* clone() const;
+  virtual void analyze(const CRingItemView& item);
+  virtual void merge(const CItemAnalyzer& following);
+
+  CSourceCounterFilter& getCounter() { return m_counter; }
+};
+
+#endif
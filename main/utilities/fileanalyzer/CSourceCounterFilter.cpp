@@ -5,11 +5,12 @@
 #include <sstream>
 #include <fstream>
 #include <FragmentIndex.h>
+#include <RingItemView.h>
 
 using namespace std;
 
   CSourceCounterFilter::CSourceCounterFilter(uint32_t defaultId, std::string outputFile)
-: m_counters(), m_defaultId(defaultId), m_outputFile(outputFile), m_builtData(true)
+: m_counters(), m_fragmentsPerEvent(), m_defaultId(defaultId), m_outputFile(outputFile), m_builtData(true)
 {
   setupCounters(m_defaultId);
 }
@@ -45,19 +46,7 @@ CRingItem* CSourceCounterFilter::handleTextItem(CRingTextItem* pItem)
 
 CRingItem* CSourceCounterFilter::handlePhysicsEventItem(CPhysicsEventItem* pItem) 
 {
-  if (m_builtData) {
-    uint16_t* pBody = reinterpret_cast<uint16_t*>(pItem->getBodyPointer());
-    FragmentIndex index(pBody);
-    auto iter = index.begin();
-    auto iter_end = index.end();
-    while (iter != iter_end) {
-      std::unique_ptr<CRingItem> pSubItem(CRingItemFactory::createRingItem(iter->s_itemhdr));
-      incrementCounter(iter->s_sourceId, pSubItem->type());
-      ++iter;
-    }
-  } else {
-    incrementCounter(pItem);
-  }
+  incrementCounter(pItem);
   return static_cast<CRingItem*>(pItem);
 }
 
@@ -138,23 +127,86 @@ string CSourceCounterFilter::translate(uint32_t type) const
 
 }
 
+void CSourceCounterFilter::printFragmentsPerEvent(std::ostream& stream) const
+{
+  stream << "set fragmentsPerEvent {";
+  map<size_t,uint32_t>::const_iterator it = m_fragmentsPerEvent.begin();
+  while (it != m_fragmentsPerEvent.end()) {
+    stream << it->first << " " << it->second << " ";
+    ++it;
+  }
+  stream << "}";
+}
+
 void CSourceCounterFilter::finalize() 
 {
   std::ofstream dump_file(m_outputFile.c_str());
   printCounters(dump_file);
+  if (m_builtData) {
+    dump_file << endl;
+    printFragmentsPerEvent(dump_file);
+  }
 }
 
 
 void CSourceCounterFilter::incrementCounter(CRingItem* pItem) 
 {
+  countItem(CRingItemView(pItem->getItemPointer()));
+}
 
-  if ( pItem->hasBodyHeader() ) {
-    incrementCounter(pItem->getSourceId(), pItem->type());
+/**
+ * countItem
+ *   Count a raw ring item.  Built physics events are counted by the
+ *   type and source of each of their fragments; the fragment item
+ *   headers are read in place.
+ *
+ * @param item - view of the item.
+ */
+void CSourceCounterFilter::countItem(const CRingItemView& item)
+{
+  if (m_builtData && item.type() == PHYSICS_EVENT) {
+    uint16_t* pBody =
+      reinterpret_cast<uint16_t*>(const_cast<void*>(item.getBodyPointer()));
+    FragmentIndex index(pBody);
+    auto iter = index.begin();
+    auto iter_end = index.end();
+    while (iter != iter_end) {
+      incrementCounter(iter->s_sourceId, CRingItemView(iter->s_itemhdr).type());
+      ++iter;
+    }
+    m_fragmentsPerEvent[index.getNumberFragments()] += 1;
+  } else if (item.hasBodyHeader()) {
+    incrementCounter(item.getSourceId(), item.type());
   } else {
     // this is setup in the constructor
-    incrementCounter(m_defaultId, pItem->type());
+    incrementCounter(m_defaultId, item.type());
   }
+}
 
+/**
+ * merge
+ *   Add the counts from another counter into ours.  Sums don't depend on
+ *   order so the counts can come from any part of the data.
+ *
+ * @param following - the counter to add in.
+ */
+void CSourceCounterFilter::merge(const CSourceCounterFilter& following)
+{
+  map<uint32_t,map<uint32_t,uint32_t> >::const_iterator it;
+  for (it = following.m_counters.begin(); it != following.m_counters.end(); ++it) {
+    if (!counterExists(it->first)) {
+      setupCounters(it->first);
+    }
+    map<uint32_t,uint32_t>::const_iterator idit;
+    for (idit = it->second.begin(); idit != it->second.end(); ++idit) {
+      m_counters[it->first][idit->first] += idit->second;
+    }
+  }
+  map<size_t,uint32_t>::const_iterator fit;
+  for (fit = following.m_fragmentsPerEvent.begin();
+       fit != following.m_fragmentsPerEvent.end(); ++fit) {
+    m_fragmentsPerEvent[fit->first] += fit->second;
+  }
 }
 
 void CSourceCounterFilter::incrementCounter(uint32_t id, uint32_t type) 
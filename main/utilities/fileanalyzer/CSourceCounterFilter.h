@@ -20,10 +20,13 @@
 #include <algorithm>
 #include <memory>
 
+class CRingItemView;
+
 class CSourceCounterFilter : public CFilter
 {
   private:
     std::map<uint32_t, std::map<uint32_t, uint32_t> > m_counters;
+    std::map<size_t, uint32_t> m_fragmentsPerEvent;   // built events only.
     uint32_t     m_defaultId;
     std::string  m_outputFile;
     bool         m_builtData;
@@ -49,6 +52,11 @@ class CSourceCounterFilter : public CFilter
 
     virtual void finalize();
 
+    // Counting that does not need CRingItem objects:
+
+    void countItem(const CRingItemView& item);
+    void merge(const CSourceCounterFilter& following);
+
   private:
     bool counterExists(uint32_t type);
     void setupCounters(uint32_t id);
@@ -56,6 +64,7 @@ class CSourceCounterFilter : public CFilter
     void incrementCounter(uint32_t id, uint32_t type);
 
     void printCounters(std::ostream& stream) const;
+    void printFragmentsPerEvent(std::ostream& stream) const;
     std::string translate(uint32_t type) const;
   
 
@@ -18,6 +18,8 @@
 #include <CFilterMain.h>
 
 #include "CSourceCounterFilter.h"
+#include "CSourceCounterAnalyzer.h"
+#include <CParallelFileAnalyzer.h>
 
 #include <limits>
 #include <iostream>
@@ -25,11 +27,14 @@
 #include <string>
 #include <cstring>
 #include <cstdlib>
+#include <stdexcept>
 using namespace std;
 
 struct CmdlineArgs {
-  string s_outputFile;
-  bool   s_built;
+  string   s_outputFile;
+  bool     s_built;
+  unsigned s_threads;
+  unsigned s_chunkMBytes;
 };
 
 void printSpecialUsage() {
@@ -38,9 +43,34 @@ void printSpecialUsage() {
 
   cout << "\n  -u" << endl;
   cout << "  --unbuilt       If present, data is not treated as built data." << endl;
+
+  cout << "\n  -j" << endl;
+  cout << "  --threads       Analyze the event files on this many threads.  The" << endl;
+  cout << "                  files are given as --source=file://path or plain" << endl;
+  cout << "                  paths and are not run through the filter framework." << endl;
+
+  cout << "\n  --chunk-size    With --threads, split files into pieces of about" << endl;
+  cout << "                  this many megabytes (default 256, 0 - whole files)." << endl;
 }
 
 
+/**! Convert the value of a count option
+ *
+ * \throw std::invalid_argument if the value is not a non-negative integer;
+ *        atoi would turn those into 0 or, stored unsigned, huge counts.
+ */
+unsigned toCount(const string& option, const string& value)
+{
+  char* pEnd;
+  long  count = strtol(value.c_str(), &pEnd, 0);
+  if (value.empty() || *pEnd || count < 0 || count > numeric_limits<int>::max()) {
+    throw invalid_argument(
+      option + " must be a non-negative integer, got '" + value + "'"
+    );
+  }
+  return count;
+}
+
 vector<string> 
 cArgsToCppArgs(int argc, char* argv[]) 
 {
@@ -55,7 +85,7 @@ cArgsToCppArgs(int argc, char* argv[])
 pair<vector<string>, CmdlineArgs>
 processAndRemoveSpecialArgs(const vector<string>& argv)
 {
-  CmdlineArgs cmdArgs = {"", true};
+  CmdlineArgs cmdArgs = {"", true, 0, 256};
 
   vector<string> filteredArgv;
   for (size_t i=0; i<argv.size(); ++i) {
@@ -74,6 +104,27 @@ processAndRemoveSpecialArgs(const vector<string>& argv)
       } else {
         cmdArgs.s_outputFile = option.substr(3); 
       }
+    } else if (option.find("--threads") == 0) {
+      if (option.size() == 9) {
+        cmdArgs.s_threads = toCount(option, argv.at(i+1));
+        ++i;
+      } else {
+        cmdArgs.s_threads = toCount("--threads", option.substr(10));
+      }
+    } else if (option.find("-j") == 0) {
+      if (option.size() == 2) {
+        cmdArgs.s_threads = toCount(option, argv.at(i+1));
+        ++i;
+      } else {
+        cmdArgs.s_threads = toCount("-j", option.substr(2));
+      }
+    } else if (option.find("--chunk-size") == 0) {
+      if (option.size() == 12) {
+        cmdArgs.s_chunkMBytes = toCount(option, argv.at(i+1));
+        ++i;
+      } else {
+        cmdArgs.s_chunkMBytes = toCount("--chunk-size", option.substr(13));
+      }
     } else if (option == "--unbuilt" || option == "-u") {
       cmdArgs.s_built = false;
     } else if (option == "--help" || option == "-h") {
@@ -97,6 +148,47 @@ char** createNewCArgV(const vector<string>& argV)
   return pArgV;
 }
 
+/**! Analyze files on a pool of threads
+ *
+ * The arguments left after the special ones are removed name the files.
+ * They can be given as the filter framework would expect them
+ * (--source=file:///path) or just as paths.  Other kinds of data
+ * source (e.g. tcp://) can't be split and are rejected.
+ *
+ * \return 0 on success, 1 if a data source is not a file.
+ */
+int analyzeInParallel(const vector<string>& args, const CmdlineArgs& opts)
+{
+  CParallelFileAnalyzer driver(
+    opts.s_threads, 8*1024*1024, off_t(opts.s_chunkMBytes)*1024*1024
+  );
+  for (size_t i = 1; i < args.size(); i++) {
+    string file = args[i];
+    if (file.find("--source=") == 0) {
+      file = file.substr(9);
+    }
+    if (file.find("file://") == 0) {
+      file = file.substr(7);
+    } else if (file.find("://") != string::npos) {
+      cerr << "Only file:// data sources can be analyzed with --threads, not "
+           << file << endl;
+      return 1;
+    } else if (file.find("-") == 0) {
+      cerr << "Option " << file << " is ignored with --threads" << endl;
+      continue;
+    }
+    driver.addFile(file);
+  }
+
+  CSourceCounterAnalyzer counter(
+    numeric_limits<uint32_t>::max(), opts.s_outputFile, opts.s_built
+  );
+  driver.analyze(counter);
+  counter.getCounter().finalize();
+
+  return 0;
+}
+
 /// The main function
 /**! main function
   Creates a CFilterMain object and 
@@ -121,13 +213,17 @@ int main(int argc, char* argv[])
       return 1;
     }
 
+    auto cmdLineOpts = parserResult.second;
+    if (cmdLineOpts.s_threads > 0) {
+      return analyzeInParallel(newArgV, cmdLineOpts);
+    }
+
     argc = newArgV.size();
     argv = createNewCArgV(newArgV);
 
     // Create the main
     CFilterMain theApp(argc,argv);
 
-    auto cmdLineOpts = parserResult.second;
     // Construct filter(s) here.
     CSourceCounterFilter srcCounter(numeric_limits<uint32_t>::max(), cmdLineOpts.s_outputFile);
     srcCounter.setBuiltData(cmdLineOpts.s_built);
@@ -139,6 +235,9 @@ int main(int argc, char* argv[])
 
   } catch (CFatalException exc) {
     status = 1;
+  } catch (std::exception& exc) {
+    cout << exc.what() << endl;
+    status = 1;
   } catch (...) {
     cout << "Caught unknown fatal error...!" << endl;
     status = 2;
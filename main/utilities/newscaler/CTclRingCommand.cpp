@@ -43,6 +43,7 @@
 #include <tcl.h>
 
 #include <limits>
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <iostream>
@@ -55,14 +56,19 @@ using namespace std;
  *                   command.
  */
 CTclRingCommand::CTclRingCommand(CTCLInterpreter& interp) :
-    CTCLObjectProcessor(interp, "ring", true) {}
+    CTCLObjectProcessor(interp, "ring", true),
+    m_myThread(Tcl_GetCurrentThread()) {}
     
 /**
  * destruction:
- *    Kill off all the CRingItems in the m_attachedRings map.
+ *    Stop any notifications and kill off all the CRingItems in the
+ *    m_attachedRings map.
  */
 CTclRingCommand::~CTclRingCommand()
 {
+    while (!m_notifiers.empty()) {
+        cancelNotify(m_notifiers.begin()->first);
+    }
     while(! m_attachedRings.empty()) {
         CRingBuffer* pRing = (m_attachedRings.begin())->second;    // First item.
         delete pRing;
@@ -99,6 +105,8 @@ CTclRingCommand::operator()(CTCLInterpreter& interp, std::vector<CTCLObject>& ob
             detach(interp, objv);
         } else if (subcommand == "get") {
             get(interp, objv);
+        } else if (subcommand == "notify") {
+            notify(interp, objv);
         } else {
             throw std::string("bad subcommand");
         }
@@ -175,6 +183,7 @@ CTclRingCommand::detach(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
     if (p == m_attachedRings.end()) {
         throw std::string("ring is not attached");
     }
+    cancelNotify(uri);
     CRingBuffer* pRing = p->second;
     m_attachedRings.erase(p);
     delete pRing;
@@ -183,12 +192,16 @@ CTclRingCommand::detach(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
 /**
  * get
  *   Execute the ring get command (blocks until an item is available);
+ *    * Process the options (-timeout, -count, -all).
  *    * Ensure there's a ring URI parameter
  *    * Looks up the CRingBuffer in the map (error if no match).
  *    * Gets a CRingItem from the ring with the appropriate filter.
  *    * Produces a dict whose keys/contents will depend on the item type
  *      (which will always be in the -type key).  See the private formattting
  *      functions for more on what's in each dict.
+ *    * With -count or -all the result is instead a list of those dicts.
+ *      Only the first item is waited for; the rest must already be in the
+ *      ring when it arrives.
  *   @param interp - reference to the interpreter that's executing the command.
  *   @param args   - The command line words.
  *
@@ -199,28 +212,44 @@ void
 CTclRingCommand::get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
 {
     requireAtLeast(objv, 3, "ring get needs a URI");
-    requireAtMost(objv, 6, "Too many command parameters");
 
     CAllButPredicate all;
     CDesiredTypesPredicate some;
     CRingSelectionPredicate* pred;
     pred = &all;
     
-    // If there's a 4th parameter it must be a list of item types to select
-    // from
-
     unsigned long timeout = std::numeric_limits<unsigned long>::max();
+    size_t        maxItems = 0;             // 0 means a single item, not a list.
 
     size_t paramIndexOffset = 0;
-    if (std::string(objv[2]) == "-timeout") {
-        if (objv.size() >= 4) {
-            CTCLObject object = objv[3];
-            timeout = int(object.lindex(0));
-        } else {
+    while ((objv.size() > 2+paramIndexOffset) &&
+           (std::string(objv[2+paramIndexOffset])[0] == '-')) {
+        std::string option = objv[2+paramIndexOffset];
+        if (option == "-all") {
+            maxItems = std::numeric_limits<size_t>::max();
+            paramIndexOffset++;
+            continue;
+        }
+        if ((option != "-timeout") && (option != "-count")) {
+            throw std::string("Invalid option: ") + option;
+        }
+        if (objv.size() < 4+paramIndexOffset) {
             throw std::string("Insufficient number of parameters");
         }
-        paramIndexOffset = 2;
+        CTCLObject object = objv[3+paramIndexOffset];
+        int value = int(object.lindex(0));
+        if (option == "-timeout") {
+            timeout = value;
+        } else {
+            if (value <= 0) {
+                throw std::string("-count must be positive");
+            }
+            maxItems = value;
+        }
+        paramIndexOffset += 2;
     }
+    requireAtLeast(objv, 3+paramIndexOffset, "ring get needs a URI");
+    requireAtMost(objv, 4+paramIndexOffset, "Too many command parameters");
 
     std::string uri  = std::string(objv[2+paramIndexOffset]);
     std::map<std::string, CRingBuffer*>::iterator p =  m_attachedRings.find(uri);
@@ -228,6 +257,9 @@ CTclRingCommand::get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
         throw std::string("ring is not attached");
     }
 
+    // If there's a parameter after the URI it must be a list of item types
+    // to select from
+
     if (objv.size() == 4+paramIndexOffset) {
         CTCLObject types = objv[3+paramIndexOffset];
         for (int i = 0; i < types.llength(); i++) {
@@ -237,10 +269,15 @@ CTclRingCommand::get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
         pred = &some;
     }
     
-    // Get the item from the ring.
+    // Get the item(s) from the ring.
     
     
     CRingBuffer* pRing = p->second;
+    if (maxItems) {
+        CTCLObject result = getItems(interp, *pRing, *pred, maxItems, timeout);
+        interp.setResult(result);
+        return;
+    }
     auto pSpecificItem = getFromRing(*pRing, *pred, timeout);
 
     if (pSpecificItem == nullptr) {
@@ -250,10 +287,74 @@ CTclRingCommand::get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
         interp.setResult(result);
         return;
     }
-    
-    // Actual upcast depends on the type...and that describes how to format:
-    
-    
+    formatItem(interp, pSpecificItem);
+    delete pSpecificItem;
+}
+/**
+ * notify
+ *    Execute the ring notify command:
+ *    *  Ensure the ring is attached.
+ *    *  Replace any existing notification for the ring.
+ *    *  If the script is not empty, start a thread that watches the ring
+ *       and queues events to us when data arrives.
+ *
+ *   @param interp - reference to the interpreter that's executing the command.
+ *   @param args   - The command line words.
+ *
+ *   @throw std::string error message to put in result string if TCL_ERROR
+ *          should be returned from operator().
+ */
+void
+CTclRingCommand::notify(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
+{
+    requireAtLeast(objv, 4, "ring notify needs a URI and a script");
+    requireAtMost(objv, 5, "Too many command parameters");
+
+    std::string uri    = objv[2];
+    std::string script = objv[3];
+    std::map<std::string, CRingBuffer*>::iterator p =  m_attachedRings.find(uri);
+    if (p == m_attachedRings.end()) {
+        throw std::string("ring is not attached");
+    }
+    cancelNotify(uri);
+    if (script == "") {
+        return;
+    }
+
+    pNotifier pNotify  = new Notifier;
+    pNotify->s_pCommand = this;
+    pNotify->s_pRing    = p->second;
+    pNotify->s_script   = script;
+    pNotify->s_stop     = false;
+    pNotify->s_pending  = false;
+    if (objv.size() == 5) {
+        CTCLObject types = objv[4];
+        for (int i = 0; i < types.llength(); i++) {
+            pNotify->s_types.push_back(int(types.lindex(i)));
+        }
+    }
+    pNotify->s_thread   = std::thread(watchRing, pNotify);
+    m_notifiers[uri]    = pNotify;
+}
+
+/*-----------------------------------------------------------------------------
+ * Private utilities
+ */
+
+
+/**
+ * formatItem
+ *    Set the interpreter result to the dict that describes an item.  The
+ *    actual upcast depends on the type...and that describes how to format.
+ *    Types we don't know how to format leave an empty result.
+ *
+ * @param interp - The interpreter whose result is set.
+ * @param pSpecificItem - The item.
+ */
+void
+CTclRingCommand::formatItem(CTCLInterpreter& interp, CRingItem* pSpecificItem)
+{
+    Tcl_ResetResult(interp.getInterpreter());
     switch(pSpecificItem->type()) {
         case BEGIN_RUN:
         case END_RUN:
@@ -290,15 +391,186 @@ CTclRingCommand::get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv)
             break;;
             // TO DO:
     }
-    
-    
-    delete pSpecificItem;
 }
+/**
+ * getItems
+ *    Get a batch of items as a list of item dicts.  We wait for the first
+ *    acceptable item for up to timeout seconds.  After that we only take
+ *    items that were already in the ring when the first one was gotten;
+ *    anything later is left for the next call.
+ *
+ * @param interp    - Interpreter used to format the items.
+ * @param ring      - Ring to get items from.
+ * @param predicate - Selects the items that are wanted.
+ * @param maxItems  - Most items to return.
+ * @param timeout   - Seconds to wait for the first item.
+ * @return CTCLObject - list of dicts (empty if the wait timed out).
+ */
+CTCLObject
+CTclRingCommand::getItems(CTCLInterpreter& interp, CRingBuffer& ring,
+                          CRingSelectionPredicate& predicate, size_t maxItems,
+                          unsigned long timeout)
+{
+    CTCLObject result;
+    result.Bind(interp);
 
-/*-----------------------------------------------------------------------------
- * Private utilities
+    size_t     nItems = 0;
+    CRingItem* pItem  = getFromRing(ring, predicate, timeout);
+
+    // Only the data that's there once we have the first item is taken.
+    // Otherwise a producer that keeps up with us would keep us here forever.
+
+    size_t     available = pItem ? ring.availableData() : 0;
+    while (pItem) {
+        formatItem(interp, pItem);
+        delete pItem;
+        Tcl_Obj* pDict = Tcl_GetObjResult(interp.getInterpreter());
+        if (Tcl_GetCharLength(pDict)) {
+            result += pDict;
+            nItems++;
+        }
+        pItem = 0;
+        while (!pItem && (nItems < maxItems) && available) {
+            CTimeout noWait(0);
+            pItem = getFromRing(ring, noWait);
+            if (!pItem) break;
+            available -= std::min(available, size_t(pItem->size()));
+            if (!accepted(predicate, pItem)) {
+                delete pItem;
+                pItem = 0;
+            }
+        }
+    }
+    Tcl_ResetResult(interp.getInterpreter());
+    return result;
+}
+/**
+ * cancelNotify
+ *    Stop notifications for a ring if there are any: the watcher thread is
+ *    stopped and any of its events still in the queue are discarded.
+ *
+ * @param uri - The ring.
+ */
+void
+CTclRingCommand::cancelNotify(std::string uri)
+{
+    std::map<std::string, pNotifier>::iterator p = m_notifiers.find(uri);
+    if (p != m_notifiers.end()) {
+        pNotifier pNotify = p->second;
+        m_notifiers.erase(p);
+
+        pNotify->s_stop = true;
+        pNotify->s_thread.join();
+        Tcl_DeleteEvents(isNotifyEvent, pNotify);
+        delete pNotify;
+    }
+}
+/**
+ * dispatchNotification
+ *    Runs in the interpreter thread when a watcher says there's data.
+ *    The items available now are gotten and, if any are wanted, the script is
+ *    run at global level with their list appended.  Script errors are
+ *    reported as background errors.
+ *
+ * @param pNotify - The notification.  Note the script may cancel it so it
+ *                  can't be touched once the script runs.
+ */
+void
+CTclRingCommand::dispatchNotification(pNotifier pNotify)
+{
+    CTCLInterpreter& interp(*getInterpreter());
+
+    CAllButPredicate all;
+    CDesiredTypesPredicate some;
+    CRingSelectionPredicate* pred = &all;
+    if (!pNotify->s_types.empty()) {
+        for (int i = 0; i < pNotify->s_types.size(); i++) {
+            some.addDesiredType(pNotify->s_types[i]);
+        }
+        pred = &some;
+    }
+    CTCLObject items =
+        getItems(interp, *pNotify->s_pRing, *pred,
+                 std::numeric_limits<size_t>::max(), 0);
+    pNotify->s_pending = false;         // Later data needs another event.
+
+    if (items.llength() > 0) {
+        CTCLObject script;
+        script.Bind(interp);
+        script = pNotify->s_script;
+        script += items;
+
+        Tcl_Interp* pInterp = interp.getInterpreter();
+        Tcl_Obj*    pScript = script.getObject();
+        Tcl_IncrRefCount(pScript);
+        if (Tcl_EvalObjEx(pInterp, pScript, TCL_EVAL_GLOBAL) != TCL_OK) {
+            Tcl_BackgroundError(pInterp);
+        }
+        Tcl_DecrRefCount(pScript);
+    }
+}
+/**
+ * watchRing
+ *    Thread that watches a ring for a notification.  When there's data and
+ *    no event is already outstanding, an event is queued to the
+ *    interpreter's thread.  The ring's data is never touched here.
+ *
+ * @param pNotify - The notification we're watching for.
  */
+void
+CTclRingCommand::watchRing(pNotifier pNotify)
+{
+    using namespace std::chrono;
 
+    while (!pNotify->s_stop) {
+        if (!pNotify->s_pending &&
+            (pNotify->s_pRing->availableData() >= sizeof(RingItemHeader))) {
+            pNotify->s_pending = true;
+
+            pNotifyEvent pEvent =
+                reinterpret_cast<pNotifyEvent>(Tcl_Alloc(sizeof(NotifyEvent)));
+            pEvent->s_event.proc    = notifyEvent;
+            pEvent->s_event.nextPtr = NULL;
+            pEvent->s_pNotifier     = pNotify;
+
+            Tcl_ThreadId tid = pNotify->s_pCommand->m_myThread;
+            Tcl_ThreadQueueEvent(
+                tid, reinterpret_cast<Tcl_Event*>(pEvent), TCL_QUEUE_TAIL
+            );
+            Tcl_ThreadAlert(tid);
+        }
+        std::this_thread::sleep_for(milliseconds(50));
+    }
+}
+/**
+ * notifyEvent
+ *    Tcl event handler for notification events.
+ *
+ * @param pEvent - Actually a pNotifyEvent.
+ * @param flags  - Event dispatch mask.
+ * @return int 1 - The event can be freed.
+ */
+int
+CTclRingCommand::notifyEvent(Tcl_Event* pEvent, int flags)
+{
+    pNotifier pNotify = reinterpret_cast<pNotifyEvent>(pEvent)->s_pNotifier;
+    pNotify->s_pCommand->dispatchNotification(pNotify);
+    return 1;
+}
+/**
+ * isNotifyEvent
+ *    Tcl_DeleteEvents filter that matches the events of one notification.
+ *
+ * @param pEvent  - An event in the queue.
+ * @param pNotify - The notification whose events are being deleted.
+ * @return int - nonzero if the event should be deleted.
+ */
+int
+CTclRingCommand::isNotifyEvent(Tcl_Event* pEvent, ClientData pNotify)
+{
+    return (pEvent->proc == notifyEvent) &&
+        (reinterpret_cast<pNotifyEvent>(pEvent)->s_pNotifier == pNotify);
+}
 
 /**
  *  formatBodyHeader
@@ -743,12 +1015,8 @@ CTclRingCommand::getFromRing(CRingBuffer &ring, CRingSelectionPredicate &predica
     do {
         pItem = getFromRing(ring, timer);
 
-        if (pItem) {
-            if (!predicate.selectThis(pItem->type())
-                    || (predicate.getNumberOfSelections() == 0) ) {
-                break;
-            }
-
+        if (pItem && accepted(predicate, pItem)) {
+            break;
         }
 
         delete pItem;
@@ -807,12 +1075,24 @@ CTclRingCommand::getFromRing(CRingBuffer &ring, CTimeout& timer)
       std::cerr << "Mismatch in CRingItem::getItem required size: sb " << size << " was " << gotSize
                 << std::endl;
     }
+    ring.countItems(1);
 
     return CRingItemFactory::createRingItem(buffer.data());
 }
 
 
 
+/**
+ * accepted
+ *   @return bool - true if the predicate lets an item through.
+ */
+bool
+CTclRingCommand::accepted(CRingSelectionPredicate& predicate, CRingItem* pItem)
+{
+    return !predicate.selectThis(pItem->type())
+        || (predicate.getNumberOfSelections() == 0);
+}
+
 uint32_t CTclRingCommand::swal(uint32_t value)
 {
     union {
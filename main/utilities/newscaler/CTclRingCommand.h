@@ -39,6 +39,34 @@
 #include <TCLObject.h>
 #endif
 
+#ifndef __TCL_H
+#include <tcl.h>
+#ifndef __TCL_H
+#define __TCL_H
+#endif
+#endif
+
+#ifndef __STL_VECTOR
+#include <vector>
+#ifndef __STL_VECTOR
+#define __STL_VECTOR
+#endif
+#endif
+
+#ifndef __CPP_THREAD
+#include <thread>
+#ifndef __CPP_THREAD
+#define __CPP_THREAD
+#endif
+#endif
+
+#ifndef __CPP_ATOMIC
+#include <atomic>
+#ifndef __CPP_ATOMIC
+#define __CPP_ATOMIC
+#endif
+#endif
+
 class CTCLInterpreter;
 class CRingBuffer;
 class CRingItem;
@@ -63,13 +91,44 @@ class CTimeout;
  *  \verbatim
  *     ring attach ringname
  *     ring detach ringname
- *     ring get ringname ?acceptable-types?
+ *     ring get ?-timeout secs? ?-count n | -all? ringname ?acceptable-types?
+ *     ring notify ringname script ?acceptable-types?
  * \endverbatim
+ *
+ *  With -count or -all, get returns a list of item dicts.  It waits (up to
+ *  the timeout) for the first item and then, without waiting again, takes
+ *  items that were already in the ring when the first one arrived until it
+ *  has n in total (-all: all of them).  Items put after that are left for
+ *  the next get.
+ *
+ *  notify runs script from the event loop with a list of item dicts
+ *  appended whenever items arrive.  A thread watches the ring and queues
+ *  an event to the interpreter's thread; the items themselves are
+ *  gotten and formatted in the interpreter's thread.  An empty script
+ *  cancels the notification, as does detaching the ring.
  */
 class CTclRingCommand : public CTCLObjectProcessor
 {
+private:
+    typedef struct _Notifier {
+        CTclRingCommand*   s_pCommand;
+        CRingBuffer*       s_pRing;
+        std::string        s_script;
+        std::vector<int>   s_types;         // Empty means all types.
+        std::thread        s_thread;        // Watches the ring.
+        std::atomic<bool>  s_stop;          // Tells the thread to exit.
+        std::atomic<bool>  s_pending;       // An event is queued and not handled.
+    } Notifier, *pNotifier;
+
+    typedef struct _NotifyEvent {
+        Tcl_Event          s_event;
+        pNotifier          s_pNotifier;
+    } NotifyEvent, *pNotifyEvent;
+
 private:
     std::map<std::string, CRingBuffer*> m_attachedRings;
+    std::map<std::string, pNotifier>    m_notifiers;
+    Tcl_ThreadId                        m_myThread;
     
 public:
     CTclRingCommand(CTCLInterpreter& interp);
@@ -83,10 +142,20 @@ protected:
     void attach(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
     void detach(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
     void get(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
+    void notify(CTCLInterpreter& interp, std::vector<CTCLObject>& objv);
     
     // Local utilities.
 private:
     CTCLObject formatBodyHeader(CTCLInterpreter& interp, CRingItem* pItem);
+    void formatItem(CTCLInterpreter& interp, CRingItem* pSpecificItem);
+    CTCLObject getItems(CTCLInterpreter& interp, CRingBuffer& ring,
+                        CRingSelectionPredicate& predicate, size_t maxItems,
+                        unsigned long timeout);
+    void cancelNotify(std::string uri);
+    void dispatchNotification(pNotifier pNotify);
+    static void watchRing(pNotifier pNotify);
+    static int  notifyEvent(Tcl_Event* pEvent, int flags);
+    static int  isNotifyEvent(Tcl_Event* pEvent, ClientData pNotify);
     void formatStateChangeItem(CTCLInterpreter& interp, CRingItem* pItem);
     void formatScalerItem(CTCLInterpreter& interp, CRingItem* pSpecificItem);
     void formatStringItem(CTCLInterpreter& interp, CRingItem* pSpecificItem);
@@ -100,6 +169,7 @@ private:
     CRingItem* getFromRing(CRingBuffer& ring, CRingSelectionPredicate& predicate,
                            unsigned long timeout);
     CRingItem* getFromRing(CRingBuffer& ring, CTimeout& timeout);
+    static bool accepted(CRingSelectionPredicate& predicate, CRingItem* pItem);
     uint32_t swal(uint32_t value);
 };
 
@@ -29,6 +29,10 @@
 #include <CRingScalerItem.h>
 
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <time.h>
+#include <unistd.h>
 
 class RingTests : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(RingTests);
@@ -72,6 +76,17 @@ class RingTests : public CppUnit::TestFixture {
   CPPUNIT_TEST(getWithPredicate);
   CPPUNIT_TEST(getTimeout_0);
   CPPUNIT_TEST(getTimeout_1);
+  CPPUNIT_TEST(getCount);
+  CPPUNIT_TEST(getAll);
+  CPPUNIT_TEST(getAllEmpty);
+  CPPUNIT_TEST(getAllBusy);
+  CPPUNIT_TEST(getBadCount);
+
+  // Tests for notify:
+
+  CPPUNIT_TEST(notifyNeedAttached);
+  CPPUNIT_TEST(notify);
+  CPPUNIT_TEST(notifyCancel);
   // Test for Abnormal End.
   
   CPPUNIT_TEST(getAbnormalEnd);
@@ -131,6 +146,15 @@ protected:
   void getAbnormalEnd();
   void getTimeout_0();
   void getTimeout_1();
+  void getCount();
+  void getAll();
+  void getAllEmpty();
+  void getAllBusy();
+  void getBadCount();
+
+  void notifyNeedAttached();
+  void notify();
+  void notifyCancel();
 
 private:
     int tryCommand(const char* command);
@@ -146,6 +170,7 @@ private:
     
     
     int getDictItem(Tcl_Obj* obj, const char* key, std::string& value);
+    void runEvents(const char* varName, int seconds);
     
 };
 
@@ -193,6 +218,19 @@ int RingTests::getDictItem(Tcl_Obj* obj, const char* key, std::string& value)
     }
     return status;
 }
+/**
+ * Run the event loop until a global variable is set or for at most
+ * the given number of seconds.
+ */
+void RingTests::runEvents(const char* varName, int seconds)
+{
+    Tcl_Interp* pI = m_pInterp->getInterpreter();
+    time_t end = time(NULL) + seconds;
+    while (!Tcl_GetVar(pI, varName, TCL_GLOBAL_ONLY) && (time(NULL) < end)) {
+        Tcl_DoOneEvent(TCL_ALL_EVENTS | TCL_DONT_WAIT);
+        usleep(10000);
+    }
+}
 /**
  * insertStateChange - insert a state change item in the tcltestring
  * @param type - Actual state change type (e.g. BEGIN_RUN).
@@ -1144,3 +1182,139 @@ void RingTests::getTimeout_1()
     getDictItem(event2, "type", itemValue);
     EQ(std::string("Begin Run"), itemValue);
 }
+
+// -count gives a list of at most that many items, selected by type.
+
+void RingTests::getCount()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    insertStateChange(BEGIN_RUN, false);
+    insertScalerItem(false);
+    insertScalerItem(false);
+    insertScalerItem(false);
+    insertStateChange(END_RUN, false);
+
+    EQ(TCL_OK, tryCommand("ring get -timeout 1 -count 2 tcp://localhost/tcltestring 20"));
+    Tcl_Obj* list = Tcl_GetObjResult(m_pInterp->getInterpreter());
+    int n;
+    Tcl_ListObjLength(m_pInterp->getInterpreter(), list, &n);
+    EQ(2, n);
+    Tcl_Obj* item;
+    Tcl_ListObjIndex(m_pInterp->getInterpreter(), list, 0, &item);
+    std::string value;
+    getDictItem(item, "type", value);
+    EQ(std::string("Scaler"), value);
+
+    // The remaining scaler is next; the end run is skipped by the type list:
+
+    EQ(TCL_OK, tryCommand("ring get -timeout 1 -count 10 tcp://localhost/tcltestring 20"));
+    list = Tcl_GetObjResult(m_pInterp->getInterpreter());
+    Tcl_ListObjLength(m_pInterp->getInterpreter(), list, &n);
+    EQ(1, n);
+}
+// -all takes everything that's there.
+
+void RingTests::getAll()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    insertStateChange(BEGIN_RUN, false);
+    insertScalerItem(false);
+    insertStateChange(END_RUN, false);
+
+    EQ(TCL_OK, tryCommand("ring get -all -timeout 1 tcp://localhost/tcltestring"));
+    Tcl_Obj* list = Tcl_GetObjResult(m_pInterp->getInterpreter());
+    int n;
+    Tcl_ListObjLength(m_pInterp->getInterpreter(), list, &n);
+    EQ(3, n);
+    Tcl_Obj* item;
+    Tcl_ListObjIndex(m_pInterp->getInterpreter(), list, 2, &item);
+    std::string value;
+    getDictItem(item, "type", value);
+    EQ(std::string("End Run"), value);
+}
+// A timed out batch is an empty list.
+
+void RingTests::getAllEmpty()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    EQ(TCL_OK, tryCommand("ring get -timeout 0 -all tcp://localhost/tcltestring"));
+    EQ(std::string(""), getResult());
+}
+// -all ends even if a producer keeps putting items while it runs.
+
+void RingTests::getAllBusy()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    insertStateChange(BEGIN_RUN, false);
+
+    std::atomic<bool> stop(false);
+    std::thread producer([&stop]() {
+        CRingBuffer ring("tcltestring", CRingBuffer::producer);
+        CRingStateChangeItem item(END_RUN, 123, 0, 0, std::string("A test title"));
+        while (!stop) {
+            if (ring.availablePutSpace() > item.size()) {
+                item.commitToRing(ring);
+            } else {
+                usleep(100);
+            }
+        }
+    });
+    int status = tryCommand("ring get -all -timeout 1 tcp://localhost/tcltestring");
+    stop = true;
+    producer.join();
+
+    EQ(TCL_OK, status);
+    Tcl_Obj* list = Tcl_GetObjResult(m_pInterp->getInterpreter());
+    int n;
+    Tcl_ListObjLength(m_pInterp->getInterpreter(), list, &n);
+    ASSERT(n >= 1);
+}
+
+void RingTests::getBadCount()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    EQ(TCL_ERROR, tryCommand("ring get -count 0 tcp://localhost/tcltestring"));
+    EQ(TCL_ERROR, tryCommand("ring get -bogus tcp://localhost/tcltestring"));
+}
+
+void RingTests::notifyNeedAttached()
+{
+    EQ(TCL_ERROR, tryCommand("ring notify tcp://localhost/tcltestring {set got}"));
+    EQ(std::string("ring is not attached"), getResult());
+}
+// The script is run from the event loop with the wanted items appended.
+
+void RingTests::notify()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    EQ(TCL_OK, tryCommand("ring notify tcp://localhost/tcltestring {set ::got} 20"));
+    EQ(size_t(1), m_pCommand->m_notifiers.size());
+
+    insertStateChange(BEGIN_RUN, false);
+    insertScalerItem(false);
+    insertScalerItem(false);
+    runEvents("got", 5);
+
+    EQ(TCL_OK, tryCommand("llength $::got"));
+    EQ(std::string("2"), getResult());
+    EQ(TCL_OK, tryCommand("dict get [lindex $::got 0] type"));
+    EQ(std::string("Scaler"), getResult());
+
+    // Detaching stops the notification:
+
+    EQ(TCL_OK, tryCommand("ring detach tcp://localhost/tcltestring"));
+    EQ(size_t(0), m_pCommand->m_notifiers.size());
+}
+// An empty script cancels; nothing is run afterwards.
+
+void RingTests::notifyCancel()
+{
+    tryCommand("ring attach tcp://localhost/tcltestring");
+    EQ(TCL_OK, tryCommand("ring notify tcp://localhost/tcltestring {set ::got}"));
+    EQ(TCL_OK, tryCommand("ring notify tcp://localhost/tcltestring {}"));
+    EQ(size_t(0), m_pCommand->m_notifiers.size());
+
+    insertStateChange(BEGIN_RUN, false);
+    runEvents("got", 1);
+    EQ(TCL_ERROR, tryCommand("set ::got"));
+}
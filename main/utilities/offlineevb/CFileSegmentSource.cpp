@@ -0,0 +1,277 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CFileSegmentSource.cpp
+ * @brief Implement reading ring items from event segment files.
+ */
+
+#include <config.h>
+#include "CFileSegmentSource.h"
+
+#include <CCompressedSegmentReader.h>
+#include <io.h>
+
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Consumed parts of mapped segments are handed back to the kernel in
+// chunks this big so reading a large run does not fill the page cache.
+
+static const size_t ReleaseChunk(64*1024*1024);
+
+// Initial decompression buffer size.
+
+static const size_t BufferSize(4*1024*1024);
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *
+ * @param files - The segments in the order they are read.  Files are
+ *                opened as they are needed.
+ */
+CFileSegmentSource::CFileSegmentSource(const std::vector<std::string>& files) :
+  m_files(files), m_nextFile(0), m_fd(-1),
+  m_pMap(0), m_mapSize(0), m_released(0),
+  m_pDecompressor(0), m_nFilled(0), m_cursor(0)
+{
+}
+/**
+ * destructor
+ */
+CFileSegmentSource::~CFileSegmentSource()
+{
+  closeCurrent();
+}
+
+/*----------------------------------------------------------------------------
+ * Public interface
+ */
+
+/**
+ * next
+ *   Return the next item, moving on to the next segment as each ends.
+ */
+const RingItemHeader*
+CFileSegmentSource::next()
+{
+  while (true) {
+    if ((m_fd < 0) && !openNext()) {
+      return 0;
+    }
+    const RingItemHeader* pItem = m_pDecompressor ? nextCompressed() : nextMapped();
+    if (pItem) {
+      return pItem;
+    }
+    closeCurrent();
+  }
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities
+ */
+
+/**
+ * openNext
+ *   Open the next segment and determine how to read it.
+ *
+ * @return bool - false if there are no more segments.
+ */
+bool
+CFileSegmentSource::openNext()
+{
+  if (m_nextFile >= m_files.size()) {
+    return false;
+  }
+  m_currentFile = m_files[m_nextFile++];
+  m_cursor      = 0;
+  m_fd = open(m_currentFile.c_str(), O_RDONLY);
+  if (m_fd < 0) {
+    error(strerror(errno));
+  }
+
+  uint8_t magic[CCompressedSegmentReader::MagicSize];
+  size_t  nMagic;
+  try {
+    nMagic = io::readData(m_fd, magic, sizeof(magic));
+  }
+  catch (int e) {
+    error(strerror(e));
+  }
+  if (CCompressedSegmentReader::isCompressed(magic, nMagic)) {
+    try {
+      m_pDecompressor = new CCompressedSegmentReader(m_fd, true);
+    }
+    catch (std::exception& e) {
+      error(e.what());
+    }
+    catch (int e) {
+      error(strerror(e));
+    }
+    m_buffer.resize(BufferSize);
+    m_nFilled = 0;
+    return true;
+  }
+
+  struct stat info;
+  if (fstat(m_fd, &info) < 0) {
+    error(strerror(errno));
+  }
+  m_mapSize  = info.st_size;
+  m_released = 0;
+  if (m_mapSize) {
+    void* p = mmap(0, m_mapSize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (p == MAP_FAILED) {
+      error(strerror(errno));
+    }
+    m_pMap = reinterpret_cast<uint8_t*>(p);
+    madvise(m_pMap, m_mapSize, MADV_SEQUENTIAL);
+  }
+  return true;
+}
+/**
+ * closeCurrent
+ *   Release everything associated with the current segment.
+ */
+void
+CFileSegmentSource::closeCurrent()
+{
+  if (m_pMap) {
+    munmap(m_pMap, m_mapSize);
+    m_pMap = 0;
+  }
+  delete m_pDecompressor;
+  m_pDecompressor = 0;
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+/**
+ * nextMapped
+ *   Next item of a mapped segment.
+ *
+ * @return const RingItemHeader* - 0 at the end of the segment.
+ */
+const RingItemHeader*
+CFileSegmentSource::nextMapped()
+{
+  size_t remaining = m_mapSize - m_cursor;
+  if (remaining == 0) {
+    return 0;
+  }
+  if (remaining < sizeof(RingItemHeader)) {
+    error("truncated ring item at end of segment");
+  }
+  const RingItemHeader* pItem =
+    reinterpret_cast<const RingItemHeader*>(m_pMap + m_cursor);
+  if ((pItem->s_size < sizeof(RingItemHeader)) || (pItem->s_size > remaining)) {
+    error("invalid or truncated ring item");
+  }
+  m_cursor += pItem->s_size;
+
+  if ((m_cursor - m_released) > 2*ReleaseChunk) {
+    madvise(m_pMap + m_released, ReleaseChunk, MADV_DONTNEED);
+    m_released += ReleaseChunk;
+  }
+  return pItem;
+}
+/**
+ * nextCompressed
+ *   Next item of a compressed segment.
+ *
+ * @return const RingItemHeader* - 0 at the end of the segment.
+ */
+const RingItemHeader*
+CFileSegmentSource::nextCompressed()
+{
+  if (!fill(sizeof(RingItemHeader))) {
+    if (m_nFilled > m_cursor) {
+      error("truncated ring item at end of segment");
+    }
+    return 0;
+  }
+  const RingItemHeader* pItem =
+    reinterpret_cast<const RingItemHeader*>(&m_buffer[m_cursor]);
+  uint32_t size = pItem->s_size;
+  if (size < sizeof(RingItemHeader)) {
+    error("invalid ring item size");
+  }
+  if (!fill(size)) {
+    error("truncated ring item at end of segment");
+  }
+  pItem     = reinterpret_cast<const RingItemHeader*>(&m_buffer[m_cursor]);
+  m_cursor += size;
+  return pItem;
+}
+/**
+ * fill
+ *   Ensure at least nBytes of decompressed data are available at the cursor.
+ *   Consumed data are discarded and the buffer grows if an item is bigger
+ *   than it.
+ *
+ * @return bool - false if the segment ended first.
+ */
+bool
+CFileSegmentSource::fill(size_t nBytes)
+{
+  while ((m_nFilled - m_cursor) < nBytes) {
+    if ((m_cursor + nBytes) > m_buffer.size()) {
+      memmove(&m_buffer[0], &m_buffer[m_cursor], m_nFilled - m_cursor);
+      m_nFilled -= m_cursor;
+      m_cursor   = 0;
+      if (nBytes > m_buffer.size()) {
+        m_buffer.resize(nBytes);
+      }
+    }
+    size_t n;
+    try {
+      n = m_pDecompressor->read(&m_buffer[m_nFilled], m_buffer.size() - m_nFilled);
+    }
+    catch (std::exception& e) {
+      error(e.what());
+    }
+    catch (int e) {
+      error(strerror(e));
+    }
+    if (n == 0) {
+      return false;
+    }
+    m_nFilled += n;
+  }
+  return true;
+}
+/**
+ * error
+ *   Throw an error that identifies the segment.
+ */
+void
+CFileSegmentSource::error(const std::string& why) const
+{
+  std::string msg = m_currentFile;
+  msg += ": ";
+  msg += why;
+  throw msg;
+}
@@ -0,0 +1,84 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CFileSegmentSource.h
+ * @brief Ring items from a sequence of event segment files.
+ */
+#ifndef CFILESEGMENTSOURCE_H
+#define CFILESEGMENTSOURCE_H
+
+#include "COfflineSource.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+class CCompressedSegmentReader;
+
+/**
+ * @class CFileSegmentSource
+ *
+ *   Reads the segments of a run in order as a single stream of ring items.
+ *   Plain segments are mapped into memory and items are handed out in
+ *   place.  Block compressed segments (see CCompressedSegmentWriter) are
+ *   decompressed into a large buffer.  Either way nothing is copied per
+ *   item.
+ */
+class CFileSegmentSource : public COfflineSource
+{
+private:
+  std::vector<std::string>  m_files;
+  size_t                    m_nextFile;
+  std::string               m_currentFile;
+  int                       m_fd;
+
+  // Mapped segment:
+
+  uint8_t*                  m_pMap;
+  size_t                    m_mapSize;
+  size_t                    m_released;	// Bytes given back to the kernel.
+
+  // Compressed segment:
+
+  CCompressedSegmentReader* m_pDecompressor;
+  std::vector<uint8_t>      m_buffer;
+  size_t                    m_nFilled;
+
+  size_t                    m_cursor;	// Offset of the next item.
+
+public:
+  CFileSegmentSource(const std::vector<std::string>& files);
+  virtual ~CFileSegmentSource();
+
+private:
+  CFileSegmentSource(const CFileSegmentSource& rhs);
+  CFileSegmentSource& operator=(const CFileSegmentSource& rhs);
+
+public:
+  virtual const RingItemHeader* next();
+
+private:
+  bool                  openNext();
+  void                  closeCurrent();
+  const RingItemHeader* nextMapped();
+  const RingItemHeader* nextCompressed();
+  bool                  fill(size_t nBytes);
+  void                  error(const std::string& why) const;
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file COfflineEventBuilder.cpp
+ * @brief Implement the offline event builder.
+ */
+
+#include <config.h>
+#include "COfflineEventBuilder.h"
+
+#include <fragment.h>
+
+#include <algorithm>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+
+// Space at the front of a built event for its headers:
+
+static const size_t EventHeaderSize(sizeof(RingItemHeader) + sizeof(BodyHeader) +
+                                    sizeof(uint32_t));
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *
+ * @param sink     - Receives the built data.
+ * @param dt       - Coincidence window in timestamp ticks.
+ * @param building - If false each fragment is its own event (glom --nobuild).
+ * @param policy   - Which timestamp a built event gets.
+ * @param sourceId - Source id of built events.
+ */
+COfflineEventBuilder::COfflineEventBuilder(COfflineSink& sink, uint64_t dt,
+                                           bool building, TimestampPolicy policy,
+                                           uint32_t sourceId) :
+  m_sink(sink), m_dt(dt), m_building(building), m_policy(policy),
+  m_sourceId(sourceId), m_nEventFragments(0),
+  m_firstTimestamp(0), m_lastTimestamp(0), m_timestampSum(0),
+  m_glomParametersSent(false), m_stateChangeNesting(0), m_newestTimestamp(0),
+  m_nFragments(0), m_nEvents(0), m_nBarriers(0), m_nOutOfOrder(0)
+{
+  m_event.reserve(1024*1024);
+}
+/**
+ * destructor
+ *   Sources belong to the caller.
+ */
+COfflineEventBuilder::~COfflineEventBuilder()
+{
+}
+
+/*----------------------------------------------------------------------------
+ * Public interface
+ */
+
+/**
+ * addSource
+ *   Add a stream to merge.  Must be called before run().
+ *
+ * @param pSource - The stream; it must outlive run().
+ */
+void
+COfflineEventBuilder::addSource(COfflineSource* pSource)
+{
+  Input input = {pSource, 0, 0, 0, 0, 0};
+  m_inputs.push_back(input);
+}
+/**
+ * run
+ *   Merge and build until all sources have ended.
+ *
+ * @throw std::string - from the sources and sink.
+ */
+void
+COfflineEventBuilder::run()
+{
+  outputFormat();
+  for (size_t i = 0; i < m_inputs.size(); i++) {
+    if (advance(m_inputs[i]) && !m_inputs[i].s_barrier) {
+      pushHeap(i);
+    }
+  }
+
+  do {
+    while (!m_heap.empty()) {
+      size_t i     = popHeap();
+      Input& input = m_inputs[i];
+      if (input.s_pItem->s_type == PHYSICS_EVENT) {
+        accumulate(input);
+      } else {
+        outputItem(input.s_pItem);
+      }
+      if (advance(input) && !input.s_barrier) {
+        pushHeap(i);
+      }
+    }
+  } while (outputBarriers());
+
+  flushEvent();
+  if (m_stateChangeNesting) {
+    outputAbnormalEnd();
+  }
+}
+
+/*----------------------------------------------------------------------------
+ * Merging
+ */
+
+/**
+ * advance
+ *   Load the next item of a source and figure out its timestamp, source
+ *   and barrier type.  Items we replace are skipped.
+ *
+ * @return bool - false if the source has ended.
+ * @throw std::string - a physics event has no body header.
+ */
+bool
+COfflineEventBuilder::advance(Input& input)
+{
+  while ((input.s_pItem = input.s_pSource->next())) {
+    uint32_t type = input.s_pItem->s_type;
+    if ((type == RING_FORMAT) || (type == EVB_GLOM_INFO)) {
+      continue;
+    }
+    const RingItem* pItem = reinterpret_cast<const RingItem*>(input.s_pItem);
+    bool hasBodyHeader =
+      (pItem->s_header.s_size >= (sizeof(RingItemHeader) + sizeof(BodyHeader))) &&
+      (pItem->s_body.u_noBodyHeader.s_mbz != 0);
+
+    uint64_t timestamp = NULL_TIMESTAMP;
+    if (hasBodyHeader) {
+      const BodyHeader& header(pItem->s_body.u_hasBodyHeader.s_bodyHeader);
+      timestamp         = header.s_timestamp;
+      input.s_sourceId  = header.s_sourceId;
+      input.s_barrier   = header.s_barrier;
+    } else if (type == PHYSICS_EVENT) {
+      throw std::string("Physics events must have body headers to be built offline");
+    } else {
+      input.s_barrier = ((type == BEGIN_RUN) || (type == END_RUN) ||
+                         (type == PAUSE_RUN) || (type == RESUME_RUN)) ? type : 0;
+    }
+    if (timestamp == NULL_TIMESTAMP) {
+      timestamp = input.s_lastTimestamp;
+    }
+    input.s_timestamp     = timestamp;
+    input.s_lastTimestamp = timestamp;
+    return true;
+  }
+  return false;
+}
+/**
+ * earlier
+ *   Heap ordering: by timestamp then by source order so equal timestamps
+ *   come out the way they went in.
+ */
+bool
+COfflineEventBuilder::earlier(size_t a, size_t b) const
+{
+  uint64_t ta = m_inputs[a].s_timestamp;
+  uint64_t tb = m_inputs[b].s_timestamp;
+  return (ta < tb) || ((ta == tb) && (a < b));
+}
+void
+COfflineEventBuilder::pushHeap(size_t input)
+{
+  m_heap.push_back(input);
+  std::push_heap(m_heap.begin(), m_heap.end(),
+                 [this](size_t a, size_t b) { return earlier(b, a); });
+}
+size_t
+COfflineEventBuilder::popHeap()
+{
+  std::pop_heap(m_heap.begin(), m_heap.end(),
+                [this](size_t a, size_t b) { return earlier(b, a); });
+  size_t result = m_heap.back();
+  m_heap.pop_back();
+  return result;
+}
+/**
+ * outputBarriers
+ *   Called when every source is at a barrier or has ended.  Outputs the
+ *   barriers and lets their sources continue.
+ *
+ * @return bool - false if all sources have ended.
+ */
+bool
+COfflineEventBuilder::outputBarriers()
+{
+  bool any = false;
+  for (size_t i = 0; i < m_inputs.size(); i++) {
+    Input& input = m_inputs[i];
+    if (input.s_pItem) {
+      if (!any) {
+        flushEvent();
+        any = true;
+      }
+      m_nBarriers++;
+      outputItem(input.s_pItem);
+      if (!m_glomParametersSent) {
+        outputGlomParameters();
+      }
+      if (advance(input) && !input.s_barrier) {
+        pushHeap(i);
+      }
+    }
+  }
+  return any;
+}
+
+/*----------------------------------------------------------------------------
+ * Building (see glom)
+ */
+
+/**
+ * accumulate
+ *   Add a physics event to the built event, first flushing the built
+ *   event if this one is outside its coincidence window.
+ */
+void
+COfflineEventBuilder::accumulate(const Input& input)
+{
+  uint64_t timestamp = input.s_timestamp;
+  if (timestamp < m_newestTimestamp) {
+    m_nOutOfOrder++;
+  }
+  m_newestTimestamp = timestamp;
+
+  if (!m_building || (m_nEventFragments && ((timestamp - m_firstTimestamp) > m_dt))) {
+    flushEvent();
+  }
+  if (!m_nEventFragments) {
+    m_event.resize(EventHeaderSize);
+    m_firstTimestamp = timestamp;
+    m_timestampSum   = 0;
+  }
+  m_lastTimestamp = timestamp;
+  m_timestampSum += timestamp;
+  m_nEventFragments++;
+  m_nFragments++;
+
+  EVB::FragmentHeader header;
+  header.s_timestamp = timestamp;
+  header.s_sourceId  = input.s_sourceId;
+  header.s_size      = input.s_pItem->s_size;
+  header.s_barrier   = input.s_barrier;
+
+  size_t offset = m_event.size();
+  m_event.resize(offset + sizeof(header) + header.s_size);
+  memcpy(&m_event[offset], &header, sizeof(header));
+  memcpy(&m_event[offset + sizeof(header)], input.s_pItem, header.s_size);
+}
+/**
+ * flushEvent
+ *   Output the event being built, if there is one.
+ */
+void
+COfflineEventBuilder::flushEvent()
+{
+  if (!m_nEventFragments) {
+    return;
+  }
+  uint64_t timestamp;
+  switch (m_policy) {
+  case Latest:
+    timestamp = m_lastTimestamp;
+    break;
+  case Average:
+    timestamp = m_timestampSum/m_nEventFragments;
+    break;
+  default:
+    timestamp = m_firstTimestamp;
+    break;
+  }
+
+  RingItemHeader header;
+  header.s_size = m_event.size();
+  header.s_type = PHYSICS_EVENT;
+
+  BodyHeader bodyHeader;
+  bodyHeader.s_size      = sizeof(BodyHeader);
+  bodyHeader.s_timestamp = timestamp;
+  bodyHeader.s_sourceId  = m_sourceId;
+  bodyHeader.s_barrier   = 0;
+
+  uint32_t eventSize = m_event.size() - EventHeaderSize + sizeof(uint32_t);
+
+  uint8_t* p = &m_event[0];
+  memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  memcpy(p, &bodyHeader, sizeof(bodyHeader));
+  p += sizeof(bodyHeader);
+  memcpy(p, &eventSize, sizeof(eventSize));
+
+  m_sink.put(&m_event[0], m_event.size());
+  m_nEvents++;
+  m_nEventFragments = 0;
+}
+/**
+ * outputItem
+ *   Output an item as is, keeping track of whether we are in a run.
+ */
+void
+COfflineEventBuilder::outputItem(const RingItemHeader* pItem)
+{
+  switch (pItem->s_type) {
+  case BEGIN_RUN:
+    {
+      const StateChangeItem* pState = reinterpret_cast<const StateChangeItem*>(pItem);
+      const RingItem*        pRing  = reinterpret_cast<const RingItem*>(pItem);
+      m_sink.beginRun(pRing->s_body.u_noBodyHeader.s_mbz ?
+                      pState->s_body.u_hasBodyHeader.s_body.s_runNumber :
+                      pState->s_body.u_noBodyHeader.s_body.s_runNumber);
+    }
+    m_stateChangeNesting++;
+    break;
+  case END_RUN:
+    if (m_stateChangeNesting) m_stateChangeNesting--;
+    break;
+  case ABNORMAL_ENDRUN:
+    m_stateChangeNesting = 0;
+    break;
+  }
+  m_sink.put(pItem, pItem->s_size);
+}
+void
+COfflineEventBuilder::outputFormat()
+{
+  DataFormat format;
+  format.s_header.s_size = sizeof(DataFormat);
+  format.s_header.s_type = RING_FORMAT;
+  format.s_mbz           = 0;
+  format.s_majorVersion  = FORMAT_MAJOR;
+  format.s_minorVersion  = FORMAT_MINOR;
+  m_sink.put(&format, sizeof(format));
+}
+void
+COfflineEventBuilder::outputGlomParameters()
+{
+  pGlomParameters p = formatGlomParameters(m_dt, m_building ? 1 : 0, m_policy);
+  m_sink.put(p, p->s_header.s_size);
+  free(p);
+  m_glomParametersSent = true;
+}
+void
+COfflineEventBuilder::outputAbnormalEnd()
+{
+  AbnormalEndItem end;
+  end.s_header.s_size = sizeof(AbnormalEndItem);
+  end.s_header.s_type = ABNORMAL_ENDRUN;
+  end.s_mbz           = 0;
+  m_sink.put(&end, sizeof(end));
+  m_stateChangeNesting = 0;
+}
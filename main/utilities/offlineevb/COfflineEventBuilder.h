@@ -0,0 +1,134 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file COfflineEventBuilder.h
+ * @brief Merge and build events from recorded data in one process.
+ */
+#ifndef COFFLINEEVENTBUILDER_H
+#define COFFLINEEVENTBUILDER_H
+
+#include "COfflineSource.h"
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @class COfflineEventBuilder
+ *
+ *   Does offline what the orderer and glom do online.  Each source is
+ *   a time ordered stream of ring items (normally one data source's run
+ *   segments).  The streams are merged by body header timestamp and
+ *   physics events are glued together into built events when their
+ *   timestamps are within the coincidence window of the first event
+ *   in the built event.  The output is what glom writes.
+ *
+ *   As in the orderer:
+ *   - Barriers (items whose body header has a barrier type and state
+ *     changes without body headers) hold their source until every source
+ *     is at a barrier or has ended.  The barriers are then output
+ *     together, in source order, after flushing the event being built.
+ *   - Items whose timestamp is NULL_TIMESTAMP or which have no body header
+ *     get the timestamp of the preceding item from their source.
+ *
+ *   As in glom, items other than physics events are output as soon as
+ *   they are merged without ending the event being built, and an abnormal
+ *   end run is output if the data end inside a run.  Ring format and glom
+ *   parameter items in the input are replaced by ones describing the
+ *   output.
+ */
+class COfflineEventBuilder
+{
+public:
+  // Values are those of GLOM_TIMESTAMP_*:
+
+  typedef enum _TimestampPolicy {
+    Earliest = 0,
+    Latest   = 1,
+    Average  = 2
+  } TimestampPolicy;
+
+private:
+  typedef struct _Input {
+    COfflineSource*       s_pSource;
+    const RingItemHeader* s_pItem;          // Head of the stream, 0 if ended.
+    uint64_t              s_timestamp;
+    uint32_t              s_sourceId;
+    uint32_t              s_barrier;
+    uint64_t              s_lastTimestamp;
+  } Input, *pInput;
+
+  COfflineSink&        m_sink;
+  uint64_t             m_dt;
+  bool                 m_building;
+  TimestampPolicy      m_policy;
+  uint32_t             m_sourceId;
+  std::vector<Input>   m_inputs;
+  std::vector<size_t>  m_heap;              // Inputs not held at a barrier.
+
+  // The event being built:
+
+  std::vector<uint8_t> m_event;
+  unsigned             m_nEventFragments;
+  uint64_t             m_firstTimestamp;
+  uint64_t             m_lastTimestamp;
+  uint64_t             m_timestampSum;
+
+  bool                 m_glomParametersSent;
+  unsigned             m_stateChangeNesting;
+  uint64_t             m_newestTimestamp;
+
+  // Statistics:
+
+  uint64_t             m_nFragments;
+  uint64_t             m_nEvents;
+  uint64_t             m_nBarriers;
+  uint64_t             m_nOutOfOrder;
+
+public:
+  COfflineEventBuilder(COfflineSink& sink, uint64_t dt, bool building = true,
+                       TimestampPolicy policy = Earliest, uint32_t sourceId = 0);
+  virtual ~COfflineEventBuilder();
+
+private:
+  COfflineEventBuilder(const COfflineEventBuilder& rhs);
+  COfflineEventBuilder& operator=(const COfflineEventBuilder& rhs);
+
+public:
+  void addSource(COfflineSource* pSource);
+  void run();
+
+  uint64_t fragments()  const { return m_nFragments; }
+  uint64_t events()     const { return m_nEvents; }
+  uint64_t barriers()   const { return m_nBarriers; }
+  uint64_t outOfOrder() const { return m_nOutOfOrder; }
+
+private:
+  bool advance(Input& input);
+  bool earlier(size_t a, size_t b) const;
+  void pushHeap(size_t input);
+  size_t popHeap();
+  bool outputBarriers();
+  void accumulate(const Input& input);
+  void flushEvent();
+  void outputItem(const RingItemHeader* pItem);
+  void outputFormat();
+  void outputGlomParameters();
+  void outputAbnormalEnd();
+};
+
+#endif
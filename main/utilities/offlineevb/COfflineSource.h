@@ -0,0 +1,67 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file COfflineSource.h
+ * @brief Interfaces for the ends of the offline event builder.
+ */
+#ifndef COFFLINESOURCE_H
+#define COFFLINESOURCE_H
+
+#include <DataFormat.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class COfflineSource
+ *
+ *   A time ordered stream of ring items from one or more data sources,
+ *   e.g. the event segments of one source's run.
+ */
+class COfflineSource
+{
+public:
+  virtual ~COfflineSource() {}
+
+  /**
+   * next
+   *   @return const RingItemHeader* - the next ring item or 0 at the end
+   *           of the stream.  The item is only valid until the next call.
+   *   @throw std::string - on read errors or malformed data.
+   */
+  virtual const RingItemHeader* next() = 0;
+};
+
+/**
+ * @class COfflineSink
+ *
+ *   Destination of built data.
+ */
+class COfflineSink
+{
+public:
+  virtual ~COfflineSink() {}
+
+  virtual void put(const void* pData, size_t nBytes) = 0;
+
+  /**
+   * beginRun
+   *   Called before the first begin run item of each run is put.
+   */
+  virtual void beginRun(uint32_t run) {}
+};
+
+#endif
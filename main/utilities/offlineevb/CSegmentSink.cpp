@@ -0,0 +1,245 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CSegmentSink.cpp
+ * @brief Implement writing event segments.
+ */
+
+#include <config.h>
+#include "CSegmentSink.h"
+
+#include <CCompressedSegmentWriter.h>
+#include <io.h>
+
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *
+ * @param path             - Directory in which segments are written.
+ * @param prefix           - Segment file name prefix (e.g. "run").
+ * @param segmentSize      - Largest segment in bytes.
+ * @param compress         - Write block compressed segments.
+ * @param compressionLevel - zlib level for compressed segments.
+ */
+CSegmentSink::CSegmentSink(std::string path, std::string prefix,
+                           uint64_t segmentSize, bool compress,
+                           int compressionLevel) :
+  m_path(path), m_prefix(prefix), m_segmentSize(segmentSize),
+  m_compress(compress), m_compressionLevel(compressionLevel),
+  m_haveRun(false), m_run(0), m_segment(0), m_fd(-1), m_pWriter(0),
+  m_bytesInSegment(0)
+{
+}
+/**
+ * destructor
+ *   Errors can't be reported here; call close() to find out about them.
+ */
+CSegmentSink::~CSegmentSink()
+{
+  try {
+    close();
+  }
+  catch (...) {
+  }
+}
+
+/*----------------------------------------------------------------------------
+ * Public interface
+ */
+
+/**
+ * setRun
+ *   Fix the run number used to name the segments.  Once set, begin run
+ *   items don't change it.
+ */
+void
+CSegmentSink::setRun(uint32_t run)
+{
+  m_run     = run;
+  m_haveRun = true;
+}
+/**
+ * beginRun
+ *   The first begin run supplies the run number if it was not set.
+ */
+void
+CSegmentSink::beginRun(uint32_t run)
+{
+  if (!m_haveRun) {
+    setRun(run);
+  }
+  if (m_fd < 0) {
+    open();
+  }
+}
+/**
+ * put
+ *   Write an item, starting a new segment if needed.
+ *
+ * @throw std::string - the data could not be written.
+ */
+void
+CSegmentSink::put(const void* pData, size_t nBytes)
+{
+  if (m_fd < 0) {
+    if (!m_haveRun) {
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(pData);
+      m_held.insert(m_held.end(), p, p + nBytes);
+      return;
+    }
+    open();
+  }
+  uint64_t used = m_pWriter ?
+    (m_pWriter->bytesWritten() + m_pWriter->pendingBytes()) : m_bytesInSegment;
+  if (used && ((used + nBytes) > m_segmentSize)) {
+    closeSegment();
+    m_segment++;
+    open();
+  }
+  write(pData, nBytes);
+}
+/**
+ * close
+ *   Finish the last segment.  If the run was never known, what was held
+ *   is written to run 0.
+ */
+void
+CSegmentSink::close()
+{
+  if ((m_fd < 0) && !m_held.empty()) {
+    open();
+  }
+  closeSegment();
+}
+/**
+ * segmentName
+ *   @return std::string - the name of a segment file.
+ */
+std::string
+CSegmentSink::segmentName(std::string path, std::string prefix,
+                          uint32_t run, unsigned segment)
+{
+  char name[100];
+  snprintf(name, sizeof(name), "/%s-%04d-%02d.evt", prefix.c_str(), run, segment);
+  return path + name;
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities
+ */
+
+/**
+ * open
+ *   Open the current segment and write anything held for it.
+ */
+void
+CSegmentSink::open()
+{
+  std::string name = segmentName(m_path, m_prefix, m_run, m_segment);
+  m_fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (m_fd < 0) {
+    std::string msg = "Unable to open event segment ";
+    msg += name + ": ";
+    msg += strerror(errno);
+    throw msg;
+  }
+  m_written.push_back(name);
+  m_bytesInSegment = 0;
+  if (m_compress) {
+    m_pWriter = new CCompressedSegmentWriter(
+      m_fd, CCompressedSegmentWriter::DefaultBlockSize, m_compressionLevel
+    );
+  }
+  if (!m_held.empty()) {
+    std::vector<uint8_t> held;
+    held.swap(m_held);
+    write(&held[0], held.size());
+  }
+}
+/**
+ * closeSegment
+ *   Finish and close the current segment if there is one.
+ */
+void
+CSegmentSink::closeSegment()
+{
+  if (m_fd >= 0) {
+    int fd = m_fd;
+    m_fd = -1;
+    try {
+      if (m_pWriter) {
+        m_pWriter->finish();
+      }
+    }
+    catch (int e) {
+      delete m_pWriter;
+      m_pWriter = 0;
+      ::close(fd);
+      std::string msg = "Unable to finish a compressed event segment: ";
+      msg += strerror(e);
+      throw msg;
+    }
+    catch (std::exception& e) {
+      delete m_pWriter;
+      m_pWriter = 0;
+      ::close(fd);
+      std::string msg = "Unable to finish a compressed event segment: ";
+      msg += e.what();
+      throw msg;
+    }
+    delete m_pWriter;
+    m_pWriter = 0;
+    ::close(fd);
+  }
+}
+/**
+ * write
+ *   Write to the current segment.
+ */
+void
+CSegmentSink::write(const void* pData, size_t nBytes)
+{
+  try {
+    if (m_pWriter) {
+      m_pWriter->write(pData, nBytes);
+    } else {
+      io::writeData(m_fd, pData, nBytes);
+    }
+  }
+  catch (int e) {
+    std::string msg = "Unable to write an event segment: ";
+    msg += strerror(e);
+    throw msg;
+  }
+  catch (std::exception& e) {
+    std::string msg = "Unable to write an event segment: ";
+    msg += e.what();
+    throw msg;
+  }
+  m_bytesInSegment += nBytes;
+}
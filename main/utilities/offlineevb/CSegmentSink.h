@@ -0,0 +1,88 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CSegmentSink.h
+ * @brief Write built data as event segments.
+ */
+#ifndef CSEGMENTSINK_H
+#define CSEGMENTSINK_H
+
+#include "COfflineSource.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class CCompressedSegmentWriter;
+
+/**
+ * @class CSegmentSink
+ *
+ *   Writes items into event segment files named as eventlog names them:
+ *   path/prefix-run-segment.evt with the run in %04d and the segment in
+ *   %02d.  A new segment is started when the next item would make the
+ *   current one larger than the segment size.  Segments can be block
+ *   compressed (see CCompressedSegmentWriter).
+ *
+ *   If no run number is given, the segment is opened at the first begin
+ *   run and the items that came before it are held until then.
+ */
+class CSegmentSink : public COfflineSink
+{
+private:
+  std::string               m_path;
+  std::string               m_prefix;
+  uint64_t                  m_segmentSize;
+  bool                      m_compress;
+  int                       m_compressionLevel;
+
+  bool                      m_haveRun;
+  uint32_t                  m_run;
+  unsigned                  m_segment;
+  int                       m_fd;
+  CCompressedSegmentWriter* m_pWriter;
+  uint64_t                  m_bytesInSegment;
+  std::vector<uint8_t>      m_held;	// Items put before the run is known.
+  std::vector<std::string>  m_written;
+
+public:
+  CSegmentSink(std::string path, std::string prefix, uint64_t segmentSize,
+               bool compress = false, int compressionLevel = 1);
+  virtual ~CSegmentSink();
+
+private:
+  CSegmentSink(const CSegmentSink& rhs);
+  CSegmentSink& operator=(const CSegmentSink& rhs);
+
+public:
+  void setRun(uint32_t run);
+  void close();
+  const std::vector<std::string>& segments() const { return m_written; }
+
+  virtual void put(const void* pData, size_t nBytes);
+  virtual void beginRun(uint32_t run);
+
+  static std::string segmentName(std::string path, std::string prefix,
+                                 uint32_t run, unsigned segment);
+
+private:
+  void open();
+  void closeSegment();
+  void write(const void* pData, size_t nBytes);
+};
+
+#endif
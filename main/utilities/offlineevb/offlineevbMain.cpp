@@ -0,0 +1,157 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file offlineevbMain.cpp
+ * @brief Main program of the offline event builder.
+ */
+
+#include <config.h>
+#include "offlineevbargs.h"
+#include "COfflineEventBuilder.h"
+#include "CFileSegmentSource.h"
+#include "CSegmentSink.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <exception>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint64_t K(1024);
+static const uint64_t M(K*K);
+static const uint64_t G(K*M);
+
+/*
+** Decode a segment size of the form number, numberk, numberm or numberg
+** as eventlog does.  Exits on errors.
+*/
+static uint64_t
+segmentSize(const char* pValue)
+{
+  char*    end;
+  uint64_t size = strtoull(pValue, &end, 0);
+  if (strlen(end) < 2) {
+    if (*end == 'g') {
+      size *= G;
+    } else if (*end == 'm') {
+      size *= M;
+    } else if (*end == 'k') {
+      size *= K;
+    } else if (*end) {
+      std::cerr << "Segment size multipliers must be one of g, m, or k\n";
+      exit(EXIT_FAILURE);
+    }
+    if (size) {
+      return size;
+    }
+  }
+  std::cerr << "Segment sizes must be a nonzero integer, or an integer followed by g, m, or k\n";
+  exit(EXIT_FAILURE);
+}
+/*
+** Split a source into its comma separated segments.
+*/
+static std::vector<std::string>
+segments(std::string source)
+{
+  std::vector<std::string> result;
+  size_t start = 0;
+  while (start <= source.size()) {
+    size_t comma = source.find(',', start);
+    if (comma == std::string::npos) {
+      comma = source.size();
+    }
+    if (comma > start) {
+      result.push_back(source.substr(start, comma - start));
+    }
+    start = comma + 1;
+  }
+  return result;
+}
+
+/**
+ * main
+ *   Parse the parameters, set up a source per file list and build.
+ */
+int
+main(int argc, char** argv)
+{
+  gengetopt_args_info args;
+  if (cmdline_parser(argc, argv, &args)) {
+    exit(EXIT_FAILURE);
+  }
+  if (args.inputs_num == 0) {
+    std::cerr << "offlineevb: at least one source must be given\n";
+    cmdline_parser_print_help();
+    exit(EXIT_FAILURE);
+  }
+  if (!args.nobuild_flag && (args.dt_arg < 0)) {
+    std::cerr << "Coincidence window must be >= 0 was " << args.dt_arg << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  uint64_t maxSegment = args.segmentsize_given ?
+    segmentSize(args.segmentsize_arg) : static_cast<uint64_t>(1.9*G);
+
+  std::vector<CFileSegmentSource*> sources;
+  int status = EXIT_SUCCESS;
+  try {
+    CSegmentSink sink(args.path_arg, args.prefix_arg, maxSegment,
+                      args.compress_flag, args.compression_level_arg);
+    if (args.run_given) {
+      sink.setRun(args.run_arg);
+    }
+    COfflineEventBuilder builder(
+      sink, args.dt_arg, !args.nobuild_flag,
+      static_cast<COfflineEventBuilder::TimestampPolicy>(args.timestamp_policy_arg),
+      args.sourceid_arg
+    );
+    for (unsigned i = 0; i < args.inputs_num; i++) {
+      sources.push_back(new CFileSegmentSource(segments(args.inputs[i])));
+      builder.addSource(sources.back());
+    }
+
+    builder.run();
+    sink.close();
+
+    std::cerr << "offlineevb: " << sources.size() << " sources, "
+              << builder.fragments() << " fragments built into "
+              << builder.events() << " events, "
+              << builder.barriers() << " barriers\n";
+    if (builder.outOfOrder()) {
+      std::cerr << "offlineevb: " << builder.outOfOrder()
+                << " fragments were out of timestamp order in their source\n";
+    }
+    const std::vector<std::string>& written(sink.segments());
+    for (size_t i = 0; i < written.size(); i++) {
+      std::cerr << "offlineevb: wrote " << written[i] << std::endl;
+    }
+  }
+  catch (std::string msg) {
+    std::cerr << "offlineevb: " << msg << std::endl;
+    status = EXIT_FAILURE;
+  }
+  catch (std::exception& e) {
+    std::cerr << "offlineevb: " << e.what() << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  for (size_t i = 0; i < sources.size(); i++) {
+    delete sources[i];
+  }
+  return status;
+}
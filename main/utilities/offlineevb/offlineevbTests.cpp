@@ -0,0 +1,438 @@
+// Tests for the offline event builder.
+
+#include <config.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include "COfflineEventBuilder.h"
+#include "CFileSegmentSource.h"
+#include "CSegmentSink.h"
+#include <DataFormat.h>
+#include <fragment.h>
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+typedef vector<uint8_t> Item;
+
+// Make ring items:
+
+static Item
+item(uint32_t type, uint64_t timestamp, uint32_t sourceId, uint32_t barrier = 0,
+     uint32_t payload = 0)
+{
+  Item result(sizeof(RingItemHeader) + sizeof(BodyHeader) + sizeof(uint32_t));
+  pRingItem p = reinterpret_cast<pRingItem>(&result[0]);
+  p->s_header.s_size = result.size();
+  p->s_header.s_type = type;
+  BodyHeader& h(p->s_body.u_hasBodyHeader.s_bodyHeader);
+  h.s_size      = sizeof(BodyHeader);
+  h.s_timestamp = timestamp;
+  h.s_sourceId  = sourceId;
+  h.s_barrier   = barrier;
+  memcpy(p->s_body.u_hasBodyHeader.s_body, &payload, sizeof(payload));
+  return result;
+}
+static Item
+noBodyHeader(uint32_t type)
+{
+  Item result(sizeof(RingItemHeader) + 2*sizeof(uint32_t));
+  pRingItem p = reinterpret_cast<pRingItem>(&result[0]);
+  p->s_header.s_size = result.size();
+  p->s_header.s_type = type;
+  p->s_body.u_noBodyHeader.s_mbz = 0;
+  return result;
+}
+static Item
+stateChange(uint32_t type, uint32_t run, uint64_t timestamp, uint32_t sourceId)
+{
+  Item result(sizeof(StateChangeItem));
+  pStateChangeItem p = reinterpret_cast<pStateChangeItem>(&result[0]);
+  p->s_header.s_size = result.size();
+  p->s_header.s_type = type;
+  BodyHeader& h(p->s_body.u_hasBodyHeader.s_bodyHeader);
+  h.s_size      = sizeof(BodyHeader);
+  h.s_timestamp = timestamp;
+  h.s_sourceId  = sourceId;
+  h.s_barrier   = (type == BEGIN_RUN) ? BARRIER_START : BARRIER_END;
+  p->s_body.u_hasBodyHeader.s_body.s_runNumber = run;
+  return result;
+}
+static Item
+event(uint64_t timestamp, uint32_t sourceId)
+{
+  return item(PHYSICS_EVENT, timestamp, sourceId);
+}
+
+// A source of items held in memory and a sink that keeps what it gets:
+
+class MemorySource : public COfflineSource
+{
+  vector<Item> m_items;
+  size_t       m_next;
+public:
+  MemorySource() : m_next(0) {}
+  MemorySource& operator<<(const Item& i) { m_items.push_back(i); return *this; }
+  virtual const RingItemHeader* next() {
+    if (m_next >= m_items.size()) return 0;
+    return reinterpret_cast<const RingItemHeader*>(&m_items[m_next++][0]);
+  }
+};
+
+class MemorySink : public COfflineSink
+{
+public:
+  vector<Item>     m_items;
+  vector<uint32_t> m_runs;
+  virtual void put(const void* pData, size_t nBytes) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(pData);
+    m_items.push_back(Item(p, p + nBytes));
+  }
+  virtual void beginRun(uint32_t run) { m_runs.push_back(run); }
+
+  uint32_t type(size_t i) {
+    return reinterpret_cast<pRingItemHeader>(&m_items.at(i)[0])->s_type;
+  }
+  uint64_t timestamp(size_t i) {
+    return reinterpret_cast<pRingItem>(&m_items.at(i)[0])
+      ->s_body.u_hasBodyHeader.s_bodyHeader.s_timestamp;
+  }
+  // Timestamps of the fragments of a built event:
+  vector<uint64_t> fragments(size_t i) {
+    vector<uint64_t> result;
+    pRingItem p = reinterpret_cast<pRingItem>(&m_items.at(i)[0]);
+    uint8_t*  pBody = p->s_body.u_hasBodyHeader.s_body;
+    uint32_t  size  = *reinterpret_cast<uint32_t*>(pBody) - sizeof(uint32_t);
+    uint8_t*  pFrag = pBody + sizeof(uint32_t);
+    while (size) {
+      EVB::pFragmentHeader h = reinterpret_cast<EVB::pFragmentHeader>(pFrag);
+      result.push_back(h->s_timestamp);
+      size_t n = sizeof(EVB::FragmentHeader) + h->s_size;
+      pFrag += n;
+      size  -= n;
+    }
+    return result;
+  }
+};
+
+static vector<uint64_t>
+stamps(uint64_t a, uint64_t b = NULL_TIMESTAMP, uint64_t c = NULL_TIMESTAMP)
+{
+  vector<uint64_t> result;
+  result.push_back(a);
+  if (b != NULL_TIMESTAMP) result.push_back(b);
+  if (c != NULL_TIMESTAMP) result.push_back(c);
+  return result;
+}
+
+
+class OfflineEvbTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(OfflineEvbTests);
+  CPPUNIT_TEST(Merge);
+  CPPUNIT_TEST(Window);
+  CPPUNIT_TEST(Policy);
+  CPPUNIT_TEST(Barriers);
+  CPPUNIT_TEST(NullTimestamp);
+  CPPUNIT_TEST(AbnormalEnd);
+  CPPUNIT_TEST(NoBodyHeader);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  MemorySource* m_pA;
+  MemorySource* m_pB;
+  MemorySink*   m_pSink;
+public:
+  void setUp() {
+    m_pA    = new MemorySource;
+    m_pB    = new MemorySource;
+    m_pSink = new MemorySink;
+  }
+  void tearDown() {
+    delete m_pA;
+    delete m_pB;
+    delete m_pSink;
+  }
+protected:
+  void Merge();
+  void Window();
+  void Policy();
+  void Barriers();
+  void NullTimestamp();
+  void AbnormalEnd();
+  void NoBodyHeader();
+private:
+  void build(uint64_t dt, bool building = true,
+             COfflineEventBuilder::TimestampPolicy policy = COfflineEventBuilder::Earliest) {
+    COfflineEventBuilder builder(*m_pSink, dt, building, policy, 99);
+    builder.addSource(m_pA);
+    builder.addSource(m_pB);
+    builder.run();
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(OfflineEvbTests);
+
+// Without building, fragments come out one per event in timestamp order.
+
+void
+OfflineEvbTests::Merge()
+{
+  *m_pA << event(1, 1) << event(4, 1) << event(5, 1);
+  *m_pB << event(2, 2) << event(3, 2) << event(6, 2);
+  build(0, false);
+
+  EQ(size_t(7), m_pSink->m_items.size());
+  EQ(RING_FORMAT, m_pSink->type(0));
+  for (int i = 1; i < 7; i++) {
+    EQ(PHYSICS_EVENT, m_pSink->type(i));
+    EQ(uint64_t(i), m_pSink->timestamp(i));
+    ASSERT(stamps(i) == m_pSink->fragments(i));
+  }
+}
+
+// Fragments within dt of the first of an event are built together.
+
+void
+OfflineEvbTests::Window()
+{
+  *m_pA << event(0, 1) << event(5, 1) << event(30, 1);
+  *m_pB << event(3, 2) << event(20, 2);
+  build(10);
+
+  EQ(size_t(3), m_pSink->m_items.size());
+  ASSERT(stamps(0, 3, 5) == m_pSink->fragments(1));
+  ASSERT(stamps(20, 30) == m_pSink->fragments(2));     // 30 - 20 == dt is in.
+  EQ(uint64_t(0), m_pSink->timestamp(1));
+}
+
+void
+OfflineEvbTests::Policy()
+{
+  *m_pA << event(10, 1) << event(30, 1);
+  *m_pB << event(14, 2) << event(32, 2);
+  build(10, true, COfflineEventBuilder::Average);
+  EQ(uint64_t(12), m_pSink->timestamp(1));
+  EQ(uint64_t(31), m_pSink->timestamp(2));
+
+  MemorySource a;
+  MemorySource b;
+  MemorySink   sink;
+  a << event(10, 1);
+  b << event(14, 2);
+  COfflineEventBuilder builder(sink, 10, true, COfflineEventBuilder::Latest);
+  builder.addSource(&a);
+  builder.addSource(&b);
+  builder.run();
+  EQ(uint64_t(14), sink.timestamp(1));
+}
+
+// A source at a barrier waits for the others.
+
+void
+OfflineEvbTests::Barriers()
+{
+  *m_pA << stateChange(BEGIN_RUN, 12, 0, 1) << event(10, 1)
+        << stateChange(END_RUN, 12, 11, 1)
+        << stateChange(BEGIN_RUN, 13, 12, 1) << event(40, 1);
+  *m_pB << stateChange(BEGIN_RUN, 12, 0, 2) << event(20, 2) << event(30, 2)
+        << stateChange(END_RUN, 12, 31, 2)
+        << stateChange(BEGIN_RUN, 13, 32, 2) << event(50, 2)
+        << stateChange(END_RUN, 13, 51, 2);
+  build(0);
+
+  uint32_t expected[] = {
+    RING_FORMAT, BEGIN_RUN, EVB_GLOM_INFO, BEGIN_RUN,
+    PHYSICS_EVENT, PHYSICS_EVENT, PHYSICS_EVENT,
+    END_RUN, END_RUN, BEGIN_RUN, BEGIN_RUN,
+    PHYSICS_EVENT, PHYSICS_EVENT, END_RUN, ABNORMAL_ENDRUN
+  };
+  size_t n = sizeof(expected)/sizeof(uint32_t);
+  EQ(n, m_pSink->m_items.size());
+  for (size_t i = 0; i < n; i++) {
+    EQMSG("type", expected[i], m_pSink->type(i));
+  }
+  EQ(uint64_t(10), m_pSink->timestamp(4));
+  EQ(uint64_t(30), m_pSink->timestamp(6));
+  EQ(uint64_t(40), m_pSink->timestamp(11));
+
+  EQ(size_t(4), m_pSink->m_runs.size());
+  EQ(uint32_t(12), m_pSink->m_runs[0]);
+  EQ(uint32_t(13), m_pSink->m_runs[3]);
+}
+
+// Items without timestamps take the previous one from their source and
+// non physics items don't end the built event.
+
+void
+OfflineEvbTests::NullTimestamp()
+{
+  *m_pA << event(10, 1) << noBodyHeader(PERIODIC_SCALERS) << event(30, 1);
+  *m_pB << event(20, 2);
+  *m_pA << item(MONITORED_VARIABLES, NULL_TIMESTAMP, 1);
+  build(100);
+
+  EQ(size_t(4), m_pSink->m_items.size());
+  EQ(PERIODIC_SCALERS, m_pSink->type(1));
+  EQ(MONITORED_VARIABLES, m_pSink->type(2));
+  EQ(PHYSICS_EVENT, m_pSink->type(3));
+  ASSERT(stamps(10, 20, 30) == m_pSink->fragments(3));
+}
+
+void
+OfflineEvbTests::AbnormalEnd()
+{
+  *m_pA << stateChange(BEGIN_RUN, 1, 0, 1) << event(10, 1);
+  build(0);
+  EQ(ABNORMAL_ENDRUN, m_pSink->type(m_pSink->m_items.size() - 1));
+}
+
+void
+OfflineEvbTests::NoBodyHeader()
+{
+  *m_pA << noBodyHeader(PHYSICS_EVENT);
+  EXCEPTION(build(0), std::string);
+}
+
+// Reading and writing segments:
+
+class SegmentTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(SegmentTests);
+  CPPUNIT_TEST(ReadSegments);
+  CPPUNIT_TEST(RunFromBegin);
+  CPPUNIT_TEST(Rollover);
+  CPPUNIT_TEST(Compressed);
+  CPPUNIT_TEST(Truncated);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  string m_dir;
+public:
+  void setUp() {
+    char dir[] = "/tmp/offlineevbXXXXXX";
+    m_dir = mkdtemp(dir);
+  }
+  void tearDown() {
+    string cmd = "rm -rf " + m_dir;
+    system(cmd.c_str());
+  }
+protected:
+  void ReadSegments();
+  void RunFromBegin();
+  void Rollover();
+  void Compressed();
+  void Truncated();
+private:
+  string writeFile(string name, const vector<Item>& items) {
+    string path = m_dir + "/" + name;
+    FILE* f = fopen(path.c_str(), "w");
+    for (size_t i = 0; i < items.size(); i++) {
+      fwrite(&items[i][0], 1, items[i].size(), f);
+    }
+    fclose(f);
+    return path;
+  }
+  vector<uint64_t> readStamps(const vector<string>& files) {
+    vector<uint64_t> result;
+    CFileSegmentSource source(files);
+    const RingItemHeader* p;
+    while ((p = source.next())) {
+      result.push_back(reinterpret_cast<const RingItem*>(p)
+                       ->s_body.u_hasBodyHeader.s_bodyHeader.s_timestamp);
+    }
+    return result;
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(SegmentTests);
+
+void
+SegmentTests::ReadSegments()
+{
+  vector<Item> one;
+  one.push_back(event(1, 1));
+  one.push_back(event(2, 1));
+  vector<string> files;
+  files.push_back(writeFile("a.evt", one));
+  files.push_back(writeFile("empty.evt", vector<Item>()));
+  one.clear();
+  one.push_back(event(3, 1));
+  files.push_back(writeFile("b.evt", one));
+
+  ASSERT(stamps(1, 2, 3) == readStamps(files));
+}
+
+void
+SegmentTests::RunFromBegin()
+{
+  CSegmentSink sink(m_dir, "run", 1024*1024);
+  Item e = event(1, 1);
+  sink.put(&e[0], e.size());             // Held until the run is known.
+  sink.beginRun(42);
+  Item b = stateChange(BEGIN_RUN, 42, 0, 1);
+  sink.put(&b[0], b.size());
+  sink.close();
+
+  EQ(size_t(1), sink.segments().size());
+  EQ(m_dir + "/run-0042-00.evt", sink.segments()[0]);
+  struct stat info;
+  EQ(0, stat(sink.segments()[0].c_str(), &info));
+  EQ(off_t(e.size() + b.size()), info.st_size);
+}
+
+void
+SegmentTests::Rollover()
+{
+  Item e = event(1, 1);
+  CSegmentSink sink(m_dir, "built", 2*e.size() + 1);
+  sink.setRun(7);
+  for (int i = 0; i < 5; i++) {
+    Item e = event(i, 1);
+    sink.put(&e[0], e.size());
+  }
+  sink.close();
+
+  EQ(size_t(3), sink.segments().size());
+  EQ(CSegmentSink::segmentName(m_dir, "built", 7, 2), sink.segments()[2]);
+
+  vector<uint64_t> expected;
+  for (int i = 0; i < 5; i++) expected.push_back(i);
+  ASSERT(expected == readStamps(sink.segments()));
+}
+
+void
+SegmentTests::Compressed()
+{
+  CSegmentSink sink(m_dir, "run", 1024*1024, true);
+  sink.setRun(1);
+  vector<uint64_t> expected;
+  for (int i = 0; i < 1000; i++) {
+    Item e = item(PHYSICS_EVENT, i, 1, 0, i);
+    sink.put(&e[0], e.size());
+    expected.push_back(i);
+  }
+  sink.close();
+
+  ASSERT(expected == readStamps(sink.segments()));
+}
+
+void
+SegmentTests::Truncated()
+{
+  vector<Item> items;
+  items.push_back(event(1, 1));
+  string name = writeFile("a.evt", items);
+  truncate(name.c_str(), items[0].size() - 2);
+
+  vector<string> files;
+  files.push_back(name);
+  EXCEPTION(readStamps(files), std::string);
+}
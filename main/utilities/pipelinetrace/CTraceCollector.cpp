@@ -0,0 +1,175 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CTraceCollector.cpp
+ * @brief Implement the trace hop collector.
+ */
+
+#include <config.h>
+#include "CTraceCollector.h"
+
+#include <algorithm>
+#include <vector>
+#include <iomanip>
+#include <string.h>
+
+/**
+ * constructor
+ *
+ * @param holdNs - How long after its last hop an item's hops are
+ *                 considered complete.
+ */
+CTraceCollector::CTraceCollector(uint64_t holdNs) :
+  m_holdNs(holdNs), m_items(0), m_singles(0), m_lost(0)
+{
+}
+
+/**
+ * add
+ *   Add a hop to the hops of its item.
+ */
+void
+CTraceCollector::add(const CPipelineTrace::Hop& hop)
+{
+  std::map<uint64_t, Chain>::iterator p = m_pending.find(hop.s_timestamp);
+  if (p == m_pending.end()) {
+    Chain chain;
+    memset(&chain, 0, sizeof(chain));
+    p = m_pending.insert(std::make_pair(hop.s_timestamp, chain)).first;
+  }
+  Chain& chain = p->second;
+  if (chain.s_ns[hop.s_stage] == 0) {
+    chain.s_ns[hop.s_stage] = hop.s_ns;
+  }
+  if (hop.s_ns > chain.s_lastNs) {
+    chain.s_lastNs = hop.s_ns;
+  }
+}
+/**
+ * complete
+ *   Histogram the items whose last hop is older than the hold time.
+ *
+ * @param nowNs - The current monotonic time.
+ */
+void
+CTraceCollector::complete(uint64_t nowNs)
+{
+  std::map<uint64_t, Chain>::iterator p = m_pending.begin();
+  while (p != m_pending.end()) {
+    if (p->second.s_lastNs + m_holdNs <= nowNs) {
+      histogram(p->second);
+      m_pending.erase(p++);
+    } else {
+      ++p;
+    }
+  }
+}
+/**
+ * completeAll
+ *   Histogram all items regardless of age (e.g. at exit).
+ */
+void
+CTraceCollector::completeAll()
+{
+  std::map<uint64_t, Chain>::iterator p;
+  for (p = m_pending.begin(); p != m_pending.end(); ++p) {
+    histogram(p->second);
+  }
+  m_pending.clear();
+}
+/**
+ * clear
+ *   Forget the histograms and counters; pending items are kept.
+ */
+void
+CTraceCollector::clear()
+{
+  m_hops.clear();
+  m_endToEnd.clear();
+  m_items = m_singles = m_lost = 0;
+}
+/**
+ * report
+ *   Write a table of the histograms: one line per stage pair with the
+ *   count, mean, median, 99th percentile and maximum in microseconds.
+ */
+void
+CTraceCollector::report(std::ostream& out) const
+{
+  out << m_items << " traced items (" << m_singles
+      << " seen by only one stage), " << m_lost << " hops lost\n";
+  reportHistograms(out, "Stage to stage", m_hops);
+  reportHistograms(out, "End to end", m_endToEnd);
+}
+
+/*
+** Histogram the intervals of one item: between successive stages in
+** time order and from the first stage to the last.
+*/
+void
+CTraceCollector::histogram(const Chain& chain)
+{
+  std::vector<std::pair<uint64_t, unsigned> > seen;
+  for (unsigned s = 0; s < CPipelineTrace::NumStages; s++) {
+    if (chain.s_ns[s]) {
+      seen.push_back(std::make_pair(chain.s_ns[s], s));
+    }
+  }
+  std::sort(seen.begin(), seen.end());
+  m_items++;
+  if (seen.size() < 2) {
+    m_singles++;
+    return;
+  }
+  for (size_t i = 1; i < seen.size(); i++) {
+    m_hops[StagePair(seen[i-1].second, seen[i].second)].add(
+      seen[i].first - seen[i-1].first
+    );
+  }
+  m_endToEnd[StagePair(seen.front().second, seen.back().second)].add(
+    seen.back().first - seen.front().first
+  );
+}
+/*
+** Write one table.
+*/
+void
+CTraceCollector::reportHistograms(std::ostream& out, const char* title,
+                                  const Histograms& histograms)
+{
+  if (histograms.empty()) return;
+
+  out << title << " latencies (us):\n";
+  out << std::setw(30) << std::left << "  stages" << std::right
+      << std::setw(10) << "count" << std::setw(12) << "mean"
+      << std::setw(12) << "p50" << std::setw(12) << "p99"
+      << std::setw(12) << "max" << std::endl;
+
+  Histograms::const_iterator p;
+  for (p = histograms.begin(); p != histograms.end(); ++p) {
+    CLatencyHistogram::Snapshot data = p->second.snapshot();
+    std::string stages = std::string("  ") +
+      CPipelineTrace::stageName(p->first.first) + " -> " +
+      CPipelineTrace::stageName(p->first.second);
+    out << std::setw(30) << std::left << stages << std::right
+        << std::setw(10) << data.s_count << std::fixed << std::setprecision(1)
+        << std::setw(12) << (data.s_count ? data.s_sum/1000.0/data.s_count : 0.0)
+        << std::setw(12) << CLatencyHistogram::percentile(data, 0.5)/1000.0
+        << std::setw(12) << CLatencyHistogram::percentile(data, 0.99)/1000.0
+        << std::setw(12) << data.s_max/1000.0 << std::endl;
+  }
+}
@@ -0,0 +1,88 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CTraceCollector.h
+ * @brief Turn pipeline trace hops into per stage latency histograms.
+ */
+#ifndef CTRACECOLLECTOR_H
+#define CTRACECOLLECTOR_H
+
+#include <CPipelineTrace.h>
+#include <CLatencyHistogram.h>
+
+#include <map>
+#include <utility>
+#include <ostream>
+#include <stdint.h>
+
+/**
+ * @class CTraceCollector
+ *
+ *   Groups the hops of CPipelineTrace by item timestamp.  Once no hop has
+ *   arrived for a timestamp for a while (the hold time) its hops are
+ *   sorted by time and the time between each pair of successive stages is
+ *   histogrammed, as is the time from the first to the last stage.
+ *   Sorting by time rather than by stage lets the same collector handle
+ *   any arrangement of the stages.
+ *
+ *   If a stage sees more than one item with the same timestamp (e.g. two
+ *   sources with equal timestamps) only the first hop is used.
+ */
+class CTraceCollector
+{
+public:
+  typedef std::pair<unsigned, unsigned>            StagePair;
+  typedef std::map<StagePair, CLatencyHistogram>   Histograms;
+
+private:
+  typedef struct _Chain {
+    uint64_t s_lastNs;                              // Newest hop.
+    uint64_t s_ns[CPipelineTrace::NumStages];       // 0 if not seen.
+  } Chain;
+
+  uint64_t                     m_holdNs;
+  std::map<uint64_t, Chain>    m_pending;          // By timestamp.
+  Histograms                   m_hops;
+  Histograms                   m_endToEnd;
+  uint64_t                     m_items;            // Chains completed.
+  uint64_t                     m_singles;          // ..with only one stage.
+  uint64_t                     m_lost;
+
+public:
+  CTraceCollector(uint64_t holdNs);
+
+  void     add(const CPipelineTrace::Hop& hop);
+  void     addLost(uint64_t n) { m_lost += n; }
+  void     complete(uint64_t nowNs);
+  void     completeAll();
+  void     clear();
+  void     report(std::ostream& out) const;
+
+  const Histograms& hops() const     { return m_hops; }
+  const Histograms& endToEnd() const { return m_endToEnd; }
+  uint64_t items() const             { return m_items; }
+  uint64_t singles() const           { return m_singles; }
+  uint64_t lost() const              { return m_lost; }
+  size_t   pending() const           { return m_pending.size(); }
+
+private:
+  void histogram(const Chain& chain);
+  static void reportHistograms(std::ostream& out, const char* title,
+                               const Histograms& histograms);
+};
+
+#endif
@@ -0,0 +1,183 @@
+// Tests for the trace hop collector.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CTraceCollector.h"
+
+#include <sstream>
+#include <string>
+
+class CollectorTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(CollectorTests);
+  CPPUNIT_TEST(chain);
+  CPPUNIT_TEST(timeOrder);
+  CPPUNIT_TEST(hold);
+  CPPUNIT_TEST(single);
+  CPPUNIT_TEST(duplicates);
+  CPPUNIT_TEST(reportText);
+  CPPUNIT_TEST(clear);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+  static CPipelineTrace::Hop hop(CPipelineTrace::Stage stage,
+                                 uint64_t timestamp, uint64_t ns) {
+    CPipelineTrace::Hop result;
+    result.s_stage     = stage;
+    result.s_pid       = 1;
+    result.s_timestamp = timestamp;
+    result.s_ns        = ns;
+    return result;
+  }
+  static uint64_t count(const CTraceCollector::Histograms& h,
+                        unsigned from, unsigned to) {
+    CTraceCollector::Histograms::const_iterator p =
+      h.find(CTraceCollector::StagePair(from, to));
+    return p == h.end() ? 0 : p->second.snapshot().s_count;
+  }
+  static uint64_t sum(const CTraceCollector::Histograms& h,
+                      unsigned from, unsigned to) {
+    CTraceCollector::Histograms::const_iterator p =
+      h.find(CTraceCollector::StagePair(from, to));
+    return p == h.end() ? 0 : p->second.snapshot().s_sum;
+  }
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void chain();
+  void timeOrder();
+  void hold();
+  void single();
+  void duplicates();
+  void reportText();
+  void clear();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(CollectorTests);
+
+// Successive stages and the end to end time are histogrammed.
+
+void CollectorTests::chain()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::ReadoutOutput, 10, 100));
+  c.add(hop(CPipelineTrace::RingSource,    10, 150));
+  c.add(hop(CPipelineTrace::OrdererIngest, 10, 175));
+  c.add(hop(CPipelineTrace::EventLog,      10, 400));
+  c.completeAll();
+
+  EQ(uint64_t(1), c.items());
+  EQ(size_t(0), c.pending());
+  EQ(size_t(3), c.hops().size());
+  EQ(uint64_t(50),
+     sum(c.hops(), CPipelineTrace::ReadoutOutput, CPipelineTrace::RingSource));
+  EQ(uint64_t(25),
+     sum(c.hops(), CPipelineTrace::RingSource, CPipelineTrace::OrdererIngest));
+  EQ(uint64_t(225),
+     sum(c.hops(), CPipelineTrace::OrdererIngest, CPipelineTrace::EventLog));
+  EQ(size_t(1), c.endToEnd().size());
+  EQ(uint64_t(300),
+     sum(c.endToEnd(), CPipelineTrace::ReadoutOutput, CPipelineTrace::EventLog));
+}
+// Stages are put in the order they saw the item, not stage order.
+
+void CollectorTests::timeOrder()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::RingSource,    5, 300));
+  c.add(hop(CPipelineTrace::StdinToRing,   5, 200));
+  c.add(hop(CPipelineTrace::ReadoutOutput, 5, 100));
+  c.completeAll();
+
+  EQ(uint64_t(1),
+     count(c.hops(), CPipelineTrace::ReadoutOutput, CPipelineTrace::StdinToRing));
+  EQ(uint64_t(1),
+     count(c.hops(), CPipelineTrace::StdinToRing, CPipelineTrace::RingSource));
+  EQ(uint64_t(0),
+     count(c.hops(), CPipelineTrace::ReadoutOutput, CPipelineTrace::RingSource));
+}
+// Items are held until they've had no hops for the hold time.
+
+void CollectorTests::hold()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::ReadoutOutput, 1, 100));
+  c.add(hop(CPipelineTrace::ReadoutOutput, 2, 600));
+  c.add(hop(CPipelineTrace::EventLog,      1, 900));
+
+  c.complete(1500);
+  EQ(uint64_t(0), c.items());
+  EQ(size_t(2), c.pending());
+
+  c.complete(1600);                   // 600 + 1000
+  EQ(uint64_t(1), c.items());
+  EQ(uint64_t(1), c.singles());
+  EQ(size_t(1), c.pending());
+
+  c.complete(1900);                   // 900 + 1000
+  EQ(uint64_t(2), c.items());
+  EQ(size_t(0), c.pending());
+  EQ(uint64_t(1),
+     count(c.hops(), CPipelineTrace::ReadoutOutput, CPipelineTrace::EventLog));
+}
+// Items seen by one stage are counted but give no intervals.
+
+void CollectorTests::single()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::Glom, 1, 100));
+  c.completeAll();
+  EQ(uint64_t(1), c.items());
+  EQ(uint64_t(1), c.singles());
+  EQ(size_t(0), c.hops().size());
+  EQ(size_t(0), c.endToEnd().size());
+}
+// Only the first hop of a stage counts.
+
+void CollectorTests::duplicates()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::OrdererIngest, 1, 100));
+  c.add(hop(CPipelineTrace::OrdererIngest, 1, 150));
+  c.add(hop(CPipelineTrace::OrdererEmit,   1, 400));
+  c.completeAll();
+  EQ(uint64_t(300),
+     sum(c.hops(), CPipelineTrace::OrdererIngest, CPipelineTrace::OrdererEmit));
+}
+// The report names the stage pairs.
+
+void CollectorTests::reportText()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::OrdererEmit, 1, 1000));
+  c.add(hop(CPipelineTrace::Glom,        1, 3000));
+  c.addLost(4);
+  c.completeAll();
+
+  std::stringstream s;
+  c.report(s);
+  std::string text = s.str();
+  ASSERT(text.find("1 traced items") != std::string::npos);
+  ASSERT(text.find("4 hops lost") != std::string::npos);
+  ASSERT(text.find("orderer-out -> glom") != std::string::npos);
+}
+// clear forgets the statistics.
+
+void CollectorTests::clear()
+{
+  CTraceCollector c(1000);
+  c.add(hop(CPipelineTrace::OrdererEmit, 1, 1000));
+  c.add(hop(CPipelineTrace::Glom,        1, 3000));
+  c.addLost(4);
+  c.completeAll();
+  c.clear();
+  EQ(uint64_t(0), c.items());
+  EQ(uint64_t(0), c.lost());
+  EQ(size_t(0), c.hops().size());
+}
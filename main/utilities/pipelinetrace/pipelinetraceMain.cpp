@@ -0,0 +1,115 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file pipelinetraceMain.cpp
+ * @brief Main program of the pipeline latency trace collector.
+ */
+
+#include <config.h>
+#include "pipelinetraceargs.h"
+#include "CTraceCollector.h"
+
+#include <CPipelineTrace.h>
+#include <CLatencyHistogram.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static const unsigned POLL_US(10000);     // Time between region reads.
+
+static volatile sig_atomic_t stopRequested(0);
+
+static void
+onSignal(int sig)
+{
+  stopRequested = 1;
+}
+
+/**
+ * main
+ *   Attach to (or create) the trace region, read hops until told to stop
+ *   and report the latencies.
+ */
+int
+main(int argc, char** argv)
+{
+  gengetopt_args_info args;
+  if (cmdline_parser(argc, argv, &args)) {
+    exit(EXIT_FAILURE);
+  }
+  if ((args.interval_arg <= 0) || (args.hold_arg < 0) ||
+      (args.duration_arg < 0.0) || (args.report_arg < 0.0)) {
+    std::cerr << "pipelinetrace: --interval must be positive and --hold, "
+              << "--duration and --report can't be negative\n";
+    exit(EXIT_FAILURE);
+  }
+  std::string region = args.region_given ?
+    args.region_arg : CPipelineTrace::defaultName();
+
+  CPipelineTrace::pBlock pRegion =
+    CPipelineTrace::create(region, args.interval_arg);
+  if (!pRegion) {
+    std::cerr << "pipelinetrace: unable to use the trace region " << region
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  std::cerr << "pipelinetrace: tracing 1 in " << pRegion->s_interval
+            << " timestamps in " << region << std::endl;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  CTraceCollector collector(uint64_t(args.hold_arg)*1000000);
+  uint64_t cursor   = pRegion->s_next.load();  // Only hops from now on.
+  uint64_t start    = CLatencyHistogram::nowNs();
+  uint64_t endNs    = start + uint64_t(args.duration_arg*1.0e9);
+  uint64_t reportNs = uint64_t(args.report_arg*1.0e9);
+  uint64_t nextReport = start + reportNs;
+
+  std::vector<CPipelineTrace::Hop> hops;
+  while (!stopRequested) {
+    hops.clear();
+    collector.addLost(CPipelineTrace::read(pRegion, cursor, hops));
+    for (size_t i = 0; i < hops.size(); i++) {
+      collector.add(hops[i]);
+    }
+    uint64_t now = CLatencyHistogram::nowNs();
+    collector.complete(now);
+
+    if (args.duration_arg > 0.0 && now >= endNs) {
+      break;
+    }
+    if (reportNs && (now >= nextReport)) {
+      collector.report(std::cout);
+      std::cout << std::endl;
+      if (args.clear_flag) {
+        collector.clear();
+      }
+      nextReport += reportNs;
+    }
+    usleep(POLL_US);
+  }
+  collector.completeAll();
+  collector.report(std::cout);
+
+  CPipelineTrace::detach(pRegion, region);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReplayEngine.cpp
+ * @brief Implement the replay loop.
+ */
+
+#include <config.h>
+#include "CReplayEngine.h"
+#include "CReplayReader.h"
+#include "CReplayPacer.h"
+
+#include <CDataSink.h>
+#include <DataFormat.h>
+#include <fragment.h>
+
+#include <algorithm>
+#include <iomanip>
+
+/**
+ * constructor
+ *
+ * @param sink  - Where the items go.
+ * @param pacer - Says when they go.
+ */
+CReplayEngine::CReplayEngine(CDataSink& sink, CReplayPacer& pacer) :
+  m_sink(sink), m_pacer(pacer), m_pass(0),
+  m_pReport(0), m_reportNs(1000000000),
+  m_nItems(0), m_nBytes(0)
+{
+}
+
+/**
+ * addReader
+ *   Add a file to the replay.  Must be called before run().
+ *
+ * @param pReader - Reads the file; belongs to the caller.
+ */
+void
+CReplayEngine::addReader(CReplayReader* pReader)
+{
+  Input input = {pReader, 0, 0, 0, 0};
+  m_inputs.push_back(input);
+}
+/**
+ * setReport
+ *   Report achieved rates periodically.
+ *
+ * @param pStream  - Stream to report on; null turns reports off.
+ * @param interval - Seconds between reports.
+ */
+void
+CReplayEngine::setReport(std::ostream* pStream, double interval)
+{
+  m_pReport  = interval > 0.0 ? pStream : 0;
+  m_reportNs = static_cast<uint64_t>(interval*1.0e9);
+}
+/**
+ * run
+ *   Replay until all readers are done.
+ *
+ * @throw std::string - from the readers.
+ * @throw whatever the sink throws.
+ */
+void
+CReplayEngine::run()
+{
+  for (size_t i = 0; i < m_inputs.size(); i++) {
+    if (advance(m_inputs[i])) {
+      pushHeap(i);
+    }
+  }
+
+  uint64_t lastReport = CReplayPacer::now();
+  uint64_t lastItems  = 0;
+  uint64_t lastBytes  = 0;
+
+  while (!m_heap.empty()) {
+    size_t i     = popHeap();
+    Input& input = m_inputs[i];
+    if (input.s_pass != m_pass) {
+      m_pass = input.s_pass;
+      m_pacer.newPass();
+    }
+
+    m_pacer.wait(input.s_pItem);
+    uint32_t size = input.s_pItem->s_size;
+    m_sink.put(input.s_pItem, size);
+    m_nItems++;
+    m_nBytes += size;
+    input.s_nItems++;
+
+    if (advance(input)) {
+      pushHeap(i);
+    }
+
+    if (m_pReport) {
+      uint64_t now = CReplayPacer::now();
+      if ((now - lastReport) >= m_reportNs) {
+        report((now - lastReport)/1.0e9, m_nItems - lastItems, m_nBytes - lastBytes);
+        lastReport = now;
+        lastItems  = m_nItems;
+        lastBytes  = m_nBytes;
+      }
+    }
+  }
+}
+/**
+ * stalls
+ * @return uint64_t - times the replay had to wait for the readers.
+ */
+uint64_t
+CReplayEngine::stalls() const
+{
+  uint64_t result = 0;
+  for (size_t i = 0; i < m_inputs.size(); i++) {
+    result += m_inputs[i].s_pReader->stalls();
+  }
+  return result;
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities
+ */
+
+/**
+ * advance
+ *   Get the next item of an input.  Items without timestamps keep the
+ *   timestamp of the item before them.
+ *
+ * @return bool - false if the input is done.
+ */
+bool
+CReplayEngine::advance(Input& input)
+{
+  input.s_pItem = input.s_pReader->next();
+  if (!input.s_pItem) {
+    return false;
+  }
+  input.s_pass = input.s_pReader->pass();
+
+  const RingItem* pItem = reinterpret_cast<const RingItem*>(input.s_pItem);
+  if ((pItem->s_header.s_size >= (sizeof(RingItemHeader) + sizeof(BodyHeader))) &&
+      pItem->s_body.u_noBodyHeader.s_mbz) {
+    uint64_t timestamp = pItem->s_body.u_hasBodyHeader.s_bodyHeader.s_timestamp;
+    if (timestamp != NULL_TIMESTAMP) {
+      input.s_timestamp = timestamp;
+    }
+  }
+  return true;
+}
+/**
+ * earlier
+ *   Merge order: pass, timestamp, then whichever input has put the
+ *   fewest items, then input order.
+ */
+bool
+CReplayEngine::earlier(size_t a, size_t b) const
+{
+  const Input& ia(m_inputs[a]);
+  const Input& ib(m_inputs[b]);
+  if (ia.s_pass != ib.s_pass) {
+    return ia.s_pass < ib.s_pass;
+  }
+  if (ia.s_timestamp != ib.s_timestamp) {
+    return ia.s_timestamp < ib.s_timestamp;
+  }
+  if (ia.s_nItems != ib.s_nItems) {
+    return ia.s_nItems < ib.s_nItems;
+  }
+  return a < b;
+}
+void
+CReplayEngine::pushHeap(size_t input)
+{
+  m_heap.push_back(input);
+  std::push_heap(m_heap.begin(), m_heap.end(),
+                 [this](size_t a, size_t b) { return earlier(b, a); });
+}
+size_t
+CReplayEngine::popHeap()
+{
+  std::pop_heap(m_heap.begin(), m_heap.end(),
+                [this](size_t a, size_t b) { return earlier(b, a); });
+  size_t result = m_heap.back();
+  m_heap.pop_back();
+  return result;
+}
+/**
+ * report
+ *   Write the rates achieved over the last interval.
+ */
+void
+CReplayEngine::report(double seconds, uint64_t items, uint64_t bytes)
+{
+  std::ostream& out(*m_pReport);
+  std::ios::fmtflags flags     = out.flags();
+  std::streamsize    precision = out.precision();
+  out << "ringreplay: " << std::fixed << std::setprecision(0)
+      << items/seconds << " items/s "
+      << std::setprecision(2) << bytes/seconds/(1024.0*1024.0) << " MB/s ("
+      << m_nItems << " items " << m_nBytes << " bytes "
+      << stalls() << " read stalls)" << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
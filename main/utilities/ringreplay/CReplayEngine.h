@@ -0,0 +1,88 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReplayEngine.h
+ * @brief Replay event files into a data sink.
+ */
+#ifndef CREPLAYENGINE_H
+#define CREPLAYENGINE_H
+
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+#include <stddef.h>
+
+class CDataSink;
+class CReplayReader;
+class CReplayPacer;
+struct _RingItemHeader;
+
+/**
+ * @class CReplayEngine
+ *
+ *   Takes items from one or more read ahead readers and puts them in a
+ *   sink as the pacer says.  Items of several readers are merged by
+ *   pass and then body header timestamp; items with equal timestamps (or
+ *   no timestamps at all) are taken from the readers in turn.  A reader
+ *   that finishes a pass waits for the others to finish it too.
+ *
+ *   Each report interval the achieved rates are written to the report
+ *   stream.
+ */
+class CReplayEngine
+{
+private:
+  typedef struct _Input {
+    CReplayReader*          s_pReader;
+    const _RingItemHeader*  s_pItem;
+    unsigned                s_pass;
+    uint64_t                s_timestamp;
+    uint64_t                s_nItems;	// Items put from this reader.
+  } Input;
+
+  CDataSink&          m_sink;
+  CReplayPacer&       m_pacer;
+  std::vector<Input>  m_inputs;
+  std::vector<size_t> m_heap;
+  unsigned            m_pass;
+
+  std::ostream*       m_pReport;
+  uint64_t            m_reportNs;
+
+  uint64_t            m_nItems;
+  uint64_t            m_nBytes;
+
+public:
+  CReplayEngine(CDataSink& sink, CReplayPacer& pacer);
+
+  void addReader(CReplayReader* pReader);
+  void setReport(std::ostream* pStream, double interval);
+  void run();
+
+  uint64_t items() const { return m_nItems; }
+  uint64_t bytes() const { return m_nBytes; }
+  uint64_t stalls() const;
+
+private:
+  bool advance(Input& input);
+  bool earlier(size_t a, size_t b) const;
+  void pushHeap(size_t input);
+  size_t popHeap();
+  void report(double seconds, uint64_t items, uint64_t bytes);
+};
+
+#endif
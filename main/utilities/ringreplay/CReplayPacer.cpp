@@ -0,0 +1,141 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReplayPacer.cpp
+ * @brief Implement replay pacing.
+ */
+
+#include <config.h>
+#include "CReplayPacer.h"
+
+#include <DataFormat.h>
+#include <fragment.h>
+
+#include <time.h>
+#include <errno.h>
+
+/**
+ * constructor
+ *
+ * @param mode - How items are paced.
+ * @param rate - Items/sec, bytes/sec or timestamp ticks/sec depending on
+ *               the mode.  Ignored for Unpaced.  Rates that are not
+ *               positive are unpaced.
+ */
+CReplayPacer::CReplayPacer(Mode mode, double rate) :
+  m_mode(rate > 0.0 ? mode : Unpaced),
+  m_nsPerUnit(rate > 0.0 ? 1.0e9/rate : 0.0),
+  m_nItems(0), m_nBytes(0),
+  m_haveBase(false), m_baseTimestamp(0), m_baseNs(0), m_lastDueNs(0),
+  m_started(false), m_startNs(0)
+{
+}
+
+/**
+ * due
+ *   Figure out when an item is due.  Must be called once per item in
+ *   replay order.
+ *
+ * @param pItem - The item.
+ * @return uint64_t - ns after the start of the replay.
+ */
+uint64_t
+CReplayPacer::due(const RingItemHeader* pItem)
+{
+  uint64_t result = 0;
+  switch (m_mode) {
+  case ItemRate:
+    result = static_cast<uint64_t>(m_nItems*m_nsPerUnit);
+    m_nItems++;
+    break;
+  case ByteRate:
+    result = static_cast<uint64_t>(m_nBytes*m_nsPerUnit);
+    m_nBytes += pItem->s_size;
+    break;
+  case TimestampRate:
+    {
+      const RingItem* p = reinterpret_cast<const RingItem*>(pItem);
+      if ((pItem->s_size < (sizeof(RingItemHeader) + sizeof(BodyHeader))) ||
+          !p->s_body.u_noBodyHeader.s_mbz) {
+        return m_lastDueNs;
+      }
+      uint64_t timestamp = p->s_body.u_hasBodyHeader.s_bodyHeader.s_timestamp;
+      if (timestamp == NULL_TIMESTAMP) {
+        return m_lastDueNs;
+      }
+      if (!m_haveBase || (timestamp < m_baseTimestamp)) {
+        m_haveBase      = true;
+        m_baseTimestamp = timestamp;
+        m_baseNs        = m_lastDueNs;
+      }
+      result = m_baseNs +
+        static_cast<uint64_t>((timestamp - m_baseTimestamp)*m_nsPerUnit);
+      if (result > m_lastDueNs) {
+        m_lastDueNs = result;
+      }
+    }
+    break;
+  default:
+    break;
+  }
+  return result;
+}
+/**
+ * newPass
+ *   The replay has started over; the next timestamp becomes the base
+ *   again so the replay carries on from where the schedule is.
+ */
+void
+CReplayPacer::newPass()
+{
+  m_haveBase = false;
+}
+/**
+ * wait
+ *   Sleep until an item is due.  The first call starts the schedule.
+ */
+void
+CReplayPacer::wait(const RingItemHeader* pItem)
+{
+  if (m_mode == Unpaced) {
+    return;
+  }
+  uint64_t dueNs = due(pItem);
+  if (!m_started) {
+    m_started = true;
+    m_startNs = now();
+  }
+  uint64_t when = m_startNs + dueNs;
+  if (when > now()) {
+    struct timespec t;
+    t.tv_sec  = when/1000000000;
+    t.tv_nsec = when%1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, 0) == EINTR)
+      ;
+  }
+}
+/**
+ * now
+ * @return uint64_t - the monotonic clock in ns.
+ */
+uint64_t
+CReplayPacer::now()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return static_cast<uint64_t>(t.tv_sec)*1000000000 + t.tv_nsec;
+}
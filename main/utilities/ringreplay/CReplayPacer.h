@@ -0,0 +1,74 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReplayPacer.h
+ * @brief Decide when replayed items are due.
+ */
+#ifndef CREPLAYPACER_H
+#define CREPLAYPACER_H
+
+#include <stdint.h>
+
+struct _RingItemHeader;
+
+/**
+ * @class CReplayPacer
+ *
+ *   Computes when each replayed item is due relative to the start of the
+ *   replay and sleeps until then.  Items are paced at a fixed item rate, a
+ *   fixed byte rate or as their body header timestamps say they were
+ *   taken.  The schedule is absolute, so sleep overshoot does not
+ *   accumulate and a replay that falls behind catches up.
+ *
+ *   For timestamp pacing items without timestamps are due immediately.
+ *   The timestamp that corresponds to the start of the schedule is set by
+ *   the first timestamped item and again at each new pass or when the
+ *   timestamps go back in time (a new run with its clocks reset).
+ */
+class CReplayPacer
+{
+public:
+  typedef enum _Mode {
+    Unpaced, ItemRate, ByteRate, TimestampRate
+  } Mode;
+
+private:
+  Mode     m_mode;
+  double   m_nsPerUnit;		// ns per item, byte or timestamp tick.
+
+  uint64_t m_nItems;
+  uint64_t m_nBytes;
+
+  bool     m_haveBase;
+  uint64_t m_baseTimestamp;
+  uint64_t m_baseNs;		// Schedule time of m_baseTimestamp.
+  uint64_t m_lastDueNs;
+
+  bool     m_started;
+  uint64_t m_startNs;
+
+public:
+  CReplayPacer(Mode mode = Unpaced, double rate = 0.0);
+
+  uint64_t due(const _RingItemHeader* pItem);
+  void     newPass();
+  void     wait(const _RingItemHeader* pItem);
+
+  static uint64_t now();
+};
+
+#endif
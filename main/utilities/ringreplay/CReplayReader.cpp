@@ -0,0 +1,299 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReplayReader.cpp
+ * @brief Implement the read ahead of event files.
+ */
+
+#include <config.h>
+#include "CReplayReader.h"
+
+#include <CFileDataSource.h>
+#include <DataFormat.h>
+
+#include <stdexcept>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*----------------------------------------------------------------------------
+ * Canonicals
+ */
+
+/**
+ * constructor
+ *   Open the file and start reading ahead.
+ *
+ * @param file      - Event file to replay.
+ * @param passes    - Number of times to read the file; 0 reads it forever.
+ * @param sourceId  - If not KeepSourceIds, the body header source id
+ *                    every item gets.
+ * @param chunkSize - Size of the read ahead chunks.
+ * @param nChunks   - Number of chunks (at least 2).
+ *
+ * @throw std::string - the file could not be opened or the thread started.
+ */
+CReplayReader::CReplayReader(std::string file, unsigned passes, int sourceId,
+                             size_t chunkSize, unsigned nChunks) :
+  m_file(file), m_passes(passes),
+  m_setSourceId(sourceId != KeepSourceIds), m_sourceId(sourceId),
+  m_chunkSize(chunkSize), m_pSource(0),
+  m_pCurrent(0), m_offset(0), m_pass(0), m_nStalls(0), m_primed(false),
+  m_nTruncated(0)
+{
+  if (nChunks < 2) {
+    nChunks = 2;
+  }
+  openFile();
+  for (unsigned i = 0; i < nChunks; i++) {
+    Chunk* pChunk = new Chunk;
+    pChunk->s_data.resize(m_chunkSize);
+    pChunk->s_size = 0;
+    pChunk->s_pass = 0;
+    pChunk->s_end  = false;
+    m_chunks.push_back(pChunk);
+    m_free.queue(pChunk);
+  }
+  if (pthread_create(&m_thread, 0, reader, this)) {
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+      delete m_chunks[i];
+    }
+    delete m_pSource;
+    throw std::string("Unable to start the read ahead thread for ") + m_file;
+  }
+}
+/**
+ * destructor
+ *   Take back the free chunks so the reader thread runs out of work, then
+ *   tell it to exit with a null chunk.
+ */
+CReplayReader::~CReplayReader()
+{
+  m_free.getAll();
+  m_free.queue(0);
+  pthread_join(m_thread, 0);
+
+  for (size_t i = 0; i < m_chunks.size(); i++) {
+    delete m_chunks[i];
+  }
+  delete m_pSource;
+}
+
+/*----------------------------------------------------------------------------
+ * Public interface
+ */
+
+/**
+ * next
+ *   Return the next item.  The item is valid until the next call.
+ *
+ * @return const RingItemHeader* - null once all passes are done.
+ * @throw std::string - the reader thread failed.
+ */
+const RingItemHeader*
+CReplayReader::next()
+{
+  while (1) {
+    if (m_pCurrent) {
+      if (m_offset < m_pCurrent->s_size) {
+        const RingItemHeader* pItem =
+          reinterpret_cast<const RingItemHeader*>(&m_pCurrent->s_data[m_offset]);
+        m_offset += pItem->s_size;
+        m_pass    = m_pCurrent->s_pass;
+        return pItem;
+      }
+      if (m_pCurrent->s_end) {
+        if (!m_pCurrent->s_error.empty()) {
+          throw m_pCurrent->s_error;
+        }
+        return 0;
+      }
+      m_free.queue(m_pCurrent);
+      m_pCurrent = 0;
+    }
+    if (!m_filled.getnow(m_pCurrent)) {
+      if (m_primed) {
+        m_nStalls++;            // The disk did not keep up.
+      }
+      m_pCurrent = m_filled.get();
+    }
+    m_primed = true;
+    m_offset = 0;
+  }
+}
+
+/*----------------------------------------------------------------------------
+ * Private utilities
+ */
+
+/**
+ * openFile
+ *   (Re)open the file from the beginning.
+ *
+ * @throw std::string - the file could not be opened.
+ */
+void
+CReplayReader::openFile()
+{
+  delete m_pSource;
+  m_pSource = 0;
+
+  int fd = open(m_file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::string msg = m_file;
+    msg += ": ";
+    msg += strerror(errno);
+    throw msg;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  m_pSource = new CFileDataSource(fd, std::vector<uint16_t>());
+}
+/**
+ * readAhead
+ *   Body of the reader thread: fill free chunks and queue them as filled
+ *   until the last pass is done, an error happens or a null chunk says
+ *   to exit.
+ */
+void
+CReplayReader::readAhead()
+{
+  std::vector<uint8_t> carry;
+  unsigned             pass = 0;
+
+  while (1) {
+    Chunk* pChunk = m_free.get();
+    if (!pChunk) {
+      return;
+    }
+    pChunk->s_size = 0;
+    pChunk->s_pass = pass;
+    pChunk->s_end  = false;
+    pChunk->s_error.clear();
+
+    try {
+      if (fillChunk(pChunk, carry)) {
+        if (!carry.empty()) {
+          m_nTruncated++;       // File ends in the middle of an item.
+          carry.clear();
+        }
+        pass++;
+        if (m_passes && (pass >= m_passes)) {
+          pChunk->s_end = true;
+        } else {
+          openFile();
+        }
+      }
+    }
+    catch (std::string msg) {
+      pChunk->s_error = msg;
+    }
+    catch (int e) {
+      pChunk->s_error = m_file + ": " + strerror(e);
+    }
+    catch (std::exception& e) {
+      pChunk->s_error = m_file + ": " + e.what();
+    }
+    catch (...) {
+      pChunk->s_error = m_file + ": unanticipated exception while reading";
+    }
+    if (!pChunk->s_error.empty()) {
+      pChunk->s_end = true;
+    }
+    m_filled.queue(pChunk);
+    if (pChunk->s_end) {
+      return;
+    }
+  }
+}
+/**
+ * fillChunk
+ *   Put the carried partial item at the front of the chunk and read until
+ *   the chunk is full or the file ends.  Whatever follows the last
+ *   complete item becomes the new carry.  If not even one item fits the
+ *   chunk is made bigger.
+ *
+ * @return bool - true if the end of the file was reached.
+ */
+bool
+CReplayReader::fillChunk(Chunk* pChunk, std::vector<uint8_t>& carry)
+{
+  std::vector<uint8_t>& data(pChunk->s_data);
+  size_t n = carry.size();
+  if (data.size() <= n) {
+    data.resize(n + m_chunkSize);
+  }
+  if (n) {
+    memcpy(&data[0], &carry[0], n);
+  }
+
+  bool   eof;
+  size_t used;
+  while (1) {
+    n   += m_pSource->readBlock(reinterpret_cast<char*>(&data[n]), data.size() - n);
+    eof  = m_pSource->eof();
+    used = completeItems(&data[0], n);
+    if (used || eof) {
+      break;
+    }
+    size_t need = reinterpret_cast<RingItemHeader*>(&data[0])->s_size;
+    data.resize((need > 2*data.size()) ? need : 2*data.size());
+  }
+  carry.assign(data.begin() + used, data.begin() + n);
+  pChunk->s_size = used;
+  return eof;
+}
+/**
+ * completeItems
+ *   Find the complete items at the front of a block, setting their source
+ *   ids if asked to.
+ *
+ * @return size_t - bytes of complete items.
+ * @throw std::string - an item size is not possible.
+ */
+size_t
+CReplayReader::completeItems(uint8_t* pData, size_t nBytes)
+{
+  size_t offset = 0;
+  while ((offset + sizeof(RingItemHeader)) <= nBytes) {
+    pRingItem pItem = reinterpret_cast<pRingItem>(pData + offset);
+    uint32_t  size  = pItem->s_header.s_size;
+    if (size < sizeof(RingItemHeader)) {
+      throw m_file + ": invalid ring item size; this is not an event file";
+    }
+    if ((offset + size) > nBytes) {
+      break;
+    }
+    if (m_setSourceId &&
+        (size >= (sizeof(RingItemHeader) + sizeof(BodyHeader))) &&
+        pItem->s_body.u_noBodyHeader.s_mbz) {
+      pItem->s_body.u_hasBodyHeader.s_bodyHeader.s_sourceId = m_sourceId;
+    }
+    offset += size;
+  }
+  return offset;
+}
+/**
+ * reader
+ *   pthread entry point.
+ */
+void*
+CReplayReader::reader(void* pArg)
+{
+  reinterpret_cast<CReplayReader*>(pArg)->readAhead();
+  return 0;
+}
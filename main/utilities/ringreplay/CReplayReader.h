@@ -0,0 +1,116 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CReplayReader.h
+ * @brief Read ahead of an event file on its own thread.
+ */
+#ifndef CREPLAYREADER_H
+#define CREPLAYREADER_H
+
+#include <CBufferQueue.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+class CFileDataSource;
+struct _RingItemHeader;
+
+/**
+ * @class CReplayReader
+ *
+ *   Reads an event file into large chunks on an I/O thread so that the
+ *   thread replaying the items never waits for the disk as long as the
+ *   disk keeps up on average.  Chunks only hold complete ring items; the
+ *   partial item at the end of a read is carried into the next chunk.
+ *   Chunks cycle between a free and a filled queue, so the memory used is
+ *   fixed at the number of chunks times their size (a chunk grows if an
+ *   item is larger than it).
+ *
+ *   The file can be read several times (passes) for looping replays.  The
+ *   reader can also rewrite the source id in the body header of every
+ *   item so that several files can stand in for distinct sources.
+ */
+class CReplayReader
+{
+private:
+  typedef struct _Chunk {
+    std::vector<uint8_t> s_data;
+    size_t               s_size;	// Bytes of complete items.
+    unsigned             s_pass;
+    bool                 s_end;		// Last chunk - no more after this.
+    std::string          s_error;	// Why the reader stopped early.
+  } Chunk;
+
+  std::string          m_file;
+  unsigned             m_passes;	// 0 means forever.
+  bool                 m_setSourceId;
+  uint32_t             m_sourceId;
+  size_t               m_chunkSize;
+
+  CFileDataSource*     m_pSource;
+  std::vector<Chunk*>  m_chunks;
+  CBufferQueue<Chunk*> m_free;
+  CBufferQueue<Chunk*> m_filled;
+  pthread_t            m_thread;
+
+  // Consumer side:
+
+  Chunk*               m_pCurrent;
+  size_t               m_offset;
+  unsigned             m_pass;
+  uint64_t             m_nStalls;
+  bool                 m_primed;	// The first chunk has been gotten.
+
+  // Reader side; look at these only after next() returned null:
+
+  uint64_t             m_nTruncated;
+
+public:
+  static const size_t DefaultChunkSize = 8*1024*1024;
+  static const unsigned DefaultChunks  = 8;
+
+  static const int KeepSourceIds       = -1;
+
+  CReplayReader(std::string file, unsigned passes = 1,
+                int sourceId = KeepSourceIds,
+                size_t chunkSize = DefaultChunkSize,
+                unsigned nChunks = DefaultChunks);
+  ~CReplayReader();
+
+private:
+  CReplayReader(const CReplayReader& rhs);
+  CReplayReader& operator=(const CReplayReader& rhs);
+
+public:
+  const _RingItemHeader* next();
+  unsigned pass() const { return m_pass; }
+  uint64_t stalls() const { return m_nStalls; }
+  uint64_t truncated() const { return m_nTruncated; }
+  std::string file() const { return m_file; }
+
+private:
+  void   openFile();
+  void   readAhead();
+  bool   fillChunk(Chunk* pChunk, std::vector<uint8_t>& carry);
+  size_t completeItems(uint8_t* pData, size_t nBytes);
+  static void* reader(void* pArg);
+};
+
+#endif
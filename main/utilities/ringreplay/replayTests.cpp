@@ -0,0 +1,550 @@
+// Tests for the ring replay reader, pacer and engine.
+
+#include <config.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+#include "CReplayReader.h"
+#include "CReplayPacer.h"
+#include "CReplayEngine.h"
+#include <CDataSink.h>
+#include <CCompressedSegmentWriter.h>
+#include <DataFormat.h>
+#include <fragment.h>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace std;
+
+typedef vector<uint8_t> Item;
+
+// Make ring items:
+
+static Item
+event(uint64_t timestamp, uint32_t sourceId, size_t payload = sizeof(uint32_t))
+{
+  Item result(sizeof(RingItemHeader) + sizeof(BodyHeader) + payload);
+  pRingItem p = reinterpret_cast<pRingItem>(&result[0]);
+  p->s_header.s_size = result.size();
+  p->s_header.s_type = PHYSICS_EVENT;
+  BodyHeader& h(p->s_body.u_hasBodyHeader.s_bodyHeader);
+  h.s_size      = sizeof(BodyHeader);
+  h.s_timestamp = timestamp;
+  h.s_sourceId  = sourceId;
+  h.s_barrier   = 0;
+  return result;
+}
+static Item
+noBodyHeader(uint32_t type)
+{
+  Item result(sizeof(RingItemHeader) + 2*sizeof(uint32_t));
+  pRingItem p = reinterpret_cast<pRingItem>(&result[0]);
+  p->s_header.s_size = result.size();
+  p->s_header.s_type = type;
+  p->s_body.u_noBodyHeader.s_mbz = 0;
+  return result;
+}
+static uint64_t
+timestamp(const void* pItem)
+{
+  return reinterpret_cast<const RingItem*>(pItem)
+    ->s_body.u_hasBodyHeader.s_bodyHeader.s_timestamp;
+}
+static uint32_t
+sourceId(const void* pItem)
+{
+  return reinterpret_cast<const RingItem*>(pItem)
+    ->s_body.u_hasBodyHeader.s_bodyHeader.s_sourceId;
+}
+
+// A sink that keeps what it gets:
+
+class MemorySink : public CDataSink
+{
+public:
+  vector<Item> m_items;
+  virtual void putItem(const CRingItem& item) {}
+  virtual void put(const void* pData, size_t nBytes) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(pData);
+    m_items.push_back(Item(p, p + nBytes));
+  }
+  vector<uint64_t> stamps() {
+    vector<uint64_t> result;
+    for (size_t i = 0; i < m_items.size(); i++) {
+      result.push_back(timestamp(&m_items[i][0]));
+    }
+    return result;
+  }
+  vector<uint32_t> ids() {
+    vector<uint32_t> result;
+    for (size_t i = 0; i < m_items.size(); i++) {
+      result.push_back(sourceId(&m_items[i][0]));
+    }
+    return result;
+  }
+};
+
+// Files of test data:
+
+class TempDir
+{
+public:
+  string m_dir;
+  TempDir() {
+    char dir[] = "/tmp/ringreplayXXXXXX";
+    m_dir = mkdtemp(dir);
+  }
+  ~TempDir() {
+    string cmd = "rm -rf " + m_dir;
+    system(cmd.c_str());
+  }
+  string write(string name, const vector<Item>& items, size_t extra = 0) {
+    string path = m_dir + "/" + name;
+    FILE* f = fopen(path.c_str(), "w");
+    for (size_t i = 0; i < items.size(); i++) {
+      fwrite(&items[i][0], 1, items[i].size(), f);
+    }
+    if (extra) {
+      fwrite(&items[0][0], 1, extra, f);   // A partial item.
+    }
+    fclose(f);
+    return path;
+  }
+  string compressed(string name, const vector<Item>& items) {
+    string path = m_dir + "/" + name;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CCompressedSegmentWriter writer(fd, 100, 1);
+    for (size_t i = 0; i < items.size(); i++) {
+      writer.write(&items[i][0], items[i].size());
+    }
+    writer.finish();
+    close(fd);
+    return path;
+  }
+};
+
+static vector<Item>
+events(uint64_t first, unsigned n, uint64_t step = 1, uint32_t id = 1,
+       size_t payload = sizeof(uint32_t))
+{
+  vector<Item> result;
+  for (unsigned i = 0; i < n; i++) {
+    result.push_back(event(first + i*step, id, payload));
+  }
+  return result;
+}
+static vector<uint64_t>
+series(uint64_t first, unsigned n, uint64_t step = 1)
+{
+  vector<uint64_t> result;
+  for (unsigned i = 0; i < n; i++) {
+    result.push_back(first + i*step);
+  }
+  return result;
+}
+static vector<uint64_t>
+readStamps(CReplayReader& reader, vector<unsigned>* pPasses = 0)
+{
+  vector<uint64_t> result;
+  const RingItemHeader* p;
+  while ((p = reader.next())) {
+    result.push_back(timestamp(p));
+    if (pPasses) pPasses->push_back(reader.pass());
+  }
+  return result;
+}
+
+/*----------------------------------------------------------------------------
+ * Reader
+ */
+
+class ReaderTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ReaderTests);
+  CPPUNIT_TEST(ReadAll);
+  CPPUNIT_TEST(SmallChunks);
+  CPPUNIT_TEST(Passes);
+  CPPUNIT_TEST(SourceIds);
+  CPPUNIT_TEST(Truncated);
+  CPPUNIT_TEST(Compressed);
+  CPPUNIT_TEST(Errors);
+  CPPUNIT_TEST(EarlyDelete);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void ReadAll();
+  void SmallChunks();
+  void Passes();
+  void SourceIds();
+  void Truncated();
+  void Compressed();
+  void Errors();
+  void EarlyDelete();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ReaderTests);
+
+// Items come out in file order, and the end stays the end.
+
+void
+ReaderTests::ReadAll()
+{
+  TempDir d;
+  CReplayReader reader(d.write("a.evt", events(10, 100)));
+  ASSERT(readStamps(reader) == series(10, 100));
+  ASSERT(reader.next() == 0);
+  EQ(uint64_t(0), reader.truncated());
+}
+// Items straddle chunks and some items are larger than a chunk.
+
+void
+ReaderTests::SmallChunks()
+{
+  TempDir d;
+  vector<Item> items = events(0, 20);
+  vector<Item> big   = events(20, 3, 1, 1, 500);
+  items.insert(items.begin() + 7, big.begin(), big.end());
+  vector<uint64_t> expected = series(0, 7);
+  vector<uint64_t> more     = series(20, 3);
+  expected.insert(expected.end(), more.begin(), more.end());
+  more = series(7, 13);
+  expected.insert(expected.end(), more.begin(), more.end());
+
+  CReplayReader reader(d.write("a.evt", items), 1, CReplayReader::KeepSourceIds,
+                       50, 2);
+  ASSERT(readStamps(reader) == expected);
+}
+// Several passes, and pass numbers.
+
+void
+ReaderTests::Passes()
+{
+  TempDir d;
+  CReplayReader reader(d.write("a.evt", events(1, 5)), 3,
+                       CReplayReader::KeepSourceIds, 64, 2);
+  vector<unsigned> passes;
+  vector<uint64_t> stamps = readStamps(reader, &passes);
+  EQ(size_t(15), stamps.size());
+  for (size_t i = 0; i < stamps.size(); i++) {
+    EQ(uint64_t(1 + i%5), stamps[i]);
+    EQ(unsigned(i/5), passes[i]);
+  }
+}
+// Source ids are replaced only in items with body headers.
+
+void
+ReaderTests::SourceIds()
+{
+  TempDir d;
+  vector<Item> items = events(1, 3, 1, 5);
+  items.push_back(noBodyHeader(MONITORED_VARIABLES));
+  CReplayReader reader(d.write("a.evt", items), 1, 42);
+  for (int i = 0; i < 3; i++) {
+    EQ(uint32_t(42), sourceId(reader.next()));
+  }
+  const RingItem* p = reinterpret_cast<const RingItem*>(reader.next());
+  EQ(uint32_t(MONITORED_VARIABLES), p->s_header.s_type);
+  EQ(uint32_t(0), p->s_body.u_noBodyHeader.s_mbz);
+  ASSERT(reader.next() == 0);
+}
+// A partial item at the end is not replayed but counted.
+
+void
+ReaderTests::Truncated()
+{
+  TempDir d;
+  CReplayReader reader(d.write("a.evt", events(1, 4), 10), 2);
+  vector<uint64_t> expected = series(1, 4);
+  vector<uint64_t> again(expected);
+  expected.insert(expected.end(), again.begin(), again.end());
+  ASSERT(readStamps(reader) == expected);
+  EQ(uint64_t(2), reader.truncated());
+}
+// Compressed segments are read as well.
+
+void
+ReaderTests::Compressed()
+{
+  TempDir d;
+  CReplayReader reader(d.compressed("a.evt", events(1, 50)), 2,
+                       CReplayReader::KeepSourceIds, 128, 3);
+  vector<uint64_t> expected = series(1, 50);
+  vector<uint64_t> again(expected);
+  expected.insert(expected.end(), again.begin(), again.end());
+  ASSERT(readStamps(reader) == expected);
+}
+// Missing files throw at construction, garbage throws when it is reached.
+
+void
+ReaderTests::Errors()
+{
+  TempDir d;
+  EXCEPTION(CReplayReader(d.m_dir + "/nosuch.evt"), std::string);
+
+  vector<Item> items = events(1, 2);
+  Item bad(sizeof(RingItemHeader));
+  pRingItemHeader h = reinterpret_cast<pRingItemHeader>(&bad[0]);
+  h->s_size = 2;
+  h->s_type = PHYSICS_EVENT;
+  items.push_back(bad);
+  CReplayReader reader(d.write("bad.evt", items));
+  EXCEPTION(readStamps(reader), std::string);
+}
+// Readers can be destroyed in the middle of a forever replay.
+
+void
+ReaderTests::EarlyDelete()
+{
+  TempDir d;
+  CReplayReader* pReader = new CReplayReader(d.write("a.evt", events(1, 100)), 0,
+                                             CReplayReader::KeepSourceIds, 64, 4);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT(pReader->next());
+  }
+  delete pReader;
+}
+
+/*----------------------------------------------------------------------------
+ * Pacer
+ */
+
+class PacerTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(PacerTests);
+  CPPUNIT_TEST(Unpaced);
+  CPPUNIT_TEST(Items);
+  CPPUNIT_TEST(Bytes);
+  CPPUNIT_TEST(Timestamps);
+  CPPUNIT_TEST(Rebase);
+  CPPUNIT_TEST(Wait);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void Unpaced();
+  void Items();
+  void Bytes();
+  void Timestamps();
+  void Rebase();
+  void Wait();
+private:
+  const RingItemHeader* header(const Item& i) {
+    return reinterpret_cast<const RingItemHeader*>(&i[0]);
+  }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PacerTests);
+
+void
+PacerTests::Unpaced()
+{
+  CReplayPacer pacer;
+  Item e = event(100, 1);
+  EQ(uint64_t(0), pacer.due(header(e)));
+  EQ(uint64_t(0), pacer.due(header(e)));
+
+  CReplayPacer zero(CReplayPacer::ItemRate, 0.0);  // No rate is no pacing.
+  EQ(uint64_t(0), zero.due(header(e)));
+  EQ(uint64_t(0), zero.due(header(e)));
+}
+void
+PacerTests::Items()
+{
+  CReplayPacer pacer(CReplayPacer::ItemRate, 1000.0);
+  Item e = event(100, 1);
+  EQ(uint64_t(0), pacer.due(header(e)));
+  EQ(uint64_t(1000000), pacer.due(header(e)));
+  EQ(uint64_t(2000000), pacer.due(header(e)));
+}
+// Bytes: each item is due when the bytes before it are.
+
+void
+PacerTests::Bytes()
+{
+  CReplayPacer pacer(CReplayPacer::ByteRate, 1.0e6);
+  Item small = event(1, 1);
+  Item large = event(1, 1, 1000 - sizeof(RingItemHeader) - sizeof(BodyHeader));
+  EQ(uint64_t(0), pacer.due(header(large)));
+  EQ(uint64_t(1000000), pacer.due(header(small)));
+  EQ(uint64_t(1000000 + small.size()*1000), pacer.due(header(small)));
+}
+// Timestamps: relative to the first timestamp; untimed items are due now.
+
+void
+PacerTests::Timestamps()
+{
+  CReplayPacer pacer(CReplayPacer::TimestampRate, 1.0e8);   // 10ns ticks.
+  Item none = noBodyHeader(MONITORED_VARIABLES);
+  EQ(uint64_t(0), pacer.due(header(none)));
+  Item e = event(1000, 1);
+  EQ(uint64_t(0), pacer.due(header(e)));
+  e = event(1500, 1);
+  EQ(uint64_t(5000), pacer.due(header(e)));
+  EQ(uint64_t(5000), pacer.due(header(none)));
+  e = event(NULL_TIMESTAMP, 1);
+  EQ(uint64_t(5000), pacer.due(header(e)));
+  e = event(3000, 1);
+  EQ(uint64_t(20000), pacer.due(header(e)));
+}
+// New passes and clock resets continue the schedule.
+
+void
+PacerTests::Rebase()
+{
+  CReplayPacer pacer(CReplayPacer::TimestampRate, 1.0e9);
+  Item e = event(100, 1);
+  EQ(uint64_t(0), pacer.due(header(e)));
+  e = event(200, 1);
+  EQ(uint64_t(100), pacer.due(header(e)));
+
+  pacer.newPass();
+  e = event(100, 1);
+  EQ(uint64_t(100), pacer.due(header(e)));
+  e = event(150, 1);
+  EQ(uint64_t(150), pacer.due(header(e)));
+
+  e = event(10, 1);                      // Clocks reset.
+  EQ(uint64_t(150), pacer.due(header(e)));
+  e = event(30, 1);
+  EQ(uint64_t(170), pacer.due(header(e)));
+}
+// Wait really waits.
+
+void
+PacerTests::Wait()
+{
+  CReplayPacer pacer(CReplayPacer::ItemRate, 100.0);
+  Item e = event(1, 1);
+  uint64_t start = CReplayPacer::now();
+  for (int i = 0; i < 6; i++) {
+    pacer.wait(header(e));
+  }
+  ASSERT((CReplayPacer::now() - start) >= 50000000);
+}
+
+/*----------------------------------------------------------------------------
+ * Engine
+ */
+
+class EngineTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(EngineTests);
+  CPPUNIT_TEST(Single);
+  CPPUNIT_TEST(Merge);
+  CPPUNIT_TEST(Untimed);
+  CPPUNIT_TEST(Loop);
+  CPPUNIT_TEST(Report);
+  CPPUNIT_TEST_SUITE_END();
+
+protected:
+  void Single();
+  void Merge();
+  void Untimed();
+  void Loop();
+  void Report();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EngineTests);
+
+void
+EngineTests::Single()
+{
+  TempDir      d;
+  MemorySink   sink;
+  CReplayPacer pacer;
+  CReplayReader reader(d.write("a.evt", events(1, 10)));
+  CReplayEngine engine(sink, pacer);
+  engine.addReader(&reader);
+  engine.run();
+
+  ASSERT(sink.stamps() == series(1, 10));
+  EQ(uint64_t(10), engine.items());
+  EQ(uint64_t(10*event(1, 1).size()), engine.bytes());
+}
+// Files are merged by timestamp and get their source ids.
+
+void
+EngineTests::Merge()
+{
+  TempDir      d;
+  MemorySink   sink;
+  CReplayPacer pacer;
+  CReplayReader a(d.write("a.evt", events(0, 5, 2)), 1, 1);
+  CReplayReader b(d.write("b.evt", events(1, 5, 2)), 1, 2);
+  CReplayEngine engine(sink, pacer);
+  engine.addReader(&a);
+  engine.addReader(&b);
+  engine.run();
+
+  ASSERT(sink.stamps() == series(0, 10));
+  vector<uint32_t> ids = sink.ids();
+  for (size_t i = 0; i < ids.size(); i++) {
+    EQ(uint32_t(1 + i%2), ids[i]);
+  }
+}
+// Without timestamps files take turns.
+
+void
+EngineTests::Untimed()
+{
+  TempDir      d;
+  MemorySink   sink;
+  CReplayPacer pacer;
+  CReplayReader a(d.write("a.evt", events(0, 3, 0)), 1, 1);
+  CReplayReader b(d.write("b.evt", events(0, 3, 0)), 1, 2);
+  CReplayEngine engine(sink, pacer);
+  engine.addReader(&a);
+  engine.addReader(&b);
+  engine.run();
+
+  vector<uint32_t> ids = sink.ids();
+  EQ(size_t(6), ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    EQ(uint32_t(1 + i%2), ids[i]);
+  }
+}
+// Passes are not mixed: a file that finished a pass waits for the others.
+
+void
+EngineTests::Loop()
+{
+  TempDir      d;
+  MemorySink   sink;
+  CReplayPacer pacer;
+  CReplayReader a(d.write("a.evt", events(0, 2)), 2, 1);
+  CReplayReader b(d.write("b.evt", events(10, 2)), 2, 2);
+  CReplayEngine engine(sink, pacer);
+  engine.addReader(&a);
+  engine.addReader(&b);
+  engine.run();
+
+  vector<uint64_t> expected;
+  expected.push_back(0); expected.push_back(1);
+  expected.push_back(10); expected.push_back(11);
+  vector<uint64_t> again(expected);
+  expected.insert(expected.end(), again.begin(), again.end());
+  ASSERT(sink.stamps() == expected);
+}
+// Reports are made at the interval.
+
+void
+EngineTests::Report()
+{
+  TempDir      d;
+  MemorySink   sink;
+  CReplayPacer pacer(CReplayPacer::ItemRate, 100.0);
+  CReplayReader a(d.write("a.evt", events(0, 6)));
+  CReplayEngine engine(sink, pacer);
+  engine.addReader(&a);
+  std::ostringstream report;
+  engine.setReport(&report, 0.02);
+  engine.run();
+
+  EQ(size_t(6), sink.m_items.size());
+  ASSERT(report.str().find("items/s") != string::npos);
+  ASSERT(report.str().find("MB/s") != string::npos);
+}
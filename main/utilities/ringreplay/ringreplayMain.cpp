@@ -0,0 +1,192 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file ringreplayMain.cpp
+ * @brief Main program of the ring replay benchmark driver.
+ */
+
+#include <config.h>
+#include "ringreplayargs.h"
+#include "CReplayReader.h"
+#include "CReplayPacer.h"
+#include "CReplayEngine.h"
+
+#include <CDataSink.h>
+#include <CDataSinkFactory.h>
+#include <CRingBuffer.h>
+#include <Exception.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <exception>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint64_t K(1024);
+static const uint64_t M(K*K);
+static const uint64_t G(K*M);
+
+/*
+** Decode a buffer size of the form number, numberk, numberm or numberg.
+** Exits on errors.
+*/
+static size_t
+bufferSize(const char* pValue)
+{
+  char*    end;
+  uint64_t size = strtoull(pValue, &end, 0);
+  if (strlen(end) < 2) {
+    if (*end == 'g') {
+      size *= G;
+    } else if (*end == 'm') {
+      size *= M;
+    } else if (*end == 'k') {
+      size *= K;
+    } else if (*end) {
+      std::cerr << "Buffer size multipliers must be one of g, m, or k\n";
+      exit(EXIT_FAILURE);
+    }
+    if (size) {
+      return size;
+    }
+  }
+  std::cerr << "Buffer sizes must be a nonzero integer, or an integer followed by g, m, or k\n";
+  exit(EXIT_FAILURE);
+}
+/*
+** Make the pacer the options ask for.  Exits if more than one rate is given.
+*/
+static CReplayPacer
+makePacer(const gengetopt_args_info& args)
+{
+  int nRates = args.items_per_second_given + args.mbytes_per_second_given +
+               args.timestamp_rate_given;
+  if (nRates > 1) {
+    std::cerr << "Only one of --items-per-second, --mbytes-per-second and "
+              << "--timestamp-rate can be given\n";
+    exit(EXIT_FAILURE);
+  }
+  if (args.items_per_second_given) {
+    return CReplayPacer(CReplayPacer::ItemRate, args.items_per_second_arg);
+  }
+  if (args.mbytes_per_second_given) {
+    return CReplayPacer(CReplayPacer::ByteRate, args.mbytes_per_second_arg*M);
+  }
+  if (args.timestamp_rate_given) {
+    if (args.speed_arg <= 0.0) {
+      std::cerr << "--speed must be greater than zero\n";
+      exit(EXIT_FAILURE);
+    }
+    return CReplayPacer(CReplayPacer::TimestampRate,
+                        args.timestamp_rate_arg*args.speed_arg);
+  }
+  return CReplayPacer();
+}
+
+/**
+ * main
+ *   Parse the parameters, start a reader per file and replay.
+ */
+int
+main(int argc, char** argv)
+{
+  gengetopt_args_info args;
+  if (cmdline_parser(argc, argv, &args)) {
+    exit(EXIT_FAILURE);
+  }
+  if (args.inputs_num == 0) {
+    std::cerr << "ringreplay: at least one event file must be given\n";
+    cmdline_parser_print_help();
+    exit(EXIT_FAILURE);
+  }
+  if (args.sourceid_given > args.inputs_num) {
+    std::cerr << "ringreplay: there are more --sourceid values than files\n";
+    exit(EXIT_FAILURE);
+  }
+  if (args.loop_arg < 0) {
+    std::cerr << "ringreplay: --loop must be >= 0\n";
+    exit(EXIT_FAILURE);
+  }
+  CReplayPacer pacer   = makePacer(args);
+  size_t       bufSize = bufferSize(args.buffer_size_arg);
+  std::string  sinkUri = args.sink_given ?
+    args.sink_arg : CRingBuffer::defaultRingUrl();
+
+  std::vector<CReplayReader*> readers;
+  CDataSink*                  pSink  = 0;
+  int                         status = EXIT_SUCCESS;
+  try {
+    for (unsigned i = 0; i < args.inputs_num; i++) {
+      int sourceId = (i < args.sourceid_given) ?
+        args.sourceid_arg[i] : CReplayReader::KeepSourceIds;
+      readers.push_back(new CReplayReader(
+        args.inputs[i], args.loop_arg, sourceId, bufSize, args.buffers_arg
+      ));
+    }
+    CDataSinkFactory factory;
+    pSink = factory.makeSink(sinkUri);
+    if (!pSink) {
+      throw std::string("Unable to make a data sink for ") + sinkUri;
+    }
+
+    CReplayEngine engine(*pSink, pacer);
+    for (size_t i = 0; i < readers.size(); i++) {
+      engine.addReader(readers[i]);
+    }
+    engine.setReport(&std::cerr, args.report_arg);
+
+    uint64_t start = CReplayPacer::now();
+    engine.run();
+    double seconds = (CReplayPacer::now() - start)/1.0e9;
+
+    std::cerr << "ringreplay: " << engine.items() << " items "
+              << engine.bytes() << " bytes in " << std::fixed
+              << std::setprecision(2) << seconds << " seconds";
+    if (seconds > 0.0) {
+      std::cerr << " (" << std::setprecision(0) << engine.items()/seconds
+                << " items/s " << std::setprecision(2)
+                << engine.bytes()/seconds/M << " MB/s)";
+    }
+    std::cerr << ", " << engine.stalls() << " read stalls\n";
+    for (size_t i = 0; i < readers.size(); i++) {
+      if (readers[i]->truncated()) {
+        std::cerr << "ringreplay: " << readers[i]->file()
+                  << " ends with a partial item which was not replayed\n";
+      }
+    }
+  }
+  catch (std::string msg) {
+    std::cerr << "ringreplay: " << msg << std::endl;
+    status = EXIT_FAILURE;
+  }
+  catch (CException& e) {
+    std::cerr << "ringreplay: " << e.ReasonText() << std::endl;
+    status = EXIT_FAILURE;
+  }
+  catch (std::exception& e) {
+    std::cerr << "ringreplay: " << e.what() << std::endl;
+    status = EXIT_FAILURE;
+  }
+
+  delete pSink;
+  for (size_t i = 0; i < readers.size(); i++) {
+    delete readers[i];
+  }
+  return status;
+}
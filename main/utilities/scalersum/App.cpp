@@ -31,6 +31,8 @@
 #include <CRingItemFactory.h>
 #include <CDataFormatItem.h>
 #include <DataFormat.h>
+#include <RingItemView.h>
+#include <CParallelFileAnalyzer.h>
 
 #include <ErrnoException.h>
 
@@ -53,10 +55,13 @@
  * constructor
  *
  * @param args - Command line arguments processed gengetopt.
+ * @throws std::invalid_argument - --threads or --chunk-size is negative.
  */
 App::App(struct gengetopt_args_info& args) :
     m_omitLabels(false),
     m_flip(false),
+    m_threads(0),
+    m_chunkMBytes(256),
     m_state(App::expectingStart),
     m_pCurrentRun(0)
 {
@@ -64,6 +69,18 @@ App::App(struct gengetopt_args_info& args) :
     
     if (args.omit_labels_given) m_omitLabels = true;
     if (args.flip_given)        m_flip       = true;
+    if (args.threads_given) {
+        if (args.threads_arg < 0) {
+            throw std::invalid_argument("--threads must not be negative");
+        }
+        m_threads    = args.threads_arg;
+    }
+    if (args.chunk_size_given) {
+        if (args.chunk_size_arg < 0) {
+            throw std::invalid_argument("--chunk-size must not be negative");
+        }
+        m_chunkMBytes = args.chunk_size_arg;
+    }
     if (args.name_file_given) {
         processNameFile(args.name_file_arg);
     }
@@ -88,7 +105,9 @@ App::App(struct gengetopt_args_info& args) :
  *     Process all of the input:
  *     -   If there are no input files, a data source for stdin is created
  *         and processed.
- *     -   If there are input files those are processed.
+ *     -   If there are input files those are processed.  With --threads
+ *         the files are decoded on a pool of threads first
+ *         (see processFilesInParallel).
  *  @note living above all of this is a simple state machine with the state:
  *        -  expectingStart - Looking for a begin run.
  *        -  expectingEnd   - Processing scalers until an end run.
@@ -101,6 +120,8 @@ App::operator()()
         std::unique_ptr<CDataSource>
             pDs(CDataSourceFactory::makeSource("-", dummy, dummy));
         processFile(*pDs);
+    } else if (m_threads > 0) {
+        processFilesInParallel();
     } else {
         for(auto p = m_files.begin(); p != m_files.end(); p++) {
             try {
@@ -220,41 +241,12 @@ void
 App::processFile(CDataSource& ds) {
     try {
         CRingItem* pRawItem;
+        CScalerRecorder::Record record;
         while (pRawItem = ds.getItem()) {
-            // What we do depends on type and state:
-            
-            switch (pRawItem->type()) {
-            case BEGIN_RUN:
-                if(m_state == expectingEnd) {
-                    std::cerr << "Warning, got a begin run in the middle of processing run ";
-                    std::cerr << m_pCurrentRun->getRun() << std::endl;
-                    std::cerr << "Saving partial run  sums and continuing.";
-                    end();
-                }
-                begin(*pRawItem);
-                m_state = expectingEnd;
-                break;
-            case END_RUN:
-                if (m_state == expectingStart) {
-                    std::cerr << "Warning - got an end run while expecting a begin\n";
-                    std::cerr << "Continuing processing\n";
-                    
-                    // probably don't have one but in case we do:
-                    
-                    delete m_pCurrentRun;
-                    m_pCurrentRun = 0;
-                } else {
-                    end();
-                    m_state = expectingStart;
-                }
-                break;
-            case PERIODIC_SCALERS:
-                if (m_state == expectingEnd) {
-                    scaler(*pRawItem);
-                }
-                break;
-            defaut:
-                break;
+            if (CScalerRecorder::decode(
+                CRingItemView(pRawItem->getItemPointer()), record)
+            ) {
+                processRecord(record);
             }
             
             delete pRawItem;       // - it was dynamic.
@@ -272,6 +264,88 @@ App::processFile(CDataSource& ds) {
     }
 }
 
+/**
+ * processFilesInParallel
+ *    Process all of the input files using a pool of m_threads threads.
+ *    Decoding the items is what costs; the files (split into m_chunkMBytes
+ *    pieces) are decoded in parallel into begin/end/scaler records which are
+ *    then gathered in file order and replayed through the same state machine
+ *    processFile uses.  The sums are therefore identical to a serial pass.
+ *
+ * @throw std::runtime_error - if any of the files could not be processed.
+ */
+void
+App::processFilesInParallel()
+{
+    CParallelFileAnalyzer driver(
+        m_threads, 8*1024*1024, off_t(m_chunkMBytes)*1024*1024
+    );
+    for (auto p = m_files.begin(); p != m_files.end(); p++) {
+        driver.addFile(*p);
+    }
+    
+    CScalerRecorder recorder;
+    try {
+        driver.analyze(recorder);
+    }
+    catch (CErrnoException& e) {
+        std::string msg = "Unable to process files : ";
+        msg += e.ReasonText();
+        throw std::runtime_error(msg);
+    }
+    
+    const std::vector<CScalerRecorder::Record>& records(recorder.records());
+    for (auto p = records.begin(); p != records.end(); p++) {
+        processRecord(*p);
+    }
+}
+
+/**
+ * processRecord
+ *    The state machine described in processFile.
+ *
+ * @param record - A decoded begin run, end run or scaler item.
+ */
+void
+App::processRecord(const CScalerRecorder::Record& record)
+{
+    // What we do depends on type and state:
+    
+    switch (record.s_type) {
+    case BEGIN_RUN:
+        if(m_state == expectingEnd) {
+            std::cerr << "Warning, got a begin run in the middle of processing run ";
+            std::cerr << m_pCurrentRun->getRun() << std::endl;
+            std::cerr << "Saving partial run  sums and continuing.";
+            end();
+        }
+        begin(record.s_run);
+        m_state = expectingEnd;
+        break;
+    case END_RUN:
+        if (m_state == expectingStart) {
+            std::cerr << "Warning - got an end run while expecting a begin\n";
+            std::cerr << "Continuing processing\n";
+            
+            // probably don't have one but in case we do:
+            
+            delete m_pCurrentRun;
+            m_pCurrentRun = 0;
+        } else {
+            end();
+            m_state = expectingStart;
+        }
+        break;
+    case PERIODIC_SCALERS:
+        if (m_state == expectingEnd) {
+            scaler(record.s_sourceId, record.s_incremental, record.s_scalers);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 /**
  * dumpScalerNames
  *    For debugging purposes, dumps the scaler name map to the
@@ -421,19 +495,14 @@ App::makeFileUri(std::string name)
 /**
  * begin
  *    Begin run processing
- *    - Get the run number from the item.
  *    - Create a new CRun object at m_pCurrent Run.
  *    - Redundant but set the state to expectingEnd.
- * @param item - the undifferentiated item.
+ * @param run - the run number from the begin run item.
  */
 void
-App::begin(CRingItem& item)
+App::begin(unsigned run)
 {
-    CRingStateChangeItem* pBegin =
-        dynamic_cast<CRingStateChangeItem*>(CRingItemFactory::createRingItem(item));
-    m_pCurrentRun = new CRun(pBegin->getRunNumber());
-    
-    delete pBegin;
+    m_pCurrentRun = new CRun(run);
     m_state = expectingEnd;
 }
 /**
@@ -453,31 +522,17 @@ App::end()
 /**
  * scaler
  *    Process a scaler item
- *    - Convert the item to a scaler item.
- *    - Pull out the incremental flag and the data source
  *    - Pass the increments to the run one by one...getting the scaler width
  *      as we do.
- * @param item - references the ring item that is being processed.
+ * @param srcId       - data source of the item (0 if there's no body header).
+ * @param incremental - true if the scalers are incremental.
+ * @param scalers     - the counters.
  */
 void
-App::scaler(CRingItem& item)
+App::scaler(
+    unsigned srcId, bool incremental, const std::vector<uint32_t>& scalers
+)
 {
-    CRingScalerItem* pScaler =
-        reinterpret_cast<CRingScalerItem*>(CRingItemFactory::createRingItem(item));
-        
-    // Source id is 0 if there's no body header:
-    
-    unsigned srcId;
-    if (pScaler->hasBodyHeader()) {
-        srcId = pScaler->getSourceId();
-    } else {
-        srcId = 0;
-    }
-    // Figure out if the scalers are incremental or not and get the counters.
-    
-    bool incremental = pScaler->isIncremental();
-    std::vector<uint32_t> scalers = pScaler->getScalers();
-    
     // Make a Channel struct and use it to iterate over the scalers in the
     // vector:
     
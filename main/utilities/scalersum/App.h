@@ -31,6 +31,7 @@
 
 
 #include "options.h"
+#include "CScalerRecorder.h"
 
 
 class CDataSource;
@@ -66,6 +67,8 @@ public:
 private:
     bool m_omitLabels;
     bool m_flip;
+    unsigned m_threads;
+    unsigned m_chunkMBytes;
     
     std::vector<std::string>         m_files;
     std::map<Channel, ChannelInfo>   m_channelNames;
@@ -90,11 +93,13 @@ private:
     unsigned    getScalerWidth(Channel& ch);
     
     void processFile(CDataSource& ds);
+    void processFilesInParallel();
+    void processRecord(const CScalerRecorder::Record& record);
     std::string makeFileUri(std::string name);
 
-    void begin(CRingItem& item);
+    void begin(unsigned run);
     void end();
-    void scaler(CRingItem& item);
+    void scaler(unsigned srcId, bool incremental, const std::vector<uint32_t>& scalers);
     
     void outputByRuns(
         std::ostream& out,
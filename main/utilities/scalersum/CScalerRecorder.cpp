@@ -0,0 +1,104 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2015.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CScalerRecorder.cpp
+# @brief  Implement the scaler sum item recorder.
+# @author <fox@nscl.msu.edu>
+*/
+
+#include "CScalerRecorder.h"
+#include <RingItemView.h>
+#include <DataFormat.h>
+
+/**
+ * clone
+ *    @return CItemAnalyzer* - a new, empty recorder.
+ */
+CItemAnalyzer*
+CScalerRecorder::clone() const
+{
+    return new CScalerRecorder;
+}
+
+/**
+ * analyze
+ *    Record the item if it's one the state machine cares about.
+ *
+ * @param item - view of the raw ring item.
+ */
+void
+CScalerRecorder::analyze(const CRingItemView& item)
+{
+    Record r;
+    if (decode(item, r)) {
+        m_records.push_back(r);
+    }
+}
+
+/**
+ * merge
+ *    Append the records of the recorder that saw the following data.
+ *
+ * @param following - must be a CScalerRecorder.
+ */
+void
+CScalerRecorder::merge(const CItemAnalyzer& following)
+{
+    const CScalerRecorder& other(dynamic_cast<const CScalerRecorder&>(following));
+    m_records.insert(m_records.end(), other.m_records.begin(), other.m_records.end());
+}
+
+/**
+ * decode
+ *    Turn a raw item into a record.
+ *
+ *  @param item   - view of the item.
+ *  @param record - Filled in if the item is relevant.
+ *  @return bool  - true if the item is a begin, end or scaler item.
+ */
+bool
+CScalerRecorder::decode(const CRingItemView& item, Record& record)
+{
+    record.s_type        = item.type();
+    record.s_run         = 0;
+    record.s_sourceId    = 0;
+    record.s_incremental = true;
+    record.s_scalers.clear();
+    
+    switch (record.s_type) {
+    case BEGIN_RUN:
+        record.s_run = CStateChangeItemView(item.getItemPointer()).getRunNumber();
+        return true;
+    case END_RUN:
+        return true;
+    case PERIODIC_SCALERS:
+        {
+            CScalerItemView scaler(item.getItemPointer());
+            if (scaler.hasBodyHeader()) {
+                record.s_sourceId = scaler.getSourceId();
+            }
+            record.s_incremental = scaler.isIncremental();
+            record.s_scalers.resize(scaler.getScalerCount());
+            if (!record.s_scalers.empty()) {
+                scaler.copyScalers(&record.s_scalers[0], record.s_scalers.size());
+            }
+        }
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,63 @@
+/**
+
+#    This software is Copyright by the Board of Trustees of Michigan
+#    State University (c) Copyright 2015.
+#
+#    You may use this software under the terms of the GNU public license
+#    (GPL).  The terms of this license are described at:
+#
+#     http://www.gnu.org/licenses/gpl.txt
+#
+#    Author:
+#            Ron Fox
+#            NSCL
+#            Michigan State University
+#            East Lansing, MI 48824-1321
+
+##
+# @file   CScalerRecorder.h
+# @brief  Decode the items scaler sums care about so they can be replayed.
+# @author <fox@nscl.msu.edu>
+*/
+
+#ifndef CSCALERRECORDER_H
+#define CSCALERRECORDER_H
+
+#include <CItemAnalyzer.h>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @class CScalerRecorder
+ *    Summing scalers is a state machine over begin runs, end runs and
+ *    scaler items (see App::processFile).  That state machine has to see
+ *    the items in order, but decoding them does not.  This analyzer decodes
+ *    those three item types into compact records; the parallel file
+ *    analyzer decodes pieces of the data on separate threads and
+ *    concatenates the records in data order.  The application then replays
+ *    them through the state machine.
+ */
+class CScalerRecorder : public CItemAnalyzer
+{
+public:
+    typedef struct _Record {
+        uint32_t              s_type;          // BEGIN_RUN, END_RUN, PERIODIC_SCALERS
+        unsigned              s_run;           // BEGIN_RUN only.
+        unsigned              s_sourceId;      // Scalers only (0 if no body header).
+        bool                  s_incremental;   // Scalers only.
+        std::vector<uint32_t> s_scalers;       // Scalers only.
+    } Record, *pRecord;
+private:
+    std::vector<Record> m_records;
+public:
+    virtual CItemAnalyzer* clone() const;
+    virtual void analyze(const CRingItemView& item);
+    virtual void merge(const CItemAnalyzer& following);
+    
+    const std::vector<Record>& records() const { return m_records; }
+    void clear() { m_records.clear(); }
+    
+    static bool decode(const CRingItemView& item, Record& record);
+};
+
+#endif
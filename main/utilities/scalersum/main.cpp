@@ -39,7 +39,7 @@
 int main(int argc, char** argv)
 {
     struct gengetopt_args_info processParams;
-    App* pApp;
+    App* pApp(0);
     
     if (cmdline_parser(argc, argv, &processParams)) {
         exit(EXIT_FAILURE);             // cmdline_parser writes error msgs.
@@ -54,8 +54,10 @@ int main(int argc, char** argv)
     catch(std::exception& e) {
         std::cerr << e.what() << std::endl;
         
-        std::cerr << "Fatal error, dumping what we've got so far";
-        pApp->outputResults(std::cout);
+        if (pApp) {
+            std::cerr << "Fatal error, dumping what we've got so far";
+            pApp->outputResults(std::cout);
+        }
         
         exit(EXIT_FAILURE);
     }
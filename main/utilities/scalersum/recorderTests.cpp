@@ -0,0 +1,134 @@
+// Tests for the scaler item recorder used by the parallel path.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CScalerRecorder.h"
+#include <RingItemView.h>
+#include <DataFormat.h>
+
+#include <stdlib.h>
+
+
+class testRecorder : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(testRecorder);
+  CPPUNIT_TEST(begin);
+  CPPUNIT_TEST(end);
+  CPPUNIT_TEST(scalers);
+  CPPUNIT_TEST(timestampedScalers);
+  CPPUNIT_TEST(ignored);
+  CPPUNIT_TEST(mergeOrder);
+  CPPUNIT_TEST_SUITE_END();
+
+
+private:
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void begin();
+  void end();
+  void scalers();
+  void timestampedScalers();
+  void ignored();
+  void mergeOrder();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(testRecorder);
+
+void testRecorder::begin()
+{
+  pStateChangeItem pItem = formatStateChange(0, 0, 1234, "title", BEGIN_RUN);
+  CScalerRecorder::Record r;
+  
+  ASSERT(CScalerRecorder::decode(CRingItemView(pItem), r));
+  EQ(uint32_t(BEGIN_RUN), r.s_type);
+  EQ(unsigned(1234), r.s_run);
+  
+  free(pItem);
+}
+
+void testRecorder::end()
+{
+  pStateChangeItem pItem = formatStateChange(0, 10, 1234, "title", END_RUN);
+  CScalerRecorder::Record r;
+  
+  ASSERT(CScalerRecorder::decode(CRingItemView(pItem), r));
+  EQ(uint32_t(END_RUN), r.s_type);
+  
+  free(pItem);
+}
+
+void testRecorder::scalers()
+{
+  uint32_t counters[4] = {1, 2, 3, 4};
+  pScalerItem pItem = formatScalerItem(4, 0, 0, 10, counters);
+  CScalerRecorder::Record r;
+  
+  ASSERT(CScalerRecorder::decode(CRingItemView(pItem), r));
+  EQ(uint32_t(PERIODIC_SCALERS), r.s_type);
+  EQ(unsigned(0), r.s_sourceId);
+  EQ(true, r.s_incremental);
+  EQ(size_t(4), r.s_scalers.size());
+  for (int i = 0; i < 4; i++) {
+    EQ(counters[i], r.s_scalers[i]);
+  }
+  
+  free(pItem);
+}
+
+void testRecorder::timestampedScalers()
+{
+  uint32_t counters[2] = {10, 20};
+  pScalerItem pItem =
+    formatTimestampedScalerItem(0x1234, 5, 0, 0, 1, 0, 0, 10, 2, counters);
+  CScalerRecorder::Record r;
+  
+  ASSERT(CScalerRecorder::decode(CRingItemView(pItem), r));
+  EQ(unsigned(5), r.s_sourceId);
+  EQ(false, r.s_incremental);
+  EQ(size_t(2), r.s_scalers.size());
+  EQ(uint32_t(20), r.s_scalers[1]);
+  
+  free(pItem);
+}
+
+void testRecorder::ignored()
+{
+  pPhysicsEventItem pItem = formatEventItem(2, const_cast<char*>("abcd"));
+  CScalerRecorder::Record r;
+  
+  ASSERT(!CScalerRecorder::decode(CRingItemView(pItem), r));
+  
+  CScalerRecorder rec;
+  rec.analyze(CRingItemView(pItem));
+  EQ(size_t(0), rec.records().size());
+  
+  free(pItem);
+}
+// merge appends so the records stay in data order.
+
+void testRecorder::mergeOrder()
+{
+  pStateChangeItem pBegin = formatStateChange(0, 0, 1, "title", BEGIN_RUN);
+  pStateChangeItem pEnd   = formatStateChange(0, 10, 1, "title", END_RUN);
+  
+  CScalerRecorder first;
+  first.analyze(CRingItemView(pBegin));
+  CItemAnalyzer* pSecond = first.clone();
+  EQ(size_t(0), dynamic_cast<CScalerRecorder*>(pSecond)->records().size());
+  pSecond->analyze(CRingItemView(pEnd));
+  
+  first.merge(*pSecond);
+  EQ(size_t(2), first.records().size());
+  EQ(uint32_t(BEGIN_RUN), first.records()[0].s_type);
+  EQ(uint32_t(END_RUN), first.records()[1].s_type);
+  
+  delete pSecond;
+  free(pBegin);
+  free(pEnd);
+}
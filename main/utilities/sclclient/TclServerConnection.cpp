@@ -54,17 +54,99 @@ int TclServerConnection::SendCommand(const string& rData)
   //   -1     - Some errno like error.
   //    n     - Number of bytes actually sent.
   //
+  // Replies to scripts still in flight are collected first so that the
+  // reply we wait for is the one to this command.
+  // If the connection is lost, the disconnect callback may have
+  // destroyed this object so we return without touching members.
+  //
+  while(m_nOutstanding > 0) {
+    if(ConsumeReplies(true) < 0) return -1;
+  }
   Flush();
-  int nSent;
-  string MyCopy = rData + '\n';	// Add in the newline.
   m_Response = string("");	// Empty response string first.
-  nSent = Send((void*)MyCopy.c_str(), MyCopy.size());
-  if(nSent >= 0) GetLine(m_Response);
+  int nSent = SendScript(rData);
+  if(nSent > 0) {
+    if(ConsumeReplies(true) < 0) return -1;
+  }
   return nSent;
 }
 //////////////////////////////////////////////////////////////////////////////
 //
 //  Function:       
+//     SendScript(string& rScript)
+//  Operation Type: 
+//     
+int TclServerConnection::SendScript(const string& rScript)
+{
+  // Sends a script terminated by a newline in a single write and
+  // returns without waiting for the reply.  The reply is counted as
+  // outstanding until ConsumeReplies sees it.
+  //
+  // The script is wrapped so that its reply is a single line even if it
+  // fails or its result spans lines; otherwise the line count would get
+  // out of step with the scripts sent.
+  //
+  // Returns:
+  //    0     - Disconnected
+  //   -1     - Some errno like error.
+  //    n     - Number of bytes sent.
+  //
+  string MyCopy = "catch {" + rScript + "} SclClientReply; "
+                  "string map [list \\n { }] $SclClientReply\n";
+  const char* p = MyCopy.c_str();
+  int nLeft     = MyCopy.size();
+  while(nLeft > 0) {
+    int nSent = Send((void*)p, nLeft);
+    if(nSent <= 0) return nSent; // Lost; this may be gone.
+    p     += nSent;
+    nLeft -= nSent;
+  }
+  m_nOutstanding++;
+  return MyCopy.size();
+}
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       
+//     ConsumeReplies(bool wait)
+//  Operation Type: 
+//     
+int TclServerConnection::ConsumeReplies(bool wait)
+{
+  // Reads the replies to outstanding scripts that have arrived.  If wait
+  // is true, blocks until at least one reply is in.  The text of the last
+  // reply becomes the response.  SendScript makes each reply one line.
+  //
+  // Returns:
+  //   Number of replies consumed.
+  //   -1    - The connection was lost (this may have been destroyed).
+  //
+  int  nReplies = 0;
+  char Buffer[1024];
+  while(m_nOutstanding > 0) {
+    if(!wait || (nReplies > 0)) {
+      if(Poll() != 1) break;	// Nothing more without blocking.
+    }
+    int nRead = Receive(Buffer, sizeof(Buffer));
+    if(nRead <= 0) return -1;
+    for(int i = 0; i < nRead; i++) {
+      if(Buffer[i] == '\n') {
+	if(m_nOutstanding > 0) {
+	  m_Response = m_Partial;
+	  m_nOutstanding--;
+	  nReplies++;
+	}
+	m_Partial = string("");
+      }
+      else {
+	m_Partial += Buffer[i];
+      }
+    }
+  }
+  return nReplies;
+}
+//////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       
 //     GetLastResponse()
 //  Operation Type: 
 //     
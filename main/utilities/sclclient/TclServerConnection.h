@@ -43,10 +43,23 @@
 #endif
 
 
+/*!
+  Connection to a Tcl server.  SendCommand sends a command and waits for
+  its reply.  SendScript sends a script without waiting; its reply is
+  collected later by ConsumeReplies (or by the next SendCommand) so that
+  any number of scripts can be in flight.
+
+  Replies are matched to scripts by counting lines, so each script is
+  sent wrapped in a catch that makes its reply exactly one line: the
+  script's result, or its error message, with newlines turned into
+  spaces.  Scripts must therefore be brace balanced.
+*/
 class TclServerConnection  : public TcpClientConnection        
 {                       
 			
    std::string m_Response; //Response from last tcl command        
+   std::string m_Partial;  // Reply text not yet terminated by a newline.
+   int         m_nOutstanding; // Scripts sent whose replies aren't in.
 
 protected:
 
@@ -57,7 +70,8 @@ public:
   TclServerConnection (const std::string& RemoteHost=std::string("localhost"), 
 		       int nPort=2700)    : 
     TcpClientConnection(RemoteHost, nPort),
-    m_Response(std::string("")) 
+    m_Response(std::string("")),
+    m_nOutstanding(0)
   {}
   virtual ~TclServerConnection ( )  // Destructor 
   { }  
@@ -69,6 +83,9 @@ private:
 public:	
 
    int SendCommand (const std::string& rData)    ;
+   int SendScript (const std::string& rScript)    ;
+   int ConsumeReplies (bool wait = false)    ;
+   int Outstanding () const { return m_nOutstanding; }
    std::string GetLastResponse ()    ;
  
 protected:
@@ -43,6 +43,11 @@
 
 using namespace std;
 
+// Scripts that may be in flight to the server before we wait for replies.
+// This bounds how far the display can lag behind the data.
+
+static const int MAX_OUTSTANDING(8);
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Constructors and other canonicals we bothered to implement:
@@ -239,8 +244,7 @@ SclClientMain::processItems()
 	  // If the begin run not seen.. call RunInProgres in the server
 
 	  if (!beginSeen) {
-	    m_pServer->SendCommand("set RunState Active");
-	    m_pServer->SendCommand("RunInProgress");
+	    sendScript("set RunState Active; RunInProgress");
 	    clearTotals();
 	    beginSeen = true;	// only do this once though.
 	  }
@@ -278,13 +282,15 @@ SclClientMain::processScalers(const CRingScalerItem& item)
   float startTime           = item.computeStartTime();
   float endTime             = item.computeEndTime();
   vector<uint32_t> increments  = item.getScalers();
+  string script;		// All the updates go in one script.
   
   // What we do next depends on whether or not there's a body header:
   
   if (item.hasBodyHeader()) {
         uint32_t source = item.getSourceId();
         processScalers(
-            source, startTime, endTime, increments, item.isIncremental()
+            script, source, startTime, endTime, increments,
+            item.isIncremental()
         );
     
   } else {
@@ -314,18 +320,18 @@ SclClientMain::processScalers(const CRingScalerItem& item)
     
       // Interact with the server:
     
-      setDouble("ScalerDeltaTime", deltaTime);
-      setDouble("ElapsedRunTime",  elapsedTime);
-      setInteger("Incremental", item.isIncremental() ? 1 : 0);
-      for (int i = 0; i < increments.size(); i++) {
-        setInteger("Scaler_Increments", increments[i], i);
-        setDouble("Scaler_Totals",  m_Totals[i], i);
-      }
+      char command[128];
+      sprintf(command, "set ScalerDeltaTime %f", deltaTime);
+      appendCommand(script, command);
+      sprintf(command, "set ElapsedRunTime %f", elapsedTime);
+      appendCommand(script, command);
+      sprintf(command, "set Incremental %d", item.isIncremental() ? 1 : 0);
+      appendCommand(script, command);
+      appendArraySet(script, "Scaler_Increments", increments);
+      appendArraySet(script, "Scaler_Totals", m_Totals);
   }
-  m_pServer->SendCommand("Update");
-
-
-
+  appendCommand(script, "Update");
+  sendScript(script);
 }
 /**
  * processScalers
@@ -333,6 +339,7 @@ SclClientMain::processScalers(const CRingScalerItem& item)
  * This overload of processScalers processes scalers when they have a defined
  * data source associated with them.
  *
+ * @param script        - Script the server commands are appended to.
  * @param id            - Source id.
  * @param startOffset   - Time offset (floating pt. seconds).
  * @param endOffset     - Time offfset (floating pt. seconds).
@@ -341,8 +348,8 @@ SclClientMain::processScalers(const CRingScalerItem& item)
  */
 void
 SclClientMain::processScalers(
-    uint32_t id, float startOffset, float endOffset, std::vector<uint32_t> scalers,
-    bool incremental
+    std::string& script, uint32_t id, float startOffset, float endOffset,
+    const std::vector<uint32_t>& scalers, bool incremental
 )
 {
     float deltaTime = endOffset - startOffset;
@@ -374,31 +381,23 @@ SclClientMain::processScalers(
       Now we're ready to interact with the server.  The main point is that
       indices are of the form index.id.
     */
-    setDouble("ScalerDeltaTime", deltaTime);
+    char command[128];
+    sprintf(command, "set ScalerDeltaTime %f", deltaTime);
+    appendCommand(script, command);
 
     /* Elapsed run time needs to be done via the proc
       SourceElapsedTime
       Since the actual time should be the max time seen.
     */
-    char updateRunTime[100];
-    sprintf(updateRunTime, "SourceElapsedTime %f", elapsedTime);
-    m_pServer->SendCommand(updateRunTime);
-    setInteger("Incremental", incremental ? 1 : 0);
-    setInteger("LastDataSource", id);
+    sprintf(command, "SourceElapsedTime %f", elapsedTime);
+    appendCommand(script, command);
+    sprintf(command, "set Incremental %d", incremental ? 1 : 0);
+    appendCommand(script, command);
+    sprintf(command, "set LastDataSource %u", id);
+    appendCommand(script, command);
     
-    for (int i = 0; i < scalers.size(); i++) {
-        
-        // Figure out the index string:
-        
-      char incrementString[100];
-      sprintf(incrementString, "Scaler_Increments(%d.%d)", i, id);
-      
-      char totalsString[100];
-      sprintf(totalsString, "Scaler_Totals(%d.%d)", i, id);
-        
-      setInteger(incrementString, scalers[i]);
-      setDouble(totalsString,  totals[i]);
-    }
+    appendArraySet(script, "Scaler_Increments", scalers, id);
+    appendArraySet(script, "Scaler_Totals", totals, id);
 }
 /*
 ** Process state change items.
@@ -419,38 +418,44 @@ SclClientMain::processStateChange(const CRingStateChangeItem& item)
   float    elapsed = item.computeElapsedTime();
   
 
-  setInteger("RunNumber", run);
-  setDouble("ElapsedRunTime", elapsed);
+  string script;
+  char   command[128];
+  sprintf(command, "set RunNumber %u", run);
+  appendCommand(script, command);
+  sprintf(command, "set ElapsedRunTime %f", elapsed);
+  appendCommand(script, command);
 
-  string command = "set RunTitle {";
-  command += item.getTitle();
-  command += "}";
-  m_pServer->SendCommand(command);
+  string title = "set RunTitle {";
+  title += item.getTitle();
+  title += "}";
+  appendCommand(script, title);
 
+  string state;
   string stateproc;
 
-  command = "set RunState ";
+  state = "set RunState ";
   switch (type) {
   case BEGIN_RUN:
-    command += "Active";
+    state += "Active";
     stateproc = "BeginRun";
     clearTotals();
     break;
   case RESUME_RUN:
-    command += "Active";
+    state += "Active";
     stateproc = "ResumeRun";
     break;
   case PAUSE_RUN:
-    command += "Paused";
+    state += "Paused";
     stateproc = "PauseRun";
     break;
   case END_RUN:
-    command += "Inactive";
+    state += "Inactive";
     stateproc= "EndRun";
     break;
   }
-  m_pServer->SendCommand(command);
-  m_pServer->SendCommand(stateproc);
+  appendCommand(script, state);
+  appendCommand(script, stateproc);
+  sendScript(script);
 
   //  m_pServer->SendCommand("Update");
 
@@ -463,10 +468,8 @@ SclClientMain::processStateChange(const CRingStateChangeItem& item)
 void
 SclClientMain::initializeStateChange()
 {
-  m_pServer->SendCommand("set RunState *Unknown*");
-  m_pServer->SendCommand("set RunTitle *Unknown*");
-  m_pServer->SendCommand("set RunNumber *Unknown*");
-  m_pServer->SendCommand("set ElapsedRunTime *Unknown");
+  sendScript("set RunState *Unknown*; set RunTitle *Unknown*; "
+             "set RunNumber *Unknown*; set ElapsedRunTime *Unknown");
 }
 /*
 ** Connect to the Tcl server and establish connection lost callbacks.
@@ -532,47 +535,80 @@ SclClientMain::defaultRing()
 
 
 /*
-** Set an integer Tcl variable in the server:
+** Send a script to the server without waiting for its reply.  Replies
+** that have come in are consumed; if too many scripts are in flight we
+** wait for the server to catch up.
 **
-** Parameters:
-**   name    - Base name of the array.
-**   value   - Value to set.
-**   index   - if non-negative an integer array index.
+** If the connection is lost, ConnectionLost has replaced m_pServer and
+** reinitialized the server state by the time SendScript or
+** ConsumeReplies returns.
 */
 void
-SclClientMain::setInteger(string name, int value, int index)
+SclClientMain::sendScript(const string& script)
 {
-  string command;
-  char   buffer[128];
-  if (index < 0) {
-    sprintf(buffer, "set %s %d", name.c_str(), value);
-  }
-  else {
-    sprintf(buffer, "set %s(%d) %d", name.c_str(), index, value);
+  if (m_pServer->SendScript(script) <= 0) return;
+  if (m_pServer->ConsumeReplies() < 0)    return;
+  while (m_pServer->Outstanding() > MAX_OUTSTANDING) {
+    if (m_pServer->ConsumeReplies(true) < 0) return;
   }
-  command = buffer;
-  m_pServer->SendCommand(command);
 }
 
 /*
-** Sets a floating point tcl variable in the server.
-** Parameters are similar to setInteger above.
+** Append a command to a script, separating it from prior commands with ;
+** so that the script stays on one line.
 */
 void
-SclClientMain::setDouble(string name, double value, int index)
+SclClientMain::appendCommand(string& script, const string& command)
 {
-  string command;
-  char   buffer[256];
-
-  if (index < 0) {
-    sprintf(buffer, "set %s %f", name.c_str(), value);
+  if (!script.empty()) {
+    script += "; ";
   }
-  else {
-    sprintf(buffer, "set %s(%d) %.0f", name.c_str(),  index, value);
+  script += command;
+}
+/*
+** Append an array set of a scaler array.  The indices are the channel
+** numbers or, if sourceId is non-negative, channel.sourceId.
+*/
+void
+SclClientMain::appendArraySet(string& script, const char* name,
+                              const vector<uint32_t>& values, int sourceId)
+{
+  string command = "array set ";
+  command += name;
+  command += " {";
+  char element[64];
+  for (int i = 0; i < values.size(); i++) {
+    if (sourceId < 0) {
+      sprintf(element, "%d %u ", i, values[i]);
+    } else {
+      sprintf(element, "%d.%d %u ", i, sourceId, values[i]);
+    }
+    command += element;
   }
-  command = buffer;
-
-  m_pServer->SendCommand(command);
+  command += "}";
+  appendCommand(script, command);
+}
+/*
+** As above for the totals, which are kept as doubles.
+*/
+void
+SclClientMain::appendArraySet(string& script, const char* name,
+                              const vector<double>& values, int sourceId)
+{
+  string command = "array set ";
+  command += name;
+  command += " {";
+  char element[128];
+  for (int i = 0; i < values.size(); i++) {
+    if (sourceId < 0) {
+      sprintf(element, "%d %.0f ", i, values[i]);
+    } else {
+      sprintf(element, "%d.%d %.0f ", i, sourceId, values[i]);
+    }
+    command += element;
+  }
+  command += "}";
+  appendCommand(script, command);
 }
 /*
 ** Clear the totals array both here and in the tclserver
@@ -580,18 +616,21 @@ SclClientMain::setDouble(string name, double value, int index)
 void
 SclClientMain::clearTotals()
 {
-  for (int i =0; i < m_Totals.size(); i++) {
-    m_Totals[i] = 0.0;
-    setDouble("Scaler_Totals", 0.0, i);
-    setInteger("Scaler_Increments", 0, i);
-  }
-  m_sourcedTotals.clear();
-  //
-  // At the very beginning of the first run,
-  // the scaler display program won't have any scaler array elements.
-  // not until the first update in any event.
-  //
   if (m_Totals.size() > 0) {
-    m_pServer->SendCommand("Update");
+    for (int i =0; i < m_Totals.size(); i++) {
+      m_Totals[i] = 0.0;
+    }
+    string script;
+    appendArraySet(script, "Scaler_Totals", m_Totals);
+    appendArraySet(script, "Scaler_Increments",
+                   vector<uint32_t>(m_Totals.size(), 0));
+    //
+    // At the very beginning of the first run,
+    // the scaler display program won't have any scaler array elements.
+    // not until the first update in any event.
+    //
+    appendCommand(script, "Update");
+    sendScript(script);
   }
+  m_sourcedTotals.clear();
 }
@@ -88,8 +88,9 @@ private:
   int  getDisplayPort(std::string portArg);
   void processItems();
   void processScalers(const CRingScalerItem& item);
-  void processScalers(uint32_t sourceId, float start, float end,
-                      std::vector<uint32_t> values, bool incremental);
+  void processScalers(std::string& script, uint32_t sourceId,
+                      float start, float end,
+                      const std::vector<uint32_t>& values, bool incremental);
   void processStateChange(const CRingStateChangeItem& item);
   void initializeStateChange();
   void connectTclServer();
@@ -97,8 +98,14 @@ private:
   static void ConnectionLostRelay(TcpClientConnection& connection, void* theObject);
   std::string defaultRing();
 
-  void setInteger(std::string name, int value, int index = -1);
-  void setDouble(std::string name,  double value, int index = -1);
+  void sendScript(const std::string& script);
+  static void appendCommand(std::string& script, const std::string& command);
+  static void appendArraySet(std::string& script, const char* name,
+                             const std::vector<uint32_t>& values,
+                             int sourceId = -1);
+  static void appendArraySet(std::string& script, const char* name,
+                             const std::vector<double>& values,
+                             int sourceId = -1);
   void clearTotals();
 };
 
@@ -0,0 +1,103 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCAENV1x90Unpacker.cpp
+ * @brief Implement the CAEN V1190/V1290 unpacker.
+ */
+
+#include "CCAENV1x90Unpacker.h"
+#include "CHitTable.h"
+#include "UnpackKernel.h"
+
+#include <string>
+
+// Field definitions; the same as those in CCAENV1x90Data.h.
+
+static const uint32_t TYPE_MASK(0xf8000000);
+static const uint32_t GLOBAL_HEADER(0x40000000);
+static const uint32_t GLOBAL_TRAILER(0x80000000);
+static const uint32_t MEASUREMENT(0x00000000);
+static const uint32_t FILLER(0xc0000000);
+static const uint32_t GEO_MASK(0x1f);
+
+static const UnpackKernel::Layout layout1190 = {
+  TYPE_MASK, MEASUREMENT,
+  19, 0x7f,                          // Channel.
+  0x0007ffff,                        // Value.
+  26, 1, 2                           // Trailing bit -> CHitTable::Trailing
+};
+static const UnpackKernel::Layout layout1290 = {
+  TYPE_MASK, MEASUREMENT,
+  21, 0x1f,
+  0x001fffff,
+  26, 1, 2
+};
+
+/**
+ * constructor
+ *
+ * @param is1190 - true for a V1190, false for a V1290.  They place the
+ *                 channel and value differently.
+ */
+CCAENV1x90Unpacker::CCAENV1x90Unpacker(bool is1190) :
+  m_is1190(is1190)
+{
+}
+/**
+ * clone
+ */
+CCAENV1x90Unpacker*
+CCAENV1x90Unpacker::clone() const
+{
+  return new CCAENV1x90Unpacker(*this);
+}
+/**
+ * unpack
+ *   Decode the module's event.
+ *
+ * @return const uint32_t* - Past the global trailer.
+ * @throw  std::string - No global header, or no global trailer before
+ *                       pEnd.
+ */
+const uint32_t*
+CCAENV1x90Unpacker::unpack(const uint32_t* p, const uint32_t* pEnd,
+                           uint32_t source, CHitTable& hits)
+{
+  const UnpackKernel::Layout& layout(m_is1190 ? layout1190 : layout1290);
+
+  while ((p < pEnd) && ((UnpackKernel::load(p) & TYPE_MASK) == FILLER)) {
+    p++;
+  }
+  if ((p >= pEnd) ||
+      ((UnpackKernel::load(p) & TYPE_MASK) != GLOBAL_HEADER)) {
+    throw std::string("CCAENV1x90Unpacker::unpack - expected a global header");
+  }
+  uint32_t geo = UnpackKernel::load(p) & GEO_MASK;
+  p++;
+
+  while (p < pEnd) {
+    p += UnpackKernel::decodeRun(p, pEnd - p, layout, source, geo, hits);
+    if (p < pEnd) {
+      uint32_t type = UnpackKernel::load(p) & TYPE_MASK;
+      p++;
+      if (type == GLOBAL_TRAILER) {
+        return p;
+      }
+    }
+  }
+  throw std::string("CCAENV1x90Unpacker::unpack - no global trailer");
+}
@@ -0,0 +1,49 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCAENV1x90Unpacker.h
+ * @brief Unpacker for the CAEN V1190/V1290 multihit TDCs.
+ */
+#ifndef CCAENV1X90UNPACKER_H
+#define CCAENV1X90UNPACKER_H
+
+#include "CModuleUnpacker.h"
+
+/**
+ * @class CCAENV1x90Unpacker
+ *
+ *   Decodes one event of a V1190 or V1290 as described by
+ *   CCAENV1x90Data.h: a global header with the GEO, TDC headers,
+ *   measurements, TDC trailers, errors and trigger time tags in any
+ *   order, then a global trailer.  Measurements become hits (module is
+ *   the GEO, trailing edges have the Trailing flag); everything else is
+ *   skipped.  Filler words before the global header are skipped.
+ */
+class CCAENV1x90Unpacker : public CModuleUnpacker
+{
+private:
+  bool m_is1190;
+
+public:
+  CCAENV1x90Unpacker(bool is1190 = true);
+
+  virtual CCAENV1x90Unpacker* clone() const;
+  virtual const uint32_t* unpack(const uint32_t* p, const uint32_t* pEnd,
+                                 uint32_t source, CHitTable& hits);
+};
+
+#endif
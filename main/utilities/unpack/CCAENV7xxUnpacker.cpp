@@ -0,0 +1,97 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCAENV7xxUnpacker.cpp
+ * @brief Implement the CAEN V785/V775/V792 unpacker.
+ */
+
+#include "CCAENV7xxUnpacker.h"
+#include "CHitTable.h"
+#include "UnpackKernel.h"
+
+#include <string>
+
+const uint32_t CCAENV7xxUnpacker::TypeMask;
+const uint32_t CCAENV7xxUnpacker::Header;
+const uint32_t CCAENV7xxUnpacker::Data;
+const uint32_t CCAENV7xxUnpacker::Trailer;
+const uint32_t CCAENV7xxUnpacker::Invalid;
+
+static const UnpackKernel::Layout layout = {
+  CCAENV7xxUnpacker::TypeMask, CCAENV7xxUnpacker::Data,
+  16, 0x1f,                              // Channel.
+  0xfff,                                 // Value.
+  12, 3, 0                               // OV -> Overflow, UN -> Underflow.
+};
+
+static const unsigned GEO_SHIFT(27);
+static const unsigned COUNT_SHIFT(8);
+static const uint32_t COUNT_MASK(0x3f);
+
+/**
+ * clone
+ */
+CCAENV7xxUnpacker*
+CCAENV7xxUnpacker::clone() const
+{
+  return new CCAENV7xxUnpacker(*this);
+}
+/**
+ * unpack
+ *   Decode one event of the module.  Leading invalid data words are
+ *   skipped; if that's all the module gave, it had no event.
+ *
+ * @param p      - First word of the module's data.
+ * @param pEnd   - End of the event.
+ * @param source - Source id for the hits.
+ * @param hits   - Table the hits are appended to.
+ *
+ * @return const uint32_t* - Past the trailer (or the invalid words).
+ * @throw  std::string - the data is not a V7xx event.
+ */
+const uint32_t*
+CCAENV7xxUnpacker::unpack(const uint32_t* p, const uint32_t* pEnd,
+                          uint32_t source, CHitTable& hits)
+{
+  if ((p < pEnd) && ((UnpackKernel::load(p) & TypeMask) == Invalid)) {
+    while ((p < pEnd) && ((UnpackKernel::load(p) & TypeMask) == Invalid)) {
+      p++;
+    }
+    return p;
+  }
+  if (p >= pEnd) {
+    throw std::string("CCAENV7xxUnpacker::unpack - no data for the module");
+  }
+  uint32_t header = UnpackKernel::load(p);
+  if ((header & TypeMask) != Header) {
+    throw std::string("CCAENV7xxUnpacker::unpack - expected a header");
+  }
+  uint32_t geo   = header >> GEO_SHIFT;
+  size_t   count = (header >> COUNT_SHIFT) & COUNT_MASK;
+  p++;
+  if (size_t(pEnd - p) < count + 1) {
+    throw std::string("CCAENV7xxUnpacker::unpack - event runs past the end of the data");
+  }
+  if (UnpackKernel::decodeRun(p, count, layout, source, geo, hits) != count) {
+    throw std::string("CCAENV7xxUnpacker::unpack - fewer data words than the header count");
+  }
+  p += count;
+  if ((UnpackKernel::load(p) & TypeMask) != Trailer) {
+    throw std::string("CCAENV7xxUnpacker::unpack - expected a trailer");
+  }
+  return p + 1;
+}
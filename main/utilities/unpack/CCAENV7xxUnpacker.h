@@ -0,0 +1,55 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CCAENV7xxUnpacker.h
+ * @brief Unpacker for the CAEN V785/V775/V792 peak sensing ADC, TDC and QDC.
+ */
+#ifndef CCAENV7XXUNPACKER_H
+#define CCAENV7XXUNPACKER_H
+
+#include "CModuleUnpacker.h"
+
+/**
+ * @class CCAENV7xxUnpacker
+ *
+ *   The V785, V775 and V792 (and their N variants) share a format:
+ *
+ *   - Header:  GEO 31-27, type (26-24) 2, crate 23-16, word count 13-8.
+ *   - Data:    GEO 31-27, type 0, channel 20-16, underflow bit 13,
+ *              overflow bit 12, value 11-0.
+ *   - Trailer: GEO 31-27, type 4, event counter 23-0.
+ *   - Type 6 marks a word with no valid data; a module with nothing to
+ *     read out may give one of these instead of an event.
+ *
+ *   The module column of the hits is the GEO.
+ */
+class CCAENV7xxUnpacker : public CModuleUnpacker
+{
+public:
+  static const uint32_t TypeMask = 0x07000000;
+  static const uint32_t Header   = 0x02000000;
+  static const uint32_t Data     = 0x00000000;
+  static const uint32_t Trailer  = 0x04000000;
+  static const uint32_t Invalid  = 0x06000000;
+
+public:
+  virtual CCAENV7xxUnpacker* clone() const;
+  virtual const uint32_t* unpack(const uint32_t* p, const uint32_t* pEnd,
+                                 uint32_t source, CHitTable& hits);
+};
+
+#endif
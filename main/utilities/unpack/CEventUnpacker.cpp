@@ -0,0 +1,235 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CEventUnpacker.cpp
+ * @brief Implement the physics event body unpacker.
+ */
+
+#include <config.h>
+#include "CEventUnpacker.h"
+#include "CModuleUnpacker.h"
+#include "CHitTable.h"
+
+#include <CRingItem.h>
+#include <DataFormat.h>
+#include <fragment.h>
+
+#include <string>
+#include <string.h>
+
+const uint32_t CEventUnpacker::AnySource;
+
+/**
+ * constructor
+ *   No modules; events are unbuilt.
+ */
+CEventUnpacker::CEventUnpacker() :
+  m_built(false)
+{
+}
+/**
+ * copy constructor
+ *   The module unpackers are cloned.
+ */
+CEventUnpacker::CEventUnpacker(const CEventUnpacker& rhs)
+{
+  copyIn(rhs);
+}
+/**
+ * destructor
+ *   Deletes the module unpackers.
+ */
+CEventUnpacker::~CEventUnpacker()
+{
+  destroy();
+}
+/**
+ * operator=
+ */
+CEventUnpacker&
+CEventUnpacker::operator=(const CEventUnpacker& rhs)
+{
+  if (this != &rhs) {
+    destroy();
+    copyIn(rhs);
+  }
+  return *this;
+}
+
+/**
+ * addModule
+ *   Add a module to the end of the modules read by a source.
+ *
+ * @param pModule - Unpacker for the module; it becomes owned by this object.
+ * @param source  - Source id, AnySource for events with no (or an
+ *                  otherwise unknown) source id.
+ */
+void
+CEventUnpacker::addModule(CModuleUnpacker* pModule, uint32_t source)
+{
+  m_sources[source].s_modules.push_back(pModule);
+}
+/**
+ * setPrefix
+ *   Set the number of bytes that precede the module data in a source's
+ *   event bodies (0 by default).
+ */
+void
+CEventUnpacker::setPrefix(size_t bytes, uint32_t source)
+{
+  m_sources[source].s_prefixBytes = bytes;
+}
+
+/**
+ * unpack
+ *   Unpack a physics event ring item, built or not depending on
+ *   setBuilt.
+ */
+void
+CEventUnpacker::unpack(const CRingItem& item, CHitTable& hits)
+{
+  if (m_built) {
+    unpackBuiltBody(item.getBodyPointer(), item.getBodySize(), hits);
+  } else {
+    uint32_t source = item.hasBodyHeader() ? item.getSourceId() : AnySource;
+    unpackBody(item.getBodyPointer(), item.getBodySize(), source, hits);
+  }
+}
+/**
+ * unpackBody
+ *   Unpack the body of an unbuilt event.
+ *
+ * @param pBody  - The body (after any body header).
+ * @param nBytes - Its size.
+ * @param source - The source id that determines the modules.
+ * @param hits   - Table the hits are appended to.
+ */
+void
+CEventUnpacker::unpackBody(const void* pBody, size_t nBytes, uint32_t source,
+                           CHitTable& hits)
+{
+  Source* pSource = findSource(source);
+  if (!pSource) return;
+
+  if (nBytes < pSource->s_prefixBytes) {
+    throw std::string("CEventUnpacker::unpackBody - body is smaller than its prefix");
+  }
+  const uint8_t*  pBytes = static_cast<const uint8_t*>(pBody) + pSource->s_prefixBytes;
+  const uint32_t* p      = reinterpret_cast<const uint32_t*>(pBytes);
+  const uint32_t* pEnd   = p + (nBytes - pSource->s_prefixBytes)/sizeof(uint32_t);
+
+  std::vector<CModuleUnpacker*>& modules(pSource->s_modules);
+  for (size_t i = 0; i < modules.size(); i++) {
+    p = modules[i]->unpack(p, pEnd, source, hits);
+  }
+}
+/**
+ * unpackBuiltBody
+ *   Unpack the body of an event built by glom: a longword with the body
+ *   size in bytes, then fragments, each a fragment header followed by
+ *   the ring item of the fragment.
+ */
+void
+CEventUnpacker::unpackBuiltBody(const void* pBody, size_t nBytes,
+                                CHitTable& hits)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(pBody);
+  uint32_t size;
+  if (nBytes < sizeof(size)) {
+    throw std::string("CEventUnpacker::unpackBuiltBody - body too small for its size");
+  }
+  memcpy(&size, p, sizeof(size));
+  if ((size < sizeof(size)) || (size > nBytes)) {
+    throw std::string("CEventUnpacker::unpackBuiltBody - inconsistent body size");
+  }
+  const uint8_t* pEnd = p + size;
+  p += sizeof(size);
+
+  while (p < pEnd) {
+    EVB::FragmentHeader fragment;
+    RingItemHeader      item;
+    uint32_t            bodyHeaderSize;
+    if (size_t(pEnd - p) < sizeof(fragment)) {
+      throw std::string("CEventUnpacker::unpackBuiltBody - truncated fragment header");
+    }
+    memcpy(&fragment, p, sizeof(fragment));
+    p += sizeof(fragment);
+    if (size_t(pEnd - p) < fragment.s_size) {
+      throw std::string("CEventUnpacker::unpackBuiltBody - fragment runs past the event");
+    }
+    const uint8_t* pPayload = p;
+    p += fragment.s_size;
+
+    if (fragment.s_size < sizeof(item) + sizeof(bodyHeaderSize)) continue;
+    memcpy(&item, pPayload, sizeof(item));
+    memcpy(&bodyHeaderSize, pPayload + sizeof(item), sizeof(bodyHeaderSize));
+    if (item.s_type != PHYSICS_EVENT) continue;
+    if (bodyHeaderSize == 0) {
+      bodyHeaderSize = sizeof(uint32_t);
+    }
+    size_t bodyOffset = sizeof(item) + bodyHeaderSize;
+    if ((item.s_size > fragment.s_size) || (bodyOffset > item.s_size)) {
+      throw std::string("CEventUnpacker::unpackBuiltBody - bad fragment ring item");
+    }
+    unpackBody(pPayload + bodyOffset, item.s_size - bodyOffset,
+               fragment.s_sourceId, hits);
+  }
+}
+
+/*
+** The modules of a source, those of AnySource if the source has none,
+** or null if neither has any.
+*/
+CEventUnpacker::Source*
+CEventUnpacker::findSource(uint32_t source)
+{
+  std::map<uint32_t, Source>::iterator p = m_sources.find(source);
+  if (p == m_sources.end()) {
+    p = m_sources.find(AnySource);
+  }
+  return p == m_sources.end() ? 0 : &(p->second);
+}
+/*
+** Deep copy of rhs's configuration into this.
+*/
+void
+CEventUnpacker::copyIn(const CEventUnpacker& rhs)
+{
+  m_built = rhs.m_built;
+  std::map<uint32_t, Source>::const_iterator p;
+  for (p = rhs.m_sources.begin(); p != rhs.m_sources.end(); ++p) {
+    Source& s(m_sources[p->first]);
+    s.s_prefixBytes = p->second.s_prefixBytes;
+    for (size_t i = 0; i < p->second.s_modules.size(); i++) {
+      s.s_modules.push_back(p->second.s_modules[i]->clone());
+    }
+  }
+}
+/*
+** Delete the module unpackers.
+*/
+void
+CEventUnpacker::destroy()
+{
+  std::map<uint32_t, Source>::iterator p;
+  for (p = m_sources.begin(); p != m_sources.end(); ++p) {
+    for (size_t i = 0; i < p->second.s_modules.size(); i++) {
+      delete p->second.s_modules[i];
+    }
+  }
+  m_sources.clear();
+}
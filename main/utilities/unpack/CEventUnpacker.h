@@ -0,0 +1,91 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CEventUnpacker.h
+ * @brief Unpack physics event bodies into a hit table.
+ */
+#ifndef CEVENTUNPACKER_H
+#define CEVENTUNPACKER_H
+
+#include <map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class CRingItem;
+class CHitTable;
+class CModuleUnpacker;
+
+/**
+ * @class CEventUnpacker
+ *
+ *   Knows what modules each data source reads and in what order, and
+ *   runs their unpackers over physics event bodies.
+ *
+ *   - Unbuilt events (from a readout ring) are unpacked with the modules
+ *     of the source id in their body header, or of AnySource if they
+ *     have no body header or that source has no modules of its own.
+ *   - Built events (from glom) are a sequence of fragments; each physics
+ *     event fragment is unpacked with the modules of its source id (or
+ *     AnySource).  Fragments of sources with no modules are skipped.
+ *
+ *   Some readouts put a few bytes in front of the module data (e.g. the
+ *   size longword of the SBS readout, the stack header of the VM-USB);
+ *   setPrefix says how many bytes to skip.  Anything after the last
+ *   module's data is ignored.
+ *
+ *   Errors in the data throw std::string.  The hits found before the
+ *   error remain in the table.
+ */
+class CEventUnpacker
+{
+public:
+  static const uint32_t AnySource = 0xffffffff;
+
+private:
+  typedef struct _Source {
+    size_t                          s_prefixBytes;
+    std::vector<CModuleUnpacker*>   s_modules;
+  } Source;
+
+  std::map<uint32_t, Source>  m_sources;
+  bool                        m_built;
+
+public:
+  CEventUnpacker();
+  CEventUnpacker(const CEventUnpacker& rhs);
+  virtual ~CEventUnpacker();
+
+  CEventUnpacker& operator=(const CEventUnpacker& rhs);
+
+  void addModule(CModuleUnpacker* pModule, uint32_t source = AnySource);
+  void setPrefix(size_t bytes, uint32_t source = AnySource);
+  void setBuilt(bool built) { m_built = built; }
+  bool isBuilt() const      { return m_built; }
+
+  void unpack(const CRingItem& item, CHitTable& hits);
+  void unpackBody(const void* pBody, size_t nBytes, uint32_t source,
+                  CHitTable& hits);
+  void unpackBuiltBody(const void* pBody, size_t nBytes, CHitTable& hits);
+
+private:
+  Source* findSource(uint32_t source);
+  void    copyIn(const CEventUnpacker& rhs);
+  void    destroy();
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CHitTable.cpp
+ * @brief Implement the hit table.
+ */
+
+#include "CHitTable.h"
+
+const uint32_t CHitTable::Overflow;
+const uint32_t CHitTable::Underflow;
+const uint32_t CHitTable::Trailing;
+
+/**
+ * constructor
+ *   Empty table.
+ */
+CHitTable::CHitTable() :
+  m_size(0)
+{
+}
+
+/**
+ * reserve
+ *   Make sure there's room for n hits beyond the current ones.  Columns
+ *   grow at least by doubling so events of slowly increasing size don't
+ *   reallocate every time.
+ */
+void
+CHitTable::reserve(size_t n)
+{
+  size_t needed = m_size + n;
+  if (needed <= m_value.size()) return;
+
+  size_t newSize = m_value.size() * 2;
+  if (newSize < needed) newSize = needed;
+  m_source.resize(newSize);
+  m_module.resize(newSize);
+  m_channel.resize(newSize);
+  m_value.resize(newSize);
+  m_flags.resize(newSize);
+}
+/**
+ * add
+ *   Append one hit.
+ */
+void
+CHitTable::add(uint32_t source, uint32_t module, uint32_t channel,
+               uint32_t value, uint32_t flags)
+{
+  reserve(1);
+  m_source[m_size]  = source;
+  m_module[m_size]  = module;
+  m_channel[m_size] = channel;
+  m_value[m_size]   = value;
+  m_flags[m_size]   = flags;
+  m_size++;
+}
@@ -0,0 +1,84 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CHitTable.h
+ * @brief Structure of arrays table of the hits decoded from an event.
+ */
+#ifndef CHITTABLE_H
+#define CHITTABLE_H
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class CHitTable
+ *
+ *   The hits of an event stored column by column: hit i is
+ *   source()[i], module()[i], channel()[i], value()[i], flags()[i].
+ *   Consumers that only need some of the columns (e.g. channel and value
+ *   to increment spectra) touch only those.
+ *
+ *   Columns are all 32 bits wide so the unpacking kernels can store whole
+ *   vectors into them.  Storage is kept between events; clear() only
+ *   forgets the hits so a table reused for each event stops allocating
+ *   once it has seen the largest event.
+ */
+class CHitTable
+{
+public:
+  // Bits in the flags column:
+
+  static const uint32_t Overflow  = 1;      // Value over range.
+  static const uint32_t Underflow = 2;      // Value under threshold.
+  static const uint32_t Trailing  = 4;      // TDC trailing edge.
+
+private:
+  size_t                 m_size;
+  std::vector<uint32_t>  m_source;
+  std::vector<uint32_t>  m_module;
+  std::vector<uint32_t>  m_channel;
+  std::vector<uint32_t>  m_value;
+  std::vector<uint32_t>  m_flags;
+
+public:
+  CHitTable();
+
+  size_t size() const  { return m_size; }
+  bool   empty() const { return m_size == 0; }
+  void   clear()       { m_size = 0; }
+  void   reserve(size_t n);
+  void   add(uint32_t source, uint32_t module, uint32_t channel,
+             uint32_t value, uint32_t flags = 0);
+
+  const uint32_t* source() const  { return m_source.data(); }
+  const uint32_t* module() const  { return m_module.data(); }
+  const uint32_t* channel() const { return m_channel.data(); }
+  const uint32_t* value() const   { return m_value.data(); }
+  const uint32_t* flags() const   { return m_flags.data(); }
+
+  // For the unpackers: reserve room, write past size() then commit.
+
+  uint32_t* sourceColumn()  { return m_source.data(); }
+  uint32_t* moduleColumn()  { return m_module.data(); }
+  uint32_t* channelColumn() { return m_channel.data(); }
+  uint32_t* valueColumn()   { return m_value.data(); }
+  uint32_t* flagsColumn()   { return m_flags.data(); }
+  void      commit(size_t n) { m_size += n; }
+};
+
+#endif
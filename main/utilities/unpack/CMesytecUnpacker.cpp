@@ -0,0 +1,114 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CMesytecUnpacker.cpp
+ * @brief Implement the MADC-32/MQDC-32 unpacker.
+ */
+
+#include "CMesytecUnpacker.h"
+#include "CHitTable.h"
+#include "UnpackKernel.h"
+
+#include <string>
+
+static const uint32_t SIGNATURE_MASK(0xc0000000);
+static const uint32_t HEADER(0x40000000);
+static const uint32_t END_OF_EVENT(0xc0000000);
+static const uint32_t SUBTYPE_MASK(0xffc00000);
+static const uint32_t DATA(0x04000000);
+static const uint32_t EXTENDED_TIMESTAMP(0x04800000);
+static const uint32_t FILL(0);
+
+static const unsigned ID_SHIFT(16);
+static const uint32_t ID_MASK(0xff);
+static const uint32_t COUNT_MASK(0xfff);
+
+static const UnpackKernel::Layout madcLayout = {
+  SUBTYPE_MASK, DATA,
+  16, 0x1f,                          // Channel.
+  0x1fff,                            // Value.
+  14, 1, 0                           // Out of range -> Overflow.
+};
+static const UnpackKernel::Layout mqdcLayout = {
+  SUBTYPE_MASK, DATA,
+  16, 0x1f,
+  0xfff,
+  15, 1, 0
+};
+
+/**
+ * constructor
+ *
+ * @param model - Which module; they differ in the value and overflow bits.
+ */
+CMesytecUnpacker::CMesytecUnpacker(Model model) :
+  m_model(model)
+{
+}
+/**
+ * clone
+ */
+CMesytecUnpacker*
+CMesytecUnpacker::clone() const
+{
+  return new CMesytecUnpacker(*this);
+}
+/**
+ * unpack
+ *   Decode the module's event.
+ *
+ * @return const uint32_t* - Past the end of event word.
+ * @throw  std::string - No header, the event runs past pEnd or has words
+ *                       that don't belong in it.
+ */
+const uint32_t*
+CMesytecUnpacker::unpack(const uint32_t* p, const uint32_t* pEnd,
+                         uint32_t source, CHitTable& hits)
+{
+  const UnpackKernel::Layout& layout(m_model == MADC32 ? madcLayout : mqdcLayout);
+
+  while ((p < pEnd) && (UnpackKernel::load(p) == FILL)) {
+    p++;
+  }
+  if ((p >= pEnd) ||
+      ((UnpackKernel::load(p) & SIGNATURE_MASK) != HEADER)) {
+    throw std::string("CMesytecUnpacker::unpack - expected a header");
+  }
+  uint32_t header = UnpackKernel::load(p);
+  uint32_t id     = (header >> ID_SHIFT) & ID_MASK;
+  size_t   count  = header & COUNT_MASK;
+  p++;
+  if ((count == 0) || (size_t(pEnd - p) < count)) {
+    throw std::string("CMesytecUnpacker::unpack - bad event word count");
+  }
+  const uint32_t* pLast = p + count - 1;        // End of event word.
+
+  while (p < pLast) {
+    p += UnpackKernel::decodeRun(p, pLast - p, layout, source, id, hits);
+    if (p < pLast) {
+      uint32_t word = UnpackKernel::load(p);
+      if ((word != FILL) && ((word & SUBTYPE_MASK) != EXTENDED_TIMESTAMP)) {
+        throw std::string("CMesytecUnpacker::unpack - unexpected word in the event");
+      }
+      p++;
+    }
+  }
+  if ((UnpackKernel::load(pLast) & SIGNATURE_MASK) != END_OF_EVENT) {
+    throw std::string("CMesytecUnpacker::unpack - expected an end of event");
+  }
+  return pLast + 1;
+}
@@ -0,0 +1,62 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CMesytecUnpacker.h
+ * @brief Unpacker for the Mesytec MADC-32 and MQDC-32.
+ */
+#ifndef CMESYTECUNPACKER_H
+#define CMESYTECUNPACKER_H
+
+#include "CModuleUnpacker.h"
+
+/**
+ * @class CMesytecUnpacker
+ *
+ *   The MADC-32 and MQDC-32 events are:
+ *
+ *   - Header: bits 31-30 01, module id 23-16, number of words that
+ *     follow (including the end of event) 11-0.
+ *   - Data: bits 31-22 0x010, channel 20-16 and the value; the MADC
+ *     value is bits 12-0 with bit 14 set if out of range, the MQDC value
+ *     is bits 11-0 with bit 15 set on overflow.
+ *   - Extended timestamp: bits 31-22 0x012 (skipped).
+ *   - End of event: bits 31-30 11, event counter or timestamp 29-0.
+ *
+ *   Zero fill words (from blocks padded to the transfer size) before the
+ *   header or among the data are skipped.  The module column is the
+ *   module id of the header.
+ */
+class CMesytecUnpacker : public CModuleUnpacker
+{
+public:
+  typedef enum _Model {
+    MADC32,
+    MQDC32
+  } Model;
+
+private:
+  Model m_model;
+
+public:
+  CMesytecUnpacker(Model model = MADC32);
+
+  virtual CMesytecUnpacker* clone() const;
+  virtual const uint32_t* unpack(const uint32_t* p, const uint32_t* pEnd,
+                                 uint32_t source, CHitTable& hits);
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CModuleUnpacker.h
+ * @brief Abstract base class of the unpackers for one module's data.
+ */
+#ifndef CMODULEUNPACKER_H
+#define CMODULEUNPACKER_H
+
+#include <stdint.h>
+
+class CHitTable;
+
+/**
+ * @class CModuleUnpacker
+ *
+ *   Decodes the data one module contributes to an event.  Concrete
+ *   classes know one data format.  unpack is handed the event from the
+ *   first word of the module's data on and returns a pointer past the
+ *   last word it used so the next module's unpacker can take over.
+ *
+ *   Data that isn't in the module's format throws a std::string
+ *   describing the problem.
+ */
+class CModuleUnpacker
+{
+public:
+  virtual ~CModuleUnpacker() {}
+
+  virtual CModuleUnpacker* clone() const = 0;
+  virtual const uint32_t* unpack(const uint32_t* p, const uint32_t* pEnd,
+                                 uint32_t source, CHitTable& hits) = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CUnpackingFilter.cpp
+ * @brief Implement the unpacking filter base class.
+ */
+
+#include "CUnpackingFilter.h"
+
+/**
+ * constructor
+ */
+CUnpackingFilter::CUnpackingFilter() :
+  m_badEvents(0)
+{
+}
+/**
+ * copy constructor
+ *   Copies the module configuration; the copy starts with no hits and
+ *   no bad events.
+ */
+CUnpackingFilter::CUnpackingFilter(const CUnpackingFilter& rhs) :
+  CFilter(rhs), m_unpacker(rhs.m_unpacker), m_badEvents(0)
+{
+}
+
+/**
+ * handlePhysicsEventItem
+ *   Unpack the event and give the hits to handleHits.
+ */
+CRingItem*
+CUnpackingFilter::handlePhysicsEventItem(CPhysicsEventItem* pItem)
+{
+  m_hits.clear();
+  try {
+    m_unpacker.unpack(*pItem, m_hits);
+  }
+  catch (std::string reason) {
+    m_hits.clear();
+    return handleBadEvent(pItem, reason);
+  }
+  return handleHits(pItem, m_hits);
+}
+/**
+ * handleBadEvent
+ *   Default handling of events that can't be unpacked: count them and
+ *   pass them on unmodified.
+ *
+ * @param pItem  - The event.
+ * @param reason - What the unpacker didn't like.
+ */
+CRingItem*
+CUnpackingFilter::handleBadEvent(CPhysicsEventItem* pItem,
+                                 const std::string& reason)
+{
+  m_badEvents++;
+  return pItem;
+}
@@ -0,0 +1,65 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file CUnpackingFilter.h
+ * @brief Filter base class that hands physics events over already unpacked.
+ */
+#ifndef CUNPACKINGFILTER_H
+#define CUNPACKINGFILTER_H
+
+#include <CFilter.h>
+#include "CEventUnpacker.h"
+#include "CHitTable.h"
+
+#include <string>
+#include <stdint.h>
+
+/**
+ * @class CUnpackingFilter
+ *
+ *   Filters that work on the hits of each physics event derive from this
+ *   class rather than CFilter.  Describe the modules to unpacker() (e.g.
+ *   in the constructor or initialize()) and implement handleHits, which
+ *   is called for each physics event with the event's hits.  Events the
+ *   unpacker can't make sense of are passed to handleBadEvent, which by
+ *   default counts them and passes them through.
+ *
+ *   As with CFilter, derived classes must implement clone.
+ */
+class CUnpackingFilter : public CFilter
+{
+private:
+  CEventUnpacker  m_unpacker;
+  CHitTable       m_hits;
+  uint64_t        m_badEvents;
+
+public:
+  CUnpackingFilter();
+  CUnpackingFilter(const CUnpackingFilter& rhs);
+
+  CEventUnpacker& unpacker()       { return m_unpacker; }
+  uint64_t        badEvents() const { return m_badEvents; }
+
+  virtual CRingItem* handlePhysicsEventItem(CPhysicsEventItem* pItem);
+
+  virtual CRingItem* handleHits(CPhysicsEventItem* pItem,
+                                const CHitTable& hits) = 0;
+  virtual CRingItem* handleBadEvent(CPhysicsEventItem* pItem,
+                                    const std::string& reason);
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file UnpackKernel.cpp
+ * @brief Implement the data word decode kernels.
+ */
+
+#include "UnpackKernel.h"
+#include "CHitTable.h"
+
+namespace UnpackKernel {
+
+typedef uint32_t Vector __attribute__((vector_size(Lanes*sizeof(uint32_t))));
+typedef int32_t  Mask   __attribute__((vector_size(Lanes*sizeof(uint32_t))));
+
+static_assert(Lanes == 4, "splat and the data word test assume 4 lanes");
+
+static inline Vector
+splat(uint32_t value)
+{
+  Vector result = {value, value, value, value};
+  return result;
+}
+
+/**
+ * decodeRun
+ *   Decode data words starting at p until n words have been decoded or
+ *   a word that is not a data word is found.  The hits are appended to
+ *   the table.
+ *
+ * @param p      - First word.
+ * @param n      - Maximum number of words to decode.
+ * @param layout - Where the fields are in the data words.
+ * @param source - Source id column value of the hits.
+ * @param module - Module column value of the hits.
+ * @param hits   - Table the hits are appended to.
+ *
+ * @return size_t - Number of words decoded; p[result] (if result < n) is
+ *                  the first word that is not a data word.
+ */
+size_t
+decodeRun(const uint32_t* p, size_t n, const Layout& layout,
+          uint32_t source, uint32_t module, CHitTable& hits)
+{
+  hits.reserve(n);
+  size_t    start   = hits.size();
+  uint32_t* pSource = hits.sourceColumn() + start;
+  uint32_t* pModule = hits.moduleColumn() + start;
+  uint32_t* pChan   = hits.channelColumn() + start;
+  uint32_t* pValue  = hits.valueColumn() + start;
+  uint32_t* pFlags  = hits.flagsColumn() + start;
+
+  const Vector typeMask  = splat(layout.s_typeMask);
+  const Vector typeValue = splat(layout.s_typeValue);
+  const Vector chanMask  = splat(layout.s_channelMask);
+  const Vector valueMask = splat(layout.s_valueMask);
+  const Vector flagMask  = splat(layout.s_flagMask);
+  const Vector sources   = splat(source);
+  const Vector modules   = splat(module);
+
+  size_t i = 0;
+  for (; i + Lanes <= n; i += Lanes) {
+    Vector words;
+    memcpy(&words, p + i, sizeof(words));
+
+    Mask   notData  = (words & typeMask) != typeValue;
+    if (notData[0] | notData[1] | notData[2] | notData[3]) {
+      break;                                       // Scalar finishes the run.
+    }
+    Vector channels = (words >> layout.s_channelShift) & chanMask;
+    Vector values   = words & valueMask;
+    Vector flags    = ((words >> layout.s_flagShift) & flagMask)
+                        << layout.s_flagPosition;
+
+    memcpy(pSource + i, &sources,  sizeof(Vector));
+    memcpy(pModule + i, &modules,  sizeof(Vector));
+    memcpy(pChan + i,   &channels, sizeof(Vector));
+    memcpy(pValue + i,  &values,   sizeof(Vector));
+    memcpy(pFlags + i,  &flags,    sizeof(Vector));
+  }
+  hits.commit(i);
+  return i + decodeRunScalar(p + i, n - i, layout, source, module, hits);
+}
+/**
+ * decodeRunScalar
+ *   Word at a time version of decodeRun.  Used for the end of runs and
+ *   as the reference the vector version is tested against.
+ */
+size_t
+decodeRunScalar(const uint32_t* p, size_t n, const Layout& layout,
+                uint32_t source, uint32_t module, CHitTable& hits)
+{
+  hits.reserve(n);
+  size_t    start   = hits.size();
+  uint32_t* pSource = hits.sourceColumn() + start;
+  uint32_t* pModule = hits.moduleColumn() + start;
+  uint32_t* pChan   = hits.channelColumn() + start;
+  uint32_t* pValue  = hits.valueColumn() + start;
+  uint32_t* pFlags  = hits.flagsColumn() + start;
+
+  size_t i = 0;
+  for (; i < n; i++) {
+    uint32_t word = load(p + i);
+    if ((word & layout.s_typeMask) != layout.s_typeValue) break;
+
+    pSource[i] = source;
+    pModule[i] = module;
+    pChan[i]   = (word >> layout.s_channelShift) & layout.s_channelMask;
+    pValue[i]  = word & layout.s_valueMask;
+    pFlags[i]  = ((word >> layout.s_flagShift) & layout.s_flagMask)
+                   << layout.s_flagPosition;
+  }
+  hits.commit(i);
+  return i;
+}
+
+}
@@ -0,0 +1,80 @@
+/*
+    This software is Copyright by the Board of Trustees of Michigan
+    State University (c) Copyright 2015.
+
+    You may use this software under the terms of the GNU public license
+    (GPL).  The terms of this license are described at:
+
+     http://www.gnu.org/licenses/gpl.txt
+
+     Author:
+             Ron Fox
+	     NSCL
+	     Michigan State University
+	     East Lansing, MI 48824-1321
+*/
+
+/**
+ * @file UnpackKernel.h
+ * @brief Vector decode of runs of digitizer data words.
+ */
+#ifndef UNPACKKERNEL_H
+#define UNPACKKERNEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class CHitTable;
+
+/**
+ *  All of the supported digitizers put their conversions out as a run of
+ *  data words between a header and a trailer, each word identified by
+ *  a type field and carrying a channel, a value and a few flag bits at
+ *  fixed positions.  Only those positions differ from module to module,
+ *  so one kernel, given a Layout, decodes the data words of all of them.
+ *
+ *  The kernel works on Lanes words at a time using the compiler's vector
+ *  extensions, which compile to SSE2 on x86_64 and NEON on ARM without
+ *  any special build flags.  Words are loaded with memcpy so the data
+ *  need not be aligned (VM-USB event bodies are only 16 bit aligned).
+ */
+namespace UnpackKernel {
+
+  static const size_t Lanes = 4;
+
+  /**
+   * Where the fields of a data word are.  A word is a data word if
+   * (word & s_typeMask) == s_typeValue.  The hit's flags are
+   * ((word >> s_flagShift) & s_flagMask) << s_flagPosition so a module's
+   * flag bits can be moved to the CHitTable flag bits.
+   */
+  typedef struct _Layout {
+    uint32_t  s_typeMask;
+    uint32_t  s_typeValue;
+    uint32_t  s_channelShift;
+    uint32_t  s_channelMask;        // After the shift.
+    uint32_t  s_valueMask;
+    uint32_t  s_flagShift;
+    uint32_t  s_flagMask;           // After the shift.
+    uint32_t  s_flagPosition;
+  } Layout;
+
+  /**
+   * Load a possibly unaligned word.
+   */
+  static inline uint32_t
+  load(const uint32_t* p)
+  {
+    uint32_t result;
+    memcpy(&result, p, sizeof(result));
+    return result;
+  }
+
+  size_t decodeRun(const uint32_t* p, size_t n, const Layout& layout,
+                   uint32_t source, uint32_t module, CHitTable& hits);
+  size_t decodeRunScalar(const uint32_t* p, size_t n, const Layout& layout,
+                         uint32_t source, uint32_t module, CHitTable& hits);
+}
+
+#endif
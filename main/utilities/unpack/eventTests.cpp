@@ -0,0 +1,260 @@
+// Tests for the event body unpacker and the unpacking filter.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CEventUnpacker.h"
+#include "CUnpackingFilter.h"
+#include "CHitTable.h"
+#include "CCAENV7xxUnpacker.h"
+#include "CMesytecUnpacker.h"
+
+#include <CPhysicsEventItem.h>
+#include <DataFormat.h>
+#include <fragment.h>
+
+#include <vector>
+#include <string>
+#include <string.h>
+
+// Filter that remembers the hits it's given.
+
+class CHitCountFilter : public CUnpackingFilter
+{
+public:
+  std::vector<uint32_t> m_values;
+  virtual CHitCountFilter* clone() const { return new CHitCountFilter(*this); }
+  virtual CRingItem* handleHits(CPhysicsEventItem* pItem, const CHitTable& hits) {
+    m_values.assign(hits.value(), hits.value() + hits.size());
+    return pItem;
+  }
+};
+
+class EventTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(EventTests);
+  CPPUNIT_TEST(raw);
+  CPPUNIT_TEST(prefix);
+  CPPUNIT_TEST(bySource);
+  CPPUNIT_TEST(built);
+  CPPUNIT_TEST(builtBadSize);
+  CPPUNIT_TEST(copy);
+  CPPUNIT_TEST(filter);
+  CPPUNIT_TEST(filterBadEvent);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  // A V7xx event with one hit per value, GEO geo.
+
+  static std::vector<uint32_t> caenEvent(uint32_t geo,
+                                         const std::vector<uint32_t>& values) {
+    std::vector<uint32_t> result;
+    result.push_back((geo << 27) | CCAENV7xxUnpacker::Header | (values.size() << 8));
+    for (size_t i = 0; i < values.size(); i++) {
+      result.push_back((geo << 27) | (i << 16) | values[i]);
+    }
+    result.push_back((geo << 27) | CCAENV7xxUnpacker::Trailer);
+    return result;
+  }
+  static std::vector<uint32_t> values(uint32_t first, size_t n) {
+    std::vector<uint32_t> result;
+    for (size_t i = 0; i < n; i++) result.push_back(first + i);
+    return result;
+  }
+  static void fill(CRingItem& item, const void* pData, size_t nBytes) {
+    uint8_t* p = static_cast<uint8_t*>(item.getBodyCursor());
+    memcpy(p, pData, nBytes);
+    item.setBodyCursor(p + nBytes);
+    item.updateSize();
+  }
+  static void fill(CRingItem& item, const std::vector<uint32_t>& words) {
+    fill(item, words.data(), words.size()*sizeof(uint32_t));
+  }
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void raw();
+  void prefix();
+  void bySource();
+  void built();
+  void builtBadSize();
+  void copy();
+  void filter();
+  void filterBadEvent();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EventTests);
+
+// Modules are unpacked in order; trailing words are ignored.
+
+void EventTests::raw()
+{
+  std::vector<uint32_t> body = caenEvent(1, values(100, 3));
+  std::vector<uint32_t> second = caenEvent(2, values(200, 6));
+  body.insert(body.end(), second.begin(), second.end());
+  body.push_back(0xffffffff);
+
+  CPhysicsEventItem item;
+  fill(item, body);
+
+  CEventUnpacker unpacker;
+  unpacker.addModule(new CCAENV7xxUnpacker);
+  unpacker.addModule(new CCAENV7xxUnpacker);
+  CHitTable hits;
+  unpacker.unpack(item, hits);
+
+  EQ(size_t(9), hits.size());
+  EQ(uint32_t(1), hits.module()[0]);
+  EQ(uint32_t(102), hits.value()[2]);
+  EQ(uint32_t(2), hits.module()[3]);
+  EQ(uint32_t(205), hits.value()[8]);
+  EQ(CEventUnpacker::AnySource, hits.source()[0]);
+}
+// A 16 bit prefix (VM-USB stack header) leaves the data unaligned.
+
+void EventTests::prefix()
+{
+  std::vector<uint32_t> words = caenEvent(3, values(10, 5));
+  std::vector<uint8_t>  body(2 + words.size()*sizeof(uint32_t));
+  memcpy(body.data() + 2, words.data(), words.size()*sizeof(uint32_t));
+
+  CPhysicsEventItem item;
+  fill(item, body.data(), body.size());
+
+  CEventUnpacker unpacker;
+  unpacker.addModule(new CCAENV7xxUnpacker);
+  unpacker.setPrefix(2);
+  CHitTable hits;
+  unpacker.unpack(item, hits);
+  EQ(size_t(5), hits.size());
+  EQ(uint32_t(14), hits.value()[4]);
+}
+// The body header source id picks the modules.
+
+void EventTests::bySource()
+{
+  std::vector<uint32_t> body;
+  body.push_back(0x40000000 | (9 << 16) | 2);
+  body.push_back(0x04000000 | (4 << 16) | 77);
+  body.push_back(0xc0000000);
+
+  CPhysicsEventItem item(12345, 5, 0);
+  fill(item, body);
+
+  CEventUnpacker unpacker;
+  unpacker.addModule(new CCAENV7xxUnpacker);
+  unpacker.addModule(new CMesytecUnpacker, 5);
+  CHitTable hits;
+  unpacker.unpack(item, hits);
+
+  EQ(size_t(1), hits.size());
+  EQ(uint32_t(5),  hits.source()[0]);
+  EQ(uint32_t(9),  hits.module()[0]);
+  EQ(uint32_t(4),  hits.channel()[0]);
+  EQ(uint32_t(77), hits.value()[0]);
+}
+// Built events: each physics fragment is unpacked with the modules of its
+// source; other fragments and unknown sources are skipped.
+
+void EventTests::built()
+{
+  CPhysicsEventItem frag1(100, 1, 0);
+  fill(frag1, caenEvent(4, values(1, 4)));
+  CPhysicsEventItem frag2;                   // No body header.
+  fill(frag2, caenEvent(6, values(50, 2)));
+  CPhysicsEventItem frag3(100, 3, 0);        // Source with no modules.
+  fill(frag3, caenEvent(8, values(90, 2)));
+
+  struct { CRingItem* s_item; uint32_t s_source; } frags[] = {
+    {&frag1, 1}, {&frag3, 3}, {&frag2, 2}
+  };
+  std::vector<uint8_t> body(sizeof(uint32_t));
+  for (int i = 0; i < 3; i++) {
+    EVB::FragmentHeader h = {100, frags[i].s_source, frags[i].s_item->size(), 0};
+    const uint8_t* pH = reinterpret_cast<const uint8_t*>(&h);
+    const uint8_t* pI = reinterpret_cast<const uint8_t*>(frags[i].s_item->getItemPointer());
+    body.insert(body.end(), pH, pH + sizeof(h));
+    body.insert(body.end(), pI, pI + frags[i].s_item->size());
+  }
+  uint32_t size = body.size();
+  memcpy(body.data(), &size, sizeof(size));
+
+  CPhysicsEventItem item(100, 10, 0);
+  fill(item, body.data(), body.size());
+
+  CEventUnpacker unpacker;
+  unpacker.setBuilt(true);
+  unpacker.addModule(new CCAENV7xxUnpacker, 1);
+  unpacker.addModule(new CCAENV7xxUnpacker, 2);
+  CHitTable hits;
+  unpacker.unpack(item, hits);
+
+  EQ(size_t(6), hits.size());
+  EQ(uint32_t(1), hits.source()[0]);
+  EQ(uint32_t(4), hits.module()[3]);
+  EQ(uint32_t(2), hits.source()[4]);
+  EQ(uint32_t(6), hits.module()[4]);
+  EQ(uint32_t(51), hits.value()[5]);
+}
+// A built body whose size runs past the item is rejected.
+
+void EventTests::builtBadSize()
+{
+  uint32_t body[] = {1000, 0};
+  CEventUnpacker unpacker;
+  CHitTable hits;
+  EXCEPTION(unpacker.unpackBuiltBody(body, sizeof(body), hits), std::string);
+}
+// Copies have their own modules.
+
+void EventTests::copy()
+{
+  CEventUnpacker* pOriginal = new CEventUnpacker;
+  pOriginal->addModule(new CCAENV7xxUnpacker);
+  pOriginal->setPrefix(4);
+  CEventUnpacker copy(*pOriginal);
+  delete pOriginal;
+
+  std::vector<uint32_t> body(1, 0xabcd);
+  std::vector<uint32_t> words = caenEvent(2, values(7, 2));
+  body.insert(body.end(), words.begin(), words.end());
+  CHitTable hits;
+  copy.unpackBody(body.data(), body.size()*sizeof(uint32_t), 0, hits);
+  EQ(size_t(2), hits.size());
+}
+// The filter hands the hits of each event to handleHits.
+
+void EventTests::filter()
+{
+  CHitCountFilter f;
+  f.unpacker().addModule(new CCAENV7xxUnpacker);
+
+  CPhysicsEventItem item;
+  fill(item, caenEvent(1, values(300, 3)));
+  EQ(static_cast<CRingItem*>(&item), f.handlePhysicsEventItem(&item));
+  EQ(size_t(3), f.m_values.size());
+  EQ(uint32_t(302), f.m_values[2]);
+
+  CHitCountFilter* pClone = f.clone();
+  pClone->handlePhysicsEventItem(&item);
+  EQ(size_t(3), pClone->m_values.size());
+  delete pClone;
+}
+// Events that don't unpack are counted and passed through.
+
+void EventTests::filterBadEvent()
+{
+  CHitCountFilter f;
+  f.unpacker().addModule(new CCAENV7xxUnpacker);
+
+  uint32_t garbage[] = {0x12345678};
+  CPhysicsEventItem item;
+  fill(item, garbage, sizeof(garbage));
+  EQ(static_cast<CRingItem*>(&item), f.handlePhysicsEventItem(&item));
+  EQ(uint64_t(1), f.badEvents());
+  EQ(size_t(0), f.m_values.size());
+}
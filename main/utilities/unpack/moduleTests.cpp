@@ -0,0 +1,358 @@
+// Tests for the decode kernels and the module unpackers.
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/Asserter.h>
+#include "Asserts.h"
+
+#include "CHitTable.h"
+#include "UnpackKernel.h"
+#include "CCAENV7xxUnpacker.h"
+#include "CCAENV1x90Unpacker.h"
+#include "CMesytecUnpacker.h"
+
+#include <CCAENV1x90Data.h>
+
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+class ModuleTests : public CppUnit::TestFixture {
+  CPPUNIT_TEST_SUITE(ModuleTests);
+  CPPUNIT_TEST(vectorMatchesScalar);
+  CPPUNIT_TEST(unaligned);
+  CPPUNIT_TEST(tableGrows);
+  CPPUNIT_TEST(v7xx);
+  CPPUNIT_TEST(v7xxInvalid);
+  CPPUNIT_TEST(v7xxErrors);
+  CPPUNIT_TEST(v1190);
+  CPPUNIT_TEST(v1290);
+  CPPUNIT_TEST(v1x90NoTrailer);
+  CPPUNIT_TEST(madc);
+  CPPUNIT_TEST(mqdc);
+  CPPUNIT_TEST(mesytecErrors);
+  CPPUNIT_TEST_SUITE_END();
+
+private:
+  // Words of a V7xx event.
+
+  static uint32_t caenHeader(uint32_t geo, uint32_t count) {
+    return (geo << 27) | CCAENV7xxUnpacker::Header | (count << 8);
+  }
+  static uint32_t caenData(uint32_t geo, uint32_t chan, uint32_t value,
+                           bool un = false, bool ov = false) {
+    return (geo << 27) | (chan << 16) | (un ? 0x2000 : 0) | (ov ? 0x1000 : 0) |
+      value;
+  }
+  static uint32_t caenTrailer(uint32_t geo, uint32_t count) {
+    return (geo << 27) | CCAENV7xxUnpacker::Trailer | count;
+  }
+  static uint32_t tdcMeasurement(bool is1190, uint32_t chan, uint32_t value,
+                                 bool trailing) {
+    return (trailing ? CCAENV1x90Data::TRAILING_BIT : 0) |
+      (chan << (is1190 ? CCAENV1x90Data::V1190CHANNEL_RSHIFT :
+                         CCAENV1x90Data::V1290CHANNEL_RSHIFT)) | value;
+  }
+
+public:
+  void setUp() {
+  }
+  void tearDown() {
+  }
+protected:
+  void vectorMatchesScalar();
+  void unaligned();
+  void tableGrows();
+  void v7xx();
+  void v7xxInvalid();
+  void v7xxErrors();
+  void v1190();
+  void v1290();
+  void v1x90NoTrailer();
+  void madc();
+  void mqdc();
+  void mesytecErrors();
+private:
+  void v1x90(bool is1190);
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(ModuleTests);
+
+static const UnpackKernel::Layout testLayout = {
+  0x07000000, 0, 16, 0x1f, 0xfff, 12, 3, 0
+};
+
+static void
+sameHits(const CHitTable& a, const CHitTable& b)
+{
+  EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    EQ(a.source()[i], b.source()[i]);
+    EQ(a.module()[i], b.module()[i]);
+    EQ(a.channel()[i], b.channel()[i]);
+    EQ(a.value()[i], b.value()[i]);
+    EQ(a.flags()[i], b.flags()[i]);
+  }
+}
+
+// Runs of every length ending at every position decode the same way
+// with the vector and scalar kernels.
+
+void ModuleTests::vectorMatchesScalar()
+{
+  srand(1234);
+  for (size_t length = 0; length < 20; length++) {
+    for (size_t bad = 0; bad <= length; bad++) {
+      std::vector<uint32_t> words;
+      for (size_t i = 0; i < length; i++) {
+        words.push_back(rand() & 0xf8ffffff);       // Type 0 data words.
+      }
+      if (bad < length) words[bad] |= 0x04000000;   // Non data word.
+
+      CHitTable vector, scalar;
+      size_t nv = UnpackKernel::decodeRun(words.data(), length, testLayout,
+                                          3, 7, vector);
+      size_t ns = UnpackKernel::decodeRunScalar(words.data(), length,
+                                                testLayout, 3, 7, scalar);
+      EQ(bad, nv);
+      EQ(bad, ns);
+      sameHits(scalar, vector);
+    }
+  }
+}
+// Data only 16 bit aligned (as in VM-USB events) is fine.
+
+void ModuleTests::unaligned()
+{
+  uint16_t buffer[2*9 + 1];
+  uint32_t words[9];
+  for (int i = 0; i < 9; i++) {
+    words[i] = caenData(4, i, 100+i, false, (i == 5));
+  }
+  memcpy(buffer + 1, words, sizeof(words));
+
+  CHitTable hits;
+  const uint32_t* p = reinterpret_cast<const uint32_t*>(buffer + 1);
+  EQ(size_t(9), UnpackKernel::decodeRun(p, 9, testLayout, 0, 4, hits));
+  EQ(size_t(9), hits.size());
+  for (uint32_t i = 0; i < 9; i++) {
+    EQ(i, hits.channel()[i]);
+    EQ(100+i, hits.value()[i]);
+    EQ(i == 5 ? CHitTable::Overflow : uint32_t(0), hits.flags()[i]);
+  }
+}
+// The table keeps its hits as it grows and clear empties it.
+
+void ModuleTests::tableGrows()
+{
+  CHitTable hits;
+  for (uint32_t i = 0; i < 1000; i++) {
+    hits.add(1, 2, i, 2*i, i & 1);
+  }
+  EQ(size_t(1000), hits.size());
+  for (uint32_t i = 0; i < 1000; i++) {
+    EQ(i, hits.channel()[i]);
+    EQ(2*i, hits.value()[i]);
+    EQ(i & 1, hits.flags()[i]);
+  }
+  hits.clear();
+  ASSERT(hits.empty());
+}
+// A V7xx event: hits have the GEO and the OV/UN flags.
+
+void ModuleTests::v7xx()
+{
+  uint32_t event[] = {
+    caenHeader(10, 5),
+    caenData(10, 0, 123),
+    caenData(10, 1, 4095, false, true),
+    caenData(10, 2, 0, true, false),
+    caenData(10, 17, 2000),
+    caenData(10, 31, 1),
+    caenTrailer(10, 42),
+    0xdeadbeef                           // Next module's data.
+  };
+  CHitTable hits;
+  CCAENV7xxUnpacker unpacker;
+  const uint32_t* pEnd = event + sizeof(event)/sizeof(uint32_t);
+  EQ((const uint32_t*)(event + 7), unpacker.unpack(event, pEnd, 9, hits));
+
+  EQ(size_t(5), hits.size());
+  uint32_t channels[] = {0, 1, 2, 17, 31};
+  uint32_t values[]   = {123, 4095, 0, 2000, 1};
+  uint32_t flags[]    = {0, CHitTable::Overflow, CHitTable::Underflow, 0, 0};
+  for (int i = 0; i < 5; i++) {
+    EQ(uint32_t(9),  hits.source()[i]);
+    EQ(uint32_t(10), hits.module()[i]);
+    EQ(channels[i],  hits.channel()[i]);
+    EQ(values[i],    hits.value()[i]);
+    EQ(flags[i],     hits.flags()[i]);
+  }
+}
+// Invalid data words mean the module had no event.
+
+void ModuleTests::v7xxInvalid()
+{
+  uint32_t event[] = {
+    CCAENV7xxUnpacker::Invalid, CCAENV7xxUnpacker::Invalid, caenHeader(1, 0)
+  };
+  CHitTable hits;
+  CCAENV7xxUnpacker unpacker;
+  EQ((const uint32_t*)(event + 2), unpacker.unpack(event, event + 3, 0, hits));
+  EQ(size_t(0), hits.size());
+}
+// Bad headers, short events, missing trailers throw.
+
+void ModuleTests::v7xxErrors()
+{
+  CHitTable hits;
+  CCAENV7xxUnpacker unpacker;
+
+  uint32_t noHeader[] = {caenData(1, 0, 0), caenTrailer(1, 0)};
+  EXCEPTION(unpacker.unpack(noHeader, noHeader + 2, 0, hits), std::string);
+
+  uint32_t shortEvent[] = {caenHeader(1, 3), caenData(1, 0, 0)};
+  EXCEPTION(unpacker.unpack(shortEvent, shortEvent + 2, 0, hits), std::string);
+
+  uint32_t noTrailer[] = {caenHeader(1, 1), caenData(1, 0, 0), caenHeader(1, 0)};
+  EXCEPTION(unpacker.unpack(noTrailer, noTrailer + 3, 0, hits), std::string);
+
+  uint32_t countWrong[] = {caenHeader(1, 2), caenData(1, 0, 0), caenTrailer(1, 0),
+                           caenTrailer(1, 0)};
+  EXCEPTION(unpacker.unpack(countWrong, countWrong + 4, 0, hits), std::string);
+}
+// V1x90 hits agree with the CCAENV1x90Data decode of the same words.
+
+void ModuleTests::v1x90(bool is1190)
+{
+  std::vector<uint32_t> event;
+  event.push_back(CCAENV1x90Data::FILLER_LONG);
+  event.push_back(CCAENV1x90Data::GLOBAL_HEADER | 0x100 | 13);
+  event.push_back(CCAENV1x90Data::TDC_HEADER);
+
+  uint32_t maxChannel = is1190 ? 128 : 32;
+  uint32_t maxValue   = is1190 ? CCAENV1x90Data::V1190DATA_MASK :
+                                 CCAENV1x90Data::V1290DATA_MASK;
+  srand(42);
+  for (int i = 0; i < 50; i++) {
+    if (i == 23) {
+      event.push_back(CCAENV1x90Data::TDC_TRAILER);
+      event.push_back(CCAENV1x90Data::TDC_ERROR);
+      event.push_back(CCAENV1x90Data::TDC_HEADER);
+    }
+    event.push_back(tdcMeasurement(is1190, rand() % maxChannel,
+                                   rand() & maxValue, rand() & 1));
+  }
+  event.push_back(CCAENV1x90Data::TDC_TRAILER);
+  event.push_back(CCAENV1x90Data::TRIGGER_TIME | 12345);
+  event.push_back(CCAENV1x90Data::GLOBAL_TRAILER);
+
+  CHitTable hits;
+  CCAENV1x90Unpacker unpacker(is1190);
+  const uint32_t* pEnd = event.data() + event.size();
+  EQ(pEnd, unpacker.unpack(event.data(), pEnd, 2, hits));
+
+  EQ(size_t(50), hits.size());
+  size_t hit = 0;
+  for (size_t i = 0; i < event.size(); i++) {
+    uint32_t word = event[i];
+    if (!CCAENV1x90Data::isMeasurement(word)) continue;
+    EQ(uint32_t(13), hits.module()[hit]);
+    EQ(uint32_t(CCAENV1x90Data::ChannelNumber(word, is1190)), hits.channel()[hit]);
+    EQ(uint32_t(CCAENV1x90Data::ChannelValue(word, is1190)), hits.value()[hit]);
+    EQ(CCAENV1x90Data::isTrailing(word) ? CHitTable::Trailing : uint32_t(0),
+       hits.flags()[hit]);
+    hit++;
+  }
+  EQ(size_t(50), hit);
+}
+void ModuleTests::v1190()
+{
+  v1x90(true);
+}
+void ModuleTests::v1290()
+{
+  v1x90(false);
+}
+// A V1x90 event must start with a global header and end with a trailer.
+
+void ModuleTests::v1x90NoTrailer()
+{
+  CHitTable hits;
+  CCAENV1x90Unpacker unpacker;
+  uint32_t noTrailer[] = {CCAENV1x90Data::GLOBAL_HEADER, 0, 0};
+  EXCEPTION(unpacker.unpack(noTrailer, noTrailer + 3, 0, hits), std::string);
+
+  uint32_t noHeader[] = {0, CCAENV1x90Data::GLOBAL_TRAILER};
+  EXCEPTION(unpacker.unpack(noHeader, noHeader + 2, 0, hits), std::string);
+}
+// MADC-32: 13 bit values, out of range bit 14, extended timestamp and
+// fill words are skipped.
+
+void ModuleTests::madc()
+{
+  uint32_t event[] = {
+    0, 0,                                // Fill before the event.
+    0x40000000 | (7 << 16) | 7,          // Header: id 7, 7 words follow.
+    0x04000000 | (0 << 16) | 0x1fff,
+    0x04000000 | (5 << 16) | 0x4000 | 100,
+    0,
+    0x04000000 | (31 << 16) | 4000,
+    0x04000000 | (12 << 16) | 1,
+    0x04800000 | 0xffff,                 // Extended timestamp.
+    0xc0000000 | 1234                    // End of event.
+  };
+  CHitTable hits;
+  CMesytecUnpacker unpacker(CMesytecUnpacker::MADC32);
+  const uint32_t* pEnd = event + sizeof(event)/sizeof(uint32_t);
+  EQ(pEnd, unpacker.unpack(event, pEnd, 1, hits));
+
+  EQ(size_t(4), hits.size());
+  uint32_t channels[] = {0, 5, 31, 12};
+  uint32_t values[]   = {0x1fff, 100, 4000, 1};
+  uint32_t flags[]    = {0, CHitTable::Overflow, 0, 0};
+  for (int i = 0; i < 4; i++) {
+    EQ(uint32_t(7), hits.module()[i]);
+    EQ(channels[i], hits.channel()[i]);
+    EQ(values[i],   hits.value()[i]);
+    EQ(flags[i],    hits.flags()[i]);
+  }
+}
+// MQDC-32: 12 bit values, overflow bit 15.
+
+void ModuleTests::mqdc()
+{
+  uint32_t event[] = {
+    0x40000000 | (3 << 16) | 3,
+    0x04000000 | (1 << 16) | 0x8000 | 0xfff,
+    0x04000000 | (2 << 16) | 0x1abc,     // Bit 12 isn't part of the value.
+    0xc0000000
+  };
+  CHitTable hits;
+  CMesytecUnpacker unpacker(CMesytecUnpacker::MQDC32);
+  EQ((const uint32_t*)(event + 4), unpacker.unpack(event, event + 4, 1, hits));
+  EQ(size_t(2), hits.size());
+  EQ(uint32_t(0xfff), hits.value()[0]);
+  EQ(CHitTable::Overflow, hits.flags()[0]);
+  EQ(uint32_t(0xabc), hits.value()[1]);
+  EQ(uint32_t(0), hits.flags()[1]);
+}
+// Missing header, end of event or stray words throw.
+
+void ModuleTests::mesytecErrors()
+{
+  CHitTable hits;
+  CMesytecUnpacker unpacker;
+
+  uint32_t noHeader[] = {0x04000000, 0xc0000000};
+  EXCEPTION(unpacker.unpack(noHeader, noHeader + 2, 0, hits), std::string);
+
+  uint32_t tooLong[] = {0x40000005, 0x04000000, 0xc0000000};
+  EXCEPTION(unpacker.unpack(tooLong, tooLong + 3, 0, hits), std::string);
+
+  uint32_t noEnd[] = {0x40000002, 0x04000000, 0x04000001};
+  EXCEPTION(unpacker.unpack(noEnd, noEnd + 3, 0, hits), std::string);
+
+  uint32_t stray[] = {0x40000003, 0x04000000, 0x40000000, 0xc0000000};
+  EXCEPTION(unpacker.unpack(stray, stray + 4, 0, hits), std::string);
+}